@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+""" Compares two micro_bench JSON results and flags regressions
+
+Time is noisy, so ns/op is flagged only beyond the threshold. Bytes and
+allocations per op are deterministic, so any increase beyond the threshold
+is flagged too, and an allocation appearing where there was none always is.
+
+Usage: compare_bench.py [--threshold percent] base.json new.json
+Exits with 1 if any case regressed.
+"""
+
+import argparse
+import json
+import sys
+
+
+METRICS = (("ns_per_op", "ns/op"), ("bytes_per_op", "bytes/op"), ("allocs_per_op", "allocs/op"))
+
+
+def load_results(path):
+    """ Returns results of a run keyed by case name
+    """
+    with open(path) as results_file:
+        return {result["name"]: result for result in json.load(results_file)["results"]}
+
+
+def change_percent(base, new):
+    """ Returns relative change from base to new in percent
+    """
+    if base == 0:
+        return 0.0 if new == 0 else float("inf")
+    return (new - base) * 100.0 / base
+
+
+def main():
+    """ Prints a per case comparison, returns process exit status
+    """
+    parser = argparse.ArgumentParser(description="Compare two micro_bench runs")
+    parser.add_argument("base", help="results of the reference run")
+    parser.add_argument("new", help="results of the run under test")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="regression threshold in percent (default 10)")
+    args = parser.parse_args()
+
+    base = load_results(args.base)
+    new = load_results(args.new)
+    regressions = []
+
+    print("%-40s %12s %12s %9s  %s" % ("case", "base ns/op", "new ns/op", "change", "bytes/op, allocs/op"))
+    for name in sorted(set(base) | set(new)):
+        if name not in new:
+            print("%-40s %s" % (name, "missing in new run"))
+            continue
+        if name not in base:
+            print("%-40s %s" % (name, "new case"))
+            continue
+
+        flags = []
+        for key, label in METRICS:
+            change = change_percent(base[name][key], new[name][key])
+            if change > args.threshold:
+                flags.append(label)
+        if flags:
+            regressions.append(name)
+
+        print("%-40s %12.1f %12.1f %+8.1f%%  %.1f -> %.1f, %.2f -> %.2f%s" % (
+            name, base[name]["ns_per_op"], new[name]["ns_per_op"],
+            change_percent(base[name]["ns_per_op"], new[name]["ns_per_op"]),
+            base[name]["bytes_per_op"], new[name]["bytes_per_op"],
+            base[name]["allocs_per_op"], new[name]["allocs_per_op"],
+            "  REGRESSION (" + ", ".join(flags) + ")" if flags else ""))
+
+    if regressions:
+        print("%d case(s) regressed beyond %.1f%%" % (len(regressions), args.threshold))
+        return 1
+    print("No regressions beyond %.1f%%" % args.threshold)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
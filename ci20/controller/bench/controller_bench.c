@@ -0,0 +1,213 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/**
+ * Controller event handling benchmark against the offline FlowCloud
+ * stand-in: cost of a sensor event (parse, relay logic, history, commands
+ * to flow thread) and of applying changed and unchanged settings.
+ * Controller files are created in the working directory.
+ *
+ * Usage: controller_bench [-n events] [-s settings updates]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "flow/flowcore.h"
+#include "controller.h"
+#include "flow_interface.h"
+#include "controller_stats.h"
+#include "flow_stub.h"
+
+#define QUEUE_SIZE (64)
+#define USER_ID "user"
+#define SENSOR_ID "sensor"
+#define ACTUATOR_ID "actuator"
+
+#define SETTINGS_FORMAT \
+	"<ControllerConfig>" \
+	"<TemperatureThreshold>%0.2f</TemperatureThreshold><HumidityThreshold>40.00</HumidityThreshold>" \
+	"<TemperatureOrientation>BELOW</TemperatureOrientation><HumidityOrientation>ABOVE</HumidityOrientation>" \
+	"<HeartBeat>15000</HeartBeat>" \
+	"<SensorConfig><HeartBeat>15000</HeartBeat><TemperatureReadInterval>1000</TemperatureReadInterval>" \
+	"<HumidityReadInterval>2500</HumidityReadInterval><TemperatureReadDelta>0.50</TemperatureReadDelta>" \
+	"<HumidityReadDelta>2.00</HumidityReadDelta></SensorConfig>" \
+	"<ActuatorConfig><HeartBeat>15000</HeartBeat></ActuatorConfig>" \
+	"</ControllerConfig>"
+
+#define SENSOR_EVENT_FORMAT \
+	"<event><type>Sensor</type><info><Temperature>%0.2f</Temperature><Humidity>%0.2f</Humidity></info></event>"
+
+#define ACTUATOR_EVENT_XML \
+	"<event><type>Actuator</type><info><Relay_1>OFF</Relay_1><Relay_2>OFF</Relay_2></info></event>"
+
+static Controller _Controller;
+static unsigned long _commands;
+
+static double NowSeconds(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * Stand in for flow thread, dropping everything posted to it
+ */
+static void DrainCommands(Controller *me)
+{
+	FlowInterfaceCmd *cmd;
+
+	while ((cmd = FlowQueue_DequeueWaitFor(me->sendMsgQueue, 0)) != NULL)
+	{
+		Flow_MemFree(&cmd->details);
+		Flow_MemFree((void **)&cmd);
+		_commands++;
+	}
+}
+
+static void HandleEvent(Controller *me, ControllerEvent_Type evtType, void *details)
+{
+	ControllerEvent *event = Flow_MemAlloc(sizeof(ControllerEvent));
+
+	event->evtType = evtType;
+	event->details = details;
+	ControllerHandleEvent(me, event);
+	DrainCommands(me);
+}
+
+static void HandleMessage(Controller *me, const char *from, const char *content)
+{
+	ReceivedMessage *message = Flow_MemAlloc(sizeof(ReceivedMessage));
+
+	message->sendorId = FlowString_Duplicate(from);
+	message->data = FlowString_Duplicate(content);
+	HandleEvent(me, ControllerEvent_ReceivedMessage, message);
+}
+
+static void HandleSettings(Controller *me, float threshold)
+{
+	char settings[1024];
+
+	snprintf(settings, sizeof(settings), SETTINGS_FORMAT, threshold);
+	HandleEvent(me, ControllerEvent_SettingSuccess, FlowString_Duplicate(settings));
+}
+
+int main(int argc, char *argv[])
+{
+	Controller *me = &_Controller;
+	unsigned int events = 100000;
+	unsigned int updates = 10000;
+	char content[256];
+	double start, elapsed;
+	unsigned int i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:s:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'n': events = strtoul(optarg, NULL, 10); break;
+			case 's': updates = strtoul(optarg, NULL, 10); break;
+			default:
+				fprintf(stderr, "Usage: %s [-n events] [-s settings updates]\n", argv[0]);
+				return 1;
+		}
+	}
+
+	FlowStub_UseVirtualTime(time(NULL));
+	ControllerSetDefaults(me);
+	me->stateDir = ".";	//Scratch directory make runs this in
+	strcpy(me->userId, USER_ID);
+	me->sendMsgQueue = FlowQueue_NewBlocking(QUEUE_SIZE);
+	me->receiveMsgQueue = FlowQueue_NewBlocking(QUEUE_SIZE);
+
+	ControllerStart(me);
+	DrainCommands(me);
+	HandleMessage(me, SENSOR_ID, "<event><type>Sensor</type><info><Temperature>20</Temperature><Humidity>40</Humidity></info></event>");
+	HandleMessage(me, ACTUATOR_ID, ACTUATOR_EVENT_XML);
+	HandleSettings(me, 22.5f);
+
+	printf("events %u, settings updates %u\n", events, updates);
+
+	//Sensor events, crossing temperature threshold every 16 events
+	_commands = 0;
+	start = NowSeconds();
+	for (i = 0; i < events; ++i)
+	{
+		snprintf(content, sizeof(content), SENSOR_EVENT_FORMAT, ((i / 16) & 1) ? 18.0 : 26.0, 35.0 + (i % 7));
+		HandleMessage(me, SENSOR_ID, content);
+		if ((i % 1000) == 0)
+		{
+			ControllerEvent *event;
+
+			//Let timers run, as they would between sensor events
+			FlowStub_AdvanceTime(1000);
+			while ((event = FlowQueue_DequeueWaitFor(me->receiveMsgQueue, 0)) != NULL)
+			{
+				ControllerHandleEvent(me, event);
+				DrainCommands(me);
+			}
+		}
+	}
+	elapsed = NowSeconds() - start;
+	printf("sensor      %10.2f us/event, %.2f commands/event\n", elapsed * 1e6 / events, (double)_commands / events);
+
+	//Settings, alternating between two sets
+	_commands = 0;
+	start = NowSeconds();
+	for (i = 0; i < updates; ++i)
+	{
+		HandleSettings(me, (i & 1) ? 22.5f : 23.0f);
+	}
+	elapsed = NowSeconds() - start;
+	printf("changed     %10.2f us/update, %.2f commands/update\n", elapsed * 1e6 / updates, (double)_commands / updates);
+
+	//Same settings over and over
+	_commands = 0;
+	start = NowSeconds();
+	for (i = 0; i < updates; ++i)
+	{
+		HandleSettings(me, 23.0f);
+	}
+	elapsed = NowSeconds() - start;
+	printf("unchanged   %10.2f us/update, %.2f commands/update\n", elapsed * 1e6 / updates, (double)_commands / updates);
+
+	printf("outstanding %10ld allocations\n", FlowStub_OutstandingAllocations());
+	return 0;
+}
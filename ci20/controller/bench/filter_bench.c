@@ -0,0 +1,385 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/**
+ * ADC oversampling, filters and read scheduling of the Wi-Fire sensor.
+ * First the error of the ADC scan's averaged values, per oversampling,
+ * against a simulated input with noise counts of noise. Each trace is replayed through the sensor's read path, firmware
+ * built for host: ADC conversion, filter and read delta comparison.
+ * Reports, per filter configuration, the change messages it would send
+ * and how far the reported value is from the true one. Then, per back off
+ * of the sensor thread's schedule, its wakeups, sensor reads and messages,
+ * and the detection latency: from the true value moving more than the
+ * read delta from the reported one till a change message is sent.
+ *
+ * A trace file has an ADC count per line, optionally followed by the true
+ * count, '#' starts a comment. Without a true count, a centered moving
+ * average of the trace stands in for it. Without trace files, synthetic
+ * traces of ADC noise and spikes on a steady, drifting and stepping
+ * input are used.
+ *
+ * Usage: filter_bench [-d read delta] [-i read interval ms] [-n ADC noise] [trace ...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "firmware_bench.h"
+
+#define MAX_READINGS (100000)
+#define SYNTHETIC_READINGS (4000)
+#define REFERENCE_HALF_WIDTH (8)	//readings either side of the moving average standing in for truth
+#define NOISE_COUNTS (12)	//uniform noise either side, in ADC counts, three summed
+#define SPIKE_PERCENT (2)
+#define SPIKE_COUNTS (100)
+#define SEED (12345u)
+
+typedef struct
+{
+	char name[64];
+	unsigned int count;
+	unsigned int *raw;
+	float *truth;	//degree centigrade
+}Trace;
+
+typedef struct
+{
+	unsigned int medianSize;
+	float alpha;
+}FilterConfig;
+
+static const unsigned int _backOffs[] = { 1, 2, 4, 8, 16 };
+static const unsigned int _oversampling[] = { 1, 4, 16, 64, 256 };
+
+static const FilterConfig _configs[] =
+{
+	{ 1, 1.0f }, { 1, 0.5f }, { 1, 0.25f },
+	{ 3, 1.0f }, { 3, 0.5f }, { 3, 0.25f },
+	{ 5, 1.0f }, { 5, 0.5f }, { 5, 0.25f },
+	{ 7, 1.0f }, { 7, 0.5f }, { 7, 0.25f },
+};
+
+static bool NewTrace(Trace *trace, const char *name, unsigned int count)
+{
+	snprintf(trace->name, sizeof(trace->name), "%s", name);
+	trace->count = count;
+	trace->raw = malloc(count * sizeof(unsigned int));
+	trace->truth = malloc(count * sizeof(float));
+	return trace->raw && trace->truth;
+}
+
+static void FreeTrace(Trace *trace)
+{
+	free(trace->raw);
+	free(trace->truth);
+}
+
+static unsigned int ClampCount(int count)
+{
+	return (count < 0) ? 0 : ((count > 4095) ? 4095 : (unsigned int)count);
+}
+
+/**
+ * Input of 0: steady, 1: drifting, 2: stepping, in ADC counts
+ */
+static int SyntheticInput(unsigned int shape, unsigned int i)
+{
+	switch (shape)
+	{
+		case 0: return 2000;
+		case 1: return 1800 + (int)(400 * i / SYNTHETIC_READINGS);
+		default: return (i < SYNTHETIC_READINGS / 2) ? 1800 : 2200;
+	}
+}
+
+static bool SyntheticTrace(Trace *trace, unsigned int shape)
+{
+	static const char *names[] = { "steady", "drift", "step" };
+	unsigned int seed = SEED + shape;
+	unsigned int i, j;
+
+	if (!NewTrace(trace, names[shape], SYNTHETIC_READINGS))
+	{
+		return false;
+	}
+	for (i = 0; i < trace->count; ++i)
+	{
+		int input = SyntheticInput(shape, i);
+		int noise = 0;
+
+		for (j = 0; j < 3; ++j)
+		{
+			noise += (int)(rand_r(&seed) % (2 * NOISE_COUNTS + 1)) - NOISE_COUNTS;
+		}
+		if ((unsigned int)(rand_r(&seed) % 100) < SPIKE_PERCENT)
+		{
+			noise += (rand_r(&seed) % 2) ? SPIKE_COUNTS : -SPIKE_COUNTS;
+		}
+		trace->raw[i] = ClampCount(input + noise);
+		trace->truth[i] = FirmwareBench_AdcTemperature(ClampCount(input));
+	}
+	return true;
+}
+
+static bool ReadTrace(Trace *trace, const char *path)
+{
+	FILE *file;
+	char line[128];
+	bool hasTruth = true;
+	unsigned int i, j;
+
+	memset(trace, 0, sizeof(*trace));
+	file = fopen(path, "r");
+	if (!file)
+	{
+		perror(path);
+		return false;
+	}
+	if (!NewTrace(trace, path, MAX_READINGS))
+	{
+		fclose(file);
+		return false;
+	}
+	trace->count = 0;
+	while (fgets(line, sizeof(line), file) && (trace->count < MAX_READINGS))
+	{
+		unsigned int raw, truth;
+		int fields;
+
+		line[strcspn(line, "#")] = '\0';
+		fields = sscanf(line, "%u %u", &raw, &truth);
+		if (fields < 1)
+		{
+			continue;
+		}
+		trace->raw[trace->count] = ClampCount((int)raw);
+		if (fields == 2)
+		{
+			trace->truth[trace->count] = FirmwareBench_AdcTemperature(ClampCount((int)truth));
+		}
+		else
+		{
+			hasTruth = false;
+		}
+		trace->count++;
+	}
+	fclose(file);
+
+	if (!hasTruth)
+	{
+		for (i = 0; i < trace->count; ++i)
+		{
+			unsigned int from = (i > REFERENCE_HALF_WIDTH) ? i - REFERENCE_HALF_WIDTH : 0;
+			unsigned int to = (i + REFERENCE_HALF_WIDTH < trace->count) ? i + REFERENCE_HALF_WIDTH : trace->count - 1;
+			double sum = 0.0;
+
+			for (j = from; j <= to; ++j)
+			{
+				sum += FirmwareBench_AdcTemperature(trace->raw[j]);
+			}
+			trace->truth[i] = (float)(sum / (to - from + 1));
+		}
+	}
+	return trace->count > 0;
+}
+
+static void RunTrace(const Trace *trace, float readDelta, unsigned int readInterval)
+{
+	double hours = trace->count * (readInterval / 1000.0) / 3600.0;
+	unsigned int c, i;
+
+	printf("%s: %u readings, %.2f hours\n", trace->name, trace->count, hours);
+	printf("  %6s %6s %9s %10s %9s %9s\n", "median", "alpha", "messages", "msgs/hour", "rms err", "max err");
+	for (c = 0; c < sizeof(_configs) / sizeof(_configs[0]); ++c)
+	{
+		unsigned int messages = 0;
+		double sumSquareError = 0.0;
+		float maxError = 0.0f;
+		float reported;
+
+		if (!FirmwareBench_SensorSetFilter(_configs[c].medianSize, _configs[c].alpha, readDelta))
+		{
+			continue;
+		}
+		for (i = 0; i < trace->count; ++i)
+		{
+			float error;
+
+			if (FirmwareBench_SensorReadTemperature(trace->raw[i], &reported))
+			{
+				messages++;
+			}
+			error = fabsf(reported - trace->truth[i]);
+			sumSquareError += error * error;
+			if (error > maxError)
+			{
+				maxError = error;
+			}
+		}
+		printf("  %6u %6.2f %9u %10.1f %9.3f %9.3f\n", _configs[c].medianSize, _configs[c].alpha,
+				messages, messages / hours, sqrt(sumSquareError / trace->count), maxError);
+	}
+}
+
+static void RunSchedules(const Trace *trace, float readDelta, unsigned int readInterval)
+{
+	unsigned int duration = trace->count * readInterval;
+	double hours = duration / 3600000.0;
+	unsigned int b;
+
+	printf("  %8s %10s %10s %10s %12s %12s\n", "back off", "wakeups/h", "reads/h", "msgs/h", "latency (s)", "max lat (s)");
+	for (b = 0; b < sizeof(_backOffs) / sizeof(_backOffs[0]); ++b)
+	{
+		unsigned int now = 0;
+		unsigned int checked = 0;	//Trace readings checked for a departure from reported value
+		unsigned int wakeups = 0;
+		unsigned int messages = 0;
+		unsigned int detections = 0;
+		unsigned int departure = 0;
+		bool isDeparted = false;
+		double sumLatency = 0.0;
+		unsigned int maxLatency = 0;
+		unsigned long reads = 0;
+		float reported = 0.0f;
+
+		FirmwareBench_SensorStartSchedule(_backOffs[b], readDelta);
+		while (true)
+		{
+			float previous = reported;
+			bool isSent;
+
+			now += FirmwareBench_SensorTimeToWakeup(now);
+			if (now >= duration)
+			{
+				break;
+			}
+			for (; (checked < trace->count) && (checked * readInterval <= now); ++checked)
+			{
+				if (!isDeparted && (previous != 0.0f) && (fabsf(trace->truth[checked] - previous) > readDelta))
+				{
+					isDeparted = true;
+					departure = checked * readInterval;
+				}
+			}
+			isSent = FirmwareBench_SensorWakeup(trace->raw[now / readInterval], now, &reported, &reads);
+			wakeups++;
+			messages += isSent ? 1 : 0;
+			if (isSent && (reported != previous) && isDeparted)
+			{
+				unsigned int latency = now - departure;
+
+				sumLatency += latency;
+				maxLatency = (latency > maxLatency) ? latency : maxLatency;
+				detections++;
+				isDeparted = false;
+			}
+		}
+		printf("  %8u %10.0f %10.0f %10.1f %12.2f %12.2f\n", _backOffs[b], wakeups / hours, reads / hours,
+				messages / hours, detections ? sumLatency / detections / 1000.0 : 0.0, maxLatency / 1000.0);
+	}
+}
+
+static void RunOversampling(unsigned int noise)
+{
+	float countToC = FirmwareBench_AdcTemperature(1) - FirmwareBench_AdcTemperature(0);
+	unsigned int i;
+
+	printf("ADC noise %u counts\n", noise);
+	printf("  %12s %10s %10s\n", "oversampling", "rms err", "rms err C");
+	for (i = 0; i < sizeof(_oversampling) / sizeof(_oversampling[0]); ++i)
+	{
+		double error = FirmwareBench_AdcScanError(_oversampling[i], noise, 4000);
+
+		printf("  %12u %10.2f %10.3f\n", _oversampling[i], error, error * countToC);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	float readDelta = 0.5f;
+	unsigned int readInterval = 500;
+	unsigned int noise = 20;
+	Trace trace;
+	unsigned int i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:i:n:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'd': readDelta = atof(optarg); break;
+			case 'i': readInterval = strtoul(optarg, NULL, 10); break;
+			case 'n': noise = strtoul(optarg, NULL, 10); break;
+			default:
+				fprintf(stderr, "Usage: %s [-d read delta] [-i read interval ms] [-n ADC noise] [trace ...]\n", argv[0]);
+				return 1;
+		}
+	}
+	if ((readDelta <= 0.0f) || (readInterval == 0))
+	{
+		fprintf(stderr, "Read delta and interval must be positive\n");
+		return 1;
+	}
+
+	RunOversampling(noise);
+	printf("read delta %.2f, read interval %u ms\n", readDelta, readInterval);
+	if (optind == argc)
+	{
+		for (i = 0; i < 3; ++i)
+		{
+			if (SyntheticTrace(&trace, i))
+			{
+				RunTrace(&trace, readDelta, readInterval);
+				RunSchedules(&trace, readDelta, readInterval);
+			}
+			FreeTrace(&trace);
+		}
+		return 0;
+	}
+	for (; optind < argc; ++optind)
+	{
+		if (!ReadTrace(&trace, argv[optind]))
+		{
+			FreeTrace(&trace);
+			return 1;
+		}
+		RunTrace(&trace, readDelta, readInterval);
+		RunSchedules(&trace, readDelta, readInterval);
+		FreeTrace(&trace);
+	}
+	return 0;
+}
@@ -0,0 +1,91 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/**
+ * WiFire actuator's climate_actuator.c, built for host so that its
+ * heartbeat construction and command lookup can be benchmarked. Static
+ * functions are reached by including the source.
+ */
+
+#include "climate_actuator.c"
+
+#include "firmware_bench.h"
+
+static ClimateActuator _actuator =
+{
+	.relays =
+	{
+		{ .xmlTagString = RELAY_1_XML_TAG, .field = ClimateProto_ActuatorInfo_relay1 },
+		{ .xmlTagString = RELAY_2_XML_TAG, .field = ClimateProto_ActuatorInfo_relay2 },
+	}
+};
+
+char *FirmwareBench_ActuatorHeartBeatMsg(bool relay1On, bool relay2On)
+{
+	_actuator.relays[Relay_1].state = relay1On ? Relay_On : Relay_Off;
+	_actuator.relays[Relay_2].state = relay2On ? Relay_On : Relay_Off;
+	return CreateHeartBeatMsg(&_actuator);
+}
+
+char *FirmwareBench_FormatActuatorHeartBeatMsg(bool relay1On, bool relay2On)
+{
+	_actuator.relays[Relay_1].state = relay1On ? Relay_On : Relay_Off;
+	_actuator.relays[Relay_2].state = relay2On ? Relay_On : Relay_Off;
+	return FormatHeartBeatMsg(&_actuator);
+}
+
+int FirmwareBench_FindCommand(const char *cmd)
+{
+	return FindCommand(cmd);
+}
+
+bool FirmwareBench_ActuatorParseCommand(const char *msg, char *cmd, size_t size, unsigned int *heartBeat, bool *isCompact)
+{
+	ControllerCmd *command = ParseMsgAndCreateControllerCmd(msg);
+	ClimateActuatorConfig *config;
+
+	if (!command)
+	{
+		return false;
+	}
+	snprintf(cmd, size, "%s", command->cmd);
+	config = command->payload;
+	if (config)
+	{
+		*heartBeat = config->heartBeat;
+		*isCompact = (config->wireFormat == WireFormat_Compact);
+	}
+	FreeControllerCmd(command);
+	return true;
+}
@@ -0,0 +1,118 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/**
+ * Firmware message paths of the WiFire sensor and actuator, compiled for
+ * host from the firmware sources, for micro_bench and test_climate_proto.
+ */
+
+#ifndef FIRMWARE_BENCH_H
+#define FIRMWARE_BENCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "climate_proto.h"
+
+//Sensor's event message, as built by its CreateMessageXML(). Free with Flow_MemFree().
+char *FirmwareBench_SensorMessageXML(float temperature, float humidity, time_t time);
+
+//Actuator's heartbeat message, as built by its CreateHeartBeatMsg(). Free with Flow_MemFree().
+char *FirmwareBench_ActuatorHeartBeatMsg(bool relay1On, bool relay2On);
+
+//As above, formatted rather than patched into the message template
+char *FirmwareBench_FormatSensorMessageXML(float temperature, float humidity, time_t time);
+char *FirmwareBench_FormatActuatorHeartBeatMsg(bool relay1On, bool relay2On);
+
+//Actuator's relay command lookup, index in its command table or -1
+int FirmwareBench_FindCommand(const char *cmd);
+
+//Sensor's event in delta mode, with a keyframe every keyframe events. Free with Flow_MemFree().
+char *FirmwareBench_SensorDeltaMessageXML(float temperature, float humidity, unsigned int keyframe, time_t time);
+
+//Samples the send thread kept while offline, a minute apart from from, as it uploads them.
+//At most SAMPLE_UPLOAD_BATCH. Free with Flow_MemFree().
+char *FirmwareBench_SensorLogXML(const float *temperatures, const float *humidities, unsigned int count,
+									time_t from, time_t time);
+
+//Temperature the sensor reads with its ADC at adcValue, unfiltered
+float FirmwareBench_AdcTemperature(unsigned int adcValue);
+
+//RMS error, in counts, of reads values of the sensor's ADC scan at oversampling, with a steady input
+//and noise counts of noise per conversion. The sensor's own scan is restarted after.
+double FirmwareBench_AdcScanError(unsigned int oversampling, unsigned int noise, unsigned int reads);
+
+//Filter and read delta of the sensor's temperature, for the reads after. False if the filter is invalid.
+bool FirmwareBench_SensorSetFilter(unsigned int medianSize, float alpha, float readDelta);
+
+//Sensor's temperature read with its ADC at adcValue, as on its read timer: true if the
+//filtered reading changed by more than the read delta, so a message is sent. reported
+//is set to the last value reported.
+bool FirmwareBench_SensorReadTemperature(unsigned int adcValue, float *reported);
+
+//Sensor thread's schedule from tick 0, reading each sensor at most backOff times less often
+//than its minimum interval while its readings are stable. Filters are reset to their default.
+void FirmwareBench_SensorStartSchedule(unsigned int backOff, float readDelta);
+
+//Milliseconds from now till the sensor thread next wakes up
+unsigned int FirmwareBench_SensorTimeToWakeup(unsigned int now);
+
+//Sensor thread's wakeup at now with its ADC at adcValue: true if a message is sent. reported is
+//set to the last temperature reported, reads to the sensor read transactions since the schedule started.
+bool FirmwareBench_SensorWakeup(unsigned int adcValue, unsigned int now, float *reported, unsigned long *reads);
+
+//Decode of a DHT reply of 45 %RH and 21 C as its capture records it, noisy with pulses off by
+//up to 8 microseconds and 10 glitches. False if it does not decode.
+bool FirmwareBench_DhtDecode(bool isNoisy, unsigned int *humidity, unsigned int *temperature);
+
+//Thermistor temperature at adcValue, from the datasheet formula with a log() as it was worked
+//out on every read, or from the thermistor's table as the sensor does now
+float FirmwareBench_ThermistorFormula(unsigned int adcValue);
+float FirmwareBench_ThermistorTable(unsigned int adcValue);
+
+//Settings of a controller command, as the sensor takes them. False if it rejects the command.
+bool FirmwareBench_SensorParseSettings(const char *msg, ClimateProto_SensorSettings *settings, bool *isCompact);
+
+//Same, applied to the sensor as it does on UPDATE_SETTINGS
+bool FirmwareBench_SensorApplySettings(const char *msg);
+
+//Reading corrected by a second order calibration, as the sensor does before filtering it
+float FirmwareBench_SensorCalibrate(float reading);
+
+//Controller command as the actuator takes it, heartBeat and isCompact set by settings only.
+//False if it rejects the command.
+bool FirmwareBench_ActuatorParseCommand(const char *msg, char *cmd, size_t size, unsigned int *heartBeat, bool *isCompact);
+
+#endif	/* FIRMWARE_BENCH_H */
@@ -0,0 +1,427 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/**
+ * Firmware fleet: the controller against N WiFire sensors and actuators
+ * running their real firmware, built for host by make firmware-host.
+ * Every device is a process of its own, with its own threads, timers and
+ * queues, linked to this one over a SOCK_SEQPACKET socket pair. The
+ * controller runs its real threads against the Flow stand-in as in
+ * fleet_load, and this process carries messages between it and the
+ * devices, by device id.
+ *
+ * Every other device is a sensor. As on a network, the controller serves
+ * the first sensor and actuator heard of and ignores the others.
+ *
+ * After the run it reports message rates both ways, messages dropped as
+ * the controller queue or a device link was full, devices that exited
+ * early and the CPU time of this process and of the devices.
+ *
+ * Usage: firmware_fleet [-N devices] [-t seconds] [-d firmware directory]
+ *                       [-w analog drift] [-q controller queue size]
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "flow/flowcore.h"
+#include "controller.h"
+#include "controller_stats.h"
+#include "flow_interface.h"
+#include "flow_stub.h"
+
+#define STACK_SIZE (4096)
+#define TASK_PRIORITY (1)
+#define USER_ID "user"
+#define SENSOR_BINARY "flowclimatesensor.host.bin"
+#define ACTUATOR_BINARY "flowclimateactuator.host.bin"
+#define LINK_MESSAGE_SIZE (4096)
+#define POLL_TIMEOUT (100)	//milliseconds
+#define FDS_PER_DEVICE (4)	//Link, and some headroom for the controller's own
+
+typedef struct
+{
+	unsigned int numDevices;
+	unsigned int seconds;
+	const char *directory;
+	unsigned int drift;
+	unsigned int queueSize;
+}Config;
+
+typedef struct
+{
+	volatile bool isRunning;
+	unsigned long received;	//Messages from devices
+	unsigned long oversized;	//Of those, too long for the link buffer
+}Router;
+
+static Controller _Controller;
+static pid_t *_pids;
+static struct pollfd *_links;	//Parent ends of device links, by device index
+static unsigned int _numDevices;
+static Router _router;
+static volatile unsigned long _sent;	//Messages from controller to devices
+static volatile unsigned long _linkDrops;	//Of those, not sent as device link was full
+
+static uint64_t NowUs(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static uint64_t CpuUs(int who)
+{
+	struct rusage usage;
+
+	getrusage(who, &usage);
+	return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 +
+			usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+static bool IsSensor(unsigned int index)
+{
+	return (index % 2) == 0;
+}
+
+static void DeviceId(unsigned int index, char *id, size_t size)
+{
+	snprintf(id, size, "%s-%06u", IsSensor(index) ? "sensor" : "actuator", index / 2);
+}
+
+/**
+ * Device index from a device id, or -1 if it is none of the fleet's
+ */
+static int DeviceIndex(const char *id)
+{
+	const char *number = strrchr(id, '-');
+	unsigned int index;
+
+	if (!number)
+	{
+		return -1;
+	}
+	index = 2 * strtoul(number + 1, NULL, 10) + ((strncmp(id, "sensor-", 7) == 0) ? 0 : 1);
+	return (index < _numDevices) ? (int)index : -1;
+}
+
+/**
+ * Controller's messages to devices go down their links, dropped rather
+ * than blocking the controller if a device is not keeping up
+ */
+static void SendToDevice(const FlowStubMessage *message)
+{
+	int index;
+
+	if (message->isToUser)
+	{
+		return;
+	}
+	index = DeviceIndex(message->to);
+	if (index < 0)
+	{
+		return;
+	}
+	__sync_fetch_and_add(&_sent, 1);
+	if (send(_links[index].fd, message->content, strlen(message->content), MSG_DONTWAIT | MSG_NOSIGNAL) < 0)
+	{
+		__sync_fetch_and_add(&_linkDrops, 1);
+	}
+}
+
+/**
+ * Devices' messages to the controller, delivered as from their device id
+ */
+static void *RouterThread(void *context)
+{
+	static char buffer[LINK_MESSAGE_SIZE];
+	Router *router = context;
+	char id[32];
+	unsigned int i;
+
+	while (router->isRunning)
+	{
+		if (poll(_links, _numDevices, POLL_TIMEOUT) <= 0)
+		{
+			continue;
+		}
+		for (i = 0; i < _numDevices; ++i)
+		{
+			ssize_t length;
+
+			if (!(_links[i].revents & POLLIN))
+			{
+				if (_links[i].revents & (POLLHUP | POLLERR))
+				{
+					_links[i].fd = -_links[i].fd - 1;	//Device is gone, stop polling it
+				}
+				continue;
+			}
+			length = recv(_links[i].fd, buffer, sizeof(buffer) - 1, MSG_DONTWAIT | MSG_TRUNC);
+			if (length <= 0)
+			{
+				continue;
+			}
+			router->received++;
+			if ((size_t)length >= sizeof(buffer))
+			{
+				router->oversized++;
+				continue;
+			}
+			buffer[length] = '\0';
+			DeviceId(i, id, sizeof(id));
+			FlowStub_DeliverMessage(NULL, id, buffer);
+		}
+	}
+	return NULL;
+}
+
+static bool StartController(const Config *config)
+{
+	Controller *me = &_Controller;
+	FILE *file = fopen("flow_controller.cnf", "w");
+
+	if (!file)
+	{
+		return false;
+	}
+	fprintf(file, "Server_Address=stub\nAuth_Key=stub\nSecret_Key=stub\nDevice_Type=stub\n"
+					"MAC_Addr=stub\nSerial_Num=stub\nDevice_Name=stub\nDevreg_Key=stub\n");
+	fclose(file);
+
+	FlowStub_SetOwner(USER_ID);
+	FlowStub_SetLogLevel(FlowLogLevel_Warning);
+	ControllerSetDefaults(me);
+	me->stateDir = ".";	//Scratch directory make runs this in
+	me->sendMsgQueue = FlowQueue_NewBlocking(config->queueSize);
+	me->receiveMsgQueue = FlowQueue_NewBlocking(config->queueSize);
+	if (!InitializeFlowInterface(me))
+	{
+		return false;
+	}
+
+	me->controllerThread = FlowThread_New("ControllerTask", TASK_PRIORITY, STACK_SIZE, ControllerThread, me);
+	me->flowInterfaceThread = FlowThread_New("FlowInterfaceTask", TASK_PRIORITY, STACK_SIZE, FlowInterfaceThread, me);
+	return me->controllerThread && me->flowInterfaceThread;
+}
+
+/**
+ * Start device process, linked over the parent end of a socket pair. Only
+ * async-signal-safe calls between fork and exec, as the controller's threads run.
+ */
+static bool StartDevice(const Config *config, unsigned int index)
+{
+	char path[PATH_MAX];
+	char link[16], drift[16], seed[16];
+	int ends[2];
+	pid_t pid;
+
+	snprintf(path, sizeof(path), "%s/%s", config->directory, IsSensor(index) ? SENSOR_BINARY : ACTUATOR_BINARY);
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, ends) < 0)
+	{
+		perror("socketpair");
+		return false;
+	}
+	snprintf(link, sizeof(link), "%d", ends[1]);
+	snprintf(drift, sizeof(drift), "%u", config->drift);
+	snprintf(seed, sizeof(seed), "%u", index + 1);
+
+	pid = fork();
+	if (pid == 0)
+	{
+		char *argv[] = { path, "-l", link, "-w", drift, "-s", seed, NULL };
+
+		fcntl(ends[1], F_SETFD, 0);
+		execv(path, argv);
+		_exit(127);
+	}
+	close(ends[1]);
+	if (pid < 0)
+	{
+		perror("fork");
+		close(ends[0]);
+		return false;
+	}
+	_pids[index] = pid;
+	_links[index].fd = ends[0];
+	_links[index].events = POLLIN;
+	return true;
+}
+
+static void RaiseFileLimit(unsigned int numDevices)
+{
+	struct rlimit limit;
+
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+	{
+		rlim_t needed = (rlim_t)numDevices * FDS_PER_DEVICE + 64;
+
+		if (limit.rlim_cur < needed)
+		{
+			limit.rlim_cur = (needed < limit.rlim_max) ? needed : limit.rlim_max;
+			setrlimit(RLIMIT_NOFILE, &limit);
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	Config config = { 100, 10, NULL, 8, 20 };
+	unsigned long received, dropped, sent, linkDrops;
+	uint64_t start, cpuStart;
+	double seconds, controllerCpu, devicesCpu;
+	unsigned int i, started, exited = 0;
+	pthread_t routerThread;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "N:t:d:w:q:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'N': config.numDevices = strtoul(optarg, NULL, 10); break;
+			case 't': config.seconds = strtoul(optarg, NULL, 10); break;
+			case 'd': config.directory = optarg; break;
+			case 'w': config.drift = strtoul(optarg, NULL, 10); break;
+			case 'q': config.queueSize = strtoul(optarg, NULL, 10); break;
+			default:
+				fprintf(stderr, "Usage: %s [-N devices] [-t seconds] [-d firmware directory]\n"
+								"\t[-w analog drift] [-q controller queue size]\n", argv[0]);
+				return 1;
+		}
+	}
+	if ((config.numDevices == 0) || (config.seconds == 0) || (config.queueSize == 0))
+	{
+		fprintf(stderr, "Devices, seconds and queue size must be positive\n");
+		return 1;
+	}
+	if (!config.directory)
+	{
+		config.directory = dirname(argv[0]);
+	}
+
+	_numDevices = config.numDevices;
+	_pids = calloc(_numDevices, sizeof(pid_t));
+	_links = calloc(_numDevices, sizeof(struct pollfd));
+	if (!_pids || !_links)
+	{
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	for (i = 0; i < _numDevices; ++i)
+	{
+		_links[i].fd = -1;
+	}
+	RaiseFileLimit(_numDevices);
+	FlowStub_SetSendListener(SendToDevice);
+
+	if (!StartController(&config))
+	{
+		fprintf(stderr, "Starting controller failed\n");
+		return 1;
+	}
+	for (started = 0; started < _numDevices; ++started)
+	{
+		if (!StartDevice(&config, started))
+		{
+			break;
+		}
+	}
+	if (started < _numDevices)
+	{
+		fprintf(stderr, "Started only %u of %u devices\n", started, _numDevices);
+		_numDevices = started;
+	}
+
+	start = NowUs();
+	cpuStart = CpuUs(RUSAGE_SELF);
+	received = controllerStats.receivedMessages;
+	dropped = controllerStats.droppedMessages;
+	_router.isRunning = true;
+	pthread_create(&routerThread, NULL, RouterThread, &_router);
+	sleep(config.seconds);
+	_router.isRunning = false;
+	pthread_join(routerThread, NULL);
+
+	seconds = (NowUs() - start) / 1e6;
+	controllerCpu = (double)(CpuUs(RUSAGE_SELF) - cpuStart) / (seconds * 1e6) * 100.0;
+	received = controllerStats.receivedMessages - received;
+	dropped = controllerStats.droppedMessages - dropped;
+	sent = _sent;
+	linkDrops = _linkDrops;
+
+	//Devices exit as their link closes
+	FlowStub_SetSendListener(NULL);
+	for (i = 0; i < _numDevices; ++i)
+	{
+		int status;
+
+		if ((waitpid(_pids[i], &status, WNOHANG) == _pids[i]) ||
+			(_links[i].fd < 0))
+		{
+			exited++;
+		}
+		close((_links[i].fd < 0) ? -_links[i].fd - 1 : _links[i].fd);
+	}
+	for (i = 0; i < _numDevices; ++i)
+	{
+		waitpid(_pids[i], NULL, 0);
+	}
+	devicesCpu = CpuUs(RUSAGE_CHILDREN) / 1e3 / (seconds * _numDevices);
+
+	printf("%u devices (%u sensors, %u actuators), %.1f s, controller queue %u\n",
+			_numDevices, (_numDevices + 1) / 2, _numDevices / 2, seconds, config.queueSize);
+	printf("from devices   %10.1f msg/s, %lu delivered to controller, %lu dropped (queue full), %lu oversized\n",
+			_router.received / seconds, received, dropped, _router.oversized);
+	printf("to devices     %10.1f msg/s, %lu dropped (link full)\n", sent / seconds, linkDrops);
+	printf("cpu            %9.1f%% controller and router, %.3f ms/s per device\n", controllerCpu, devicesCpu);
+	if (exited)
+	{
+		printf("%u devices exited early\n", exited);
+	}
+	return exited ? 1 : 0;
+}
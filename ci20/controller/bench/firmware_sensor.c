@@ -0,0 +1,311 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/**
+ * WiFire sensor's climate_sensor.c, built for host so that its message
+ * construction can be benchmarked next to the controller's. Static
+ * functions are reached by including the source.
+ */
+
+#include "climate_sensor.c"
+
+#include <math.h>
+
+#include "adc_scan.h"
+#include "dht_decoder.h"
+#include "firmware_bench.h"
+#include "sensor_thermistor.h"
+#include "wifire_sim.h"
+
+static ClimateSensor _sensor =
+{
+	.heartBeat = DEFAULT_HEART_BEAT_PERIOD,
+	.sensors =
+	{
+		{
+			.type = Sensor_Temperature,
+			.readInterval = MINIMUM_TEMPERATURE_SENSOR_READ_PERIOD,
+			.minimumReadInterval = MINIMUM_TEMPERATURE_SENSOR_READ_PERIOD,
+			.maximumReadInterval = MAXIMUM_TEMPERATURE_SENSOR_READ_PERIOD,
+			.readDelta = DEFAULT_TEMPERATURE_READING_DELTA,
+			.valueField = ClimateProto_SensorInfo_temperature,
+			.readIntervalField = ClimateProto_SensorSettings_temperatureReadInterval,
+			.maximumReadIntervalField = ClimateProto_SensorSettings_temperatureMaxReadInterval,
+			.readDeltaField = ClimateProto_SensorSettings_temperatureReadDelta,
+			.medianSizeField = ClimateProto_SensorSettings_temperatureMedianSize,
+			.filterAlphaField = ClimateProto_SensorSettings_temperatureFilterAlpha,
+			.offsetField = ClimateProto_SensorSettings_temperatureOffset,
+			.gainField = ClimateProto_SensorSettings_temperatureGain,
+			.curveField = ClimateProto_SensorSettings_temperatureCurve,
+			.xmlTagString = TEMPERATURE_XML_TAG,
+			.calibration = SENSOR_CALIBRATION_NONE,
+			.filter = { .medianSize = DEFAULT_MEDIAN_SIZE, .alpha = DEFAULT_FILTER_ALPHA },
+		},
+		{
+			.type = Sensor_Humidity,
+			.readInterval = MINIMUM_HUMIDITY_SENSOR_READ_PERIOD,
+			.minimumReadInterval = MINIMUM_HUMIDITY_SENSOR_READ_PERIOD,
+			.maximumReadInterval = MAXIMUM_HUMIDITY_SENSOR_READ_PERIOD,
+			.readDelta = DEFAULT_HUMIDITY_READING_DELTA,
+			.valueField = ClimateProto_SensorInfo_humidity,
+			.readIntervalField = ClimateProto_SensorSettings_humidityReadInterval,
+			.maximumReadIntervalField = ClimateProto_SensorSettings_humidityMaxReadInterval,
+			.readDeltaField = ClimateProto_SensorSettings_humidityReadDelta,
+			.medianSizeField = ClimateProto_SensorSettings_humidityMedianSize,
+			.filterAlphaField = ClimateProto_SensorSettings_humidityFilterAlpha,
+			.offsetField = ClimateProto_SensorSettings_humidityOffset,
+			.gainField = ClimateProto_SensorSettings_humidityGain,
+			.curveField = ClimateProto_SensorSettings_humidityCurve,
+			.xmlTagString = HUMIDITY_XML_TAG,
+			.calibration = SENSOR_CALIBRATION_NONE,
+			.filter = { .medianSize = DEFAULT_MEDIAN_SIZE, .alpha = DEFAULT_FILTER_ALPHA },
+		},
+	}
+};
+
+char *FirmwareBench_SensorMessageXML(float temperature, float humidity, time_t time)
+{
+	_sensor.sensors[Sensor_Temperature].value = temperature;
+	_sensor.sensors[Sensor_Humidity].value = humidity;
+	return CreateMessageXML(&_sensor, time);
+}
+
+char *FirmwareBench_FormatSensorMessageXML(float temperature, float humidity, time_t time)
+{
+	_sensor.sensors[Sensor_Temperature].value = temperature;
+	_sensor.sensors[Sensor_Humidity].value = humidity;
+	return FormatMessageXML(&_sensor, time);
+}
+
+char *FirmwareBench_SensorDeltaMessageXML(float temperature, float humidity, unsigned int keyframe, time_t time)
+{
+	char *message;
+
+	_sensor.heartBeatKeyframe = keyframe;
+	message = FirmwareBench_SensorMessageXML(temperature, humidity, time);
+	_sensor.heartBeatKeyframe = 0;
+	return message;
+}
+
+char *FirmwareBench_SensorLogXML(const float *temperatures, const float *humidities, unsigned int count,
+									time_t from, time_t time)
+{
+	StoredSample samples[SAMPLE_UPLOAD_BATCH];
+	unsigned int i;
+
+	if (count > SAMPLE_UPLOAD_BATCH)
+	{
+		return NULL;
+	}
+	for (i = 0; i < count; ++i)
+	{
+		SampleBuffer_MakeSample(&samples[i], from + i * 60, temperatures[i], humidities[i]);
+	}
+	return SampleBuffer_CreateLogXML(samples, count, time);
+}
+
+/*
+ * Steady analog input at adcValue, the sensor's ADC scan started on first use
+ */
+static void SetAdcInput(unsigned int adcValue)
+{
+	static bool isStarted;
+
+	WifireSim_SetAnalogInput(adcValue, 0, 1);
+	if (!isStarted)
+	{
+		Sensor_Init();
+		isStarted = true;
+	}
+}
+
+float FirmwareBench_AdcTemperature(unsigned int adcValue)
+{
+	int32_t temperature = 0;
+
+	SetAdcInput(adcValue);
+	Sensor_ReadTemperature(&temperature);
+	return temperature * (1.0f / (1 << SENSOR_CALIBRATION_READING_BITS));
+}
+
+double FirmwareBench_AdcScanError(unsigned int oversampling, unsigned int noise, unsigned int reads)
+{
+	const unsigned int input = WIFIRE_SIM_ADC_MAX / 2;
+	double sum = 0.0;
+	unsigned int value;
+	unsigned int i;
+
+	WifireSim_SetAnalogInput(input, 0, 1);
+	WifireSim_SetAnalogNoise(noise);
+	AdcScan_Init();
+	AdcScan_AddChannel(0, oversampling);
+	AdcScan_Start();
+	for (i = 0; (i < reads) && AdcScan_Latest(0, &value); ++i)
+	{
+		sum += ((double)value - input) * ((double)value - input);
+	}
+	WifireSim_SetAnalogNoise(0);
+	Sensor_Init();
+	return (i > 0) ? sqrt(sum / i) : 0.0;
+}
+
+bool FirmwareBench_SensorSetFilter(unsigned int medianSize, float alpha, float readDelta)
+{
+	Sensor *sensor = &_sensor.sensors[Sensor_Temperature];
+
+	sensor->readDelta = readDelta;
+	sensor->value = FLT_MAX;
+	return SensorFilter_Configure(&sensor->filter, medianSize, (uint32_t)lrintf(alpha * SENSOR_FILTER_ALPHA_ONE));
+}
+
+bool FirmwareBench_SensorReadTemperature(unsigned int adcValue, float *reported)
+{
+	Sensor *sensor = &_sensor.sensors[Sensor_Temperature];
+	SensorReadings readings;
+	float value;
+	bool isChanged;
+
+	SetAdcInput(adcValue);
+	isChanged = Sensor_ReadAll(&readings) && ApplyReading(&_sensor, Sensor_Temperature, readings.temperature, &value);
+	*reported = sensor->value;
+	return isChanged;
+}
+
+void FirmwareBench_SensorStartSchedule(unsigned int backOff, float readDelta)
+{
+	unsigned int i;
+
+	for (i = 0; i < NUM_SENSORS; ++i)
+	{
+		Sensor *sensor = &_sensor.sensors[i];
+
+		sensor->readInterval = sensor->minimumReadInterval;
+		sensor->maximumReadInterval = backOff * sensor->readInterval;
+		sensor->value = FLT_MAX;
+		SensorFilter_Configure(&sensor->filter, DEFAULT_MEDIAN_SIZE, DEFAULT_FILTER_ALPHA);
+	}
+	_sensor.sensors[Sensor_Temperature].readDelta = readDelta;
+	_sensor.reads = 0;
+	StartSchedule(&_sensor, 0);
+}
+
+unsigned int FirmwareBench_SensorTimeToWakeup(unsigned int now)
+{
+	return TimeToWakeup(&_sensor, now);
+}
+
+bool FirmwareBench_SensorWakeup(unsigned int adcValue, unsigned int now, float *reported, unsigned long *reads)
+{
+	bool isSend;
+
+	SetAdcInput(adcValue);
+	isSend = RunSchedule(&_sensor, now);
+	*reported = _sensor.sensors[Sensor_Temperature].value;
+	*reads = _sensor.reads;
+	return isSend;
+}
+
+bool FirmwareBench_DhtDecode(bool isNoisy, unsigned int *humidity, unsigned int *temperature)
+{
+	static uint32_t edges[2][DHT_DECODER_MAX_EDGES];
+	static unsigned int counts[2];
+	uint8_t bytes[DHT_DECODER_NUM_BYTES] = { 45, 0, 21, 0, 66 };
+
+	if (counts[isNoisy] == 0)
+	{
+		unsigned int seed = 1;
+
+		counts[isNoisy] = WifireSim_MakeDhtWaveform(bytes, isNoisy ? 8 : 0, isNoisy ? 10 : 0, &seed,
+													edges[isNoisy], DHT_DECODER_MAX_EDGES);
+	}
+	if (!DhtDecoder_Decode(edges[isNoisy], counts[isNoisy], bytes))
+	{
+		return false;
+	}
+	*humidity = bytes[0];
+	*temperature = bytes[2];
+	return true;
+}
+
+float FirmwareBench_ThermistorFormula(unsigned int adcValue)
+{
+	float resistance = (float)((4096 - adcValue) * 100000) / (adcValue);
+
+	return 1 / (log(resistance / 100000) / 4200 + 1 / 298.15) - 273.15;
+}
+
+float FirmwareBench_ThermistorTable(unsigned int adcValue)
+{
+	int32_t temperature = 0;
+
+	Sensor_Thermistor_Convert(adcValue, &temperature);
+	return temperature * (1.0f / (1 << SENSOR_CALIBRATION_READING_BITS));
+}
+
+bool FirmwareBench_SensorParseSettings(const char *msg, ClimateProto_SensorSettings *settings, bool *isCompact)
+{
+	ControllerCmd *command = ParseMsgAndCreateControllerCmd(msg);
+	ClimateSensorSettings *update;
+
+	if (!command)
+	{
+		return false;
+	}
+	update = command->payload;
+	*settings = update->settings;
+	*isCompact = (update->wireFormat == WireFormat_Compact);
+	FreeControllerCmd(command);
+	return true;
+}
+
+bool FirmwareBench_SensorApplySettings(const char *msg)
+{
+	ControllerCmd *command = ParseMsgAndCreateControllerCmd(msg);
+
+	if (!command)
+	{
+		return false;
+	}
+	UpdateSettings(&_sensor, command->payload);
+	FreeControllerCmd(command);
+	return true;
+}
+
+float FirmwareBench_SensorCalibrate(float reading)
+{
+	//Offset -0.5, gain 1.01, curve 0.0002
+	static const SensorCalibration calibration = { .offset = -128, .gain = 66191, .curve = 3355 };
+
+	return SensorCalibration_ApplyFloat(&calibration, reading);
+}
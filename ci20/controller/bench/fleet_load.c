@@ -0,0 +1,602 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/**
+ * Fleet load generator: emulates N sensors and actuators speaking the
+ * same XML events as wifire/sensor (<type>Sensor</type>) and
+ * wifire/actuator (<type>Actuator</type>), injected through the Flow
+ * messaging stand-in into a controller running its real threads
+ * (flow interface and controller thread, queues as in main.c).
+ *
+ * Device count ramps up by a factor of 10 per step. For every step it
+ * reports offered and delivered event rates, messages dropped as the
+ * controller queue was full, controller queue depth, CPU used by
+ * controller threads and end-to-end latency: user PING commands carry
+ * their send time in app_time, which the controller echoes back.
+ *
+ * Controller serves one sensor and one actuator, the first ones heard
+ * of; events from all others are parsed and ignored, as on a device.
+ *
+ * Usage: fleet_load [-N max devices] [-t seconds per step] [-h heartbeat ms]
+ *                   [-c changes per device per minute] [-p none|gaussian|spiky]
+ *                   [-q controller queue size]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+#include "flow/flowcore.h"
+#include "controller.h"
+#include "controller_stats.h"
+#include "flow_interface.h"
+#include "flow_stub.h"
+
+#define STACK_SIZE (4096)
+#define TASK_PRIORITY (1)
+#define USER_ID "user"
+#define PROBE_INTERVAL (20000)	//microseconds
+#define SAMPLE_INTERVAL (250)	//microseconds between queue depth samples and response polls
+#define LATE_THRESHOLD (100000)	//microseconds, events sent later than this are late
+#define MAX_PROBES (65536)
+#define EVENT_SIZE (512)
+#define BASE_TEMPERATURE (21.0)
+#define BASE_HUMIDITY (45.0)
+
+typedef enum
+{
+	Noise_None,
+	Noise_Gaussian,	//Sensor noise, 0.1 degree/0.5 percent standard deviation
+	Noise_Spiky,	//Gaussian, plus 1% of readings off by up to 10 degrees/percent
+}Noise_Type;
+
+typedef struct
+{
+	uint64_t nextHeartbeat;	//microseconds
+	uint64_t nextChange;
+	float temperature;
+	float humidity;
+	bool relays[2];
+}Device;
+
+typedef struct
+{
+	unsigned int maxDevices;
+	unsigned int stepSeconds;
+	unsigned int heartbeat;	//milliseconds
+	double changeRate;	//changes per device per minute
+	Noise_Type noise;
+	unsigned int queueSize;
+}Config;
+
+typedef struct
+{
+	volatile bool isRunning;
+	uint64_t depthSum;
+	unsigned long depthSamples;
+	unsigned int depthMax;
+	double latencies[MAX_PROBES];	//milliseconds
+	unsigned long numLatencies;
+	unsigned long probesSent;
+	uint64_t cpuUs;	//Monitor's own CPU time
+}Monitor;
+
+static Controller _Controller;
+static Device *_devices;
+static unsigned int *_heap;	//Device indices, ordered by next due time
+static unsigned int _heapSize;
+static Monitor _monitor;
+static uint32_t _seed = 12345u;
+
+static uint64_t NowUs(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static uint64_t ThreadCpuUs(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static uint64_t ProcessCpuUs(void)
+{
+	struct rusage usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+	return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 +
+			usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+static void SleepUs(uint64_t microseconds)
+{
+	struct timespec delay;
+
+	delay.tv_sec = microseconds / 1000000;
+	delay.tv_nsec = (long)(microseconds % 1000000) * 1000;
+	nanosleep(&delay, NULL);
+}
+
+static double Uniform(void)
+{
+	_seed ^= _seed << 13;
+	_seed ^= _seed >> 17;
+	_seed ^= _seed << 5;
+	return (_seed + 0.5) / 4294967296.0;
+}
+
+static double Gaussian(void)
+{
+	return sqrt(-2.0 * log(Uniform())) * cos(2.0 * M_PI * Uniform());
+}
+
+static double Exponential(double mean)
+{
+	return -log(Uniform()) * mean;
+}
+
+static float Noise(Noise_Type noise, double deviation, double spike)
+{
+	double value = 0.0;
+
+	if (noise != Noise_None)
+	{
+		value = Gaussian() * deviation;
+	}
+	if ((noise == Noise_Spiky) && (Uniform() < 0.01))
+	{
+		value += (Uniform() * 2.0 - 1.0) * spike;
+	}
+	return (float)value;
+}
+
+static bool IsSensor(unsigned int index)
+{
+	return (index & 1) == 0;
+}
+
+static uint64_t NextChange(const Config *config, uint64_t now)
+{
+	if (config->changeRate <= 0.0)
+	{
+		return UINT64_MAX;
+	}
+	return now + (uint64_t)Exponential(60e6 / config->changeRate);
+}
+
+static uint64_t DueTime(unsigned int index)
+{
+	const Device *device = &_devices[index];
+
+	return (device->nextHeartbeat < device->nextChange) ? device->nextHeartbeat : device->nextChange;
+}
+
+static void SiftDown(unsigned int position)
+{
+	for (;;)
+	{
+		unsigned int smallest = position;
+		unsigned int left = 2 * position + 1, right = left + 1;
+		unsigned int swap;
+
+		if ((left < _heapSize) && (DueTime(_heap[left]) < DueTime(_heap[smallest])))
+		{
+			smallest = left;
+		}
+		if ((right < _heapSize) && (DueTime(_heap[right]) < DueTime(_heap[smallest])))
+		{
+			smallest = right;
+		}
+		if (smallest == position)
+		{
+			return;
+		}
+		swap = _heap[position];
+		_heap[position] = _heap[smallest];
+		_heap[smallest] = swap;
+		position = smallest;
+	}
+}
+
+/**
+ * Spread first heartbeats of devices evenly over one heartbeat period
+ */
+static void StartDevices(const Config *config, unsigned int count, uint64_t now)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; ++i)
+	{
+		Device *device = &_devices[i];
+
+		device->nextHeartbeat = now + (uint64_t)(Uniform() * config->heartbeat * 1000.0);
+		device->nextChange = NextChange(config, now);
+		_heap[i] = i;
+	}
+	_heapSize = count;
+	for (i = count / 2; i-- > 0; )
+	{
+		SiftDown(i);
+	}
+}
+
+/**
+ * Event as sent by wifire sensor and actuator
+ */
+static void ConstructEvent(const Config *config, const Device *device, unsigned int index, char *event)
+{
+	time_t now = time(NULL);
+	struct tm timeNow;
+	char info[128];
+
+	gmtime_r(&now, &timeNow);
+	if (IsSensor(index))
+	{
+		snprintf(info, sizeof(info), "<Temperature>%0.2f</Temperature><Humidity>%0.2f</Humidity>",
+				device->temperature + Noise(config->noise, 0.1, 10.0),
+				device->humidity + Noise(config->noise, 0.5, 10.0));
+	}
+	else
+	{
+		snprintf(info, sizeof(info), "<Relay_1>%s</Relay_1><Relay_2>%s</Relay_2>",
+				device->relays[0] ? "ON" : "OFF", device->relays[1] ? "ON" : "OFF");
+	}
+	snprintf(event, EVENT_SIZE, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+				"<event>"
+					"<time type=\"datetime\">%04d-%02d-%02dT%02d:%02d:%02dZ</time>"
+					"<type>%s</type>"
+					"<info>%s</info>"
+				"</event>",
+				timeNow.tm_year + 1900, timeNow.tm_mon + 1, timeNow.tm_mday,
+				timeNow.tm_hour, timeNow.tm_min, timeNow.tm_sec,
+				IsSensor(index) ? "Sensor" : "Actuator", info);
+}
+
+static void DeviceId(unsigned int index, char *id, size_t size)
+{
+	snprintf(id, size, "%s-%06u", IsSensor(index) ? "sensor" : "actuator", index / 2);
+}
+
+/**
+ * Take user's PING responses from cloud, dropping all other messages
+ */
+static void CollectResponses(Monitor *monitor)
+{
+	FlowStubMessage message;
+
+	while (FlowStub_PopSentMessage(&message))
+	{
+		char *appTime = strstr(message.content, "<app_time>");
+
+		if (message.isToUser && appTime && (monitor->numLatencies < MAX_PROBES))
+		{
+			uint64_t sent = strtoull(appTime + strlen("<app_time>"), NULL, 10);
+
+			monitor->latencies[monitor->numLatencies++] = (NowUs() - sent) / 1000.0;
+		}
+		free(message.content);
+	}
+}
+
+/**
+ * Sample controller queue depth, send PING probes and collect responses
+ */
+static void *MonitorThread(void *context)
+{
+	Monitor *monitor = context;
+	uint64_t start = ThreadCpuUs();
+	uint64_t nextProbe = NowUs();
+
+	while (monitor->isRunning)
+	{
+		unsigned int depth = FlowStub_QueueLength(_Controller.receiveMsgQueue);
+		uint64_t now = NowUs();
+
+		monitor->depthSum += depth;
+		monitor->depthSamples++;
+		if (depth > monitor->depthMax)
+		{
+			monitor->depthMax = depth;
+		}
+
+		if (now >= nextProbe)
+		{
+			char command[128];
+
+			snprintf(command, sizeof(command), "<command><info>PING</info><app_time>%llu</app_time></command>",
+					(unsigned long long)now);
+			FlowStub_DeliverMessage(USER_ID, NULL, command);
+			monitor->probesSent++;
+			nextProbe = now + PROBE_INTERVAL;
+		}
+		CollectResponses(monitor);
+		SleepUs(SAMPLE_INTERVAL);
+	}
+	CollectResponses(monitor);
+	monitor->cpuUs = ThreadCpuUs() - start;
+	return NULL;
+}
+
+static int CompareDouble(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+static double Percentile(const double *sorted, unsigned long count, double percentile)
+{
+	if (count == 0)
+	{
+		return 0.0;
+	}
+	return sorted[(unsigned long)(percentile / 100.0 * (count - 1) + 0.5)];
+}
+
+/**
+ * Run fleet of count devices for one step and report
+ */
+static bool RunStep(const Config *config, unsigned int count)
+{
+	uint64_t start, end, now, cpuStart, cpuEnd, generatorStart, generatorCpu;
+	unsigned long received = controllerStats.receivedMessages;
+	unsigned long dropped = controllerStats.droppedMessages;
+	unsigned long sent = 0, late = 0, lostProbes;
+	double offered, seconds, controllerCpu, dropRate;
+	char event[EVENT_SIZE];
+	char id[32];
+	pthread_t monitorThread;
+
+	memset(&_monitor, 0, sizeof(_monitor));
+	_monitor.isRunning = true;
+
+	start = NowUs();
+	StartDevices(config, count, start);
+	end = start + (uint64_t)config->stepSeconds * 1000000;
+	cpuStart = ProcessCpuUs();
+	generatorStart = ThreadCpuUs();
+	pthread_create(&monitorThread, NULL, MonitorThread, &_monitor);
+
+	while ((now = NowUs()) < end)
+	{
+		unsigned int index = _heap[0];
+		Device *device = &_devices[index];
+		uint64_t due = DueTime(index);
+
+		if (due > now)
+		{
+			SleepUs(((due - now) < 1000) ? (due - now) : 1000);
+			continue;
+		}
+		if (now - due > LATE_THRESHOLD)
+		{
+			late++;
+		}
+
+		if (device->nextChange <= device->nextHeartbeat)
+		{
+			//Measurement or relay changed, device reports at once
+			if (IsSensor(index))
+			{
+				device->temperature += (float)((Uniform() < 0.5) ? -0.5 : 0.5);
+				device->humidity += (float)((Uniform() < 0.5) ? -2.0 : 2.0);
+			}
+			else
+			{
+				device->relays[Uniform() < 0.5] ^= true;
+			}
+			device->nextChange = NextChange(config, due);
+		}
+		device->nextHeartbeat = due + (uint64_t)config->heartbeat * 1000;
+		SiftDown(0);
+
+		DeviceId(index, id, sizeof(id));
+		ConstructEvent(config, device, index, event);
+		FlowStub_DeliverMessage(NULL, id, event);
+		sent++;
+	}
+
+	generatorCpu = ThreadCpuUs() - generatorStart;
+	_monitor.isRunning = false;
+	pthread_join(monitorThread, NULL);
+	cpuEnd = ProcessCpuUs();
+
+	seconds = (NowUs() - start) / 1e6;
+	offered = count * (1000.0 / config->heartbeat + config->changeRate / 60.0);
+	received = controllerStats.receivedMessages - received;
+	dropped = controllerStats.droppedMessages - dropped;
+	dropRate = received ? 100.0 * dropped / received : 0.0;
+	controllerCpu = (double)(cpuEnd - cpuStart - generatorCpu - _monitor.cpuUs) / (seconds * 1e6) * 100.0;
+	lostProbes = _monitor.probesSent - _monitor.numLatencies;
+	qsort(_monitor.latencies, _monitor.numLatencies, sizeof(double), CompareDouble);
+
+	printf("%8u %10.1f %10.1f %8.2f%% %7.1f %5u %7.1f%% %9.3f %9.3f %9.3f %6lu%s\n",
+			count, offered, sent / seconds, dropRate,
+			_monitor.depthSamples ? (double)_monitor.depthSum / _monitor.depthSamples : 0.0, _monitor.depthMax,
+			controllerCpu,
+			Percentile(_monitor.latencies, _monitor.numLatencies, 50.0),
+			Percentile(_monitor.latencies, _monitor.numLatencies, 99.0),
+			Percentile(_monitor.latencies, _monitor.numLatencies, 100.0),
+			lostProbes, (late > sent / 100) ? "  generator behind" : "");
+	fflush(stdout);
+	return dropRate < 1.0;
+}
+
+static bool ParseNoise(const char *name, Noise_Type *noise)
+{
+	if (strcmp(name, "none") == 0)
+	{
+		*noise = Noise_None;
+	}
+	else if (strcmp(name, "gaussian") == 0)
+	{
+		*noise = Noise_Gaussian;
+	}
+	else if (strcmp(name, "spiky") == 0)
+	{
+		*noise = Noise_Spiky;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Bring up controller as main.c does, against the stand-in cloud
+ */
+static bool StartController(const Config *config)
+{
+	Controller *me = &_Controller;
+	FILE *file = fopen("flow_controller.cnf", "w");
+
+	if (!file)
+	{
+		return false;
+	}
+	fprintf(file, "Server_Address=stub\nAuth_Key=stub\nSecret_Key=stub\nDevice_Type=stub\n"
+					"MAC_Addr=stub\nSerial_Num=stub\nDevice_Name=stub\nDevreg_Key=stub\n");
+	fclose(file);
+
+	FlowStub_SetOwner(USER_ID);
+	ControllerSetDefaults(me);
+	me->stateDir = ".";	//Scratch directory make runs this in
+	me->sendMsgQueue = FlowQueue_NewBlocking(config->queueSize);
+	me->receiveMsgQueue = FlowQueue_NewBlocking(config->queueSize);
+	if (!InitializeFlowInterface(me))
+	{
+		return false;
+	}
+
+	me->controllerThread = FlowThread_New("ControllerTask", TASK_PRIORITY, STACK_SIZE, ControllerThread, me);
+	me->flowInterfaceThread = FlowThread_New("FlowInterfaceTask", TASK_PRIORITY, STACK_SIZE, FlowInterfaceThread, me);
+	if (!me->controllerThread || !me->flowInterfaceThread)
+	{
+		return false;
+	}
+
+	//Let controller settle on its settings before loading it
+	SleepUs(200000);
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	Config config = { 100000, 5, 15000, 2.0, Noise_Gaussian, 20 };
+	unsigned int count, saturation = 0;
+	unsigned int i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "N:t:h:c:p:q:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'N': config.maxDevices = strtoul(optarg, NULL, 10); break;
+			case 't': config.stepSeconds = strtoul(optarg, NULL, 10); break;
+			case 'h': config.heartbeat = strtoul(optarg, NULL, 10); break;
+			case 'c': config.changeRate = atof(optarg); break;
+			case 'q': config.queueSize = strtoul(optarg, NULL, 10); break;
+			case 'p':
+				if (ParseNoise(optarg, &config.noise))
+				{
+					break;
+				}
+				//fall through
+			default:
+				fprintf(stderr, "Usage: %s [-N max devices] [-t seconds per step] [-h heartbeat ms]\n"
+								"\t[-c changes per device per minute] [-p none|gaussian|spiky] [-q controller queue size]\n", argv[0]);
+				return 1;
+		}
+	}
+	if ((config.maxDevices == 0) || (config.stepSeconds == 0) || (config.heartbeat == 0) || (config.queueSize == 0))
+	{
+		fprintf(stderr, "Devices, step, heartbeat and queue size must be positive\n");
+		return 1;
+	}
+
+	_devices = calloc(config.maxDevices, sizeof(Device));
+	_heap = calloc(config.maxDevices, sizeof(unsigned int));
+	if (!_devices || !_heap)
+	{
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	for (i = 0; i < config.maxDevices; ++i)
+	{
+		_devices[i].temperature = (float)(BASE_TEMPERATURE + Gaussian());
+		_devices[i].humidity = (float)(BASE_HUMIDITY + 5.0 * Gaussian());
+	}
+
+	if (!StartController(&config))
+	{
+		fprintf(stderr, "Starting controller failed\n");
+		return 1;
+	}
+
+	printf("heartbeat %u ms, %.1f changes/min per device, controller queue %u, %u s per step\n",
+			config.heartbeat, config.changeRate, config.queueSize, config.stepSeconds);
+	printf(" devices  offered/s  deliver/s  dropped   depth   max     cpu   p50 ms   p99 ms   max ms  lost\n");
+	for (count = 1; ; count = (count > config.maxDevices / 10) ? config.maxDevices : count * 10)
+	{
+		if (!RunStep(&config, count) && (saturation == 0))
+		{
+			saturation = count;
+		}
+		if (count >= config.maxDevices)
+		{
+			break;
+		}
+	}
+
+	if (saturation)
+	{
+		printf("controller saturated at %u devices (over 1%% of messages dropped)\n", saturation);
+	}
+	else
+	{
+		printf("controller kept up with %u devices\n", config.maxDevices);
+	}
+	return 0;
+}
@@ -0,0 +1,234 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/**
+ * History store benchmark: sustained ingest and range scan throughput.
+ *
+ * SD card class storage is emulated by throttling every sync: after
+ * msync() returns, the benchmark sleeps for a fixed latency plus the
+ * synced bytes at the given bandwidth, as the writer thread would be
+ * blocked on a slow card for that long.
+ *
+ * Usage: history_bench [-d dir] [-n records] [-B sync batch] [-b MB/s] [-l latency ms] [-q queries]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include "history_store.h"
+
+#define START_TIME (1500000000u)
+#define SAMPLE_PERIOD (1)	//seconds between records
+#define QUERY_WINDOW (3600)	//seconds
+#define SEED (12345u)
+
+typedef struct
+{
+	uint64_t count;
+	int64_t temperatureSum;
+}ScanContext;
+
+static double NowSeconds(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void SleepSeconds(double seconds)
+{
+	struct timespec delay;
+
+	delay.tv_sec = (time_t)seconds;
+	delay.tv_nsec = (long)((seconds - delay.tv_sec) * 1e9);
+	nanosleep(&delay, NULL);
+}
+
+/**
+ * Remove benchmark's own store directory
+ */
+static void RemoveStore(const char *dir)
+{
+	char path[HISTORY_STORE_PATH_SIZE];
+	DIR *handle = opendir(dir);
+	struct dirent *entry;
+
+	if (handle)
+	{
+		while ((entry = readdir(handle)) != NULL)
+		{
+			if (entry->d_name[0] != '.')
+			{
+				snprintf(path, sizeof(path), "%s/%.31s", dir, entry->d_name);
+				unlink(path);
+			}
+		}
+		closedir(handle);
+		rmdir(dir);
+	}
+}
+
+static bool ScanRecord(const HistoryRecord *record, void *context)
+{
+	ScanContext *scan = (ScanContext *)context;
+
+	scan->count++;
+	scan->temperatureSum += record->temperature;
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	HistoryStore store;
+	HistoryRecord record;
+	ScanContext scan = { 0, 0 };
+	char dir[HISTORY_STORE_DIR_SIZE];
+	unsigned int records = 2000000;
+	unsigned int syncBatch = 512;
+	unsigned int queries = 1000;
+	double bandwidth = 10.0;	//MB/s
+	double latency = 5.0;	//ms
+	double start, elapsed, throttled = 0.0;
+	uint64_t lastSynced = 0;
+	uint32_t seed = SEED;
+	unsigned int i, syncs = 0;
+	bool isOwnDir = true;
+	int opt;
+
+	snprintf(dir, sizeof(dir), "/tmp/history_bench.%d", (int)getpid());
+	while ((opt = getopt(argc, argv, "d:n:B:b:l:q:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'd': snprintf(dir, sizeof(dir), "%s", optarg); isOwnDir = false; break;
+			case 'n': records = strtoul(optarg, NULL, 10); break;
+			case 'B': syncBatch = strtoul(optarg, NULL, 10); break;
+			case 'b': bandwidth = atof(optarg); break;
+			case 'l': latency = atof(optarg); break;
+			case 'q': queries = strtoul(optarg, NULL, 10); break;
+			default:
+				fprintf(stderr, "Usage: %s [-d dir] [-n records] [-B sync batch] [-b MB/s] [-l latency ms] [-q queries]\n", argv[0]);
+				return 1;
+		}
+	}
+	if ((syncBatch == 0) || (bandwidth <= 0.0) || (records == 0))
+	{
+		fprintf(stderr, "Records, sync batch and bandwidth must be positive\n");
+		return 1;
+	}
+
+	if (!HistoryStore_Open(&store, dir, 1024, HISTORY_STORE_MAX_SEGMENTS))
+	{
+		fprintf(stderr, "Opening store in %s failed\n", dir);
+		return 1;
+	}
+
+	printf("records %u, sync every %u, storage %.1f MB/s + %.1f ms per sync, %zu records per block\n",
+			records, syncBatch, bandwidth, latency, (size_t)HISTORY_BLOCK_RECORDS);
+
+	//Ingest
+	start = NowSeconds();
+	for (i = 0; i < records; ++i)
+	{
+		record.time = START_TIME + i * SAMPLE_PERIOD;
+		record.zone = 0;
+		record.relays = (i / 600) & 0x3;
+		record.temperature = 2000 + (int16_t)(i % 500);
+		record.humidity = 4000 + (uint16_t)(i % 1000);
+		if (!HistoryStore_Append(&store, &record))
+		{
+			fprintf(stderr, "Append failed at record %u\n", i);
+			return 1;
+		}
+
+		if ((i + 1) % syncBatch == 0)
+		{
+			double delay;
+
+			HistoryStore_Sync(&store);
+			delay = latency / 1000.0 + (store.bytesSynced - lastSynced) / (bandwidth * 1024.0 * 1024.0);
+			lastSynced = store.bytesSynced;
+			SleepSeconds(delay);
+			throttled += delay;
+			syncs++;
+		}
+	}
+	HistoryStore_Sync(&store);
+	elapsed = NowSeconds() - start;
+	printf("ingest      %10.0f records/s sustained, %.0f records/s excluding storage, %u syncs, %.1f MB synced\n",
+			records / elapsed, records / (elapsed - throttled), syncs, store.bytesSynced / (1024.0 * 1024.0));
+	HistoryStore_Close(&store);
+
+	//Reopen, so that scans go through recovery and read only mappings
+	start = NowSeconds();
+	if (!HistoryStore_Open(&store, dir, 1024, HISTORY_STORE_MAX_SEGMENTS))
+	{
+		fprintf(stderr, "Reopening store failed\n");
+		return 1;
+	}
+	printf("reopen      %10.2f ms, %u segments\n", (NowSeconds() - start) * 1000.0, store.numSegments);
+
+	start = NowSeconds();
+	HistoryStore_Scan(&store, 0, 0xFFFFFFFF, ScanRecord, &scan);
+	elapsed = NowSeconds() - start;
+	printf("full scan   %10.0f records/s, %llu records\n", scan.count / elapsed, (unsigned long long)scan.count);
+
+	scan.count = 0;
+	start = NowSeconds();
+	for (i = 0; i < queries; ++i)
+	{
+		uint32_t from;
+
+		seed = seed * 1664525u + 1013904223u;
+		from = store.segments[0].firstTime + (seed >> 8) % (records - QUERY_WINDOW);
+		HistoryStore_Scan(&store, from, from + QUERY_WINDOW - 1, ScanRecord, &scan);
+	}
+	elapsed = NowSeconds() - start;
+	if (queries > 0)
+	{
+		printf("1h range    %10.1f us/query, %llu records\n", elapsed * 1e6 / queries, (unsigned long long)scan.count);
+	}
+
+	HistoryStore_Close(&store);
+	if (isOwnDir)
+	{
+		RemoveStore(dir);
+	}
+	return 0;
+}
@@ -0,0 +1,425 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/**
+ * History server load test: concurrent clients querying random zones,
+ * ranges, resolutions and point limits, while another thread keeps
+ * adding samples as the controller would.
+ *
+ * Every response is checked: point times increase, their count is within
+ * the requested limit, and they are aligned to the resolution reported.
+ *
+ * Usage: history_load [-c clients] [-q queries per client] [-s socket path] [-p loopback port]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "history_server.h"
+
+#define NUM_ZONES (2)
+#define START_TIME (1500000000u)
+#define SAMPLE_PERIOD (10)	//seconds between samples
+#define HISTORY_DAYS (30)
+#define LIVE_PERIOD_US (1000)	//live sample every millisecond, far faster than a real sensor
+#define SEED (12345u)
+
+typedef struct
+{
+	const char *path;
+	uint16_t port;
+	unsigned int queries;
+	unsigned int seed;
+	double *latencies;
+	unsigned long points;
+	unsigned long bytes;
+	unsigned int errors;
+}LoadClient;
+
+static TimeSeries series[NUM_ZONES];
+static const TimeSeries *zones[NUM_ZONES] = { &series[0], &series[1] };
+static pthread_mutex_t seriesLock = PTHREAD_MUTEX_INITIALIZER;
+static volatile bool isRunning = true;
+static uint32_t now = START_TIME;
+
+static double NowSeconds(void)
+{
+	struct timespec time;
+
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static float SampleValue(unsigned int zone, uint32_t time)
+{
+	return (zone == 0 ? 21.0f : 45.0f) + (float)((time / SAMPLE_PERIOD) % 50) / 10.0f;
+}
+
+static void *ServerThread(void *context)
+{
+	HistoryServer *server = (HistoryServer *)context;
+
+	while (isRunning && HistoryServer_Poll(server, 50))
+	{
+	}
+	return NULL;
+}
+
+static void *LiveThread(void *context)
+{
+	struct timespec delay = { 0, LIVE_PERIOD_US * 1000 };
+	unsigned int zone;
+
+	(void)context;
+	while (isRunning)
+	{
+		pthread_mutex_lock(&seriesLock);
+		now += SAMPLE_PERIOD;
+		for (zone = 0; zone < NUM_ZONES; ++zone)
+		{
+			TimeSeries_Add(&series[zone], now, SampleValue(zone, now));
+		}
+		pthread_mutex_unlock(&seriesLock);
+		nanosleep(&delay, NULL);
+	}
+	return NULL;
+}
+
+static int Connect(const LoadClient *client)
+{
+	int fd;
+
+	if (client->port != 0)
+	{
+		struct sockaddr_in address;
+
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		address.sin_port = htons(client->port);
+		if (fd >= 0 && connect(fd, (struct sockaddr *)&address, sizeof(address)) == 0)
+		{
+			return fd;
+		}
+	}
+	else
+	{
+		struct sockaddr_un address;
+
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		strncpy(address.sun_path, client->path, sizeof(address.sun_path) - 1);
+		if (fd >= 0 && connect(fd, (struct sockaddr *)&address, sizeof(address)) == 0)
+		{
+			return fd;
+		}
+	}
+	if (fd >= 0)
+	{
+		close(fd);
+	}
+	return -1;
+}
+
+static bool ReadFull(int fd, uint8_t *buffer, size_t size)
+{
+	while (size > 0)
+	{
+		ssize_t received = recv(fd, buffer, size, 0);
+
+		if (received <= 0)
+		{
+			return false;
+		}
+		buffer += received;
+		size -= (size_t)received;
+	}
+	return true;
+}
+
+static uint32_t GetU32(const uint8_t *buffer)
+{
+	return (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) | ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+}
+
+static void PutU32(uint8_t *buffer, uint32_t value)
+{
+	buffer[0] = (uint8_t)value;
+	buffer[1] = (uint8_t)(value >> 8);
+	buffer[2] = (uint8_t)(value >> 16);
+	buffer[3] = (uint8_t)(value >> 24);
+}
+
+/**
+ * Send one request and read its whole response, checking it on the way.
+ */
+static bool Query(LoadClient *client, int fd, uint8_t zone, uint32_t from, uint32_t to, uint32_t resolution, uint16_t maxPoints)
+{
+	uint8_t request[HISTORY_REQUEST_SIZE] = { 0 };
+	uint8_t header[HISTORY_RESPONSE_HEADER_SIZE];
+	uint8_t point[HISTORY_POINT_SIZE];
+	uint32_t usedResolution;
+	uint32_t lastTime = 0;
+	unsigned long numPoints = 0;
+	bool isValid = true;
+
+	request[0] = HISTORY_PROTOCOL_MAGIC & 0xFF;
+	request[1] = HISTORY_PROTOCOL_MAGIC >> 8;
+	request[2] = HISTORY_PROTOCOL_VERSION;
+	request[3] = zone;
+	PutU32(&request[4], from);
+	PutU32(&request[8], to);
+	PutU32(&request[12], resolution);
+	request[16] = maxPoints & 0xFF;
+	request[17] = maxPoints >> 8;
+
+	if (send(fd, request, sizeof(request), MSG_NOSIGNAL) != sizeof(request) || !ReadFull(fd, header, sizeof(header)))
+	{
+		return false;
+	}
+	if (header[3] != HistoryStatus_Ok)
+	{
+		return false;
+	}
+	usedResolution = GetU32(&header[4]);
+	client->bytes += sizeof(header);
+
+	for (;;)
+	{
+		uint8_t countBytes[2];
+		unsigned int count;
+
+		if (!ReadFull(fd, countBytes, sizeof(countBytes)))
+		{
+			return false;
+		}
+		client->bytes += sizeof(countBytes);
+		count = countBytes[0] | (countBytes[1] << 8);
+		if (count == 0)
+		{
+			break;
+		}
+		for (; count > 0; --count)
+		{
+			uint32_t time;
+
+			if (!ReadFull(fd, point, sizeof(point)))
+			{
+				return false;
+			}
+			time = GetU32(&point[0]);
+			if ((numPoints > 0 && time <= lastTime) || (usedResolution > 0 && time % usedResolution != 0))
+			{
+				isValid = false;
+			}
+			lastTime = time;
+			numPoints++;
+			client->bytes += sizeof(point);
+		}
+	}
+
+	if (numPoints > maxPoints || usedResolution < resolution)
+	{
+		isValid = false;
+	}
+	client->points += numPoints;
+	return isValid;
+}
+
+static void *ClientThread(void *context)
+{
+	LoadClient *client = (LoadClient *)context;
+	static const uint32_t resolutions[] = { 0, 60, 300, 900, 3600, 86400 };
+	unsigned int i;
+	int fd = Connect(client);
+
+	if (fd < 0)
+	{
+		client->errors = client->queries;
+		return NULL;
+	}
+
+	for (i = 0; i < client->queries; ++i)
+	{
+		uint32_t latest = now;
+		uint32_t span = 600 + rand_r(&client->seed) % (HISTORY_DAYS * 86400);
+		uint32_t to = latest - rand_r(&client->seed) % 3600;
+		uint32_t from = (to > span) ? to - span : 0;
+		uint32_t resolution = resolutions[rand_r(&client->seed) % (sizeof(resolutions) / sizeof(resolutions[0]))];
+		uint16_t maxPoints = (uint16_t)(10 + rand_r(&client->seed) % 2000);
+		double start = NowSeconds();
+
+		if (!Query(client, fd, (uint8_t)(rand_r(&client->seed) % NUM_ZONES), from, to, resolution, maxPoints))
+		{
+			client->errors++;
+		}
+		client->latencies[i] = NowSeconds() - start;
+	}
+	close(fd);
+	return NULL;
+}
+
+static int CompareDouble(const void *a, const void *b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *path = "/tmp/history_load.sock";
+	unsigned int numClients = 16;
+	unsigned int queries = 500;
+	uint16_t port = 0;
+	HistoryServer server;
+	pthread_t serverThread;
+	pthread_t liveThread;
+	pthread_t *threads;
+	LoadClient *clients;
+	double *latencies;
+	unsigned long totalPoints = 0;
+	unsigned long totalBytes = 0;
+	unsigned int errors = 0;
+	unsigned int total;
+	unsigned int i;
+	unsigned int zone;
+	double start;
+	double elapsed;
+	int option;
+
+	while ((option = getopt(argc, argv, "c:q:s:p:")) != -1)
+	{
+		switch (option)
+		{
+			case 'c':
+				numClients = (unsigned int)atoi(optarg);
+				break;
+			case 'q':
+				queries = (unsigned int)atoi(optarg);
+				break;
+			case 's':
+				path = optarg;
+				break;
+			case 'p':
+				port = (uint16_t)atoi(optarg);
+				break;
+			default:
+				fprintf(stderr, "Usage: %s [-c clients] [-q queries per client] [-s socket path] [-p loopback port]\n", argv[0]);
+				return 1;
+		}
+	}
+	if (numClients == 0 || queries == 0)
+	{
+		fprintf(stderr, "Need at least one client and one query\n");
+		return 1;
+	}
+
+	for (zone = 0; zone < NUM_ZONES; ++zone)
+	{
+		TimeSeries_Init(&series[zone]);
+		for (now = START_TIME; now < START_TIME + HISTORY_DAYS * 86400; now += SAMPLE_PERIOD)
+		{
+			TimeSeries_Add(&series[zone], now, SampleValue(zone, now));
+		}
+	}
+
+	if (!HistoryServer_Open(&server, path, port, zones, NUM_ZONES, &seriesLock))
+	{
+		fprintf(stderr, "Opening history server failed\n");
+		return 1;
+	}
+	pthread_create(&serverThread, NULL, ServerThread, &server);
+	pthread_create(&liveThread, NULL, LiveThread, NULL);
+
+	total = numClients * queries;
+	threads = calloc(numClients, sizeof(pthread_t));
+	clients = calloc(numClients, sizeof(LoadClient));
+	latencies = calloc(total, sizeof(double));
+	if (threads == NULL || clients == NULL || latencies == NULL)
+	{
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	start = NowSeconds();
+	for (i = 0; i < numClients; ++i)
+	{
+		clients[i].path = path;
+		clients[i].port = port;
+		clients[i].queries = queries;
+		clients[i].seed = SEED + i;
+		clients[i].latencies = &latencies[i * queries];
+		pthread_create(&threads[i], NULL, ClientThread, &clients[i]);
+	}
+	for (i = 0; i < numClients; ++i)
+	{
+		pthread_join(threads[i], NULL);
+		totalPoints += clients[i].points;
+		totalBytes += clients[i].bytes;
+		errors += clients[i].errors;
+	}
+	elapsed = NowSeconds() - start;
+
+	isRunning = false;
+	pthread_join(liveThread, NULL);
+	pthread_join(serverThread, NULL);
+
+	qsort(latencies, total, sizeof(double), CompareDouble);
+	printf("clients %u, queries %u over %s\n", numClients, total, port ? "loopback TCP" : "Unix socket");
+	printf("throughput: %.0f queries/s, %.0f points/s, %.1f MB/s\n",
+			total / elapsed, totalPoints / elapsed, totalBytes / elapsed / 1e6);
+	printf("latency: p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+			latencies[total / 2] * 1e3, latencies[total * 95 / 100] * 1e3,
+			latencies[total * 99 / 100] * 1e3, latencies[total - 1] * 1e3);
+	printf("mean points per query %.1f, requests served %lu, clients rejected %lu, errors %u\n",
+			(double)totalPoints / total, server.requests, server.rejectedClients, errors);
+
+	HistoryServer_Close(&server);
+	free(latencies);
+	free(clients);
+	free(threads);
+	return (errors == 0) ? 0 : 1;
+}
@@ -0,0 +1,696 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/**
+ * Micro benchmarks of message construction and parsing: each Construct*
+ * function, ParseMessage() over sensor/actuator events and user commands,
+ * ParseAndUpdateSettings(), and the WiFire firmware's own message builders
+ * and command lookup compiled for host.
+ *
+ * Cases suffixed _snprintf format the messages that are otherwise patched
+ * into pre-rendered templates, to compare the two paths. Cases suffixed
+ * _dirty mark the state they serialize as changed on every op, so that
+ * cached sections are built again.
+ *
+ * Cases under proto/ run the climate_proto codec shared with the
+ * firmware on its own, without building or posting a message.
+ *
+ * Cases under wire/ convert messages to and from the compact wire format,
+ * so their bytes/op is the size of the message produced. Cases suffixed
+ * _compact parse compact messages from a peer which advertised it, so
+ * that the controller also encodes what it sends back.
+ *
+ * Each case reports ns/op (median of runs), and bytes and allocations
+ * per op, as counted by the stand-in's Flow_MemAlloc(). Results can be
+ * saved as JSON and compared between runs with compare_bench.py.
+ *
+ * Usage: micro_bench [-t ms per run] [-r runs] [-f filter] [-o results.json]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "flow/flowcore.h"
+#include "controller.h"
+#include "flow_interface.h"
+#include "construct_message.h"
+#include "flow_stub.h"
+#include "firmware_bench.h"
+
+#define QUEUE_SIZE (64)
+#define MAX_RUNS (32)
+#define USER_ID "user"
+#define SENSOR_ID "sensor"
+#define ACTUATOR_ID "actuator"
+
+#define SETTINGS_XML \
+	"<ControllerConfig>" \
+	"<TemperatureThreshold>22.50</TemperatureThreshold><HumidityThreshold>40.00</HumidityThreshold>" \
+	"<TemperatureOrientation>BELOW</TemperatureOrientation><HumidityOrientation>ABOVE</HumidityOrientation>" \
+	"<HeartBeat>15000</HeartBeat>" \
+	"<SensorConfig><HeartBeat>15000</HeartBeat><TemperatureReadInterval>1000</TemperatureReadInterval>" \
+	"<HumidityReadInterval>2500</HumidityReadInterval><TemperatureReadDelta>0.50</TemperatureReadDelta>" \
+	"<HumidityReadDelta>2.00</HumidityReadDelta></SensorConfig>" \
+	"<ActuatorConfig><HeartBeat>15000</HeartBeat></ActuatorConfig>" \
+	"</ControllerConfig>"
+
+//As sent by the firmware, so with declaration and time
+#define SENSOR_EVENT_XML \
+	"<?xml version=\"1.0\" encoding=\"UTF-8\"?><event><time type=\"datetime\">2017-07-14T14:00:00Z</time>" \
+	"<type>Sensor</type><info><Temperature>21.50</Temperature><Humidity>38.00</Humidity></info></event>"
+
+#define ACTUATOR_EVENT_XML \
+	"<?xml version=\"1.0\" encoding=\"UTF-8\"?><event><time type=\"datetime\">2017-07-14T14:00:00Z</time>" \
+	"<type>Actuator</type><info><Relay_1>ON</Relay_1><Relay_2>OFF</Relay_2></info></event>"
+
+#define RELAY_ON_COMMAND_XML "<command><info>RELAY_2_ON</info></command>"
+#define RELAY_OFF_COMMAND_XML "<command><info>RELAY_2_OFF</info></command>"
+#define PING_COMMAND_XML "<command><info>PING</info><app_time>1499997600123456</app_time></command>"
+#define UNKNOWN_COMMAND_XML "<command><info>SELF_DESTRUCT</info></command>"
+#define SENSOR_SETTINGS_COMMAND_XML \
+	"<?xml version=\"1.0\" encoding=\"UTF-8\"?><command><time type=\"datetime\">2017-07-14T14:00:00Z</time>" \
+	"<info>UPDATE_SETTINGS</info><wire>1</wire><settings><HeartBeat>15000</HeartBeat>" \
+	"<TemperatureReadInterval>1000</TemperatureReadInterval><HumidityReadInterval>2500</HumidityReadInterval>" \
+	"<TemperatureReadDelta>0.50</TemperatureReadDelta><HumidityReadDelta>2.00</HumidityReadDelta></settings></command>"
+
+#define PING_COMMAND_WIRE_XML "<command><info>PING</info><app_time>1499997600123456</app_time><wire>1</wire></command>"
+
+typedef void (*BenchFunc)(unsigned long iteration);
+
+typedef struct
+{
+	const char *name;
+	BenchFunc func;
+}BenchCase;
+
+typedef struct
+{
+	const char *name;
+	unsigned long iterations;
+	double nsPerOp;
+	double bytesPerOp;
+	double allocsPerOp;
+}BenchResult;
+
+static Controller *_me;
+static Controller *_formatting;	//Copy of _me without templates, so formatting its messages
+static volatile int _sink;
+static char *_heartBeatXml;	//Heartbeat to user and messages from peers, as converted in SetUp()
+static char *_heartBeatCompact;
+static char *_sensorEventCompact;
+static char *_pingCommandCompact;
+
+static double NowNs(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+/**
+ * Stand in for flow thread, dropping everything posted to it. Commands
+ * are part of what a parse produces, so they count towards its op.
+ */
+static void DrainCommands(Controller *me)
+{
+	FlowInterfaceCmd *cmd;
+
+	while ((cmd = FlowQueue_DequeueWaitFor(me->sendMsgQueue, 0)) != NULL)
+	{
+		Flow_MemFree(&cmd->details);
+		Flow_MemFree((void **)&cmd);
+	}
+}
+
+static void Consume(bool success, char *data)
+{
+	_sink += success;
+	Flow_MemFree((void **)&data);
+}
+
+static void Parse(const char *from, const char *content)
+{
+	ReceivedMessage message = { (char *)from, (char *)content };
+
+	_sink += ParseMessage(&message, _me);
+	DrainCommands(_me);
+}
+
+static void ConstructSettingsForSensor(unsigned long i)
+{
+	char *data = NULL;
+
+	Consume(ConstructSettingsCommandForSensor(_me, &data), data);
+}
+
+static void ConstructSettingsForActuator(unsigned long i)
+{
+	char *data = NULL;
+
+	Consume(ConstructSettingsCommandForActuator(_me, &data), data);
+}
+
+static void ConstructResponse(unsigned long i)
+{
+	char *data = NULL;
+
+	Consume(ConstructResponseForUser("RELAY_1_ON", &data), data);
+}
+
+static void ConstructPingResponse(unsigned long i)
+{
+	char *data = NULL;
+
+	Consume(ConstructPingResponseForUser("1499997600123456", &data), data);
+}
+
+static void ConstructRelayCommand(unsigned long i)
+{
+	char *data = NULL;
+
+	Consume(ConstructRelayCommandForActuator("RELAY_1_ON", &data), data);
+}
+
+static void ConstructDeviceStatus(unsigned long i)
+{
+	char *data = NULL;
+
+	Consume(ConstructDeviceStatusMsgForUser(_me, &data), data);
+}
+
+static void ConstructSensorStatus(unsigned long i)
+{
+	char *data = NULL;
+
+	Consume(ConstructSensorStatusMsgForUser(_me, &data), data);
+}
+
+static void ConstructActuatorStatus(unsigned long i)
+{
+	char *data = NULL;
+
+	Consume(ConstructActuatorStatusMsgForUser(_me, &data), data);
+}
+
+static void ConstructSettings(unsigned long i)
+{
+	char *data = NULL;
+
+	Consume(ConstructSetting(_me, &data), data);
+}
+
+static void ConstructHeartBeat(unsigned long i)
+{
+	char *data = NULL;
+
+	Consume(ConstructHeartBeatMsgForUser(_me, &data), data);
+}
+
+//As after every settings change, so formatting settings each time
+static void ConstructSettingsDirty(unsigned long i)
+{
+	char *data = NULL;
+
+	ControllerMarkDirty(_me, ControllerSection_Settings);
+	Consume(ConstructSetting(_me, &data), data);
+}
+
+//As after every sensor event, so patching sensor values each time
+static void ConstructHeartBeatDirty(unsigned long i)
+{
+	char *data = NULL;
+
+	ControllerMarkDirty(_me, ControllerSection_Sensors);
+	Consume(ConstructHeartBeatMsgForUser(_me, &data), data);
+}
+
+static void FormatDeviceStatus(unsigned long i)
+{
+	char *data = NULL;
+
+	Consume(ConstructDeviceStatusMsgForUser(_formatting, &data), data);
+}
+
+static void FormatSensorStatus(unsigned long i)
+{
+	char *data = NULL;
+
+	Consume(ConstructSensorStatusMsgForUser(_formatting, &data), data);
+}
+
+static void FormatActuatorStatus(unsigned long i)
+{
+	char *data = NULL;
+
+	Consume(ConstructActuatorStatusMsgForUser(_formatting, &data), data);
+}
+
+static void FormatHeartBeat(unsigned long i)
+{
+	char *data = NULL;
+
+	Consume(ConstructHeartBeatMsgForUser(_formatting, &data), data);
+}
+
+static void ParseSensorEvent(unsigned long i)
+{
+	Parse(SENSOR_ID, SENSOR_EVENT_XML);
+}
+
+static void ParseActuatorEvent(unsigned long i)
+{
+	Parse(ACTUATOR_ID, ACTUATOR_EVENT_XML);
+}
+
+//Alternates, so that every command changes the relay
+static void ParseRelayCommand(unsigned long i)
+{
+	Parse(USER_ID, (i & 1) ? RELAY_OFF_COMMAND_XML : RELAY_ON_COMMAND_XML);
+}
+
+static void ParsePingCommand(unsigned long i)
+{
+	Parse(USER_ID, PING_COMMAND_XML);
+}
+
+static void ParseUnknownCommand(unsigned long i)
+{
+	Parse(USER_ID, UNKNOWN_COMMAND_XML);
+}
+
+static void ParseSensorEventCompact(unsigned long i)
+{
+	Parse(SENSOR_ID, _sensorEventCompact);
+}
+
+static void ParsePingCommandCompact(unsigned long i)
+{
+	Parse(USER_ID, _pingCommandCompact);
+}
+
+static void HeartBeatToCompact(unsigned long i)
+{
+	char *data = WireFormat_ToCompact(_heartBeatXml);
+
+	Consume(data != NULL, data);
+}
+
+static void HeartBeatToXml(unsigned long i)
+{
+	char *data = WireFormat_ToXml(_heartBeatCompact);
+
+	Consume(data != NULL, data);
+}
+
+//Heartbeat built, then parsed into a tree as its receiver would
+static void ParseTree(char *xml)
+{
+	TreeNode root = xml ? TreeNode_ParseXML((uint8_t *)xml, strlen(xml), true) : NULL;
+
+	_sink += (root != NULL);
+	if (root)
+	{
+		Tree_Delete(root);
+	}
+	Flow_MemFree((void **)&xml);
+}
+
+static void HeartBeatRoundTrip(unsigned long i)
+{
+	char *data = NULL;
+
+	ConstructHeartBeatMsgForUser(_me, &data);
+	ParseTree(data);
+}
+
+static void HeartBeatRoundTripCompact(unsigned long i)
+{
+	char *data = NULL;
+	char *compact;
+
+	ConstructHeartBeatMsgForUser(_me, &data);
+	compact = WireFormat_ToCompact(data);
+	Flow_MemFree((void **)&data);
+	ParseTree(WireFormat_ToXml(compact));
+	Flow_MemFree((void **)&compact);
+}
+
+static void ParseSettings(unsigned long i)
+{
+	_sink += ParseAndUpdateSettings(SETTINGS_XML, _me);
+	DrainCommands(_me);
+}
+
+static void ProtoParseEvent(unsigned long i)
+{
+	ClimateProto_Event event;
+	ClimateProto_SensorInfo info;
+
+	_sink += ClimateProto_Parse(&ClimateProto_EventSchema, SENSOR_EVENT_XML, &event);
+	_sink += ClimateProto_Parse(&ClimateProto_SensorInfoSchema, SENSOR_EVENT_XML, &info);
+}
+
+static void ProtoParseSensorSettings(unsigned long i)
+{
+	ClimateProto_Command command;
+	ClimateProto_SensorSettings settings;
+
+	_sink += ClimateProto_ParseCommand(SENSOR_SETTINGS_COMMAND_XML, &command, &ClimateProto_SensorSettingsSchema, &settings);
+}
+
+static void ProtoSerializeSensorSettings(unsigned long i)
+{
+	const ClimateProto_Schema *schema = &ClimateProto_SensorSettingsSchema;
+	ClimateProto_SensorSettings settings = { 0 };
+	char buffer[256];
+
+	ClimateProto_SetUint(schema, &settings, ClimateProto_SensorSettings_heartBeat, 15000);
+	ClimateProto_SetUint(schema, &settings, ClimateProto_SensorSettings_temperatureReadInterval, 1000);
+	ClimateProto_SetUint(schema, &settings, ClimateProto_SensorSettings_humidityReadInterval, 2500);
+	ClimateProto_SetFloat(schema, &settings, ClimateProto_SensorSettings_temperatureReadDelta, 0.5f);
+	ClimateProto_SetFloat(schema, &settings, ClimateProto_SensorSettings_humidityReadDelta, 2.0f);
+	_sink += ClimateProto_Serialize(schema, &settings, buffer, sizeof(buffer));
+}
+
+static void FirmwareSensorMessage(unsigned long i)
+{
+	char *data = FirmwareBench_SensorMessageXML(21.5f, 38.0f, 1499997600 + i);
+
+	Consume(data != NULL, data);
+}
+
+static void FirmwareActuatorHeartBeat(unsigned long i)
+{
+	char *data = FirmwareBench_ActuatorHeartBeatMsg(i & 1, true);
+
+	Consume(data != NULL, data);
+}
+
+static void FirmwareFormatSensorMessage(unsigned long i)
+{
+	char *data = FirmwareBench_FormatSensorMessageXML(21.5f, 38.0f, 1499997600 + i);
+
+	Consume(data != NULL, data);
+}
+
+static void FirmwareFormatActuatorHeartBeat(unsigned long i)
+{
+	char *data = FirmwareBench_FormatActuatorHeartBeatMsg(i & 1, true);
+
+	Consume(data != NULL, data);
+}
+
+static void FirmwareLookupLast(unsigned long i)
+{
+	_sink += FirmwareBench_FindCommand("RELAY_2_OFF");
+}
+
+static void FirmwareLookupMiss(unsigned long i)
+{
+	_sink += FirmwareBench_FindCommand("UPDATE_SETTINGS");
+}
+
+static void FirmwareSensorParseSettings(unsigned long i)
+{
+	ClimateProto_SensorSettings settings;
+	bool isCompact;
+
+	_sink += FirmwareBench_SensorParseSettings(SENSOR_SETTINGS_COMMAND_XML, &settings, &isCompact);
+}
+
+static void FirmwareDhtDecode(unsigned long i)
+{
+	unsigned int humidity, temperature;
+
+	_sink += FirmwareBench_DhtDecode(false, &humidity, &temperature);
+}
+
+static void FirmwareDhtDecodeNoisy(unsigned long i)
+{
+	unsigned int humidity, temperature;
+
+	_sink += FirmwareBench_DhtDecode(true, &humidity, &temperature);
+}
+
+//Codes 1 to 4095, over and over
+static void FirmwareThermistorFormula(unsigned long i)
+{
+	_sink += FirmwareBench_ThermistorFormula((i % 4095) + 1);
+}
+
+static void FirmwareThermistorTable(unsigned long i)
+{
+	_sink += FirmwareBench_ThermistorTable((i % 4095) + 1);
+}
+
+//Readings over -40 to 62 C, in 1/40 C steps
+static void FirmwareSensorCalibrate(unsigned long i)
+{
+	_sink += FirmwareBench_SensorCalibrate((float)(i & 4095) / 40.0f - 40.0f);
+}
+
+static const BenchCase _cases[] =
+{
+	{ "construct/settings_for_sensor", ConstructSettingsForSensor },
+	{ "construct/settings_for_actuator", ConstructSettingsForActuator },
+	{ "construct/response_for_user", ConstructResponse },
+	{ "construct/ping_response_for_user", ConstructPingResponse },
+	{ "construct/relay_command_for_actuator", ConstructRelayCommand },
+	{ "construct/device_status_for_user", ConstructDeviceStatus },
+	{ "construct/sensor_status_for_user", ConstructSensorStatus },
+	{ "construct/actuator_status_for_user", ConstructActuatorStatus },
+	{ "construct/setting", ConstructSettings },
+	{ "construct/setting_dirty", ConstructSettingsDirty },
+	{ "construct/heartbeat_for_user", ConstructHeartBeat },
+	{ "construct/heartbeat_for_user_dirty", ConstructHeartBeatDirty },
+	{ "construct/device_status_for_user_snprintf", FormatDeviceStatus },
+	{ "construct/sensor_status_for_user_snprintf", FormatSensorStatus },
+	{ "construct/actuator_status_for_user_snprintf", FormatActuatorStatus },
+	{ "construct/heartbeat_for_user_snprintf", FormatHeartBeat },
+	{ "parse/sensor_event", ParseSensorEvent },
+	{ "parse/actuator_event", ParseActuatorEvent },
+	{ "parse/relay_command", ParseRelayCommand },
+	{ "parse/ping_command", ParsePingCommand },
+	{ "parse/unknown_command", ParseUnknownCommand },
+	{ "parse/settings", ParseSettings },
+	{ "parse/sensor_event_compact", ParseSensorEventCompact },
+	{ "parse/ping_command_compact", ParsePingCommandCompact },
+	{ "proto/parse_event", ProtoParseEvent },
+	{ "proto/parse_sensor_settings", ProtoParseSensorSettings },
+	{ "proto/serialize_sensor_settings", ProtoSerializeSensorSettings },
+	{ "wire/heartbeat_to_compact", HeartBeatToCompact },
+	{ "wire/heartbeat_to_xml", HeartBeatToXml },
+	{ "wire/heartbeat_round_trip", HeartBeatRoundTrip },
+	{ "wire/heartbeat_round_trip_compact", HeartBeatRoundTripCompact },
+	{ "firmware/sensor_message_xml", FirmwareSensorMessage },
+	{ "firmware/actuator_heartbeat_msg", FirmwareActuatorHeartBeat },
+	{ "firmware/sensor_message_xml_snprintf", FirmwareFormatSensorMessage },
+	{ "firmware/actuator_heartbeat_msg_snprintf", FirmwareFormatActuatorHeartBeat },
+	{ "firmware/find_command_last", FirmwareLookupLast },
+	{ "firmware/find_command_miss", FirmwareLookupMiss },
+	{ "firmware/sensor_parse_settings", FirmwareSensorParseSettings },
+	{ "firmware/dht_decode", FirmwareDhtDecode },
+	{ "firmware/dht_decode_noisy", FirmwareDhtDecodeNoisy },
+	{ "firmware/thermistor_log", FirmwareThermistorFormula },
+	{ "firmware/thermistor_table", FirmwareThermistorTable },
+	{ "firmware/sensor_calibration", FirmwareSensorCalibrate },
+};
+
+static double RunIterations(BenchFunc func, unsigned long iterations)
+{
+	double start = NowNs();
+	unsigned long i;
+
+	for (i = 0; i < iterations; ++i)
+	{
+		func(i);
+	}
+	return NowNs() - start;
+}
+
+static int CompareDouble(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+/**
+ * Size a run to the target time, then take the median of runs. Allocations
+ * are deterministic, so they are averaged over all runs.
+ */
+static void RunCase(const BenchCase *bench, double targetNs, unsigned int runs, BenchResult *result)
+{
+	FlowStubAllocationStats before, after;
+	double elapsed[MAX_RUNS];
+	unsigned long iterations = 1;
+	unsigned int run;
+
+	bench->func(0);
+	DrainCommands(_me);
+	while ((elapsed[0] = RunIterations(bench->func, iterations)) < targetNs / 10)
+	{
+		iterations *= 2;
+	}
+	iterations = (unsigned long)(iterations * targetNs / (elapsed[0] > 0 ? elapsed[0] : 1)) + 1;
+
+	FlowStub_GetAllocationStats(&before);
+	for (run = 0; run < runs; ++run)
+	{
+		elapsed[run] = RunIterations(bench->func, iterations);
+	}
+	FlowStub_GetAllocationStats(&after);
+	qsort(elapsed, runs, sizeof(elapsed[0]), CompareDouble);
+
+	result->name = bench->name;
+	result->iterations = iterations;
+	result->nsPerOp = elapsed[runs / 2] / iterations;
+	result->bytesPerOp = (double)(after.bytes - before.bytes) / ((double)iterations * runs);
+	result->allocsPerOp = (double)(after.count - before.count) / ((double)iterations * runs);
+}
+
+static bool WriteJson(const char *path, const BenchResult *results, unsigned int count, unsigned int runs, unsigned int targetMs)
+{
+	FILE *file = fopen(path, "w");
+	unsigned int i;
+
+	if (!file)
+	{
+		perror(path);
+		return false;
+	}
+	fprintf(file, "{\n\t\"benchmark\": \"micro_bench\",\n\t\"timestamp\": %ld,\n\t\"runs\": %u,\n\t\"target_ms\": %u,\n\t\"results\": [\n",
+			(long)time(NULL), runs, targetMs);
+	for (i = 0; i < count; ++i)
+	{
+		fprintf(file, "\t\t{\"name\": \"%s\", \"iterations\": %lu, \"ns_per_op\": %.2f, \"bytes_per_op\": %.2f, \"allocs_per_op\": %.3f}%s\n",
+				results[i].name, results[i].iterations, results[i].nsPerOp, results[i].bytesPerOp, results[i].allocsPerOp,
+				(i + 1 < count) ? "," : "");
+	}
+	fprintf(file, "\t]\n}\n");
+	return fclose(file) == 0;
+}
+
+static void SetUp(Controller *me)
+{
+	ControllerEvent *event;
+
+	FlowStub_UseVirtualTime(1499997600);
+	ControllerSetDefaults(me);
+	me->stateDir = ".";	//Scratch directory make runs this in
+	strcpy(me->userId, USER_ID);
+	me->sendMsgQueue = FlowQueue_NewBlocking(QUEUE_SIZE);
+	me->receiveMsgQueue = FlowQueue_NewBlocking(QUEUE_SIZE);
+	ControllerStart(me);
+
+	//Settings applied and both devices known, as in steady state
+	event = Flow_MemAlloc(sizeof(ControllerEvent));
+	event->evtType = ControllerEvent_SettingSuccess;
+	event->details = FlowString_Duplicate(SETTINGS_XML);
+	ControllerHandleEvent(me, event);
+	Parse(SENSOR_ID, SENSOR_EVENT_XML);
+	Parse(ACTUATOR_ID, ACTUATOR_EVENT_XML);
+	DrainCommands(me);
+
+	ConstructHeartBeatMsgForUser(me, &_heartBeatXml);
+	_heartBeatCompact = WireFormat_ToCompact(_heartBeatXml);
+	_sensorEventCompact = WireFormat_ToCompact(SENSOR_EVENT_XML);
+	_pingCommandCompact = WireFormat_ToCompact(PING_COMMAND_WIRE_XML);
+	printf("heartbeat to user %zu bytes as XML, %zu compact\n", strlen(_heartBeatXml), strlen(_heartBeatCompact));
+	printf("sensor event %zu bytes as XML, %zu compact\n", strlen(SENSOR_EVENT_XML), strlen(_sensorEventCompact));
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int count = sizeof(_cases) / sizeof(_cases[0]);
+	BenchResult results[sizeof(_cases) / sizeof(_cases[0])];
+	const char *filter = NULL;
+	const char *output = NULL;
+	unsigned int targetMs = 100;
+	unsigned int runs = 5;
+	unsigned int i, done = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "t:r:f:o:")) != -1)
+	{
+		switch (opt)
+		{
+			case 't': targetMs = strtoul(optarg, NULL, 10); break;
+			case 'r': runs = strtoul(optarg, NULL, 10); break;
+			case 'f': filter = optarg; break;
+			case 'o': output = optarg; break;
+			default:
+				fprintf(stderr, "Usage: %s [-t ms per run] [-r runs] [-f filter] [-o results.json]\n", argv[0]);
+				return 1;
+		}
+	}
+	if (runs < 1 || runs > MAX_RUNS || targetMs < 1)
+	{
+		fprintf(stderr, "Runs must be 1 to %d, time per run at least 1 ms\n", MAX_RUNS);
+		return 1;
+	}
+
+	//Controller threads keep using it, so it is never freed
+	_me = calloc(1, sizeof(Controller));
+	SetUp(_me);
+	_formatting = malloc(sizeof(Controller));
+	memcpy(_formatting, _me, sizeof(Controller));
+	_formatting->heartBeatTemplate.isValid = false;
+	_formatting->sensorStatusTemplate.isValid = false;
+	_formatting->actuatorStatusTemplate.isValid = false;
+	_formatting->deviceStatusTemplate.isValid = false;
+
+	printf("%-40s %12s %10s %10s %10s\n", "case", "iterations", "ns/op", "bytes/op", "allocs/op");
+	for (i = 0; i < count; ++i)
+	{
+		if (filter && !strstr(_cases[i].name, filter))
+		{
+			continue;
+		}
+		RunCase(&_cases[i], targetMs * 1e6, runs, &results[done]);
+		printf("%-40s %12lu %10.1f %10.1f %10.2f\n", results[done].name, results[done].iterations,
+				results[done].nsPerOp, results[done].bytesPerOp, results[done].allocsPerOp);
+		done++;
+	}
+
+	if (output && !WriteJson(output, results, done, runs, targetMs))
+	{
+		return 1;
+	}
+	return 0;
+}
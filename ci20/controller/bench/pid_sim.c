@@ -0,0 +1,223 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/**
+ * Offline closed loop simulation of a temperature zone: sensor reporting
+ * rules of the Wi-Fire sensor, controller zone logic and a thermal plant.
+ * Compares threshold (bang-bang) control against PID duty cycle control,
+ * reporting tracking error, overshoot and relay transitions per hour.
+ *
+ * Usage: pid_sim [-p kp] [-i ki] [-d kd] [-w window ms] [-t hours] [-s setpoint]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "zone_control.h"
+#include "thermal_plant.h"
+
+#define SIM_STEP (1000)	//milliseconds, also control tick
+#define SENSOR_READ_INTERVAL (1000)	//milliseconds
+#define SENSOR_HEARTBEAT (15000)	//milliseconds
+#define SENSOR_READ_DELTA (0.5f)	//degree centigrade
+#define MIN_PULSE (10000)	//milliseconds
+#define WARM_UP_HOURS (3.0)
+#define SEED (12345u)
+
+typedef enum
+{
+	SimMode_Threshold,
+	SimMode_Pid,
+}SimMode_Type;
+
+typedef struct
+{
+	double sumAbsError;
+	double sumSquareError;
+	float maxOvershoot;
+	float maxUndershoot;
+	unsigned int transitions;
+	unsigned int onSeconds;
+	unsigned int samples;
+	unsigned int reports;
+}SimResult;
+
+static void RunSimulation(SimMode_Type mode, const PidGains *gains, unsigned int window, float setpoint,
+							double hours, SimResult *result)
+{
+	ThermalPlant plant;
+	ZoneControl zone;
+	float reported = 0.0f;
+	float lastSent = 0.0f;
+	bool hasReport = false;
+	bool relayOn = false;
+	unsigned int sinceRead = 0;
+	unsigned int sinceSent = 0;
+	unsigned int step;
+	unsigned int steps = (unsigned int)(hours * 3600.0 * 1000.0 / SIM_STEP);
+	unsigned int warmUpSteps = (unsigned int)(WARM_UP_HOURS * 3600.0 * 1000.0 / SIM_STEP);
+
+	ThermalPlant_Init(&plant, &ThermalPlant_DefaultRoom, 15.0f, SEED);
+	ZoneControl_Init(&zone, window, SIM_STEP, (MIN_PULSE > window / 4) ? window / 4 : MIN_PULSE);
+	memset(result, 0, sizeof(*result));
+	result->maxUndershoot = 0.0f;
+
+	for (step = 0; step < steps; ++step)
+	{
+		bool isNewReport = false;
+		bool relayWanted = relayOn;
+
+		//Sensor side: send on significant change or on heartbeat
+		sinceRead += SIM_STEP;
+		sinceSent += SIM_STEP;
+		if (sinceRead >= SENSOR_READ_INTERVAL)
+		{
+			float value = ThermalPlant_ReadSensor(&plant);
+
+			sinceRead = 0;
+			if (!hasReport || (fabsf(value - lastSent) > SENSOR_READ_DELTA) || (sinceSent >= SENSOR_HEARTBEAT))
+			{
+				lastSent = value;
+				reported = value;
+				sinceSent = 0;
+				hasReport = true;
+				isNewReport = true;
+				result->reports++;
+			}
+		}
+
+		//Controller side
+		if (hasReport)
+		{
+			if (mode == SimMode_Threshold)
+			{
+				if (isNewReport)
+				{
+					relayWanted = (reported <= setpoint);
+				}
+			}
+			else
+			{
+				relayWanted = ZoneControl_Tick(&zone, gains, setpoint, reported, ZoneDirection_Raise, relayOn);
+			}
+		}
+
+		if (relayWanted != relayOn)
+		{
+			relayOn = relayWanted;
+			if (step >= warmUpSteps)
+			{
+				result->transitions++;
+			}
+		}
+
+		ThermalPlant_Step(&plant, relayOn, SIM_STEP / 1000.0f);
+
+		if (step >= warmUpSteps)
+		{
+			float error = plant.airTemperature - setpoint;
+
+			result->sumAbsError += fabsf(error);
+			result->sumSquareError += error * error;
+			if (error > result->maxOvershoot)
+			{
+				result->maxOvershoot = error;
+			}
+			if (error < result->maxUndershoot)
+			{
+				result->maxUndershoot = error;
+			}
+			result->onSeconds += relayOn ? SIM_STEP / 1000 : 0;
+			result->samples++;
+		}
+	}
+}
+
+static void PrintResult(const char *name, const SimResult *result)
+{
+	double hours = result->samples * (SIM_STEP / 1000.0) / 3600.0;
+
+	printf("%-10s %9.3f %9.3f %9.2f %9.2f %12.1f %7.1f%%\n", name,
+			result->sumAbsError / result->samples,
+			sqrt(result->sumSquareError / result->samples),
+			result->maxOvershoot,
+			result->maxUndershoot,
+			result->transitions / hours,
+			100.0 * result->onSeconds / (result->samples * (SIM_STEP / 1000.0)));
+}
+
+int main(int argc, char *argv[])
+{
+	PidGains gains = { 0.25f, 0.0005f, 0.0f };
+	unsigned int window = 120000;
+	float setpoint = 21.0f;
+	double hours = 48.0;
+	SimResult result;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "p:i:d:w:t:s:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'p': gains.kp = atof(optarg); break;
+			case 'i': gains.ki = atof(optarg); break;
+			case 'd': gains.kd = atof(optarg); break;
+			case 'w': window = strtoul(optarg, NULL, 10); break;
+			case 't': hours = atof(optarg); break;
+			case 's': setpoint = atof(optarg); break;
+			default:
+				fprintf(stderr, "Usage: %s [-p kp] [-i ki] [-d kd] [-w window ms] [-t hours] [-s setpoint]\n", argv[0]);
+				return 1;
+		}
+	}
+
+	if ((window < SIM_STEP) || (hours <= WARM_UP_HOURS))
+	{
+		fprintf(stderr, "Window must be at least %u ms and duration above %.0f hours\n", SIM_STEP, WARM_UP_HOURS);
+		return 1;
+	}
+
+	printf("setpoint %.2f, %.0f hours (first %.0f ignored), kp %.4f ki %.6f kd %.4f, window %u ms\n",
+			setpoint, hours, WARM_UP_HOURS, gains.kp, gains.ki, gains.kd, window);
+	printf("%-10s %9s %9s %9s %9s %12s %8s\n", "mode", "mean|err|", "rms err", "overshoot", "undershoot", "switches/h", "duty");
+
+	RunSimulation(SimMode_Threshold, &gains, window, setpoint, hours, &result);
+	PrintResult("threshold", &result);
+	RunSimulation(SimMode_Pid, &gains, window, setpoint, hours, &result);
+	PrintResult("pid", &result);
+	return 0;
+}
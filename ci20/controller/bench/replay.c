@@ -0,0 +1,576 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/**
+ * Deterministic replay of a message trace captured on a controller
+ * (flowclimatecontroller ... TRACE file) through the controller logic,
+ * built for the host against the offline FlowCloud stand-in.
+ *
+ * The virtual clock starts at the trace's wall clock time and is moved
+ * to each record's time before it is injected, so timers (heartbeats,
+ * control ticks, device expiry) fire as they did on the controller.
+ * Received messages and settings reads are injected as controller events;
+ * messages sent by the controller are compared to the recorded ones,
+ * ignoring their <time> elements.
+ *
+ * Usage: replay [-r] [-n repeat] [-d max diffs] trace
+ *   -r  replay at recorded pace, instead of as fast as possible
+ *   -n  replay trace this many times, for a steadier rate
+ *   -d  number of differences to print
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "flow/flowcore.h"
+#include "controller.h"
+#include "flow_interface.h"
+#include "message_trace.h"
+#include "flow_stub.h"
+
+#define QUEUE_SIZE (64)
+#define MATCH_WINDOW (32)	//Outbound messages searched for a match, either way
+#define SETTING_PEER "ControllerConfig"
+
+typedef enum
+{
+	Stage_Inject,	//Copy payload into a controller event
+	Stage_Handle,	//Parse message or settings, run control logic
+	Stage_Timers,	//Move virtual clock, handle timer events
+	Stage_Dispatch,	//Take commands posted for flow thread
+	Stage_Max
+}Stage_Type;
+
+static const char *_StageNames[Stage_Max] = { "inject", "handle", "timers", "dispatch" };
+
+typedef struct
+{
+	uint64_t time;
+	MessageTrace_Direction direction;
+	char *peer;
+	char *content;
+}Payload;
+
+typedef struct
+{
+	Payload *items;
+	size_t count;
+	size_t capacity;
+}PayloadList;
+
+typedef struct
+{
+	double *samples;	//seconds
+	size_t count;
+	size_t capacity;
+}Latencies;
+
+static Latencies _latencies[Stage_Max];
+static PayloadList _produced;
+
+static double NowSeconds(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void *Grow(void *items, size_t *capacity, size_t itemSize)
+{
+	void *grown;
+
+	*capacity = *capacity ? *capacity * 2 : 1024;
+	grown = realloc(items, *capacity * itemSize);
+	if (!grown)
+	{
+		fprintf(stderr, "Out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	return grown;
+}
+
+static void AddLatency(Stage_Type stage, double start)
+{
+	Latencies *latencies = &_latencies[stage];
+
+	if (latencies->count == latencies->capacity)
+	{
+		latencies->samples = Grow(latencies->samples, &latencies->capacity, sizeof(double));
+	}
+	latencies->samples[latencies->count++] = NowSeconds() - start;
+}
+
+static char *Duplicate(const char *value)
+{
+	char *copy = strdup(value ? value : "");
+
+	if (!copy)
+	{
+		fprintf(stderr, "Out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	return copy;
+}
+
+/**
+ * Copy of content without <time ...>...</time> elements, which differ
+ * between capture and replay.
+ */
+static char *Normalise(const char *content)
+{
+	char *normal = Duplicate(content);
+	char *start;
+
+	while ((start = strstr(normal, "<time")) != NULL)
+	{
+		char *end = strstr(start, "</time>");
+
+		if (!end)
+		{
+			break;
+		}
+		memmove(start, end + strlen("</time>"), strlen(end + strlen("</time>")) + 1);
+	}
+	return normal;
+}
+
+static void AddPayload(PayloadList *list, uint64_t time, MessageTrace_Direction direction, const char *peer, const char *content)
+{
+	Payload *payload;
+
+	if (list->count == list->capacity)
+	{
+		list->items = Grow(list->items, &list->capacity, sizeof(Payload));
+	}
+	payload = &list->items[list->count++];
+	payload->time = time;
+	payload->direction = direction;
+	payload->peer = Duplicate(peer);
+	payload->content = (direction == MessageTrace_Received || direction == MessageTrace_SettingRead ||
+						direction == MessageTrace_Identity) ? Duplicate(content) : Normalise(content);
+}
+
+static void FreePayloads(PayloadList *list)
+{
+	size_t i;
+
+	for (i = 0; i < list->count; ++i)
+	{
+		free(list->items[i].peer);
+		free(list->items[i].content);
+	}
+	list->count = 0;
+}
+
+static bool IsOutbound(MessageTrace_Direction direction)
+{
+	return (direction == MessageTrace_Sent) || (direction == MessageTrace_SettingWrite);
+}
+
+/**
+ * Stand in for flow thread: take posted commands and keep what would
+ * have been sent, addressed the way FlowInterfaceThread() does.
+ */
+static void Dispatch(Controller *me, uint64_t time)
+{
+	FlowInterfaceCmd *cmd;
+	double start = NowSeconds();
+
+	while ((cmd = FlowQueue_DequeueWaitFor(me->sendMsgQueue, 0)) != NULL)
+	{
+		const char *peer = NULL;
+		MessageTrace_Direction direction = MessageTrace_Sent;
+
+		switch (cmd->cmdType)
+		{
+			case FlowInterfaceCmd_SendMessageToUser: peer = me->userId; break;
+			case FlowInterfaceCmd_SendMessageToActuator: peer = me->actuatorConfig.actuatorId; break;
+			case FlowInterfaceCmd_SendMessageToSensor: peer = me->sensorConfig.sensorId; break;
+			case FlowInterfaceCmd_SetSetting: peer = SETTING_PEER; direction = MessageTrace_SettingWrite; break;
+			default: break;	//Settings reads are injected from trace
+		}
+		if (peer && cmd->details)
+		{
+			AddPayload(&_produced, time, direction, peer, cmd->details);
+		}
+		Flow_MemFree(&cmd->details);
+		Flow_MemFree((void **)&cmd);
+	}
+	AddLatency(Stage_Dispatch, start);
+}
+
+static void HandleEvent(Controller *me, ControllerEvent_Type evtType, void *details, double start)
+{
+	ControllerEvent *event = Flow_MemAlloc(sizeof(ControllerEvent));
+
+	event->evtType = evtType;
+	event->details = details;
+	AddLatency(Stage_Inject, start);
+
+	start = NowSeconds();
+	ControllerHandleEvent(me, event);
+	AddLatency(Stage_Handle, start);
+}
+
+/**
+ * Move virtual clock to time, handling timer events on the way
+ */
+static void AdvanceTo(Controller *me, uint64_t *now, uint64_t time)
+{
+	ControllerEvent *event;
+	double start = NowSeconds();
+
+	if (time / 1000 > *now / 1000)
+	{
+		FlowStub_AdvanceTime((unsigned int)(time / 1000 - *now / 1000));
+	}
+	*now = time;
+	while ((event = FlowQueue_DequeueWaitFor(me->receiveMsgQueue, 0)) != NULL)
+	{
+		ControllerHandleEvent(me, event);
+	}
+	AddLatency(Stage_Timers, start);
+}
+
+static void SetIdentity(char **id, const char *value)
+{
+	*id = Flow_MemAlloc(MAX_SIZE);
+	snprintf(*id, MAX_SIZE, "%s", value);
+}
+
+/**
+ * Replay trace through a new controller. Controller is not freed, as its
+ * history threads keep running till exit.
+ */
+static void Replay(const PayloadList *trace, time_t epoch, bool isPaced)
+{
+	Controller *me = malloc(sizeof(Controller));
+	double wallStart = NowSeconds();
+	uint64_t now = 0;
+	size_t i;
+
+	FlowStub_Reset();
+	FlowStub_UseVirtualTime(epoch);
+	ControllerSetDefaults(me);
+	me->stateDir = ".";	//Scratch directory make runs this in
+	me->sendMsgQueue = FlowQueue_NewBlocking(QUEUE_SIZE);
+	me->receiveMsgQueue = FlowQueue_NewBlocking(QUEUE_SIZE);
+
+	for (i = 0; (i < trace->count) && (trace->items[i].direction == MessageTrace_Identity); ++i)
+	{
+		const Payload *payload = &trace->items[i];
+
+		if (strcmp(payload->content, TRACE_USER_STR) == 0)
+		{
+			snprintf(me->userId, sizeof(me->userId), "%s", payload->peer);
+		}
+		else if (strcmp(payload->content, TRACE_SENSOR_STR) == 0)
+		{
+			SetIdentity(&me->sensorConfig.sensorId, payload->peer);
+		}
+		else if (strcmp(payload->content, TRACE_ACTUATOR_STR) == 0)
+		{
+			SetIdentity(&me->actuatorConfig.actuatorId, payload->peer);
+		}
+	}
+
+	ControllerStart(me);
+	Dispatch(me, 0);
+
+	for (; i < trace->count; ++i)
+	{
+		const Payload *payload = &trace->items[i];
+		double start;
+
+		if (IsOutbound(payload->direction) || (payload->direction == MessageTrace_Identity))
+		{
+			continue;
+		}
+
+		if (isPaced)
+		{
+			double delay = wallStart + payload->time / 1e6 - NowSeconds();
+
+			if (delay > 0.0)
+			{
+				usleep((useconds_t)(delay * 1e6));
+			}
+		}
+
+		AdvanceTo(me, &now, payload->time);
+		Dispatch(me, now);
+
+		start = NowSeconds();
+		if (payload->direction == MessageTrace_Received)
+		{
+			ReceivedMessage *message = Flow_MemAlloc(sizeof(ReceivedMessage));
+
+			message->sendorId = FlowString_Duplicate(payload->peer);
+			message->data = FlowString_Duplicate(payload->content);
+			HandleEvent(me, ControllerEvent_ReceivedMessage, message, start);
+		}
+		else if (payload->content[0] != '\0')
+		{
+			HandleEvent(me, ControllerEvent_SettingSuccess, FlowString_Duplicate(payload->content), start);
+		}
+		else
+		{
+			HandleEvent(me, ControllerEvent_SettingFailure, NULL, start);
+		}
+		Dispatch(me, now);
+	}
+}
+
+static bool IsSamePayload(const Payload *a, const Payload *b)
+{
+	return (a->direction == b->direction) && (strcmp(a->peer, b->peer) == 0) && (strcmp(a->content, b->content) == 0);
+}
+
+static void PrintDiff(char sign, const Payload *payload, unsigned int *printed, unsigned int maxDiffs)
+{
+	if (*printed < maxDiffs)
+	{
+		printf("%c %10.3f s %s %s\n", sign, payload->time / 1e6, payload->peer, payload->content);
+	}
+	(*printed)++;
+}
+
+/**
+ * Offset of the first payload equal to wanted among the next few in list,
+ * or MATCH_WINDOW if none.
+ */
+static size_t FindAhead(const Payload *wanted, Payload * const *list, size_t count)
+{
+	size_t ahead;
+
+	for (ahead = 1; (ahead < MATCH_WINDOW) && (ahead < count); ++ahead)
+	{
+		if (IsSamePayload(wanted, list[ahead]))
+		{
+			return ahead;
+		}
+	}
+	return MATCH_WINDOW;
+}
+
+/**
+ * Align replayed outbound payloads with recorded ones, looking a few
+ * messages ahead on either side, as timer driven messages may interleave
+ * differently around injected ones.
+ */
+static void Compare(const PayloadList *trace, unsigned int maxDiffs)
+{
+	Payload **recorded = malloc(sizeof(Payload *) * (trace->count + 1));
+	Payload **produced = malloc(sizeof(Payload *) * (_produced.count + 1));
+	size_t numRecorded = 0, r = 0, p = 0, i;
+	unsigned long matched = 0, missing = 0, extra = 0;
+	unsigned int printed = 0;
+
+	for (i = 0; i < trace->count; ++i)
+	{
+		if (IsOutbound(trace->items[i].direction))
+		{
+			recorded[numRecorded++] = &trace->items[i];
+		}
+	}
+	for (i = 0; i < _produced.count; ++i)
+	{
+		produced[i] = &_produced.items[i];
+	}
+
+	while ((r < numRecorded) && (p < _produced.count))
+	{
+		size_t extraAhead, missingAhead;
+
+		if (IsSamePayload(recorded[r], produced[p]))
+		{
+			matched++;
+			r++;
+			p++;
+			continue;
+		}
+
+		extraAhead = FindAhead(recorded[r], produced + p, _produced.count - p);
+		missingAhead = FindAhead(produced[p], recorded + r, numRecorded - r);
+		if ((extraAhead < MATCH_WINDOW) && (extraAhead <= missingAhead))
+		{
+			for (i = 0; i < extraAhead; ++i, ++extra)
+			{
+				PrintDiff('+', produced[p++], &printed, maxDiffs);
+			}
+		}
+		else if (missingAhead < MATCH_WINDOW)
+		{
+			for (i = 0; i < missingAhead; ++i, ++missing)
+			{
+				PrintDiff('-', recorded[r++], &printed, maxDiffs);
+			}
+		}
+		else
+		{
+			PrintDiff('-', recorded[r++], &printed, maxDiffs);
+			PrintDiff('+', produced[p++], &printed, maxDiffs);
+			missing++;
+			extra++;
+		}
+	}
+	for (; r < numRecorded; ++r, ++missing)
+	{
+		PrintDiff('-', recorded[r], &printed, maxDiffs);
+	}
+	for (; p < _produced.count; ++p, ++extra)
+	{
+		PrintDiff('+', produced[p], &printed, maxDiffs);
+	}
+
+	if (printed > maxDiffs)
+	{
+		printf("... %u more differences\n", printed - maxDiffs);
+	}
+	printf("outbound    %lu recorded, %lu replayed: %lu matched, %lu missing (-), %lu extra (+)\n",
+			(unsigned long)numRecorded, (unsigned long)_produced.count, matched, missing, extra);
+	free(recorded);
+	free(produced);
+}
+
+static int CompareDouble(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+static double Percentile(const Latencies *latencies, double percentile)
+{
+	size_t index = (size_t)(percentile / 100.0 * (latencies->count - 1) + 0.5);
+
+	return latencies->samples[index];
+}
+
+static void PrintLatencies(void)
+{
+	unsigned int stage;
+
+	printf("stage         count     p50 us     p95 us     p99 us     max us\n");
+	for (stage = 0; stage < Stage_Max; ++stage)
+	{
+		Latencies *latencies = &_latencies[stage];
+
+		if (latencies->count == 0)
+		{
+			continue;
+		}
+		qsort(latencies->samples, latencies->count, sizeof(double), CompareDouble);
+		printf("%-10s %8lu %10.2f %10.2f %10.2f %10.2f\n", _StageNames[stage], (unsigned long)latencies->count,
+				Percentile(latencies, 50.0) * 1e6, Percentile(latencies, 95.0) * 1e6,
+				Percentile(latencies, 99.0) * 1e6, latencies->samples[latencies->count - 1] * 1e6);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	MessageTraceReader reader;
+	MessageTraceRecord record;
+	PayloadList trace = { NULL, 0, 0 };
+	unsigned int repeat = 1, maxDiffs = 20, run;
+	unsigned long injected = 0;
+	bool isPaced = false;
+	double start, elapsed;
+	size_t i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "rn:d:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'r': isPaced = true; break;
+			case 'n': repeat = strtoul(optarg, NULL, 10); break;
+			case 'd': maxDiffs = strtoul(optarg, NULL, 10); break;
+			default:
+				fprintf(stderr, "Usage: %s [-r] [-n repeat] [-d max diffs] trace\n", argv[0]);
+				return 1;
+		}
+	}
+	if ((optind >= argc) || (repeat == 0))
+	{
+		fprintf(stderr, "Usage: %s [-r] [-n repeat] [-d max diffs] trace\n", argv[0]);
+		return 1;
+	}
+
+	if (!MessageTraceReader_Open(&reader, argv[optind]))
+	{
+		fprintf(stderr, "Opening trace %s failed\n", argv[optind]);
+		return 1;
+	}
+	while (MessageTraceReader_Next(&reader, &record))
+	{
+		AddPayload(&trace, record.time, record.direction, record.peer, record.content);
+		if ((record.direction == MessageTrace_Received) || (record.direction == MessageTrace_SettingRead))
+		{
+			injected++;
+		}
+	}
+
+	printf("trace %s: %lu records, %lu injected, %.1f s recorded, %s\n", argv[optind], (unsigned long)trace.count,
+			injected, trace.count ? trace.items[trace.count - 1].time / 1e6 : 0.0,
+			isPaced ? "recorded pace" : "as fast as possible");
+
+	//Every run starts from a fresh controller; only the last run is compared
+	start = NowSeconds();
+	for (run = 0; run < repeat; ++run)
+	{
+		FreePayloads(&_produced);
+		Replay(&trace, (time_t)reader.startEpoch, isPaced);
+	}
+	elapsed = NowSeconds() - start;
+
+	printf("rate        %10.0f events/s, %.3f s for %u run(s)\n", injected * repeat / elapsed, elapsed, repeat);
+	PrintLatencies();
+	Compare(&trace, maxDiffs);
+
+	FreePayloads(&trace);
+	free(trace.items);
+	FreePayloads(&_produced);
+	free(_produced.items);
+	for (i = 0; i < Stage_Max; ++i)
+	{
+		free(_latencies[i].samples);
+	}
+	MessageTraceReader_Close(&reader);
+	return 0;
+}
@@ -0,0 +1,106 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include <math.h>
+
+#include "thermal_plant.h"
+
+#define SECONDS_PER_DAY (86400.0)
+#define SENSOR_RESOLUTION (0.01f)
+
+const ThermalPlantParams ThermalPlant_DefaultRoom =
+{
+	.airCapacity = 150000.0f,
+	.wallCapacity = 2000000.0f,
+	.airToWall = 100.0f,
+	.airToOutside = 40.0f,
+	.wallToOutside = 25.0f,
+	.heaterPower = 1500.0f,
+	.heaterLag = 300.0f,
+	.outsideMean = 8.0f,
+	.outsideSwing = 4.0f,
+	.sensorNoise = 0.05f,
+};
+
+/**
+ * Linear congruential generator, so that runs are repeatable on any host
+ */
+static float NextNoise(ThermalPlant *plant)
+{
+	plant->seed = plant->seed * 1664525u + 1013904223u;
+	return ((plant->seed >> 8) / (float)(1u << 24)) * 2.0f - 1.0f;
+}
+
+void ThermalPlant_Init(ThermalPlant *plant, const ThermalPlantParams *params, float initialTemperature, uint32_t seed)
+{
+	plant->params = *params;
+	plant->airTemperature = initialTemperature;
+	plant->wallTemperature = initialTemperature;
+	plant->heaterOutput = 0.0f;
+	plant->time = 0.0;
+	plant->seed = seed;
+}
+
+float ThermalPlant_OutsideTemperature(const ThermalPlant *plant)
+{
+	return plant->params.outsideMean +
+		plant->params.outsideSwing * (float)sin(2.0 * M_PI * plant->time / SECONDS_PER_DAY);
+}
+
+/**
+ * Advance model by dt seconds (explicit Euler, keep dt well below heaterLag)
+ */
+void ThermalPlant_Step(ThermalPlant *plant, bool isHeaterOn, float dt)
+{
+	const ThermalPlantParams *p = &plant->params;
+	float outside = ThermalPlant_OutsideTemperature(plant);
+	float airToWall = p->airToWall * (plant->airTemperature - plant->wallTemperature);
+	float airToOutside = p->airToOutside * (plant->airTemperature - outside);
+	float wallToOutside = p->wallToOutside * (plant->wallTemperature - outside);
+
+	plant->heaterOutput += ((isHeaterOn ? 1.0f : 0.0f) - plant->heaterOutput) * dt / p->heaterLag;
+	plant->airTemperature += (p->heaterPower * plant->heaterOutput - airToWall - airToOutside) * dt / p->airCapacity;
+	plant->wallTemperature += (airToWall - wallToOutside) * dt / p->wallCapacity;
+	plant->time += dt;
+}
+
+/**
+ * Noisy reading, quantised to what sensor reports
+ */
+float ThermalPlant_ReadSensor(ThermalPlant *plant)
+{
+	float value = plant->airTemperature + plant->params.sensorNoise * NextNoise(plant);
+
+	return roundf(value / SENSOR_RESOLUTION) * SENSOR_RESOLUTION;
+}
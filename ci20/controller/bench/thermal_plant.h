@@ -0,0 +1,88 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef THERMAL_PLANT_H
+#define THERMAL_PLANT_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Deterministic two-node thermal model of a heated room, used for tuning
+ * zone control offline. Room air exchanges heat with the walls and the
+ * outside, walls exchange heat with the outside. Heater output follows
+ * its relay through a first-order lag (e.g. oil filled radiator), which
+ * is what makes bang-bang control overshoot.
+ */
+
+typedef struct
+{
+	float airCapacity;	//J/K
+	float wallCapacity;	//J/K
+	float airToWall;	//W/K
+	float airToOutside;	//W/K
+	float wallToOutside;	//W/K
+	float heaterPower;	//W
+	float heaterLag;	//seconds
+	float outsideMean;	//degree centigrade
+	float outsideSwing;	//degree centigrade, daily swing amplitude
+	float sensorNoise;	//degree centigrade, peak
+}ThermalPlantParams;
+
+typedef struct
+{
+	ThermalPlantParams params;
+	float airTemperature;
+	float wallTemperature;
+	float heaterOutput;	//0..1
+	double time;	//seconds
+	uint32_t seed;
+}ThermalPlant;
+
+extern const ThermalPlantParams ThermalPlant_DefaultRoom;
+
+void ThermalPlant_Init(ThermalPlant *plant, const ThermalPlantParams *params, float initialTemperature, uint32_t seed);
+void ThermalPlant_Step(ThermalPlant *plant, bool isHeaterOn, float dt);
+float ThermalPlant_OutsideTemperature(const ThermalPlant *plant);
+float ThermalPlant_ReadSensor(ThermalPlant *plant);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* THERMAL_PLANT_H */
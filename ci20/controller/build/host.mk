@@ -0,0 +1,219 @@
+# Offline host build: controller core and adapter against the FlowCloud
+# stand-in in ../host, so that tests and benchmarks run on a PC without
+# the SDK, a network or a board.
+#
+#   make host       controller binary running against the stand-in
+#   make host-test  unit and controller tests
+#   make bench      host benchmarks
+#   make replay     replay a captured message trace (TRACE=file)
+#   make fleet-load controller under an emulated fleet of devices
+#   make microbench construct/parse micro benchmarks, saved as JSON
+#   make firmware-host   WiFire sensor and actuator firmware built for host
+#   make firmware-fleet  controller against a fleet of firmware processes
+
+DIR__HOST:=$(DIR__BUILD)/../host
+DIR__TEST:=$(DIR__BUILD)/../test
+DIR__HOST_OBJ:=$(DIR__BUILD)/host$(if $(ALLOC_PROFILE),-profile)
+
+HOST_AR ?= ar
+HOST_CFLAGS:=-std=gnu99 -DPOSIX=1 -O2 -g -Wall -MMD -MP
+HOST_INCLUDES:=-I"$(DIR__SRC)" -I"$(DIR__COMMON)/include" -I"$(DIR__HOST)/include"
+HOST_LIBS:=-lpthread -lm
+
+STUB_SRC:=$(addprefix $(DIR__HOST)/,	\
+	flow_stub_core.c \
+	flow_stub_timer.c \
+	flow_stub_xml.c \
+	flow_stub_cloud.c \
+)
+
+HOST_CORE_OBJ:=$(patsubst $(DIR__SRC)/%.c,$(DIR__HOST_OBJ)/src/%.o,$(CORE_SRC)) \
+	$(patsubst $(DIR__COMMON)/src/%.c,$(DIR__HOST_OBJ)/common/%.o,$(COMMON_SRC))
+HOST_ADAPTER_OBJ:=$(patsubst $(DIR__SRC)/%.c,$(DIR__HOST_OBJ)/src/%.o,$(ADAPTER_SRC))
+HOST_STUB_OBJ:=$(patsubst $(DIR__HOST)/%.c,$(DIR__HOST_OBJ)/stub/%.o,$(STUB_SRC))
+HOST_CORE_LIB:=$(DIR__HOST_OBJ)/libclimatecore.a
+HOST_STUB_LIB:=$(DIR__HOST_OBJ)/libflowstub.a
+HOST_BINARY:=$(DIR__BIN)/flowclimatecontroller.host.bin
+
+TEST_SRC:=$(wildcard $(DIR__TEST)/test_*.c)
+TEST_BIN:=$(patsubst $(DIR__TEST)/%.c,$(DIR__HOST_OBJ)/test/%,$(TEST_SRC))
+CONTROLLER_BENCH:=$(DIR__BIN)/controller_bench.$(ARCH)
+
+HOST_DEP:=$(HOST_CORE_OBJ:.o=.d) $(HOST_ADAPTER_OBJ:.o=.d) $(HOST_STUB_OBJ:.o=.d)
+ifneq ($(MAKECMDGOALS),clean)
+-include $(HOST_DEP)
+endif
+
+.PHONY: host host-test bench controller-bench replay fleet-load microbench filter-bench firmware-host firmware-fleet
+
+$(DIR__HOST_OBJ)/src/%.o: $(DIR__SRC)/%.c
+	mkdir -p $(dir $@)
+	$(HOSTCC) $(HOST_CFLAGS) $(ALLOC_PROFILE_CFLAGS) $(HOST_INCLUDES) -c -o "$@" "$<"
+
+$(DIR__HOST_OBJ)/common/%.o: $(DIR__COMMON)/src/%.c
+	mkdir -p $(dir $@)
+	$(HOSTCC) $(HOST_CFLAGS) $(ALLOC_PROFILE_CFLAGS) $(HOST_INCLUDES) -c -o "$@" "$<"
+
+$(DIR__HOST_OBJ)/stub/%.o: $(DIR__HOST)/%.c
+	mkdir -p $(dir $@)
+	$(HOSTCC) $(HOST_CFLAGS) $(HOST_INCLUDES) -c -o "$@" "$<"
+
+$(HOST_CORE_LIB): $(HOST_CORE_OBJ)
+	$(RM) "$@"
+	$(HOST_AR) rcs "$@" $^
+
+$(HOST_STUB_LIB): $(HOST_STUB_OBJ)
+	$(RM) "$@"
+	$(HOST_AR) rcs "$@" $^
+
+host: $(HOST_BINARY)
+
+$(HOST_BINARY): $(HOST_ADAPTER_OBJ) $(HOST_CORE_LIB) $(HOST_STUB_LIB)
+	mkdir -p $(dir $@)
+	$(HOSTCC) -o "$@" $(HOST_ADAPTER_OBJ) $(HOST_CORE_LIB) $(HOST_STUB_LIB) $(HOST_LIBS)
+
+# Each test is a standalone program, run in its own scratch directory. Tests
+# starting a controller give it a state directory under TMPDIR, and benchmarks
+# use the scratch directory, for its history, settings cache and socket.
+$(DIR__HOST_OBJ)/test/%: $(DIR__TEST)/%.c $(DIR__TEST)/test.h $(HOST_CORE_LIB) $(HOST_STUB_LIB)
+	mkdir -p $(dir $@)
+	$(HOSTCC) $(HOST_CFLAGS) $(HOST_INCLUDES) -I"$(DIR__TEST)" $(TEST_INCLUDES) -o "$@" "$<" $(TEST_OBJ) $(HOST_CORE_LIB) $(HOST_STUB_LIB) $(HOST_LIBS)
+
+host-test: $(TEST_BIN)
+	@failed=0; \
+	for test in $(TEST_BIN); do \
+		dir=$$(mktemp -d); \
+		if (cd $$dir && $$test); then echo "PASS $$(basename $$test)"; \
+		else echo "FAIL $$(basename $$test)"; failed=1; fi; \
+		rm -rf $$dir; \
+	done; \
+	exit $$failed
+
+# Controller event handling throughput against the stand-in
+controller-bench: $(CONTROLLER_BENCH)
+	dir=$$(mktemp -d); (cd $$dir && $(CONTROLLER_BENCH)); status=$$?; rm -rf $$dir; exit $$status
+
+$(CONTROLLER_BENCH): $(DIR__BENCH)/controller_bench.c $(HOST_CORE_LIB) $(HOST_STUB_LIB)
+	mkdir -p $(dir $@)
+	$(HOSTCC) $(HOST_CFLAGS) $(HOST_INCLUDES) -o "$@" "$<" $(HOST_CORE_LIB) $(HOST_STUB_LIB) $(HOST_LIBS)
+
+bench: pid-sim history-bench history-load controller-bench microbench filter-bench
+
+# Replay a captured message trace, e.g. make replay TRACE=messages.trace REPLAY_FLAGS=-r
+REPLAY:=$(DIR__BIN)/replay.$(ARCH)
+TRACE_PATH=$(abspath $(TRACE))
+
+replay: $(REPLAY)
+	@test -n "$(TRACE)" || (echo "Usage: make replay TRACE=file [REPLAY_FLAGS=...]"; exit 1)
+	dir=$$(mktemp -d); (cd $$dir && $(REPLAY) $(REPLAY_FLAGS) "$(TRACE_PATH)"); status=$$?; rm -rf $$dir; exit $$status
+
+$(REPLAY): $(DIR__BENCH)/replay.c $(HOST_CORE_LIB) $(HOST_STUB_LIB)
+	mkdir -p $(dir $@)
+	$(HOSTCC) $(HOST_CFLAGS) $(HOST_INCLUDES) -o "$@" "$<" $(HOST_CORE_LIB) $(HOST_STUB_LIB) $(HOST_LIBS)
+
+# Controller under an emulated fleet of sensors and actuators, e.g. make fleet-load FLEET_FLAGS="-N 10000"
+FLEET_LOAD:=$(DIR__BIN)/fleet_load.$(ARCH)
+HOST_FLOW_OBJ:=$(filter-out %/main.o %/console.o,$(HOST_ADAPTER_OBJ))
+
+fleet-load: $(FLEET_LOAD)
+	dir=$$(mktemp -d); (cd $$dir && $(FLEET_LOAD) $(FLEET_FLAGS)); status=$$?; rm -rf $$dir; exit $$status
+
+$(FLEET_LOAD): $(DIR__BENCH)/fleet_load.c $(HOST_FLOW_OBJ) $(HOST_CORE_LIB) $(HOST_STUB_LIB)
+	mkdir -p $(dir $@)
+	$(HOSTCC) $(HOST_CFLAGS) $(HOST_INCLUDES) -o "$@" "$<" $(HOST_FLOW_OBJ) $(HOST_CORE_LIB) $(HOST_STUB_LIB) $(HOST_LIBS)
+
+# Construct/parse micro benchmarks, with the WiFire firmware's message builders
+# built from its sources against the stand-in, e.g. make microbench
+# MICROBENCH_JSON=new.json, then bench/compare_bench.py old.json new.json
+DIR__WIFIRE:=$(DIR__BUILD)/../../../wifire
+MICRO_BENCH:=$(DIR__BIN)/micro_bench.$(ARCH)
+MICROBENCH_JSON ?= $(DIR__HOST_OBJ)/micro_bench.json
+MICROBENCH_PATH=$(abspath $(MICROBENCH_JSON))
+FIRMWARE_HOST_OBJ:=$(addprefix $(DIR__HOST_OBJ)/firmware/,freertos_queue.o adc_sim.o ports_sim.o)
+FIRMWARE_COMMON_OBJ:=$(addprefix $(DIR__HOST_OBJ)/firmware/,message_template.o wire_format.o climate_proto.o \
+	queue_wrapper.o send_message.o sample_buffer.o flow_interface.o) $(FIRMWARE_HOST_OBJ)
+FIRMWARE_BENCH_OBJ:=$(addprefix $(DIR__HOST_OBJ)/firmware/,firmware_sensor.o firmware_actuator.o firmware_stubs.o \
+	sensor_adc.o adc_scan.o sensor_filter.o sample_schedule.o sensor_dht.o dht_decoder.o dht_sim.o relay.o \
+	sensor_thermistor.o ntc_table.o sensor_calibration.o) $(FIRMWARE_COMMON_OBJ)
+# Host headers come first, as some wrap or stand in for the board's
+FIRMWARE_INCLUDES:=-I"$(DIR__WIFIRE)/host/include" -I"$(DIR__HOST)/include" -I"$(DIR__WIFIRE)/common/include" \
+	-I"$(DIR__WIFIRE)/sensor/include" -I"$(DIR__WIFIRE)/actuator/include" -I"$(DIR__WIFIRE)/sensor/src" -I"$(DIR__WIFIRE)/actuator/src"
+FIRMWARE_CFLAGS:=$(HOST_CFLAGS) -DUSE_ADC_SENSOR
+ifneq ($(MAKECMDGOALS),clean)
+-include $(wildcard $(DIR__HOST_OBJ)/firmware/*.d)
+endif
+
+# Conformance tests exchange messages with the firmware, built as for micro_bench,
+# and the firmware's queues and HAL are tested on the POSIX backend
+$(DIR__HOST_OBJ)/test/test_climate_proto: $(FIRMWARE_BENCH_OBJ)
+$(DIR__HOST_OBJ)/test/test_climate_proto: TEST_INCLUDES=-I"$(DIR__BENCH)"
+$(DIR__HOST_OBJ)/test/test_climate_proto: TEST_OBJ=$(FIRMWARE_BENCH_OBJ)
+$(DIR__HOST_OBJ)/test/test_firmware_host: $(FIRMWARE_BENCH_OBJ)
+$(DIR__HOST_OBJ)/test/test_firmware_host: TEST_INCLUDES=$(FIRMWARE_INCLUDES)
+$(DIR__HOST_OBJ)/test/test_firmware_host: TEST_OBJ=$(FIRMWARE_BENCH_OBJ)
+
+$(DIR__HOST_OBJ)/firmware/%.o: $(DIR__BENCH)/%.c $(DIR__BENCH)/firmware_bench.h
+	mkdir -p $(dir $@)
+	$(HOSTCC) $(FIRMWARE_CFLAGS) $(FIRMWARE_INCLUDES) -c -o "$@" "$<"
+
+$(DIR__HOST_OBJ)/firmware/%.o: $(DIR__WIFIRE)/common/src/%.c
+	mkdir -p $(dir $@)
+	$(HOSTCC) $(FIRMWARE_CFLAGS) $(FIRMWARE_INCLUDES) -c -o "$@" "$<"
+
+$(DIR__HOST_OBJ)/firmware/%.o: $(DIR__WIFIRE)/sensor/src/%.c
+	mkdir -p $(dir $@)
+	$(HOSTCC) $(FIRMWARE_CFLAGS) $(FIRMWARE_INCLUDES) -c -o "$@" "$<"
+
+$(DIR__HOST_OBJ)/firmware/%.o: $(DIR__WIFIRE)/actuator/src/%.c
+	mkdir -p $(dir $@)
+	$(HOSTCC) $(FIRMWARE_CFLAGS) $(FIRMWARE_INCLUDES) -c -o "$@" "$<"
+
+# POSIX backend of the board: FreeRTOS queues, ADC and ports
+$(DIR__HOST_OBJ)/firmware/%.o: $(DIR__WIFIRE)/host/src/%.c
+	mkdir -p $(dir $@)
+	$(HOSTCC) $(FIRMWARE_CFLAGS) $(FIRMWARE_INCLUDES) -c -o "$@" "$<"
+
+microbench: $(MICRO_BENCH)
+	dir=$$(mktemp -d); (cd $$dir && $(MICRO_BENCH) -o "$(MICROBENCH_PATH)" $(MICROBENCH_FLAGS)); status=$$?; rm -rf $$dir; exit $$status
+
+$(MICRO_BENCH): $(DIR__BENCH)/micro_bench.c $(FIRMWARE_BENCH_OBJ) $(HOST_CORE_LIB) $(HOST_STUB_LIB)
+	mkdir -p $(dir $@)
+	$(HOSTCC) $(HOST_CFLAGS) $(HOST_INCLUDES) -o "$@" "$<" $(FIRMWARE_BENCH_OBJ) $(HOST_CORE_LIB) $(HOST_STUB_LIB) $(HOST_LIBS)
+
+# Sensor reading filters against raw ADC traces, e.g. make filter-bench FILTER_BENCH_FLAGS="-d 0.25 adc.trace"
+FILTER_BENCH:=$(DIR__BIN)/filter_bench.$(ARCH)
+
+filter-bench: $(FILTER_BENCH)
+	$(FILTER_BENCH) $(FILTER_BENCH_FLAGS)
+
+$(FILTER_BENCH): $(DIR__BENCH)/filter_bench.c $(FIRMWARE_BENCH_OBJ) $(HOST_CORE_LIB) $(HOST_STUB_LIB)
+	mkdir -p $(dir $@)
+	$(HOSTCC) $(HOST_CFLAGS) $(HOST_INCLUDES) -o "$@" "$<" $(FIRMWARE_BENCH_OBJ) $(HOST_CORE_LIB) $(HOST_STUB_LIB) $(HOST_LIBS)
+
+# WiFire sensor and actuator firmware built for host from the same sources,
+# one device per process as the firmware keeps its state in statics
+SENSOR_HOST_BINARY:=$(DIR__BIN)/flowclimatesensor.host.bin
+ACTUATOR_HOST_BINARY:=$(DIR__BIN)/flowclimateactuator.host.bin
+SENSOR_HOST_OBJ:=$(addprefix $(DIR__HOST_OBJ)/firmware/,climate_sensor.o climate_sensor_main.o sensor_adc.o adc_scan.o sensor_filter.o sample_schedule.o \
+	sensor_calibration.o device_main.o) $(FIRMWARE_COMMON_OBJ)
+ACTUATOR_HOST_OBJ:=$(addprefix $(DIR__HOST_OBJ)/firmware/,climate_actuator.o climate_actuator_main.o relay.o device_main.o) $(FIRMWARE_COMMON_OBJ)
+
+firmware-host: $(SENSOR_HOST_BINARY) $(ACTUATOR_HOST_BINARY)
+
+$(SENSOR_HOST_BINARY): $(SENSOR_HOST_OBJ) $(HOST_STUB_LIB)
+	mkdir -p $(dir $@)
+	$(HOSTCC) -o "$@" $(SENSOR_HOST_OBJ) $(HOST_STUB_LIB) $(HOST_LIBS)
+
+$(ACTUATOR_HOST_BINARY): $(ACTUATOR_HOST_OBJ) $(HOST_STUB_LIB)
+	mkdir -p $(dir $@)
+	$(HOSTCC) -o "$@" $(ACTUATOR_HOST_OBJ) $(HOST_STUB_LIB) $(HOST_LIBS)
+
+# Controller against a fleet of firmware processes, e.g. make firmware-fleet FIRMWARE_FLEET_FLAGS="-N 1000"
+FIRMWARE_FLEET:=$(DIR__BIN)/firmware_fleet.$(ARCH)
+
+firmware-fleet: $(FIRMWARE_FLEET) firmware-host
+	dir=$$(mktemp -d); (cd $$dir && $(FIRMWARE_FLEET) -d "$(abspath $(DIR__BIN))" $(FIRMWARE_FLEET_FLAGS)); status=$$?; rm -rf $$dir; exit $$status
+
+$(FIRMWARE_FLEET): $(DIR__BENCH)/firmware_fleet.c $(HOST_FLOW_OBJ) $(HOST_CORE_LIB) $(HOST_STUB_LIB)
+	mkdir -p $(dir $@)
+	$(HOSTCC) $(HOST_CFLAGS) $(HOST_INCLUDES) -o "$@" "$<" $(HOST_FLOW_OBJ) $(HOST_CORE_LIB) $(HOST_STUB_LIB) $(HOST_LIBS)
@@ -1,3 +1,3 @@
 
-LIBS := -lflowmessaging -lflowcore -L$(DIR__STAGING)/lib
+LIBS := -lflowmessaging -lflowcore -lpthread -L$(DIR__STAGING)/lib
 
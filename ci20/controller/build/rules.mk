@@ -8,6 +8,7 @@ ifeq ($(TARGET),mipsel)
 export STAGING_DIR:=/opt/mips_toolchain
 CROSSTOOL:=$(STAGING_DIR)/bin
 export CC:=$(CROSSTOOL)/mips-linux-gnu-gcc -EL
+export AR:=$(CROSSTOOL)/mips-linux-gnu-ar
 else
 ifeq ($(TARGET),)
 #ARCH is not mips ,and host & target are same i.e. linux PC
@@ -24,7 +25,7 @@ PYTHON_VERSION:=$(shell python --version 2>&1 | gawk '{ print substr($$2,0,3) }'
 export PYTHON_INC:=-I/usr/include/python$(PYTHON_VERSION)
 endif
 
-export DIR__DEBUG:=$(if $(DEBUG),debug,release)
+export DIR__DEBUG:=$(if $(DEBUG),debug,release)$(if $(ALLOC_PROFILE),-profile)
 export DIR__OBJ:=$(DIR__BUILD)/$(TARGET)/$(DIR__DEBUG)
 export DIR__STAGING:=/tmp/$(TARGET)/$(DIR__DEBUG)/usr
 
@@ -1,21 +1,53 @@
 DIR__SRC=../src
-SRC=$(addprefix $(DIR__SRC)/,	\
-	./main.c \
+# Message codec shared with the WiFire firmware, built from its one copy there,
+# or from common/ with DIR__COMMON=../common when building a source archive
+DIR__COMMON?=../../../wifire/common
+
+# Controller logic, no dependency on the flow libraries beyond the headers
+# (core, threading, queue, timer, xmltree), built into libclimatecore.a
+CORE_SRC=$(addprefix $(DIR__SRC)/,	\
 	./controller.c \
+	./construct_message.c \
+	./controller_logging.c \
+	./zone_control.c \
+	./time_series.c \
+	./history_store.c \
+	./history_writer.c \
+	./history_server.c \
+	./settings_cache.c \
+	./message_trace.c \
+	./controller_stats.c \
+	./alloc_profile.c \
+)
+
+# Shared codec, also part of libclimatecore.a
+COMMON_SRC=$(addprefix $(DIR__COMMON)/src/,	\
+	./message_template.c \
+	./wire_format.c \
+	./climate_proto.c \
+)
+
+# Thin adapter binding the core to FlowCloud and the console
+ADAPTER_SRC=$(addprefix $(DIR__SRC)/,	\
+	./main.c \
 	./flow_interface.c \
 	./flow_interface_func.c \
 	./console.c \
-	./construct_message.c \
-	./controller_logging.c \
 )
 
+SRC=$(ADAPTER_SRC) $(CORE_SRC)
+
 DIR__LIB:=../
 
 C_SRC:=$(filter %.c,$(SRC))
 C_OBJ:=$(patsubst $(DIR__SRC)/%.c,$(DIR__OBJ)/%.o,$(C_SRC))
-C_DEP:=$(C_OBJ:.o=.d)
+COMMON_OBJ:=$(patsubst $(DIR__COMMON)/src/%.c,$(DIR__OBJ)/common/%.o,$(COMMON_SRC))
+C_DEP:=$(C_OBJ:.o=.d) $(COMMON_OBJ:.o=.d)
+CORE_OBJ:=$(patsubst $(DIR__SRC)/%.c,$(DIR__OBJ)/%.o,$(CORE_SRC)) $(COMMON_OBJ)
+ADAPTER_OBJ:=$(patsubst $(DIR__SRC)/%.c,$(DIR__OBJ)/%.o,$(ADAPTER_SRC))
+CORE_LIB:=$(DIR__OBJ)/libclimatecore.a
 
-OBJS+=$(C_OBJ)
+OBJS+=$(C_OBJ) $(COMMON_OBJ)
 
 CFLAGS= \
 	-DPOSIX=1 \
@@ -32,8 +64,15 @@ CFLAGS+= \
 	-O0 -g3 -Wall
 endif
 
+# Per call site allocation profile, e.g. make ALLOC_PROFILE=1 (see alloc_profile.h)
+ifneq ($(ALLOC_PROFILE),)
+ALLOC_PROFILE_CFLAGS:=-DALLOC_PROFILE=1 -include "$(DIR__SRC)/alloc_profile.h"
+CFLAGS+= $(ALLOC_PROFILE_CFLAGS)
+endif
+
 INCLUDES:=\
 	-I"$(DIR__SRC)" \
+	-I"$(DIR__COMMON)/include" \
 	-I"$(DIR__SDK)/Lib/include" \
 	-I"$(DIR__STAGING)/include" \
 
@@ -43,3 +82,8 @@ $(C_OBJ) : $(DIR__OBJ)/%.o : $(DIR__SRC)/%.c | $(DIR__OBJ)
 	mkdir -p $(dir $@)
 	$(CC) $(CFLAGS) $(INCLUDES) -c -MF"$(@:%.o=%.d)" -MT"$(@:%.o=%.d)" -o "$@" "$<"
 
+
+$(COMMON_OBJ) : $(DIR__OBJ)/common/%.o : $(DIR__COMMON)/src/%.c | $(DIR__OBJ)
+	@echo 'Building file: $<'
+	mkdir -p $(dir $@)
+	$(CC) $(CFLAGS) $(INCLUDES) -c -MF"$(@:%.o=%.d)" -MT"$(@:%.o=%.d)" -o "$@" "$<"
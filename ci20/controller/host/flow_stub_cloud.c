@@ -0,0 +1,589 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "flow/flowmessaging.h"
+#include "flow_stub.h"
+#include "flow_stub_private.h"
+
+#define MAX_DEVICES (8)
+#define MAX_SETTINGS (8)
+#define LOGGED_IN_DEVICE_ID "controller"
+#define LOGGED_IN_DEVICE_TYPE "ClimateControlDemoController"
+
+struct _FlowMemoryManager
+{
+	int unused;
+};
+
+struct _FlowAPI
+{
+	int unused;
+};
+
+struct _FlowUser
+{
+	char id[FLOW_STUB_ID_SIZE];
+};
+
+struct _FlowDevice
+{
+	char id[FLOW_STUB_ID_SIZE];
+	char type[FLOW_STUB_ID_SIZE];
+};
+
+struct _FlowDevices
+{
+	struct _FlowDevice *items;
+	int count;
+};
+
+struct _FlowSetting
+{
+	char key[FLOW_STUB_ID_SIZE];
+	char *value;
+};
+
+struct _FlowSettings
+{
+	int unused;
+};
+
+struct _FlowMessagingMessage
+{
+	const char *content;
+	const char *senderUserId;
+	const char *senderDeviceId;
+};
+
+typedef struct OutboxEntry
+{
+	FlowStubMessage message;
+	struct OutboxEntry *next;
+}OutboxEntry;
+
+static pthread_mutex_t _cloudLock = PTHREAD_MUTEX_INITIALIZER;
+static struct _FlowMemoryManager _memoryManager;
+static struct _FlowAPI _api;
+static struct _FlowSettings _settingsPage;
+static struct _FlowUser _owner = { "user" };
+static struct _FlowDevice _loggedInDevice = { LOGGED_IN_DEVICE_ID, LOGGED_IN_DEVICE_TYPE };
+static struct _FlowDevice _devices[MAX_DEVICES];
+static struct _FlowDevices _ownedDevices = { _devices, 0 };
+static struct _FlowSetting _settings[MAX_SETTINGS];
+static unsigned int _numSettings;
+static struct _FlowSetting _retrievedSetting;
+static FlowError _lastError = FlowError_NoError;
+static FlowMessaging_MessageReceivedCallBack _listener;
+static FlowStub_SendListener _sendListener;
+static bool _isOffline;
+static OutboxEntry *_outboxHead;
+static OutboxEntry *_outboxTail;
+static unsigned int _outboxCount;
+
+static void CopyId(char *id, const char *value)
+{
+	strncpy(id, value ? value : "", FLOW_STUB_ID_SIZE - 1);
+	id[FLOW_STUB_ID_SIZE - 1] = '\0';
+}
+
+static struct _FlowSetting *FindSetting(const char *key)
+{
+	unsigned int i;
+
+	for (i = 0; i < _numSettings; ++i)
+	{
+		if (strcmp(_settings[i].key, key) == 0)
+		{
+			return &_settings[i];
+		}
+	}
+	return NULL;
+}
+
+void FlowStubCloud_Reset(void)
+{
+	FlowStubMessage message;
+	unsigned int i;
+
+	while (FlowStub_PopSentMessage(&message))
+	{
+		free(message.content);
+	}
+
+	pthread_mutex_lock(&_cloudLock);
+	for (i = 0; i < _numSettings; ++i)
+	{
+		free(_settings[i].value);
+	}
+	_numSettings = 0;
+	free(_retrievedSetting.value);
+	_retrievedSetting.value = NULL;
+	_ownedDevices.count = 0;
+	CopyId(_owner.id, "user");
+	_listener = NULL;
+	_sendListener = NULL;
+	_isOffline = false;
+	_lastError = FlowError_NoError;
+	pthread_mutex_unlock(&_cloudLock);
+}
+
+/**
+ * Stop timers and forget cloud state, outbox and listener.
+ */
+void FlowStub_Reset(void)
+{
+	FlowStubTimer_Reset();
+	FlowStubCloud_Reset();
+}
+
+void FlowStub_SetOwner(const char *userId)
+{
+	pthread_mutex_lock(&_cloudLock);
+	CopyId(_owner.id, userId);
+	pthread_mutex_unlock(&_cloudLock);
+}
+
+void FlowStub_AddOwnedDevice(const char *deviceType, const char *deviceId)
+{
+	pthread_mutex_lock(&_cloudLock);
+	if (_ownedDevices.count < MAX_DEVICES)
+	{
+		CopyId(_devices[_ownedDevices.count].type, deviceType);
+		CopyId(_devices[_ownedDevices.count].id, deviceId);
+		_ownedDevices.count++;
+	}
+	pthread_mutex_unlock(&_cloudLock);
+}
+
+/**
+ * Set a KVS setting of the logged in device, NULL value removes it.
+ */
+void FlowStub_SetSetting(const char *key, const char *value)
+{
+	struct _FlowSetting *setting;
+
+	pthread_mutex_lock(&_cloudLock);
+	setting = FindSetting(key);
+	if (setting == NULL && value && _numSettings < MAX_SETTINGS)
+	{
+		setting = &_settings[_numSettings++];
+		CopyId(setting->key, key);
+		setting->value = NULL;
+	}
+	if (setting)
+	{
+		free(setting->value);
+		setting->value = NULL;
+		if (value)
+		{
+			setting->value = strdup(value);
+		}
+		else
+		{
+			*setting = _settings[--_numSettings];
+			_settings[_numSettings].value = NULL;
+		}
+	}
+	pthread_mutex_unlock(&_cloudLock);
+}
+
+/**
+ * Return a KVS setting, valid until it is next changed.
+ */
+const char *FlowStub_GetSetting(const char *key)
+{
+	struct _FlowSetting *setting;
+	const char *value;
+
+	pthread_mutex_lock(&_cloudLock);
+	setting = FindSetting(key);
+	value = setting ? setting->value : NULL;
+	pthread_mutex_unlock(&_cloudLock);
+	return value;
+}
+
+/**
+ * Hand a message to the registered listener, on caller's thread.
+ * Sender is a user if userId is given, otherwise a device.
+ */
+bool FlowStub_DeliverMessage(const char *userId, const char *deviceId, const char *content)
+{
+	struct _FlowMessagingMessage message = { content, userId, userId ? NULL : deviceId };
+	FlowMessaging_MessageReceivedCallBack listener;
+
+	pthread_mutex_lock(&_cloudLock);
+	listener = _listener;
+	pthread_mutex_unlock(&_cloudLock);
+
+	if (listener == NULL)
+	{
+		return false;
+	}
+	listener(&message);
+	return true;
+}
+
+unsigned int FlowStub_SentMessageCount(void)
+{
+	unsigned int count;
+
+	pthread_mutex_lock(&_cloudLock);
+	count = _outboxCount;
+	pthread_mutex_unlock(&_cloudLock);
+	return count;
+}
+
+/**
+ * Take oldest sent message out of outbox.
+ */
+bool FlowStub_PopSentMessage(FlowStubMessage *message)
+{
+	OutboxEntry *entry;
+
+	pthread_mutex_lock(&_cloudLock);
+	entry = _outboxHead;
+	if (entry)
+	{
+		_outboxHead = entry->next;
+		if (_outboxHead == NULL)
+		{
+			_outboxTail = NULL;
+		}
+		_outboxCount--;
+	}
+	pthread_mutex_unlock(&_cloudLock);
+
+	if (entry == NULL)
+	{
+		return false;
+	}
+	*message = entry->message;
+	free(entry);
+	return true;
+}
+
+/**
+ * Hand messages sent from now on to listener rather than the outbox,
+ * e.g. to carry them to another process. NULL restores the outbox.
+ */
+void FlowStub_SetSendListener(FlowStub_SendListener listener)
+{
+	pthread_mutex_lock(&_cloudLock);
+	_sendListener = listener;
+	pthread_mutex_unlock(&_cloudLock);
+}
+
+/**
+ * While offline, as through a network outage, sends fail and nothing is
+ * kept. Reset puts the cloud back online.
+ */
+void FlowStub_SetOnline(bool isOnline)
+{
+	pthread_mutex_lock(&_cloudLock);
+	_isOffline = !isOnline;
+	pthread_mutex_unlock(&_cloudLock);
+}
+
+static bool Send(bool isToUser, const char *to, const char *content, unsigned int length)
+{
+	OutboxEntry *entry = (OutboxEntry *)calloc(1, sizeof(OutboxEntry));
+	FlowStub_SendListener listener;
+
+	if (entry == NULL || to == NULL || content == NULL)
+	{
+		free(entry);
+		return false;
+	}
+	entry->message.content = (char *)malloc(length + 1);
+	if (entry->message.content == NULL)
+	{
+		free(entry);
+		return false;
+	}
+	memcpy(entry->message.content, content, length);
+	entry->message.content[length] = '\0';
+	entry->message.isToUser = isToUser;
+	CopyId(entry->message.to, to);
+
+	pthread_mutex_lock(&_cloudLock);
+	if (_isOffline)
+	{
+		_lastError = FlowError_Unknown;
+		pthread_mutex_unlock(&_cloudLock);
+		free(entry->message.content);
+		free(entry);
+		return false;
+	}
+	listener = _sendListener;
+	if (listener)
+	{
+		pthread_mutex_unlock(&_cloudLock);
+		listener(&entry->message);
+		free(entry->message.content);
+		free(entry);
+		return true;
+	}
+	if (_outboxTail)
+	{
+		_outboxTail->next = entry;
+	}
+	else
+	{
+		_outboxHead = entry;
+	}
+	_outboxTail = entry;
+	_outboxCount++;
+	pthread_mutex_unlock(&_cloudLock);
+	return true;
+}
+
+const char *FlowMessaging_GetVersion(void)
+{
+	return FlowCore_GetVersion();
+}
+
+bool FlowMessaging_Initialise(void)
+{
+	return true;
+}
+
+bool FlowMessaging_SendMessageToUser(FlowID userId, const char *contentType, const char *content,
+										unsigned int length, unsigned int expirySeconds)
+{
+	(void)contentType;
+	(void)expirySeconds;
+	return Send(true, userId, content, length);
+}
+
+bool FlowMessaging_SendMessageToDevice(FlowID deviceId, const char *contentType, const char *content,
+										unsigned int length, unsigned int expirySeconds)
+{
+	(void)contentType;
+	(void)expirySeconds;
+	return Send(false, deviceId, content, length);
+}
+
+void FlowMessaging_SetMessageReceivedListenerForDevice(FlowMessaging_MessageReceivedCallBack callback)
+{
+	pthread_mutex_lock(&_cloudLock);
+	_listener = callback;
+	pthread_mutex_unlock(&_cloudLock);
+}
+
+char *FlowMessagingMessage_GetContent(FlowMessagingMessage message)
+{
+	return (char *)message->content;
+}
+
+unsigned int FlowMessagingMessage_GetContentLength(FlowMessagingMessage message)
+{
+	return (unsigned int)strlen(message->content);
+}
+
+char *FlowMessagingMessage_GetSenderUserID(FlowMessagingMessage message)
+{
+	return (char *)message->senderUserId;
+}
+
+char *FlowMessagingMessage_GetSenderDeviceID(FlowMessagingMessage message)
+{
+	return (char *)message->senderDeviceId;
+}
+
+FlowError Flow_GetLastError(void)
+{
+	return _lastError;
+}
+
+FlowMemoryManager FlowMemoryManager_New(void)
+{
+	return &_memoryManager;
+}
+
+void FlowMemoryManager_Free(FlowMemoryManager *memoryManager)
+{
+	*memoryManager = NULL;
+}
+
+bool FlowClient_ConnectToServer(const char *url, const char *key, const char *secret, bool isRemember)
+{
+	(void)url;
+	(void)key;
+	(void)secret;
+	(void)isRemember;
+	return true;
+}
+
+bool FlowClient_LoginAsDevice(const char *deviceType, const char *macAddress, const char *serialNumber,
+								const char *deviceId, const char *softwareVersion, const char *deviceName,
+								const char *registrationKey)
+{
+	(void)macAddress;
+	(void)serialNumber;
+	(void)softwareVersion;
+	(void)deviceName;
+	(void)registrationKey;
+	pthread_mutex_lock(&_cloudLock);
+	CopyId(_loggedInDevice.type, deviceType);
+	if (deviceId)
+	{
+		CopyId(_loggedInDevice.id, deviceId);
+	}
+	pthread_mutex_unlock(&_cloudLock);
+	return true;
+}
+
+FlowDevice FlowClient_GetLoggedInDevice(FlowMemoryManager memoryManager)
+{
+	(void)memoryManager;
+	return &_loggedInDevice;
+}
+
+FlowAPI FlowClient_GetAPI(FlowMemoryManager memoryManager)
+{
+	(void)memoryManager;
+	return &_api;
+}
+
+bool FlowAPI_CanRetrieveUser(FlowAPI api)
+{
+	return (api != NULL);
+}
+
+FlowUser FlowAPI_RetrieveUser(FlowAPI api, FlowID userId)
+{
+	(void)api;
+	return (strcmp(userId, _owner.id) == 0) ? &_owner : NULL;
+}
+
+FlowID FlowUser_GetUserID(FlowUser user)
+{
+	return user->id;
+}
+
+FlowDevices FlowUser_RetrieveOwnedDevices(FlowUser user, int pageSize)
+{
+	(void)pageSize;
+	return user ? &_ownedDevices : NULL;
+}
+
+int FlowDevices_GetCount(FlowDevices devices)
+{
+	return devices->count;
+}
+
+FlowDevice FlowDevices_GetItem(FlowDevices devices, int index)
+{
+	return (index >= 0 && index < devices->count) ? &devices->items[index] : NULL;
+}
+
+FlowID FlowDevice_GetDeviceID(FlowDevice device)
+{
+	return device->id;
+}
+
+bool FlowDevice_HasDeviceType(FlowDevice device)
+{
+	return device->type[0] != '\0';
+}
+
+char *FlowDevice_GetDeviceType(FlowDevice device)
+{
+	return device->type;
+}
+
+FlowUser FlowDevice_RetrieveOwner(FlowDevice device)
+{
+	(void)device;
+	return &_owner;
+}
+
+bool FlowDevice_CanRetrieveSettings(FlowDevice device)
+{
+	return (device != NULL);
+}
+
+FlowSettings FlowDevice_RetrieveSettings(FlowDevice device, int pageSize)
+{
+	(void)device;
+	(void)pageSize;
+	return &_settingsPage;
+}
+
+/**
+ * Retrieved setting is a copy, valid until the next retrieval.
+ */
+FlowSetting FlowDevice_RetrieveSetting(FlowDevice device, const char *key)
+{
+	struct _FlowSetting *setting;
+
+	(void)device;
+	pthread_mutex_lock(&_cloudLock);
+	setting = FindSetting(key);
+	free(_retrievedSetting.value);
+	_retrievedSetting.value = NULL;
+	CopyId(_retrievedSetting.key, key);
+	if (setting && setting->value)
+	{
+		_retrievedSetting.value = strdup(setting->value);
+	}
+	_lastError = setting ? FlowError_NoError : FlowError_NotFound;
+	pthread_mutex_unlock(&_cloudLock);
+	return &_retrievedSetting;
+}
+
+bool FlowSetting_HasValue(FlowSetting setting)
+{
+	return (setting && setting->value);
+}
+
+char *FlowSetting_GetValue(FlowSetting setting)
+{
+	return setting->value;
+}
+
+FlowSetting FlowSettings_SaveSetting(FlowMemoryManager memoryManager, FlowSettings settings, const char *key, const char *value)
+{
+	(void)memoryManager;
+	(void)settings;
+	FlowStub_SetSetting(key, value);
+	pthread_mutex_lock(&_cloudLock);
+	_lastError = FlowError_NoError;
+	pthread_mutex_unlock(&_cloudLock);
+	return NULL;
+}
@@ -0,0 +1,346 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "flow/flowcore.h"
+#include "flow_stub.h"
+
+#define STUB_VERSION "0.0.0-stub"
+
+struct _FlowThread
+{
+	pthread_t thread;
+	FlowThread_Function function;
+	void *context;
+};
+
+struct _FlowQueue
+{
+	pthread_mutex_t lock;
+	pthread_cond_t notEmpty;
+	unsigned int size;
+	unsigned int head;
+	unsigned int count;
+	void **items;
+};
+
+static long _allocations;
+static FlowLogLevel _logLevel = FlowLogLevel_Debug;
+static uint64_t _allocationCount;
+static uint64_t _allocationBytes;
+
+const char *FlowCore_GetVersion(void)
+{
+	return STUB_VERSION;
+}
+
+bool FlowCore_Initialise(void)
+{
+	return true;
+}
+
+void FlowCore_RegisterTypes(void)
+{
+}
+
+static void CountAllocation(size_t size)
+{
+	__atomic_add_fetch(&_allocationCount, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&_allocationBytes, size, __ATOMIC_RELAXED);
+}
+
+/**
+ * Allocations are counted, so tests can check that events and messages
+ * are freed by their receivers, and benchmarks can report allocations
+ * per operation.
+ */
+void *Flow_MemAlloc(size_t size)
+{
+	void *memory = calloc(1, size);
+
+	if (memory)
+	{
+		__atomic_add_fetch(&_allocations, 1, __ATOMIC_RELAXED);
+		CountAllocation(size);
+	}
+	return memory;
+}
+
+void *Flow_MemRealloc(void *memory, size_t size)
+{
+	void *resized = realloc(memory, size);
+
+	if (resized)
+	{
+		if (memory == NULL)
+		{
+			__atomic_add_fetch(&_allocations, 1, __ATOMIC_RELAXED);
+		}
+		CountAllocation(size);
+	}
+	return resized;
+}
+
+void Flow_MemFree(void **memory)
+{
+	if (memory && *memory)
+	{
+		free(*memory);
+		*memory = NULL;
+		__atomic_sub_fetch(&_allocations, 1, __ATOMIC_RELAXED);
+	}
+}
+
+long FlowStub_OutstandingAllocations(void)
+{
+	return __atomic_load_n(&_allocations, __ATOMIC_RELAXED);
+}
+
+void FlowStub_GetAllocationStats(FlowStubAllocationStats *stats)
+{
+	stats->count = __atomic_load_n(&_allocationCount, __ATOMIC_RELAXED);
+	stats->bytes = __atomic_load_n(&_allocationBytes, __ATOMIC_RELAXED);
+}
+
+char *FlowString_Duplicate(const char *string)
+{
+	char *copy = NULL;
+
+	if (string)
+	{
+		copy = (char *)Flow_MemAlloc(strlen(string) + 1);
+		if (copy)
+		{
+			strcpy(copy, string);
+		}
+	}
+	return copy;
+}
+
+static void *ThreadMain(void *context)
+{
+	FlowThread thread = (FlowThread)context;
+
+	thread->function(thread, thread->context);
+	return NULL;
+}
+
+/**
+ * Threads run detached, as the controller's threads never return.
+ * Priority and stack size are left to the host.
+ */
+FlowThread FlowThread_New(const char *name, unsigned int priority, unsigned int stackSize,
+							FlowThread_Function function, void *context)
+{
+	FlowThread thread = (FlowThread)calloc(1, sizeof(struct _FlowThread));
+
+	(void)name;
+	(void)priority;
+	(void)stackSize;
+	if (thread)
+	{
+		thread->function = function;
+		thread->context = context;
+		if (pthread_create(&thread->thread, NULL, ThreadMain, thread) != 0)
+		{
+			free(thread);
+			return NULL;
+		}
+		pthread_detach(thread->thread);
+	}
+	return thread;
+}
+
+void FlowThread_Sleep(FlowThread thread, unsigned int milliseconds)
+{
+	struct timespec delay;
+
+	(void)thread;
+	delay.tv_sec = milliseconds / 1000;
+	delay.tv_nsec = (long)(milliseconds % 1000) * 1000000;
+	nanosleep(&delay, NULL);
+}
+
+/**
+ * Host threads cannot be stopped from outside, so the handle is kept for
+ * the thread that may still be using it.
+ */
+void FlowThread_Free(FlowThread thread)
+{
+	(void)thread;
+}
+
+int FlowThread_GetLastError(void)
+{
+	return 0;
+}
+
+/**
+ * Drop log messages less severe than level, e.g. for many device
+ * processes sharing a terminal
+ */
+void FlowStub_SetLogLevel(FlowLogLevel level)
+{
+	_logLevel = level;
+}
+
+void Flow_Logv(FlowLogLevel level, const char *format, va_list args)
+{
+	if ((level != FlowLogLevel_None) && (level <= _logLevel))
+	{
+		vfprintf(stderr, format, args);
+		fputc('\n', stderr);
+	}
+}
+
+FlowQueue FlowQueue_NewBlocking(unsigned int size)
+{
+	FlowQueue queue = (FlowQueue)calloc(1, sizeof(struct _FlowQueue));
+	pthread_condattr_t attributes;
+
+	if (queue == NULL || size == 0)
+	{
+		free(queue);
+		return NULL;
+	}
+
+	queue->items = (void **)calloc(size, sizeof(void *));
+	if (queue->items == NULL)
+	{
+		free(queue);
+		return NULL;
+	}
+	queue->size = size;
+	pthread_mutex_init(&queue->lock, NULL);
+	pthread_condattr_init(&attributes);
+	pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+	pthread_cond_init(&queue->notEmpty, &attributes);
+	pthread_condattr_destroy(&attributes);
+	return queue;
+}
+
+/**
+ * Add item, failing rather than blocking when queue is full.
+ */
+bool FlowQueue_Enqueue(FlowQueue queue, void *item)
+{
+	bool success = false;
+
+	if (queue == NULL)
+	{
+		return false;
+	}
+
+	pthread_mutex_lock(&queue->lock);
+	if (queue->count < queue->size)
+	{
+		queue->items[(queue->head + queue->count) % queue->size] = item;
+		queue->count++;
+		success = true;
+		pthread_cond_signal(&queue->notEmpty);
+	}
+	pthread_mutex_unlock(&queue->lock);
+	return success;
+}
+
+/**
+ * Remove oldest item, waiting up to milliseconds (real time) for one.
+ * Return NULL if none arrived.
+ */
+void *FlowQueue_DequeueWaitFor(FlowQueue queue, unsigned int milliseconds)
+{
+	struct timespec deadline;
+	void *item = NULL;
+
+	if (queue == NULL)
+	{
+		return NULL;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += milliseconds / 1000;
+	deadline.tv_nsec += (long)(milliseconds % 1000) * 1000000;
+	if (deadline.tv_nsec >= 1000000000)
+	{
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	pthread_mutex_lock(&queue->lock);
+	while (queue->count == 0 && milliseconds > 0)
+	{
+		if (pthread_cond_timedwait(&queue->notEmpty, &queue->lock, &deadline) == ETIMEDOUT)
+		{
+			break;
+		}
+	}
+	if (queue->count > 0)
+	{
+		item = queue->items[queue->head];
+		queue->head = (queue->head + 1) % queue->size;
+		queue->count--;
+	}
+	pthread_mutex_unlock(&queue->lock);
+	return item;
+}
+
+/**
+ * Items waiting in queue, for load tests
+ */
+unsigned int FlowStub_QueueLength(FlowQueue queue)
+{
+	unsigned int count;
+
+	pthread_mutex_lock(&queue->lock);
+	count = queue->count;
+	pthread_mutex_unlock(&queue->lock);
+	return count;
+}
+
+void FlowQueue_Free(FlowQueue *queue)
+{
+	if (queue && *queue)
+	{
+		pthread_cond_destroy(&(*queue)->notEmpty);
+		pthread_mutex_destroy(&(*queue)->lock);
+		free((*queue)->items);
+		free(*queue);
+		*queue = NULL;
+	}
+}
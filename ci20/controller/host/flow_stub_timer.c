@@ -0,0 +1,319 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "flow/flowcore.h"
+#include "flow_stub.h"
+#include "flow_stub_private.h"
+
+#define TICK_MS (5)
+
+struct _FlowTimer
+{
+	unsigned int period;	//milliseconds
+	bool repeat;
+	bool isRunning;
+	uint64_t due;	//milliseconds on stub clock
+	FlowTimer_Function function;
+	void *context;
+	struct _FlowTimer *next;
+};
+
+static pthread_mutex_t _timerLock = PTHREAD_MUTEX_INITIALIZER;
+static struct _FlowTimer *_timers;
+static bool _isTickerStarted;
+static bool _isVirtual;
+static uint64_t _virtualMs;
+static time_t _virtualEpoch;
+
+static uint64_t RealMs(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static uint64_t NowMsLocked(void)
+{
+	return _isVirtual ? _virtualMs : RealMs();
+}
+
+uint64_t FlowStub_NowMs(void)
+{
+	uint64_t now;
+
+	pthread_mutex_lock(&_timerLock);
+	now = NowMsLocked();
+	pthread_mutex_unlock(&_timerLock);
+	return now;
+}
+
+/**
+ * Milliseconds since an arbitrary start, as the SDK's system tick
+ */
+unsigned int FlowTimer_GetTickCount(void)
+{
+	return (unsigned int)FlowStub_NowMs();
+}
+
+bool Flow_GetTime(time_t *now)
+{
+	pthread_mutex_lock(&_timerLock);
+	*now = _isVirtual ? _virtualEpoch + (time_t)(_virtualMs / 1000) : time(NULL);
+	pthread_mutex_unlock(&_timerLock);
+	return true;
+}
+
+/**
+ * Switch to virtual clock, starting at epoch (seconds). Should be called
+ * before any timer is started.
+ */
+void FlowStub_UseVirtualTime(time_t epoch)
+{
+	pthread_mutex_lock(&_timerLock);
+	_isVirtual = true;
+	_virtualMs = 0;
+	_virtualEpoch = epoch;
+	pthread_mutex_unlock(&_timerLock);
+}
+
+/**
+ * Fire the earliest running timer due at or before limit, if any.
+ * Virtual clock is moved on to its due time.
+ * Return false if no timer is due.
+ */
+static bool FireNext(uint64_t limit)
+{
+	struct _FlowTimer *timer;
+	struct _FlowTimer *earliest = NULL;
+	FlowTimer_Function function = NULL;
+	void *context = NULL;
+
+	pthread_mutex_lock(&_timerLock);
+	for (timer = _timers; timer; timer = timer->next)
+	{
+		if (timer->isRunning && timer->due <= limit && (earliest == NULL || timer->due < earliest->due))
+		{
+			earliest = timer;
+		}
+	}
+	if (earliest)
+	{
+		if (_isVirtual && earliest->due > _virtualMs)
+		{
+			_virtualMs = earliest->due;
+		}
+		if (earliest->repeat)
+		{
+			earliest->due += (earliest->period > 0) ? earliest->period : 1;
+			//Real clock may have jumped, don't try to catch up
+			if (!_isVirtual && earliest->due <= limit)
+			{
+				earliest->due = limit + earliest->period;
+			}
+		}
+		else
+		{
+			earliest->isRunning = false;
+		}
+		function = earliest->function;
+		context = earliest->context;
+	}
+	pthread_mutex_unlock(&_timerLock);
+
+	//Callback may well use timers itself
+	if (earliest)
+	{
+		function(earliest, context);
+	}
+	return (earliest != NULL);
+}
+
+/**
+ * Move virtual clock on by milliseconds, firing timers that fall due in
+ * order on the caller's thread.
+ */
+void FlowStub_AdvanceTime(unsigned int milliseconds)
+{
+	uint64_t target;
+
+	pthread_mutex_lock(&_timerLock);
+	target = _virtualMs + milliseconds;
+	pthread_mutex_unlock(&_timerLock);
+
+	while (FireNext(target))
+	{
+	}
+
+	pthread_mutex_lock(&_timerLock);
+	_virtualMs = target;
+	pthread_mutex_unlock(&_timerLock);
+}
+
+static void *TickerThread(void *context)
+{
+	struct timespec delay = { 0, TICK_MS * 1000000 };
+	bool isVirtual;
+
+	(void)context;
+	for (;;)
+	{
+		nanosleep(&delay, NULL);
+		pthread_mutex_lock(&_timerLock);
+		isVirtual = _isVirtual;
+		pthread_mutex_unlock(&_timerLock);
+
+		while (!isVirtual && FireNext(RealMs()))
+		{
+		}
+	}
+	return NULL;
+}
+
+FlowTimer FlowTimer_New(const char *name, unsigned int period, bool repeat, FlowTimer_Function function, void *context)
+{
+	FlowTimer timer = (FlowTimer)calloc(1, sizeof(struct _FlowTimer));
+
+	(void)name;
+	if (timer)
+	{
+		timer->period = period;
+		timer->repeat = repeat;
+		timer->function = function;
+		timer->context = context;
+
+		pthread_mutex_lock(&_timerLock);
+		timer->next = _timers;
+		_timers = timer;
+		pthread_mutex_unlock(&_timerLock);
+	}
+	return timer;
+}
+
+void FlowTimer_Start(FlowTimer timer)
+{
+	pthread_t ticker;
+
+	if (timer == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&_timerLock);
+	timer->isRunning = true;
+	timer->due = NowMsLocked() + timer->period;
+	if (!_isTickerStarted && pthread_create(&ticker, NULL, TickerThread, NULL) == 0)
+	{
+		pthread_detach(ticker);
+		_isTickerStarted = true;
+	}
+	pthread_mutex_unlock(&_timerLock);
+}
+
+void FlowTimer_Stop(FlowTimer timer)
+{
+	if (timer)
+	{
+		pthread_mutex_lock(&_timerLock);
+		timer->isRunning = false;
+		pthread_mutex_unlock(&_timerLock);
+	}
+}
+
+/**
+ * Restart a full period from now.
+ */
+void FlowTimer_Reset(FlowTimer timer)
+{
+	if (timer)
+	{
+		pthread_mutex_lock(&_timerLock);
+		timer->isRunning = true;
+		timer->due = NowMsLocked() + timer->period;
+		pthread_mutex_unlock(&_timerLock);
+	}
+}
+
+void FlowTimer_SetPeriod(FlowTimer timer, unsigned int period)
+{
+	if (timer)
+	{
+		pthread_mutex_lock(&_timerLock);
+		timer->period = period;
+		pthread_mutex_unlock(&_timerLock);
+	}
+}
+
+void FlowTimer_Free(FlowTimer *timer)
+{
+	struct _FlowTimer **link;
+
+	if (timer == NULL || *timer == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&_timerLock);
+	for (link = &_timers; *link; link = &(*link)->next)
+	{
+		if (*link == *timer)
+		{
+			*link = (*timer)->next;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&_timerLock);
+	free(*timer);
+	*timer = NULL;
+}
+
+/**
+ * Stop every timer, so that a test's timers can't fire into the next one.
+ * Timers are not freed, their owners may still refer to them.
+ */
+void FlowStubTimer_Reset(void)
+{
+	struct _FlowTimer *timer;
+
+	pthread_mutex_lock(&_timerLock);
+	for (timer = _timers; timer; timer = timer->next)
+	{
+		timer->isRunning = false;
+	}
+	pthread_mutex_unlock(&_timerLock);
+}
@@ -0,0 +1,454 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "flow/flowcore.h"
+
+/**
+ * Small XML parser, enough for the controller's messages and settings:
+ * elements, attributes (ignored), text, CDATA, comments, processing
+ * instructions and the predefined entities. No namespaces or DTDs.
+ */
+
+#define MAX_DEPTH (32)
+
+struct _TreeNode
+{
+	char *name;
+	char *value;	//Text content, NULL if none
+	size_t valueLength;
+	struct _TreeNode *firstChild;
+	struct _TreeNode *lastChild;
+	struct _TreeNode *next;
+};
+
+typedef struct
+{
+	const char *position;
+	const char *end;
+	bool trimWhitespace;
+}Parser;
+
+static bool StartsWith(const Parser *parser, const char *prefix)
+{
+	size_t length = strlen(prefix);
+
+	return ((size_t)(parser->end - parser->position) >= length) && (memcmp(parser->position, prefix, length) == 0);
+}
+
+static bool SkipPast(Parser *parser, const char *terminator)
+{
+	size_t length = strlen(terminator);
+
+	for (; parser->position + length <= parser->end; parser->position++)
+	{
+		if (memcmp(parser->position, terminator, length) == 0)
+		{
+			parser->position += length;
+			return true;
+		}
+	}
+	return false;
+}
+
+static void SkipWhitespace(Parser *parser)
+{
+	while (parser->position < parser->end && isspace((unsigned char)*parser->position))
+	{
+		parser->position++;
+	}
+}
+
+/**
+ * Skip whitespace, comments and processing instructions between elements.
+ */
+static bool SkipMisc(Parser *parser)
+{
+	for (;;)
+	{
+		SkipWhitespace(parser);
+		if (StartsWith(parser, "<?"))
+		{
+			if (!SkipPast(parser, "?>"))
+			{
+				return false;
+			}
+		}
+		else if (StartsWith(parser, "<!--"))
+		{
+			if (!SkipPast(parser, "-->"))
+			{
+				return false;
+			}
+		}
+		else if (StartsWith(parser, "<!"))
+		{
+			if (!SkipPast(parser, ">"))
+			{
+				return false;
+			}
+		}
+		else
+		{
+			return true;
+		}
+	}
+}
+
+static bool AppendValue(struct _TreeNode *node, const char *text, size_t length)
+{
+	char *value;
+
+	if (length == 0)
+	{
+		return true;
+	}
+	value = (char *)realloc(node->value, node->valueLength + length + 1);
+	if (value == NULL)
+	{
+		return false;
+	}
+	memcpy(value + node->valueLength, text, length);
+	node->valueLength += length;
+	value[node->valueLength] = '\0';
+	node->value = value;
+	return true;
+}
+
+static bool AppendText(struct _TreeNode *node, const char *text, const char *end)
+{
+	while (text < end)
+	{
+		const char *ampersand = memchr(text, '&', (size_t)(end - text));
+		static const struct { const char *entity; char character; } entities[] =
+		{
+			{ "&lt;", '<' }, { "&gt;", '>' }, { "&amp;", '&' }, { "&quot;", '"' }, { "&apos;", '\'' },
+		};
+		unsigned int i;
+
+		if (ampersand == NULL)
+		{
+			return AppendValue(node, text, (size_t)(end - text));
+		}
+		if (!AppendValue(node, text, (size_t)(ampersand - text)))
+		{
+			return false;
+		}
+		text = ampersand;
+		for (i = 0; i < sizeof(entities) / sizeof(entities[0]); ++i)
+		{
+			size_t length = strlen(entities[i].entity);
+
+			if ((size_t)(end - text) >= length && memcmp(text, entities[i].entity, length) == 0)
+			{
+				break;
+			}
+		}
+		if (i < sizeof(entities) / sizeof(entities[0]))
+		{
+			if (!AppendValue(node, &entities[i].character, 1))
+			{
+				return false;
+			}
+			text += strlen(entities[i].entity);
+		}
+		else
+		{
+			//Not an entity we know, keep as is
+			if (!AppendValue(node, text, 1))
+			{
+				return false;
+			}
+			text++;
+		}
+	}
+	return true;
+}
+
+static char *ParseName(Parser *parser)
+{
+	const char *start = parser->position;
+	char *name;
+
+	while (parser->position < parser->end && !isspace((unsigned char)*parser->position) &&
+		*parser->position != '>' && *parser->position != '/')
+	{
+		parser->position++;
+	}
+	if (parser->position == start)
+	{
+		return NULL;
+	}
+	name = (char *)malloc((size_t)(parser->position - start) + 1);
+	if (name)
+	{
+		memcpy(name, start, (size_t)(parser->position - start));
+		name[parser->position - start] = '\0';
+	}
+	return name;
+}
+
+static void TrimValue(struct _TreeNode *node)
+{
+	size_t start = 0;
+
+	if (node->value == NULL)
+	{
+		return;
+	}
+	while (node->valueLength > 0 && isspace((unsigned char)node->value[node->valueLength - 1]))
+	{
+		node->value[--node->valueLength] = '\0';
+	}
+	while (start < node->valueLength && isspace((unsigned char)node->value[start]))
+	{
+		start++;
+	}
+	memmove(node->value, node->value + start, node->valueLength - start + 1);
+	node->valueLength -= start;
+	if (node->valueLength == 0)
+	{
+		free(node->value);
+		node->value = NULL;
+	}
+}
+
+/**
+ * Parse element starting at '<', return NULL on malformed input.
+ */
+static struct _TreeNode *ParseElement(Parser *parser, unsigned int depth)
+{
+	struct _TreeNode *node;
+
+	if (depth > MAX_DEPTH || !StartsWith(parser, "<"))
+	{
+		return NULL;
+	}
+	parser->position++;
+
+	node = (struct _TreeNode *)calloc(1, sizeof(struct _TreeNode));
+	if (node == NULL)
+	{
+		return NULL;
+	}
+	node->name = ParseName(parser);
+	if (node->name == NULL)
+	{
+		Tree_Delete(node);
+		return NULL;
+	}
+
+	//Attributes are skipped, minding quoted values
+	while (parser->position < parser->end && *parser->position != '>' && !StartsWith(parser, "/>"))
+	{
+		if (*parser->position == '"' || *parser->position == '\'')
+		{
+			char quote[2] = { *parser->position, '\0' };
+
+			parser->position++;
+			if (!SkipPast(parser, quote))
+			{
+				Tree_Delete(node);
+				return NULL;
+			}
+		}
+		else
+		{
+			parser->position++;
+		}
+	}
+	if (StartsWith(parser, "/>"))
+	{
+		parser->position += 2;
+		return node;
+	}
+	if (!StartsWith(parser, ">"))
+	{
+		Tree_Delete(node);
+		return NULL;
+	}
+	parser->position++;
+
+	for (;;)
+	{
+		const char *text = parser->position;
+
+		while (parser->position < parser->end && *parser->position != '<')
+		{
+			parser->position++;
+		}
+		if (parser->position == parser->end || !AppendText(node, text, parser->position))
+		{
+			Tree_Delete(node);
+			return NULL;
+		}
+
+		if (StartsWith(parser, "</"))
+		{
+			size_t length = strlen(node->name);
+
+			parser->position += 2;
+			if ((size_t)(parser->end - parser->position) < length ||
+				memcmp(parser->position, node->name, length) != 0)
+			{
+				Tree_Delete(node);
+				return NULL;
+			}
+			parser->position += length;
+			SkipWhitespace(parser);
+			if (!StartsWith(parser, ">"))
+			{
+				Tree_Delete(node);
+				return NULL;
+			}
+			parser->position++;
+			if (parser->trimWhitespace)
+			{
+				TrimValue(node);
+			}
+			return node;
+		}
+		else if (StartsWith(parser, "<![CDATA["))
+		{
+			const char *start = parser->position + 9;
+
+			parser->position = start;
+			if (!SkipPast(parser, "]]>") || !AppendValue(node, start, (size_t)(parser->position - 3 - start)))
+			{
+				Tree_Delete(node);
+				return NULL;
+			}
+		}
+		else if (StartsWith(parser, "<!--") || StartsWith(parser, "<?"))
+		{
+			if (!SkipPast(parser, StartsWith(parser, "<?") ? "?>" : "-->"))
+			{
+				Tree_Delete(node);
+				return NULL;
+			}
+		}
+		else
+		{
+			struct _TreeNode *child = ParseElement(parser, depth + 1);
+
+			if (child == NULL)
+			{
+				Tree_Delete(node);
+				return NULL;
+			}
+			if (node->lastChild)
+			{
+				node->lastChild->next = child;
+			}
+			else
+			{
+				node->firstChild = child;
+			}
+			node->lastChild = child;
+		}
+	}
+}
+
+/**
+ * Parse document, returning its root element.
+ */
+TreeNode TreeNode_ParseXML(uint8_t *xml, size_t length, bool trimWhitespace)
+{
+	Parser parser = { (const char *)xml, (const char *)xml + length, trimWhitespace };
+	struct _TreeNode *root;
+
+	if (xml == NULL || !SkipMisc(&parser))
+	{
+		return NULL;
+	}
+	root = ParseElement(&parser, 0);
+	if (root && !SkipMisc(&parser))
+	{
+		Tree_Delete(root);
+		return NULL;
+	}
+	return root;
+}
+
+/**
+ * Find node by path of element names separated by '/', the first of
+ * which names node itself. Return NULL if there is no such node.
+ */
+TreeNode TreeNode_Navigate(TreeNode node, const char *path)
+{
+	while (node && path)
+	{
+		const char *separator = strchr(path, '/');
+		size_t length = separator ? (size_t)(separator - path) : strlen(path);
+
+		while (node && (strlen(node->name) != length || memcmp(node->name, path, length) != 0))
+		{
+			node = node->next;
+		}
+		if (node == NULL || separator == NULL)
+		{
+			return node;
+		}
+		node = node->firstChild;
+		path = separator + 1;
+	}
+	return NULL;
+}
+
+void *TreeNode_GetValue(TreeNode node)
+{
+	return node ? node->value : NULL;
+}
+
+char *TreeNode_GetName(TreeNode node)
+{
+	return node ? node->name : NULL;
+}
+
+void Tree_Delete(TreeNode root)
+{
+	while (root)
+	{
+		struct _TreeNode *next = root->next;
+
+		Tree_Delete(root->firstChild);
+		free(root->name);
+		free(root->value);
+		free(root);
+		root = next;
+	}
+}
@@ -0,0 +1,97 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef FLOW_STUB_CLIENT_H
+#define FLOW_STUB_CLIENT_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+#define FLOW_DEFAULT_PAGE_SIZE (20)
+
+typedef char *FlowID;
+typedef struct _FlowMemoryManager *FlowMemoryManager;
+typedef struct _FlowAPI *FlowAPI;
+typedef struct _FlowUser *FlowUser;
+typedef struct _FlowDevice *FlowDevice;
+typedef struct _FlowDevices *FlowDevices;
+typedef struct _FlowSetting *FlowSetting;
+typedef struct _FlowSettings *FlowSettings;
+
+typedef enum
+{
+	FlowError_NoError,
+	FlowError_NotFound,
+	FlowError_Unknown,
+}FlowError;
+
+FlowError Flow_GetLastError(void);
+
+FlowMemoryManager FlowMemoryManager_New(void);
+void FlowMemoryManager_Free(FlowMemoryManager *memoryManager);
+
+bool FlowClient_ConnectToServer(const char *url, const char *key, const char *secret, bool isRemember);
+bool FlowClient_LoginAsDevice(const char *deviceType, const char *macAddress, const char *serialNumber,
+								const char *deviceId, const char *softwareVersion, const char *deviceName,
+								const char *registrationKey);
+FlowDevice FlowClient_GetLoggedInDevice(FlowMemoryManager memoryManager);
+FlowAPI FlowClient_GetAPI(FlowMemoryManager memoryManager);
+
+bool FlowAPI_CanRetrieveUser(FlowAPI api);
+FlowUser FlowAPI_RetrieveUser(FlowAPI api, FlowID userId);
+FlowID FlowUser_GetUserID(FlowUser user);
+FlowDevices FlowUser_RetrieveOwnedDevices(FlowUser user, int pageSize);
+
+int FlowDevices_GetCount(FlowDevices devices);
+FlowDevice FlowDevices_GetItem(FlowDevices devices, int index);
+FlowID FlowDevice_GetDeviceID(FlowDevice device);
+bool FlowDevice_HasDeviceType(FlowDevice device);
+char *FlowDevice_GetDeviceType(FlowDevice device);
+FlowUser FlowDevice_RetrieveOwner(FlowDevice device);
+bool FlowDevice_CanRetrieveSettings(FlowDevice device);
+FlowSettings FlowDevice_RetrieveSettings(FlowDevice device, int pageSize);
+FlowSetting FlowDevice_RetrieveSetting(FlowDevice device, const char *key);
+
+bool FlowSetting_HasValue(FlowSetting setting);
+char *FlowSetting_GetValue(FlowSetting setting);
+FlowSetting FlowSettings_SaveSetting(FlowMemoryManager memoryManager, FlowSettings settings, const char *key, const char *value);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* FLOW_STUB_CLIENT_H */
@@ -0,0 +1,66 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef FLOW_STUB_MESSAGING_H
+#define FLOW_STUB_MESSAGING_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+#include "flow/flowcore.h"
+
+typedef struct _FlowMessagingMessage *FlowMessagingMessage;
+typedef void (*FlowMessaging_MessageReceivedCallBack)(FlowMessagingMessage message);
+
+const char *FlowMessaging_GetVersion(void);
+bool FlowMessaging_Initialise(void);
+bool FlowMessaging_SendMessageToUser(FlowID userId, const char *contentType, const char *content,
+										unsigned int length, unsigned int expirySeconds);
+bool FlowMessaging_SendMessageToDevice(FlowID deviceId, const char *contentType, const char *content,
+										unsigned int length, unsigned int expirySeconds);
+void FlowMessaging_SetMessageReceivedListenerForDevice(FlowMessaging_MessageReceivedCallBack callback);
+
+char *FlowMessagingMessage_GetContent(FlowMessagingMessage message);
+unsigned int FlowMessagingMessage_GetContentLength(FlowMessagingMessage message);
+char *FlowMessagingMessage_GetSenderUserID(FlowMessagingMessage message);
+char *FlowMessagingMessage_GetSenderDeviceID(FlowMessagingMessage message);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* FLOW_STUB_MESSAGING_H */
@@ -0,0 +1,108 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef FLOW_STUB_H
+#define FLOW_STUB_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "flow/core/flow_queue.h"
+#include "flow/core/flow_logging.h"
+
+/**
+ * Control of the offline FlowCloud stand-in, used by host tests and
+ * benchmarks.
+ *
+ * Clock is real time by default, with timers fired from a ticker thread.
+ * FlowStub_UseVirtualTime() switches to a virtual clock, which only moves
+ * on FlowStub_AdvanceTime(). Timers then fire on the caller's thread, in
+ * due order, so tests are deterministic.
+ *
+ * The cloud is a single logged in device owned by one user, with a
+ * key/value settings store. Sent messages are kept in an outbox, or
+ * handed to the send listener if one is set, and received messages are
+ * delivered to the registered listener. Sends fail after
+ * FlowStub_SetOnline(false), to test devices through network outages.
+ */
+
+#define FLOW_STUB_ID_SIZE (64)
+
+typedef struct
+{
+	uint64_t count;	//Flow_MemAlloc() calls since start, including reallocations
+	uint64_t bytes;	//Bytes requested by those calls
+}FlowStubAllocationStats;
+
+typedef struct
+{
+	bool isToUser;
+	char to[FLOW_STUB_ID_SIZE];
+	char *content;	//Free with free()
+}FlowStubMessage;
+
+//Takes a sent message instead of the outbox, on the sender's thread. Content is freed on return.
+typedef void (*FlowStub_SendListener)(const FlowStubMessage *message);
+
+void FlowStub_Reset(void);
+void FlowStub_SetLogLevel(FlowLogLevel level);
+
+void FlowStub_UseVirtualTime(time_t epoch);
+void FlowStub_AdvanceTime(unsigned int milliseconds);
+uint64_t FlowStub_NowMs(void);
+
+long FlowStub_OutstandingAllocations(void);
+void FlowStub_GetAllocationStats(FlowStubAllocationStats *stats);
+unsigned int FlowStub_QueueLength(FlowQueue queue);
+
+void FlowStub_SetOwner(const char *userId);
+void FlowStub_AddOwnedDevice(const char *deviceType, const char *deviceId);
+void FlowStub_SetSetting(const char *key, const char *value);
+const char *FlowStub_GetSetting(const char *key);
+bool FlowStub_DeliverMessage(const char *userId, const char *deviceId, const char *content);
+unsigned int FlowStub_SentMessageCount(void);
+bool FlowStub_PopSentMessage(FlowStubMessage *message);
+void FlowStub_SetSendListener(FlowStub_SendListener listener);
+void FlowStub_SetOnline(bool isOnline);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* FLOW_STUB_H */
@@ -0,0 +1,390 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "alloc_profile.h"
+
+//Wrappers call through to the real allocator
+#undef Flow_MemAlloc
+#undef Flow_MemRealloc
+#undef FlowString_Duplicate
+#undef Flow_MemFree
+
+#define MAX_SITES (512)
+#define INITIAL_BLOCKS (1024)	//Live block table size, grows by doubling
+
+typedef struct
+{
+	const char *file;
+	int line;
+	unsigned long allocs;	//Including duplicates
+	unsigned long reallocs;
+	unsigned long frees;
+	uint64_t bytes;	//Requested over all calls
+	size_t maxSize;
+	unsigned long liveCount;
+	uint64_t liveBytes;
+	uint64_t peakLiveBytes;
+	unsigned long lifetimes[ALLOC_PROFILE_LIFETIME_BUCKETS];
+}AllocSite;
+
+typedef struct
+{
+	void *memory;	//NULL if slot is empty
+	size_t size;
+	uint64_t allocatedUs;
+	unsigned int site;
+}LiveBlock;
+
+static pthread_mutex_t _lock = PTHREAD_MUTEX_INITIALIZER;
+static AllocSite _sites[MAX_SITES];
+static unsigned int _siteCount;
+static unsigned long _droppedSites;	//Calls not recorded, as site table was full
+static LiveBlock *_blocks;
+static size_t _blockSlots;
+static size_t _blockCount;
+static bool _isExitDumpRegistered;
+
+static uint64_t NowUs(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static size_t HashPointer(const void *memory, size_t slots)
+{
+	uint64_t key = (uint64_t)(uintptr_t)memory;
+
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	return (size_t)key & (slots - 1);
+}
+
+static void DumpAtExit(void)
+{
+	AllocProfile_Dump(stdout);
+}
+
+/**
+ * Site of file:line, added on first use. Sites are few and looked up
+ * from the end, where the most recent ones are.
+ */
+static int FindSite(const char *file, int line)
+{
+	int i;
+
+	for (i = (int)_siteCount - 1; i >= 0; --i)
+	{
+		if (_sites[i].line == line && (_sites[i].file == file || strcmp(_sites[i].file, file) == 0))
+		{
+			return i;
+		}
+	}
+	if (_siteCount == MAX_SITES)
+	{
+		_droppedSites++;
+		return -1;
+	}
+	if (!_isExitDumpRegistered)
+	{
+		_isExitDumpRegistered = true;
+		atexit(DumpAtExit);
+	}
+	_sites[_siteCount].file = file;
+	_sites[_siteCount].line = line;
+	return (int)_siteCount++;
+}
+
+static bool GrowBlocks(void)
+{
+	size_t slots = _blockSlots ? _blockSlots * 2 : INITIAL_BLOCKS;
+	LiveBlock *blocks = calloc(slots, sizeof(LiveBlock));
+	size_t i;
+
+	if (!blocks)
+	{
+		return false;
+	}
+	for (i = 0; i < _blockSlots; ++i)
+	{
+		if (_blocks[i].memory)
+		{
+			size_t slot = HashPointer(_blocks[i].memory, slots);
+
+			while (blocks[slot].memory)
+			{
+				slot = (slot + 1) & (slots - 1);
+			}
+			blocks[slot] = _blocks[i];
+		}
+	}
+	free(_blocks);
+	_blocks = blocks;
+	_blockSlots = slots;
+	return true;
+}
+
+/**
+ * Remove block, closing its lifetime at the site that allocated it.
+ * Table is linear probed, so following entries are shifted back into
+ * the hole.
+ */
+static void RemoveBlock(void *memory)
+{
+	size_t slot, next;
+	AllocSite *site;
+	uint64_t lifetime, limit = 10;
+	unsigned int bucket = 0;
+
+	if (!_blockSlots)
+	{
+		return;
+	}
+	slot = HashPointer(memory, _blockSlots);
+	while (_blocks[slot].memory != memory)
+	{
+		if (!_blocks[slot].memory)
+		{
+			return;	//Not allocated by profiled code
+		}
+		slot = (slot + 1) & (_blockSlots - 1);
+	}
+
+	site = &_sites[_blocks[slot].site];
+	site->frees++;
+	site->liveCount--;
+	site->liveBytes -= _blocks[slot].size;
+	lifetime = NowUs() - _blocks[slot].allocatedUs;
+	while (bucket < ALLOC_PROFILE_LIFETIME_BUCKETS - 1 && lifetime >= limit)
+	{
+		bucket++;
+		limit *= 10;
+	}
+	site->lifetimes[bucket]++;
+
+	_blocks[slot].memory = NULL;
+	_blockCount--;
+	next = (slot + 1) & (_blockSlots - 1);
+	while (_blocks[next].memory)
+	{
+		size_t home = HashPointer(_blocks[next].memory, _blockSlots);
+
+		//Move back if its home is not in (slot, next]
+		if (((next - home) & (_blockSlots - 1)) >= ((next - slot) & (_blockSlots - 1)))
+		{
+			_blocks[slot] = _blocks[next];
+			_blocks[next].memory = NULL;
+			slot = next;
+		}
+		next = (next + 1) & (_blockSlots - 1);
+	}
+}
+
+static void AddBlock(void *memory, size_t size, int site)
+{
+	size_t slot;
+
+	//Still listed if it was freed outside profiled code, close it there
+	RemoveBlock(memory);
+	if (site < 0 || ((_blockCount + 1) * 4 > _blockSlots * 3 && !GrowBlocks()))
+	{
+		return;
+	}
+	slot = HashPointer(memory, _blockSlots);
+	while (_blocks[slot].memory)
+	{
+		slot = (slot + 1) & (_blockSlots - 1);
+	}
+	_blocks[slot].memory = memory;
+	_blocks[slot].size = size;
+	_blocks[slot].allocatedUs = NowUs();
+	_blocks[slot].site = (unsigned int)site;
+	_blockCount++;
+
+	_sites[site].bytes += size;
+	if (size > _sites[site].maxSize)
+	{
+		_sites[site].maxSize = size;
+	}
+	_sites[site].liveCount++;
+	_sites[site].liveBytes += size;
+	if (_sites[site].liveBytes > _sites[site].peakLiveBytes)
+	{
+		_sites[site].peakLiveBytes = _sites[site].liveBytes;
+	}
+}
+
+void *AllocProfile_Alloc(size_t size, const char *file, int line)
+{
+	void *memory = Flow_MemAlloc(size);
+	int site;
+
+	if (memory)
+	{
+		pthread_mutex_lock(&_lock);
+		site = FindSite(file, line);
+		if (site >= 0)
+		{
+			_sites[site].allocs++;
+		}
+		AddBlock(memory, size, site);
+		pthread_mutex_unlock(&_lock);
+	}
+	return memory;
+}
+
+void *AllocProfile_Realloc(void *memory, size_t size, const char *file, int line)
+{
+	void *resized = Flow_MemRealloc(memory, size);
+	int site;
+
+	if (resized)
+	{
+		pthread_mutex_lock(&_lock);
+		site = FindSite(file, line);
+		if (memory)
+		{
+			RemoveBlock(memory);
+		}
+		if (site >= 0)
+		{
+			_sites[site].reallocs++;
+		}
+		AddBlock(resized, size, site);
+		pthread_mutex_unlock(&_lock);
+	}
+	return resized;
+}
+
+char *AllocProfile_Duplicate(const char *string, const char *file, int line)
+{
+	char *copy = FlowString_Duplicate(string);
+	int site;
+
+	if (copy)
+	{
+		pthread_mutex_lock(&_lock);
+		site = FindSite(file, line);
+		if (site >= 0)
+		{
+			_sites[site].allocs++;
+		}
+		AddBlock(copy, strlen(copy) + 1, site);
+		pthread_mutex_unlock(&_lock);
+	}
+	return copy;
+}
+
+void AllocProfile_Free(void **memory)
+{
+	if (memory && *memory)
+	{
+		pthread_mutex_lock(&_lock);
+		RemoveBlock(*memory);
+		pthread_mutex_unlock(&_lock);
+	}
+	Flow_MemFree(memory);
+}
+
+static int CompareSiteBytes(const void *a, const void *b)
+{
+	const AllocSite *x = *(const AllocSite * const *)a, *y = *(const AllocSite * const *)b;
+
+	return (x->bytes < y->bytes) - (x->bytes > y->bytes);
+}
+
+static const char *BaseName(const char *file)
+{
+	const char *slash = strrchr(file, '/');
+
+	return slash ? slash + 1 : file;
+}
+
+/**
+ * Print sites sorted by bytes allocated, i.e. worst churn first. Lifetime
+ * columns count freed blocks by decade, from under 10us to over 10s.
+ */
+void AllocProfile_Dump(FILE *out)
+{
+	static const AllocSite *sorted[MAX_SITES];
+	uint64_t totalBytes = 0, liveBytes = 0;
+	unsigned long totalCalls = 0;
+	unsigned int i, j, count;
+	char where[64];
+
+	pthread_mutex_lock(&_lock);
+	count = _siteCount;
+	for (i = 0; i < count; ++i)
+	{
+		sorted[i] = &_sites[i];
+	}
+	qsort(sorted, count, sizeof(sorted[0]), CompareSiteBytes);
+
+	fprintf(out, "%-30s %8s %8s %8s %10s %6s %6s %8s %8s | %s\n", "site", "allocs", "reallocs", "frees",
+			"bytes", "avg", "max", "live", "peak", "lifetime <10us <100us <1ms <10ms <100ms <1s <10s >=10s");
+	for (i = 0; i < count; ++i)
+	{
+		const AllocSite *site = sorted[i];
+		unsigned long calls = site->allocs + site->reallocs;
+
+		snprintf(where, sizeof(where), "%s:%d", BaseName(site->file), site->line);
+		fprintf(out, "%-30s %8lu %8lu %8lu %10llu %6llu %6zu %8llu %8llu |", where, site->allocs, site->reallocs,
+				site->frees, (unsigned long long)site->bytes, (unsigned long long)(calls ? site->bytes / calls : 0),
+				site->maxSize, (unsigned long long)site->liveBytes, (unsigned long long)site->peakLiveBytes);
+		for (j = 0; j < ALLOC_PROFILE_LIFETIME_BUCKETS; ++j)
+		{
+			fprintf(out, " %lu", site->lifetimes[j]);
+		}
+		fputc('\n', out);
+		totalBytes += site->bytes;
+		totalCalls += calls;
+		liveBytes += site->liveBytes;
+	}
+	fprintf(out, "%u sites, %lu calls, %llu bytes allocated, %llu bytes in %zu live blocks",
+			count, totalCalls, (unsigned long long)totalBytes, (unsigned long long)liveBytes, _blockCount);
+	if (_droppedSites)
+	{
+		fprintf(out, ", %lu calls from untracked sites", _droppedSites);
+	}
+	fputc('\n', out);
+	pthread_mutex_unlock(&_lock);
+}
@@ -0,0 +1,78 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef ALLOC_PROFILE_H
+#define ALLOC_PROFILE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "flow/flowcore.h"
+
+/**
+ * Per call site allocation profiler. Built with ALLOC_PROFILE=1, this
+ * header is force included ahead of every controller source, so that
+ * Flow_MemAlloc(), Flow_MemRealloc(), FlowString_Duplicate() and
+ * Flow_MemFree() record their caller. For each site it keeps calls, bytes,
+ * live and peak live bytes, and a histogram of how long blocks lived.
+ *
+ * Blocks are found by address, so memory allocated outside the profiled
+ * sources (SDK, tests) can still be freed through the wrappers, and is
+ * just not counted.
+ */
+
+#define ALLOC_PROFILE_LIFETIME_BUCKETS (8)	//<10us, <100us, ... <10s, longer
+
+void *AllocProfile_Alloc(size_t size, const char *file, int line);
+void *AllocProfile_Realloc(void *memory, size_t size, const char *file, int line);
+char *AllocProfile_Duplicate(const char *string, const char *file, int line);
+void AllocProfile_Free(void **memory);
+void AllocProfile_Dump(FILE *out);
+
+#ifdef ALLOC_PROFILE
+#define Flow_MemAlloc(size) AllocProfile_Alloc((size), __FILE__, __LINE__)
+#define Flow_MemRealloc(memory, size) AllocProfile_Realloc((memory), (size), __FILE__, __LINE__)
+#define FlowString_Duplicate(string) AllocProfile_Duplicate((string), __FILE__, __LINE__)
+#define Flow_MemFree(memory) AllocProfile_Free(memory)
+#endif
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* ALLOC_PROFILE_H */
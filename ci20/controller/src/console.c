@@ -41,6 +41,8 @@
 #include "flow/core/core.h"
 #include "flow/messaging/flow_messaging.h"
 #include "version.h"
+#include "controller_stats.h"
+#include "alloc_profile.h"
 
 typedef struct {
 	const char* cmdName;
@@ -54,6 +56,10 @@ typedef struct {
 
 static void GetDeviceRegKey(void);
 static void GetVersions(void);
+static void ShowStats(void);
+#ifdef ALLOC_PROFILE
+static void ShowAllocs(void);
+#endif
 static void AvailableCommands(void);
 static void ExitConsole(void);
 
@@ -61,6 +67,10 @@ static ConsoleCmdTable cmd_table[] =
 	{
 		{ "show devreg_key", GetDeviceRegKey, "Get device registration key"},
 		{ "show versions", GetVersions, "Show application and flow libraries versions"},
+		{ "show stats", ShowStats, "Show controller statistics"},
+#ifdef ALLOC_PROFILE
+		{ "show allocs", ShowAllocs, "Show allocations per call site"},
+#endif
 		{ "help", AvailableCommands, "Show available commands"},
 		{ "exit", ExitConsole, "Exits the interpreter"},
 	};
@@ -112,6 +122,18 @@ static void GetVersions(void)
 	printf("\tapplication(internal):\t(v%s)\n",INTERNAL_SOFTWARE_VERSION);
 }
 
+static void ShowStats(void)
+{
+	ControllerStats_Print();
+}
+
+#ifdef ALLOC_PROFILE
+static void ShowAllocs(void)
+{
+	AllocProfile_Dump(stdout);
+}
+#endif
+
 static void AvailableCommands(void)
 {
 	int i=ARRAY_SIZE(cmd_table);
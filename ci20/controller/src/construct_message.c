@@ -32,7 +32,10 @@
  OF SUCH DAMAGE.
  *****************************************************************************/
 
+#include <stdarg.h>
+
 #include "controller.h"
+#include "controller_stats.h"
 #include "flow/core/flow_time.h"
 #include "flow/core/flow_memalloc.h"
 #define ON_STR "ON"
@@ -43,9 +46,20 @@
 #define MANUAL_STR "MANUAL"
 #define ABOVE_STR "ABOVE"
 #define BELOW_STR "BELOW"
+#define THRESHOLD_STR "THRESHOLD"
+#define PID_STR "PID"
 
 #define INT_STR_SIZE (10)
-#define TAG_SIZE (100)
+#define TAG_SIZE (160)
+#define ENUM_SLOT_WIDTH (6)	//Longest of ON/OFF, AUTO/MANUAL, ALIVE/DEAD
+#define HEARTBEAT_DELTA_SIZE (512)
+
+//Fields of a delta heartbeat
+#define DELTA_FIELD_SENSOR(i) (1u << (i))
+#define DELTA_FIELD_RELAY(i) (1u << (NUM_SENSORS + (i)))
+#define DELTA_FIELD_SENSOR_ALIVE (1u << (NUM_SENSORS + NUM_RELAYS))
+#define DELTA_FIELD_ACTUATOR_ALIVE (1u << (NUM_SENSORS + NUM_RELAYS + 1))
+#define DELTA_FIELD_ALL ((DELTA_FIELD_ACTUATOR_ALIVE << 1) - 1)
 
 struct tm *gmtime_r(const time_t *timep, struct tm *result);
 
@@ -64,6 +78,11 @@ static bool isOrientationAbove(Orientation_Type orientation)
 	return orientation == Orientation_Above;
 }
 
+static bool isControlPid(Control_Type control)
+{
+	return control == Control_Pid;
+}
+
 static void FreeMemory(char *data)
 {
 	if (data)
@@ -97,93 +116,157 @@ static bool CreateTagString(char **tag, char *tmpTag)
 	return success;
 }
 
-bool ConstructSettingsCommandForSensor(const Controller *me, char **data)
+typedef bool (*SectionFormatter)(const Controller *me, char **data);
+
+/**
+ * Text of a serialized section, formatted again only if the section has
+ * changed since it was cached. NULL if formatting failed.
+ */
+static const char *GetCachedSection(Controller *me, CachedSection *cache, ControllerSection section,
+									SectionFormatter format, CacheStat *stat)
 {
-	unsigned int msgSize = 0;
-	unsigned int i;
-	char *readIntervalTag = NULL;
-	char *readDeltaTag = NULL;
-	char tmpTag[TAG_SIZE];
-	char heartBeat[INT_STR_SIZE];
-	bool success = true;
-	char msgXML[] = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
-							"<command>"
-								"<time type=\"datetime\">%04d-%02d-%02dT%02d:%02d:%02dZ</time>"
-								"<info>UPDATE_SETTINGS</info>"
-								"<settings>"
-									"<HeartBeat>%s</HeartBeat>"
-									"%s"
-									"%s"
-								"</settings>"
-							"</command>";
+	unsigned int generation = me->generations[section];
+	char *text = NULL;
 
-	for (i = 0; (i < NUM_SENSORS) && success; ++i)
+	if (cache->text && (cache->generation == generation))
 	{
-		sprintf(tmpTag, me->sensors[i].readIntervalTagString, me->sensors[i].readInterval);
-		success = CreateTagString(&readIntervalTag, tmpTag);
+		stat->hits++;
+		return cache->text;
+	}
 
-		if (success)
-		{
-			sprintf(tmpTag, me->sensors[i].readDeltaTagString, me->sensors[i].readDelta);
-			success = CreateTagString(&readDeltaTag, tmpTag);
-		}
+	stat->misses++;
+	if (format(me, &text))
+	{
+		FreeMemory(cache->text);
+		cache->text = text;
+		cache->generation = generation;
+		return text;
 	}
+	return NULL;
+}
 
-	if (success)
+/**
+ * Section of a message as its schema serializes it
+ */
+static bool SerializeSection(const ClimateProto_Schema *schema, const void *message, char **data)
+{
+	int length = ClimateProto_Serialize(schema, message, NULL, 0);
+
+	if (length < 0)
+	{
+		return false;
+	}
+	*data = (char *)Flow_MemAlloc(length + 1);
+	if (*data)
 	{
-		sprintf(heartBeat, "%u", me->sensorConfig.heartBeat);
+		ClimateProto_Serialize(schema, message, *data, length + 1);
+		return true;
+	}
+	return false;
+}
 
-		msgSize = strlen(msgXML)
-					+ strlen(readIntervalTag)
-					+ strlen(readDeltaTag) + 1;
+/**
+ * Value in fixed point with the given fraction bits, rounded
+ */
+static int ToFixedPoint(float value, unsigned int fractionBits)
+{
+	value *= (float)(1u << fractionBits);
+	return (int)((value < 0.0f) ? value - 0.5f : value + 0.5f);
+}
 
-		*data = (char *)Flow_MemAlloc(msgSize);
+static bool FormatSensorSettings(const Controller *me, char **data)
+{
+	static const unsigned int readIntervalFields[NUM_SENSORS] =
+		{ ClimateProto_SensorSettings_temperatureReadInterval, ClimateProto_SensorSettings_humidityReadInterval };
+	static const unsigned int maxReadIntervalFields[NUM_SENSORS] =
+		{ ClimateProto_SensorSettings_temperatureMaxReadInterval, ClimateProto_SensorSettings_humidityMaxReadInterval };
+	static const unsigned int readDeltaFields[NUM_SENSORS] =
+		{ ClimateProto_SensorSettings_temperatureReadDelta, ClimateProto_SensorSettings_humidityReadDelta };
+	static const unsigned int medianSizeFields[NUM_SENSORS] =
+		{ ClimateProto_SensorSettings_temperatureMedianSize, ClimateProto_SensorSettings_humidityMedianSize };
+	static const unsigned int filterAlphaFields[NUM_SENSORS] =
+		{ ClimateProto_SensorSettings_temperatureFilterAlpha, ClimateProto_SensorSettings_humidityFilterAlpha };
+	static const unsigned int offsetFields[NUM_SENSORS] =
+		{ ClimateProto_SensorSettings_temperatureOffset, ClimateProto_SensorSettings_humidityOffset };
+	static const unsigned int gainFields[NUM_SENSORS] =
+		{ ClimateProto_SensorSettings_temperatureGain, ClimateProto_SensorSettings_humidityGain };
+	static const unsigned int curveFields[NUM_SENSORS] =
+		{ ClimateProto_SensorSettings_temperatureCurve, ClimateProto_SensorSettings_humidityCurve };
+	const ClimateProto_Schema *schema = &ClimateProto_SensorSettingsSchema;
+	ClimateProto_SensorSettings settings = { 0 };
+	unsigned int i;
 
-		if (*data)
+	ClimateProto_SetUint(schema, &settings, ClimateProto_SensorSettings_heartBeat, me->sensorConfig.heartBeat);
+	for (i = 0; i < NUM_SENSORS; ++i)
+	{
+		ClimateProto_SetUint(schema, &settings, readIntervalFields[i], me->sensors[i].readInterval);
+		ClimateProto_SetFloat(schema, &settings, readDeltaFields[i], me->sensors[i].readDelta);
+		//Back off, filters and calibration are only sent if configured, so that sensor keeps its defaults otherwise
+		if (me->sensors[i].maxReadInterval)
 		{
-			time_t time;
-			Flow_GetTime(&time);
-			struct tm timeNow;
-			gmtime_r(&time, &timeNow);
-
-			snprintf(*data, msgSize, msgXML,
-							timeNow.tm_year + 1900,
-							timeNow.tm_mon + 1,
-							timeNow.tm_mday,
-							timeNow.tm_hour,
-							timeNow.tm_min,
-							timeNow.tm_sec,
-							heartBeat,
-							readIntervalTag,
-							readDeltaTag);
+			ClimateProto_SetUint(schema, &settings, maxReadIntervalFields[i], me->sensors[i].maxReadInterval);
 		}
-		else
+		if (me->sensors[i].medianSize)
 		{
-			success = false;
+			ClimateProto_SetUint(schema, &settings, medianSizeFields[i], me->sensors[i].medianSize);
+		}
+		if (me->sensors[i].filterAlpha > 0.0f)
+		{
+			ClimateProto_SetUint(schema, &settings, filterAlphaFields[i],
+									ToFixedPoint(me->sensors[i].filterAlpha, CLIMATE_PROTO_FILTER_ALPHA_FRACTION_BITS));
+		}
+		if (me->sensors[i].calibration.gain != 0.0f)
+		{
+			const Calibration *calibration = &me->sensors[i].calibration;
+
+			//In fixed point, which sensor applies as it is
+			ClimateProto_SetInt(schema, &settings, offsetFields[i],
+								ToFixedPoint(calibration->offset, CLIMATE_PROTO_OFFSET_FRACTION_BITS));
+			ClimateProto_SetInt(schema, &settings, gainFields[i],
+								ToFixedPoint(calibration->gain, CLIMATE_PROTO_GAIN_FRACTION_BITS));
+			ClimateProto_SetInt(schema, &settings, curveFields[i],
+								ToFixedPoint(calibration->curve, CLIMATE_PROTO_CURVE_FRACTION_BITS));
 		}
 	}
+	if (me->config.heartBeatKeyframe)
+	{
+		//Only sent in delta mode, so that sensor sends full events otherwise
+		ClimateProto_SetUint(schema, &settings, ClimateProto_SensorSettings_heartBeatKeyframe, me->config.heartBeatKeyframe);
+	}
+	return SerializeSection(schema, &settings, data);
+}
 
-	FreeMemory(readDeltaTag);
-	FreeMemory(readIntervalTag);
-	return success;
+static bool FormatActuatorSettings(const Controller *me, char **data)
+{
+	ClimateProto_ActuatorSettings settings = { 0 };
+
+	ClimateProto_SetUint(&ClimateProto_ActuatorSettingsSchema, &settings, ClimateProto_ActuatorSettings_heartBeat,
+							me->actuatorConfig.heartBeat);
+	return SerializeSection(&ClimateProto_ActuatorSettingsSchema, &settings, data);
 }
 
-bool ConstructSettingsCommandForActuator(const ActuatorConfig config, char **data)
+/**
+ * UPDATE_SETTINGS command to a device, with its serialized settings
+ */
+static bool ConstructSettingsCommand(const char *settings, char **data)
 {
 	unsigned int msgSize = 0;
-	char heartBeat[INT_STR_SIZE];
-	char msgXML[] = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+	char msgXML[] = CLIMATE_PROTO_XML_DECLARATION
 							"<command>"
-								"<time type=\"datetime\">%04d-%02d-%02dT%02d:%02d:%02dZ</time>"
+								CLIMATE_PROTO_TIME_XML
 								"<info>UPDATE_SETTINGS</info>"
+								WIRE_FORMAT_XML_TAG
 								"<settings>"
-									"<HeartBeat>%s</HeartBeat>"
+									"%s"
 								"</settings>"
 							"</command>";
 
-	sprintf(heartBeat, "%u", config.heartBeat);
+	if (!settings)
+	{
+		return false;
+	}
 
-	msgSize = strlen(msgXML) + strlen(heartBeat) + 1;
+	msgSize = strlen(msgXML) + strlen(settings) + 1;
 
 	*data = (char *)Flow_MemAlloc(msgSize);
 
@@ -195,25 +278,33 @@ bool ConstructSettingsCommandForActuator(const ActuatorConfig config, char **dat
 		gmtime_r(&time, &timeNow);
 
 		snprintf(*data, msgSize, msgXML,
-						timeNow.tm_year + 1900,
-						timeNow.tm_mon + 1,
-						timeNow.tm_mday,
-						timeNow.tm_hour,
-						timeNow.tm_min,
-						timeNow.tm_sec,
-						heartBeat);
+						CLIMATE_PROTO_TIME_ARGS(timeNow),
+						settings);
 		return true;
 	}
 	return false;
 }
 
+bool ConstructSettingsCommandForSensor(Controller *me, char **data)
+{
+	return ConstructSettingsCommand(GetCachedSection(me, &me->sensorSettings, ControllerSection_Settings,
+										FormatSensorSettings, &controllerStats.sensorSettingsCache), data);
+}
+
+bool ConstructSettingsCommandForActuator(Controller *me, char **data)
+{
+	return ConstructSettingsCommand(GetCachedSection(me, &me->actuatorSettings, ControllerSection_Settings,
+										FormatActuatorSettings, &controllerStats.actuatorSettingsCache), data);
+}
+
 bool ConstructResponseForUser(const char *response, char **data)
 {
 	unsigned int msgSize = 0;
-	char msgXML[] = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+	char msgXML[] = CLIMATE_PROTO_XML_DECLARATION
 							"<response>"
-								"<time type=\"datetime\">%04d-%02d-%02dT%02d:%02d:%02dZ</time>"
+								CLIMATE_PROTO_TIME_XML
 								"<info>%s</info>"
+								WIRE_FORMAT_XML_TAG
 							"</response>";
 
 	msgSize = strlen(msgXML) + strlen(response) + 1;
@@ -228,12 +319,7 @@ bool ConstructResponseForUser(const char *response, char **data)
 		gmtime_r(&time, &timeNow);
 
 		snprintf(*data, msgSize, msgXML,
-						timeNow.tm_year + 1900,
-						timeNow.tm_mon + 1,
-						timeNow.tm_mday,
-						timeNow.tm_hour,
-						timeNow.tm_min,
-						timeNow.tm_sec,
+						CLIMATE_PROTO_TIME_ARGS(timeNow),
 						response);
 		return true;
 	}
@@ -243,11 +329,12 @@ bool ConstructResponseForUser(const char *response, char **data)
 bool ConstructPingResponseForUser(const char *response, char **data)
 {
 	unsigned int msgSize = 0;
-	char msgXML[] = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+	char msgXML[] = CLIMATE_PROTO_XML_DECLARATION
 							"<response>"
-								"<time type=\"datetime\">%04d-%02d-%02dT%02d:%02d:%02dZ</time>"
+								CLIMATE_PROTO_TIME_XML
 								"<info>PING</info>"
 								"<app_time>%s</app_time>"
+								WIRE_FORMAT_XML_TAG
 							"</response>";
 
 	msgSize = strlen(msgXML) + strlen(response) + 1;
@@ -262,12 +349,7 @@ bool ConstructPingResponseForUser(const char *response, char **data)
 		gmtime_r(&time, &timeNow);
 
 		snprintf(*data, msgSize, msgXML,
-						timeNow.tm_year + 1900,
-						timeNow.tm_mon + 1,
-						timeNow.tm_mday,
-						timeNow.tm_hour,
-						timeNow.tm_min,
-						timeNow.tm_sec,
+						CLIMATE_PROTO_TIME_ARGS(timeNow),
 						response);
 		return true;
 	}
@@ -276,9 +358,9 @@ bool ConstructPingResponseForUser(const char *response, char **data)
 bool ConstructRelayCommandForActuator(const char *status, char **data)
 {
 	unsigned int msgSize = 0;
-	char msgXML[] = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+	char msgXML[] = CLIMATE_PROTO_XML_DECLARATION
 							"<command>"
-								"<time type=\"datetime\">%04d-%02d-%02dT%02d:%02d:%02dZ</time>"
+								CLIMATE_PROTO_TIME_XML
 								"<info>%s</info>"
 							"</command>";
 
@@ -294,26 +376,21 @@ bool ConstructRelayCommandForActuator(const char *status, char **data)
 		gmtime_r(&time, &timeNow);
 
 		snprintf(*data, msgSize, msgXML,
-						timeNow.tm_year + 1900,
-						timeNow.tm_mon + 1,
-						timeNow.tm_mday,
-						timeNow.tm_hour,
-						timeNow.tm_min,
-						timeNow.tm_sec,
+						CLIMATE_PROTO_TIME_ARGS(timeNow),
 						status);
 		return true;
 	}
 	return false;
 }
 
-bool ConstructDeviceStatusMsgForUser(const Controller *me, char **data)
+static bool FormatDeviceStatusMsgForUser(const Controller *me, char **data)
 {
 	unsigned int msgSize = 0;
 	const char *sensorStatus = me->sensorConfig.isAlive?ALIVE_STR:DEAD_STR;
 	const char *actuatorStatus = me->actuatorConfig.isAlive?ALIVE_STR:DEAD_STR;
-	char msgXML[] = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+	char msgXML[] = CLIMATE_PROTO_XML_DECLARATION
 							"<event>"
-								"<time type=\"datetime\">%04d-%02d-%02dT%02d:%02d:%02dZ</time>"
+								CLIMATE_PROTO_TIME_XML
 								"<type>DeviceStatus</type>"
 								"<info>"
 									"<Sensor>%s</Sensor>"
@@ -333,12 +410,7 @@ bool ConstructDeviceStatusMsgForUser(const Controller *me, char **data)
 		gmtime_r(&time, &timeNow);
 
 		snprintf(*data, msgSize, msgXML,
-						timeNow.tm_year + 1900,
-						timeNow.tm_mon + 1,
-						timeNow.tm_mday,
-						timeNow.tm_hour,
-						timeNow.tm_min,
-						timeNow.tm_sec,
+						CLIMATE_PROTO_TIME_ARGS(timeNow),
 						sensorStatus,
 						actuatorStatus);
 		return true;
@@ -346,16 +418,16 @@ bool ConstructDeviceStatusMsgForUser(const Controller *me, char **data)
 	return false;
 }
 
-bool ConstructSensorStatusMsgForUser(const Controller *me, char **data)
+static bool FormatSensorStatusMsgForUser(const Controller *me, char **data)
 {
 	unsigned int msgSize = 0;
 	unsigned int i;
 	char *sensorTag = NULL;
 	char tmpTag[TAG_SIZE];
 	bool success = true;
-	char msgXML[] = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+	char msgXML[] = CLIMATE_PROTO_XML_DECLARATION
 							"<event>"
-								"<time type=\"datetime\">%04d-%02d-%02dT%02d:%02d:%02dZ</time>"
+								CLIMATE_PROTO_TIME_XML
 								"<type>Measurement</type>"
 								"<info>%s</info>"
 							"</event>";
@@ -380,12 +452,7 @@ bool ConstructSensorStatusMsgForUser(const Controller *me, char **data)
 			gmtime_r(&time, &timeNow);
 
 			snprintf(*data, msgSize, msgXML,
-							timeNow.tm_year + 1900,
-							timeNow.tm_mon + 1,
-							timeNow.tm_mday,
-							timeNow.tm_hour,
-							timeNow.tm_min,
-							timeNow.tm_sec,
+							CLIMATE_PROTO_TIME_ARGS(timeNow),
 							sensorTag);
 		}
 		else
@@ -398,16 +465,16 @@ bool ConstructSensorStatusMsgForUser(const Controller *me, char **data)
 	return success;
 }
 
-bool ConstructActuatorStatusMsgForUser(const Controller *me, char **data)
+static bool FormatActuatorStatusMsgForUser(const Controller *me, char **data)
 {
 	unsigned int msgSize = 0;
 	unsigned int i;
 	char *relayTag = NULL;
 	char tmpTag[TAG_SIZE];
 	bool success = true;
-	char msgXML[] = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+	char msgXML[] = CLIMATE_PROTO_XML_DECLARATION
 							"<event>"
-								"<time type=\"datetime\">%04d-%02d-%02dT%02d:%02d:%02dZ</time>"
+								CLIMATE_PROTO_TIME_XML
 								"<type>RelayStatus</type>"
 								"<info>%s</info>"
 							"</event>";
@@ -434,12 +501,7 @@ bool ConstructActuatorStatusMsgForUser(const Controller *me, char **data)
 			gmtime_r(&time, &timeNow);
 
 			snprintf(*data, msgSize, msgXML,
-							timeNow.tm_year + 1900,
-							timeNow.tm_mon + 1,
-							timeNow.tm_mday,
-							timeNow.tm_hour,
-							timeNow.tm_min,
-							timeNow.tm_sec,
+							CLIMATE_PROTO_TIME_ARGS(timeNow),
 							relayTag);
 		}
 		else
@@ -452,7 +514,7 @@ bool ConstructActuatorStatusMsgForUser(const Controller *me, char **data)
 	return success;
 }
 
-bool ConstructSetting(const Controller *me, char **data)
+static bool FormatSetting(const Controller *me, char **data)
 {
 	unsigned int msgSize = 0;
 	unsigned int i;
@@ -460,17 +522,21 @@ bool ConstructSetting(const Controller *me, char **data)
 	char *orientationTag = NULL;
 	char *readIntervalTag = NULL;
 	char *readDeltaTag = NULL;
+	char *controlTag = NULL;
 	char tmpTag[TAG_SIZE];
 	char controllerHeartBeat[INT_STR_SIZE];
+	char controlWindow[INT_STR_SIZE];
 	char sensorHeartBeat[INT_STR_SIZE];
 	char actuatorHeartBeat[INT_STR_SIZE];
 	bool success = true;
-	char msgXML[] = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+	char msgXML[] = CLIMATE_PROTO_XML_DECLARATION
 							"<ControllerConfig>"
 								"<version>1.0</version>"
 								"%s"
 								"%s"
 								"<HeartBeat>%s</HeartBeat>"
+								"%s"
+								"<ControlWindow>%s</ControlWindow>"
 								"<SensorConfig>"
 									"<HeartBeat>%s</HeartBeat>"
 									"%s"
@@ -504,6 +570,16 @@ bool ConstructSetting(const Controller *me, char **data)
 				{
 					sprintf(tmpTag, me->sensors[i].readDeltaTagString, me->sensors[i].readDelta);
 					success = CreateTagString(&readDeltaTag, tmpTag);
+
+					if (success)
+					{
+						sprintf(tmpTag, me->sensors[i].controlTagString,
+								isControlPid(me->sensors[i].control)?PID_STR:THRESHOLD_STR,
+								me->sensors[i].gains.kp,
+								me->sensors[i].gains.ki,
+								me->sensors[i].gains.kd);
+						success = CreateTagString(&controlTag, tmpTag);
+					}
 				}
 			}
 		}
@@ -512,6 +588,7 @@ bool ConstructSetting(const Controller *me, char **data)
 	if (success)
 	{
 		sprintf(controllerHeartBeat, "%u", me->config.heartBeat);
+		sprintf(controlWindow, "%u", me->config.controlWindow);
 		sprintf(sensorHeartBeat, "%u", me->sensorConfig.heartBeat);
 		sprintf(actuatorHeartBeat, "%u", me->actuatorConfig.heartBeat);
 
@@ -520,7 +597,9 @@ bool ConstructSetting(const Controller *me, char **data)
 					+ strlen(orientationTag)
 					+ strlen(readIntervalTag)
 					+ strlen(readDeltaTag)
+					+ strlen(controlTag)
 					+ strlen(controllerHeartBeat)
+					+ strlen(controlWindow)
 					+ strlen(sensorHeartBeat)
 					+ strlen(actuatorHeartBeat) + 1;
 
@@ -532,6 +611,8 @@ bool ConstructSetting(const Controller *me, char **data)
 						thresholdTag,
 						orientationTag,
 						controllerHeartBeat,
+						controlTag,
+						controlWindow,
 						sensorHeartBeat,
 						readIntervalTag,
 						readDeltaTag,
@@ -543,6 +624,7 @@ bool ConstructSetting(const Controller *me, char **data)
 		}
 	}
 
+	FreeMemory(controlTag);
 	FreeMemory(readDeltaTag);
 	FreeMemory(readIntervalTag);
 	FreeMemory(orientationTag);
@@ -550,7 +632,27 @@ bool ConstructSetting(const Controller *me, char **data)
 	return success;
 }
 
-bool ConstructHeartBeatMsgForUser(const Controller *me, char **data)
+/**
+ * Settings carry no time, so the cached message is sent as it is
+ */
+bool ConstructSetting(Controller *me, char **data)
+{
+	const char *setting = GetCachedSection(me, &me->setting, ControllerSection_Settings,
+											FormatSetting, &controllerStats.settingCache);
+
+	if (setting)
+	{
+		*data = (char *)Flow_MemAlloc(strlen(setting) + 1);
+		if (*data)
+		{
+			strcpy(*data, setting);
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool FormatHeartBeatMsgForUser(const Controller *me, char **data)
 {
 	unsigned int i;
 	unsigned int msgSize = 0;
@@ -559,9 +661,9 @@ bool ConstructHeartBeatMsgForUser(const Controller *me, char **data)
 	bool success = true;
 	const char *sensorStatus = me->sensorConfig.isAlive?ALIVE_STR:DEAD_STR;
 	const char *actuatorStatus = me->actuatorConfig.isAlive?ALIVE_STR:DEAD_STR;
-	char msgXML[] = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+	char msgXML[] = CLIMATE_PROTO_XML_DECLARATION
 						"<event>"
-							"<time type=\"datetime\">%04d-%02d-%02dT%02d:%02d:%02dZ</time>"
+							CLIMATE_PROTO_TIME_XML
 							"<type>HeartBeat</type>"
 							"<info>"
 								"%s"
@@ -601,12 +703,7 @@ bool ConstructHeartBeatMsgForUser(const Controller *me, char **data)
 			gmtime_r(&time, &timeNow);
 
 			snprintf(*data, msgSize, msgXML,
-							timeNow.tm_year + 1900,
-							timeNow.tm_mon + 1,
-							timeNow.tm_mday,
-							timeNow.tm_hour,
-							timeNow.tm_min,
-							timeNow.tm_sec,
+							CLIMATE_PROTO_TIME_ARGS(timeNow),
 							sensorTag,
 							relayTag,
 							sensorStatus,
@@ -623,3 +720,386 @@ bool ConstructHeartBeatMsgForUser(const Controller *me, char **data)
 	return success;
 }
 
+/**
+ * Render templates of the periodic messages to user. Sensor and relay
+ * tags come from controller's configuration, so this follows
+ * ControllerSetDefaults(). A template that fails to render is left
+ * invalid, and its message is formatted instead.
+ */
+void ConstructMessageTemplates(Controller *me)
+{
+	MessageTemplate *template;
+	unsigned int i;
+
+	template = &me->heartBeatTemplate;
+	MessageTemplate_Init(template);
+	MessageTemplate_AppendText(template, CLIMATE_PROTO_XML_DECLARATION "<event><time type=\"datetime\">");
+	MessageTemplate_AppendTime(template);
+	MessageTemplate_AppendText(template, "</time><type>HeartBeat</type><info>");
+	for (i = 0; i < NUM_SENSORS; ++i)
+	{
+		MessageTemplate_AppendFormat(template, me->sensors[i].sensorTagString, 0);
+	}
+	for (i = 0; i < NUM_RELAYS; ++i)
+	{
+		MessageTemplate_AppendFormat(template, me->relays[i].relayTagString, ENUM_SLOT_WIDTH);
+	}
+	MessageTemplate_AppendFormat(template, "<Sensor>%s</Sensor><Actuator>%s</Actuator></info></event>", ENUM_SLOT_WIDTH);
+	memcpy(me->heartBeat.text, template->text, sizeof(me->heartBeat.text));
+	memset(me->heartBeat.generations, 0, sizeof(me->heartBeat.generations));
+
+	template = &me->sensorStatusTemplate;
+	MessageTemplate_Init(template);
+	MessageTemplate_AppendText(template, CLIMATE_PROTO_XML_DECLARATION "<event><time type=\"datetime\">");
+	MessageTemplate_AppendTime(template);
+	MessageTemplate_AppendText(template, "</time><type>Measurement</type><info>");
+	for (i = 0; i < NUM_SENSORS; ++i)
+	{
+		MessageTemplate_AppendFormat(template, me->sensors[i].sensorTagString, 0);
+	}
+	MessageTemplate_AppendText(template, "</info></event>");
+
+	template = &me->actuatorStatusTemplate;
+	MessageTemplate_Init(template);
+	MessageTemplate_AppendText(template, CLIMATE_PROTO_XML_DECLARATION "<event><time type=\"datetime\">");
+	MessageTemplate_AppendTime(template);
+	MessageTemplate_AppendText(template, "</time><type>RelayStatus</type><info>");
+	for (i = 0; i < NUM_RELAYS; ++i)
+	{
+		MessageTemplate_AppendFormat(template, me->relays[i].relayTagString, ENUM_SLOT_WIDTH);
+	}
+	MessageTemplate_AppendText(template, "</info></event>");
+
+	template = &me->deviceStatusTemplate;
+	MessageTemplate_Init(template);
+	MessageTemplate_AppendText(template, CLIMATE_PROTO_XML_DECLARATION "<event><time type=\"datetime\">");
+	MessageTemplate_AppendTime(template);
+	MessageTemplate_AppendFormat(template, "</time><type>DeviceStatus</type><info>"
+									"<Sensor>%s</Sensor><Actuator>%s</Actuator></info></event>", ENUM_SLOT_WIDTH);
+}
+
+/**
+ * Copy of template with its time slot (always first) set to now.
+ * Following slots are patched by the caller.
+ */
+static char *CopyTemplate(const MessageTemplate *template)
+{
+	char *message = MessageTemplate_Copy(template);
+	time_t time;
+
+	if (message)
+	{
+		Flow_GetTime(&time);
+		if (!MessageTemplate_SetTime(template, message, 0, time))
+		{
+			Flow_MemFree((void **)&message);
+		}
+	}
+	return message;
+}
+
+static bool PatchSensors(const Controller *me, const MessageTemplate *template, char *message, unsigned int *slot)
+{
+	bool success = true;
+	unsigned int i;
+
+	for (i = 0; (i < NUM_SENSORS) && success; ++i)
+	{
+		success = MessageTemplate_SetFloat(template, message, (*slot)++, me->sensors[i].value);
+	}
+	return success;
+}
+
+static bool PatchRelays(const Controller *me, const MessageTemplate *template, char *message, unsigned int *slot)
+{
+	bool success = true;
+	unsigned int i;
+
+	for (i = 0; (i < NUM_RELAYS) && success; ++i)
+	{
+		success = MessageTemplate_SetString(template, message, (*slot)++, isRelayAuto(me->relays[i].mode)?AUTO_STR:MANUAL_STR) &&
+				MessageTemplate_SetString(template, message, (*slot)++, isRelayOn(me->relays[i].status)?ON_STR:OFF_STR);
+	}
+	return success;
+}
+
+static bool PatchDeviceStatus(const Controller *me, const MessageTemplate *template, char *message, unsigned int *slot)
+{
+	return MessageTemplate_SetString(template, message, (*slot)++, me->sensorConfig.isAlive?ALIVE_STR:DEAD_STR) &&
+			MessageTemplate_SetString(template, message, (*slot)++, me->actuatorConfig.isAlive?ALIVE_STR:DEAD_STR);
+}
+
+/**
+ * Hand over a patched message, or drop it so that the caller formats one
+ */
+static bool Patched(bool success, char *message, char **data)
+{
+	if (success)
+	{
+		*data = message;
+		return true;
+	}
+	FreeMemory(message);
+	return false;
+}
+
+bool ConstructDeviceStatusMsgForUser(const Controller *me, char **data)
+{
+	char *message = CopyTemplate(&me->deviceStatusTemplate);
+	unsigned int slot = 1;
+
+	if (message && Patched(PatchDeviceStatus(me, &me->deviceStatusTemplate, message, &slot), message, data))
+	{
+		return true;
+	}
+	return FormatDeviceStatusMsgForUser(me, data);
+}
+
+bool ConstructSensorStatusMsgForUser(const Controller *me, char **data)
+{
+	char *message = CopyTemplate(&me->sensorStatusTemplate);
+	unsigned int slot = 1;
+
+	if (message && Patched(PatchSensors(me, &me->sensorStatusTemplate, message, &slot), message, data))
+	{
+		return true;
+	}
+	return FormatSensorStatusMsgForUser(me, data);
+}
+
+bool ConstructActuatorStatusMsgForUser(const Controller *me, char **data)
+{
+	char *message = CopyTemplate(&me->actuatorStatusTemplate);
+	unsigned int slot = 1;
+
+	if (message && Patched(PatchRelays(me, &me->actuatorStatusTemplate, message, &slot), message, data))
+	{
+		return true;
+	}
+	return FormatActuatorStatusMsgForUser(me, data);
+}
+
+typedef bool (*SectionPatcher)(const Controller *me, const MessageTemplate *template, char *message, unsigned int *slot);
+
+//Sections of heartbeat, in slot order after time
+static const struct
+{
+	ControllerSection section;
+	SectionPatcher patch;
+	unsigned int slots;
+}_heartBeatSections[] =
+{
+	{ ControllerSection_Sensors, PatchSensors, NUM_SENSORS },
+	{ ControllerSection_Relays, PatchRelays, 2 * NUM_RELAYS },
+	{ ControllerSection_Liveness, PatchDeviceStatus, 2 },
+};
+
+/**
+ * Heartbeat is kept patched in me->heartBeat, rewriting only sections
+ * changed since the last one, and sent as a copy with time patched in.
+ */
+static bool PatchHeartBeat(Controller *me, char **data)
+{
+	const MessageTemplate *template = &me->heartBeatTemplate;
+	PatchedMessage *heartBeat = &me->heartBeat;
+	unsigned int i, slot = 1;
+	char *message;
+	time_t time;
+
+	if (!template->isValid)
+	{
+		return false;
+	}
+
+	for (i = 0; i < sizeof(_heartBeatSections) / sizeof(_heartBeatSections[0]); ++i)
+	{
+		ControllerSection section = _heartBeatSections[i].section;
+		unsigned int nextSlot = slot + _heartBeatSections[i].slots;
+
+		if (heartBeat->generations[section] == me->generations[section])
+		{
+			controllerStats.heartBeatCache.hits++;
+		}
+		else
+		{
+			controllerStats.heartBeatCache.misses++;
+			if (!_heartBeatSections[i].patch(me, template, heartBeat->text, &slot))
+			{
+				heartBeat->generations[section] = 0;
+				return false;
+			}
+			heartBeat->generations[section] = me->generations[section];
+		}
+		slot = nextSlot;
+	}
+
+	message = (char *)Flow_MemAlloc(template->length + 1);
+	if (message)
+	{
+		memcpy(message, heartBeat->text, template->length + 1);
+		Flow_GetTime(&time);
+		return Patched(MessageTemplate_SetTime(template, message, 0, time), message, data);
+	}
+	return false;
+}
+
+bool ConstructHeartBeatMsgForUser(Controller *me, char **data)
+{
+	return PatchHeartBeat(me, data) || FormatHeartBeatMsgForUser(me, data);
+}
+
+static bool AppendTag(char *text, unsigned int size, unsigned int *length, const char *format, ...)
+{
+	va_list args;
+	int written;
+
+	va_start(args, format);
+	written = vsnprintf(text + *length, size - *length, format, args);
+	va_end(args);
+
+	if ((written < 0) || (*length + written >= size))
+	{
+		return false;
+	}
+	*length += written;
+	return true;
+}
+
+static bool FormatHeartBeatDelta(const Controller *me, unsigned int sequence, unsigned int base, unsigned int fields, char **data)
+{
+	unsigned int msgSize = 0;
+	unsigned int length = 0;
+	unsigned int i;
+	char info[HEARTBEAT_DELTA_SIZE] = "";
+	bool success = true;
+	char msgXML[] = CLIMATE_PROTO_XML_DECLARATION
+						"<event>"
+							CLIMATE_PROTO_TIME_XML
+							"<type>HeartBeatDelta</type>"
+							"<seq>%u</seq>"
+							"<base>%u</base>"
+							"<info>%s</info>"
+						"</event>";
+
+	for (i = 0; (i < NUM_SENSORS) && success; ++i)
+	{
+		if (fields & DELTA_FIELD_SENSOR(i))
+		{
+			success = AppendTag(info, sizeof(info), &length, me->sensors[i].sensorTagString, me->sensors[i].value);
+		}
+	}
+	for (i = 0; (i < NUM_RELAYS) && success; ++i)
+	{
+		if (fields & DELTA_FIELD_RELAY(i))
+		{
+			success = AppendTag(info, sizeof(info), &length, me->relays[i].relayTagString,
+								isRelayAuto(me->relays[i].mode)?AUTO_STR:MANUAL_STR,
+								isRelayOn(me->relays[i].status)?ON_STR:OFF_STR);
+		}
+	}
+	if (success && (fields & DELTA_FIELD_SENSOR_ALIVE))
+	{
+		success = AppendTag(info, sizeof(info), &length, "<Sensor>%s</Sensor>", me->sensorConfig.isAlive?ALIVE_STR:DEAD_STR);
+	}
+	if (success && (fields & DELTA_FIELD_ACTUATOR_ALIVE))
+	{
+		success = AppendTag(info, sizeof(info), &length, "<Actuator>%s</Actuator>", me->actuatorConfig.isAlive?ALIVE_STR:DEAD_STR);
+	}
+
+	if (success)
+	{
+		msgSize = strlen(msgXML) + 2 * INT_STR_SIZE + length + 1;
+
+		*data = (char *)Flow_MemAlloc(msgSize);
+
+		if (*data)
+		{
+			time_t time;
+			Flow_GetTime(&time);
+			struct tm timeNow;
+			gmtime_r(&time, &timeNow);
+
+			snprintf(*data, msgSize, msgXML,
+							CLIMATE_PROTO_TIME_ARGS(timeNow),
+							sequence,
+							base,
+							info);
+		}
+		else
+		{
+			success = false;
+		}
+	}
+	return success;
+}
+
+/**
+ * Heartbeat in delta mode, see HeartBeatKeyframe. A keyframe is sent
+ * every config.heartBeatKeyframe beats, the beats in between carry the
+ * fields that differ from it. Users that miss a keyframe wait for the
+ * next one, while missing other beats loses nothing.
+ */
+bool ConstructHeartBeatDeltaMsgForUser(Controller *me, char **data)
+{
+	HeartBeatKeyframe *keyframe = &me->heartBeatKeyframe;
+	unsigned int sequence = keyframe->sequence + 1;
+	unsigned int fields = 0;
+	unsigned int i;
+
+	if ((sequence == 0) || (keyframe->base == 0) || (sequence - keyframe->base >= me->config.heartBeatKeyframe))
+	{
+		if (sequence == 0)
+		{
+			//Sequence 0 is never sent, as base 0 stands for no keyframe
+			sequence = 1;
+		}
+		if (!FormatHeartBeatDelta(me, sequence, sequence, DELTA_FIELD_ALL, data))
+		{
+			return false;
+		}
+
+		keyframe->base = sequence;
+		for (i = 0; i < NUM_SENSORS; ++i)
+		{
+			keyframe->values[i] = me->sensors[i].value;
+		}
+		for (i = 0; i < NUM_RELAYS; ++i)
+		{
+			keyframe->modes[i] = me->relays[i].mode;
+			keyframe->statuses[i] = me->relays[i].status;
+		}
+		keyframe->isSensorAlive = me->sensorConfig.isAlive;
+		keyframe->isActuatorAlive = me->actuatorConfig.isAlive;
+	}
+	else
+	{
+		for (i = 0; i < NUM_SENSORS; ++i)
+		{
+			if (me->sensors[i].value != keyframe->values[i])
+			{
+				fields |= DELTA_FIELD_SENSOR(i);
+			}
+		}
+		for (i = 0; i < NUM_RELAYS; ++i)
+		{
+			if ((me->relays[i].mode != keyframe->modes[i]) || (me->relays[i].status != keyframe->statuses[i]))
+			{
+				fields |= DELTA_FIELD_RELAY(i);
+			}
+		}
+		if (me->sensorConfig.isAlive != keyframe->isSensorAlive)
+		{
+			fields |= DELTA_FIELD_SENSOR_ALIVE;
+		}
+		if (me->actuatorConfig.isAlive != keyframe->isActuatorAlive)
+		{
+			fields |= DELTA_FIELD_ACTUATOR_ALIVE;
+		}
+		if (!FormatHeartBeatDelta(me, sequence, keyframe->base, fields, data))
+		{
+			return false;
+		}
+	}
+	keyframe->sequence = sequence;
+	return true;
+}
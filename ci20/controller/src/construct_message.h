@@ -41,16 +41,18 @@ extern "C" {
 
 #include "controller.h"
 
-bool ConstructSettingsCommandForSensor(const Controller *me, char **data);
-bool ConstructSettingsCommandForActuator(const ActuatorConfig config, char **data);
+bool ConstructSettingsCommandForSensor(Controller *me, char **data);
+bool ConstructSettingsCommandForActuator(Controller *me, char **data);
 bool ConstructResponseForUser(const char *response, char **data);
 bool ConstructPingResponseForUser(const char *response, char **data);
 bool ConstructRelayCommandForActuator(const char *status, char **data);
 bool ConstructDeviceStatusMsgForUser(const Controller *me, char **data);
 bool ConstructSensorStatusMsgForUser(const Controller *me, char **data);
 bool ConstructActuatorStatusMsgForUser(const Controller *me, char **data);
-bool ConstructSetting(const Controller *me, char **data);
-bool ConstructHeartBeatMsgForUser(const Controller *me, char **data);
+bool ConstructSetting(Controller *me, char **data);
+bool ConstructHeartBeatMsgForUser(Controller *me, char **data);
+bool ConstructHeartBeatDeltaMsgForUser(Controller *me, char **data);
+void ConstructMessageTemplates(Controller *me);
 
 #ifdef	__cplusplus
 }
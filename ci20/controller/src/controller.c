@@ -35,17 +35,25 @@
 #include <stdbool.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <sys/stat.h>
 
 #include "controller.h"
 #include "controller_logging.h"
 #include "flow_interface.h"
 #include "construct_message.h"
+#include "controller_stats.h"
 
 #define SENSOR_HEARTBEAT_EXPIRY (DEFAULT_SENSOR_HEARTBEAT * 2)	//milliseconds
 #define ACTUATOR_HEARTBEAT_EXPIRY (DEFAULT_ACTUATOR_HEARTBEAT * 2)	//milliseconds
 #define FLOAT_COMPARE_PRECISION (100)
+#define HISTORY_ZONE (0)	//Single climate zone per controller
+#define HISTORY_NO_TEMPERATURE (-32768)
+#define HISTORY_NO_HUMIDITY (65535)
+#define HISTORY_RESTORE_SPAN (TIME_SERIES_HOUR_BUCKETS * 3600)	//seconds, as far back as rollups reach
+#define HISTORY_SERVER_STACK_SIZE (8192)
+#define HISTORY_SERVER_PRIORITY (1)
 
-#define EVENT_STR "event"
 #define COMMAND_STR "command"
 #define SENSOR_STR "Sensor"
 #define ACTUATOR_STR "Actuator"
@@ -62,6 +70,8 @@
 #define RETRIEVE_SETTINGS_STR "RETRIEVE_SETTINGS"
 #define ABOVE_STR "ABOVE"
 #define BELOW_STR "BELOW"
+#define THRESHOLD_STR "THRESHOLD"
+#define PID_STR "PID"
 
 //XML strings for parsing received messages
 #define TEMPERATURE_THRESHOLD_XML_STR "ControllerConfig/TemperatureThreshold"
@@ -69,19 +79,34 @@
 #define TEMPERATURE_ORIENTATION_XML_STR "ControllerConfig/TemperatureOrientation"
 #define HUMIDITY_ORIENTATION_XML_STR "ControllerConfig/HumidityOrientation"
 #define CONTROLLER_HEARTBEAT_XML_STR "ControllerConfig/HeartBeat"
+#define HEARTBEAT_KEYFRAME_XML_STR "ControllerConfig/HeartBeatKeyframe"
 #define SENSOR_HEARTBEAT_XML_STR "ControllerConfig/SensorConfig/HeartBeat"
 #define TEMP_READ_INTERVAL_XML_STR "ControllerConfig/SensorConfig/TemperatureReadInterval"
 #define HMDT_READ_INTERVAL_XML_STR "ControllerConfig/SensorConfig/HumidityReadInterval"
+#define TEMP_MAX_READ_INTERVAL_XML_STR "ControllerConfig/SensorConfig/TemperatureMaxReadInterval"
+#define HMDT_MAX_READ_INTERVAL_XML_STR "ControllerConfig/SensorConfig/HumidityMaxReadInterval"
 #define TEMP_READ_DELTA_XML_STR "ControllerConfig/SensorConfig/TemperatureReadDelta"
 #define HMDT_READ_DELTA_XML_STR "ControllerConfig/SensorConfig/HumidityReadDelta"
 #define ACTUATOR_HEARTBEAT_XML_STR "ControllerConfig/ActuatorConfig/HeartBeat"
-#define EVENT_TYPE_XML_STR "event/type"
-#define EVENT_TEMPERATURE_XML_STR "event/info/Temperature"
-#define EVENT_HUMIDITY_XML_STR "event/info/Humidity"
-#define EVENT_RELAY_1_XML_STR "event/info/Relay_1"
-#define EVENT_RELAY_2_XML_STR "event/info/Relay_2"
+#define CONTROL_WINDOW_XML_STR "ControllerConfig/ControlWindow"
+#define TEMPERATURE_CONTROL_XML_STR "ControllerConfig/TemperatureControl"
+#define HUMIDITY_CONTROL_XML_STR "ControllerConfig/HumidityControl"
+#define CONTROL_MODE_XML_STR "Mode"
+#define CONTROL_KP_XML_STR "Kp"
+#define CONTROL_KI_XML_STR "Ki"
+#define CONTROL_KD_XML_STR "Kd"
+#define TEMPERATURE_CALIBRATION_XML_STR "ControllerConfig/SensorConfig/TemperatureCalibration"
+#define HUMIDITY_CALIBRATION_XML_STR "ControllerConfig/SensorConfig/HumidityCalibration"
+#define CALIBRATION_OFFSET_XML_STR "Offset"
+#define CALIBRATION_GAIN_XML_STR "Gain"
+#define CALIBRATION_CURVE_XML_STR "Curve"
+#define TEMP_MEDIAN_SIZE_XML_STR "ControllerConfig/SensorConfig/TemperatureMedianSize"
+#define HMDT_MEDIAN_SIZE_XML_STR "ControllerConfig/SensorConfig/HumidityMedianSize"
+#define TEMP_FILTER_ALPHA_XML_STR "ControllerConfig/SensorConfig/TemperatureFilterAlpha"
+#define HMDT_FILTER_ALPHA_XML_STR "ControllerConfig/SensorConfig/HumidityFilterAlpha"
 #define COMMAND_INFO_XML_STR "command/info"
 #define COMMAND_APP_TIME_XML_STR "command/app_time"
+#define COMMAND_WIRE_XML_STR "command/wire"
 
 struct tm *gmtime_r(const time_t *timep, struct tm *result);
 
@@ -104,6 +129,87 @@ typedef enum
 	Device_Actuator,
 }Device_Type;
 
+static const Controller _DefaultController =
+{
+	.isUserUpdate = false,
+	.isStarted = false,
+	.stateDir = DEFAULT_STATE_DIR,
+	.config =
+	{
+		.heartBeat = DEFAULT_HEARTBEAT,
+		.controlWindow = DEFAULT_CONTROL_WINDOW,
+		.controlTick = DEFAULT_CONTROL_TICK,
+	},
+	.sensorConfig =
+	{
+		.isAlive = false,
+		.hasSettings = false,
+		.sensorId = NULL,
+		.heartBeat = DEFAULT_SENSOR_HEARTBEAT,
+	},
+	.actuatorConfig =
+	{
+		.isAlive = false,
+		.hasSettings = false,
+		.actuatorId = NULL,
+		.heartBeat = DEFAULT_ACTUATOR_HEARTBEAT,
+	},
+	.sensors =
+	{
+		{
+			.type = Sensor_Temperature,
+			.threshold = DEFAULT_TEMP_THRESHOLD,
+			.value = DEFAULT_SENSOR_VALUE,
+			.orientation = Orientation_Below,
+			.readInterval = DEFAULT_TEMP_READ_INTERVAL,
+			.readDelta = DEFAULT_TEMP_READ_DELTA,
+			.control = Control_Threshold,
+			.gains = { DEFAULT_TEMP_KP, DEFAULT_TEMP_KI, DEFAULT_TEMP_KD },
+			.sensorTagString = TEMPERATURE_XML_TAG,
+			.thresholdTagString = TEMP_THRESHOLD_XML_TAG,
+			.orientationTagString = TEMP_ORIENTATION_XML_TAG,
+			.readIntervalTagString = TEMP_READ_INTERVAL_XML_TAG,
+			.readDeltaTagString = TEMP_READ_DELTA_XML_TAG,
+			.controlTagString = TEMP_CONTROL_XML_TAG,
+		},
+		{
+			.type = Sensor_Humidity,
+			.threshold = DEFAULT_HMDT_THRESHOLD,
+			.value = DEFAULT_SENSOR_VALUE,
+			.orientation = Orientation_Above,
+			.readInterval = DEFAULT_HMDT_READ_INTERVAL,
+			.readDelta = DEFAULT_HMDT_READ_DELTA,
+			.control = Control_Threshold,
+			.gains = { DEFAULT_HMDT_KP, DEFAULT_HMDT_KI, DEFAULT_HMDT_KD },
+			.sensorTagString = HUMIDITY_XML_TAG,
+			.thresholdTagString = HMDT_THRESHOLD_XML_TAG,
+			.orientationTagString = HMDT_ORIENTATION_XML_TAG,
+			.readIntervalTagString = HMDT_READ_INTERVAL_XML_TAG,
+			.readDeltaTagString = HMDT_READ_DELTA_XML_TAG,
+			.controlTagString = HMDT_CONTROL_XML_TAG,
+		},
+	},
+	.relays =
+	{
+		{
+			.type = Relay_Heater,
+			.status = Relay_Off,
+			.mode = Relay_Auto,
+			.relayTagString = RELAY_1_XML_TAG,
+			.relayName = RELAY_1_STR,
+		},
+		{
+			.type = Relay_Fan,
+			.status = Relay_Off,
+			.mode = Relay_Auto,
+			.relayTagString = RELAY_2_XML_TAG,
+			.relayName = RELAY_2_STR,
+		},
+	},
+	.historyLock = PTHREAD_MUTEX_INITIALIZER,
+	.generations = { 1, 1, 1, 1 },	//Cached sections start at 0, so are built on first use
+};
+
 static void FreeEvent(ControllerEvent *event)
 {
 	if (event->details)
@@ -114,9 +220,9 @@ static void FreeEvent(ControllerEvent *event)
 }
 
 /**
- * Send a message to self for sending a heartBeat command
+ * Send an event without details to self, e.g. heartBeat or control tick
  */
-static bool PostControllerEventHeartBeat(const FlowQueue* receiveMsgQueue)
+static bool PostControllerEvent(const FlowQueue* receiveMsgQueue, ControllerEvent_Type evtType)
 {
 	bool success = false;
 	ControllerEvent *event = NULL;
@@ -125,7 +231,7 @@ static bool PostControllerEventHeartBeat(const FlowQueue* receiveMsgQueue)
 	event = (ControllerEvent *)Flow_MemAlloc(sizeof(ControllerEvent));
 	if (event)
 	{
-		event->evtType = ControllerEvent_HeartBeat;
+		event->evtType = evtType;
 		event->details = NULL;
 
 		success = FlowQueue_Enqueue(*receiveMsgQueue, event);
@@ -273,7 +379,7 @@ static bool PostFlowInterfaceCmdSetSetting(const FlowQueue* sendMsgQueue, char *
  * Construct a message for user or device.
  * And post it on flow interface thread.
  */
-static bool SendCommand(const Controller *me, const char *msg, Message_Type type)
+static bool SendCommand(Controller *me, const char *msg, Message_Type type)
 {
 	char *data = NULL;
 	bool isDevice = false;
@@ -316,7 +422,14 @@ static bool SendCommand(const Controller *me, const char *msg, Message_Type type
 		}
 		case Message_HeartBeatToUser:
 		{
-			success = ConstructHeartBeatMsgForUser(me, &data);
+			if (me->config.heartBeatKeyframe)
+			{
+				success = ConstructHeartBeatDeltaMsgForUser(me, &data);
+			}
+			else
+			{
+				success = ConstructHeartBeatMsgForUser(me, &data);
+			}
 			break;
 		}
 		case Message_UpdateSettingsToSensor:
@@ -329,7 +442,7 @@ static bool SendCommand(const Controller *me, const char *msg, Message_Type type
 		case Message_UpdateSettingsToActuator:
 		{
 			isDevice = true;
-			success = ConstructSettingsCommandForActuator(me->actuatorConfig, &data);
+			success = ConstructSettingsCommandForActuator(me, &data);
 			break;
 		}
 		default:
@@ -338,6 +451,20 @@ static bool SendCommand(const Controller *me, const char *msg, Message_Type type
 
 	if (success)
 	{
+		WireFormat wireFormat = !isDevice ? me->userWireFormat :
+								(deviceType == Device_Sensor) ? me->sensorConfig.wireFormat : me->actuatorConfig.wireFormat;
+		if (wireFormat == WireFormat_Compact)
+		{
+			char *compact = WireFormat_ToCompact(data);
+
+			//Peer takes XML too, so that is sent if encoding fails
+			if (compact)
+			{
+				Flow_MemFree((void **)&data);
+				data = compact;
+			}
+		}
+
 		if (isDevice)
 		{
 			if (!PostFlowInterfaceCmdSendMsgToDevice(&me->sendMsgQueue, data, deviceType))
@@ -367,73 +494,38 @@ static bool SendCommand(const Controller *me, const char *msg, Message_Type type
 }
 
 /**
- * Get node value in integer format
- */
-static bool NodeValueToInt(TreeNode root, unsigned int* valueToSet, char* nodeName)
-{
-	TreeNode node = TreeNode_Navigate(root, nodeName);
-	if (node)
-	{
-		char *buf = (char *)TreeNode_GetValue(node);
-		if (buf && *buf)
-		{
-			*valueToSet = (unsigned int)strtoul (buf, NULL, 10);
-			return true;
-		}
-	}
-	return false;
-}
-
-/**
- * Get node value in float format
+ * Convert orientation string(ABOVE/BELOW) to orientation type
+ * Return true, on successful conversion.
  */
-static bool NodeValueToFloat(TreeNode root, float* valueToSet, char* nodeName)
+static bool SetOrientation(Orientation_Type *orientation, const char *orientationStr)
 {
-	TreeNode node = TreeNode_Navigate(root, nodeName);
-	if (node)
+	if (strcmp(orientationStr, ABOVE_STR) == 0)
 	{
-		char *buf = (char *)TreeNode_GetValue(node);
-		if (buf && *buf)
-		{
-			*valueToSet = atof(buf);
-			return true;
-		}
+		*orientation = Orientation_Above;
+		return true;
 	}
-	return false;
-}
-
-/**
- * Get node value in string format
- */
-static bool NodeValueToString(TreeNode root, char* valueToSet, char* nodeName)
-{
-	TreeNode node = TreeNode_Navigate(root, nodeName);
-	if (node)
+	else if (strcmp(orientationStr, BELOW_STR) == 0)
 	{
-		char *buf = (char *)TreeNode_GetValue(node);
-		if (buf && *buf)
-		{
-			strcpy(valueToSet,buf);
-			return true;
-		}
+		*orientation = Orientation_Below;
+		return true;
 	}
 	return false;
 }
 
 /**
- * Convert orientation string(ABOVE/BELOW) to orientation type
+ * Convert control string(THRESHOLD/PID) to control type
  * Return true, on successful conversion.
  */
-static bool SetOrientation(Orientation_Type *orientation, const char *orientationStr)
+static bool SetControl(Control_Type *control, const char *controlStr)
 {
-	if (strcmp(orientationStr, ABOVE_STR) == 0)
+	if (strcmp(controlStr, THRESHOLD_STR) == 0)
 	{
-		*orientation = Orientation_Above;
+		*control = Control_Threshold;
 		return true;
 	}
-	else if (strcmp(orientationStr, BELOW_STR) == 0)
+	else if (strcmp(controlStr, PID_STR) == 0)
 	{
-		*orientation = Orientation_Below;
+		*control = Control_Pid;
 		return true;
 	}
 	return false;
@@ -519,6 +611,72 @@ static bool IsSensorDataChanged(const Sensor *sensorOld, const Sensor *sensorNew
 	return false;
 }
 
+/**
+ * Convert measurement to hundredths, rounding to nearest
+ */
+static int ToCentiValue(float value)
+{
+	return (int)(value * 100.0f + ((value < 0.0f) ? -0.5f : 0.5f));
+}
+
+/**
+ * Post current measurements and relay states to history writer.
+ * Measurements not received yet are stored as out of range values.
+ */
+static void RecordHistory(Controller *me)
+{
+	HistoryRecord record;
+	time_t now;
+	unsigned int i;
+
+	Flow_GetTime(&now);
+	record.time = (uint32_t)now;
+	record.zone = HISTORY_ZONE;
+	record.relays = 0;
+	for (i = 0; i < NUM_RELAYS; ++i)
+	{
+		if (me->relays[i].status == Relay_On)
+		{
+			record.relays |= (1 << i);
+		}
+	}
+
+	record.temperature = HISTORY_NO_TEMPERATURE;
+	record.humidity = HISTORY_NO_HUMIDITY;
+	if (!CompareFloat(me->sensors[Sensor_Temperature].value, DEFAULT_SENSOR_VALUE))
+	{
+		record.temperature = (int16_t)ToCentiValue(me->sensors[Sensor_Temperature].value);
+	}
+	if (!CompareFloat(me->sensors[Sensor_Humidity].value, DEFAULT_SENSOR_VALUE))
+	{
+		record.humidity = (uint16_t)ToCentiValue(me->sensors[Sensor_Humidity].value);
+	}
+
+	if (!HistoryWriter_Post(&me->historyWriter, &record))
+	{
+		ControllerLog(ControllerLogLevel_Debug, DEBUG_PREFIX "History record dropped");
+	}
+}
+
+/**
+ * Put a record from history store back into measurements history, so
+ * that it reaches back past a restart.
+ */
+static bool RestoreHistory(const HistoryRecord *record, void *context)
+{
+	Controller *me = context;
+
+	if (record->temperature != HISTORY_NO_TEMPERATURE)
+	{
+		TimeSeries_AddPast(&me->history[Sensor_Temperature], record->time, record->temperature / 100.0f);
+	}
+	if (record->humidity != HISTORY_NO_HUMIDITY)
+	{
+		TimeSeries_AddPast(&me->history[Sensor_Humidity], record->time, record->humidity / 100.0f);
+	}
+	return true;
+}
+
 /**
  * Run actuator logic, which turns ON/OFF relays based on the
  * measurement values sent by sensor, if relay is in auto mode.
@@ -532,7 +690,8 @@ static bool ActuatorControlLogic(Controller *me)
 
 	for (i = 0; i < NUM_RELAYS; ++i)
 	{
-		if (me->relays[i].mode == Relay_Auto)
+		//PID controlled relays are driven by control tick instead
+		if ((me->relays[i].mode == Relay_Auto) && (me->sensors[i].control == Control_Threshold))
 		{
 			Relay_Status relayStatus;
 
@@ -547,6 +706,53 @@ static bool ActuatorControlLogic(Controller *me)
 				if (SendCommand(me, relayCmdStr, Message_RelayCommandToActuator))
 				{
 					me->relays[i].status = relayStatus;
+					ControllerMarkDirty(me, ControllerSection_Relays);
+					success = true;
+				}
+			}
+		}
+	}
+	return success;
+}
+
+/**
+ * Run PID logic for relays in auto mode whose sensor is PID controlled.
+ * Called on every control tick, each zone switching its relay at most
+ * once per control window.
+ * Return true, if successfully sent a command to actuator.
+ */
+static bool ZoneControlLogic(Controller *me)
+{
+	unsigned int i;
+	bool success = false;
+
+	if (!me->sensorConfig.isAlive)
+	{
+		//No fresh measurements to act upon
+		return false;
+	}
+
+	for (i = 0; i < NUM_RELAYS; ++i)
+	{
+		if ((me->relays[i].mode == Relay_Auto) && (me->sensors[i].control == Control_Pid))
+		{
+			Relay_Status relayStatus;
+			ZoneDirection_Type direction;
+
+			direction = (me->sensors[i].orientation == Orientation_Below) ? ZoneDirection_Raise : ZoneDirection_Lower;
+			relayStatus = ZoneControl_Tick(&me->zones[i], &me->sensors[i].gains, me->sensors[i].threshold,
+											me->sensors[i].value, direction, me->relays[i].status == Relay_On) ? Relay_On : Relay_Off;
+
+			if (me->relays[i].status != relayStatus)
+			{
+				char relayCmdStr[MAX_SIZE] = {0};
+
+				ConstructRelayCmdStr(relayCmdStr, me->relays[i].relayName, relayStatus);
+
+				if (SendCommand(me, relayCmdStr, Message_RelayCommandToActuator))
+				{
+					me->relays[i].status = relayStatus;
+					ControllerMarkDirty(me, ControllerSection_Relays);
 					success = true;
 				}
 			}
@@ -555,6 +761,27 @@ static bool ActuatorControlLogic(Controller *me)
 	return success;
 }
 
+/**
+ * (Re)initialise control zones from current control window setting.
+ * Minimum pulse is limited to a quarter of the window, so that
+ * intermediate duty cycles are still possible with short windows.
+ */
+static void InitControlZones(Controller *me)
+{
+	unsigned int i;
+	unsigned int minimumPulse = DEFAULT_CONTROL_MIN_PULSE;
+
+	if (minimumPulse > me->config.controlWindow / 4)
+	{
+		minimumPulse = me->config.controlWindow / 4;
+	}
+
+	for (i = 0; i < NUM_RELAYS; ++i)
+	{
+		ZoneControl_Init(&me->zones[i], me->config.controlWindow, me->config.controlTick, minimumPulse);
+	}
+}
+
 /**
  * Change relay mode to Auto, run actuator logic,
  * and send status update to user.
@@ -567,6 +794,8 @@ static bool ChangeRelayModeToAuto(Controller *me, Relay_Type type)
 		//Relay is in manual mode, changing it to auto.
 		//And send status update to user
 		me->relays[type].mode = Relay_Auto;
+		ControllerMarkDirty(me, ControllerSection_Relays);
+		ZoneControl_Reset(&me->zones[type]);
 		ActuatorControlLogic(me);
 		ControllerLog(ControllerLogLevel_Debug, DEBUG_PREFIX "Relay is now automatically controlled" );
 		return true;
@@ -588,6 +817,7 @@ static bool UpdateRelay(Controller *me, Relay_Type type, Relay_Status status, co
 		//Relay is in auto mode, changing it to manual.
 		//And send status update to user
 		me->relays[type].mode = Relay_Manual;
+		ControllerMarkDirty(me, ControllerSection_Relays);
 		success = true;
 		ControllerLog(ControllerLogLevel_Debug, DEBUG_PREFIX "Relay is now manually controlled" );
 	}
@@ -599,18 +829,138 @@ static bool UpdateRelay(Controller *me, Relay_Type type, Relay_Status status, co
 		if (SendCommand(me, relayStr, Message_RelayCommandToActuator))
 		{
 			me->relays[type].status = status;
+			ControllerMarkDirty(me, ControllerSection_Relays);
 			success = true;
 		}
 	}
 	return success;
 }
 
+/**
+ * Parse optional control settings. These are not present in KVS configs
+ * written by older controllers, in which case current settings are kept.
+ * Control zones are restarted if anything has changed.
+ */
+static void ParseControlSettings(TreeNode root, Controller *me)
+{
+	static char *controlXmlStr[NUM_SENSORS] = { TEMPERATURE_CONTROL_XML_STR, HUMIDITY_CONTROL_XML_STR };
+	unsigned int controlWindow = 0;
+	unsigned int i;
+	bool isChanged = false;
+
+	if (ClimateProto_NodeValueToInt(root, &controlWindow, CONTROL_WINDOW_XML_STR) &&
+		(controlWindow >= me->config.controlTick) && (controlWindow != me->config.controlWindow))
+	{
+		me->config.controlWindow = controlWindow;
+		isChanged = true;
+	}
+
+	for (i = 0; i < NUM_SENSORS; ++i)
+	{
+		char nodeName[MAX_SIZE];
+		char controlStr[MAX_SIZE];
+		Control_Type control = me->sensors[i].control;
+		PidGains gains = me->sensors[i].gains;
+
+		snprintf(nodeName, sizeof(nodeName), "%s/%s", controlXmlStr[i], CONTROL_MODE_XML_STR);
+		if (ClimateProto_NodeValueToString(root, controlStr, sizeof(controlStr), nodeName))
+		{
+			if (!SetControl(&control, controlStr))
+			{
+				ControllerLog(ControllerLogLevel_Warning, WARNING_PREFIX "Unknown control mode %s", controlStr);
+			}
+		}
+		snprintf(nodeName, sizeof(nodeName), "%s/%s", controlXmlStr[i], CONTROL_KP_XML_STR);
+		ClimateProto_NodeValueToFloat(root, &gains.kp, nodeName);
+		snprintf(nodeName, sizeof(nodeName), "%s/%s", controlXmlStr[i], CONTROL_KI_XML_STR);
+		ClimateProto_NodeValueToFloat(root, &gains.ki, nodeName);
+		snprintf(nodeName, sizeof(nodeName), "%s/%s", controlXmlStr[i], CONTROL_KD_XML_STR);
+		ClimateProto_NodeValueToFloat(root, &gains.kd, nodeName);
+
+		if ((control != me->sensors[i].control) ||
+			(memcmp(&gains, &me->sensors[i].gains, sizeof(PidGains)) != 0))
+		{
+			me->sensors[i].control = control;
+			me->sensors[i].gains = gains;
+			isChanged = true;
+		}
+	}
+
+	if (isChanged)
+	{
+		InitControlZones(me);
+	}
+}
+
+/**
+ * Calibration of the sensor's readings, from an optional element per
+ * sensor with its Offset, Gain and Curve, which default to no correction.
+ * Sensors without the element keep theirs.
+ */
+static void ParseCalibrationSettings(TreeNode root, Controller *me)
+{
+	static char *calibrationXmlStr[NUM_SENSORS] = { TEMPERATURE_CALIBRATION_XML_STR, HUMIDITY_CALIBRATION_XML_STR };
+	unsigned int i;
+
+	for (i = 0; i < NUM_SENSORS; ++i)
+	{
+		char nodeName[2 * MAX_SIZE];	//Paths run longer than MAX_SIZE
+		Calibration calibration = { .offset = 0.0f, .gain = 1.0f, .curve = 0.0f };
+		bool isPresent = false;
+
+		snprintf(nodeName, sizeof(nodeName), "%s/%s", calibrationXmlStr[i], CALIBRATION_OFFSET_XML_STR);
+		isPresent = ClimateProto_NodeValueToFloat(root, &calibration.offset, nodeName) || isPresent;
+		snprintf(nodeName, sizeof(nodeName), "%s/%s", calibrationXmlStr[i], CALIBRATION_GAIN_XML_STR);
+		isPresent = ClimateProto_NodeValueToFloat(root, &calibration.gain, nodeName) || isPresent;
+		snprintf(nodeName, sizeof(nodeName), "%s/%s", calibrationXmlStr[i], CALIBRATION_CURVE_XML_STR);
+		isPresent = ClimateProto_NodeValueToFloat(root, &calibration.curve, nodeName) || isPresent;
+		if (isPresent)
+		{
+			me->sensors[i].calibration = calibration;
+		}
+	}
+}
+
+/**
+ * Filters of the sensor's readings, from optional elements per sensor
+ * with its MedianSize and FilterAlpha. Sensors without an element keep
+ * that parameter, 0 leaving it to the sensor.
+ */
+static void ParseFilterSettings(TreeNode root, Controller *me)
+{
+	static char *medianSizeXmlStr[NUM_SENSORS] = { TEMP_MEDIAN_SIZE_XML_STR, HMDT_MEDIAN_SIZE_XML_STR };
+	static char *filterAlphaXmlStr[NUM_SENSORS] = { TEMP_FILTER_ALPHA_XML_STR, HMDT_FILTER_ALPHA_XML_STR };
+	unsigned int i;
+
+	for (i = 0; i < NUM_SENSORS; ++i)
+	{
+		ClimateProto_NodeValueToInt(root, &me->sensors[i].medianSize, medianSizeXmlStr[i]);
+		ClimateProto_NodeValueToFloat(root, &me->sensors[i].filterAlpha, filterAlphaXmlStr[i]);
+	}
+}
+
+/**
+ * Parse the optional longest read intervals, which sensors back off to while
+ * readings are steady, keeping the current ones when absent.
+ */
+static void ParseMaxReadIntervals(TreeNode root, Controller *me)
+{
+	static char *maxReadIntervalXmlStr[NUM_SENSORS] = { TEMP_MAX_READ_INTERVAL_XML_STR, HMDT_MAX_READ_INTERVAL_XML_STR };
+	unsigned int i;
+
+	for (i = 0; i < NUM_SENSORS; ++i)
+	{
+		ClimateProto_NodeValueToInt(root, &me->sensors[i].maxReadInterval, maxReadIntervalXmlStr[i]);
+	}
+}
+
 /**
  * Parse KVS config, and update all settings
  */
-static bool ParseAndUpdateSettings(const char *data, Controller *me)
+bool ParseAndUpdateSettings(const char *data, Controller *me)
 {
 	unsigned int controllerHeartBeat = 0;
+	unsigned int heartBeatKeyframe = me->config.heartBeatKeyframe;
 	unsigned int sensorHeartBeat = 0;
 	unsigned int actuatorHeartBeat = 0;
 	char tempOrientationString[MAX_SIZE], hmdtOrientationString[MAX_SIZE];
@@ -621,18 +971,29 @@ static bool ParseAndUpdateSettings(const char *data, Controller *me)
 		TreeNode xmlTreeRoot = TreeNode_ParseXML((uint8_t*)data, strlen(data), true);
 		if (xmlTreeRoot)
 		{
-			if ((NodeValueToFloat(xmlTreeRoot, &me->sensors[Sensor_Temperature].threshold, TEMPERATURE_THRESHOLD_XML_STR)) &&
-				(NodeValueToFloat(xmlTreeRoot, &me->sensors[Sensor_Humidity].threshold, HUMIDITY_THRESHOLD_XML_STR)) &&
-				(NodeValueToString(xmlTreeRoot, tempOrientationString, TEMPERATURE_ORIENTATION_XML_STR)) &&
-				(NodeValueToString(xmlTreeRoot, hmdtOrientationString, HUMIDITY_ORIENTATION_XML_STR)) &&
-				(NodeValueToInt(xmlTreeRoot, &controllerHeartBeat, CONTROLLER_HEARTBEAT_XML_STR)) &&
-				(NodeValueToInt(xmlTreeRoot, &sensorHeartBeat, SENSOR_HEARTBEAT_XML_STR)) &&
-				(NodeValueToInt(xmlTreeRoot, &me->sensors[Sensor_Temperature].readInterval, TEMP_READ_INTERVAL_XML_STR)) &&
-				(NodeValueToInt(xmlTreeRoot, &me->sensors[Sensor_Humidity].readInterval, HMDT_READ_INTERVAL_XML_STR)) &&
-				(NodeValueToFloat(xmlTreeRoot, &me->sensors[Sensor_Temperature].readDelta, TEMP_READ_DELTA_XML_STR)) &&
-				(NodeValueToFloat(xmlTreeRoot, &me->sensors[Sensor_Humidity].readDelta, HMDT_READ_DELTA_XML_STR)) &&
-				(NodeValueToInt(xmlTreeRoot, &actuatorHeartBeat, ACTUATOR_HEARTBEAT_XML_STR)))
+			if ((ClimateProto_NodeValueToFloat(xmlTreeRoot, &me->sensors[Sensor_Temperature].threshold, TEMPERATURE_THRESHOLD_XML_STR)) &&
+				(ClimateProto_NodeValueToFloat(xmlTreeRoot, &me->sensors[Sensor_Humidity].threshold, HUMIDITY_THRESHOLD_XML_STR)) &&
+				(ClimateProto_NodeValueToString(xmlTreeRoot, tempOrientationString, sizeof(tempOrientationString), TEMPERATURE_ORIENTATION_XML_STR)) &&
+				(ClimateProto_NodeValueToString(xmlTreeRoot, hmdtOrientationString, sizeof(hmdtOrientationString), HUMIDITY_ORIENTATION_XML_STR)) &&
+				(ClimateProto_NodeValueToInt(xmlTreeRoot, &controllerHeartBeat, CONTROLLER_HEARTBEAT_XML_STR)) &&
+				(ClimateProto_NodeValueToInt(xmlTreeRoot, &sensorHeartBeat, SENSOR_HEARTBEAT_XML_STR)) &&
+				(ClimateProto_NodeValueToInt(xmlTreeRoot, &me->sensors[Sensor_Temperature].readInterval, TEMP_READ_INTERVAL_XML_STR)) &&
+				(ClimateProto_NodeValueToInt(xmlTreeRoot, &me->sensors[Sensor_Humidity].readInterval, HMDT_READ_INTERVAL_XML_STR)) &&
+				(ClimateProto_NodeValueToFloat(xmlTreeRoot, &me->sensors[Sensor_Temperature].readDelta, TEMP_READ_DELTA_XML_STR)) &&
+				(ClimateProto_NodeValueToFloat(xmlTreeRoot, &me->sensors[Sensor_Humidity].readDelta, HMDT_READ_DELTA_XML_STR)) &&
+				(ClimateProto_NodeValueToInt(xmlTreeRoot, &actuatorHeartBeat, ACTUATOR_HEARTBEAT_XML_STR)))
 			{
+				ParseMaxReadIntervals(xmlTreeRoot, me);
+
+				//Optional, keeps the current one when absent
+				ClimateProto_NodeValueToInt(xmlTreeRoot, &heartBeatKeyframe, HEARTBEAT_KEYFRAME_XML_STR);
+				if (me->config.heartBeatKeyframe != heartBeatKeyframe)
+				{
+					//Delta heartbeats start over from a keyframe
+					me->config.heartBeatKeyframe = heartBeatKeyframe;
+					me->heartBeatKeyframe.base = 0;
+				}
+
 				if (me->config.heartBeat != controllerHeartBeat)
 				{
 					//Controller's heartbeat is changed.
@@ -661,7 +1022,13 @@ static bool ParseAndUpdateSettings(const char *data, Controller *me)
 				{
 					success = SetOrientation(&me->sensors[Sensor_Humidity].orientation, hmdtOrientationString);
 				}
+
+				ParseControlSettings(xmlTreeRoot, me);
+				ParseCalibrationSettings(xmlTreeRoot, me);
+				ParseFilterSettings(xmlTreeRoot, me);
 			}
+			//Settings are parsed in place, so may have changed even on failure
+			ControllerMarkDirty(me, ControllerSection_Settings);
 			Tree_Delete(xmlTreeRoot);
 		}
 	}
@@ -669,35 +1036,193 @@ static bool ParseAndUpdateSettings(const char *data, Controller *me)
 }
 
 /**
- * Parse following events :-
- * 1. HeartBeat message sent by sensor.
- * 2. HeartBeat message sent by actuator.
- * 3. Change in measurements sent by sensor.
+ * Return true if a device was pushed the settings applied now, by the
+ * hash recorded on the push.
  */
-static bool ParseEvent(TreeNode root, Controller *me, const char *deviceId)
+static bool HasAppliedSettings(const Controller *me, bool hasSettings, uint32_t settingsHash)
 {
-	bool isSensorHeartBeat = false;
-	bool isActuatorHeartBeat = false;
-	Sensor sensors[NUM_SENSORS];
-	Relay relays[NUM_RELAYS];
-	char data[MAX_SIZE] = {0};
+	return hasSettings && me->settingsCache.isValid && (settingsHash == me->settingsCache.hash);
+}
+
+/**
+ * Send current settings to sensor, unless it has them already or isForced.
+ * A push that is not sent is tried again on the sensor's next event.
+ */
+static void SendSettingsToSensor(Controller *me, bool isForced)
+{
+	if (!isForced && HasAppliedSettings(me, me->sensorConfig.hasSettings, me->sensorConfig.settingsHash))
+	{
+		controllerStats.skippedDevicePushes++;
+		return;
+	}
+
+	if (!SendCommand(me, NULL, Message_UpdateSettingsToSensor))
+	{
+		me->sensorConfig.hasSettings = false;
+		controllerStats.failedDevicePushes++;
+		ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Sending settings to sensor(%s) failed", me->sensorConfig.sensorId);
+		return;
+	}
+	me->sensorConfig.hasSettings = me->settingsCache.isValid;
+	me->sensorConfig.settingsHash = me->settingsCache.hash;
+	controllerStats.devicePushes++;
+	ControllerLog(ControllerLogLevel_Debug, DEBUG_PREFIX "Sending settings to sensor(%s)", me->sensorConfig.sensorId);
+}
+
+/**
+ * Send current settings to actuator, unless it has them already or isForced.
+ * A push that is not sent is tried again on the actuator's next event.
+ */
+static void SendSettingsToActuator(Controller *me, bool isForced)
+{
+	if (!isForced && HasAppliedSettings(me, me->actuatorConfig.hasSettings, me->actuatorConfig.settingsHash))
+	{
+		controllerStats.skippedDevicePushes++;
+		return;
+	}
+
+	if (!SendCommand(me, NULL, Message_UpdateSettingsToActuator))
+	{
+		me->actuatorConfig.hasSettings = false;
+		controllerStats.failedDevicePushes++;
+		ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Sending settings to actuator(%s) failed", me->actuatorConfig.actuatorId);
+		return;
+	}
+	me->actuatorConfig.hasSettings = me->settingsCache.isValid;
+	me->actuatorConfig.settingsHash = me->settingsCache.hash;
+	controllerStats.devicePushes++;
+	ControllerLog(ControllerLogLevel_Debug, DEBUG_PREFIX "Sending settings to actuator(%s)", me->actuatorConfig.actuatorId);
+}
+
+/**
+ * Get sensor values from sensor's event. Events in delta mode (see
+ * SensorKeyframe) are applied on top of their keyframe. Return false if
+ * values are incomplete, stale, or follow a keyframe that was missed.
+ */
+static bool ParseSensorValues(const char *xml, const ClimateProto_Event *event, Controller *me, Sensor *sensors)
+{
+	static const unsigned int valueFields[NUM_SENSORS] = { ClimateProto_SensorInfo_temperature, ClimateProto_SensorInfo_humidity };
+	SensorKeyframe *keyframe = &me->sensorKeyframe;
+	ClimateProto_SensorInfo info;
+	float values[NUM_SENSORS];
+	unsigned int i;
 
-	if (NodeValueToString(root, data, EVENT_TYPE_XML_STR))
+	ClimateProto_Parse(&ClimateProto_SensorInfoSchema, xml, &info);
+	if (!(event->present & CLIMATE_PROTO_PRESENT(Event, seq)) || !(event->present & CLIMATE_PROTO_PRESENT(Event, base)))
 	{
-		if (strcmp(SENSOR_STR, data) == 0)
+		for (i = 0; i < NUM_SENSORS; ++i)
 		{
-			//Check if message is coming to right sensor device
-			if (me->sensorConfig.sensorId && (strcmp(me->sensorConfig.sensorId, deviceId) != 0))
+			if (!ClimateProto_GetFloat(&ClimateProto_SensorInfoSchema, &info, valueFields[i], &sensors[i].value))
 			{
-				ControllerLog(ControllerLogLevel_Debug, DEBUG_PREFIX "Message received from unknown sensor(%s)", deviceId);
 				return false;
 			}
-			else
+		}
+		return true;
+	}
+
+	if (event->seq == event->base)
+	{
+		//Keyframe, always taken as sensor may have restarted
+		for (i = 0; i < NUM_SENSORS; ++i)
+		{
+			if (!ClimateProto_GetFloat(&ClimateProto_SensorInfoSchema, &info, valueFields[i], &values[i]))
 			{
-				if (!me->sensorConfig.sensorId)
-				{
-					//If we donot have a sensor Id, take one which first
-					//sends message to us
+				return false;
+			}
+		}
+		memcpy(keyframe->values, values, sizeof(values));
+		keyframe->base = event->base;
+	}
+	else if ((keyframe->base == 0) || (event->base != keyframe->base) || ((int)(event->seq - keyframe->sequence) <= 0))
+	{
+		return false;
+	}
+
+	for (i = 0; i < NUM_SENSORS; ++i)
+	{
+		sensors[i].value = keyframe->values[i];
+		ClimateProto_GetFloat(&ClimateProto_SensorInfoSchema, &info, valueFields[i], &sensors[i].value);
+	}
+	keyframe->sequence = event->seq;
+	return true;
+}
+
+/**
+ * Add the samples a sensor kept through a network outage to history.
+ * They are past values, so are not applied, but show the sensor is alive.
+ */
+static bool ParseSensorLog(const char *xml, Controller *me, const char *deviceId)
+{
+	const char *cursor = NULL;
+	ClimateProto_Sample sample;
+	unsigned long count = 0;
+
+	if (!me->sensorConfig.sensorId || (strcmp(me->sensorConfig.sensorId, deviceId) != 0))
+	{
+		ControllerLog(ControllerLogLevel_Debug, DEBUG_PREFIX "Sensor log from unknown sensor(%s)", deviceId);
+		return false;
+	}
+	FlowTimer_Reset(me->sensorTimer);
+
+	pthread_mutex_lock(&me->historyLock);
+	while (ClimateProto_NextRecord(&ClimateProto_SampleSchema, xml, &cursor, &sample))
+	{
+		if (!(sample.present & CLIMATE_PROTO_PRESENT(Sample, time)) || (sample.time == 0))
+		{
+			continue;
+		}
+		if ((sample.present & CLIMATE_PROTO_PRESENT(Sample, temperature)) &&
+			(sample.temperature != CLIMATE_PROTO_NO_TEMPERATURE))
+		{
+			TimeSeries_AddPast(&me->history[Sensor_Temperature], sample.time, sample.temperature / 100.0f);
+		}
+		if ((sample.present & CLIMATE_PROTO_PRESENT(Sample, humidity)) &&
+			(sample.humidity != CLIMATE_PROTO_NO_HUMIDITY))
+		{
+			TimeSeries_AddPast(&me->history[Sensor_Humidity], sample.time, sample.humidity / 100.0f);
+		}
+		count++;
+	}
+	pthread_mutex_unlock(&me->historyLock);
+	controllerStats.sensorLogSamples += count;
+	ControllerLog(ControllerLogLevel_Debug, DEBUG_PREFIX "Sensor log of %lu samples", count);
+	return true;
+}
+
+/**
+ * Parse following events :-
+ * 1. HeartBeat message sent by sensor.
+ * 2. HeartBeat message sent by actuator.
+ * 3. Change in measurements sent by sensor.
+ */
+static bool ParseEvent(const char *xml, const ClimateProto_Event *event, Controller *me, const char *deviceId)
+{
+	bool isSensorHeartBeat = false;
+	bool isActuatorHeartBeat = false;
+	Sensor sensors[NUM_SENSORS];
+	Relay relays[NUM_RELAYS];
+	ClimateProto_ActuatorInfo info;
+
+	if (event->present & CLIMATE_PROTO_PRESENT(Event, type))
+	{
+		if (strcmp(CLIMATE_PROTO_SENSOR_LOG, event->type) == 0)
+		{
+			return ParseSensorLog(xml, me, deviceId);
+		}
+		if (strcmp(SENSOR_STR, event->type) == 0)
+		{
+			//Check if message is coming to right sensor device
+			if (me->sensorConfig.sensorId && (strcmp(me->sensorConfig.sensorId, deviceId) != 0))
+			{
+				ControllerLog(ControllerLogLevel_Debug, DEBUG_PREFIX "Message received from unknown sensor(%s)", deviceId);
+				return false;
+			}
+			else
+			{
+				if (!me->sensorConfig.sensorId)
+				{
+					//If we donot have a sensor Id, take one which first
+					//sends message to us
 					me->sensorConfig.sensorId = (char *)Flow_MemAlloc(MAX_SIZE);
 					if (me->sensorConfig.sensorId)
 					{
@@ -711,14 +1236,26 @@ static bool ParseEvent(TreeNode root, Controller *me, const char *deviceId)
 					}
 				}
 
-				if ((NodeValueToFloat(root, &sensors[Sensor_Temperature].value, EVENT_TEMPERATURE_XML_STR)) &&
-					(NodeValueToFloat(root, &sensors[Sensor_Humidity].value, EVENT_HUMIDITY_XML_STR)))
+				if (me->config.heartBeatKeyframe && !(event->present & CLIMATE_PROTO_PRESENT(Event, seq)))
+				{
+					//Sensor sends deltas once it has our settings, so it has
+					//restarted since they were pushed
+					me->sensorConfig.hasSettings = false;
+				}
+
+				if (ParseSensorValues(xml, event, me, sensors))
 				{
 					isSensorHeartBeat = true;
 				}
+				else if (event->present & CLIMATE_PROTO_PRESENT(Event, seq))
+				{
+					//Delta whose keyframe was missed. Sensor is alive,
+					//and its values follow with the next keyframe.
+					FlowTimer_Reset(me->sensorTimer);
+				}
 			}
 		}
-		else if (strcmp(ACTUATOR_STR, data) == 0)
+		else if (strcmp(ACTUATOR_STR, event->type) == 0)
 		{
 			//Check if message is coming to right actuator device
 			if (me->actuatorConfig.actuatorId && (strcmp(me->actuatorConfig.actuatorId, deviceId) != 0))
@@ -745,17 +1282,18 @@ static bool ParseEvent(TreeNode root, Controller *me, const char *deviceId)
 					}
 				}
 
-				if (NodeValueToString(root, data, EVENT_RELAY_1_XML_STR))
+				ClimateProto_Parse(&ClimateProto_ActuatorInfoSchema, xml, &info);
+				if (info.present & CLIMATE_PROTO_PRESENT(ActuatorInfo, relay1))
 				{
-					if (GetRelayStatus(&relays[Relay_Heater].status, data))
+					if (GetRelayStatus(&relays[Relay_Heater].status, info.relay1))
 					{
 						isActuatorHeartBeat = true;
 					}
 				}
 
-				if (NodeValueToString(root, data, EVENT_RELAY_2_XML_STR))
+				if (info.present & CLIMATE_PROTO_PRESENT(ActuatorInfo, relay2))
 				{
-					if (GetRelayStatus(&relays[Relay_Fan].status, data))
+					if (GetRelayStatus(&relays[Relay_Fan].status, info.relay2))
 					{
 						isActuatorHeartBeat = true;
 					}
@@ -775,23 +1313,42 @@ static bool ParseEvent(TreeNode root, Controller *me, const char *deviceId)
 	if (isSensorHeartBeat)
 	{
 		unsigned int i;
+		time_t now;
 
 		//Sensor is alive, reset its expiry timer
 		FlowTimer_Reset(me->sensorTimer);
 
+		//Keep every measurement in history, including unchanged ones,
+		//so that rollups reflect the actual sample count.
+		Flow_GetTime(&now);
+		pthread_mutex_lock(&me->historyLock);
+		for (i = 0; i < NUM_SENSORS; ++i)
+		{
+			TimeSeries_Add(&me->history[i], (uint32_t)now, sensors[i].value);
+		}
+		pthread_mutex_unlock(&me->historyLock);
+
 		if (me->sensorConfig.isAlive == false)
 		{
 			me->sensorConfig.isAlive = true;
+			ControllerMarkDirty(me, ControllerSection_Liveness);
 			SendCommand(me, NULL, Message_DeviceStatusToUser);
 			ControllerLog(ControllerLogLevel_Debug, DEBUG_PREFIX "Sensor(%s) is alive now", me->sensorConfig.sensorId);
 		}
 
+		//Sensor is new, or was restarted since its last push
+		if (me->isStarted && !me->sensorConfig.hasSettings)
+		{
+			SendSettingsToSensor(me, false);
+		}
+
 		if (IsSensorDataChanged(me->sensors, sensors))
 		{
 			for (i = 0; i < NUM_SENSORS; ++i)
 			{
 				me->sensors[i].value = sensors[i].value;
 			}
+			ControllerMarkDirty(me, ControllerSection_Sensors);
 
 			SendCommand(me, NULL, Message_SensorStatusToUser);
 		}
@@ -803,6 +1360,7 @@ static bool ParseEvent(TreeNode root, Controller *me, const char *deviceId)
 			SendCommand(me, NULL, Message_ActuatorStatusToUser);
 		}
 
+		RecordHistory(me);
 		return true;
 	}
 
@@ -816,10 +1374,16 @@ static bool ParseEvent(TreeNode root, Controller *me, const char *deviceId)
 		if (me->actuatorConfig.isAlive == false)
 		{
 			me->actuatorConfig.isAlive = true;
+			ControllerMarkDirty(me, ControllerSection_Liveness);
 			SendCommand(me, NULL, Message_DeviceStatusToUser);
 			ControllerLog(ControllerLogLevel_Debug, DEBUG_PREFIX "Actuator(%s) is alive now", me->actuatorConfig.actuatorId);
 		}
 
+		if (me->isStarted && !me->actuatorConfig.hasSettings)
+		{
+			SendSettingsToActuator(me, false);
+		}
+
 		for (i = 0; i < NUM_RELAYS; ++i)
 		{
 			if (me->relays[i].status != relays[i].status)
@@ -847,12 +1411,13 @@ static bool ParseCommand(TreeNode root, Controller *me)
 	char data[MAX_SIZE] = {0};
 	bool isStatusChanged = false;
 
-	if (NodeValueToString(root, data, COMMAND_INFO_XML_STR))
+	if (ClimateProto_NodeValueToString(root, data, sizeof(data), COMMAND_INFO_XML_STR))
 	{
 		if (strcmp(RETRIEVE_SETTINGS_STR, data) == 0)
 		{
 			//Ask for KVS config and update ourself
 			me->isUserUpdate = true;
+			me->settingsRequestTime = ControllerStats_NowUs();
 			if (!PostFlowInterfaceCmdGetSetting(&me->sendMsgQueue))
 			{
 				ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Posting RETRIEVE_SETTINGS command to flow interface thread failed");
@@ -910,7 +1475,7 @@ static bool ParseCommand(TreeNode root, Controller *me)
 		{
 			char timeStr[MAX_SIZE] = {0};
 
-			if (NodeValueToString(root, timeStr, COMMAND_APP_TIME_XML_STR))
+			if (ClimateProto_NodeValueToString(root, timeStr, sizeof(timeStr), COMMAND_APP_TIME_XML_STR))
 			{
 				SendCommand(me, timeStr, Message_PingResponseToUser);
 			}
@@ -928,6 +1493,7 @@ static bool ParseCommand(TreeNode root, Controller *me)
 		if (isStatusChanged)
 		{
 			SendCommand(me, NULL, Message_ActuatorStatusToUser);
+			RecordHistory(me);
 		}
 	}
 	else
@@ -937,29 +1503,84 @@ static bool ParseCommand(TreeNode root, Controller *me)
 	return true;
 }
 
+/**
+ * Encoding to send a peer in, compact if its message was or if it
+ * advertised it decodes it. Either is taken as it stands, so a peer going
+ * back to XML only gets XML.
+ */
+static WireFormat PeerWireFormat(bool isCompact, unsigned int version)
+{
+	return isCompact ? WireFormat_Compact : ClimateProto_WireFormat(version);
+}
+
+/**
+ * Event from a device, with the encoding it came in. Events are most of
+ * the traffic, so are read in place rather than parsed into a tree.
+ */
+static bool ParseDeviceEvent(const char *xml, const ClimateProto_Event *event, bool isCompact,
+								Controller *me, const char *deviceId)
+{
+	bool success = ParseEvent(xml, event, me, deviceId);
+
+	if (me->sensorConfig.sensorId && (strcmp(me->sensorConfig.sensorId, deviceId) == 0))
+	{
+		me->sensorConfig.wireFormat = PeerWireFormat(isCompact, event->wire);
+	}
+	else if (me->actuatorConfig.actuatorId && (strcmp(me->actuatorConfig.actuatorId, deviceId) == 0))
+	{
+		me->actuatorConfig.wireFormat = PeerWireFormat(isCompact, event->wire);
+	}
+	return success;
+}
+
 /**
  * Parse all messages received by controller
  */
-static bool ParseMessage(const ReceivedMessage *receivedMsg, Controller *me)
+bool ParseMessage(const ReceivedMessage *receivedMsg, Controller *me)
 {
 	bool success = false;
-	TreeNode xmlTreeRoot = TreeNode_ParseXML((uint8_t*)receivedMsg->data, strlen(receivedMsg->data), true);
-
-	if (xmlTreeRoot)
+	bool isCompact = WireFormat_IsCompact(receivedMsg->data);
+	char *xml = isCompact ? WireFormat_ToXml(receivedMsg->data) : receivedMsg->data;
+	const char *cursor = NULL;
+	const char *batchedEvent;
+	ClimateProto_Event event;
+	TreeNode xmlTreeRoot = NULL;
+	unsigned int version = 0;
+
+	if (!xml)
 	{
-		if (strcmp(EVENT_STR,TreeNode_GetName(xmlTreeRoot)) == 0)
+		ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Malformed compact message from %s", receivedMsg->sendorId);
+	}
+	else if (ClimateProto_Parse(&ClimateProto_EventSchema, xml, &event))
+	{
+		success = ParseDeviceEvent(xml, &event, isCompact, me, receivedMsg->sendorId);
+	}
+	else if (ClimateProto_NextEvent(xml, &cursor, &batchedEvent))
+	{
+		//Events batched by the device's send thread, applied in order
+		do
 		{
-			//Received an event from a device
-			if (ParseEvent(xmlTreeRoot, me, receivedMsg->sendorId))
+			if (ClimateProto_Parse(&ClimateProto_EventSchema, batchedEvent, &event) &&
+				ParseDeviceEvent(batchedEvent, &event, isCompact, me, receivedMsg->sendorId))
 			{
 				success = true;
 			}
-		}
-		else if (strcmp(COMMAND_STR,TreeNode_GetName(xmlTreeRoot)) == 0)
+		} while (ClimateProto_NextEvent(xml, &cursor, &batchedEvent));
+	}
+	else
+	{
+		xmlTreeRoot = TreeNode_ParseXML((uint8_t*)xml, strlen(xml), true);
+	}
+
+	if (xmlTreeRoot)
+	{
+		if (strcmp(COMMAND_STR,TreeNode_GetName(xmlTreeRoot)) == 0)
 		{
 			//Received a command from user
 			if (strcmp(me->userId, receivedMsg->sendorId) == 0)
 			{
+				ClimateProto_NodeValueToInt(xmlTreeRoot, &version, COMMAND_WIRE_XML_STR);
+				me->userWireFormat = PeerWireFormat(isCompact, version);
 				if (ParseCommand(xmlTreeRoot, me))
 				{
 					success = true;
@@ -968,6 +1589,10 @@ static bool ParseMessage(const ReceivedMessage *receivedMsg, Controller *me)
 		}
 		Tree_Delete(xmlTreeRoot);
 	}
+	if (isCompact && xml)
+	{
+		Flow_MemFree((void **)&xml);
+	}
 	return success;
 }
 
@@ -985,9 +1610,12 @@ static void SensorHeartBeatTimer(FlowTimer timer, void *context)
 		if (me->sensorConfig.isAlive == true)
 		{
 			me->sensorConfig.isAlive = false;
+			ControllerMarkDirty(me, ControllerSection_Liveness);
 			SendCommand(me, NULL, Message_DeviceStatusToUser);
 			ControllerLog(ControllerLogLevel_Debug, DEBUG_PREFIX "Sensor's heartbeat expiry" );
 		}
+		//Sensor may be restarting, so it is sent settings when heard again
+		me->sensorConfig.hasSettings = false;
 	}
 }
 
@@ -1005,9 +1633,11 @@ static void ActuatorHeartBeatTimer(FlowTimer timer, void *context)
 		if (me->actuatorConfig.isAlive == true)
 		{
 			me->actuatorConfig.isAlive = false;
+			ControllerMarkDirty(me, ControllerSection_Liveness);
 			SendCommand(me, NULL, Message_DeviceStatusToUser);
 			ControllerLog(ControllerLogLevel_Debug, DEBUG_PREFIX "Actuator's heartbeat expiry" );
 		}
+		me->actuatorConfig.hasSettings = false;
 	}
 }
 
@@ -1022,13 +1652,30 @@ static void ControllerHeartBeatTimer(FlowTimer timer, void *context)
 	{
 		FlowQueue* receiveMsgQueue = (FlowQueue* )context;
 
-		if (!PostControllerEventHeartBeat(receiveMsgQueue))
+		if (!PostControllerEvent(receiveMsgQueue, ControllerEvent_HeartBeat))
 		{
 			ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Posting Controller's heartbeat event failed");
 		}
 	}
 }
 
+/**
+ * Controller's control timer callback. PID controlled relays are
+ * driven from controller thread on every control tick.
+ */
+static void ControllerControlTimer(FlowTimer timer, void *context)
+{
+	if (context)
+	{
+		FlowQueue* receiveMsgQueue = (FlowQueue* )context;
+
+		if (!PostControllerEvent(receiveMsgQueue, ControllerEvent_ControlTick))
+		{
+			ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Posting Controller's control tick event failed");
+		}
+	}
+}
+
 /**
  * Start sensor's heartbeat expiry timer
  */
@@ -1077,6 +1724,38 @@ static bool StartControllerHeartBeatTimer(Controller *me)
 	return true;
 }
 
+/**
+ * Start controller's control timer, which drives PID controlled relays.
+ */
+static void StartControllerControlTimer(Controller *me)
+{
+	me->config.controlTimer = FlowTimer_New("ControllerControlTimer", me->config.controlTick, true, ControllerControlTimer, (void *)&me->receiveMsgQueue);
+	if (me->config.controlTimer == NULL)
+	{
+		ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Control timer creation failed");
+		return;
+	}
+
+	FlowTimer_Start(me->config.controlTimer);
+}
+
+/**
+ * Send current settings to known devices that don't have them yet, or
+ * to all of them if isForced.
+ */
+static void SendSettingsToDevices(Controller *me, bool isForced)
+{
+	if (me->sensorConfig.sensorId)
+	{
+		SendSettingsToSensor(me, isForced);
+	}
+
+	if (me->actuatorConfig.actuatorId)
+	{
+		SendSettingsToActuator(me, isForced);
+	}
+}
+
 /**
  * Start all timers and send updated settings to devices.
  */
@@ -1084,132 +1763,340 @@ static void StartTimersAndUpdateSettings(Controller *me)
 {
 	if (StartControllerHeartBeatTimer(me))
 	{
+		me->isStarted = true;
+		StartControllerControlTimer(me);
+
 		if (me->sensorConfig.sensorId)
 		{
 			StartSensorHeartBeatTimer(me);
-			SendCommand(me, NULL, Message_UpdateSettingsToSensor);
-			ControllerLog(ControllerLogLevel_Debug, DEBUG_PREFIX "Sending settings to sensor(%s)", me->sensorConfig.sensorId);
 		}
 
 		if (me->actuatorConfig.actuatorId)
 		{
 			StartActuatorHeartBeatTimer(me);
-			SendCommand(me, NULL, Message_UpdateSettingsToActuator);
-			ControllerLog(ControllerLogLevel_Debug, DEBUG_PREFIX "Sending settings to actuator(%s)", me->actuatorConfig.actuatorId);
 		}
+
+		SendSettingsToDevices(me, false);
 	}
 }
 
 /**
- * Controller thread's event handler
+ * Apply settings cached by a previous run, so that control starts
+ * without waiting for the cloud.
  */
-static void ControllerEventHandler(Controller *me)
+static void ApplyCachedSettings(Controller *me)
 {
-	ControllerEvent *event = NULL;
+	uint64_t start = ControllerStats_NowUs();
+	char *data = NULL;
 
-	for (;;)
+	if (!SettingsCache_Load(&me->settingsCache, &data))
 	{
-		event = FlowQueue_DequeueWaitFor(me->receiveMsgQueue,QUEUE_WAITING_TIME);
-		if (event != NULL)
+		return;
+	}
+
+	if (ParseAndUpdateSettings(data, me))
+	{
+		StartTimersAndUpdateSettings(me);
+		controllerStats.settingsFromCache++;
+		ControllerStats_AddLatency(&controllerStats.settingsApply, start);
+		ControllerLog(ControllerLogLevel_Info, INFO_PREFIX "Applied cached settings, revalidating with cloud");
+	}
+	else
+	{
+		SettingsCache_Invalidate(&me->settingsCache);
+		ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Error in parsing cached settings");
+	}
+	Flow_MemFree((void **)&data);
+}
+
+/**
+ * Handle one event posted to controller thread. Event is freed here.
+ */
+void ControllerHandleEvent(Controller *me, ControllerEvent *event)
+{
+	switch (event->evtType)
+	{
+		case ControllerEvent_HeartBeat:
+		{
+			SendCommand(me, NULL, Message_HeartBeatToUser);
+			FreeEvent(event);
+			break;
+		}
+		case ControllerEvent_SettingSuccess:
 		{
-			switch (event->evtType)
+			uint64_t start = ControllerStats_NowUs();
+
+			if (me->isStarted && SettingsCache_IsApplied(&me->settingsCache, event->details))
 			{
-				case ControllerEvent_HeartBeat:
+				//KVS config is same as the applied one, nothing to parse. Only
+				//devices that started since their last push need it.
+				controllerStats.settingsUnchanged++;
+				//Restarts are only seen in delta mode, otherwise settings
+				//asked for by user go to all devices, which may have restarted
+				SendSettingsToDevices(me, me->isUserUpdate && !me->config.heartBeatKeyframe);
+				if (me->isUserUpdate)
 				{
-					SendCommand(me, NULL, Message_HeartBeatToUser);
-					FreeEvent(event);
-					break;
+					me->isUserUpdate = false;
+					SendCommand(me, "RETRIEVE_SETTINGS_SUCCESS", Message_ResponseToUser);
 				}
-				case ControllerEvent_SettingSuccess:
+				ControllerLog(ControllerLogLevel_Debug, DEBUG_PREFIX "Settings unchanged");
+			}
+			//KVS config read successful, try parsing the content
+			else if (ParseAndUpdateSettings(event->details, me))
+			{
+				if (!SettingsCache_Store(&me->settingsCache, event->details))
 				{
-					//KVS config read successful, try parsing the content
-					if (ParseAndUpdateSettings(event->details, me))
-					{
-						//Check if we are asked for KVS config because of reception
-						//of RETRIEVE_SETTINGS command from user
-						if (me->isUserUpdate)
-						{
-							//Successfully updated the settings.
-							//Send a RETRIEVE_SETTINGS_SUCCESS message to user
-							me->isUserUpdate = false;
-							SendCommand(me, "RETRIEVE_SETTINGS_SUCCESS", Message_ResponseToUser);
-							if (me->sensorConfig.sensorId)
-							{
-								SendCommand(me, NULL, Message_UpdateSettingsToSensor);
-								ControllerLog(ControllerLogLevel_Debug, DEBUG_PREFIX "Sending settings to sensor(%s)", me->sensorConfig.sensorId);
-							}
-							if (me->actuatorConfig.actuatorId)
-							{
-								SendCommand(me, NULL, Message_UpdateSettingsToActuator);
-								ControllerLog(ControllerLogLevel_Debug, DEBUG_PREFIX "Sending settings to actuator(%s)",me->actuatorConfig.actuatorId);
-							}
-						}
-						else
-						{
-							//KVS config is read first time after booting.
-							//Start all timers.
-							StartTimersAndUpdateSettings(me);
-						}
-					}
-					else
-					{
-						//KVS config parsing is failed.
-						//Send a RETRIEVE_SETTINGS_FAILURE message to user
-						me->isUserUpdate = false;
-						SendCommand(me, "RETRIEVE_SETTINGS_FAILURE", Message_ResponseToUser);
-						ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Error in parsing settings" );
-					}
-					FreeEvent(event);
-					break;
+					ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Caching settings failed");
 				}
-				case ControllerEvent_SettingFailure:
-				{
-					char *data = NULL;
-					//KVS config is not present. Create one.
-					ConstructSetting(me, &data);
-					if (!PostFlowInterfaceCmdSetSetting(&me->sendMsgQueue, data))
-					{
-						Flow_MemFree((void **)&data);
-						ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Posting set settings command to flow interface thread failed");
-					}
-
-					//KVS config is set, start all timers.
-					StartTimersAndUpdateSettings(me);
 
-					FreeEvent(event);
-					break;
+				//Check if we are asked for KVS config because of reception
+				//of RETRIEVE_SETTINGS command from user
+				if (me->isUserUpdate)
+				{
+					//Successfully updated the settings.
+					//Send a RETRIEVE_SETTINGS_SUCCESS message to user
+					me->isUserUpdate = false;
+					SendCommand(me, "RETRIEVE_SETTINGS_SUCCESS", Message_ResponseToUser);
+					SendSettingsToDevices(me, false);
 				}
-				case ControllerEvent_ReceivedMessage:
+				else if (me->isStarted)
 				{
-					ReceivedMessage *receivedMsg;
-
-					receivedMsg = (ReceivedMessage *)event->details;
-					ParseMessage(receivedMsg, me);
-					Flow_MemFree((void **)&receivedMsg->data);
-					Flow_MemFree((void **)&receivedMsg->sendorId);
-					FreeEvent(event);
-					break;
+					//KVS config differs from the cached one we booted with
+					SendSettingsToDevices(me, false);
 				}
-				default:
+				else
 				{
-					ControllerLog(ControllerLogLevel_Debug, DEBUG_PREFIX "Received unknown event" );
-					FreeEvent(event);
-					break;
+					//KVS config is read first time after booting.
+					//Start all timers.
+					StartTimersAndUpdateSettings(me);
 				}
 			}
+			else
+			{
+				//KVS config parsing is failed.
+				//Send a RETRIEVE_SETTINGS_FAILURE message to user
+				me->isUserUpdate = false;
+				SendCommand(me, "RETRIEVE_SETTINGS_FAILURE", Message_ResponseToUser);
+				ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Error in parsing settings" );
+			}
+			ControllerStats_AddLatency(&controllerStats.settingsApply, start);
+			ControllerStats_AddLatency(&controllerStats.settingsRoundTrip, me->settingsRequestTime);
+			FreeEvent(event);
+			break;
+		}
+		case ControllerEvent_SettingFailure:
+		{
+			char *data = NULL;
+			//KVS config is not present. Create one.
+			ConstructSetting(me, &data);
+			if (data && !SettingsCache_Store(&me->settingsCache, data))
+			{
+				ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Caching settings failed");
+			}
+			if (!PostFlowInterfaceCmdSetSetting(&me->sendMsgQueue, data))
+			{
+				Flow_MemFree((void **)&data);
+				ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Posting set settings command to flow interface thread failed");
+			}
+
+			//KVS config is set, start all timers,
+			//unless already running on cached settings.
+			if (!me->isStarted)
+			{
+				StartTimersAndUpdateSettings(me);
+			}
+
+			FreeEvent(event);
+			break;
+		}
+		case ControllerEvent_ControlTick:
+		{
+			if (ZoneControlLogic(me))
+			{
+				//There has been a change in relay status,
+				//hence, send an update to user.
+				SendCommand(me, NULL, Message_ActuatorStatusToUser);
+				RecordHistory(me);
+			}
+			FreeEvent(event);
+			break;
+		}
+		case ControllerEvent_ReceivedMessage:
+		{
+			ReceivedMessage *receivedMsg;
+
+			receivedMsg = (ReceivedMessage *)event->details;
+			ParseMessage(receivedMsg, me);
+			Flow_MemFree((void **)&receivedMsg->data);
+			Flow_MemFree((void **)&receivedMsg->sendorId);
+			FreeEvent(event);
+			break;
+		}
+		default:
+		{
+			ControllerLog(ControllerLogLevel_Debug, DEBUG_PREFIX "Received unknown event" );
+			FreeEvent(event);
+			break;
 		}
 	}
 }
 
-void ControllerThread(FlowThread thread, void *taskParameters)
+/**
+ * Controller thread's event handler
+ */
+static void ControllerEventHandler(Controller *me)
+{
+	ControllerEvent *event = NULL;
+
+	for (;;)
+	{
+		event = FlowQueue_DequeueWaitFor(me->receiveMsgQueue,QUEUE_WAITING_TIME);
+		if (event != NULL)
+		{
+			ControllerHandleEvent(me, event);
+		}
+	}
+}
+
+static void HistoryServerThread(FlowThread thread, void *taskParameters)
 {
 	Controller *me = taskParameters;
 
+	while (HistoryServer_Poll(&me->historyServer, -1))
+	{
+	}
+	ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "History server stopped");
+	HistoryServer_Close(&me->historyServer);
+}
+
+/**
+ * Path of a file kept in controller's state directory.
+ * Return false if it does not fit in size.
+ */
+static bool StatePath(const Controller *me, const char *name, char *path, size_t size)
+{
+	int length = snprintf(path, size, "%s/%s", me->stateDir, name);
+
+	if ((length < 0) || ((size_t)length >= size))
+	{
+		ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Path of %s in %s is too long", name, me->stateDir);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Serve history queries from local clients on a thread of their own.
+ * Controller keeps running without the endpoint, if this fails.
+ */
+static bool StartHistoryServer(Controller *me)
+{
+	char path[HISTORY_SERVER_PATH_SIZE];
+	unsigned int i;
+
+	//Queries are by control zone, relay i is controlled by sensor i
+	for (i = 0; i < NUM_RELAYS; ++i)
+	{
+		me->zoneHistory[i] = &me->history[i];
+	}
+
+	if (!StatePath(me, HISTORY_SERVER_PATH, path, sizeof(path)) ||
+		!HistoryServer_Open(&me->historyServer, path, HISTORY_SERVER_TCP_PORT,
+							me->zoneHistory, NUM_RELAYS, &me->historyLock))
+	{
+		ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Opening history server on %s failed", path);
+		return false;
+	}
+
+	me->historyServerThread = FlowThread_New("HistoryServerTask", HISTORY_SERVER_PRIORITY, HISTORY_SERVER_STACK_SIZE,
+											HistoryServerThread, me);
+	if (me->historyServerThread == NULL)
+	{
+		ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Creation of history server thread failed");
+		HistoryServer_Close(&me->historyServer);
+		return false;
+	}
+	ControllerLog(ControllerLogLevel_Info, INFO_PREFIX "History server listening on %s", path);
+	return true;
+}
+
+/**
+ * Record a change to a section of controller state, so that its cached
+ * serialization is built again on next use.
+ */
+void ControllerMarkDirty(Controller *me, ControllerSection section)
+{
+	//Generation 0 stands for nothing cached yet
+	if (++me->generations[section] == 0)
+	{
+		me->generations[section] = 1;
+	}
+}
+
+/**
+ * Set controller to default settings, before it is started.
+ */
+void ControllerSetDefaults(Controller *me)
+{
+	*me = _DefaultController;
+}
+
+/**
+ * Initialise controller state, apply cached settings and ask flow thread
+ * for KVS config. Events are handled by ControllerHandleEvent() after this.
+ */
+void ControllerStart(Controller *me)
+{
+	char path[HISTORY_STORE_DIR_SIZE];
+	uint32_t restoreFrom = 0;
+	time_t now;
+	unsigned int i;
+
+	InitControlZones(me);
+	ConstructMessageTemplates(me);
+
+	for (i = 0; i < NUM_SENSORS; ++i)
+	{
+		TimeSeries_Init(&me->history[i]);
+	}
+
+	if ((mkdir(me->stateDir, 0755) != 0) && (errno != EEXIST))
+	{
+		ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Creating state directory %s failed", me->stateDir);
+	}
+
+	Flow_GetTime(&now);
+	if ((uint32_t)now > HISTORY_RESTORE_SPAN)
+	{
+		restoreFrom = (uint32_t)now - HISTORY_RESTORE_SPAN;
+	}
+	if (StatePath(me, HISTORY_STORE_DIR, path, sizeof(path)))
+	{
+		//History server is not started yet, so history needs no lock
+		HistoryWriter_Start(&me->historyWriter, path, restoreFrom, RestoreHistory, me);
+	}
+	StartHistoryServer(me);
+
+	if (!StatePath(me, SETTINGS_CACHE_FILE, path, SETTINGS_CACHE_PATH_SIZE))
+	{
+		//Cache is then neither loaded nor stored
+		path[0] = '\0';
+	}
+	SettingsCache_Init(&me->settingsCache, path);
+	ApplyCachedSettings(me);
+
+	//Fetch KVS config, in background if cached settings are applied already
+	me->settingsRequestTime = ControllerStats_NowUs();
 	if (!PostFlowInterfaceCmdGetSetting(&me->sendMsgQueue))
 	{
 		ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Posting get settings command to flow interface thread failed");
 	}
+}
 
+void ControllerThread(FlowThread thread, void *taskParameters)
+{
+	Controller *me = taskParameters;
+
+	ControllerStart(me);
 	ControllerEventHandler(me);
 }
-
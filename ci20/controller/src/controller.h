@@ -45,6 +45,15 @@ extern "C" {
 #include "flow/core/flow_queue.h"
 #include "flow/core/flow_timer.h"
 
+#include "zone_control.h"
+#include "time_series.h"
+#include "history_writer.h"
+#include "history_server.h"
+#include "settings_cache.h"
+#include "message_template.h"
+#include "wire_format.h"
+#include "climate_proto.h"
+
 #define MAX_SIZE (50)
 #define QUEUE_WAITING_TIME (10000)	//milliseconds
 #define NUM_SENSORS (2)
@@ -55,6 +64,16 @@ extern "C" {
 #define DEFAULT_HMDT_THRESHOLD (30.00)	//percentage
 #define DEFAULT_HEARTBEAT (15000)	//milliseconds
 #define DEFAULT_SENSOR_VALUE (-1000.00)
+#define DEFAULT_STATE_DIR "/var/lib/flowclimatecontroller"	//Settings cache, history and its socket
+#define DEFAULT_CONTROL_WINDOW (120000)	//milliseconds
+#define DEFAULT_CONTROL_TICK (1000)	//milliseconds
+#define DEFAULT_CONTROL_MIN_PULSE (10000)	//milliseconds
+#define DEFAULT_TEMP_KP (0.25)	//duty cycle per degree centigrade
+#define DEFAULT_TEMP_KI (0.0005)	//duty cycle per degree centigrade per second
+#define DEFAULT_TEMP_KD (0.0)
+#define DEFAULT_HMDT_KP (0.05)	//duty cycle per percentage
+#define DEFAULT_HMDT_KI (0.0002)	//duty cycle per percentage per second
+#define DEFAULT_HMDT_KD (0.0)
 
 //Sensor configuration defaults
 #define DEFAULT_SENSOR_HEARTBEAT (15000)	//milliseconds
@@ -77,6 +96,8 @@ extern "C" {
 #define HMDT_READ_INTERVAL_XML_TAG "<HumidityReadInterval>%u</HumidityReadInterval>"
 #define HMDT_READ_DELTA_XML_TAG "<HumidityReadDelta>%0.2f</HumidityReadDelta>"
 #define HMDT_ORIENTATION_XML_TAG "<HumidityOrientation>%s</HumidityOrientation>"
+#define TEMP_CONTROL_XML_TAG "<TemperatureControl><Mode>%s</Mode><Kp>%0.4f</Kp><Ki>%0.6f</Ki><Kd>%0.4f</Kd></TemperatureControl>"
+#define HMDT_CONTROL_XML_TAG "<HumidityControl><Mode>%s</Mode><Kp>%0.4f</Kp><Ki>%0.6f</Ki><Kd>%0.4f</Kd></HumidityControl>"
 #define RELAY_1_XML_TAG "<Relay_1><mode>%s</mode><status>%s</status></Relay_1>"
 #define RELAY_2_XML_TAG "<Relay_2><mode>%s</mode><status>%s</status></Relay_2>"
 #define RELAY_1_STR "RELAY_1"
@@ -94,6 +115,12 @@ typedef enum
 	Orientation_Below,
 }Orientation_Type;
 
+typedef enum
+{
+	Control_Threshold,	//Relay switched on threshold crossing
+	Control_Pid,	//Relay driven by PID duty cycle on every control tick
+}Control_Type;
+
 typedef enum
 {
 	Relay_On,
@@ -121,6 +148,13 @@ typedef struct
 	char *relayName;
 }Relay;
 
+typedef struct
+{
+	float offset;	//In the sensor's unit
+	float gain;	//Of the reading, 0 to leave sensor's own calibration
+	float curve;	//Of the reading squared
+}Calibration;
+
 typedef struct
 {
 	Sensor_Type type;
@@ -128,38 +162,111 @@ typedef struct
 	float threshold;
 	float value;
 	unsigned int readInterval;
+	unsigned int maxReadInterval;	//Sensor backs off to this while value is steady, 0 to leave sensor's own
 	float readDelta;
+	unsigned int medianSize;	//Sensor's despike filter, 0 to leave sensor's own
+	float filterAlpha;	//Sensor's smoothing filter, 0 to leave sensor's own
+	Calibration calibration;	//Correction of the sensor's readings for its device
+	Control_Type control;
+	PidGains gains;
 	char *sensorTagString;
 	char *thresholdTagString;
 	char *orientationTagString;
 	char *readIntervalTagString;
 	char *readDeltaTagString;
+	char *controlTagString;
 }Sensor;
 
 typedef struct
 {
 	bool isAlive;
+	bool hasSettings;	//Pushed settings since actuator was last seen starting
+	uint32_t settingsHash;	//Of settings last pushed, see SettingsCache
 	char *actuatorId;
 	unsigned int heartBeat;
+	WireFormat wireFormat;	//Encoding of messages to actuator, as it advertised
 }ActuatorConfig;
 
 typedef struct
 {
 	bool isAlive;
+	bool hasSettings;	//Pushed settings since sensor was last seen starting
+	uint32_t settingsHash;	//Of settings last pushed, see SettingsCache
 	char *sensorId;
 	unsigned int heartBeat;
+	WireFormat wireFormat;	//Encoding of messages to sensor, as it advertised
 }SensorConfig;
 
+/**
+ * Parts of controller state serialized into messages. Each has a
+ * generation, bumped by ControllerMarkDirty() on every change, and a
+ * cached serialization is reused for as long as its generation matches.
+ */
+typedef enum
+{
+	ControllerSection_Sensors,	//Sensor values
+	ControllerSection_Relays,	//Relay modes and statuses
+	ControllerSection_Liveness,	//Sensor and actuator alive flags
+	ControllerSection_Settings,	//Everything applied by ParseAndUpdateSettings()
+	ControllerSection_Count,
+}ControllerSection;
+
+typedef struct
+{
+	char *text;	//Serialized section, NULL till first built
+	unsigned int generation;	//Of section text was built from
+}CachedSection;
+
+//Pre-rendered message kept patched between sends, so that only changed sections are rewritten
+typedef struct
+{
+	char text[MESSAGE_TEMPLATE_SIZE];
+	unsigned int generations[ControllerSection_Count];	//Of sections as patched in text, 0 if not
+}PatchedMessage;
+
+/**
+ * Heartbeats in delta mode carry a sequence number and the sequence of
+ * their keyframe (base). A keyframe, whose base is its own sequence, has
+ * all fields, and the beats after it only fields differing from it.
+ */
+typedef struct
+{
+	unsigned int sequence;	//Of last heartbeat sent
+	unsigned int base;	//Sequence of last keyframe sent, 0 till first one
+	float values[NUM_SENSORS];	//State as of keyframe
+	Relay_Mode modes[NUM_RELAYS];
+	Relay_Status statuses[NUM_RELAYS];
+	bool isSensorAlive;
+	bool isActuatorAlive;
+}HeartBeatKeyframe;
+
+//Keyframe of sensor's events in delta mode, see HeartBeatKeyframe
+typedef struct
+{
+	unsigned int sequence;	//Of last event applied
+	unsigned int base;	//Sequence of keyframe, 0 till first one
+	float values[NUM_SENSORS];
+}SensorKeyframe;
+
 typedef struct
 {
 	unsigned int heartBeat;
+	unsigned int heartBeatKeyframe;	//Delta heartbeats with a keyframe every this many, 0 for full ones only
 	FlowTimer heartBeatTimer;	//Timer for controller's heartbeat
+	unsigned int controlWindow;	//Duty cycle window for PID controlled relays
+	unsigned int controlTick;
+	FlowTimer controlTimer;	//Timer for driving PID controlled relays
 }ControllerConfig;
 
 typedef struct
 {
 	char userId[MAX_SIZE];
+	WireFormat userWireFormat;	//Encoding of messages to user, as its last command advertised
 	bool isUserUpdate;
+	bool isStarted;	//Timers are running and devices have settings
+	const char *stateDir;	//Holds settings cache, history and its socket, made if missing
+	SettingsCache settingsCache;	//Last applied settings
+	uint64_t settingsRequestTime;	//When settings were last asked for, microseconds
 
 	ControllerConfig config;
 	SensorConfig sensorConfig;
@@ -167,12 +274,35 @@ typedef struct
 
 	Sensor sensors[NUM_SENSORS];
 	Relay relays[NUM_RELAYS];
+	ZoneControl zones[NUM_RELAYS];	//Relay i is controlled by sensor i
+	TimeSeries history[NUM_SENSORS];	//Measurements history, fixed memory
+	const TimeSeries *zoneHistory[NUM_RELAYS];	//Of the sensor controlling each zone, served to local clients
+	HistoryWriter historyWriter;	//Persistent measurements and relay history
+	HistoryServer historyServer;	//Local history query endpoint
+	pthread_mutex_t historyLock;	//Guards history against history server thread
 
 	FlowTimer sensorTimer;	//Timer to track sensor's DEAD/ALIVE status
 	FlowTimer actuatorTimer;	//Timer to track actuator's DEAD/ALIVE status
 
 	FlowThread controllerThread;
 	FlowThread flowInterfaceThread;
+	FlowThread historyServerThread;
+
+	//Pre-rendered messages to user, see ConstructMessageTemplates()
+	MessageTemplate heartBeatTemplate;
+	MessageTemplate sensorStatusTemplate;
+	MessageTemplate actuatorStatusTemplate;
+	MessageTemplate deviceStatusTemplate;
+
+	//Serialized sections, see ControllerSection
+	unsigned int generations[ControllerSection_Count];
+	PatchedMessage heartBeat;
+	CachedSection setting;	//Whole ConstructSetting() message
+	CachedSection sensorSettings;	//Settings of UPDATE_SETTINGS command to sensor
+	CachedSection actuatorSettings;	//Settings of UPDATE_SETTINGS command to actuator
+
+	HeartBeatKeyframe heartBeatKeyframe;	//Delta heartbeats to user
+	SensorKeyframe sensorKeyframe;	//Delta events from sensor
 
 	FlowQueue sendMsgQueue;	//Used by controller thread for posting message to flow thread
 	FlowQueue receiveMsgQueue;	//Used by flow thread for posting message to controller thread
@@ -184,6 +314,7 @@ typedef enum
 	ControllerEvent_SettingSuccess,	//Event for successfully reading settings
 	ControllerEvent_SettingFailure,	//Event for failure in reading settings
 	ControllerEvent_ReceivedMessage, //Event for message receiving
+	ControllerEvent_ControlTick,	//Event for driving PID controlled relays
 }ControllerEvent_Type;
 
 typedef struct
@@ -192,7 +323,22 @@ typedef struct
 	void *details;
 }ControllerEvent;
 
+//Details of ControllerEvent_ReceivedMessage
+typedef struct
+{
+	char *sendorId;
+	char *data;
+}ReceivedMessage;
+
+void ControllerSetDefaults(Controller *me);
+void ControllerStart(Controller *me);
+void ControllerHandleEvent(Controller *me, ControllerEvent *event);
 void ControllerThread(FlowThread thread, void *taskParameters);
+void ControllerMarkDirty(Controller *me, ControllerSection section);
+
+//Message and settings parsers, used directly by the host benchmarks
+bool ParseMessage(const ReceivedMessage *receivedMsg, Controller *me);
+bool ParseAndUpdateSettings(const char *data, Controller *me);
 
 #ifdef	__cplusplus
 }
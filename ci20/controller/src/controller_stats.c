@@ -0,0 +1,97 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <time.h>
+
+#include "controller_stats.h"
+
+ControllerStats controllerStats;
+
+uint64_t ControllerStats_NowUs(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * Add time elapsed since start (from ControllerStats_NowUs()) to stat.
+ */
+void ControllerStats_AddLatency(LatencyStat *stat, uint64_t start)
+{
+	unsigned long elapsed = (unsigned long)(ControllerStats_NowUs() - start);
+
+	stat->count++;
+	stat->last = elapsed;
+	stat->total += elapsed;
+	if (elapsed > stat->max)
+	{
+		stat->max = elapsed;
+	}
+}
+
+static void PrintLatency(const char *name, const LatencyStat *stat)
+{
+	unsigned long mean = (stat->count > 0) ? (unsigned long)(stat->total / stat->count) : 0;
+
+	printf("\t%-24s count %lu, last %lu us, mean %lu us, max %lu us\n", name, stat->count, stat->last, mean, stat->max);
+}
+
+static void PrintCache(const char *name, const CacheStat *stat)
+{
+	unsigned long total = stat->hits + stat->misses;
+	unsigned long hitRate = (total > 0) ? (unsigned long)((uint64_t)stat->hits * 100 / total) : 0;
+
+	printf("\t%-24s hits %lu, misses %lu, hit rate %lu%%\n", name, stat->hits, stat->misses, hitRate);
+}
+
+void ControllerStats_Print(void)
+{
+	PrintLatency("settings apply:", &controllerStats.settingsApply);
+	PrintLatency("settings round trip:", &controllerStats.settingsRoundTrip);
+	printf("\t%-24s %lu\n", "settings from cache:", controllerStats.settingsFromCache);
+	printf("\t%-24s %lu\n", "settings unchanged:", controllerStats.settingsUnchanged);
+	printf("\t%-24s %lu\n", "device pushes:", controllerStats.devicePushes);
+	printf("\t%-24s %lu\n", "device pushes skipped:", controllerStats.skippedDevicePushes);
+	printf("\t%-24s %lu\n", "device pushes failed:", controllerStats.failedDevicePushes);
+	printf("\t%-24s %lu\n", "messages received:", controllerStats.receivedMessages);
+	printf("\t%-24s %lu\n", "messages dropped:", controllerStats.droppedMessages);
+	printf("\t%-24s %lu\n", "sensor log samples:", controllerStats.sensorLogSamples);
+	PrintCache("heartbeat cache:", &controllerStats.heartBeatCache);
+	PrintCache("settings cache:", &controllerStats.settingCache);
+	PrintCache("sensor settings cache:", &controllerStats.sensorSettingsCache);
+	PrintCache("actuator settings cache:", &controllerStats.actuatorSettingsCache);
+}
@@ -0,0 +1,91 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef CONTROLLER_STATS_H
+#define CONTROLLER_STATS_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * Counters and latencies, updated by controller thread and read from
+ * console. Values are informational only, reads are not synchronised.
+ */
+
+typedef struct
+{
+	unsigned long count;
+	unsigned long last;	//microseconds
+	unsigned long max;	//microseconds
+	uint64_t total;	//microseconds
+}LatencyStat;
+
+typedef struct
+{
+	unsigned long hits;
+	unsigned long misses;
+}CacheStat;
+
+typedef struct
+{
+	LatencyStat settingsApply;	//Parsing and applying settings, or finding them unchanged
+	LatencyStat settingsRoundTrip;	//From asking flow thread for settings until applied
+	unsigned long settingsFromCache;	//Boot time settings served from local cache
+	unsigned long settingsUnchanged;	//Settings found same as the applied ones
+	unsigned long devicePushes;	//UPDATE_SETTINGS sent to sensor/actuator
+	unsigned long skippedDevicePushes;	//UPDATE_SETTINGS not sent, as device had the settings
+	unsigned long failedDevicePushes;	//UPDATE_SETTINGS not built or posted to flow thread
+	unsigned long receivedMessages;	//Messages from users and devices, by flow thread
+	unsigned long droppedMessages;	//Of those, not posted as controller queue was full
+	unsigned long sensorLogSamples;	//Samples sensor kept through outages, added to history
+	CacheStat heartBeatCache;	//Heartbeat sections reused or patched again
+	CacheStat settingCache;	//Settings message for user
+	CacheStat sensorSettingsCache;	//Settings sent to sensor
+	CacheStat actuatorSettingsCache;	//Settings sent to actuator
+}ControllerStats;
+
+extern ControllerStats controllerStats;
+
+uint64_t ControllerStats_NowUs(void);
+void ControllerStats_AddLatency(LatencyStat *stat, uint64_t start);
+void ControllerStats_Print(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* CONTROLLER_STATS_H */
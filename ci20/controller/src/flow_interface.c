@@ -37,6 +37,7 @@
 
 #include "controller.h"
 #include "controller_logging.h"
+#include "controller_stats.h"
 #include "version.h"
 #include "flow_interface.h"
 #include "flow_interface_func.h"
@@ -182,8 +183,12 @@ void MessageReceivedCallBack(FlowMessagingMessage message)
 		sendorId = FlowMessagingMessage_GetSenderDeviceID(message);
 	}
 
+	TraceMessage(MessageTrace_Received, sendorId, data, datasize);
+
+	controllerStats.receivedMessages++;
 	if (!PostControllerEventReceivedMessage(_receiveMsgQueue, data, sendorId, datasize))
 	{
+		controllerStats.droppedMessages++;
 		ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Posting message received event to controller thread failed");
 	}
 
@@ -326,6 +331,7 @@ void FlowInterfaceThread(FlowThread thread, void *taskParameters)
 
 					if (GetSetting(CONTROLLER_CONFIG_NAME, &data))
 					{
+						TraceMessage(MessageTrace_SettingRead, CONTROLLER_CONFIG_NAME, data, strlen(data));
 						if (!PostControllerEventSetting(&me->receiveMsgQueue, data))
 						{
 							Flow_MemFree((void **)&data);
@@ -334,6 +340,7 @@ void FlowInterfaceThread(FlowThread thread, void *taskParameters)
 					}
 					else
 					{
+						TraceMessage(MessageTrace_SettingRead, CONTROLLER_CONFIG_NAME, NULL, 0);
 						if (!PostControllerEventSetting(&me->receiveMsgQueue, NULL))
 						{
 							ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Posting settings event to controller thread failed");
@@ -344,6 +351,7 @@ void FlowInterfaceThread(FlowThread thread, void *taskParameters)
 				}
 				case FlowInterfaceCmd_SetSetting:
 				{
+					TraceMessage(MessageTrace_SettingWrite, CONTROLLER_CONFIG_NAME, cmd->details, strlen(cmd->details));
 					if (!SetSetting(CONTROLLER_CONFIG_NAME, cmd->details))
 					{
 						ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Error in saving settings" );
@@ -391,3 +399,31 @@ bool InitializeFlowInterface(Controller *me)
 	return false;
 }
 
+/**
+ * Capture all payloads exchanged with cloud to a trace file, for replay
+ * on a host. IDs known at start are recorded first.
+ */
+bool StartFlowInterfaceTrace(Controller *me, const char *path)
+{
+	if (!StartMessageTrace(path))
+	{
+		return false;
+	}
+
+	TraceMessage(MessageTrace_Identity, me->userId, TRACE_USER_STR, strlen(TRACE_USER_STR));
+	if (me->sensorConfig.sensorId)
+	{
+		TraceMessage(MessageTrace_Identity, me->sensorConfig.sensorId, TRACE_SENSOR_STR, strlen(TRACE_SENSOR_STR));
+	}
+	if (me->actuatorConfig.actuatorId)
+	{
+		TraceMessage(MessageTrace_Identity, me->actuatorConfig.actuatorId, TRACE_ACTUATOR_STR, strlen(TRACE_ACTUATOR_STR));
+	}
+	printf("Capturing messages to %s\n", path);
+	return true;
+}
+
+void StopFlowInterfaceTrace(void)
+{
+	StopMessageTrace();
+}
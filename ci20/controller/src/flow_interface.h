@@ -39,11 +39,10 @@
 extern "C" {
 #endif
 
-typedef struct
-{
-	char *sendorId;
-	char *data;
-}ReceivedMessage;
+//Content of MessageTrace_Identity records
+#define TRACE_USER_STR "User"
+#define TRACE_SENSOR_STR "Sensor"
+#define TRACE_ACTUATOR_STR "Actuator"
 
 typedef enum
 {
@@ -62,6 +61,8 @@ typedef struct
 
 void FlowInterfaceThread(FlowThread thread, void *taskParameters);
 bool InitializeFlowInterface(Controller *me);
+bool StartFlowInterfaceTrace(Controller *me, const char *path);
+void StopFlowInterfaceTrace(void);
 
 #ifdef	__cplusplus
 }
@@ -41,6 +41,8 @@
 
 #define DEVICE_ID_SIZE (50)
 
+static MessageTrace _messageTrace;	//Capture of payloads exchanged with cloud, if open
+
 bool InitialiseLibFlowMessaging(const char *url, const char *key, const char *secret)
 {
 	if (FlowCore_Initialise())
@@ -220,6 +222,7 @@ bool SendMessage(char *id, char *message, SendMessage_Type msgType)
 			{
 				if (FlowMessaging_SendMessageToUser((FlowID)id, "text/plain", message, strlen(message), 20))
 				{
+					TraceMessage(MessageTrace_Sent, id, message, strlen(message));
 					ControllerLog(ControllerLogLevel_Debug, DEBUG_PREFIX "Message sent to user = %s",message);
 					success = true;
 				}
@@ -233,6 +236,7 @@ bool SendMessage(char *id, char *message, SendMessage_Type msgType)
 			{
 				if (FlowMessaging_SendMessageToDevice((FlowID)id, "text/plain", message, strlen(message), 20))
 				{
+					TraceMessage(MessageTrace_Sent, id, message, strlen(message));
 					ControllerLog(ControllerLogLevel_Debug, DEBUG_PREFIX "Message sent to device = %s",message);
 					success = true;
 				}
@@ -292,3 +296,29 @@ void GetDeviceId(const char *deviceType, const char *userId, char **deviceId)
 		FlowMemoryManager_Free(&memoryManager);
 	}
 }
+
+/**
+ * Start capturing every payload exchanged with cloud to a trace file at path
+ */
+bool StartMessageTrace(const char *path)
+{
+	if (!MessageTrace_Open(&_messageTrace, path))
+	{
+		ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Failed to open message trace %s.", path);
+		return false;
+	}
+	return true;
+}
+
+void StopMessageTrace(void)
+{
+	MessageTrace_Close(&_messageTrace);
+}
+
+/**
+ * Append a payload to message trace, if capture is started
+ */
+void TraceMessage(MessageTrace_Direction direction, const char *peer, const char *content, unsigned int length)
+{
+	MessageTrace_Record(&_messageTrace, direction, peer, content, length);
+}
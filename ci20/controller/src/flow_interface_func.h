@@ -39,6 +39,8 @@
 extern "C" {
 #endif
 
+#include "message_trace.h"
+
 typedef enum
 {
 	SendMessage_ToUser,
@@ -53,6 +55,9 @@ bool GetUserId(char *userId);
 bool SendMessage(char *id, char *message, SendMessage_Type msgType);
 void RegisterCallbackForReceivedMsg(FlowMessaging_MessageReceivedCallBack callback);
 void GetDeviceId(const char *deviceName, const char *userId, char **deviceId);
+bool StartMessageTrace(const char *path);
+void StopMessageTrace(void);
+void TraceMessage(MessageTrace_Direction direction, const char *peer, const char *content, unsigned int length);
 
 #ifdef	__cplusplus
 }
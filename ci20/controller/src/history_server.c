@@ -0,0 +1,512 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "history_server.h"
+
+#define LISTEN_BACKLOG (16)
+#define NO_FD (-1)
+
+static void PutU16(uint8_t *buffer, uint16_t value)
+{
+	buffer[0] = (uint8_t)value;
+	buffer[1] = (uint8_t)(value >> 8);
+}
+
+static void PutU32(uint8_t *buffer, uint32_t value)
+{
+	buffer[0] = (uint8_t)value;
+	buffer[1] = (uint8_t)(value >> 8);
+	buffer[2] = (uint8_t)(value >> 16);
+	buffer[3] = (uint8_t)(value >> 24);
+}
+
+static void PutFloat(uint8_t *buffer, float value)
+{
+	uint32_t bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+	PutU32(buffer, bits);
+}
+
+static uint16_t GetU16(const uint8_t *buffer)
+{
+	return (uint16_t)(buffer[0] | (buffer[1] << 8));
+}
+
+static uint32_t GetU32(const uint8_t *buffer)
+{
+	return (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) | ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+}
+
+static bool SetNonBlocking(int fd)
+{
+	int flags = fcntl(fd, F_GETFL, 0);
+
+	return (flags >= 0) && (fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0);
+}
+
+static int ListenUnix(const char *path)
+{
+	struct sockaddr_un address;
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (fd < 0)
+	{
+		return NO_FD;
+	}
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+	//Socket left behind by a previous run
+	unlink(path);
+
+	if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+		listen(fd, LISTEN_BACKLOG) != 0 ||
+		!SetNonBlocking(fd))
+	{
+		close(fd);
+		return NO_FD;
+	}
+	return fd;
+}
+
+static int ListenLoopback(uint16_t port)
+{
+	struct sockaddr_in address;
+	int reuse = 1;
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	if (fd < 0)
+	{
+		return NO_FD;
+	}
+
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons(port);
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+		listen(fd, LISTEN_BACKLOG) != 0 ||
+		!SetNonBlocking(fd))
+	{
+		close(fd);
+		return NO_FD;
+	}
+	return fd;
+}
+
+static void CloseClient(HistoryClient *client)
+{
+	close(client->fd);
+	client->fd = NO_FD;
+}
+
+static void Accept(HistoryServer *me, int listenFd)
+{
+	int fd;
+
+	while ((fd = accept(listenFd, NULL, NULL)) >= 0)
+	{
+		HistoryClient *client = NULL;
+		unsigned int i;
+
+		for (i = 0; i < HISTORY_SERVER_MAX_CLIENTS; ++i)
+		{
+			if (me->clients[i].fd == NO_FD)
+			{
+				client = &me->clients[i];
+				break;
+			}
+		}
+		if (client == NULL || !SetNonBlocking(fd))
+		{
+			me->rejectedClients++;
+			close(fd);
+			continue;
+		}
+
+		//Chunks are small writes, don't let them wait for acknowledgements
+		if (listenFd == me->tcpFd)
+		{
+			int noDelay = 1;
+
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+		}
+
+		memset(client, 0, sizeof(*client));
+		client->fd = fd;
+	}
+}
+
+static void PutHeader(HistoryClient *client, HistoryStatus_Type status, uint32_t resolution)
+{
+	PutU16(&client->buffer[0], HISTORY_PROTOCOL_MAGIC);
+	client->buffer[2] = HISTORY_PROTOCOL_VERSION;
+	client->buffer[3] = (uint8_t)status;
+	PutU32(&client->buffer[4], resolution);
+	client->bufferSize = HISTORY_RESPONSE_HEADER_SIZE;
+	client->bufferSent = 0;
+}
+
+/**
+ * Fill client buffer with the next chunk of its response, after any
+ * header already in it. Series lock is only held for one chunk, so
+ * streaming a long range does not hold up the controller.
+ */
+static void FillChunk(HistoryServer *me, HistoryClient *client)
+{
+	TimeSeriesPoint points[HISTORY_CHUNK_POINTS];
+	unsigned int numPoints = 0;
+	unsigned int maxPoints = HISTORY_CHUNK_POINTS;
+	uint8_t *out = &client->buffer[client->bufferSize];
+	unsigned int i;
+
+	if (maxPoints > client->pointsLeft)
+	{
+		maxPoints = client->pointsLeft;
+	}
+	if (maxPoints > 0 && client->next <= client->to)
+	{
+		pthread_mutex_lock(me->lock);
+		numPoints = TimeSeries_Query(me->zones[client->zone], client->next, client->to, client->resolution, points, maxPoints);
+		pthread_mutex_unlock(me->lock);
+	}
+
+	PutU16(out, (uint16_t)numPoints);
+	out += 2;
+	for (i = 0; i < numPoints; ++i)
+	{
+		PutU32(&out[0], points[i].time);
+		PutFloat(&out[4], points[i].min);
+		PutFloat(&out[8], points[i].max);
+		PutFloat(&out[12], points[i].mean);
+		PutU32(&out[16], points[i].count);
+		out += HISTORY_POINT_SIZE;
+	}
+	client->bufferSize = (unsigned int)(out - client->buffer);
+
+	if (numPoints == 0)
+	{
+		client->isLastChunk = true;
+		return;
+	}
+
+	client->pointsLeft -= numPoints;
+	if (client->resolution > 0)
+	{
+		client->next = points[numPoints - 1].time + client->resolution;
+	}
+	else
+	{
+		client->next = points[numPoints - 1].time + 1;
+	}
+	//Wrapped around end of time
+	if (client->next <= points[numPoints - 1].time)
+	{
+		client->pointsLeft = 0;
+	}
+}
+
+/**
+ * Validate a complete request, and set client up to stream its response.
+ */
+static void StartResponse(HistoryServer *me, HistoryClient *client)
+{
+	const uint8_t *request = client->request;
+	uint8_t zone = request[3];
+	uint32_t from = GetU32(&request[4]);
+	uint32_t to = GetU32(&request[8]);
+	uint32_t resolution = GetU32(&request[12]);
+	uint32_t maxPoints = GetU16(&request[16]);
+	uint32_t span;
+
+	me->requests++;
+	client->requestSize = 0;
+	client->isStreaming = true;
+	client->isLastChunk = false;
+
+	if (GetU16(&request[0]) != HISTORY_PROTOCOL_MAGIC || request[2] != HISTORY_PROTOCOL_VERSION || from > to)
+	{
+		PutHeader(client, HistoryStatus_BadRequest, 0);
+		client->isLastChunk = true;
+		return;
+	}
+	if (zone >= me->numZones)
+	{
+		PutHeader(client, HistoryStatus_UnknownZone, 0);
+		client->isLastChunk = true;
+		return;
+	}
+
+	if (maxPoints == 0 || maxPoints > HISTORY_MAX_POINTS)
+	{
+		maxPoints = HISTORY_MAX_POINTS;
+	}
+	//Intervals aligned to resolution, so range may touch one more than span / resolution
+	span = to - from;
+	if (maxPoints > 1 && resolution < span / (maxPoints - 1) + 1)
+	{
+		resolution = span / (maxPoints - 1) + 1;
+	}
+
+	pthread_mutex_lock(me->lock);
+	resolution = TimeSeries_Resolution(me->zones[zone], from, resolution);
+	pthread_mutex_unlock(me->lock);
+
+	client->zone = zone;
+	client->next = from;
+	client->to = to;
+	client->resolution = resolution;
+	client->pointsLeft = maxPoints;
+	PutHeader(client, HistoryStatus_Ok, resolution);
+	FillChunk(me, client);
+}
+
+static bool Receive(HistoryServer *me, HistoryClient *client)
+{
+	ssize_t received = recv(client->fd, &client->request[client->requestSize],
+							HISTORY_REQUEST_SIZE - client->requestSize, 0);
+
+	if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+	{
+		return false;
+	}
+	if (received > 0)
+	{
+		client->requestSize += (unsigned int)received;
+		if (client->requestSize == HISTORY_REQUEST_SIZE)
+		{
+			StartResponse(me, client);
+		}
+	}
+	return true;
+}
+
+/**
+ * Send as much of the response as socket takes, producing further chunks
+ * once the current one is out.
+ */
+static bool Send(HistoryServer *me, HistoryClient *client)
+{
+	for (;;)
+	{
+		ssize_t sent;
+
+		if (client->bufferSent == client->bufferSize)
+		{
+			if (client->isLastChunk)
+			{
+				client->isStreaming = false;
+				return true;
+			}
+			client->bufferSize = 0;
+			client->bufferSent = 0;
+			FillChunk(me, client);
+		}
+
+		sent = send(client->fd, &client->buffer[client->bufferSent], client->bufferSize - client->bufferSent, MSG_NOSIGNAL);
+		if (sent < 0)
+		{
+			return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+		}
+		client->bufferSent += (unsigned int)sent;
+	}
+}
+
+/**
+ * Start listening on Unix socket path, and on loopback TCP port unless
+ * it is 0. Zones has numZones entries, zones[i] being the history of
+ * the measurement control zone i is driven by. Lock must be held while
+ * they are written.
+ */
+bool HistoryServer_Open(HistoryServer *me, const char *path, uint16_t tcpPort,
+						const TimeSeries *const *zones, uint8_t numZones, pthread_mutex_t *lock)
+{
+	unsigned int i;
+
+	memset(me, 0, sizeof(*me));
+	me->zones = zones;
+	me->numZones = numZones;
+	me->lock = lock;
+	me->tcpFd = NO_FD;
+	for (i = 0; i < HISTORY_SERVER_MAX_CLIENTS; ++i)
+	{
+		me->clients[i].fd = NO_FD;
+	}
+
+	if (strlen(path) >= sizeof(me->path))
+	{
+		return false;
+	}
+	strcpy(me->path, path);
+
+	me->unixFd = ListenUnix(path);
+	if (me->unixFd == NO_FD)
+	{
+		return false;
+	}
+
+	if (tcpPort != 0)
+	{
+		me->tcpFd = ListenLoopback(tcpPort);
+		if (me->tcpFd == NO_FD)
+		{
+			close(me->unixFd);
+			unlink(me->path);
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Wait up to timeout milliseconds (-1 forever) for socket activity, and
+ * serve it. Return false on poll failure.
+ */
+bool HistoryServer_Poll(HistoryServer *me, int timeout)
+{
+	struct pollfd fds[HISTORY_SERVER_MAX_CLIENTS + 2];
+	HistoryClient *clients[HISTORY_SERVER_MAX_CLIENTS + 2];
+	nfds_t numFds = 0;
+	nfds_t i;
+	int ready;
+
+	fds[numFds].fd = me->unixFd;
+	fds[numFds].events = POLLIN;
+	clients[numFds++] = NULL;
+	if (me->tcpFd != NO_FD)
+	{
+		fds[numFds].fd = me->tcpFd;
+		fds[numFds].events = POLLIN;
+		clients[numFds++] = NULL;
+	}
+	for (i = 0; i < HISTORY_SERVER_MAX_CLIENTS; ++i)
+	{
+		HistoryClient *client = &me->clients[i];
+
+		if (client->fd != NO_FD)
+		{
+			fds[numFds].fd = client->fd;
+			fds[numFds].events = client->isStreaming ? POLLOUT : POLLIN;
+			clients[numFds++] = client;
+		}
+	}
+
+	ready = poll(fds, numFds, timeout);
+	if (ready < 0)
+	{
+		return (errno == EINTR);
+	}
+
+	for (i = 0; i < numFds && ready > 0; ++i)
+	{
+		HistoryClient *client = clients[i];
+		bool isOk = true;
+
+		if (fds[i].revents == 0)
+		{
+			continue;
+		}
+		ready--;
+
+		if (client == NULL)
+		{
+			Accept(me, fds[i].fd);
+			continue;
+		}
+
+		if (fds[i].revents & (POLLERR | POLLNVAL))
+		{
+			isOk = false;
+		}
+		else if (client->isStreaming)
+		{
+			isOk = Send(me, client);
+		}
+		else
+		{
+			isOk = Receive(me, client);
+			//Answer straight away, socket is most likely writable
+			if (isOk && client->isStreaming)
+			{
+				isOk = Send(me, client);
+			}
+		}
+
+		if (!isOk)
+		{
+			CloseClient(client);
+		}
+	}
+	return true;
+}
+
+void HistoryServer_Close(HistoryServer *me)
+{
+	unsigned int i;
+
+	for (i = 0; i < HISTORY_SERVER_MAX_CLIENTS; ++i)
+	{
+		if (me->clients[i].fd != NO_FD)
+		{
+			CloseClient(&me->clients[i]);
+		}
+	}
+	if (me->tcpFd != NO_FD)
+	{
+		close(me->tcpFd);
+		me->tcpFd = NO_FD;
+	}
+	if (me->unixFd != NO_FD)
+	{
+		close(me->unixFd);
+		me->unixFd = NO_FD;
+		unlink(me->path);
+	}
+}
@@ -0,0 +1,130 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef HISTORY_SERVER_H
+#define HISTORY_SERVER_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "time_series.h"
+
+/**
+ * Local history query endpoint, on a Unix domain socket and optionally
+ * on a loopback TCP port. All integers are little endian.
+ *
+ * Request, 20 bytes:
+ *   u16 magic, u8 version, u8 zone, u32 from, u32 to, u32 resolution,
+ *   u16 maxPoints (0 for server maximum), u16 reserved
+ * Zone is a control zone of the controller, answered with the history
+ * of the measurement that drives it.
+ * Response header, 8 bytes:
+ *   u16 magic, u8 version, u8 status, u32 resolution actually used
+ * Followed, if status is ok, by chunks:
+ *   u16 count, then count points of u32 time, f32 min, f32 max, f32 mean, u32 count
+ * A chunk with zero count ends the response. Further requests may follow
+ * on the same connection.
+ *
+ * Responses are produced one chunk at a time, so a large range needs no
+ * more memory than a small one. Resolution is raised so that at most
+ * maxPoints points are returned for [from, to].
+ */
+
+#define HISTORY_PROTOCOL_MAGIC (0x4843)	//"CH"
+#define HISTORY_PROTOCOL_VERSION (1)
+#define HISTORY_REQUEST_SIZE (20)
+#define HISTORY_RESPONSE_HEADER_SIZE (8)
+#define HISTORY_POINT_SIZE (20)
+#define HISTORY_CHUNK_POINTS (64)
+#define HISTORY_MAX_POINTS (4096)
+#define HISTORY_SERVER_MAX_CLIENTS (32)
+#define HISTORY_SERVER_PATH_SIZE (108)
+#define HISTORY_SERVER_PATH "climate_history.sock"	//In controller's state directory
+#define HISTORY_SERVER_TCP_PORT (0)	//Loopback port, 0 for Unix socket only
+
+typedef enum
+{
+	HistoryStatus_Ok,
+	HistoryStatus_BadRequest,
+	HistoryStatus_UnknownZone,
+}HistoryStatus_Type;
+
+typedef struct
+{
+	int fd;
+	uint8_t request[HISTORY_REQUEST_SIZE];
+	unsigned int requestSize;
+
+	//Response being streamed
+	bool isStreaming;
+	uint8_t zone;
+	uint32_t next;	//Start of next chunk
+	uint32_t to;
+	uint32_t resolution;
+	uint32_t pointsLeft;
+	uint8_t buffer[HISTORY_RESPONSE_HEADER_SIZE + 2 + HISTORY_CHUNK_POINTS * HISTORY_POINT_SIZE];
+	unsigned int bufferSize;
+	unsigned int bufferSent;
+	bool isLastChunk;
+}HistoryClient;
+
+typedef struct
+{
+	int unixFd;
+	int tcpFd;
+	char path[HISTORY_SERVER_PATH_SIZE];
+	const TimeSeries *const *zones;	//Measurement history driving each control zone
+	uint8_t numZones;
+	pthread_mutex_t *lock;	//Held by writers of series
+	HistoryClient clients[HISTORY_SERVER_MAX_CLIENTS];
+
+	unsigned long requests;
+	unsigned long rejectedClients;
+}HistoryServer;
+
+bool HistoryServer_Open(HistoryServer *me, const char *path, uint16_t tcpPort,
+						const TimeSeries *const *zones, uint8_t numZones, pthread_mutex_t *lock);
+bool HistoryServer_Poll(HistoryServer *me, int timeout);
+void HistoryServer_Close(HistoryServer *me);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* HISTORY_SERVER_H */
@@ -0,0 +1,646 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "history_store.h"
+
+#define SEGMENT_MAGIC (0x53484343)	//"CCHS"
+#define BLOCK_MAGIC (0x4B4C4243)	//"CBLK"
+#define SEGMENT_VERSION (1)
+#define SEGMENT_NAME_FORMAT "history-%08u.seg"
+#define FNV_OFFSET_BASIS (2166136261u)
+#define FNV_PRIME (16777619u)
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t pageSize;
+	uint32_t blockRecords;
+	uint32_t numBlocks;
+	uint32_t sequence;
+}HistorySegmentHeader;
+
+static size_t SegmentSize(uint32_t numBlocks)
+{
+	return (size_t)HISTORY_STORE_PAGE_SIZE * (numBlocks + 1);
+}
+
+static HistoryBlock *BlockAt(uint8_t *map, uint32_t index)
+{
+	return (HistoryBlock *)(map + (size_t)HISTORY_STORE_PAGE_SIZE * (index + 1));
+}
+
+static void SegmentPath(const HistoryStore *me, uint32_t sequence, char *path)
+{
+	snprintf(path, HISTORY_STORE_PATH_SIZE, "%s/" SEGMENT_NAME_FORMAT, me->dir, sequence);
+}
+
+static uint32_t Fnv1a(uint32_t hash, const void *data, size_t size)
+{
+	const uint8_t *bytes = (const uint8_t *)data;
+	size_t i;
+
+	for (i = 0; i < size; ++i)
+	{
+		hash = (hash ^ bytes[i]) * FNV_PRIME;
+	}
+	return hash;
+}
+
+static uint32_t BlockChecksum(const HistoryBlock *block, uint32_t count)
+{
+	uint32_t hash = FNV_OFFSET_BASIS;
+
+	hash = Fnv1a(hash, block->times, count * sizeof(block->times[0]));
+	hash = Fnv1a(hash, block->temperatures, count * sizeof(block->temperatures[0]));
+	hash = Fnv1a(hash, block->humidities, count * sizeof(block->humidities[0]));
+	hash = Fnv1a(hash, block->zones, count * sizeof(block->zones[0]));
+	return Fnv1a(hash, block->relays, count * sizeof(block->relays[0]));
+}
+
+static void CommitBlock(HistoryBlock *block, uint32_t count)
+{
+	if (count > 0)
+	{
+		block->header.firstTime = block->times[0];
+		block->header.lastTime = block->times[count - 1];
+		block->header.checksum = BlockChecksum(block, count);
+		block->header.count = count;
+		block->header.magic = BLOCK_MAGIC;
+	}
+}
+
+/**
+ * Number of valid records in a block: committed ones, plus any appended
+ * after the last commit. Records are written in sequence, time last, so
+ * these are the ones following with a time set, whatever the time is.
+ */
+static uint32_t RecoverBlockCount(const HistoryBlock *block)
+{
+	uint32_t count = 0;
+
+	if ((block->header.magic == BLOCK_MAGIC) && (block->header.count <= HISTORY_BLOCK_RECORDS) &&
+		(BlockChecksum(block, block->header.count) == block->header.checksum))
+	{
+		count = block->header.count;
+	}
+
+	while ((count < HISTORY_BLOCK_RECORDS) && (block->times[count] != 0))
+	{
+		count++;
+	}
+	return count;
+}
+
+static uint8_t *MapSegment(const HistoryStore *me, uint32_t sequence, bool isWritable, int *fd, size_t *size)
+{
+	char path[HISTORY_STORE_PATH_SIZE];
+	struct stat info;
+	uint8_t *map;
+
+	SegmentPath(me, sequence, path);
+	*fd = open(path, isWritable ? O_RDWR : O_RDONLY);
+	if (*fd < 0)
+	{
+		return NULL;
+	}
+
+	if ((fstat(*fd, &info) != 0) || (info.st_size < (off_t)SegmentSize(0)))
+	{
+		close(*fd);
+		return NULL;
+	}
+
+	*size = (size_t)info.st_size;
+	map = mmap(NULL, *size, isWritable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, *fd, 0);
+	if (map == MAP_FAILED)
+	{
+		close(*fd);
+		return NULL;
+	}
+	return map;
+}
+
+static void UnmapSegment(int fd, uint8_t *map, size_t size)
+{
+	munmap(map, size);
+	close(fd);
+}
+
+static bool IsSegmentValid(const uint8_t *map, size_t size)
+{
+	const HistorySegmentHeader *header = (const HistorySegmentHeader *)map;
+
+	return (header->magic == SEGMENT_MAGIC) && (header->version == SEGMENT_VERSION) &&
+		(header->pageSize == HISTORY_STORE_PAGE_SIZE) && (header->blockRecords == HISTORY_BLOCK_RECORDS) &&
+		(SegmentSize(header->numBlocks) <= size);
+}
+
+/**
+ * Rebuild segment's index entry from its blocks, committing blocks whose
+ * recovered count differs from their header, so that scans see every
+ * recovered record. Map must be writable.
+ * Return index of first block not full, and its record count.
+ */
+static void LoadSegmentInfo(uint8_t *map, HistorySegmentInfo *info, uint32_t *tailBlock, uint32_t *tailCount)
+{
+	const HistorySegmentHeader *header = (const HistorySegmentHeader *)map;
+	uint32_t previous = 0;
+	uint32_t i, j;
+
+	info->numRecords = 0;
+	info->firstTime = 0;
+	info->lastTime = 0;
+	info->isOrdered = true;
+	*tailCount = 0;
+
+	for (i = 0; i < header->numBlocks; ++i)
+	{
+		HistoryBlock *block = BlockAt(map, i);
+		uint32_t count = RecoverBlockCount(block);
+
+		if (block->header.count != count)
+		{
+			memset(&block->header, 0, sizeof(HistoryBlockHeader));
+			CommitBlock(block, count);
+		}
+
+		for (j = 0; j < count; ++j)
+		{
+			uint32_t time = block->times[j];
+
+			if ((info->numRecords == 0) || (time < info->firstTime))
+			{
+				info->firstTime = time;
+			}
+			if (time > info->lastTime)
+			{
+				info->lastTime = time;
+			}
+			if (time < previous)
+			{
+				info->isOrdered = false;
+			}
+			previous = time;
+			info->numRecords++;
+		}
+
+		if (count < HISTORY_BLOCK_RECORDS)
+		{
+			*tailCount = count;
+			break;
+		}
+	}
+	*tailBlock = i;
+}
+
+static int CompareSequence(const void *a, const void *b)
+{
+	uint32_t first = ((const HistorySegmentInfo *)a)->sequence;
+	uint32_t second = ((const HistorySegmentInfo *)b)->sequence;
+
+	return (first > second) - (first < second);
+}
+
+/**
+ * Find existing segments and index them, oldest first
+ */
+static bool LoadSegments(HistoryStore *me)
+{
+	DIR *dir = opendir(me->dir);
+	struct dirent *entry;
+
+	if (!dir)
+	{
+		return false;
+	}
+
+	me->numSegments = 0;
+	while (((entry = readdir(dir)) != NULL) && (me->numSegments < HISTORY_STORE_MAX_SEGMENTS))
+	{
+		uint32_t sequence;
+		char name[32];
+
+		if ((sscanf(entry->d_name, SEGMENT_NAME_FORMAT, &sequence) == 1) &&
+			(snprintf(name, sizeof(name), SEGMENT_NAME_FORMAT, sequence) > 0) &&
+			(strcmp(name, entry->d_name) == 0))
+		{
+			me->segments[me->numSegments++].sequence = sequence;
+		}
+	}
+	closedir(dir);
+
+	qsort(me->segments, me->numSegments, sizeof(HistorySegmentInfo), CompareSequence);
+	return true;
+}
+
+static bool CreateSegment(HistoryStore *me, uint32_t sequence)
+{
+	char path[HISTORY_STORE_PATH_SIZE];
+	HistorySegmentHeader *header;
+
+	SegmentPath(me, sequence, path);
+	me->tailFd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (me->tailFd < 0)
+	{
+		return false;
+	}
+
+	//File is sparse, blocks read as zero until written
+	me->tailMapSize = SegmentSize(me->blocksPerSegment);
+	if (ftruncate(me->tailFd, me->tailMapSize) != 0)
+	{
+		close(me->tailFd);
+		unlink(path);
+		return false;
+	}
+
+	me->tailMap = mmap(NULL, me->tailMapSize, PROT_READ | PROT_WRITE, MAP_SHARED, me->tailFd, 0);
+	if (me->tailMap == MAP_FAILED)
+	{
+		me->tailMap = NULL;
+		close(me->tailFd);
+		unlink(path);
+		return false;
+	}
+
+	header = (HistorySegmentHeader *)me->tailMap;
+	header->magic = SEGMENT_MAGIC;
+	header->version = SEGMENT_VERSION;
+	header->pageSize = HISTORY_STORE_PAGE_SIZE;
+	header->blockRecords = HISTORY_BLOCK_RECORDS;
+	header->numBlocks = me->blocksPerSegment;
+	header->sequence = sequence;
+	msync(me->tailMap, HISTORY_STORE_PAGE_SIZE, MS_SYNC);
+
+	me->tailBlock = 0;
+	me->tailCount = 0;
+	me->syncedBlock = 0;
+	return true;
+}
+
+/**
+ * Close tail segment and start a new one, dropping oldest segment
+ * if the store is at its limit.
+ */
+static bool RotateSegment(HistoryStore *me)
+{
+	uint32_t sequence = 1;
+
+	if (me->tailMap)
+	{
+		HistoryStore_Sync(me);
+		UnmapSegment(me->tailFd, me->tailMap, me->tailMapSize);
+		me->tailMap = NULL;
+	}
+
+	if (me->numSegments > 0)
+	{
+		sequence = me->segments[me->numSegments - 1].sequence + 1;
+	}
+
+	if (me->numSegments >= me->maxSegments)
+	{
+		char path[HISTORY_STORE_PATH_SIZE];
+
+		SegmentPath(me, me->segments[0].sequence, path);
+		unlink(path);
+		memmove(&me->segments[0], &me->segments[1], (me->numSegments - 1) * sizeof(HistorySegmentInfo));
+		me->numSegments--;
+	}
+
+	if (!CreateSegment(me, sequence))
+	{
+		return false;
+	}
+
+	memset(&me->segments[me->numSegments], 0, sizeof(HistorySegmentInfo));
+	me->segments[me->numSegments].sequence = sequence;
+	me->numSegments++;
+	return true;
+}
+
+static uint32_t TailBlocks(const HistoryStore *me)
+{
+	return ((HistorySegmentHeader *)me->tailMap)->numBlocks;
+}
+
+/**
+ * Open the store in dir, creating it if needed, and recover its tail.
+ * blocksPerSegment applies to new segments, existing ones keep their size.
+ */
+bool HistoryStore_Open(HistoryStore *me, const char *dir, uint32_t blocksPerSegment, uint32_t maxSegments)
+{
+	uint32_t i, valid = 0;
+
+	memset(me, 0, sizeof(HistoryStore));
+	me->tailFd = -1;
+	me->blocksPerSegment = blocksPerSegment;
+	me->maxSegments = (maxSegments > HISTORY_STORE_MAX_SEGMENTS) ? HISTORY_STORE_MAX_SEGMENTS : maxSegments;
+	if ((blocksPerSegment == 0) || (me->maxSegments == 0) || (strlen(dir) >= HISTORY_STORE_DIR_SIZE))
+	{
+		return false;
+	}
+	strcpy(me->dir, dir);
+
+	if ((mkdir(dir, 0755) != 0) && (errno != EEXIST))
+	{
+		return false;
+	}
+
+	if (!LoadSegments(me))
+	{
+		return false;
+	}
+
+	//Index and repair every segment, dropping foreign or damaged files from the index
+	for (i = 0; i < me->numSegments; ++i)
+	{
+		int fd;
+		size_t size;
+		uint32_t tailBlock, tailCount;
+		uint8_t *map = MapSegment(me, me->segments[i].sequence, true, &fd, &size);
+
+		if (map)
+		{
+			if (IsSegmentValid(map, size))
+			{
+				me->segments[valid].sequence = me->segments[i].sequence;
+				LoadSegmentInfo(map, &me->segments[valid], &tailBlock, &tailCount);
+				valid++;
+			}
+			UnmapSegment(fd, map, size);
+		}
+	}
+	me->numSegments = valid;
+
+	if (me->numSegments == 0)
+	{
+		return RotateSegment(me);
+	}
+
+	//Continue appending to the last segment
+	me->tailMap = MapSegment(me, me->segments[me->numSegments - 1].sequence, true, &me->tailFd, &me->tailMapSize);
+	if (!me->tailMap)
+	{
+		return false;
+	}
+	LoadSegmentInfo(me->tailMap, &me->segments[me->numSegments - 1], &me->tailBlock, &me->tailCount);
+	me->syncedBlock = me->tailBlock;
+
+	//Forget anything beyond the recovered tail, so that it is not picked up again
+	if (me->tailBlock < TailBlocks(me))
+	{
+		HistoryBlock *block = BlockAt(me->tailMap, me->tailBlock);
+
+		memset(&block->times[me->tailCount], 0, (HISTORY_BLOCK_RECORDS - me->tailCount) * sizeof(block->times[0]));
+	}
+	return true;
+}
+
+bool HistoryStore_Append(HistoryStore *me, const HistoryRecord *record)
+{
+	HistorySegmentInfo *info;
+	HistoryBlock *block;
+
+	if (record->time == 0)
+	{
+		return false;
+	}
+
+	if (!me->tailMap || (me->tailBlock >= TailBlocks(me)))
+	{
+		if (!RotateSegment(me))
+		{
+			return false;
+		}
+	}
+
+	block = BlockAt(me->tailMap, me->tailBlock);
+	block->temperatures[me->tailCount] = record->temperature;
+	block->humidities[me->tailCount] = record->humidity;
+	block->zones[me->tailCount] = record->zone;
+	block->relays[me->tailCount] = record->relays;
+	//Time marks the record as written, so it goes last
+	__sync_synchronize();
+	block->times[me->tailCount] = record->time;
+
+	info = &me->segments[me->numSegments - 1];
+	if (info->numRecords == 0)
+	{
+		info->firstTime = record->time;
+		info->lastTime = record->time;
+		info->isOrdered = true;
+	}
+	else if (record->time < info->lastTime)
+	{
+		//Clock stepped back
+		info->isOrdered = false;
+		if (record->time < info->firstTime)
+		{
+			info->firstTime = record->time;
+		}
+	}
+	else
+	{
+		info->lastTime = record->time;
+	}
+	info->numRecords++;
+	me->recordsAppended++;
+
+	if (++me->tailCount == HISTORY_BLOCK_RECORDS)
+	{
+		CommitBlock(block, me->tailCount);
+		me->tailBlock++;
+		me->tailCount = 0;
+	}
+	return true;
+}
+
+/**
+ * Commit tail block and flush everything written since last sync to storage.
+ * This blocks on the storage, so should be called from a background thread.
+ */
+bool HistoryStore_Sync(HistoryStore *me)
+{
+	uint32_t lastBlock;
+	size_t offset, length;
+
+	if (!me->tailMap)
+	{
+		return false;
+	}
+
+	lastBlock = me->tailBlock;
+	if (me->tailBlock < TailBlocks(me))
+	{
+		CommitBlock(BlockAt(me->tailMap, me->tailBlock), me->tailCount);
+	}
+	else
+	{
+		lastBlock = TailBlocks(me) - 1;
+	}
+
+	if (me->syncedBlock > lastBlock)
+	{
+		return true;
+	}
+
+	offset = (size_t)HISTORY_STORE_PAGE_SIZE * (me->syncedBlock + 1);
+	length = (size_t)HISTORY_STORE_PAGE_SIZE * (lastBlock - me->syncedBlock + 1);
+	if (msync(me->tailMap + offset, length, MS_SYNC) != 0)
+	{
+		return false;
+	}
+	me->bytesSynced += length;
+	me->syncedBlock = me->tailBlock;
+	return true;
+}
+
+/**
+ * Call callback for every record within [from, to], in the order they
+ * were appended, until it returns false. Return number of records visited.
+ */
+uint64_t HistoryStore_Scan(HistoryStore *me, uint32_t from, uint32_t to, HistoryStore_ScanCallback callback, void *context)
+{
+	uint64_t visited = 0;
+	uint32_t i;
+	bool isDone = false;
+	bool isSegmentDone;
+
+	for (i = 0; (i < me->numSegments) && !isDone; ++i)
+	{
+		const HistorySegmentInfo *info = &me->segments[i];
+		bool isTail = (i == me->numSegments - 1);
+		uint8_t *map;
+		int fd = -1;
+		size_t size = 0;
+		uint32_t usedBlocks, low, high, block;
+
+		if ((info->numRecords == 0) || (info->lastTime < from) || (info->firstTime > to))
+		{
+			continue;
+		}
+
+		map = isTail ? me->tailMap : MapSegment(me, info->sequence, false, &fd, &size);
+		if (!map)
+		{
+			continue;
+		}
+
+		usedBlocks = (info->numRecords + HISTORY_BLOCK_RECORDS - 1) / HISTORY_BLOCK_RECORDS;
+
+		//Sparse index: find last block starting at or before from,
+		//segments whose clock stepped back are scanned from the start
+		low = 0;
+		high = usedBlocks;
+		while (info->isOrdered && (high - low > 1))
+		{
+			uint32_t middle = low + (high - low) / 2;
+
+			if (BlockAt(map, middle)->times[0] <= from)
+			{
+				low = middle;
+			}
+			else
+			{
+				high = middle;
+			}
+		}
+
+		isSegmentDone = false;
+		for (block = low; (block < usedBlocks) && !isDone && !isSegmentDone; ++block)
+		{
+			const HistoryBlock *data = BlockAt(map, block);
+			uint32_t count = (isTail && (block == me->tailBlock)) ? me->tailCount : data->header.count;
+			uint32_t j;
+
+			for (j = 0; j < count; ++j)
+			{
+				HistoryRecord record;
+
+				if ((data->times[j] > to) && info->isOrdered)
+				{
+					//Later segments may still hold earlier times, if clock stepped back
+					isSegmentDone = true;
+					break;
+				}
+				if ((data->times[j] < from) || (data->times[j] > to))
+				{
+					continue;
+				}
+
+				record.time = data->times[j];
+				record.zone = data->zones[j];
+				record.relays = data->relays[j];
+				record.temperature = data->temperatures[j];
+				record.humidity = data->humidities[j];
+				visited++;
+
+				if (!callback(&record, context))
+				{
+					isDone = true;
+					break;
+				}
+			}
+		}
+
+		if (!isTail)
+		{
+			UnmapSegment(fd, map, size);
+		}
+	}
+	return visited;
+}
+
+void HistoryStore_Close(HistoryStore *me)
+{
+	if (me->tailMap)
+	{
+		HistoryStore_Sync(me);
+		UnmapSegment(me->tailFd, me->tailMap, me->tailMapSize);
+		me->tailMap = NULL;
+		me->tailFd = -1;
+	}
+}
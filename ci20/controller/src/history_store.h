@@ -0,0 +1,153 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef HISTORY_STORE_H
+#define HISTORY_STORE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Append-only persistent store of measurement records, kept in memory
+ * mapped segment files named history-<sequence>.seg in one directory.
+ *
+ * Each segment is a header page followed by fixed size blocks, one page
+ * each. A block stores its records column by column (times, temperatures,
+ * humidities, zones, relays), so that range scans touch only the columns
+ * they need and a block fills exactly one page.
+ *
+ * Block headers hold the committed record count, first/last time and a
+ * checksum. They are written on HistoryStore_Sync() and when a block
+ * fills, and serve as the sparse time index: a range scan binary searches
+ * block headers of each segment overlapping the range.
+ *
+ * A record's time is written after its other columns and is never zero,
+ * so on open every block is recovered up to its committed count, then
+ * extended over the records following it whose time is set, and its
+ * header committed again if that count differs (these
+ * survive a process crash as they are in the page cache, and are lost on
+ * power failure unless synced).
+ *
+ * Times may step back, e.g. when the clock is corrected. Records stay in
+ * the order they were appended, and segments with a step back are
+ * scanned in full instead of through the time index.
+ *
+ * Not thread safe, use from a single thread.
+ */
+
+#define HISTORY_STORE_PAGE_SIZE (4096)
+#define HISTORY_STORE_MAX_SEGMENTS (64)
+#define HISTORY_STORE_PATH_SIZE (256)
+#define HISTORY_STORE_DIR_SIZE (HISTORY_STORE_PATH_SIZE - 32)
+
+typedef struct
+{
+	uint32_t time;	//seconds since epoch, non zero
+	uint8_t zone;
+	uint8_t relays;	//bit i set, if relay i is ON
+	int16_t temperature;	//centi degree centigrade
+	uint16_t humidity;	//centi percentage
+}HistoryRecord;
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t count;	//Committed records
+	uint32_t firstTime;
+	uint32_t lastTime;
+	uint32_t checksum;	//Of committed records
+	uint32_t reserved[3];
+}HistoryBlockHeader;
+
+#define HISTORY_RECORD_SIZE (sizeof(uint32_t) + sizeof(int16_t) + sizeof(uint16_t) + 2 * sizeof(uint8_t))
+#define HISTORY_BLOCK_RECORDS ((HISTORY_STORE_PAGE_SIZE - sizeof(HistoryBlockHeader)) / HISTORY_RECORD_SIZE)
+
+typedef struct
+{
+	HistoryBlockHeader header;
+	uint32_t times[HISTORY_BLOCK_RECORDS];
+	int16_t temperatures[HISTORY_BLOCK_RECORDS];
+	uint16_t humidities[HISTORY_BLOCK_RECORDS];
+	uint8_t zones[HISTORY_BLOCK_RECORDS];
+	uint8_t relays[HISTORY_BLOCK_RECORDS];
+}HistoryBlock;
+
+typedef struct
+{
+	uint32_t sequence;
+	uint32_t firstTime;	//Earliest record time
+	uint32_t lastTime;	//Latest record time
+	uint32_t numRecords;
+	bool isOrdered;	//Times never step back, so time index applies
+}HistorySegmentInfo;
+
+typedef struct
+{
+	char dir[HISTORY_STORE_DIR_SIZE];
+	uint32_t blocksPerSegment;
+	uint32_t maxSegments;
+
+	HistorySegmentInfo segments[HISTORY_STORE_MAX_SEGMENTS];	//Oldest first, last one is tail
+	uint32_t numSegments;
+
+	//Tail segment, mapped for writing
+	int tailFd;
+	uint8_t *tailMap;
+	size_t tailMapSize;
+	uint32_t tailBlock;	//Block being filled
+	uint32_t tailCount;	//Records in that block
+	uint32_t syncedBlock;	//First block modified since last sync
+
+	uint64_t recordsAppended;
+	uint64_t bytesSynced;
+}HistoryStore;
+
+typedef bool (*HistoryStore_ScanCallback)(const HistoryRecord *record, void *context);
+
+bool HistoryStore_Open(HistoryStore *me, const char *dir, uint32_t blocksPerSegment, uint32_t maxSegments);
+bool HistoryStore_Append(HistoryStore *me, const HistoryRecord *record);
+bool HistoryStore_Sync(HistoryStore *me);
+uint64_t HistoryStore_Scan(HistoryStore *me, uint32_t from, uint32_t to, HistoryStore_ScanCallback callback, void *context);
+void HistoryStore_Close(HistoryStore *me);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* HISTORY_STORE_H */
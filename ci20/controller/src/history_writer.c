@@ -0,0 +1,160 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include <time.h>
+
+#include "history_writer.h"
+#include "controller_logging.h"
+
+#define HISTORY_WRITER_STACK_SIZE (4096)
+#define HISTORY_WRITER_PRIORITY (1)
+
+static unsigned long MonotonicMs(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ * History writer thread: appends posted records, and syncs once
+ * enough records are pending or sync interval has passed.
+ */
+static void HistoryWriterThread(FlowThread thread, void *context)
+{
+	HistoryWriter *me = (HistoryWriter *)context;
+	unsigned int pending = 0;
+	unsigned long lastSync = MonotonicMs();
+
+	for (;;)
+	{
+		HistoryRecord *record = FlowQueue_DequeueWaitFor(me->queue, HISTORY_SYNC_INTERVAL);
+
+		if (record)
+		{
+			if (HistoryStore_Append(&me->store, record))
+			{
+				pending++;
+			}
+			else
+			{
+				ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Appending history record failed");
+			}
+			Flow_MemFree((void **)&record);
+		}
+
+		if ((pending > 0) && ((pending >= HISTORY_SYNC_BATCH) || (MonotonicMs() - lastSync >= HISTORY_SYNC_INTERVAL)))
+		{
+			if (!HistoryStore_Sync(&me->store))
+			{
+				ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Syncing history failed");
+			}
+			pending = 0;
+			lastSync = MonotonicMs();
+		}
+	}
+}
+
+/**
+ * Open history store in dir, hand its records from restoreFrom on to
+ * restore (unless NULL), and start its writer thread. Restore is called
+ * before the thread starts, as the store is not thread safe.
+ * Controller keeps running without history, if this fails.
+ */
+bool HistoryWriter_Start(HistoryWriter *me, const char *dir, uint32_t restoreFrom,
+						HistoryStore_ScanCallback restore, void *context)
+{
+	if (!HistoryStore_Open(&me->store, dir, HISTORY_BLOCKS_PER_SEGMENT, HISTORY_MAX_SEGMENTS))
+	{
+		ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Opening history store in %s failed", dir);
+		return false;
+	}
+
+	if (restore)
+	{
+		uint64_t restored = HistoryStore_Scan(&me->store, restoreFrom, UINT32_MAX, restore, context);
+
+		ControllerLog(ControllerLogLevel_Info, INFO_PREFIX "Restored %llu history records", (unsigned long long)restored);
+	}
+
+	me->queue = FlowQueue_NewBlocking(HISTORY_QUEUE_SIZE);
+	if (me->queue == NULL)
+	{
+		HistoryStore_Close(&me->store);
+		return false;
+	}
+
+	me->thread = FlowThread_New("HistoryWriterTask", HISTORY_WRITER_PRIORITY, HISTORY_WRITER_STACK_SIZE, HistoryWriterThread, me);
+	if (me->thread == NULL)
+	{
+		ControllerLog(ControllerLogLevel_Error, ERROR_PREFIX "Creation of history writer thread failed");
+		FlowQueue_Free(&me->queue);
+		HistoryStore_Close(&me->store);
+		return false;
+	}
+
+	me->isStarted = true;
+	ControllerLog(ControllerLogLevel_Info, INFO_PREFIX "History store opened with %u segments", me->store.numSegments);
+	return true;
+}
+
+/**
+ * Hand a record over to writer thread. Never blocks, record is dropped
+ * if the writer is not keeping up.
+ */
+bool HistoryWriter_Post(HistoryWriter *me, const HistoryRecord *record)
+{
+	HistoryRecord *copy;
+
+	if (!me->isStarted)
+	{
+		return false;
+	}
+
+	//Allocated memory should be freed by the receiver
+	copy = (HistoryRecord *)Flow_MemAlloc(sizeof(HistoryRecord));
+	if (copy)
+	{
+		*copy = *record;
+		if (FlowQueue_Enqueue(me->queue, copy))
+		{
+			return true;
+		}
+		Flow_MemFree((void **)&copy);
+	}
+
+	me->droppedRecords++;
+	return false;
+}
@@ -48,73 +48,10 @@
 #define QUEUE_SIZE (20)
 #define USER_TASK_PRIORITY (1)
 #define DEBUG_LEVEL_STRING "DEBUG_LEVEL"
+#define TRACE_STRING "TRACE"
+#define STATE_DIR_STRING "STATE_DIR"
 
-static Controller _Controller =
-{
-	.isUserUpdate = false,
-	.config =
-	{
-		.heartBeat = DEFAULT_HEARTBEAT,
-	},
-	.sensorConfig =
-	{
-		.isAlive = false,
-		.sensorId = NULL,
-		.heartBeat = DEFAULT_SENSOR_HEARTBEAT,
-	},
-	.actuatorConfig =
-	{
-		.isAlive = false,
-		.actuatorId = NULL,
-		.heartBeat = DEFAULT_ACTUATOR_HEARTBEAT,
-	},
-	.sensors =
-	{
-		{
-			.type = Sensor_Temperature,
-			.threshold = DEFAULT_TEMP_THRESHOLD,
-			.value = DEFAULT_SENSOR_VALUE,
-			.orientation = Orientation_Below,
-			.readInterval = DEFAULT_TEMP_READ_INTERVAL,
-			.readDelta = DEFAULT_TEMP_READ_DELTA,
-			.sensorTagString = TEMPERATURE_XML_TAG,
-			.thresholdTagString = TEMP_THRESHOLD_XML_TAG,
-			.orientationTagString = TEMP_ORIENTATION_XML_TAG,
-			.readIntervalTagString = TEMP_READ_INTERVAL_XML_TAG,
-			.readDeltaTagString = TEMP_READ_DELTA_XML_TAG,
-		},
-		{
-			.type = Sensor_Humidity,
-			.threshold = DEFAULT_HMDT_THRESHOLD,
-			.value = DEFAULT_SENSOR_VALUE,
-			.orientation = Orientation_Above,
-			.readInterval = DEFAULT_HMDT_READ_INTERVAL,
-			.readDelta = DEFAULT_HMDT_READ_DELTA,
-			.sensorTagString = HUMIDITY_XML_TAG,
-			.thresholdTagString = HMDT_THRESHOLD_XML_TAG,
-			.orientationTagString = HMDT_ORIENTATION_XML_TAG,
-			.readIntervalTagString = HMDT_READ_INTERVAL_XML_TAG,
-			.readDeltaTagString = HMDT_READ_DELTA_XML_TAG,
-		},
-	},
-	.relays =
-	{
-		{
-			.type = Relay_Heater,
-			.status = Relay_Off,
-			.mode = Relay_Auto,
-			.relayTagString = RELAY_1_XML_TAG,
-			.relayName = RELAY_1_STR,
-		},
-		{
-			.type = Relay_Fan,
-			.status = Relay_Off,
-			.mode = Relay_Auto,
-			.relayTagString = RELAY_2_XML_TAG,
-			.relayName = RELAY_2_STR,
-		},
-	},
-};
+static Controller _Controller;
 
 static bool ControllerInit(Controller *me)
 {
@@ -143,12 +80,26 @@ int main(int argc, char *argv[])
 	int result = -1;
 	Controller *me = &_Controller;
 	ControllerLog_Type level = ControllerLogLevel_None;
+	const char *tracePath = NULL;
+	int i;
+
+	ControllerSetDefaults(me);
 
-	if (argc > 1)
+	//Options are name value pairs, e.g. DEBUG_LEVEL 3 TRACE messages.trace STATE_DIR /tmp/climate
+	for (i = 1; i + 1 < argc; i += 2)
 	{
-		if (strcmp(DEBUG_LEVEL_STRING, argv[1]) == 0)
+		if (strcmp(DEBUG_LEVEL_STRING, argv[i]) == 0)
 		{
-			level = atoi(argv[2]);
+			level = atoi(argv[i + 1]);
+		}
+		else if (strcmp(TRACE_STRING, argv[i]) == 0)
+		{
+			tracePath = argv[i + 1];
+		}
+		else if (strcmp(STATE_DIR_STRING, argv[i]) == 0)
+		{
+			//Instead of DEFAULT_STATE_DIR
+			me->stateDir = argv[i + 1];
 		}
 	}
 
@@ -162,10 +113,20 @@ int main(int argc, char *argv[])
 
 	if (InitializeFlowInterface(me))
 	{
+		if (tracePath)
+		{
+			StartFlowInterfaceTrace(me, tracePath);
+		}
+
 		if (ControllerInit(me));
 		{
 			StartConsole();
 		}
+
+		if (tracePath)
+		{
+			StopFlowInterfaceTrace();
+		}
 	}
 
 	FlowQueue_Free(&me->sendMsgQueue);
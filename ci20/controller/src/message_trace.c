@@ -0,0 +1,275 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "message_trace.h"
+
+#define TRACE_MAGIC (0x544D4343)	//"CCMT"
+#define TRACE_VERSION (1)
+#define TRACE_HEADER_SIZE (16)
+#define RECORD_HEADER_SIZE (16)
+#define FLUSH_INTERVAL (1000000)	//microseconds
+#define MAX_CONTENT_LENGTH (1024 * 1024)
+
+static void PutU16(uint8_t *buffer, uint16_t value)
+{
+	buffer[0] = (uint8_t)value;
+	buffer[1] = (uint8_t)(value >> 8);
+}
+
+static void PutU32(uint8_t *buffer, uint32_t value)
+{
+	buffer[0] = (uint8_t)value;
+	buffer[1] = (uint8_t)(value >> 8);
+	buffer[2] = (uint8_t)(value >> 16);
+	buffer[3] = (uint8_t)(value >> 24);
+}
+
+static void PutU64(uint8_t *buffer, uint64_t value)
+{
+	PutU32(buffer, (uint32_t)value);
+	PutU32(buffer + 4, (uint32_t)(value >> 32));
+}
+
+static uint16_t GetU16(const uint8_t *buffer)
+{
+	return (uint16_t)(buffer[0] | (buffer[1] << 8));
+}
+
+static uint32_t GetU32(const uint8_t *buffer)
+{
+	return (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) | ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+}
+
+static uint64_t GetU64(const uint8_t *buffer)
+{
+	return (uint64_t)GetU32(buffer) | ((uint64_t)GetU32(buffer + 4) << 32);
+}
+
+static uint64_t NowUs(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * Start a new trace at path, replacing any existing one
+ */
+bool MessageTrace_Open(MessageTrace *me, const char *path)
+{
+	uint8_t header[TRACE_HEADER_SIZE] = {0};
+
+	memset(me, 0, sizeof(MessageTrace));
+	me->file = fopen(path, "wb");
+	if (!me->file)
+	{
+		return false;
+	}
+
+	PutU32(header, TRACE_MAGIC);
+	PutU16(header + 4, TRACE_VERSION);
+	PutU64(header + 8, (uint64_t)time(NULL));
+	if (fwrite(header, sizeof(header), 1, me->file) != 1)
+	{
+		fclose(me->file);
+		me->file = NULL;
+		return false;
+	}
+
+	pthread_mutex_init(&me->lock, NULL);
+	me->startUs = NowUs();
+	me->flushUs = me->startUs;
+	me->bytes = sizeof(header);
+	__atomic_store_n(&me->isOpen, true, __ATOMIC_RELEASE);
+	return true;
+}
+
+/**
+ * Append a payload to trace, does nothing if trace is not open.
+ * Peer IDs longer than 255 characters are truncated.
+ */
+void MessageTrace_Record(MessageTrace *me, MessageTrace_Direction direction, const char *peer,
+							const char *content, uint32_t length)
+{
+	uint8_t header[RECORD_HEADER_SIZE] = {0};
+	size_t peerLength = peer ? strlen(peer) : 0;
+	uint64_t now;
+
+	//Unlocked check so that tracing costs nothing while off, checked again under lock
+	if (!__atomic_load_n(&me->isOpen, __ATOMIC_ACQUIRE))
+	{
+		return;
+	}
+
+	if (peerLength >= MESSAGE_TRACE_PEER_SIZE)
+	{
+		peerLength = MESSAGE_TRACE_PEER_SIZE - 1;
+	}
+	if (!content)
+	{
+		length = 0;
+	}
+
+	pthread_mutex_lock(&me->lock);
+	if (!me->isOpen)
+	{
+		pthread_mutex_unlock(&me->lock);
+		return;
+	}
+
+	now = NowUs();
+	PutU64(header, now - me->startUs);
+	header[8] = (uint8_t)direction;
+	header[9] = (uint8_t)peerLength;
+	PutU32(header + 12, length);
+
+	if ((fwrite(header, sizeof(header), 1, me->file) == 1) &&
+		((peerLength == 0) || (fwrite(peer, peerLength, 1, me->file) == 1)) &&
+		((length == 0) || (fwrite(content, length, 1, me->file) == 1)))
+	{
+		me->records++;
+		me->bytes += sizeof(header) + peerLength + length;
+	}
+
+	if (now - me->flushUs >= FLUSH_INTERVAL)
+	{
+		fflush(me->file);
+		me->flushUs = now;
+	}
+	pthread_mutex_unlock(&me->lock);
+}
+
+/**
+ * Stop the trace, records from other threads after this do nothing.
+ * The lock is left in place, as those threads may still be taking it.
+ */
+void MessageTrace_Close(MessageTrace *me)
+{
+	if (__atomic_load_n(&me->isOpen, __ATOMIC_ACQUIRE))
+	{
+		pthread_mutex_lock(&me->lock);
+		__atomic_store_n(&me->isOpen, false, __ATOMIC_RELEASE);
+		fclose(me->file);
+		me->file = NULL;
+		pthread_mutex_unlock(&me->lock);
+	}
+}
+
+bool MessageTraceReader_Open(MessageTraceReader *me, const char *path)
+{
+	uint8_t header[TRACE_HEADER_SIZE];
+
+	memset(me, 0, sizeof(MessageTraceReader));
+	me->file = fopen(path, "rb");
+	if (!me->file)
+	{
+		return false;
+	}
+
+	if ((fread(header, sizeof(header), 1, me->file) != 1) ||
+		(GetU32(header) != TRACE_MAGIC) || (GetU16(header + 4) != TRACE_VERSION))
+	{
+		fclose(me->file);
+		me->file = NULL;
+		return false;
+	}
+	me->startEpoch = GetU64(header + 8);
+	return true;
+}
+
+/**
+ * Read next record. Return false at end of trace, or on a truncated or
+ * corrupt record.
+ */
+bool MessageTraceReader_Next(MessageTraceReader *me, MessageTraceRecord *record)
+{
+	uint8_t header[RECORD_HEADER_SIZE];
+	uint32_t peerLength;
+
+	if (!me->file || (fread(header, sizeof(header), 1, me->file) != 1))
+	{
+		return false;
+	}
+
+	record->time = GetU64(header);
+	record->direction = (MessageTrace_Direction)header[8];
+	peerLength = header[9];
+	record->length = GetU32(header + 12);
+	if ((record->direction >= MessageTrace_Max) || (record->length > MAX_CONTENT_LENGTH))
+	{
+		return false;
+	}
+
+	if ((peerLength > 0) && (fread(record->peer, peerLength, 1, me->file) != 1))
+	{
+		return false;
+	}
+	record->peer[peerLength] = '\0';
+
+	if (record->length + 1 > me->bufferSize)
+	{
+		char *buffer = realloc(me->buffer, record->length + 1);
+
+		if (!buffer)
+		{
+			return false;
+		}
+		me->buffer = buffer;
+		me->bufferSize = record->length + 1;
+	}
+	if ((record->length > 0) && (fread(me->buffer, record->length, 1, me->file) != 1))
+	{
+		return false;
+	}
+	me->buffer[record->length] = '\0';
+	record->content = me->buffer;
+	return true;
+}
+
+void MessageTraceReader_Close(MessageTraceReader *me)
+{
+	if (me->file)
+	{
+		fclose(me->file);
+		me->file = NULL;
+	}
+	free(me->buffer);
+	me->buffer = NULL;
+	me->bufferSize = 0;
+}
@@ -0,0 +1,116 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef MESSAGE_TRACE_H
+#define MESSAGE_TRACE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+
+/**
+ * Binary trace of the payloads exchanged with FlowCloud, for replaying
+ * production traffic through the controller on a host.
+ *
+ * File is a 16 byte header (magic, version, wall clock seconds at start)
+ * followed by records, all little endian:
+ *   u64 time - monotonic microseconds since start
+ *   u8 direction, u8 peer length, u16 reserved, u32 content length
+ *   peer ID, content (not null terminated)
+ *
+ * Writer is thread safe and flushes at most once a second, so a crash
+ * loses at most the last second; a truncated last record is ignored by
+ * the reader. Records may race with closing the trace, but a trace must
+ * not be opened again while other threads may still record to it.
+ */
+
+#define MESSAGE_TRACE_PEER_SIZE (256)
+
+typedef enum
+{
+	MessageTrace_Received,	//Message from user or device, peer is sender
+	MessageTrace_Sent,	//Message to user or device, peer is recipient
+	MessageTrace_SettingRead,	//KVS read, peer is setting name, empty if not found
+	MessageTrace_SettingWrite,	//KVS write, peer is setting name
+	MessageTrace_Identity,	//Known IDs at start, content is "User", "Sensor" or "Actuator"
+	MessageTrace_Max
+}MessageTrace_Direction;
+
+typedef struct
+{
+	FILE *file;
+	pthread_mutex_t lock;
+	uint64_t startUs;	//Monotonic time at start
+	uint64_t flushUs;	//Monotonic time of last flush
+	uint64_t records;
+	uint64_t bytes;
+	bool isOpen;
+}MessageTrace;
+
+typedef struct
+{
+	uint64_t time;	//microseconds since start
+	MessageTrace_Direction direction;
+	char peer[MESSAGE_TRACE_PEER_SIZE];
+	char *content;	//Null terminated, owned by reader till next record
+	uint32_t length;
+}MessageTraceRecord;
+
+typedef struct
+{
+	FILE *file;
+	uint64_t startEpoch;	//Wall clock seconds at start of trace
+	char *buffer;
+	uint32_t bufferSize;
+}MessageTraceReader;
+
+bool MessageTrace_Open(MessageTrace *me, const char *path);
+void MessageTrace_Record(MessageTrace *me, MessageTrace_Direction direction, const char *peer,
+							const char *content, uint32_t length);
+void MessageTrace_Close(MessageTrace *me);
+
+bool MessageTraceReader_Open(MessageTraceReader *me, const char *path);
+bool MessageTraceReader_Next(MessageTraceReader *me, MessageTraceRecord *record);
+void MessageTraceReader_Close(MessageTraceReader *me);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* MESSAGE_TRACE_H */
@@ -0,0 +1,181 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "flow/core/flow_memalloc.h"
+#include "settings_cache.h"
+
+#define CACHE_MAGIC (0x53434343)	//"CCCS"
+#define CACHE_VERSION (1)
+#define FNV_OFFSET_BASIS (2166136261u)
+#define FNV_PRIME (16777619u)
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t hash;
+	uint32_t size;
+}SettingsCacheHeader;
+
+/**
+ * FNV-1a hash of settings string
+ */
+uint32_t SettingsCache_Hash(const char *data)
+{
+	uint32_t hash = FNV_OFFSET_BASIS;
+
+	for (; *data; ++data)
+	{
+		hash = (hash ^ (uint8_t)*data) * FNV_PRIME;
+	}
+	return hash;
+}
+
+void SettingsCache_Init(SettingsCache *me, const char *path)
+{
+	strncpy(me->path, path, sizeof(me->path) - 1);
+	me->path[sizeof(me->path) - 1] = '\0';
+	me->hash = 0;
+	me->isValid = false;
+}
+
+/**
+ * Read cached settings, allocated with Flow_MemAlloc() for the caller
+ * to free. Fails on missing, truncated or corrupt cache.
+ */
+bool SettingsCache_Load(SettingsCache *me, char **data)
+{
+	SettingsCacheHeader header;
+	FILE *file = fopen(me->path, "rb");
+	bool success = false;
+
+	*data = NULL;
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	if ((fread(&header, sizeof(header), 1, file) == 1) &&
+		(header.magic == CACHE_MAGIC) &&
+		(header.version == CACHE_VERSION) &&
+		(header.size < SETTINGS_CACHE_MAX_SIZE))
+	{
+		*data = (char *)Flow_MemAlloc(header.size + 1);
+		if (*data)
+		{
+			if (fread(*data, 1, header.size, file) == header.size)
+			{
+				(*data)[header.size] = '\0';
+				success = (strlen(*data) == header.size) && (SettingsCache_Hash(*data) == header.hash);
+			}
+			if (success)
+			{
+				me->hash = header.hash;
+				me->isValid = true;
+			}
+			else
+			{
+				Flow_MemFree((void **)data);
+			}
+		}
+	}
+	fclose(file);
+	return success;
+}
+
+/**
+ * Return true if data is same as the settings applied last.
+ */
+bool SettingsCache_IsApplied(const SettingsCache *me, const char *data)
+{
+	return me->isValid && data && (SettingsCache_Hash(data) == me->hash);
+}
+
+/**
+ * Record data as applied settings. Written to a temporary file first and
+ * renamed over the cache, so a power cut leaves either old or new cache.
+ */
+bool SettingsCache_Store(SettingsCache *me, const char *data)
+{
+	char tempPath[SETTINGS_CACHE_PATH_SIZE + 4];
+	SettingsCacheHeader header;
+	FILE *file;
+	bool success;
+
+	header.magic = CACHE_MAGIC;
+	header.version = CACHE_VERSION;
+	header.hash = SettingsCache_Hash(data);
+	header.size = (uint32_t)strlen(data);
+
+	//Applied regardless of whether it could be cached
+	me->hash = header.hash;
+	me->isValid = true;
+
+	if (header.size >= SETTINGS_CACHE_MAX_SIZE)
+	{
+		return false;
+	}
+
+	snprintf(tempPath, sizeof(tempPath), "%s.new", me->path);
+	file = fopen(tempPath, "wb");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	success = (fwrite(&header, sizeof(header), 1, file) == 1) &&
+				(fwrite(data, 1, header.size, file) == header.size) &&
+				(fflush(file) == 0) &&
+				(fsync(fileno(file)) == 0);
+	fclose(file);
+
+	if (!success || rename(tempPath, me->path) != 0)
+	{
+		unlink(tempPath);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Forget applied settings, next ones are applied regardless of hash.
+ */
+void SettingsCache_Invalidate(SettingsCache *me)
+{
+	me->isValid = false;
+}
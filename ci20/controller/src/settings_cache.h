@@ -0,0 +1,74 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef SETTINGS_CACHE_H
+#define SETTINGS_CACHE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Last applied ControllerConfig, kept on disk with a hash of its content.
+ * At boot, cached settings are applied without waiting for the cloud.
+ * Settings retrieved later are compared by hash, so unchanged ones need
+ * no parsing, and are pushed only to devices that don't have them.
+ */
+
+#define SETTINGS_CACHE_FILE "settings_cache.bin"	//In controller's state directory
+#define SETTINGS_CACHE_PATH_SIZE (128)
+#define SETTINGS_CACHE_MAX_SIZE (4096)
+
+typedef struct
+{
+	char path[SETTINGS_CACHE_PATH_SIZE];
+	uint32_t hash;	//Hash of applied settings
+	bool isValid;	//Hash is known
+}SettingsCache;
+
+uint32_t SettingsCache_Hash(const char *data);
+void SettingsCache_Init(SettingsCache *me, const char *path);
+bool SettingsCache_Load(SettingsCache *me, char **data);
+bool SettingsCache_IsApplied(const SettingsCache *me, const char *data);
+bool SettingsCache_Store(SettingsCache *me, const char *data);
+void SettingsCache_Invalidate(SettingsCache *me);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* SETTINGS_CACHE_H */
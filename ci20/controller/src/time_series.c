@@ -0,0 +1,359 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include <string.h>
+
+#include "time_series.h"
+
+#define MINUTE_WIDTH (60)	//seconds
+#define QUARTER_HOUR_WIDTH (900)	//seconds
+#define HOUR_WIDTH (3600)	//seconds
+
+/**
+ * Collects buckets or samples into output points of a fixed resolution.
+ * Input must be in time order.
+ */
+typedef struct
+{
+	TimeSeriesPoint *points;
+	unsigned int maxPoints;
+	unsigned int numPoints;
+	uint32_t resolution;
+	double sum;	//Sum of current point
+}PointWriter;
+
+static void InitTier(TimeSeriesTier *tier, uint32_t width, uint32_t capacity, TimeSeriesBucket *buckets)
+{
+	tier->width = width;
+	tier->capacity = capacity;
+	tier->buckets = buckets;
+	memset(buckets, 0, capacity * sizeof(TimeSeriesBucket));
+}
+
+static void UpdateTier(TimeSeriesTier *tier, uint32_t time, float value)
+{
+	uint32_t start = time - time % tier->width;
+	TimeSeriesBucket *bucket = &tier->buckets[(time / tier->width) % tier->capacity];
+
+	if (bucket->start != start || bucket->count == 0)
+	{
+		if (bucket->count != 0 && bucket->start > start)
+		{
+			//Sample is older than whatever is kept in this slot
+			return;
+		}
+		bucket->start = start;
+		bucket->min = value;
+		bucket->max = value;
+		bucket->sum = value;
+		bucket->count = 1;
+	}
+	else
+	{
+		if (value < bucket->min)
+		{
+			bucket->min = value;
+		}
+		if (value > bucket->max)
+		{
+			bucket->max = value;
+		}
+		bucket->sum += value;
+		bucket->count++;
+	}
+}
+
+/**
+ * Start time of oldest bucket a tier can still hold
+ */
+static uint32_t TierOldest(const TimeSeries *me, const TimeSeriesTier *tier)
+{
+	uint32_t newest = me->latest / tier->width;
+
+	if (newest < tier->capacity - 1)
+	{
+		return 0;
+	}
+	return (newest - (tier->capacity - 1)) * tier->width;
+}
+
+static uint32_t RawTime(const TimeSeries *me, uint32_t index)
+{
+	return me->rawTimes[(me->rawHead + TIME_SERIES_RAW_SAMPLES - me->rawCount + index) % TIME_SERIES_RAW_SAMPLES];
+}
+
+static float RawValue(const TimeSeries *me, uint32_t index)
+{
+	return me->rawValues[(me->rawHead + TIME_SERIES_RAW_SAMPLES - me->rawCount + index) % TIME_SERIES_RAW_SAMPLES];
+}
+
+/**
+ * Add aggregated data starting at time to output.
+ * Return false, once output is full.
+ */
+static bool WritePoint(PointWriter *writer, uint32_t time, float min, float max, float sum, uint32_t count)
+{
+	uint32_t key = (writer->resolution > 0) ? time - time % writer->resolution : time;
+	TimeSeriesPoint *point = (writer->numPoints > 0) ? &writer->points[writer->numPoints - 1] : NULL;
+
+	if (point && point->time == key)
+	{
+		if (min < point->min)
+		{
+			point->min = min;
+		}
+		if (max > point->max)
+		{
+			point->max = max;
+		}
+		point->count += count;
+		writer->sum += sum;
+		point->mean = writer->sum / point->count;
+		return true;
+	}
+
+	if (writer->numPoints == writer->maxPoints)
+	{
+		return false;
+	}
+
+	point = &writer->points[writer->numPoints++];
+	point->time = key;
+	point->min = min;
+	point->max = max;
+	point->count = count;
+	writer->sum = sum;
+	point->mean = sum / count;
+	return true;
+}
+
+static void QueryRaw(const TimeSeries *me, uint32_t from, uint32_t to, PointWriter *writer)
+{
+	uint32_t low = 0;
+	uint32_t high = me->rawCount;
+
+	//Binary search for first sample at or after from
+	while (low < high)
+	{
+		uint32_t middle = low + (high - low) / 2;
+
+		if (RawTime(me, middle) < from)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+
+	for (; low < me->rawCount; ++low)
+	{
+		uint32_t time = RawTime(me, low);
+		float value = RawValue(me, low);
+
+		if (time > to || !WritePoint(writer, time, value, value, value, 1))
+		{
+			break;
+		}
+	}
+}
+
+static void QueryTier(const TimeSeries *me, const TimeSeriesTier *tier, uint32_t from, uint32_t to, PointWriter *writer)
+{
+	uint32_t oldest = TierOldest(me, tier);
+	uint32_t index;
+	uint32_t last = to / tier->width;
+
+	for (index = ((from > oldest) ? from : oldest) / tier->width; index <= last; ++index)
+	{
+		const TimeSeriesBucket *bucket = &tier->buckets[index % tier->capacity];
+
+		if (bucket->count == 0 || bucket->start != index * tier->width)
+		{
+			continue;
+		}
+		if (!WritePoint(writer, bucket->start, bucket->min, bucket->max, bucket->sum, bucket->count))
+		{
+			break;
+		}
+	}
+}
+
+void TimeSeries_Init(TimeSeries *me)
+{
+	me->rawHead = 0;
+	me->rawCount = 0;
+	me->latest = 0;
+	InitTier(&me->tiers[TimeSeriesTier_Minute], MINUTE_WIDTH, TIME_SERIES_MINUTE_BUCKETS, me->minuteBuckets);
+	InitTier(&me->tiers[TimeSeriesTier_QuarterHour], QUARTER_HOUR_WIDTH, TIME_SERIES_QUARTER_BUCKETS, me->quarterBuckets);
+	InitTier(&me->tiers[TimeSeriesTier_Hour], HOUR_WIDTH, TIME_SERIES_HOUR_BUCKETS, me->hourBuckets);
+}
+
+/**
+ * Record a sample. Samples are expected in time order, an older sample
+ * is recorded at the time of the latest one.
+ */
+void TimeSeries_Add(TimeSeries *me, uint32_t time, float value)
+{
+	unsigned int i;
+
+	if (time < me->latest)
+	{
+		time = me->latest;
+	}
+	me->latest = time;
+
+	me->rawTimes[me->rawHead] = time;
+	me->rawValues[me->rawHead] = value;
+	me->rawHead = (me->rawHead + 1) % TIME_SERIES_RAW_SAMPLES;
+	if (me->rawCount < TIME_SERIES_RAW_SAMPLES)
+	{
+		me->rawCount++;
+	}
+
+	for (i = 0; i < TimeSeriesTier_Max; ++i)
+	{
+		UpdateTier(&me->tiers[i], time, value);
+	}
+}
+
+/**
+ * Add a sample older than the latest one, e.g. one a sensor kept through a
+ * network outage. Raw samples stay in time order, so it only goes into
+ * the rollups whose bucket for its time is still kept.
+ */
+void TimeSeries_AddPast(TimeSeries *me, uint32_t time, float value)
+{
+	unsigned int i;
+
+	if (time >= me->latest)
+	{
+		TimeSeries_Add(me, time, value);
+		return;
+	}
+	for (i = 0; i < TimeSeriesTier_Max; ++i)
+	{
+		UpdateTier(&me->tiers[i], time, value);
+	}
+}
+
+/**
+ * Select rollup for a query starting at from, NULL for raw samples.
+ * The coarsest rollup not coarser than resolution is used, falling back
+ * to coarser rollups if it does not reach back to from.
+ */
+static const TimeSeriesTier *SelectTier(const TimeSeries *me, uint32_t from, uint32_t resolution)
+{
+	int i;
+
+	if ((resolution < me->tiers[TimeSeriesTier_Minute].width) && (me->rawCount > 0) && (RawTime(me, 0) <= from))
+	{
+		return NULL;
+	}
+
+	for (i = TimeSeriesTier_Max - 1; i > 0; --i)
+	{
+		if (me->tiers[i].width <= resolution)
+		{
+			break;
+		}
+	}
+	for (; (i < TimeSeriesTier_Max - 1) && (TierOldest(me, &me->tiers[i]) > from); ++i)
+	{
+	}
+	return &me->tiers[i];
+}
+
+static uint32_t TierResolution(const TimeSeriesTier *tier, uint32_t resolution)
+{
+	if (tier == NULL)
+	{
+		return resolution;
+	}
+	if (resolution < tier->width)
+	{
+		return tier->width;
+	}
+	return ((resolution + tier->width - 1) / tier->width) * tier->width;
+}
+
+/**
+ * Return resolution a query starting at from would actually use.
+ * Querying later parts of the same range at this resolution gives
+ * points consistent with the first query.
+ */
+uint32_t TimeSeries_Resolution(const TimeSeries *me, uint32_t from, uint32_t resolution)
+{
+	return TierResolution(SelectTier(me, from, resolution), resolution);
+}
+
+/**
+ * Fill points with min/max/mean/count of [from, to] at given resolution
+ * (seconds, 0 for raw samples), oldest first. Intervals without samples
+ * are skipped.
+ *
+ * Raw samples are used for resolutions below a minute while they still
+ * cover from. Otherwise the coarsest rollup not coarser than resolution
+ * is used, falling back to coarser rollups if it does not reach back to
+ * from. Resolution is rounded up to a multiple of the rollup used.
+ * Return number of points filled.
+ */
+unsigned int TimeSeries_Query(const TimeSeries *me, uint32_t from, uint32_t to, uint32_t resolution,
+								TimeSeriesPoint *points, unsigned int maxPoints)
+{
+	PointWriter writer = { points, maxPoints, 0, resolution, 0.0 };
+	const TimeSeriesTier *tier;
+
+	if (to > me->latest)
+	{
+		to = me->latest;
+	}
+	if ((me->rawCount == 0) || (from > to) || (maxPoints == 0))
+	{
+		return 0;
+	}
+
+	tier = SelectTier(me, from, resolution);
+	writer.resolution = TierResolution(tier, resolution);
+	if (tier == NULL)
+	{
+		QueryRaw(me, from, to, &writer);
+	}
+	else
+	{
+		QueryTier(me, tier, from, to, &writer);
+	}
+	return writer.numPoints;
+}
@@ -0,0 +1,122 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef TIME_SERIES_H
+#define TIME_SERIES_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Fixed memory history of one zone's measurements: a ring of raw samples,
+ * plus 1 minute, 15 minute and 1 hour rollups (min/max/mean/count) which
+ * are updated incrementally on every sample. All storage is part of the
+ * TimeSeries itself, nothing is allocated.
+ *
+ * Rollup buckets live at slot (time / width) % capacity, so a window is
+ * located arithmetically and queried without rescanning raw samples.
+ * A bucket whose start time does not match its slot holds stale data
+ * and reads as empty.
+ */
+
+#define TIME_SERIES_RAW_SAMPLES (1024)
+#define TIME_SERIES_MINUTE_BUCKETS (1440)	//24 hours
+#define TIME_SERIES_QUARTER_BUCKETS (672)	//7 days
+#define TIME_SERIES_HOUR_BUCKETS (720)	//30 days
+
+typedef enum
+{
+	TimeSeriesTier_Minute,
+	TimeSeriesTier_QuarterHour,
+	TimeSeriesTier_Hour,
+	TimeSeriesTier_Max
+}TimeSeriesTier_Type;
+
+typedef struct
+{
+	uint32_t start;	//seconds
+	float min;
+	float max;
+	float sum;
+	uint32_t count;
+}TimeSeriesBucket;
+
+typedef struct
+{
+	uint32_t width;	//seconds
+	uint32_t capacity;
+	TimeSeriesBucket *buckets;
+}TimeSeriesTier;
+
+typedef struct
+{
+	uint32_t time;	//start of the interval, seconds
+	float min;
+	float max;
+	float mean;
+	uint32_t count;
+}TimeSeriesPoint;
+
+typedef struct
+{
+	//Raw samples, kept as separate arrays so that time lookups stay in cache
+	uint32_t rawTimes[TIME_SERIES_RAW_SAMPLES];
+	float rawValues[TIME_SERIES_RAW_SAMPLES];
+	uint32_t rawHead;	//Index of next raw sample
+	uint32_t rawCount;
+
+	uint32_t latest;	//Time of most recent sample
+
+	TimeSeriesTier tiers[TimeSeriesTier_Max];
+	TimeSeriesBucket minuteBuckets[TIME_SERIES_MINUTE_BUCKETS];
+	TimeSeriesBucket quarterBuckets[TIME_SERIES_QUARTER_BUCKETS];
+	TimeSeriesBucket hourBuckets[TIME_SERIES_HOUR_BUCKETS];
+}TimeSeries;
+
+void TimeSeries_Init(TimeSeries *me);
+void TimeSeries_Add(TimeSeries *me, uint32_t time, float value);
+void TimeSeries_AddPast(TimeSeries *me, uint32_t time, float value);
+unsigned int TimeSeries_Query(const TimeSeries *me, uint32_t from, uint32_t to, uint32_t resolution,
+								TimeSeriesPoint *points, unsigned int maxPoints);
+uint32_t TimeSeries_Resolution(const TimeSeries *me, uint32_t from, uint32_t resolution);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* TIME_SERIES_H */
@@ -0,0 +1,167 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include "zone_control.h"
+
+#define PID_OUTPUT_MIN (0.0f)
+#define PID_OUTPUT_MAX (1.0f)
+
+/**
+ * Clamp value between min and max
+ */
+static float Clamp(float value, float min, float max)
+{
+	if (value < min)
+	{
+		return min;
+	}
+	if (value > max)
+	{
+		return max;
+	}
+	return value;
+}
+
+/**
+ * Convert duty cycle to ON time within the window. Pulses shorter than
+ * the minimum pulse are dropped, and OFF gaps shorter than the minimum
+ * pulse are filled, as these only wear out the relay.
+ */
+static unsigned int DutyToOnTime(const ZoneControl *zone, float duty)
+{
+	unsigned int onTime = (unsigned int)(duty * zone->window + 0.5f);
+
+	if (onTime < zone->minimumPulse)
+	{
+		return 0;
+	}
+	if (zone->window - onTime < zone->minimumPulse)
+	{
+		return zone->window;
+	}
+	return onTime;
+}
+
+void ZoneControl_Init(ZoneControl *zone, unsigned int window, unsigned int tick, unsigned int minimumPulse)
+{
+	zone->window = window;
+	zone->tick = tick;
+	zone->minimumPulse = minimumPulse;
+	ZoneControl_Reset(zone);
+}
+
+/**
+ * Drop PID history and restart the control window on next tick.
+ * Should be called whenever the zone is taken out of manual control
+ * or its settings change.
+ */
+void ZoneControl_Reset(ZoneControl *zone)
+{
+	zone->elapsed = 0;
+	zone->onTime = 0;
+	zone->isOnFirst = false;
+	zone->duty = 0.0f;
+	zone->integral = 0.0f;
+	zone->lastMeasurement = 0.0f;
+	zone->hasLastMeasurement = false;
+}
+
+/**
+ * Compute duty cycle (0..1) for the next window.
+ * Derivative is taken on the measurement to avoid a kick on setpoint change,
+ * and integration is stopped while the output is saturated (anti-windup).
+ */
+float ZoneControl_UpdatePid(ZoneControl *zone, const PidGains *gains, float setpoint, float measurement,
+							ZoneDirection_Type direction, float dt)
+{
+	float sign = (direction == ZoneDirection_Raise) ? 1.0f : -1.0f;
+	float error = sign * (setpoint - measurement);
+	float derivative = 0.0f;
+	float integral;
+	float output;
+
+	if (zone->hasLastMeasurement && dt > 0.0f)
+	{
+		derivative = -sign * (measurement - zone->lastMeasurement) / dt;
+	}
+	zone->lastMeasurement = measurement;
+	zone->hasLastMeasurement = true;
+
+	integral = zone->integral + gains->ki * error * dt;
+	output = gains->kp * error + integral + gains->kd * derivative;
+
+	if (!((output > PID_OUTPUT_MAX) && (error > 0.0f)) &&
+		!((output < PID_OUTPUT_MIN) && (error < 0.0f)))
+	{
+		zone->integral = Clamp(integral, PID_OUTPUT_MIN, PID_OUTPUT_MAX);
+	}
+
+	return Clamp(output, PID_OUTPUT_MIN, PID_OUTPUT_MAX);
+}
+
+/**
+ * Advance zone by one control tick.
+ * Return required relay state, isOn being its current state.
+ */
+bool ZoneControl_Tick(ZoneControl *zone, const PidGains *gains, float setpoint, float measurement,
+						ZoneDirection_Type direction, bool isOn)
+{
+	bool relayOn;
+
+	if (zone->elapsed >= zone->window)
+	{
+		zone->elapsed = 0;
+	}
+
+	if (zone->elapsed == 0)
+	{
+		//Start of a new window. Keep relay in its current state across the
+		//window boundary, so that only one transition is needed per window.
+		zone->duty = ZoneControl_UpdatePid(zone, gains, setpoint, measurement, direction, zone->window / 1000.0f);
+		zone->onTime = DutyToOnTime(zone, zone->duty);
+		zone->isOnFirst = isOn;
+	}
+
+	if (zone->isOnFirst)
+	{
+		relayOn = (zone->elapsed < zone->onTime);
+	}
+	else
+	{
+		relayOn = (zone->elapsed >= zone->window - zone->onTime);
+	}
+
+	zone->elapsed += zone->tick;
+	return relayOn;
+}
@@ -0,0 +1,96 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef ZONE_CONTROL_H
+#define ZONE_CONTROL_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+/**
+ * Per-zone PID controller driving a relay through a time-proportioned
+ * duty cycle. The PID output (0..1) is computed once per control window
+ * and converted into an ON time within that window. The ON portion is
+ * placed at the start or at the end of the window depending on the relay's
+ * state when the window begins, so a relay never switches on a window
+ * boundary and makes at most one transition per window.
+ *
+ * This module has no flow dependency, so it can be built on a host PC
+ * together with the thermal plant simulator.
+ */
+
+typedef enum
+{
+	ZoneDirection_Raise,	//Relay ON raises the measured value (e.g. heater)
+	ZoneDirection_Lower,	//Relay ON lowers the measured value (e.g. fan)
+}ZoneDirection_Type;
+
+typedef struct
+{
+	float kp;	//Duty cycle per unit of error
+	float ki;	//Duty cycle per unit of error per second
+	float kd;	//Duty cycle per unit of error change per second
+}PidGains;
+
+typedef struct
+{
+	unsigned int window;	//Control window, milliseconds
+	unsigned int tick;	//Control tick period, milliseconds
+	unsigned int minimumPulse;	//Shortest ON or OFF time within a window, milliseconds
+
+	unsigned int elapsed;	//Time elapsed in current window, milliseconds
+	unsigned int onTime;	//ON time for current window, milliseconds
+	bool isOnFirst;	//ON portion placed at the start of current window
+	float duty;	//Duty cycle computed for current window
+
+	float integral;	//Integral term, already scaled by ki
+	float lastMeasurement;
+	bool hasLastMeasurement;
+}ZoneControl;
+
+void ZoneControl_Init(ZoneControl *zone, unsigned int window, unsigned int tick, unsigned int minimumPulse);
+void ZoneControl_Reset(ZoneControl *zone);
+float ZoneControl_UpdatePid(ZoneControl *zone, const PidGains *gains, float setpoint, float measurement,
+							ZoneDirection_Type direction, float dt);
+bool ZoneControl_Tick(ZoneControl *zone, const PidGains *gains, float setpoint, float measurement,
+						ZoneDirection_Type direction, bool isOn);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* ZONE_CONTROL_H */
@@ -0,0 +1,117 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/**
+ * Minimal test harness for host tests. Each test file is a program that
+ * runs its cases with RUN_TEST() and returns TEST_RESULT() from main.
+ * A failed CHECK reports and returns from the running case.
+ */
+
+static int _testFailures = 0;
+static int _testCases = 0;
+static int _testCaseFailed = 0;
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			_testCaseFailed = 1; \
+			return; \
+		} \
+	} while (0)
+
+#define CHECK_EQ_INT(expected, actual) \
+	do \
+	{ \
+		long long _e = (long long)(expected), _a = (long long)(actual); \
+		if (_e != _a) \
+		{ \
+			printf("%s:%d: %s expected %lld, got %lld\n", __FILE__, __LINE__, #actual, _e, _a); \
+			_testCaseFailed = 1; \
+			return; \
+		} \
+	} while (0)
+
+#define CHECK_NEAR(expected, actual, tolerance) \
+	do \
+	{ \
+		double _e = (double)(expected), _a = (double)(actual); \
+		if (fabs(_e - _a) > (tolerance)) \
+		{ \
+			printf("%s:%d: %s expected %g, got %g\n", __FILE__, __LINE__, #actual, _e, _a); \
+			_testCaseFailed = 1; \
+			return; \
+		} \
+	} while (0)
+
+#define CHECK_CONTAINS(haystack, needle) \
+	do \
+	{ \
+		const char *_h = (haystack); \
+		if (!_h || !strstr(_h, (needle))) \
+		{ \
+			printf("%s:%d: \"%s\" not found in %s\n", __FILE__, __LINE__, (needle), _h ? _h : "(null)"); \
+			_testCaseFailed = 1; \
+			return; \
+		} \
+	} while (0)
+
+#define RUN_TEST(test) \
+	do \
+	{ \
+		_testCaseFailed = 0; \
+		_testCases++; \
+		test(); \
+		if (_testCaseFailed) \
+		{ \
+			_testFailures++; \
+			printf("  FAIL %s\n", #test); \
+		} \
+	} while (0)
+
+#define TEST_RESULT() \
+	(printf("%d of %d test cases passed\n", _testCases - _testFailures, _testCases), \
+	_testFailures ? EXIT_FAILURE : EXIT_SUCCESS)
+
+#endif	/* TEST_H */
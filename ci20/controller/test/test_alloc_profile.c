@@ -0,0 +1,177 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+//Profile this file's allocations, as ALLOC_PROFILE=1 builds do for controller sources
+#define ALLOC_PROFILE 1
+
+#include "alloc_profile.h"
+#include "flow_stub.h"
+#include "test.h"
+
+#define DUMP_SIZE (16384)
+
+typedef struct
+{
+	unsigned long allocs, reallocs, frees, bytes, average, max, live, peak;
+	unsigned long lifetimes[ALLOC_PROFILE_LIFETIME_BUCKETS];
+}SiteRow;
+
+/**
+ * Read the dump row of the site at given line of this file
+ */
+static bool ReadSite(int line, SiteRow *row)
+{
+	char dump[DUMP_SIZE], where[64];
+	FILE *out = tmpfile();
+	const char *site;
+	size_t length;
+	int i, used;
+
+	if (!out)
+	{
+		return false;
+	}
+	AllocProfile_Dump(out);
+	rewind(out);
+	length = fread(dump, 1, DUMP_SIZE - 1, out);
+	dump[length] = '\0';
+	fclose(out);
+
+	snprintf(where, sizeof(where), "test_alloc_profile.c:%d ", line);
+	site = strstr(dump, where);
+	if (!site || sscanf(site + strlen(where), "%lu %lu %lu %lu %lu %lu %lu %lu | %n", &row->allocs, &row->reallocs,
+			&row->frees, &row->bytes, &row->average, &row->max, &row->live, &row->peak, &used) != 8)
+	{
+		return false;
+	}
+	site += strlen(where) + used;
+	for (i = 0; i < ALLOC_PROFILE_LIFETIME_BUCKETS; ++i)
+	{
+		if (sscanf(site, "%lu %n", &row->lifetimes[i], &used) != 1)
+		{
+			return false;
+		}
+		site += used;
+	}
+	return true;
+}
+
+static unsigned long LifetimeCount(const SiteRow *row)
+{
+	unsigned long count = 0;
+	int i;
+
+	for (i = 0; i < ALLOC_PROFILE_LIFETIME_BUCKETS; ++i)
+	{
+		count += row->lifetimes[i];
+	}
+	return count;
+}
+
+static void test_CountsCallsBytesAndLiveBlocksPerSite(void)
+{
+	void *blocks[3];
+	SiteRow row;
+	int line = 0, i;
+
+	for (i = 0; i < 3; ++i)
+	{
+		line = __LINE__; blocks[i] = Flow_MemAlloc(100 + i * 100);
+	}
+	Flow_MemFree(&blocks[0]);
+
+	CHECK(ReadSite(line, &row));
+	CHECK_EQ_INT(3, row.allocs);
+	CHECK_EQ_INT(0, row.reallocs);
+	CHECK_EQ_INT(1, row.frees);
+	CHECK_EQ_INT(600, row.bytes);
+	CHECK_EQ_INT(200, row.average);
+	CHECK_EQ_INT(300, row.max);
+	CHECK_EQ_INT(500, row.live);
+	CHECK_EQ_INT(600, row.peak);
+	CHECK_EQ_INT(1, LifetimeCount(&row));
+
+	Flow_MemFree(&blocks[1]);
+	Flow_MemFree(&blocks[2]);
+	CHECK(ReadSite(line, &row));
+	CHECK_EQ_INT(3, row.frees);
+	CHECK_EQ_INT(0, row.live);
+	CHECK_EQ_INT(3, LifetimeCount(&row));
+}
+
+static void test_ReallocMovesBlockToItsSite(void)
+{
+	SiteRow row;
+	char *tag;
+	int allocLine, reallocLine;
+
+	allocLine = __LINE__; tag = FlowString_Duplicate("<a>");
+	reallocLine = __LINE__; tag = Flow_MemRealloc(tag, 64);
+	CHECK(tag != NULL);
+
+	CHECK(ReadSite(allocLine, &row));
+	CHECK_EQ_INT(1, row.allocs);
+	CHECK_EQ_INT(4, row.bytes);
+	CHECK_EQ_INT(1, row.frees);
+	CHECK_EQ_INT(0, row.live);
+
+	CHECK(ReadSite(reallocLine, &row));
+	CHECK_EQ_INT(0, row.allocs);
+	CHECK_EQ_INT(1, row.reallocs);
+	CHECK_EQ_INT(64, row.live);
+
+	Flow_MemFree((void **)&tag);
+	CHECK(tag == NULL);
+	CHECK(ReadSite(reallocLine, &row));
+	CHECK_EQ_INT(0, row.live);
+}
+
+static void test_UnprofiledMemoryIsFreedThrough(void)
+{
+	void *block = (Flow_MemAlloc)(32);	//As by code built without the profile
+	long outstanding = FlowStub_OutstandingAllocations();
+
+	CHECK(block != NULL);
+	Flow_MemFree(&block);
+	CHECK(block == NULL);
+	CHECK_EQ_INT(outstanding - 1, FlowStub_OutstandingAllocations());
+}
+
+int main(void)
+{
+	RUN_TEST(test_CountsCallsBytesAndLiveBlocksPerSite);
+	RUN_TEST(test_ReallocMovesBlockToItsSite);
+	RUN_TEST(test_UnprofiledMemoryIsFreedThrough);
+	return TEST_RESULT();
+}
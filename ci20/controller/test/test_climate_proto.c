@@ -0,0 +1,662 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#define _GNU_SOURCE	//nftw()
+
+#include <unistd.h>
+#include <ftw.h>
+#include <sys/stat.h>
+
+#include "flow/flowcore.h"
+#include "controller.h"
+#include "flow_interface.h"
+#include "construct_message.h"
+#include "climate_proto.h"
+#include "flow_stub.h"
+#include "controller_stats.h"
+#include "firmware_bench.h"
+#include "test.h"
+
+/**
+ * Conformance of climate_proto, which controller and WiFire firmware
+ * share: codec cases, then messages built by one side, the firmware
+ * compiled for host as for micro_bench, parsed by the other.
+ */
+
+#define QUEUE_SIZE (64)
+#define TEST_USER "user"
+#define TEST_SENSOR "sensor"
+#define TEST_ACTUATOR "actuator"
+#define TEST_EPOCH (1500000000)
+
+//Sensor settings as the controller wrote them before climate_proto
+#define SENSOR_SETTINGS_XML \
+	"<HeartBeat>15000</HeartBeat>" \
+	"<TemperatureReadInterval>1000</TemperatureReadInterval>" \
+	"<HumidityReadInterval>2500</HumidityReadInterval>" \
+	"<TemperatureReadDelta>0.50</TemperatureReadDelta>" \
+	"<HumidityReadDelta>2.00</HumidityReadDelta>"
+
+static unsigned int _caseNumber = 0;
+
+static char _testDirectory[64];	//Of this run, holding a directory per case
+static char _caseDirectory[96];	//State directory of controllers started by the running case
+
+/**
+ * Start each case with a fresh state directory for its controllers, in a
+ * temporary directory of the run rather than the working directory.
+ */
+static void NewCaseDirectory(void)
+{
+	const char *tmp = getenv("TMPDIR");
+
+	if (!_testDirectory[0])
+	{
+		snprintf(_testDirectory, sizeof(_testDirectory), "%s/test_climate_proto.XXXXXX", tmp ? tmp : "/tmp");
+		if (!mkdtemp(_testDirectory))
+		{
+			perror("mkdtemp");
+			exit(EXIT_FAILURE);
+		}
+	}
+	snprintf(_caseDirectory, sizeof(_caseDirectory), "%s/case%u", _testDirectory, ++_caseNumber);
+}
+
+static int RemoveFile(const char *path, const struct stat *status, int flag, struct FTW *ftw)
+{
+	return remove(path);
+}
+
+/**
+ * Remove the directories of all cases, as their controllers are done.
+ */
+static void RemoveCaseDirectories(void)
+{
+	if (_testDirectory[0])
+	{
+		nftw(_testDirectory, RemoveFile, 16, FTW_DEPTH | FTW_PHYS);
+	}
+}
+
+static Controller *NewController(void)
+{
+	Controller *me = malloc(sizeof(Controller));
+
+	ControllerSetDefaults(me);
+	me->stateDir = _caseDirectory;
+	strcpy(me->userId, TEST_USER);
+	me->sendMsgQueue = FlowQueue_NewBlocking(QUEUE_SIZE);
+	me->receiveMsgQueue = FlowQueue_NewBlocking(QUEUE_SIZE);
+	return me;
+}
+
+/**
+ * Take the commands posted for flow thread, keeping the content of the
+ * last one to the actuator.
+ */
+static unsigned int TakePosted(Controller *me, char *toActuator, size_t size)
+{
+	FlowInterfaceCmd *cmd;
+	unsigned int count = 0;
+
+	while ((cmd = FlowQueue_DequeueWaitFor(me->sendMsgQueue, 0)) != NULL)
+	{
+		if (cmd->details && (cmd->cmdType == FlowInterfaceCmd_SendMessageToActuator))
+		{
+			snprintf(toActuator, size, "%s", (char *)cmd->details);
+			count++;
+		}
+		Flow_MemFree(&cmd->details);
+		Flow_MemFree((void **)&cmd);
+	}
+	return count;
+}
+
+static void HandleMessage(Controller *me, const char *from, char *content)
+{
+	ControllerEvent *event = Flow_MemAlloc(sizeof(ControllerEvent));
+	ReceivedMessage *message = Flow_MemAlloc(sizeof(ReceivedMessage));
+
+	message->sendorId = FlowString_Duplicate(from);
+	message->data = content;
+	event->evtType = ControllerEvent_ReceivedMessage;
+	event->details = message;
+	ControllerHandleEvent(me, event);
+}
+
+static void test_SerializeWritesPresentFieldsInOrder(void)
+{
+	const ClimateProto_Schema *schema = &ClimateProto_SensorSettingsSchema;
+	ClimateProto_SensorSettings settings = { 0 };
+	char buffer[512];
+	char truncated[16];
+
+	ClimateProto_SetUint(schema, &settings, ClimateProto_SensorSettings_humidityReadInterval, 2500);
+	ClimateProto_SetFloat(schema, &settings, ClimateProto_SensorSettings_humidityReadDelta, 2.0f);
+	ClimateProto_SetUint(schema, &settings, ClimateProto_SensorSettings_heartBeat, 15000);
+	ClimateProto_SetFloat(schema, &settings, ClimateProto_SensorSettings_temperatureReadDelta, 0.5f);
+	ClimateProto_SetUint(schema, &settings, ClimateProto_SensorSettings_temperatureReadInterval, 1000);
+
+	CHECK_EQ_INT(strlen(SENSOR_SETTINGS_XML), ClimateProto_Serialize(schema, &settings, buffer, sizeof(buffer)));
+	CHECK(strcmp(buffer, SENSOR_SETTINGS_XML) == 0);
+
+	//Length is that of the full text, which is cut short but terminated
+	CHECK_EQ_INT(strlen(SENSOR_SETTINGS_XML), ClimateProto_Serialize(schema, &settings, truncated, sizeof(truncated)));
+	CHECK_EQ_INT(sizeof(truncated) - 1, strlen(truncated));
+
+	//Setting a field of another type leaves it missing
+	memset(&settings, 0, sizeof(settings));
+	ClimateProto_SetFloat(schema, &settings, ClimateProto_SensorSettings_heartBeat, 1.0f);
+	CHECK_EQ_INT(0, settings.present);
+	CHECK_EQ_INT(0, ClimateProto_Serialize(schema, &settings, buffer, sizeof(buffer)));
+}
+
+static void test_ParseReadsBackSerialized(void)
+{
+	ClimateProto_SensorSettings settings = { 0 };
+	ClimateProto_SensorSettings parsed;
+	ClimateProto_ActuatorInfo info = { 0 };
+	ClimateProto_ActuatorInfo parsedInfo;
+	char buffer[512];
+	char xml[640];
+
+	ClimateProto_SetUint(&ClimateProto_SensorSettingsSchema, &settings, ClimateProto_SensorSettings_heartBeat, 15000);
+	ClimateProto_SetFloat(&ClimateProto_SensorSettingsSchema, &settings, ClimateProto_SensorSettings_humidityReadDelta, 2.25f);
+	ClimateProto_SetUint(&ClimateProto_SensorSettingsSchema, &settings, ClimateProto_SensorSettings_heartBeatKeyframe, 8);
+	ClimateProto_SetInt(&ClimateProto_SensorSettingsSchema, &settings, ClimateProto_SensorSettings_temperatureOffset, -300);
+	ClimateProto_Serialize(&ClimateProto_SensorSettingsSchema, &settings, buffer, sizeof(buffer));
+	snprintf(xml, sizeof(xml), "<command><info>UPDATE_SETTINGS</info><settings>%s</settings></command>", buffer);
+
+	CHECK(ClimateProto_Parse(&ClimateProto_SensorSettingsSchema, xml, &parsed));
+	CHECK_EQ_INT(settings.present, parsed.present);
+	CHECK_EQ_INT(15000, parsed.heartBeat);
+	CHECK_EQ_INT(8, parsed.heartBeatKeyframe);
+	CHECK_NEAR(2.25, parsed.humidityReadDelta, 0.001);
+	CHECK_EQ_INT(-300, parsed.temperatureOffset);
+
+	ClimateProto_SetString(&ClimateProto_ActuatorInfoSchema, &info, ClimateProto_ActuatorInfo_relay1, "ON");
+	ClimateProto_SetString(&ClimateProto_ActuatorInfoSchema, &info, ClimateProto_ActuatorInfo_relay2, "OFF");
+	ClimateProto_Serialize(&ClimateProto_ActuatorInfoSchema, &info, buffer, sizeof(buffer));
+	snprintf(xml, sizeof(xml), "<event><type>Actuator</type><info>%s</info></event>", buffer);
+
+	CHECK(ClimateProto_Parse(&ClimateProto_ActuatorInfoSchema, xml, &parsedInfo));
+	CHECK_EQ_INT(info.present, parsedInfo.present);
+	CHECK(strcmp(parsedInfo.relay1, "ON") == 0);
+	CHECK(strcmp(parsedInfo.relay2, "OFF") == 0);
+}
+
+static void test_ParseSkipsOtherElements(void)
+{
+	ClimateProto_Command command;
+	ClimateProto_SensorSettings settings;
+	const char *xml = "<?xml version=\"1.0\"?><!-- from user --><command>"
+		"<time type=\"datetime\">2017-07-14T14:00:00Z</time>"
+		"<extra><info>NESTED</info><settings><HeartBeat>1</HeartBeat></settings></extra>"
+		"<info>UPDATE_SETTINGS</info><wire/>"
+		"<settings><HeartBeatKeyframe>4</HeartBeatKeyframe>\n\t<HeartBeat>15000</HeartBeat>"
+		"<TemperatureReadInterval></TemperatureReadInterval></settings></command>";
+
+	CHECK(ClimateProto_Parse(&ClimateProto_CommandSchema, xml, &command));
+	CHECK(strcmp(command.info, "UPDATE_SETTINGS") == 0);
+	CHECK(!(command.present & CLIMATE_PROTO_PRESENT(Command, wire)));
+
+	//Name that is a prefix of another isn't matched by it, empty elements are missing
+	CHECK(ClimateProto_Parse(&ClimateProto_SensorSettingsSchema, xml, &settings));
+	CHECK_EQ_INT(15000, settings.heartBeat);
+	CHECK_EQ_INT(4, settings.heartBeatKeyframe);
+	CHECK_EQ_INT(CLIMATE_PROTO_PRESENT(SensorSettings, heartBeat) | CLIMATE_PROTO_PRESENT(SensorSettings, heartBeatKeyframe),
+					settings.present);
+}
+
+static void test_ParseRejectsMissingSection(void)
+{
+	ClimateProto_Command command;
+	ClimateProto_SensorInfo info;
+	char longInfo[] = "<command><info>UPDATE_SETTINGS_UPDATE_SETTINGS_UPDATE</info></command>";
+
+	CHECK(!ClimateProto_Parse(&ClimateProto_CommandSchema, "<event><info>PING</info></event>", &command));
+	CHECK(!ClimateProto_Parse(&ClimateProto_SensorInfoSchema, "<event><type>Sensor</type></event>", &info));
+	CHECK(!ClimateProto_Parse(&ClimateProto_SensorInfoSchema, "<event><info><Temperature>21.00</Temperature>", &info));
+	CHECK(!ClimateProto_Parse(&ClimateProto_CommandSchema, NULL, &command));
+
+	//Command without info, or with one longer than a string holds
+	CHECK(!ClimateProto_ParseCommand("<command><wire>1</wire></command>", &command, NULL, NULL));
+	CHECK(!ClimateProto_ParseCommand(longInfo, &command, NULL, NULL));
+}
+
+static void test_NextRecordReadsRepeatedRecords(void)
+{
+	const char *xml = "<event><type>SensorLog</type><count>4</count>"
+						"<samples>1000,2150,4000;1060,-300,65535,7;1120,,4100;1180</samples></event>";
+	const char *cursor = NULL;
+	ClimateProto_Sample sample;
+
+	CHECK(ClimateProto_NextRecord(&ClimateProto_SampleSchema, xml, &cursor, &sample));
+	CHECK_EQ_INT(1000, sample.time);
+	CHECK_EQ_INT(2150, sample.temperature);
+	CHECK_EQ_INT(4000, sample.humidity);
+	//Values added by a newer peer are skipped
+	CHECK(ClimateProto_NextRecord(&ClimateProto_SampleSchema, xml, &cursor, &sample));
+	CHECK_EQ_INT(-300, sample.temperature);
+	CHECK_EQ_INT(65535, sample.humidity);
+	CHECK(ClimateProto_NextRecord(&ClimateProto_SampleSchema, xml, &cursor, &sample));
+	CHECK_EQ_INT(1120, sample.time);
+	CHECK(!(sample.present & CLIMATE_PROTO_PRESENT(Sample, temperature)));
+	CHECK_EQ_INT(4100, sample.humidity);
+	CHECK(ClimateProto_NextRecord(&ClimateProto_SampleSchema, xml, &cursor, &sample));
+	CHECK_EQ_INT(CLIMATE_PROTO_PRESENT(Sample, time), sample.present);
+	CHECK(!ClimateProto_NextRecord(&ClimateProto_SampleSchema, xml, &cursor, &sample));
+
+	cursor = NULL;
+	CHECK(!ClimateProto_NextRecord(&ClimateProto_SampleSchema, "<event><samples></samples></event>", &cursor, &sample));
+	cursor = NULL;
+	CHECK(!ClimateProto_NextRecord(&ClimateProto_SampleSchema, "<event><count>0</count></event>", &cursor, &sample));
+}
+
+static void test_ControllerSettingsReachSensor(void)
+{
+	Controller *me = NewController();
+	ClimateProto_SensorSettings settings;
+	char *data = NULL;
+	char *compact;
+	bool isCompact = false;
+
+	me->sensorConfig.heartBeat = 20000;
+	me->sensors[Sensor_Temperature].readInterval = 1500;
+	me->sensors[Sensor_Temperature].readDelta = 0.25f;
+	me->sensors[Sensor_Humidity].readInterval = 3000;
+	me->sensors[Sensor_Humidity].readDelta = 1.5f;
+	me->config.heartBeatKeyframe = 6;
+	me->sensors[Sensor_Temperature].medianSize = 5;
+	me->sensors[Sensor_Temperature].filterAlpha = 0.125f;
+	me->sensors[Sensor_Humidity].maxReadInterval = 24000;
+	me->sensors[Sensor_Temperature].calibration.offset = -0.5f;
+	me->sensors[Sensor_Temperature].calibration.gain = 1.01f;
+	me->sensors[Sensor_Temperature].calibration.curve = 0.0002f;
+	CHECK(ConstructSettingsCommandForSensor(me, &data));
+
+	CHECK(FirmwareBench_SensorParseSettings(data, &settings, &isCompact));
+	CHECK(isCompact);
+	CHECK_EQ_INT(20000, settings.heartBeat);
+	CHECK_EQ_INT(1500, settings.temperatureReadInterval);
+	CHECK_EQ_INT(3000, settings.humidityReadInterval);
+	CHECK_NEAR(0.25, settings.temperatureReadDelta, 0.001);
+	CHECK_NEAR(1.5, settings.humidityReadDelta, 0.001);
+	CHECK_EQ_INT(6, settings.heartBeatKeyframe);
+	CHECK_EQ_INT(5, settings.temperatureMedianSize);
+	//In fixed point with 16 fraction bits, not rounded to 0.13
+	CHECK_EQ_INT(8192, settings.temperatureFilterAlpha);
+	CHECK_EQ_INT(24000, settings.humidityMaxReadInterval);
+	//Calibration in fixed point, with 8, 16 and 24 fraction bits
+	CHECK_EQ_INT(-128, settings.temperatureOffset);
+	CHECK_EQ_INT(66191, settings.temperatureGain);
+	CHECK_EQ_INT(3355, settings.temperatureCurve);
+	//Back off, filters and calibration not configured are left to the sensor
+	CHECK(!(settings.present & CLIMATE_PROTO_PRESENT(SensorSettings, humidityMedianSize)));
+	CHECK(!(settings.present & CLIMATE_PROTO_PRESENT(SensorSettings, humidityFilterAlpha)));
+	CHECK(!(settings.present & CLIMATE_PROTO_PRESENT(SensorSettings, temperatureMaxReadInterval)));
+	CHECK(!(settings.present & CLIMATE_PROTO_PRESENT(SensorSettings, humidityGain)));
+
+	//Same settings as sent to a sensor which advertised the compact format
+	compact = WireFormat_ToCompact(data);
+	CHECK(compact != NULL);
+	memset(&settings, 0, sizeof(settings));
+	CHECK(FirmwareBench_SensorParseSettings(compact, &settings, &isCompact));
+	CHECK_EQ_INT(20000, settings.heartBeat);
+	CHECK_NEAR(1.5, settings.humidityReadDelta, 0.001);
+	CHECK_EQ_INT(6, settings.heartBeatKeyframe);
+	CHECK_EQ_INT(8192, settings.temperatureFilterAlpha);
+	CHECK_EQ_INT(-128, settings.temperatureOffset);
+
+	//Sensor takes only settings from the controller
+	CHECK(!FirmwareBench_SensorParseSettings("<command><info>RELAY_1_ON</info></command>", &settings, &isCompact));
+	Flow_MemFree((void **)&compact);
+	Flow_MemFree((void **)&data);
+}
+
+static void test_SensorAppliesCalibration(void)
+{
+	Controller *me = NewController();
+	float reported = 0.0f;
+	char *data = NULL;
+	unsigned int i;
+
+	//Readings at full scale as they are, reported on any change
+	me->sensors[Sensor_Temperature].readDelta = 0.0f;
+	CHECK(FirmwareBench_SensorSetFilter(1, 1.0f, 0.0f));
+	FirmwareBench_SensorReadTemperature(4095, &reported);
+	CHECK_NEAR(24.5, reported, 0.01);
+
+	me->sensors[Sensor_Temperature].calibration.offset = -0.5f;
+	me->sensors[Sensor_Temperature].calibration.gain = 1.01f;
+	me->sensors[Sensor_Temperature].calibration.curve = 0.0002f;
+	CHECK(ConstructSettingsCommandForSensor(me, &data));
+	CHECK(FirmwareBench_SensorApplySettings(data));
+	Flow_MemFree((void **)&data);
+	CHECK(FirmwareBench_SensorReadTemperature(4095, &reported));
+	CHECK_NEAR(-0.5 + 1.01 * 24.5 + 0.0002 * 24.5 * 24.5, reported, 0.01);
+
+	//Settings without calibration keep it, no correction takes it back
+	me->sensors[Sensor_Temperature].calibration.gain = 0.0f;
+	ControllerMarkDirty(me, ControllerSection_Settings);
+	CHECK(ConstructSettingsCommandForSensor(me, &data));
+	CHECK(FirmwareBench_SensorApplySettings(data));
+	Flow_MemFree((void **)&data);
+	CHECK(!FirmwareBench_SensorReadTemperature(4095, &reported));
+	for (i = 0; i < NUM_SENSORS; ++i)
+	{
+		me->sensors[i].calibration.offset = 0.0f;
+		me->sensors[i].calibration.gain = 1.0f;
+		me->sensors[i].calibration.curve = 0.0f;
+	}
+	ControllerMarkDirty(me, ControllerSection_Settings);
+	CHECK(ConstructSettingsCommandForSensor(me, &data));
+	CHECK(FirmwareBench_SensorApplySettings(data));
+	Flow_MemFree((void **)&data);
+	CHECK(FirmwareBench_SensorReadTemperature(4095, &reported));
+	CHECK_NEAR(24.5, reported, 0.01);
+}
+
+static void test_SensorAppliesFilterSettings(void)
+{
+	Controller *me = NewController();
+	float reported = 0.0f;
+	char *data = NULL;
+
+	CHECK(FirmwareBench_SensorSetFilter(1, 1.0f, 0.0f));
+	me->sensors[Sensor_Temperature].medianSize = 1;
+	me->sensors[Sensor_Temperature].filterAlpha = 0.125f;
+	CHECK(ConstructSettingsCommandForSensor(me, &data));
+	CHECK(FirmwareBench_SensorApplySettings(data));
+	Flow_MemFree((void **)&data);
+
+	//Average starts at the first reading, then moves an eighth of the way, not 0.13
+	CHECK(FirmwareBench_SensorReadTemperature(4095, &reported));
+	CHECK_NEAR(24.5, reported, 0.01);
+	CHECK(FirmwareBench_SensorReadTemperature(0, &reported));
+	CHECK_NEAR(24.5 - (24.5 + 25.0) / 8, reported, 0.01);
+}
+
+static void test_ControllerSettingsKeepFormat(void)
+{
+	Controller *me = NewController();
+	char *data = NULL;
+
+	me->sensorConfig.heartBeat = 15000;
+	me->sensors[Sensor_Temperature].readInterval = 1000;
+	me->sensors[Sensor_Temperature].readDelta = 0.5f;
+	me->sensors[Sensor_Humidity].readInterval = 2500;
+	me->sensors[Sensor_Humidity].readDelta = 2.0f;
+	me->config.heartBeatKeyframe = 0;
+	CHECK(ConstructSettingsCommandForSensor(me, &data));
+	CHECK_CONTAINS(data, "<settings>" SENSOR_SETTINGS_XML "</settings>");
+	Flow_MemFree((void **)&data);
+}
+
+static void test_ControllerCommandsReachActuator(void)
+{
+	Controller *me = NewController();
+	char *data = NULL;
+	char cmd[CLIMATE_PROTO_STRING_SIZE];
+	unsigned int heartBeat = 0;
+	bool isCompact = false;
+
+	me->actuatorConfig.heartBeat = 12000;
+	CHECK(ConstructSettingsCommandForActuator(me, &data));
+	CHECK(FirmwareBench_ActuatorParseCommand(data, cmd, sizeof(cmd), &heartBeat, &isCompact));
+	CHECK(strcmp(cmd, "UPDATE_SETTINGS") == 0);
+	CHECK_EQ_INT(12000, heartBeat);
+	CHECK(isCompact);
+	Flow_MemFree((void **)&data);
+
+	CHECK(ConstructRelayCommandForActuator("RELAY_2_OFF", &data));
+	CHECK(FirmwareBench_ActuatorParseCommand(data, cmd, sizeof(cmd), &heartBeat, &isCompact));
+	CHECK(strcmp(cmd, "RELAY_2_OFF") == 0);
+	CHECK(FirmwareBench_FindCommand(cmd) >= 0);
+	Flow_MemFree((void **)&data);
+
+	//Settings without heartbeat are rejected
+	CHECK(!FirmwareBench_ActuatorParseCommand("<command><info>UPDATE_SETTINGS</info><settings></settings></command>",
+												cmd, sizeof(cmd), &heartBeat, &isCompact));
+}
+
+static void test_SensorEventsReachController(void)
+{
+	Controller *me = NewController();
+	char content[1024];
+	char *xml;
+
+	NewCaseDirectory();
+	ControllerStart(me);
+	TakePosted(me, content, sizeof(content));
+
+	HandleMessage(me, TEST_SENSOR, FirmwareBench_SensorMessageXML(21.5f, 38.25f, TEST_EPOCH));
+	CHECK(me->sensorConfig.isAlive);
+	CHECK_NEAR(21.5, me->sensors[Sensor_Temperature].value, 0.001);
+	CHECK_NEAR(38.25, me->sensors[Sensor_Humidity].value, 0.001);
+
+	xml = FirmwareBench_SensorMessageXML(23.0f, 41.0f, TEST_EPOCH + 1);
+	HandleMessage(me, TEST_SENSOR, WireFormat_ToCompact(xml));
+	Flow_MemFree((void **)&xml);
+	CHECK_NEAR(23.0, me->sensors[Sensor_Temperature].value, 0.001);
+	CHECK_NEAR(41.0, me->sensors[Sensor_Humidity].value, 0.001);
+
+	//Keyframe, then a delta carrying only the changed temperature
+	HandleMessage(me, TEST_SENSOR, FirmwareBench_SensorDeltaMessageXML(20.0f, 45.0f, 4, TEST_EPOCH + 2));
+	CHECK_NEAR(20.0, me->sensors[Sensor_Temperature].value, 0.001);
+	CHECK_NEAR(45.0, me->sensors[Sensor_Humidity].value, 0.001);
+	HandleMessage(me, TEST_SENSOR, FirmwareBench_SensorDeltaMessageXML(19.0f, 45.0f, 4, TEST_EPOCH + 3));
+	CHECK_NEAR(19.0, me->sensors[Sensor_Temperature].value, 0.001);
+	CHECK_NEAR(45.0, me->sensors[Sensor_Humidity].value, 0.001);
+	TakePosted(me, content, sizeof(content));
+}
+
+/**
+ * Sensor messages batched as the firmware's send thread does, in XML
+ */
+static char *SensorBatchXML(float temperature1, float humidity1, float temperature2, float humidity2)
+{
+	char *first = FirmwareBench_SensorMessageXML(temperature1, humidity1, TEST_EPOCH);
+	char *second = FirmwareBench_SensorMessageXML(temperature2, humidity2, TEST_EPOCH + 1);
+	char *batch = Flow_MemAlloc(strlen(first) + strlen(second) + 64);
+
+	sprintf(batch, CLIMATE_PROTO_XML_DECLARATION "<" CLIMATE_PROTO_EVENTS_ROOT ">%s%s</" CLIMATE_PROTO_EVENTS_ROOT ">",
+			strstr(first, "?>") + 2, strstr(second, "?>") + 2);
+	Flow_MemFree((void **)&first);
+	Flow_MemFree((void **)&second);
+	return batch;
+}
+
+static void test_BatchedSensorEventsReachController(void)
+{
+	Controller *me = NewController();
+	const char *cursor = NULL;
+	const char *event;
+	char content[1024];
+	char *xml, *single;
+	unsigned int count = 0;
+
+	xml = SensorBatchXML(21.5f, 38.25f, 22.0f, 40.0f);
+	while (ClimateProto_NextEvent(xml, &cursor, &event))
+	{
+		CHECK(strncmp(event, "<event>", 7) == 0);
+		count++;
+	}
+	CHECK_EQ_INT(2, count);
+	single = FirmwareBench_SensorMessageXML(21.5f, 38.25f, TEST_EPOCH);
+	cursor = NULL;
+	CHECK(!ClimateProto_NextEvent(single, &cursor, &event));
+	Flow_MemFree((void **)&single);
+
+	NewCaseDirectory();
+	ControllerStart(me);
+	TakePosted(me, content, sizeof(content));
+
+	//Applied in order, so the last event's values stand
+	HandleMessage(me, TEST_SENSOR, xml);
+	CHECK(me->sensorConfig.isAlive);
+	CHECK_NEAR(22.0, me->sensors[Sensor_Temperature].value, 0.001);
+	CHECK_NEAR(40.0, me->sensors[Sensor_Humidity].value, 0.001);
+
+	xml = SensorBatchXML(19.0f, 50.0f, 18.5f, 52.0f);
+	HandleMessage(me, TEST_SENSOR, WireFormat_ToCompact(xml));
+	Flow_MemFree((void **)&xml);
+	CHECK_NEAR(18.5, me->sensors[Sensor_Temperature].value, 0.001);
+	CHECK_NEAR(52.0, me->sensors[Sensor_Humidity].value, 0.001);
+	TakePosted(me, content, sizeof(content));
+}
+
+static void test_SensorLogReachesHistoryOnly(void)
+{
+	Controller *me = NewController();
+	const float temperatures[] = { 18.0f, 18.5f, 19.0f };
+	const float humidities[] = { 50.0f, 900.0f, 52.0f };
+	unsigned long logged = controllerStats.sensorLogSamples;
+	TimeSeriesPoint points[4];
+	char content[1024];
+	time_t now, from;
+
+	NewCaseDirectory();
+	ControllerStart(me);
+	TakePosted(me, content, sizeof(content));
+
+	HandleMessage(me, TEST_SENSOR, FirmwareBench_SensorMessageXML(21.5f, 38.25f, TEST_EPOCH));
+	Flow_GetTime(&now);
+	from = now - 600;
+	from -= from % 60;
+	HandleMessage(me, TEST_SENSOR, FirmwareBench_SensorLogXML(temperatures, humidities, 3, from, now));
+
+	//Kept through an outage, so past values: current ones stand
+	CHECK_NEAR(21.5, me->sensors[Sensor_Temperature].value, 0.001);
+	CHECK_NEAR(38.25, me->sensors[Sensor_Humidity].value, 0.001);
+	CHECK_EQ_INT(3, controllerStats.sensorLogSamples - logged);
+	CHECK_EQ_INT(3, TimeSeries_Query(&me->history[Sensor_Temperature], from, from + 179, 60, points, 4));
+	CHECK_NEAR(18.5, points[1].mean, 0.001);
+	//Humidity out of range was not stored
+	CHECK_EQ_INT(2, TimeSeries_Query(&me->history[Sensor_Humidity], from, from + 179, 60, points, 4));
+	CHECK_NEAR(52.0, points[1].mean, 0.001);
+
+	//Only the served sensor's log is taken
+	HandleMessage(me, TEST_ACTUATOR, FirmwareBench_SensorLogXML(temperatures, humidities, 3, from, now));
+	CHECK_EQ_INT(3, controllerStats.sensorLogSamples - logged);
+	TakePosted(me, content, sizeof(content));
+}
+
+/**
+ * Wakeups of the sensor's schedule over a minute of steady readings
+ */
+static unsigned int SteadyWakeups(unsigned int backOff, unsigned long *reads)
+{
+	unsigned int now = 0;
+	unsigned int wakeups = 0;
+	float reported;
+
+	FirmwareBench_SensorStartSchedule(backOff, 0.5f);
+	while ((now += FirmwareBench_SensorTimeToWakeup(now)) < 60000)
+	{
+		FirmwareBench_SensorWakeup(2048, now, &reported, reads);
+		wakeups++;
+	}
+	return wakeups;
+}
+
+static void test_SensorReadsCoalesceAndBackOff(void)
+{
+	unsigned long reads = 0;
+	unsigned int now = 0;
+	float reported;
+
+	//Temperature read every 500 ms, humidity read along with it every 2500 ms
+	FirmwareBench_SensorStartSchedule(1, 0.5f);
+	while ((now += FirmwareBench_SensorTimeToWakeup(now)) <= 2500)
+	{
+		FirmwareBench_SensorWakeup(2048, now, &reported, &reads);
+	}
+	CHECK_EQ_INT(5, reads);
+
+	//Steady readings back off to a fraction of the wakeups
+	CHECK(SteadyWakeups(8, &reads) * 3 < SteadyWakeups(1, &reads));
+}
+
+static void test_ActuatorEventsReachController(void)
+{
+	Controller *me = NewController();
+	char content[1024];
+	char cmd[CLIMATE_PROTO_STRING_SIZE];
+	unsigned int heartBeat = 0;
+	bool isCompact = false;
+
+	NewCaseDirectory();
+	ControllerStart(me);
+	TakePosted(me, content, sizeof(content));
+	me->relays[Relay_Heater].status = Relay_Off;
+	me->relays[Relay_Fan].status = Relay_Off;
+
+	//Actuator reports heater ON, which controller wants OFF, and switches it back
+	HandleMessage(me, TEST_ACTUATOR, FirmwareBench_ActuatorHeartBeatMsg(true, false));
+	CHECK(me->actuatorConfig.isAlive);
+	CHECK(TakePosted(me, content, sizeof(content)) > 0);
+	CHECK(FirmwareBench_ActuatorParseCommand(content, cmd, sizeof(cmd), &heartBeat, &isCompact));
+	CHECK(strcmp(cmd, "RELAY_1_OFF") == 0);
+}
+
+int main(void)
+{
+	FlowStub_UseVirtualTime(TEST_EPOCH);
+
+#define RUN_CASE(test) \
+	do \
+	{ \
+		FlowStub_Reset(); \
+		RUN_TEST(test); \
+	} while (0)
+
+	RUN_CASE(test_SerializeWritesPresentFieldsInOrder);
+	RUN_CASE(test_ParseReadsBackSerialized);
+	RUN_CASE(test_ParseSkipsOtherElements);
+	RUN_CASE(test_ParseRejectsMissingSection);
+	RUN_CASE(test_NextRecordReadsRepeatedRecords);
+	RUN_CASE(test_ControllerSettingsReachSensor);
+	RUN_CASE(test_SensorAppliesCalibration);
+	RUN_CASE(test_SensorAppliesFilterSettings);
+	RUN_CASE(test_ControllerSettingsKeepFormat);
+	RUN_CASE(test_ControllerCommandsReachActuator);
+	RUN_CASE(test_SensorEventsReachController);
+	RUN_CASE(test_BatchedSensorEventsReachController);
+	RUN_CASE(test_SensorLogReachesHistoryOnly);
+	RUN_CASE(test_SensorReadsCoalesceAndBackOff);
+	RUN_CASE(test_ActuatorEventsReachController);
+	RemoveCaseDirectories();
+	return TEST_RESULT();
+}
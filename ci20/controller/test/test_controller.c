@@ -0,0 +1,808 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#define _GNU_SOURCE	//nftw()
+
+#include <unistd.h>
+#include <ftw.h>
+#include <sys/stat.h>
+
+#include "flow/flowcore.h"
+#include "controller.h"
+#include "flow_interface.h"
+#include "controller_stats.h"
+#include "flow_stub.h"
+#include "test.h"
+
+/**
+ * Controller logic tests, driving ControllerHandleEvent() directly and
+ * inspecting commands posted for the flow thread. Clock is virtual, so
+ * timers fire only on FlowStub_AdvanceTime().
+ *
+ * Controllers are never freed: history writer and server threads keep
+ * running against them till the process exits.
+ */
+
+#define QUEUE_SIZE (64)
+#define TEST_USER "user"
+#define TEST_SENSOR "sensor"
+#define TEST_ACTUATOR "actuator"
+#define TEST_EPOCH (1500000000)
+
+#define SETTINGS_XML(threshold) SENSOR_CONFIG_SETTINGS_XML(threshold, "")
+
+//Settings with more elements in the sensor's config, e.g. its calibration
+#define SENSOR_CONFIG_SETTINGS_XML(threshold, sensorConfig) CONFIG_SETTINGS_XML(threshold, "", sensorConfig)
+
+//Settings with more elements in the controller's config, e.g. its heartbeat keyframe
+#define CONFIG_SETTINGS_XML(threshold, config, sensorConfig) \
+	"<ControllerConfig>" config \
+	"<TemperatureThreshold>" threshold "</TemperatureThreshold>" \
+	"<HumidityThreshold>40.00</HumidityThreshold>" \
+	"<TemperatureOrientation>BELOW</TemperatureOrientation>" \
+	"<HumidityOrientation>ABOVE</HumidityOrientation>" \
+	"<HeartBeat>15000</HeartBeat>" \
+	"<SensorConfig><HeartBeat>15000</HeartBeat>" \
+	"<TemperatureReadInterval>1000</TemperatureReadInterval>" \
+	"<HumidityReadInterval>2500</HumidityReadInterval>" \
+	"<TemperatureReadDelta>0.50</TemperatureReadDelta>" \
+	"<HumidityReadDelta>2.00</HumidityReadDelta>" sensorConfig "</SensorConfig>" \
+	"<ActuatorConfig><HeartBeat>15000</HeartBeat></ActuatorConfig>" \
+	"</ControllerConfig>"
+
+//Settings in delta mode, where devices are seen restarting
+#define KEYFRAME_SETTINGS_XML CONFIG_SETTINGS_XML("22.50", "<HeartBeatKeyframe>5</HeartBeatKeyframe>", "")
+
+#define SENSOR_EVENT_XML(temperature, humidity) \
+	"<event><type>Sensor</type><info>" \
+	"<Temperature>" temperature "</Temperature><Humidity>" humidity "</Humidity>" \
+	"</info></event>"
+
+//Sensor event in delta mode, info holding the values sent
+#define SENSOR_DELTA_XML(seq, base, info) \
+	"<event><type>Sensor</type><seq>" seq "</seq><base>" base "</base><info>" info "</info></event>"
+
+#define ACTUATOR_EVENT_XML \
+	"<event><type>Actuator</type><info><Relay_1>OFF</Relay_1><Relay_2>OFF</Relay_2></info></event>"
+
+typedef struct
+{
+	unsigned int counts[FlowInterfaceCmd_SetSetting + 1];
+	char lastContent[FlowInterfaceCmd_SetSetting + 1][1024];
+}Posted;
+
+static unsigned int _caseNumber = 0;
+
+static char _testDirectory[64];	//Of this run, holding a directory per case
+static char _caseDirectory[96];	//State directory of controllers started by the running case
+
+/**
+ * Start each case with a fresh state directory for its controllers, in a
+ * temporary directory of the run rather than the working directory.
+ */
+static void NewCaseDirectory(void)
+{
+	const char *tmp = getenv("TMPDIR");
+
+	if (!_testDirectory[0])
+	{
+		snprintf(_testDirectory, sizeof(_testDirectory), "%s/test_controller.XXXXXX", tmp ? tmp : "/tmp");
+		if (!mkdtemp(_testDirectory))
+		{
+			perror("mkdtemp");
+			exit(EXIT_FAILURE);
+		}
+	}
+	snprintf(_caseDirectory, sizeof(_caseDirectory), "%s/case%u", _testDirectory, ++_caseNumber);
+}
+
+static int RemoveFile(const char *path, const struct stat *status, int flag, struct FTW *ftw)
+{
+	return remove(path);
+}
+
+/**
+ * Remove the directories of all cases, as their controllers are done.
+ */
+static void RemoveCaseDirectories(void)
+{
+	if (_testDirectory[0])
+	{
+		nftw(_testDirectory, RemoveFile, 16, FTW_DEPTH | FTW_PHYS);
+	}
+}
+
+static Controller *NewController(void)
+{
+	Controller *me = malloc(sizeof(Controller));
+
+	ControllerSetDefaults(me);
+	me->stateDir = _caseDirectory;
+	strcpy(me->userId, TEST_USER);
+	me->sendMsgQueue = FlowQueue_NewBlocking(QUEUE_SIZE);
+	me->receiveMsgQueue = FlowQueue_NewBlocking(QUEUE_SIZE);
+	return me;
+}
+
+/**
+ * Take all commands posted for flow thread, counting them by type.
+ */
+static void TakePosted(Controller *me, Posted *posted)
+{
+	FlowInterfaceCmd *cmd;
+
+	memset(posted, 0, sizeof(*posted));
+	while ((cmd = FlowQueue_DequeueWaitFor(me->sendMsgQueue, 0)) != NULL)
+	{
+		posted->counts[cmd->cmdType]++;
+		if (cmd->details)
+		{
+			snprintf(posted->lastContent[cmd->cmdType], sizeof(posted->lastContent[0]), "%s", (char *)cmd->details);
+			Flow_MemFree(&cmd->details);
+		}
+		Flow_MemFree((void **)&cmd);
+	}
+}
+
+/**
+ * Handle all events posted to controller thread, e.g. by timers.
+ */
+static unsigned int HandlePending(Controller *me)
+{
+	ControllerEvent *event;
+	unsigned int count = 0;
+
+	while ((event = FlowQueue_DequeueWaitFor(me->receiveMsgQueue, 0)) != NULL)
+	{
+		ControllerHandleEvent(me, event);
+		count++;
+	}
+	return count;
+}
+
+static void HandleEvent(Controller *me, ControllerEvent_Type evtType, void *details)
+{
+	ControllerEvent *event = Flow_MemAlloc(sizeof(ControllerEvent));
+
+	event->evtType = evtType;
+	event->details = details;
+	ControllerHandleEvent(me, event);
+}
+
+static void HandleSettings(Controller *me, const char *settings)
+{
+	HandleEvent(me, ControllerEvent_SettingSuccess, FlowString_Duplicate(settings));
+}
+
+static void HandleMessage(Controller *me, const char *from, const char *content)
+{
+	ReceivedMessage *message = Flow_MemAlloc(sizeof(ReceivedMessage));
+
+	message->sendorId = FlowString_Duplicate(from);
+	message->data = FlowString_Duplicate(content);
+	HandleEvent(me, ControllerEvent_ReceivedMessage, message);
+}
+
+/**
+ * Start a controller, which has heard of both devices.
+ */
+static Controller *StartWithDevices(void)
+{
+	Controller *me = NewController();
+	Posted posted;
+
+	ControllerStart(me);
+	HandleMessage(me, TEST_SENSOR, SENSOR_EVENT_XML("30.00", "35.00"));
+	HandleMessage(me, TEST_ACTUATOR, ACTUATOR_EVENT_XML);
+	TakePosted(me, &posted);
+	return me;
+}
+
+static void test_StartAsksForSettings(void)
+{
+	Controller *me = NewController();
+	Posted posted;
+
+	NewCaseDirectory();
+	ControllerStart(me);
+	TakePosted(me, &posted);
+
+	CHECK_EQ_INT(1, posted.counts[FlowInterfaceCmd_GetSetting]);
+	CHECK(!me->isStarted);
+}
+
+static void test_FirstSettingsStartTimersAndPush(void)
+{
+	Controller *me;
+	Posted posted;
+	unsigned long pushes = controllerStats.devicePushes;
+	char path[256];
+
+	NewCaseDirectory();
+	me = StartWithDevices();
+	HandleSettings(me, SETTINGS_XML("22.50"));
+	TakePosted(me, &posted);
+
+	CHECK(me->isStarted);
+	CHECK_NEAR(22.5, me->sensors[Sensor_Temperature].threshold, 0.001);
+	CHECK_NEAR(40.0, me->sensors[Sensor_Humidity].threshold, 0.001);
+	CHECK_EQ_INT(1, posted.counts[FlowInterfaceCmd_SendMessageToSensor]);
+	CHECK_EQ_INT(1, posted.counts[FlowInterfaceCmd_SendMessageToActuator]);
+	CHECK_CONTAINS(posted.lastContent[FlowInterfaceCmd_SendMessageToSensor], "UPDATE_SETTINGS");
+	CHECK_CONTAINS(posted.lastContent[FlowInterfaceCmd_SendMessageToActuator], "UPDATE_SETTINGS");
+	CHECK_EQ_INT(pushes + 2, controllerStats.devicePushes);
+	snprintf(path, sizeof(path), "%s/%s", _caseDirectory, SETTINGS_CACHE_FILE);
+	CHECK(access(path, F_OK) == 0);
+
+	//Heartbeat timer runs on controller's configured period
+	FlowStub_AdvanceTime(15000);
+	CHECK(HandlePending(me) > 0);
+	TakePosted(me, &posted);
+	CHECK(posted.counts[FlowInterfaceCmd_SendMessageToUser] > 0);
+}
+
+static void test_UnchangedSettingsAreNotPushed(void)
+{
+	Controller *me;
+	Posted posted;
+	unsigned long skipped;
+
+	NewCaseDirectory();
+	me = StartWithDevices();
+	HandleSettings(me, KEYFRAME_SETTINGS_XML);
+	TakePosted(me, &posted);
+
+	//User asks for settings to be retrieved, but they haven't changed
+	skipped = controllerStats.skippedDevicePushes;
+	HandleMessage(me, TEST_USER, "<command><info>RETRIEVE_SETTINGS</info></command>");
+	TakePosted(me, &posted);
+	CHECK_EQ_INT(1, posted.counts[FlowInterfaceCmd_GetSetting]);
+
+	HandleSettings(me, KEYFRAME_SETTINGS_XML);
+	TakePosted(me, &posted);
+	CHECK_EQ_INT(0, posted.counts[FlowInterfaceCmd_SendMessageToSensor]);
+	CHECK_EQ_INT(0, posted.counts[FlowInterfaceCmd_SendMessageToActuator]);
+	CHECK_EQ_INT(1, posted.counts[FlowInterfaceCmd_SendMessageToUser]);
+	CHECK_CONTAINS(posted.lastContent[FlowInterfaceCmd_SendMessageToUser], "RETRIEVE_SETTINGS_SUCCESS");
+	CHECK_EQ_INT(skipped + 2, controllerStats.skippedDevicePushes);
+
+	//Changed settings are applied and pushed
+	HandleSettings(me, SETTINGS_XML("21.00"));
+	TakePosted(me, &posted);
+	CHECK_NEAR(21.0, me->sensors[Sensor_Temperature].threshold, 0.001);
+	CHECK_EQ_INT(1, posted.counts[FlowInterfaceCmd_SendMessageToSensor]);
+	CHECK_EQ_INT(1, posted.counts[FlowInterfaceCmd_SendMessageToActuator]);
+}
+
+static void test_RestartedDevicesGetUnchangedSettings(void)
+{
+	Controller *me;
+	Posted posted;
+	unsigned long pushes;
+
+	NewCaseDirectory();
+	me = StartWithDevices();
+	HandleSettings(me, KEYFRAME_SETTINGS_XML);
+	TakePosted(me, &posted);
+	pushes = controllerStats.devicePushes;
+
+	//Both devices go quiet, only sensor is heard again
+	FlowStub_AdvanceTime(30001);
+	HandlePending(me);
+	CHECK(!me->sensorConfig.isAlive);
+	CHECK(!me->actuatorConfig.isAlive);
+	HandleMessage(me, TEST_SENSOR, SENSOR_DELTA_XML("1", "1", "<Temperature>30.00</Temperature><Humidity>35.00</Humidity>"));
+	TakePosted(me, &posted);
+	CHECK_EQ_INT(1, posted.counts[FlowInterfaceCmd_SendMessageToSensor]);
+	CHECK_CONTAINS(posted.lastContent[FlowInterfaceCmd_SendMessageToSensor], "UPDATE_SETTINGS");
+	CHECK_EQ_INT(pushes + 1, controllerStats.devicePushes);
+
+	//Unchanged settings retrieved by user go to the device that missed them
+	HandleMessage(me, TEST_USER, "<command><info>RETRIEVE_SETTINGS</info></command>");
+	HandleSettings(me, KEYFRAME_SETTINGS_XML);
+	TakePosted(me, &posted);
+	CHECK_EQ_INT(0, posted.counts[FlowInterfaceCmd_SendMessageToSensor]);
+	CHECK_EQ_INT(1, posted.counts[FlowInterfaceCmd_SendMessageToActuator]);
+	CHECK_CONTAINS(posted.lastContent[FlowInterfaceCmd_SendMessageToActuator], "UPDATE_SETTINGS");
+	CHECK_CONTAINS(posted.lastContent[FlowInterfaceCmd_SendMessageToUser], "RETRIEVE_SETTINGS_SUCCESS");
+	CHECK_EQ_INT(pushes + 2, controllerStats.devicePushes);
+
+	//Sensor restarting within its expiry sends full events till it has settings again
+	HandleMessage(me, TEST_SENSOR, SENSOR_DELTA_XML("2", "1", "<Temperature>30.50</Temperature>"));
+	TakePosted(me, &posted);
+	CHECK_EQ_INT(0, posted.counts[FlowInterfaceCmd_SendMessageToSensor]);
+	HandleMessage(me, TEST_SENSOR, SENSOR_EVENT_XML("30.00", "35.00"));
+	TakePosted(me, &posted);
+	CHECK_EQ_INT(1, posted.counts[FlowInterfaceCmd_SendMessageToSensor]);
+}
+
+static void test_RestartedDevicesGetSettingsOnRetrieve(void)
+{
+	Controller *me;
+	Posted posted;
+	unsigned long pushes;
+
+	NewCaseDirectory();
+	me = StartWithDevices();
+	HandleSettings(me, SETTINGS_XML("22.50"));
+	TakePosted(me, &posted);
+	pushes = controllerStats.devicePushes;
+
+	//Without delta events a restarted sensor looks like one that kept running
+	HandleMessage(me, TEST_SENSOR, SENSOR_EVENT_XML("30.00", "35.00"));
+	TakePosted(me, &posted);
+	CHECK_EQ_INT(0, posted.counts[FlowInterfaceCmd_SendMessageToSensor]);
+
+	//So unchanged settings retrieved by user go to every device again
+	HandleMessage(me, TEST_USER, "<command><info>RETRIEVE_SETTINGS</info></command>");
+	HandleSettings(me, SETTINGS_XML("22.50"));
+	TakePosted(me, &posted);
+	CHECK_EQ_INT(1, posted.counts[FlowInterfaceCmd_SendMessageToSensor]);
+	CHECK_EQ_INT(1, posted.counts[FlowInterfaceCmd_SendMessageToActuator]);
+	CHECK_CONTAINS(posted.lastContent[FlowInterfaceCmd_SendMessageToUser], "RETRIEVE_SETTINGS_SUCCESS");
+	CHECK_EQ_INT(pushes + 2, controllerStats.devicePushes);
+
+	//Unless asked for by user
+	HandleSettings(me, SETTINGS_XML("22.50"));
+	TakePosted(me, &posted);
+	CHECK_EQ_INT(0, posted.counts[FlowInterfaceCmd_SendMessageToSensor]);
+	CHECK_EQ_INT(0, posted.counts[FlowInterfaceCmd_SendMessageToActuator]);
+}
+
+static void test_FailedPushesAreRetried(void)
+{
+	Controller *me;
+	Posted posted;
+	FlowInterfaceCmd *cmd;
+	unsigned long failed = controllerStats.failedDevicePushes;
+	unsigned long pushes;
+
+	NewCaseDirectory();
+	me = StartWithDevices();
+	HandleSettings(me, SETTINGS_XML("22.50"));
+	TakePosted(me, &posted);
+
+	//Flow thread queue is full when settings change
+	do
+	{
+		cmd = Flow_MemAlloc(sizeof(FlowInterfaceCmd));
+		cmd->cmdType = FlowInterfaceCmd_GetSetting;
+		cmd->details = NULL;
+	} while (FlowQueue_Enqueue(me->sendMsgQueue, cmd));
+	Flow_MemFree((void **)&cmd);
+	HandleSettings(me, SETTINGS_XML("21.00"));
+	TakePosted(me, &posted);
+	CHECK_EQ_INT(0, posted.counts[FlowInterfaceCmd_SendMessageToSensor]);
+	CHECK_EQ_INT(failed + 2, controllerStats.failedDevicePushes);
+	CHECK(!me->sensorConfig.hasSettings);
+
+	//Devices get them with their next event
+	pushes = controllerStats.devicePushes;
+	HandleMessage(me, TEST_SENSOR, SENSOR_EVENT_XML("30.00", "35.00"));
+	HandleMessage(me, TEST_ACTUATOR, ACTUATOR_EVENT_XML);
+	TakePosted(me, &posted);
+	CHECK_EQ_INT(pushes + 2, controllerStats.devicePushes);
+	CHECK(me->sensorConfig.hasSettings);
+	CHECK(me->actuatorConfig.hasSettings);
+}
+
+static void test_CalibrationSettingsArePushed(void)
+{
+	Controller *me;
+	Posted posted;
+
+	NewCaseDirectory();
+	me = StartWithDevices();
+	HandleSettings(me, SENSOR_CONFIG_SETTINGS_XML("22.50",
+		"<TemperatureCalibration><Offset>-0.5</Offset><Gain>1.01</Gain></TemperatureCalibration>"));
+	TakePosted(me, &posted);
+	CHECK_NEAR(-0.5, me->sensors[Sensor_Temperature].calibration.offset, 0.001);
+	CHECK_NEAR(1.01, me->sensors[Sensor_Temperature].calibration.gain, 0.001);
+	CHECK_NEAR(0.0, me->sensors[Sensor_Temperature].calibration.curve, 0.001);
+	CHECK_NEAR(0.0, me->sensors[Sensor_Humidity].calibration.gain, 0.001);
+	CHECK_EQ_INT(1, posted.counts[FlowInterfaceCmd_SendMessageToSensor]);
+	CHECK_CONTAINS(posted.lastContent[FlowInterfaceCmd_SendMessageToSensor],
+		"<TemperatureOffset>-128</TemperatureOffset><TemperatureGain>66191</TemperatureGain>"
+		"<TemperatureCurve>0</TemperatureCurve>");
+
+	//Config without calibration keeps the last one
+	HandleSettings(me, SETTINGS_XML("21.00"));
+	TakePosted(me, &posted);
+	CHECK_NEAR(1.01, me->sensors[Sensor_Temperature].calibration.gain, 0.001);
+	CHECK_CONTAINS(posted.lastContent[FlowInterfaceCmd_SendMessageToSensor], "<TemperatureGain>66191</TemperatureGain>");
+}
+
+static void test_FilterSettingsArePushed(void)
+{
+	Controller *me;
+	Posted posted;
+
+	NewCaseDirectory();
+	me = StartWithDevices();
+	HandleSettings(me, SENSOR_CONFIG_SETTINGS_XML("22.50",
+		"<TemperatureMedianSize>5</TemperatureMedianSize><TemperatureFilterAlpha>0.125</TemperatureFilterAlpha>"
+		"<HumidityMedianSize>3</HumidityMedianSize>"));
+	TakePosted(me, &posted);
+	CHECK_EQ_INT(5, me->sensors[Sensor_Temperature].medianSize);
+	CHECK_EQ_INT(3, me->sensors[Sensor_Humidity].medianSize);
+	CHECK_NEAR(0.0, me->sensors[Sensor_Humidity].filterAlpha, 0.001);
+	CHECK_CONTAINS(posted.lastContent[FlowInterfaceCmd_SendMessageToSensor],
+		"<TemperatureMedianSize>5</TemperatureMedianSize><HumidityMedianSize>3</HumidityMedianSize>"
+		"<TemperatureFilterAlpha>8192</TemperatureFilterAlpha>");
+	CHECK(!strstr(posted.lastContent[FlowInterfaceCmd_SendMessageToSensor], "HumidityFilterAlpha"));
+
+	//Config without them keeps the last ones
+	HandleSettings(me, SETTINGS_XML("21.00"));
+	TakePosted(me, &posted);
+	CHECK_EQ_INT(5, me->sensors[Sensor_Temperature].medianSize);
+	CHECK_CONTAINS(posted.lastContent[FlowInterfaceCmd_SendMessageToSensor], "<TemperatureFilterAlpha>8192</TemperatureFilterAlpha>");
+}
+
+static void test_MaxReadIntervalsArePushed(void)
+{
+	Controller *me;
+	Posted posted;
+
+	NewCaseDirectory();
+	me = StartWithDevices();
+	HandleSettings(me, SENSOR_CONFIG_SETTINGS_XML("22.50",
+		"<HumidityMaxReadInterval>24000</HumidityMaxReadInterval>"));
+	TakePosted(me, &posted);
+	CHECK_EQ_INT(0, me->sensors[Sensor_Temperature].maxReadInterval);
+	CHECK_EQ_INT(24000, me->sensors[Sensor_Humidity].maxReadInterval);
+	CHECK_CONTAINS(posted.lastContent[FlowInterfaceCmd_SendMessageToSensor],
+		"<HumidityMaxReadInterval>24000</HumidityMaxReadInterval>");
+	CHECK(!strstr(posted.lastContent[FlowInterfaceCmd_SendMessageToSensor], "TemperatureMaxReadInterval"));
+
+	//Config without them keeps the last ones
+	HandleSettings(me, SETTINGS_XML("21.00"));
+	TakePosted(me, &posted);
+	CHECK_EQ_INT(24000, me->sensors[Sensor_Humidity].maxReadInterval);
+}
+
+static void test_RestartAppliesCachedSettings(void)
+{
+	Controller *me;
+	Posted posted;
+	unsigned long fromCache = controllerStats.settingsFromCache;
+
+	NewCaseDirectory();
+	me = StartWithDevices();
+	HandleSettings(me, SETTINGS_XML("19.50"));
+	TakePosted(me, &posted);
+
+	//Controller started again in same directory doesn't wait for cloud
+	FlowStub_Reset();
+	me = NewController();
+	ControllerStart(me);
+	TakePosted(me, &posted);
+	CHECK(me->isStarted);
+	CHECK_NEAR(19.5, me->sensors[Sensor_Temperature].threshold, 0.001);
+	CHECK_EQ_INT(fromCache + 1, controllerStats.settingsFromCache);
+	CHECK_EQ_INT(1, posted.counts[FlowInterfaceCmd_GetSetting]);
+
+	//Cloud confirms the cached settings
+	HandleSettings(me, SETTINGS_XML("19.50"));
+	TakePosted(me, &posted);
+	CHECK_EQ_INT(0, posted.counts[FlowInterfaceCmd_SendMessageToUser]);
+	CHECK_NEAR(19.5, me->sensors[Sensor_Temperature].threshold, 0.001);
+}
+
+static void test_RestartRestoresHistory(void)
+{
+	Controller *me;
+	HistoryStore store;
+	HistoryRecord record = { 0 };
+	TimeSeriesPoint points[4];
+	char path[HISTORY_STORE_DIR_SIZE];
+	time_t now;
+
+	//History left by a previous run, the older record without humidity
+	NewCaseDirectory();
+	Flow_GetTime(&now);
+	mkdir(_caseDirectory, 0755);
+	snprintf(path, sizeof(path), "%s/%s", _caseDirectory, HISTORY_STORE_DIR);
+	CHECK(HistoryStore_Open(&store, path, HISTORY_BLOCKS_PER_SEGMENT, HISTORY_MAX_SEGMENTS));
+	record.time = (uint32_t)now - 7200;
+	record.temperature = 2150;
+	record.humidity = 65535;
+	CHECK(HistoryStore_Append(&store, &record));
+	record.time = (uint32_t)now - 3600;
+	record.temperature = 2200;
+	record.humidity = 4000;
+	CHECK(HistoryStore_Append(&store, &record));
+	CHECK(HistoryStore_Sync(&store));
+	HistoryStore_Close(&store);
+
+	me = NewController();
+	ControllerStart(me);
+	CHECK_EQ_INT(2, TimeSeries_Query(&me->history[Sensor_Temperature], (uint32_t)now - 7200, (uint32_t)now, 3600, points, 4));
+	CHECK_NEAR(21.5, points[0].mean, 0.001);
+	CHECK_NEAR(22.0, points[1].mean, 0.001);
+	CHECK_EQ_INT(1, TimeSeries_Query(&me->history[Sensor_Humidity], (uint32_t)now - 7200, (uint32_t)now, 3600, points, 4));
+	CHECK_NEAR(40.0, points[0].mean, 0.001);
+
+	//Served by control zone, each with the history of its sensor
+	CHECK(me->zoneHistory[Relay_Fan] == &me->history[Sensor_Humidity]);
+}
+
+static void test_MissingSettingsAreCreated(void)
+{
+	Controller *me = NewController();
+	Posted posted;
+
+	NewCaseDirectory();
+	ControllerStart(me);
+	TakePosted(me, &posted);
+	HandleEvent(me, ControllerEvent_SettingFailure, NULL);
+	TakePosted(me, &posted);
+
+	CHECK(me->isStarted);
+	CHECK_EQ_INT(1, posted.counts[FlowInterfaceCmd_SetSetting]);
+	CHECK_CONTAINS(posted.lastContent[FlowInterfaceCmd_SetSetting], "<TemperatureThreshold>25.00</TemperatureThreshold>");
+}
+
+static void test_SensorEventSwitchesRelay(void)
+{
+	Controller *me;
+	Posted posted;
+
+	NewCaseDirectory();
+	me = StartWithDevices();
+	HandleSettings(me, SETTINGS_XML("22.50"));
+	TakePosted(me, &posted);
+
+	//Below threshold, heater goes ON, fan stays ON
+	HandleMessage(me, TEST_SENSOR, SENSOR_EVENT_XML("18.00", "45.00"));
+	TakePosted(me, &posted);
+	CHECK_EQ_INT(Relay_On, me->relays[Relay_Heater].status);
+	CHECK_EQ_INT(1, posted.counts[FlowInterfaceCmd_SendMessageToActuator]);
+	CHECK_CONTAINS(posted.lastContent[FlowInterfaceCmd_SendMessageToActuator], "RELAY_1_ON");
+
+	//Unknown sensor is ignored
+	HandleMessage(me, "other", SENSOR_EVENT_XML("30.00", "45.00"));
+	TakePosted(me, &posted);
+	CHECK_EQ_INT(Relay_On, me->relays[Relay_Heater].status);
+	CHECK_EQ_INT(0, posted.counts[FlowInterfaceCmd_SendMessageToActuator]);
+}
+
+static void test_CommandsFromOthersAreIgnored(void)
+{
+	Controller *me;
+	Posted posted;
+
+	NewCaseDirectory();
+	me = StartWithDevices();
+	HandleMessage(me, "stranger", "<command><info>RELAY_1_ON</info></command>");
+	TakePosted(me, &posted);
+
+	CHECK_EQ_INT(Relay_Off, me->relays[Relay_Heater].status);
+	CHECK_EQ_INT(0, posted.counts[FlowInterfaceCmd_SendMessageToActuator]);
+}
+
+/**
+ * Keep devices alive and take the next heartbeat to user
+ */
+static void NextHeartBeat(Controller *me, Posted *posted, const char *sensorEvent)
+{
+	HandleMessage(me, TEST_SENSOR, sensorEvent);
+	HandleMessage(me, TEST_ACTUATOR, ACTUATOR_EVENT_XML);
+	TakePosted(me, posted);
+	FlowStub_AdvanceTime(15000);
+	HandlePending(me);
+	TakePosted(me, posted);
+}
+
+static void test_DeltaHeartBeatsToUser(void)
+{
+	Controller *me = NewController();
+	Posted posted;
+	const char *heartBeat = posted.lastContent[FlowInterfaceCmd_SendMessageToUser];
+
+	NewCaseDirectory();
+	ControllerStart(me);
+	HandleMessage(me, TEST_SENSOR, SENSOR_EVENT_XML("30.00", "35.00"));
+	HandleMessage(me, TEST_ACTUATOR, ACTUATOR_EVENT_XML);
+	HandleSettings(me, CONFIG_SETTINGS_XML("22.50", "<HeartBeatKeyframe>3</HeartBeatKeyframe>", ""));
+	CHECK_EQ_INT(3, me->config.heartBeatKeyframe);
+	TakePosted(me, &posted);
+	CHECK_CONTAINS(posted.lastContent[FlowInterfaceCmd_SendMessageToSensor], "<HeartBeatKeyframe>3</HeartBeatKeyframe>");
+
+	//Keyframe has all fields
+	NextHeartBeat(me, &posted, SENSOR_EVENT_XML("30.00", "35.00"));
+	CHECK_CONTAINS(heartBeat, "<type>HeartBeatDelta</type><seq>1</seq><base>1</base><info><Temperature>30.00</Temperature>"
+					"<Humidity>35.00</Humidity><Relay_1>");
+	CHECK_CONTAINS(heartBeat, "<Sensor>ALIVE</Sensor><Actuator>ALIVE</Actuator></info>");
+
+	//Others only what differs from it
+	NextHeartBeat(me, &posted, SENSOR_EVENT_XML("30.00", "35.00"));
+	CHECK_CONTAINS(heartBeat, "<seq>2</seq><base>1</base><info></info>");
+	NextHeartBeat(me, &posted, SENSOR_EVENT_XML("31.00", "35.00"));
+	CHECK_CONTAINS(heartBeat, "<seq>3</seq><base>1</base><info><Temperature>31.00</Temperature></info>");
+
+	NextHeartBeat(me, &posted, SENSOR_EVENT_XML("31.00", "35.00"));
+	CHECK_CONTAINS(heartBeat, "<seq>4</seq><base>4</base><info><Temperature>31.00</Temperature><Humidity>35.00</Humidity>");
+
+	//Config without it keeps delta heartbeats, a new keyframe interval starts with a keyframe
+	HandleSettings(me, SETTINGS_XML("22.50"));
+	CHECK_EQ_INT(3, me->config.heartBeatKeyframe);
+	HandleSettings(me, CONFIG_SETTINGS_XML("22.50", "<HeartBeatKeyframe>10</HeartBeatKeyframe>", ""));
+	TakePosted(me, &posted);
+	NextHeartBeat(me, &posted, SENSOR_EVENT_XML("31.00", "35.00"));
+	CHECK_CONTAINS(heartBeat, "<seq>5</seq><base>5</base>");
+}
+
+static void test_DeltaSensorEventsAreApplied(void)
+{
+	Controller *me;
+
+	NewCaseDirectory();
+	me = StartWithDevices();
+
+	HandleMessage(me, TEST_SENSOR, SENSOR_DELTA_XML("1", "1", "<Temperature>20.00</Temperature><Humidity>50.00</Humidity>"));
+	CHECK_NEAR(20.0, me->sensors[Sensor_Temperature].value, 0.001);
+	CHECK_NEAR(50.0, me->sensors[Sensor_Humidity].value, 0.001);
+
+	//Delta is applied to keyframe, not to previous delta
+	HandleMessage(me, TEST_SENSOR, SENSOR_DELTA_XML("2", "1", "<Humidity>55.00</Humidity>"));
+	CHECK_NEAR(20.0, me->sensors[Sensor_Temperature].value, 0.001);
+	CHECK_NEAR(55.0, me->sensors[Sensor_Humidity].value, 0.001);
+	HandleMessage(me, TEST_SENSOR, SENSOR_DELTA_XML("4", "1", "<Temperature>21.00</Temperature>"));
+	CHECK_NEAR(21.0, me->sensors[Sensor_Temperature].value, 0.001);
+	CHECK_NEAR(50.0, me->sensors[Sensor_Humidity].value, 0.001);
+
+	//Stale event, and one whose keyframe was missed, are not applied
+	HandleMessage(me, TEST_SENSOR, SENSOR_DELTA_XML("3", "1", "<Temperature>25.00</Temperature>"));
+	CHECK_NEAR(21.0, me->sensors[Sensor_Temperature].value, 0.001);
+	HandleMessage(me, TEST_SENSOR, SENSOR_DELTA_XML("9", "8", "<Temperature>25.00</Temperature>"));
+	CHECK_NEAR(21.0, me->sensors[Sensor_Temperature].value, 0.001);
+	CHECK(me->sensorConfig.isAlive);
+
+	//Keyframe is taken even if older, as sensor may have restarted
+	HandleMessage(me, TEST_SENSOR, SENSOR_DELTA_XML("1", "1", "<Temperature>19.00</Temperature><Humidity>40.00</Humidity>"));
+	CHECK_NEAR(19.0, me->sensors[Sensor_Temperature].value, 0.001);
+	CHECK_NEAR(40.0, me->sensors[Sensor_Humidity].value, 0.001);
+}
+
+static void test_CompactEncodingFollowsPeers(void)
+{
+	Controller *me;
+	Posted posted;
+	const char *toSensor = posted.lastContent[FlowInterfaceCmd_SendMessageToSensor];
+	const char *toActuator = posted.lastContent[FlowInterfaceCmd_SendMessageToActuator];
+
+	NewCaseDirectory();
+	me = StartWithDevices();
+	HandleSettings(me, SETTINGS_XML("22.50"));
+	TakePosted(me, &posted);
+	CHECK_CONTAINS(toSensor, "<?xml");
+	CHECK_CONTAINS(toSensor, "<wire>1</wire>");
+
+	//Compact event is applied, and sensor is sent compact messages from then on
+	HandleMessage(me, TEST_SENSOR, "!1(A(ESensor)(F(K20.00)(L40.00)))");
+	CHECK_NEAR(20.0, me->sensors[Sensor_Temperature].value, 0.001);
+	CHECK_NEAR(40.0, me->sensors[Sensor_Humidity].value, 0.001);
+	CHECK_EQ_INT(WireFormat_Compact, me->sensorConfig.wireFormat);
+
+	//Actuator advertises in its heartbeat
+	HandleMessage(me, TEST_ACTUATOR, "<event><type>Actuator</type><wire>1</wire></event>");
+	CHECK_EQ_INT(WireFormat_Compact, me->actuatorConfig.wireFormat);
+	HandleSettings(me, SETTINGS_XML("23.00"));
+	TakePosted(me, &posted);
+	CHECK_CONTAINS(toSensor, "!1(B(D");
+	CHECK_CONTAINS(toSensor, "(FUPDATE_SETTINGS)(H1)(G(S");
+	CHECK_CONTAINS(toActuator, "!1(B(D");
+
+	//User gets XML until it asks otherwise
+	HandleMessage(me, TEST_USER, "<command><info>PING</info><app_time>1</app_time></command>");
+	TakePosted(me, &posted);
+	CHECK_CONTAINS(posted.lastContent[FlowInterfaceCmd_SendMessageToUser], "<app_time>1</app_time><wire>1</wire></response>");
+	HandleMessage(me, TEST_USER, "<command><info>PING</info><app_time>1</app_time><wire>1</wire></command>");
+	TakePosted(me, &posted);
+	CHECK_CONTAINS(posted.lastContent[FlowInterfaceCmd_SendMessageToUser], "(FPING)(Y1)(H1))");
+
+	//Malformed compact messages are dropped
+	HandleMessage(me, TEST_SENSOR, "!1(A(ESensor)(F(K99.00)(L40.00))");
+	CHECK_NEAR(20.0, me->sensors[Sensor_Temperature].value, 0.001);
+
+	//Device going back to XML is sent XML
+	HandleMessage(me, TEST_SENSOR, SENSOR_EVENT_XML("21.00", "40.00"));
+	CHECK_EQ_INT(WireFormat_Xml, me->sensorConfig.wireFormat);
+}
+
+static void test_EventHandlingDoesNotLeak(void)
+{
+	Controller *me;
+	Posted posted;
+	long before;
+	unsigned int i;
+
+	NewCaseDirectory();
+	me = StartWithDevices();
+	HandleSettings(me, SETTINGS_XML("22.50"));
+	TakePosted(me, &posted);
+
+	before = FlowStub_OutstandingAllocations();
+	for (i = 0; i < 100; ++i)
+	{
+		HandleMessage(me, TEST_SENSOR, (i & 1) ? SENSOR_EVENT_XML("18.00", "35.00") : SENSOR_EVENT_XML("30.00", "45.00"));
+		HandleMessage(me, TEST_ACTUATOR, ACTUATOR_EVENT_XML);
+		HandleMessage(me, TEST_USER, "<command><info>PING</info></command>");
+		HandleSettings(me, SETTINGS_XML("22.50"));
+		FlowStub_AdvanceTime(1000);
+		HandlePending(me);
+		TakePosted(me, &posted);
+	}
+
+	//History records are freed by the writer thread
+	for (i = 0; (i < 100) && (FlowStub_OutstandingAllocations() != before); ++i)
+	{
+		usleep(10000);
+	}
+	CHECK_EQ_INT(before, FlowStub_OutstandingAllocations());
+}
+
+int main(void)
+{
+	FlowStub_UseVirtualTime(TEST_EPOCH);
+
+#define RUN_CASE(test) \
+	do \
+	{ \
+		FlowStub_Reset(); \
+		RUN_TEST(test); \
+	} while (0)
+
+	RUN_CASE(test_StartAsksForSettings);
+	RUN_CASE(test_FirstSettingsStartTimersAndPush);
+	RUN_CASE(test_UnchangedSettingsAreNotPushed);
+	RUN_CASE(test_RestartedDevicesGetUnchangedSettings);
+	RUN_CASE(test_RestartedDevicesGetSettingsOnRetrieve);
+	RUN_CASE(test_FailedPushesAreRetried);
+	RUN_CASE(test_CalibrationSettingsArePushed);
+	RUN_CASE(test_FilterSettingsArePushed);
+	RUN_CASE(test_MaxReadIntervalsArePushed);
+	RUN_CASE(test_RestartAppliesCachedSettings);
+	RUN_CASE(test_RestartRestoresHistory);
+	RUN_CASE(test_MissingSettingsAreCreated);
+	RUN_CASE(test_SensorEventSwitchesRelay);
+	RUN_CASE(test_CommandsFromOthersAreIgnored);
+	RUN_CASE(test_DeltaHeartBeatsToUser);
+	RUN_CASE(test_DeltaSensorEventsAreApplied);
+	RUN_CASE(test_CompactEncodingFollowsPeers);
+	RUN_CASE(test_EventHandlingDoesNotLeak);
+
+	RemoveCaseDirectories();
+	return TEST_RESULT();
+}
@@ -0,0 +1,701 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+/**
+ * WiFire firmware's queue wrapper, send thread and HAL on the POSIX
+ * backend of wifire/host, built from the firmware sources as for the host
+ * devices.
+ */
+
+#include <float.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "flow/flowcore.h"
+#include "flow_stub.h"
+#include "adc_scan.h"
+#include "climate_proto.h"
+#include "dht_decoder.h"
+#include "ntc_table.h"
+#include "queue_wrapper.h"
+#include "sample_buffer.h"
+#include "sample_schedule.h"
+#include "sensor_calibration.h"
+#include "sensor_filter.h"
+#include "send_message.h"
+#include "relay.h"
+#include "sensor_adc.h"
+#include "sensor_dht.h"
+#include "sensor_thermistor.h"
+#include "peripheral/ports/plib_ports.h"
+#include "wifire_sim.h"
+#include "test.h"
+
+static double NowMs(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000.0 + now.tv_nsec / 1e6;
+}
+
+static void test_QueueCopiesInOrderAndBounds(void)
+{
+	QueueHandle queue = QueueCreate(2, sizeof(int));
+	int value = 1;
+	double start;
+
+	CHECK(queue);
+	CHECK(QueueSend(queue, &value));
+	value = 2;
+	CHECK(QueueSend(queue, &value));
+	value = 3;
+	CHECK(!QueueSend(queue, &value));	//Full, returns at once
+	CHECK_EQ_INT(2, QueueNumOfItems(queue));
+
+	CHECK(QueueReceive(queue, &value, 0));
+	CHECK_EQ_INT(1, value);
+	CHECK(QueueReceive(queue, &value, 0));
+	CHECK_EQ_INT(2, value);
+
+	start = NowMs();
+	CHECK(!QueueReceive(queue, &value, 20));
+	CHECK(NowMs() - start >= 19.0);
+	CHECK_EQ_INT(0, QueueNumOfItems(queue));
+	QueueDelete(queue);
+}
+
+static void *DelayedSend(void *context)
+{
+	int value = 42;
+
+	usleep(20000);
+	QueueSend(context, &value);
+	return NULL;
+}
+
+static void test_QueueReceiveWaitsForSender(void)
+{
+	QueueHandle queue = QueueCreate(1, sizeof(int));
+	pthread_t sender;
+	int value = 0;
+
+	pthread_create(&sender, NULL, DelayedSend, queue);
+	CHECK(QueueReceive(queue, &value, -1));
+	CHECK_EQ_INT(42, value);
+	pthread_join(sender, NULL);
+	QueueDelete(queue);
+}
+
+static void test_SampleBufferOverwritesOldest(void)
+{
+	StoredSample sample, samples[4];
+	unsigned int i;
+	char *xml;
+
+	CHECK(SampleBuffer_Init());
+	SampleBuffer_MakeSample(&sample, 1000, 21.5f, 40.25f);
+	CHECK_EQ_INT(1000, sample.time);
+	CHECK_EQ_INT(2150, sample.temperature);
+	CHECK_EQ_INT(4025, sample.humidity);
+	SampleBuffer_MakeSample(&sample, 1000, -0.5f, 900.0f);
+	CHECK_EQ_INT(-50, sample.temperature);
+	CHECK_EQ_INT(CLIMATE_PROTO_NO_HUMIDITY, sample.humidity);
+
+	for (i = 0; i < SAMPLE_BUFFER_SIZE + 2; ++i)
+	{
+		SampleBuffer_MakeSample(&sample, 1000 + i, 20.0f, 50.0f);
+		SampleBuffer_Push(&sample);
+	}
+	CHECK_EQ_INT(SAMPLE_BUFFER_SIZE, SampleBuffer_Count());
+	CHECK_EQ_INT(2, SampleBuffer_Overwritten());
+	CHECK_EQ_INT(2, SampleBuffer_Peek(samples, 2));
+	CHECK_EQ_INT(1002, samples[0].time);
+	CHECK_EQ_INT(1003, samples[1].time);
+	SampleBuffer_Drop(SAMPLE_BUFFER_SIZE - 1);
+	CHECK_EQ_INT(1, SampleBuffer_Peek(samples, 4));
+	CHECK_EQ_INT(1000 + SAMPLE_BUFFER_SIZE + 1, samples[0].time);
+	SampleBuffer_Drop(2);
+	CHECK_EQ_INT(0, SampleBuffer_Count());
+
+	//Samples peeked but overwritten before the drop are not dropped twice
+	for (i = 0; i < SAMPLE_BUFFER_SIZE; ++i)
+	{
+		SampleBuffer_MakeSample(&sample, 2000 + i, 20.0f, 50.0f);
+		SampleBuffer_Push(&sample);
+	}
+	CHECK_EQ_INT(2, SampleBuffer_Peek(samples, 2));
+	SampleBuffer_Push(&sample);
+	SampleBuffer_Drop(2);
+	CHECK_EQ_INT(SAMPLE_BUFFER_SIZE - 1, SampleBuffer_Count());
+	CHECK_EQ_INT(1, SampleBuffer_Peek(samples, 1));
+	CHECK_EQ_INT(2002, samples[0].time);
+	SampleBuffer_Drop(SAMPLE_BUFFER_SIZE);
+	CHECK_EQ_INT(0, SampleBuffer_Count());
+
+	SampleBuffer_MakeSample(&samples[0], 1000, 21.5f, 40.0f);
+	SampleBuffer_MakeSample(&samples[1], 1060, -3.0f, -1.0f);
+	xml = SampleBuffer_CreateLogXML(samples, 2, 0);
+	CHECK(xml);
+	CHECK(strcmp(xml, "<?xml version=\"1.0\" encoding=\"UTF-8\"?><event>"
+						"<time type=\"datetime\">1970-01-01T00:00:00Z</time><type>SensorLog</type>"
+						"<count>2</count><samples>1000,2150,4000;1060,-300,65535</samples></event>") == 0);
+	Flow_MemFree((void**)&xml);
+}
+
+//Reading in 1/256 of its unit, as drivers give them
+#define READING(value) ((int32_t)((value) * (1 << SENSOR_CALIBRATION_READING_BITS)))
+
+static void test_SensorFilterDropsSpikesAndSmooths(void)
+{
+	SensorFilter filter = { 0 };
+	const int32_t spiky[] = { READING(20), READING(20), READING(35), READING(20), READING(5), READING(20) };
+	unsigned int i;
+
+	//Zeroed filter passes readings through
+	CHECK_EQ_INT(READING(35), SensorFilter_Apply(&filter, READING(35)));
+	CHECK_EQ_INT(READING(5), SensorFilter_Apply(&filter, READING(5)));
+
+	CHECK(!SensorFilter_Configure(&filter, SENSOR_FILTER_MAX_MEDIAN_SIZE + 1, SENSOR_FILTER_ALPHA_ONE));
+	CHECK(!SensorFilter_Configure(&filter, 3, 0));
+	CHECK(!SensorFilter_Configure(&filter, 3, SENSOR_FILTER_ALPHA_ONE + 1));
+
+	//Single reading spikes do not get through a median of 3
+	CHECK(SensorFilter_Configure(&filter, 3, SENSOR_FILTER_ALPHA_ONE));
+	for (i = 0; i < sizeof(spiky) / sizeof(spiky[0]); ++i)
+	{
+		CHECK_EQ_INT(READING(20), SensorFilter_Apply(&filter, spiky[i]));
+	}
+
+	//Average moves alpha of the way to each new reading, starting at the first
+	CHECK(SensorFilter_Configure(&filter, 1, SENSOR_FILTER_ALPHA_ONE / 2));
+	CHECK_EQ_INT(READING(20), SensorFilter_Apply(&filter, READING(20)));
+	CHECK_EQ_INT(READING(22), SensorFilter_Apply(&filter, READING(24)));
+	CHECK_EQ_INT(READING(23), SensorFilter_Apply(&filter, READING(24)));
+
+	//Rounded to nearest, so that it settles as close from below as from above
+	CHECK(SensorFilter_Configure(&filter, 1, SENSOR_FILTER_ALPHA_ONE / 8));
+	SensorFilter_Apply(&filter, READING(20));
+	for (i = 0; i < 100; ++i)
+	{
+		SensorFilter_Apply(&filter, READING(21));
+	}
+	CHECK(READING(21) - SensorFilter_Apply(&filter, READING(21)) <= 4);
+	for (i = 0; i < 100; ++i)
+	{
+		SensorFilter_Apply(&filter, READING(20));
+	}
+	CHECK(SensorFilter_Apply(&filter, READING(20)) - READING(20) <= 4);
+}
+
+static void test_SampleScheduleBacksOffWhileSteady(void)
+{
+	SampleSchedule schedule;
+	unsigned int now = 1000;
+
+	SampleSchedule_Reset(&schedule, 500, now);
+	CHECK_EQ_INT(500, SampleSchedule_TimeToDue(&schedule, now));
+
+	//Interval doubles per steady reading, up to the maximum
+	SampleSchedule_Update(&schedule, 20.0f, 0.5f, 500, 4000, now);
+	CHECK_EQ_INT(500, schedule.interval);
+	SampleSchedule_Update(&schedule, 20.0f, 0.5f, 500, 4000, now);
+	CHECK_EQ_INT(1000, schedule.interval);
+	SampleSchedule_Update(&schedule, 20.05f, 0.5f, 500, 4000, now);
+	CHECK_EQ_INT(2000, schedule.interval);
+	SampleSchedule_Update(&schedule, 20.0f, 0.5f, 500, 4000, now);
+	SampleSchedule_Update(&schedule, 20.0f, 0.5f, 500, 4000, now);
+	CHECK_EQ_INT(4000, schedule.interval);
+	CHECK_EQ_INT(4000, SampleSchedule_TimeToDue(&schedule, now));
+	CHECK_EQ_INT(0, SampleSchedule_TimeToDue(&schedule, now + 5000));
+
+	//A move of a fraction of the read delta drops back to the minimum
+	SampleSchedule_Update(&schedule, 20.3f, 0.5f, 500, 4000, now);
+	CHECK_EQ_INT(500, schedule.interval);
+
+	//No back off without a maximum above the minimum
+	SampleSchedule_Reset(&schedule, 500, now);
+	SampleSchedule_Update(&schedule, 20.0f, 0.5f, 500, 0, now);
+	SampleSchedule_Update(&schedule, 20.0f, 0.5f, 500, 0, now);
+	CHECK_EQ_INT(500, schedule.interval);
+}
+
+static void test_DhtDecoderDecodesNoisyWaveforms(void)
+{
+	const uint8_t reply[DHT_DECODER_NUM_BYTES] = { 55, 0, 30, 0, 85 };
+	const uint8_t corrupt[DHT_DECODER_NUM_BYTES] = { 55, 0, 30, 0, 84 };
+	uint32_t edges[DHT_DECODER_MAX_EDGES];
+	uint8_t bytes[DHT_DECODER_NUM_BYTES];
+	unsigned int count;
+	unsigned int seed = 1;
+	unsigned int i;
+
+	count = WifireSim_MakeDhtWaveform(reply, 0, 0, &seed, edges, DHT_DECODER_MAX_EDGES);
+	CHECK_EQ_INT(DHT_DECODER_NUM_EDGES + 1, count);
+	CHECK(DhtDecoder_Decode(edges, count, bytes));
+	CHECK(memcmp(reply, bytes, sizeof(reply)) == 0);
+
+	//Jittered pulses and glitches within them
+	for (seed = 1; seed <= 20; ++seed)
+	{
+		unsigned int glitchSeed = seed;
+
+		count = WifireSim_MakeDhtWaveform(reply, 8, 10, &glitchSeed, edges, DHT_DECODER_MAX_EDGES);
+		CHECK(count > DHT_DECODER_NUM_EDGES + 1);
+		memset(bytes, 0, sizeof(bytes));
+		CHECK(DhtDecoder_Decode(edges, count, bytes));
+		CHECK(memcmp(reply, bytes, sizeof(reply)) == 0);
+	}
+
+	count = WifireSim_MakeDhtWaveform(corrupt, 0, 0, &seed, edges, DHT_DECODER_MAX_EDGES);
+	CHECK(!DhtDecoder_Decode(edges, count, bytes));
+
+	//Reply cut short, and a bit's high held past the datasheet's timing
+	count = WifireSim_MakeDhtWaveform(reply, 0, 0, &seed, edges, DHT_DECODER_MAX_EDGES);
+	CHECK(!DhtDecoder_Decode(edges, DHT_DECODER_NUM_EDGES - 1, bytes));
+	CHECK(!DhtDecoder_Decode(edges, 0, bytes));
+	for (i = 10; i < count; ++i)
+	{
+		edges[i] += 200;
+	}
+	CHECK(!DhtDecoder_Decode(edges, count, bytes));
+}
+
+static void test_DhtReadsOnSimulatedBoard(void)
+{
+	unsigned int transactions = WifireSim_GetDhtTransactions();
+	int32_t humidity = 0;
+	int32_t temperature = 0;
+
+	WifireSim_SetDhtReading(60, 25, 5, 5);
+	CHECK(Sensor_DHT_ReadHumidityAndTemperature(&humidity, &temperature));
+	CHECK_EQ_INT(READING(60), humidity);
+	CHECK_EQ_INT(READING(25), temperature);
+	CHECK_EQ_INT(1, WifireSim_GetDhtTransactions() - transactions);
+
+	//Decoded, but out of the DHT11's range
+	WifireSim_SetDhtReading(95, 25, 0, 0);
+	CHECK(!Sensor_DHT_ReadHumidity(&humidity));
+	CHECK_EQ_INT(READING(60), humidity);
+	WifireSim_SetDhtReading(45, 21, 0, 0);
+}
+
+#define TEST_CONTROLLER "controller"
+#define EVENT_XML(seq) CLIMATE_PROTO_DECLARATION "<event><seq>" #seq "</seq></event>"
+#define CLIMATE_PROTO_DECLARATION "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+
+static void QueueMessages(QueueHandle queue, const char *first, const char *second, const char *third)
+{
+	const char *details[] = { first, second, third };
+	unsigned int i;
+
+	for (i = 0; (i < 3) && details[i]; ++i)
+	{
+		MeasurementMsg msg = { FlowString_Duplicate(TEST_CONTROLLER), FlowString_Duplicate(details[i]) };
+
+		QueueSend(queue, &msg);
+	}
+	//Past the batch window
+	usleep((SEND_BATCH_WINDOW + 100) * 1000);
+}
+
+static bool PopSent(char *content, size_t size)
+{
+	FlowStubMessage message;
+
+	if (!FlowStub_PopSentMessage(&message))
+	{
+		return false;
+	}
+	snprintf(content, size, "%s", (strcmp(message.to, TEST_CONTROLLER) == 0) ? message.content : "");
+	free(message.content);
+	return true;
+}
+
+/**
+ * Send thread's state is global, so all tests share one thread
+ */
+static QueueHandle SendThreadQueue(void)
+{
+	static QueueHandle queue;
+
+	if (!queue && SendMessage_Init())
+	{
+		queue = QueueCreate(SEND_MESSAGE_QUEUE_SIZE, sizeof(MeasurementMsg));
+		FlowThread_New("SendMessageThread", 1, 4096, SendMessageThread, queue);
+	}
+	return queue;
+}
+
+static void test_SendThreadBatchesCloseMessages(void)
+{
+	QueueHandle queue = SendThreadQueue();
+	SendMessageStats stats;
+	char content[512];
+
+	//Merged, without their own XML declarations or compact prefixes
+	SendMessage_SetBatchMode(SendBatch_Merge);
+	QueueMessages(queue, EVENT_XML(1), EVENT_XML(2), EVENT_XML(3));
+	CHECK(PopSent(content, sizeof(content)));
+	CHECK(strcmp(content, CLIMATE_PROTO_DECLARATION "<events><event><seq>1</seq></event>"
+							"<event><seq>2</seq></event><event><seq>3</seq></event></events>") == 0);
+	CHECK(!PopSent(content, sizeof(content)));
+	QueueMessages(queue, "!1(A(D1))", "!1(A(D2))", NULL);
+	CHECK(PopSent(content, sizeof(content)));
+	CHECK(strcmp(content, "!1('events'(A(D1))(A(D2)))") == 0);
+
+	//Encodings are not mixed
+	QueueMessages(queue, EVENT_XML(4), "!1(A(D5))", NULL);
+	CHECK(PopSent(content, sizeof(content)));
+	CHECK(strcmp(content, EVENT_XML(4)) == 0);
+	CHECK(PopSent(content, sizeof(content)));
+	CHECK(strcmp(content, "!1(A(D5))") == 0);
+
+	SendMessage_SetBatchMode(SendBatch_Latest);
+	QueueMessages(queue, EVENT_XML(6), EVENT_XML(7), NULL);
+	CHECK(PopSent(content, sizeof(content)));
+	CHECK(strcmp(content, EVENT_XML(7)) == 0);
+	CHECK(!PopSent(content, sizeof(content)));
+
+	SendMessage_SetBatchMode(SendBatch_Off);
+	QueueMessages(queue, EVENT_XML(8), EVENT_XML(9), NULL);
+	CHECK(PopSent(content, sizeof(content)));
+	CHECK(strcmp(content, EVENT_XML(8)) == 0);
+	CHECK(PopSent(content, sizeof(content)));
+	CHECK(strcmp(content, EVENT_XML(9)) == 0);
+
+	SendMessage_GetStats(&stats);
+	CHECK_EQ_INT(11, stats.queued);
+	CHECK_EQ_INT(7, stats.sent);
+	CHECK_EQ_INT(5, stats.merged);
+	CHECK_EQ_INT(1, stats.superseded);
+	CHECK_EQ_INT(0, stats.failed);
+	CHECK(stats.queueHighWater >= 1);
+}
+
+static void QueueSample(QueueHandle queue, time_t time, const char *details)
+{
+	MeasurementMsg msg = { FlowString_Duplicate(TEST_CONTROLLER), FlowString_Duplicate(details) };
+
+	SampleBuffer_MakeSample(&msg.sample, time, 21.5f, 40.0f);
+	//More than the queue holds are sent, as fast as the send thread takes them
+	while (!QueueSend(queue, &msg))
+	{
+		usleep(1000);
+	}
+}
+
+static bool WaitSent(char *content, size_t size, unsigned int timeout)
+{
+	double start = NowMs();
+
+	while (!PopSent(content, size))
+	{
+		if (NowMs() - start > timeout)
+		{
+			return false;
+		}
+		usleep(10000);
+	}
+	return true;
+}
+
+static void test_SendThreadStoresSamplesWhileOffline(void)
+{
+	QueueHandle queue = SendThreadQueue();
+	SendMessageStats stats;
+	char content[1024];
+	unsigned int i;
+
+	SendMessage_SetBatchMode(SendBatch_Off);
+	FlowStub_SetOnline(false);
+	for (i = 0; i < SAMPLE_UPLOAD_BATCH + 4; ++i)
+	{
+		QueueSample(queue, 1000 + i, EVENT_XML(1));
+	}
+	usleep(100000);
+	CHECK(!PopSent(content, sizeof(content)));
+	SendMessage_GetStats(&stats);
+	CHECK(stats.isOffline);
+	CHECK_EQ_INT(SAMPLE_UPLOAD_BATCH + 4, stats.stored);
+	//Only the first message was tried
+	CHECK_EQ_INT(1, stats.failed);
+
+	//Uploaded oldest first once a retry is due, a batch at a time
+	FlowStub_SetOnline(true);
+	CHECK(WaitSent(content, sizeof(content), SAMPLE_RETRY_INTERVAL + SAMPLE_UPLOAD_INTERVAL + 500));
+	CHECK_CONTAINS(content, "<type>SensorLog</type><count>16</count><samples>1000,2150,4000;1001,");
+
+	//Live messages are not held up by the rest of the backlog
+	QueueMessages(queue, EVENT_XML(2), NULL, NULL);
+	CHECK(PopSent(content, sizeof(content)));
+	CHECK(strcmp(content, EVENT_XML(2)) == 0);
+
+	CHECK(WaitSent(content, sizeof(content), SAMPLE_UPLOAD_INTERVAL + 500));
+	CHECK_CONTAINS(content, "<count>4</count><samples>1016,2150,4000;");
+	SendMessage_GetStats(&stats);
+	CHECK(!stats.isOffline);
+	CHECK_EQ_INT(SAMPLE_UPLOAD_BATCH + 4, stats.uploaded);
+	CHECK_EQ_INT(0, stats.lost);
+	CHECK_EQ_INT(0, SampleBuffer_Count());
+}
+
+/*
+ * The sensor keeps the sample of a measurement it could not queue, from
+ * its own thread, and the send thread uploads it once it catches up
+ */
+static void test_SendThreadUploadsSamplesKeptOnFullQueue(void)
+{
+	QueueHandle queue = SendThreadQueue();
+	char deviceId[] = TEST_CONTROLLER;
+	MeasurementMsg msg = { deviceId, NULL };
+	SendMessageStats before, stats;
+	char content[1024];
+	unsigned int i;
+
+	SendMessage_SetBatchMode(SendBatch_Off);
+	SendMessage_GetStats(&before);
+	for (i = 0; i < 3; ++i)
+	{
+		SampleBuffer_MakeSample(&msg.sample, 2000 + i, 21.5f, 40.0f);
+		SendMessage_KeepSample(&msg);
+	}
+	QueueMessages(queue, EVENT_XML(3), NULL, NULL);
+	CHECK(PopSent(content, sizeof(content)));
+	CHECK(strcmp(content, EVENT_XML(3)) == 0);
+
+	CHECK(WaitSent(content, sizeof(content), SAMPLE_UPLOAD_INTERVAL + 500));
+	CHECK_CONTAINS(content, "<count>3</count><samples>2000,2150,4000;2001,2150,4000;2002,2150,4000</samples>");
+	SendMessage_GetStats(&stats);
+	CHECK_EQ_INT(3, stats.stored - before.stored);
+	CHECK_EQ_INT(3, stats.uploaded - before.uploaded);
+	CHECK_EQ_INT(0, SampleBuffer_Count());
+}
+
+/*
+ * RMS error of count latest values of port from input, -1 if port has none
+ */
+static double ScanError(int port, unsigned int input, unsigned int count)
+{
+	double sum = 0.0;
+	unsigned int value = 0;
+	unsigned int i;
+
+	for (i = 0; i < count; ++i)
+	{
+		if (!AdcScan_Latest(port, &value))
+		{
+			return -1.0;
+		}
+		sum += ((double)value - input) * ((double)value - input);
+	}
+	return sqrt(sum / count);
+}
+
+static void test_AdcScanAveragesWithoutBlocking(void)
+{
+	unsigned int value = 0;
+	double single, averaged;
+	int port;
+
+	WifireSim_SetAnalogInput(2000, 0, 7);
+	AdcScan_Init();
+	CHECK(!AdcScan_AddChannel(2, 3));
+	CHECK(!AdcScan_AddChannel(2, 2 * ADC_SCAN_MAX_OVERSAMPLING));
+	CHECK(AdcScan_AddChannel(2, 16));
+	CHECK(AdcScan_AddChannel(3, 1));
+	CHECK(!AdcScan_Latest(2, &value));
+	AdcScan_Start();
+	CHECK(!AdcScan_AddChannel(4, 16));
+	CHECK(!AdcScan_Latest(4, &value));
+	CHECK(AdcScan_Latest(2, &value));
+	CHECK_EQ_INT(2000, value);
+
+	//Averaging 16 conversions takes a quarter of the noise
+	WifireSim_SetAnalogNoise(40);
+	single = ScanError(3, 2000, 400);
+	averaged = ScanError(2, 2000, 400);
+	CHECK(single > 15.0);
+	CHECK((averaged >= 0.0) && (averaged < single / 3));
+
+	//Inputs beyond the ADC's filters give single conversions
+	AdcScan_Init();
+	for (port = 0; port < ADC_SCAN_MAX_CHANNELS; ++port)
+	{
+		CHECK(AdcScan_AddChannel(port, 16));
+	}
+	CHECK(!AdcScan_AddChannel(port, 16));
+	AdcScan_Start();
+	CHECK(ScanError(ADC_SCAN_MAX_CHANNELS - 1, 2000, 400) > averaged * 2);
+	WifireSim_SetAnalogNoise(0);
+}
+
+/*
+ * The thermistor's datasheet formula, in double, that its table stands in for
+ */
+static double ThermistorFormula(unsigned int adcValue)
+{
+	double resistance = (4096.0 - adcValue) * 100000.0 / adcValue;
+
+	return 1.0 / (log(resistance / 100000.0) / 4200.0 + 1.0 / 298.15) - 273.15;
+}
+
+static void test_ThermistorTableMatchesFormula(void)
+{
+	double ratedError = 0.0, extendedError = 0.0;
+	double temperature, last = -FLT_MAX;
+	bool isRising = true;
+	unsigned int code;
+	int32_t reading;
+
+	CHECK(!Sensor_Thermistor_Convert(0, &reading));
+	for (code = 1; code < (1 << NTC_TABLE_CODE_BITS); ++code)
+	{
+		double exact = ThermistorFormula(code);
+		double error;
+
+		CHECK(Sensor_Thermistor_Convert(code, &reading));
+		temperature = reading / 256.0;
+		error = fabs(temperature - exact);
+		isRising = isRising && (temperature >= last);
+		last = temperature;
+		//The part's rated range, then beyond it, where the curve gets steeper
+		if ((exact >= -40.0) && (exact <= 125.0) && (error > ratedError))
+		{
+			ratedError = error;
+		}
+		if ((exact >= -50.0) && (exact <= 150.0) && (error > extendedError))
+		{
+			extendedError = error;
+		}
+	}
+	CHECK(isRising);
+	CHECK(ratedError < 0.125);
+	CHECK(extendedError < 0.35);
+
+	//Codes past 12 bits read as the largest
+	CHECK(Sensor_Thermistor_Convert(1 << NTC_TABLE_CODE_BITS, &reading));
+	CHECK_NEAR(last, reading / 256.0, 0.001);
+
+	//Half scale is R0, so 25 C, on the simulated board
+	WifireSim_SetAnalogInput(WIFIRE_SIM_ADC_MAX / 2 + 1, 0, 1);
+	Sensor_Thermistor_Init();
+	CHECK(Sensor_Thermistor_ReadTemperature(&reading));
+	CHECK_NEAR(25.0, reading / 256.0, 0.01);
+}
+
+/*
+ * What a reading costs is measured by micro_bench, as firmware/sensor_calibration
+ */
+static void test_SensorCalibrationIsAccurate(void)
+{
+	//Offset -0.5, gain 1.01, curve 0.0002, as the controller sends them
+	const SensorCalibration none = SENSOR_CALIBRATION_NONE;
+	const SensorCalibration calibration = { .offset = -128, .gain = 66191, .curve = 3355 };
+	const double offset = -128 / 256.0, gain = 66191 / 65536.0, curve = 3355 / 16777216.0;
+	double maxError = 0.0;
+	int32_t reading;
+	int i;
+
+	//No correction leaves every reading as it is
+	for (reading = -100 * 256; reading <= 200 * 256; reading += 7)
+	{
+		if (SensorCalibration_Apply(&none, reading) != reading)
+		{
+			break;
+		}
+	}
+	CHECK(reading > 200 * 256);
+
+	//Within a rounding of the fixed point, over -40 to 125
+	for (i = -4000; i <= 12500; ++i)
+	{
+		double x = i / 100.0;
+		double error = fabs(SensorCalibration_ApplyFloat(&calibration, (float)x) - (offset + gain * x + curve * x * x));
+
+		if (error > maxError)
+		{
+			maxError = error;
+		}
+	}
+	CHECK(maxError < 2.0 / 256);
+}
+
+static void test_HalRunsOnSimulatedBoard(void)
+{
+	int32_t temperature, humidity;
+	unsigned int reads = WifireSim_GetAnalogReads();
+	unsigned int writes;
+
+	//Potentiometer at full scale, not drifting
+	WifireSim_SetAnalogInput(WIFIRE_SIM_ADC_MAX, 0, 1);
+	Sensor_ADC_Init();
+	CHECK(Sensor_ADC_ReadHumidityAndTemperature(&humidity, &temperature));
+	CHECK_NEAR(24.5, temperature / 256.0, 0.01);
+	CHECK_NEAR(99.0, humidity / 256.0, 0.01);
+	//Each read takes the latest average of the scan
+	CHECK_EQ_INT(2 * 16, WifireSim_GetAnalogReads() - reads);
+
+	Relay_Init();
+	writes = WifireSim_GetPinWrites();
+	Relay_Set(0, true);
+	Relay_Set(1, false);
+	Relay_Set(2, true);	//No such relay
+	CHECK(WifireSim_GetPin(PORT_CHANNEL_E, PORTS_BIT_POS_8));
+	CHECK(!WifireSim_GetPin(PORT_CHANNEL_D, PORTS_BIT_POS_0));
+	CHECK_EQ_INT(2, WifireSim_GetPinWrites() - writes);
+}
+
+int main(void)
+{
+	RUN_TEST(test_QueueCopiesInOrderAndBounds);
+	RUN_TEST(test_QueueReceiveWaitsForSender);
+	RUN_TEST(test_SampleBufferOverwritesOldest);
+	RUN_TEST(test_SensorFilterDropsSpikesAndSmooths);
+	RUN_TEST(test_SampleScheduleBacksOffWhileSteady);
+	RUN_TEST(test_DhtDecoderDecodesNoisyWaveforms);
+	RUN_TEST(test_DhtReadsOnSimulatedBoard);
+	RUN_TEST(test_SendThreadBatchesCloseMessages);
+	RUN_TEST(test_SendThreadStoresSamplesWhileOffline);
+	RUN_TEST(test_SendThreadUploadsSamplesKeptOnFullQueue);
+	RUN_TEST(test_AdcScanAveragesWithoutBlocking);
+	RUN_TEST(test_ThermistorTableMatchesFormula);
+	RUN_TEST(test_SensorCalibrationIsAccurate);
+	RUN_TEST(test_HalRunsOnSimulatedBoard);
+	return TEST_RESULT();
+}
@@ -0,0 +1,249 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "history_store.h"
+#include "test.h"
+
+#define START (1500000000)
+#define BLOCKS_PER_SEGMENT (4)
+#define MAX_SEGMENTS (3)
+
+typedef struct
+{
+	uint64_t count;
+	uint32_t first;
+	uint32_t last;
+	bool isOrdered;
+}ScanResult;
+
+static HistoryStore _store;
+
+static bool CountRecord(const HistoryRecord *record, void *context)
+{
+	ScanResult *result = context;
+
+	if (result->count == 0)
+	{
+		result->first = record->time;
+	}
+	else if (record->time < result->last)
+	{
+		result->isOrdered = false;
+	}
+	result->last = record->time;
+	result->count++;
+	return true;
+}
+
+static ScanResult Scan(uint32_t from, uint32_t to)
+{
+	ScanResult result = { 0, 0, 0, true };
+
+	HistoryStore_Scan(&_store, from, to, CountRecord, &result);
+	return result;
+}
+
+static bool Append(uint32_t time)
+{
+	HistoryRecord record = { time, 0, 1, 2150, 4000 };
+
+	return HistoryStore_Append(&_store, &record);
+}
+
+static void test_AppendAndScan(void)
+{
+	ScanResult result;
+	uint32_t i;
+
+	CHECK(HistoryStore_Open(&_store, "append", BLOCKS_PER_SEGMENT, MAX_SEGMENTS));
+	for (i = 0; i < 1000; ++i)
+	{
+		CHECK(Append(START + i));
+	}
+
+	result = Scan(START + 100, START + 199);
+	CHECK_EQ_INT(100, result.count);
+	CHECK_EQ_INT(START + 100, result.first);
+	CHECK_EQ_INT(START + 199, result.last);
+	CHECK(result.isOrdered);
+	HistoryStore_Close(&_store);
+}
+
+static void test_RecordsSurviveReopen(void)
+{
+	ScanResult result;
+	uint32_t i;
+
+	CHECK(HistoryStore_Open(&_store, "reopen", BLOCKS_PER_SEGMENT, MAX_SEGMENTS));
+	for (i = 0; i < 500; ++i)
+	{
+		CHECK(Append(START + i));
+	}
+	HistoryStore_Close(&_store);
+
+	CHECK(HistoryStore_Open(&_store, "reopen", BLOCKS_PER_SEGMENT, MAX_SEGMENTS));
+	result = Scan(0, UINT32_MAX);
+	CHECK_EQ_INT(500, result.count);
+
+	//Appending carries on after the recovered tail
+	CHECK(Append(START + 500));
+	result = Scan(0, UINT32_MAX);
+	CHECK_EQ_INT(501, result.count);
+	CHECK_EQ_INT(START + 500, result.last);
+	HistoryStore_Close(&_store);
+}
+
+static void test_OldestSegmentsAreDropped(void)
+{
+	ScanResult result;
+	uint32_t capacity = BLOCKS_PER_SEGMENT * HISTORY_BLOCK_RECORDS * MAX_SEGMENTS;
+	uint32_t i;
+
+	CHECK(HistoryStore_Open(&_store, "rotate", BLOCKS_PER_SEGMENT, MAX_SEGMENTS));
+	for (i = 0; i < 2 * capacity; ++i)
+	{
+		CHECK(Append(START + i));
+	}
+
+	result = Scan(0, UINT32_MAX);
+	CHECK(result.count <= capacity);
+	CHECK(result.count > 0);
+	CHECK(result.first > START);
+	CHECK_EQ_INT(START + 2 * capacity - 1, result.last);
+	CHECK(result.isOrdered);
+	HistoryStore_Close(&_store);
+}
+
+static void test_ClockSteppingBackKeepsRecords(void)
+{
+	HistoryStore recovered;
+	ScanResult result = { 0, 0, 0, true };
+	uint32_t i;
+
+	CHECK(HistoryStore_Open(&_store, "stepback", BLOCKS_PER_SEGMENT, MAX_SEGMENTS));
+	for (i = 0; i < 500; ++i)
+	{
+		CHECK(Append(START + i));
+	}
+	for (i = 0; i < 300; ++i)
+	{
+		CHECK(Append(START - 1000 + i));
+	}
+
+	//Opened again without a sync, as after a crash
+	CHECK(HistoryStore_Open(&recovered, "stepback", BLOCKS_PER_SEGMENT, MAX_SEGMENTS));
+	CHECK_EQ_INT(800, HistoryStore_Scan(&recovered, 0, UINT32_MAX, CountRecord, &result));
+	result = (ScanResult){ 0, 0, 0, true };
+	HistoryStore_Scan(&recovered, START - 1000, START - 901, CountRecord, &result);
+	CHECK_EQ_INT(100, result.count);
+	CHECK_EQ_INT(START - 1000, result.first);
+	result = (ScanResult){ 0, 0, 0, true };
+	HistoryStore_Scan(&recovered, START + 400, START + 499, CountRecord, &result);
+	CHECK_EQ_INT(100, result.count);
+	HistoryStore_Close(&recovered);
+	HistoryStore_Close(&_store);
+}
+
+static void test_ClockSteppingBackAcrossSegments(void)
+{
+	ScanResult result;
+	uint32_t perSegment = BLOCKS_PER_SEGMENT * HISTORY_BLOCK_RECORDS;
+	uint32_t i;
+
+	CHECK(HistoryStore_Open(&_store, "stepsegment", BLOCKS_PER_SEGMENT, MAX_SEGMENTS));
+	for (i = 0; i < perSegment; ++i)
+	{
+		CHECK(Append(START + i));
+	}
+	for (i = 0; i < 100; ++i)
+	{
+		CHECK(Append(START - 1000 + i));
+	}
+
+	//Range ends early in the first segment, and covers all of the second
+	result = Scan(START - 1000, START + 9);
+	CHECK_EQ_INT(110, result.count);
+	CHECK_EQ_INT(START, result.first);
+	CHECK_EQ_INT(START - 901, result.last);
+	HistoryStore_Close(&_store);
+}
+
+static void test_UncommittedFullBlocksAreScanned(void)
+{
+	HistoryBlockHeader lost;
+	ScanResult result;
+	uint32_t total = BLOCKS_PER_SEGMENT * HISTORY_BLOCK_RECORDS + 100;
+	FILE *segment;
+	uint32_t i;
+
+	CHECK(HistoryStore_Open(&_store, "uncommitted", BLOCKS_PER_SEGMENT, MAX_SEGMENTS));
+	for (i = 0; i < total; ++i)
+	{
+		CHECK(Append(START + i));
+	}
+	HistoryStore_Close(&_store);
+
+	//Header of a full block in the middle of the first segment never reached storage
+	memset(&lost, 0, sizeof(lost));
+	segment = fopen("uncommitted/history-00000001.seg", "r+b");
+	CHECK(segment != NULL);
+	if (segment)
+	{
+		CHECK(fseek(segment, 2 * HISTORY_STORE_PAGE_SIZE, SEEK_SET) == 0);
+		CHECK(fwrite(&lost, sizeof(lost), 1, segment) == 1);
+		fclose(segment);
+	}
+
+	CHECK(HistoryStore_Open(&_store, "uncommitted", BLOCKS_PER_SEGMENT, MAX_SEGMENTS));
+	result = Scan(0, UINT32_MAX);
+	CHECK_EQ_INT(total, result.count);
+	CHECK(result.isOrdered);
+	result = Scan(START + HISTORY_BLOCK_RECORDS, START + 2 * HISTORY_BLOCK_RECORDS - 1);
+	CHECK_EQ_INT(HISTORY_BLOCK_RECORDS, result.count);
+	HistoryStore_Close(&_store);
+}
+
+int main(void)
+{
+	RUN_TEST(test_AppendAndScan);
+	RUN_TEST(test_RecordsSurviveReopen);
+	RUN_TEST(test_OldestSegmentsAreDropped);
+	RUN_TEST(test_ClockSteppingBackKeepsRecords);
+	RUN_TEST(test_ClockSteppingBackAcrossSegments);
+	RUN_TEST(test_UncommittedFullBlocksAreScanned);
+	return TEST_RESULT();
+}
@@ -0,0 +1,286 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include "flow/flowcore.h"
+#include "controller.h"
+#include "construct_message.h"
+#include "message_template.h"
+#include "controller_stats.h"
+#include "flow_stub.h"
+#include "test.h"
+
+/**
+ * Pre-rendered messages to user must read back as the formatted ones:
+ * same elements and values, differing only in whitespace between
+ * elements. Cached sections must follow changes marked dirty.
+ */
+
+#define TEST_EPOCH (1500000000)
+
+typedef bool (*ConstructFunction)(Controller *me, char **data);
+
+static Controller *NewController(void)
+{
+	Controller *me = malloc(sizeof(Controller));
+
+	ControllerSetDefaults(me);
+	ConstructMessageTemplates(me);
+	return me;
+}
+
+static bool SensorStatus(Controller *me, char **data)
+{
+	return ConstructSensorStatusMsgForUser(me, data);
+}
+
+static bool ActuatorStatus(Controller *me, char **data)
+{
+	return ConstructActuatorStatusMsgForUser(me, data);
+}
+
+static bool DeviceStatus(Controller *me, char **data)
+{
+	return ConstructDeviceStatusMsgForUser(me, data);
+}
+
+static void MarkAllDirty(Controller *me)
+{
+	unsigned int i;
+
+	for (i = 0; i < ControllerSection_Count; ++i)
+	{
+		ControllerMarkDirty(me, i);
+	}
+}
+
+/**
+ * Drop padding, which templates leave after closing tags
+ */
+static void StripPadding(char *message)
+{
+	char *from = message, *to = message;
+
+	while (*from)
+	{
+		*to++ = *from;
+		if (*from++ == '>')
+		{
+			while (*from == ' ')
+			{
+				from++;
+			}
+		}
+	}
+	*to = '\0';
+}
+
+/**
+ * Construct a message from templates and by formatting, returning whether
+ * they match once padding is dropped
+ */
+static bool MatchesFormatted(Controller *me, ConstructFunction construct, char *patched, size_t size)
+{
+	Controller *formatting = malloc(sizeof(Controller));
+	char *message = NULL, *formatted = NULL;
+	bool match = false;
+
+	memcpy(formatting, me, sizeof(Controller));
+	formatting->heartBeatTemplate.isValid = false;
+	formatting->sensorStatusTemplate.isValid = false;
+	formatting->actuatorStatusTemplate.isValid = false;
+	formatting->deviceStatusTemplate.isValid = false;
+
+	if (construct(me, &message) && construct(formatting, &formatted))
+	{
+		snprintf(patched, size, "%s", message);
+		StripPadding(message);
+		match = (strcmp(message, formatted) == 0);
+		if (!match)
+		{
+			printf("patched   %s\nformatted %s\n", message, formatted);
+		}
+	}
+	Flow_MemFree((void **)&message);
+	Flow_MemFree((void **)&formatted);
+	free(formatting);
+	return match;
+}
+
+static void test_PatchedMessagesMatchFormatted(void)
+{
+	static const float values[] = { 0.0f, 21.5f, -0.004f, -12.345f, 0.125f, 99.995f, 2.675f, 12345.67f };
+	Controller *me = NewController();
+	char patched[MESSAGE_TEMPLATE_SIZE];
+	unsigned int i;
+
+	for (i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+	{
+		me->sensors[0].value = values[i];
+		me->sensors[1].value = -values[i];
+		me->relays[0].mode = (i & 1) ? Relay_Auto : Relay_Manual;
+		me->relays[0].status = (i & 2) ? Relay_On : Relay_Off;
+		me->sensorConfig.isAlive = (i & 1);
+		me->actuatorConfig.isAlive = !(i & 2);
+		MarkAllDirty(me);
+
+		CHECK(MatchesFormatted(me, ConstructHeartBeatMsgForUser, patched, sizeof(patched)));
+		CHECK(MatchesFormatted(me, SensorStatus, patched, sizeof(patched)));
+		CHECK(MatchesFormatted(me, ActuatorStatus, patched, sizeof(patched)));
+		CHECK(MatchesFormatted(me, DeviceStatus, patched, sizeof(patched)));
+	}
+	CHECK_CONTAINS(patched, "<time type=\"datetime\">2017-07-14T02:40:00Z</time>");
+}
+
+static void test_PaddingIsBetweenElements(void)
+{
+	Controller *me = NewController();
+	char patched[MESSAGE_TEMPLATE_SIZE];
+
+	me->relays[0].mode = Relay_Auto;
+	me->relays[0].status = Relay_On;
+	me->sensorConfig.isAlive = true;
+	me->actuatorConfig.isAlive = false;
+	MarkAllDirty(me);
+
+	CHECK(MatchesFormatted(me, ConstructHeartBeatMsgForUser, patched, sizeof(patched)));
+	CHECK_CONTAINS(patched, "<mode>AUTO</mode>  <status>ON</status>    </Relay_1>");
+	CHECK_CONTAINS(patched, "<Sensor>ALIVE</Sensor> <Actuator>DEAD</Actuator>  </info>");
+}
+
+static void test_ValueWiderThanSlotIsFormatted(void)
+{
+	Controller *me = NewController();
+	char patched[MESSAGE_TEMPLATE_SIZE];
+
+	me->sensors[0].value = 123456789.0f;
+	ControllerMarkDirty(me, ControllerSection_Sensors);
+	CHECK(MatchesFormatted(me, SensorStatus, patched, sizeof(patched)));
+	CHECK_CONTAINS(patched, "<Temperature>123456792.00</Temperature><Humidity>");
+
+	me->sensors[0].value = NAN;
+	ControllerMarkDirty(me, ControllerSection_Sensors);
+	CHECK(MatchesFormatted(me, SensorStatus, patched, sizeof(patched)));
+}
+
+static void test_CachedSectionsFollowChanges(void)
+{
+	Controller *me = NewController();
+	CacheStat heartBeat = controllerStats.heartBeatCache;
+	CacheStat setting = controllerStats.settingCache;
+	char *first = NULL, *second = NULL;
+
+	CHECK(ConstructHeartBeatMsgForUser(me, &first));
+	CHECK_EQ_INT(heartBeat.misses + 3, controllerStats.heartBeatCache.misses);
+	Flow_MemFree((void **)&first);
+
+	//Unmarked change is not seen, marked one is
+	me->sensors[0].value = 30.25f;
+	CHECK(ConstructHeartBeatMsgForUser(me, &first));
+	CHECK_EQ_INT(heartBeat.hits + 3, controllerStats.heartBeatCache.hits);
+	CHECK(!strstr(first, "30.25"));
+	ControllerMarkDirty(me, ControllerSection_Sensors);
+	CHECK(ConstructHeartBeatMsgForUser(me, &second));
+	CHECK_EQ_INT(heartBeat.hits + 5, controllerStats.heartBeatCache.hits);
+	CHECK_EQ_INT(heartBeat.misses + 4, controllerStats.heartBeatCache.misses);
+	CHECK_CONTAINS(second, "<Temperature>30.25</Temperature>");
+	Flow_MemFree((void **)&first);
+	Flow_MemFree((void **)&second);
+
+	CHECK(ConstructSetting(me, &first));
+	CHECK(ConstructSetting(me, &second));
+	CHECK(strcmp(first, second) == 0);
+	CHECK_EQ_INT(setting.misses + 1, controllerStats.settingCache.misses);
+	CHECK_EQ_INT(setting.hits + 1, controllerStats.settingCache.hits);
+	Flow_MemFree((void **)&second);
+
+	me->sensors[0].threshold = 18.5f;
+	ControllerMarkDirty(me, ControllerSection_Settings);
+	CHECK(ConstructSetting(me, &second));
+	CHECK_CONTAINS(second, "<TemperatureThreshold>18.50</TemperatureThreshold>");
+	CHECK(!strstr(first, "18.50"));
+	Flow_MemFree((void **)&first);
+	Flow_MemFree((void **)&second);
+
+	CHECK(ConstructSettingsCommandForSensor(me, &first));
+	CHECK_CONTAINS(first, "<settings><HeartBeat>15000</HeartBeat><TemperatureReadInterval>");
+	Flow_MemFree((void **)&first);
+	me->actuatorConfig.heartBeat = 20000;
+	ControllerMarkDirty(me, ControllerSection_Settings);
+	CHECK(ConstructSettingsCommandForActuator(me, &first));
+	CHECK_CONTAINS(first, "<info>UPDATE_SETTINGS</info><wire>1</wire><settings><HeartBeat>20000</HeartBeat></settings></command>");
+	Flow_MemFree((void **)&first);
+}
+
+static void test_TemplateRejectsWhatDoesNotFit(void)
+{
+	MessageTemplate template;
+	char *message;
+	unsigned int i;
+
+	MessageTemplate_Init(&template);
+	CHECK(MessageTemplate_AppendFormat(&template, "<a>%s</a><b>%.1f</b>", 3));
+	CHECK_EQ_INT(2, template.slotCount);
+
+	message = MessageTemplate_Copy(&template);
+	CHECK(message);
+	CHECK(!MessageTemplate_SetString(&template, message, 0, "LONG"));
+	CHECK(!MessageTemplate_SetString(&template, message, 1, "ON"));
+	CHECK(MessageTemplate_SetString(&template, message, 0, "ON"));
+	CHECK(MessageTemplate_SetFloat(&template, message, 1, -0.25f));
+	CHECK(strcmp(message, "<a>ON</a> <b>-0.2</b>     ") == 0);
+	Flow_MemFree((void **)&message);
+
+	MessageTemplate_Init(&template);
+	CHECK(!MessageTemplate_AppendFormat(&template, "<a>%d</a>", 3));
+	CHECK(!MessageTemplate_Copy(&template));
+
+	MessageTemplate_Init(&template);
+	for (i = 0; i < MESSAGE_TEMPLATE_MAX_SLOTS; ++i)
+	{
+		CHECK(MessageTemplate_AppendFormat(&template, "<a>%s</a>", 1));
+	}
+	CHECK(!MessageTemplate_AppendFormat(&template, "<a>%s</a>", 1));
+}
+
+int main(void)
+{
+	FlowStub_UseVirtualTime(TEST_EPOCH);
+
+	RUN_TEST(test_PatchedMessagesMatchFormatted);
+	RUN_TEST(test_PaddingIsBetweenElements);
+	RUN_TEST(test_ValueWiderThanSlotIsFormatted);
+	RUN_TEST(test_CachedSectionsFollowChanges);
+	RUN_TEST(test_TemplateRejectsWhatDoesNotFit);
+	return TEST_RESULT();
+}
@@ -0,0 +1,193 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "message_trace.h"
+#include "test.h"
+
+#define TRACE_FILE "test.trace"
+
+static const char _Event[] = "<event><type>Sensor</type><info><Temperature>21.50</Temperature></info></event>";
+
+static void test_RecordsReadBackInOrder(void)
+{
+	MessageTrace trace;
+	MessageTraceReader reader;
+	MessageTraceRecord record;
+	uint64_t lastTime;
+
+	CHECK(MessageTrace_Open(&trace, TRACE_FILE));
+	MessageTrace_Record(&trace, MessageTrace_Identity, "user-1", "User", 4);
+	MessageTrace_Record(&trace, MessageTrace_Received, "sensor-1", _Event, strlen(_Event));
+	MessageTrace_Record(&trace, MessageTrace_SettingRead, "ControllerConfig", NULL, 0);
+	MessageTrace_Record(&trace, MessageTrace_Sent, "actuator-1", "RELAY_1_ON", 10);
+	CHECK_EQ_INT(4, trace.records);
+	MessageTrace_Close(&trace);
+
+	CHECK(MessageTraceReader_Open(&reader, TRACE_FILE));
+	CHECK(reader.startEpoch > 0);
+
+	CHECK(MessageTraceReader_Next(&reader, &record));
+	CHECK_EQ_INT(MessageTrace_Identity, record.direction);
+	CHECK(strcmp(record.peer, "user-1") == 0);
+	CHECK(strcmp(record.content, "User") == 0);
+	lastTime = record.time;
+
+	CHECK(MessageTraceReader_Next(&reader, &record));
+	CHECK_EQ_INT(MessageTrace_Received, record.direction);
+	CHECK(strcmp(record.peer, "sensor-1") == 0);
+	CHECK_EQ_INT(strlen(_Event), record.length);
+	CHECK(strcmp(record.content, _Event) == 0);
+	CHECK(record.time >= lastTime);
+
+	CHECK(MessageTraceReader_Next(&reader, &record));
+	CHECK_EQ_INT(MessageTrace_SettingRead, record.direction);
+	CHECK_EQ_INT(0, record.length);
+	CHECK(strcmp(record.content, "") == 0);
+
+	CHECK(MessageTraceReader_Next(&reader, &record));
+	CHECK_EQ_INT(MessageTrace_Sent, record.direction);
+	CHECK(strcmp(record.content, "RELAY_1_ON") == 0);
+
+	CHECK(!MessageTraceReader_Next(&reader, &record));
+	MessageTraceReader_Close(&reader);
+}
+
+static void test_TruncatedRecordIsIgnored(void)
+{
+	MessageTrace trace;
+	MessageTraceReader reader;
+	MessageTraceRecord record;
+	long size;
+	FILE *file;
+
+	CHECK(MessageTrace_Open(&trace, TRACE_FILE));
+	MessageTrace_Record(&trace, MessageTrace_Received, "sensor-1", _Event, strlen(_Event));
+	MessageTrace_Record(&trace, MessageTrace_Received, "sensor-1", _Event, strlen(_Event));
+	MessageTrace_Close(&trace);
+
+	//Cut last record short, as a crash while writing would
+	file = fopen(TRACE_FILE, "rb");
+	CHECK(file);
+	fseek(file, 0, SEEK_END);
+	size = ftell(file);
+	fclose(file);
+	CHECK(truncate(TRACE_FILE, size - 5) == 0);
+
+	CHECK(MessageTraceReader_Open(&reader, TRACE_FILE));
+	CHECK(MessageTraceReader_Next(&reader, &record));
+	CHECK(!MessageTraceReader_Next(&reader, &record));
+	MessageTraceReader_Close(&reader);
+}
+
+static void test_ClosedTraceRecordsNothing(void)
+{
+	MessageTrace trace;
+	MessageTraceReader reader;
+	FILE *file;
+
+	memset(&trace, 0, sizeof(trace));
+	MessageTrace_Record(&trace, MessageTrace_Sent, "user-1", "PING", 4);
+	CHECK_EQ_INT(0, trace.records);
+
+	//Not a trace
+	file = fopen(TRACE_FILE, "wb");
+	CHECK(file);
+	fputs("<xml/>", file);
+	fclose(file);
+	CHECK(!MessageTraceReader_Open(&reader, TRACE_FILE));
+}
+
+static void *RecordUntilClosed(void *arg)
+{
+	MessageTrace *trace = (MessageTrace *)arg;
+	int i;
+
+	for (i = 0; i < 20000; i++)
+	{
+		MessageTrace_Record(trace, MessageTrace_Received, "sensor-1", _Event, strlen(_Event));
+	}
+	return NULL;
+}
+
+static void test_CloseWhileRecording(void)
+{
+	MessageTrace trace;
+	MessageTraceReader reader;
+	MessageTraceRecord record;
+	pthread_t threads[4];
+	uint64_t records = 0;
+	int i;
+
+	CHECK(MessageTrace_Open(&trace, TRACE_FILE));
+	for (i = 0; i < 4; i++)
+	{
+		CHECK(pthread_create(&threads[i], NULL, RecordUntilClosed, &trace) == 0);
+	}
+	while (records < 1000)
+	{
+		usleep(100);
+		pthread_mutex_lock(&trace.lock);
+		records = trace.records;
+		pthread_mutex_unlock(&trace.lock);
+	}
+	MessageTrace_Close(&trace);
+	for (i = 0; i < 4; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+	CHECK(!trace.isOpen);
+
+	//Every record made before closing is whole
+	records = 0;
+	CHECK(MessageTraceReader_Open(&reader, TRACE_FILE));
+	while (MessageTraceReader_Next(&reader, &record))
+	{
+		CHECK(strcmp(record.content, _Event) == 0);
+		records++;
+	}
+	MessageTraceReader_Close(&reader);
+	CHECK_EQ_INT(trace.records, records);
+}
+
+int main(void)
+{
+	RUN_TEST(test_RecordsReadBackInOrder);
+	RUN_TEST(test_TruncatedRecordIsIgnored);
+	RUN_TEST(test_ClosedTraceRecordsNothing);
+	RUN_TEST(test_CloseWhileRecording);
+	return TEST_RESULT();
+}
@@ -0,0 +1,123 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include "time_series.h"
+#include "test.h"
+
+#define START (1499997600)	//On an hour boundary
+
+static TimeSeries _series;
+
+static void test_EmptySeriesHasNoPoints(void)
+{
+	TimeSeriesPoint points[4];
+
+	TimeSeries_Init(&_series);
+	CHECK_EQ_INT(0, TimeSeries_Query(&_series, 0, START, 0, points, 4));
+}
+
+static void test_RawSamples(void)
+{
+	TimeSeriesPoint points[16];
+	unsigned int i;
+
+	TimeSeries_Init(&_series);
+	for (i = 0; i < 10; ++i)
+	{
+		TimeSeries_Add(&_series, START + i, (float)i);
+	}
+
+	CHECK_EQ_INT(10, TimeSeries_Query(&_series, START, START + 100, 0, points, 16));
+	CHECK_EQ_INT(START + 3, points[3].time);
+	CHECK_NEAR(3.0, points[3].mean, 0.0001);
+	CHECK_EQ_INT(1, points[3].count);
+
+	//Bounded by maxPoints
+	CHECK_EQ_INT(4, TimeSeries_Query(&_series, START, START + 100, 0, points, 4));
+}
+
+static void test_MinuteRollups(void)
+{
+	TimeSeriesPoint points[8];
+	unsigned int i;
+
+	TimeSeries_Init(&_series);
+	for (i = 0; i < 18; ++i)
+	{
+		TimeSeries_Add(&_series, START + i * 10, (float)i);
+	}
+
+	CHECK_EQ_INT(3, TimeSeries_Query(&_series, START, START + 179, 60, points, 8));
+	CHECK_EQ_INT(START, points[0].time);
+	CHECK_EQ_INT(6, points[0].count);
+	CHECK_NEAR(0.0, points[0].min, 0.0001);
+	CHECK_NEAR(5.0, points[0].max, 0.0001);
+	CHECK_NEAR(2.5, points[0].mean, 0.0001);
+	CHECK_EQ_INT(START + 120, points[2].time);
+	CHECK_NEAR(14.5, points[2].mean, 0.0001);
+
+	//Resolution is rounded up to a multiple of the rollup
+	CHECK_EQ_INT(120, TimeSeries_Resolution(&_series, START, 90));
+	CHECK_EQ_INT(2, TimeSeries_Query(&_series, START, START + 179, 90, points, 8));
+	CHECK_EQ_INT(12, points[0].count);
+}
+
+static void test_FallsBackToCoarserRollup(void)
+{
+	TimeSeriesPoint points[8];
+	uint32_t latest = START + 2 * 24 * 3600;
+	uint32_t time;
+
+	TimeSeries_Init(&_series);
+	for (time = START; time <= latest; time += 60)
+	{
+		TimeSeries_Add(&_series, time, 20.0f);
+	}
+
+	//Minute rollups cover last day only
+	CHECK_EQ_INT(60, TimeSeries_Resolution(&_series, latest - 3600, 60));
+	CHECK_EQ_INT(900, TimeSeries_Resolution(&_series, START, 60));
+	CHECK_EQ_INT(1, TimeSeries_Query(&_series, START, START + 899, 60, points, 8));
+	CHECK_EQ_INT(15, points[0].count);
+	CHECK_NEAR(20.0, points[0].mean, 0.0001);
+}
+
+int main(void)
+{
+	RUN_TEST(test_EmptySeriesHasNoPoints);
+	RUN_TEST(test_RawSamples);
+	RUN_TEST(test_MinuteRollups);
+	RUN_TEST(test_FallsBackToCoarserRollup);
+	return TEST_RESULT();
+}
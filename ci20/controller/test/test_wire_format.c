@@ -0,0 +1,99 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include "wire_format.h"
+#include "test.h"
+
+#include "flow/core/flow_memalloc.h"
+
+static const char _HeartBeat[] = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+	"<event><time type=\"datetime\">2015-03-01T12:30:45Z</time><type>HeartBeat</type><info>"
+	"<Temperature>25.00</Temperature> <Humidity>30.00</Humidity>   "
+	"<Relay_1><mode>AUTO</mode><status>ON</status> </Relay_1>"
+	"<Sensor>ALIVE</Sensor><Actuator>DEAD</Actuator></info></event>";
+
+static void test_MessageRoundTrips(void)
+{
+	char *compact = WireFormat_ToCompact(_HeartBeat);
+	char *xml;
+
+	CHECK(compact);
+	CHECK(WireFormat_IsCompact(compact));
+	CHECK(strcmp(compact, "!1(A(D1425213045)(EHeartBeat)(F(K25.00)(L30.00)(M(OAUTO)(PON))(QALIVE)(RDEAD)))") == 0);
+
+	//Same tree, without prolog and whitespace between elements
+	xml = WireFormat_ToXml(compact);
+	CHECK(strcmp(xml, "<event><time type=\"datetime\">2015-03-01T12:30:45Z</time><type>HeartBeat</type><info>"
+						"<Temperature>25.00</Temperature><Humidity>30.00</Humidity>"
+						"<Relay_1><mode>AUTO</mode><status>ON</status></Relay_1>"
+						"<Sensor>ALIVE</Sensor><Actuator>DEAD</Actuator></info></event>") == 0);
+	Flow_MemFree((void **)&compact);
+	Flow_MemFree((void **)&xml);
+}
+
+static void test_UnknownNamesAndEscapes(void)
+{
+	const char message[] = "<command><info>a(b)c\\d</info><Extra>x &amp; y</Extra><empty/><time>soon</time></command>";
+	char *compact = WireFormat_ToCompact(message);
+	char *xml;
+
+	CHECK(strcmp(compact, "!1(B(Fa\\(b\\)c\\\\d)('Extra'x &amp; y)('empty')(Dsoon))") == 0);
+	xml = WireFormat_ToXml(compact);
+	CHECK(strcmp(xml, "<command><info>a(b)c\\d</info><Extra>x &amp; y</Extra><empty></empty>"
+						"<time type=\"datetime\">soon</time></command>") == 0);
+	Flow_MemFree((void **)&compact);
+	Flow_MemFree((void **)&xml);
+}
+
+static void test_MalformedIsRejected(void)
+{
+	CHECK(!WireFormat_IsCompact("<event></event>"));
+	CHECK(!WireFormat_IsCompact("!2(A)"));
+	CHECK(WireFormat_ToXml("<event></event>") == NULL);
+	CHECK(WireFormat_ToXml("!1(A(E)") == NULL);	//Unclosed
+	CHECK(WireFormat_ToXml("!1(A))") == NULL);	//Closed twice
+	CHECK(WireFormat_ToXml("!1(~)") == NULL);	//Not in table
+	CHECK(WireFormat_ToXml("!1('Extra)") == NULL);
+	CHECK(WireFormat_ToXml("!1(A\\") == NULL);
+	CHECK(WireFormat_ToXml("!1(A(A(A(A(A(A(A(A(A(A(A(A(A(A(A(A(A)))))))))))))))))") == NULL);	//Too deep
+	CHECK(WireFormat_ToCompact("<event><type>Sensor</type") == NULL);
+}
+
+int main(void)
+{
+	RUN_TEST(test_MessageRoundTrips);
+	RUN_TEST(test_UnknownNamesAndEscapes);
+	RUN_TEST(test_MalformedIsRejected);
+	return TEST_RESULT();
+}
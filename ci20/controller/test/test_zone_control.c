@@ -0,0 +1,152 @@
+/****************************************************************************
+ Copyright (c) 2015, Imagination Technologies Limited
+ All rights reserved.
+
+ Redistribution and use of the Software in source and binary forms, with or
+ without modification, are permitted provided that the following conditions are met:
+
+     1. The Software (including after any modifications that you make to it) must
+        support the FlowCloud Web Service API provided by Licensor and accessible
+        at  http://ws-uat.flowworld.com and/or some other location(s) that we specify.
+
+     2. Redistributions of source code must retain the above copyright notice, this
+        list of conditions and the following disclaimer.
+
+     3. Redistributions in binary form must reproduce the above copyright notice, this
+        list of conditions and the following disclaimer in the documentation and/or
+        other materials provided with the distribution.
+
+     4. Neither the name of the copyright holder nor the names of its contributors may
+        be used to endorse or promote products derived from this Software without
+        specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include "zone_control.h"
+#include "test.h"
+
+#define WINDOW (120000)
+#define TICK (1000)
+#define MIN_PULSE (10000)
+
+static const PidGains _Gains = { 0.25f, 0.0005f, 0.0f };
+static const PidGains _ProportionalGains = { 0.25f, 0.0f, 0.0f };
+
+/**
+ * Run zone through a window, returning number of ON ticks and relay
+ * transitions, starting with relay in state isOn.
+ */
+static void RunWindow(ZoneControl *zone, const PidGains *gains, float setpoint, float measurement,
+						ZoneDirection_Type direction, bool *isOn, unsigned int *onTicks, unsigned int *transitions)
+{
+	unsigned int i;
+
+	*onTicks = 0;
+	*transitions = 0;
+	for (i = 0; i < WINDOW / TICK; ++i)
+	{
+		bool relayOn = ZoneControl_Tick(zone, gains, setpoint, measurement, direction, *isOn);
+
+		if (relayOn != *isOn)
+		{
+			(*transitions)++;
+		}
+		if (relayOn)
+		{
+			(*onTicks)++;
+		}
+		*isOn = relayOn;
+	}
+}
+
+static void test_LargeErrorSaturates(void)
+{
+	ZoneControl zone;
+	bool isOn = false;
+	unsigned int onTicks, transitions;
+
+	ZoneControl_Init(&zone, WINDOW, TICK, MIN_PULSE);
+	RunWindow(&zone, &_Gains, 22.0f, 10.0f, ZoneDirection_Raise, &isOn, &onTicks, &transitions);
+
+	CHECK_NEAR(1.0, zone.duty, 0.0001);
+	CHECK_EQ_INT(WINDOW / TICK, onTicks);
+	CHECK_EQ_INT(1, transitions);
+}
+
+static void test_DirectionLowerInvertsError(void)
+{
+	ZoneControl zone;
+
+	ZoneControl_Init(&zone, WINDOW, TICK, MIN_PULSE);
+	CHECK_NEAR(1.0, ZoneControl_UpdatePid(&zone, &_Gains, 40.0f, 60.0f, ZoneDirection_Lower, 1.0f), 0.0001);
+	ZoneControl_Reset(&zone);
+	CHECK_NEAR(0.0, ZoneControl_UpdatePid(&zone, &_Gains, 40.0f, 30.0f, ZoneDirection_Lower, 1.0f), 0.0001);
+}
+
+static void test_AtMostOneTransitionPerWindow(void)
+{
+	ZoneControl zone;
+	bool isOn = false;
+	unsigned int onTicks, transitions;
+	unsigned int window;
+
+	//Half duty cycle, without integral windup as measurement never moves
+	ZoneControl_Init(&zone, WINDOW, TICK, MIN_PULSE);
+	for (window = 0; window < 20; ++window)
+	{
+		RunWindow(&zone, &_ProportionalGains, 22.0f, 20.0f, ZoneDirection_Raise, &isOn, &onTicks, &transitions);
+		CHECK(transitions <= 1);
+		CHECK_EQ_INT(WINDOW / TICK / 2, onTicks);
+	}
+}
+
+static void test_ShortPulsesAreDropped(void)
+{
+	ZoneControl zone;
+	bool isOn = false;
+	unsigned int onTicks, transitions;
+
+	//Duty of 0.025 is a 3 second pulse, below minimum
+	ZoneControl_Init(&zone, WINDOW, TICK, MIN_PULSE);
+	RunWindow(&zone, &_Gains, 22.0f, 21.9f, ZoneDirection_Raise, &isOn, &onTicks, &transitions);
+
+	CHECK(zone.duty > 0.0f);
+	CHECK_EQ_INT(0, onTicks);
+	CHECK_EQ_INT(0, transitions);
+}
+
+static void test_IntegralStopsWhileSaturated(void)
+{
+	ZoneControl zone;
+	unsigned int i;
+
+	ZoneControl_Init(&zone, WINDOW, TICK, MIN_PULSE);
+	for (i = 0; i < 1000; ++i)
+	{
+		ZoneControl_UpdatePid(&zone, &_Gains, 22.0f, 10.0f, ZoneDirection_Raise, 120.0f);
+	}
+	CHECK(zone.integral <= 1.0f);
+
+	//Recovers as soon as error changes sign
+	CHECK_NEAR(0.0, ZoneControl_UpdatePid(&zone, &_Gains, 22.0f, 30.0f, ZoneDirection_Raise, 120.0f), 0.5);
+}
+
+int main(void)
+{
+	RUN_TEST(test_LargeErrorSaturates);
+	RUN_TEST(test_DirectionLowerInvertsError);
+	RUN_TEST(test_AtMostOneTransitionPerWindow);
+	RUN_TEST(test_ShortPulsesAreDropped);
+	RUN_TEST(test_IntegralStopsWhileSaturated);
+	return TEST_RESULT();
+}
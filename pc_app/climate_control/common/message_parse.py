@@ -2,9 +2,11 @@
 
 """
 
+from copy import deepcopy
 from enum import Enum
 from datetime import datetime
 from xml.etree.ElementTree import Element, SubElement, tostring
+from . import wire_format
 
 
 # constants
@@ -22,13 +24,17 @@ class ControllerEventFactory(object):
 
         :param dict event_dict: event_dict which has parsed data from received message xml
         :return: controller event object
-        :rtype: HeartBeatEvent, MeasurementEvent, RelayStatusEvent, DeviceStatusEvent
+        :rtype: HeartBeatEvent, HeartBeatDeltaEvent, MeasurementEvent, RelayStatusEvent,
+            DeviceStatusEvent
         :raises: ValueError: If event_dict failed to have entry for "type" tag
         """
         try:
             if event_dict["event"]["type"] == "HeartBeat":
                 return HeartBeatEvent(event_dict)
 
+            elif event_dict["event"]["type"] == "HeartBeatDelta":
+                return HeartBeatDeltaEvent(event_dict)
+
             elif event_dict["event"]["type"] == "Measurement":
                 return MeasurementEvent(event_dict)
 
@@ -170,6 +176,82 @@ class HeartBeatEvent(object):
             raise ValueError("Failed to parse heartbeat event")
 
 
+class HeartBeatDeltaEvent(object):
+    """ Class representing Heartbeat event sent as delta
+
+    Keyframes, whose base is their own sequence, carry all heartbeat values. Others carry
+    only the values which differ from the keyframe they name as base.
+    """
+    def __init__(self, event_dict):
+        """ Heartbeat delta event constructor
+
+        :param event_dict: event dictionary which has parsed data from received message xml
+        """
+        try:
+            self.time = datetime.strptime(event_dict["event"]["time"]["#text"],
+                                          TIME_FMT)
+            self.sequence = int(event_dict["event"]["seq"])
+            self.base = int(event_dict["event"]["base"])
+            # empty info of a delta with no changes is parsed as None
+            self.info = event_dict["event"]["info"] or {}
+        except (KeyError, TypeError):
+            raise ValueError("Failed to parse heartbeat delta event")
+
+    @property
+    def is_keyframe(self):
+        """ True if event carries all heartbeat values
+        """
+        return self.sequence == self.base
+
+
+class HeartBeatDeltaDecoder(object):
+    """ Rebuilds heartbeat events from heartbeat delta events
+    """
+    def __init__(self):
+        """ HeartBeatDeltaDecoder constructor
+        """
+        self.__keyframe = None
+        self.__base = None
+        self.__sequence = None
+
+    def decode(self, event):
+        """ Applies delta event to its keyframe
+
+        :param HeartBeatDeltaEvent event: received delta event
+        :return: heartbeat event, or None if event is stale or its keyframe was missed
+        :rtype: HeartBeatEvent
+        :raises ValueError: if rebuilt heartbeat is invalid
+        """
+        if event.is_keyframe:
+            # always taken, as controller may have restarted
+            keyframe = event.info
+        elif self.__keyframe is None or event.base != self.__base or \
+                not HeartBeatDeltaDecoder.__is_newer(event.sequence, self.__sequence):
+            return None
+        else:
+            keyframe = self.__keyframe
+
+        info = deepcopy(keyframe)
+        info.update(event.info)
+        heartbeat = HeartBeatEvent({"event": {"time": {"#text": event.time.strftime(TIME_FMT)},
+                                              "info": info}})
+        if event.is_keyframe:
+            self.__keyframe = keyframe
+            self.__base = event.base
+        self.__sequence = event.sequence
+        return heartbeat
+
+    @staticmethod
+    def __is_newer(sequence, last):
+        """ Compares sequence numbers, which wrap at 32 bits
+
+        :return: True if sequence is after last
+        :rtype: bool
+        """
+        difference = (sequence - last) & 0xFFFFFFFF
+        return 0 < difference < 0x80000000
+
+
 class ControllerCommandEnum(Enum):
     """ Enum class for command string supported by controller
 
@@ -213,8 +295,10 @@ class ControllerCommand(object):
         # <command>
         #     <time type="datetime">2014-11-28T15:30:09Z</time>
         #     <info>RETRIEVE_SETTINGS/RELAY_1_ON/RELAY_1_OFF/RELAY_2_ON/RELAY_2_OFF</info>
+        #     <wire>1</wire>
         # </command>
         #
+        # wire advertises the compact wire format version the app decodes
 
         root = Element("command")
         time_tag = SubElement(root, "time", attrib={"type": "datetime"})
@@ -223,6 +307,7 @@ class ControllerCommand(object):
         if command == ControllerCommandEnum.ping:
             SubElement(root, "app_time").text = \
                 datetime.utcnow().strftime(TIME_FMT_MICROSECONDS)
+        SubElement(root, "wire").text = wire_format.VERSION
         self.type = command
         self.xml = tostring(root)
 
@@ -243,6 +328,7 @@ class ControllerResponse(object):
         #     <time type="datetime">2014-11-28T15:30:09Z</time>
         #     <info>RETRIEVE_SETTINGS_SUCCESS/RETRIEVE_SETTINGS_FAILURE/RELAY_1_ON/
         #           RELAY_1_OFF/RELAY_2_ON/RELAY_2_OFF</info>
+        #     <wire>1</wire>
         # </response>
         #
         try:
@@ -254,6 +340,9 @@ class ControllerResponse(object):
             else:
                 raise ValueError("Unsupported response message received {}".
                                  format(response_dict["response"]["info"]))
+            # controllers which decode compact wire format advertise its version
+            self.is_compact_supported = \
+                response_dict["response"].get("wire") == wire_format.VERSION
             try:
                 self.time = datetime.strptime(response_dict["response"]["time"]["#text"], TIME_FMT)
                 # for ping command, controller copies the app_time tag and replies back
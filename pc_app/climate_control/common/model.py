@@ -13,9 +13,10 @@ import xmltodict
 from xml.parsers.expat import ExpatError
 from xml.etree.ElementTree import Element, SubElement, tostring
 from .message_parse import ControllerEventFactory, MeasurementEvent, HeartBeatEvent, \
-    RelayStatusEvent, DeviceStatusEvent, ControllerCommand, ControllerResponse, \
+    HeartBeatDeltaEvent, HeartBeatDeltaDecoder, RelayStatusEvent, DeviceStatusEvent, ControllerCommand, ControllerResponse, \
     ControllerCommandEnum, ControllerResponseEnum
 from .connection_status import NetworkMonitor
+from . import wire_format
 
 LOGGER = logging.getLogger(__name__)
 THREAD_POOL_MAX_THREADS = 5
@@ -238,6 +239,8 @@ class ClimateControlModel(QObject):
         self.__last_measurement_event = None
         self.__last_relay_status_event = None
         self.__last_device_status_event = None
+        self.__heartbeat_decoder = HeartBeatDeltaDecoder()
+        self.__is_controller_compact = False
         self.__controller_heartbeat = None
         self.latency = Latency()
         self.__latency_timer = QTimer(self)
@@ -330,6 +333,8 @@ class ClimateControlModel(QObject):
         LOGGER.info("sending command {}".format(command.value))
         command_xml = ControllerCommand(command).xml
         LOGGER.debug("command xml {}".format(command_xml))
+        if self.__is_controller_compact:
+            command_xml = wire_format.to_compact(command_xml)
         runnable = WorkerThread(send_command_work, self.__command_sent_result,
                                 user=self.__flow_user, device=self.__controller_device,
                                 message=command_xml)
@@ -457,6 +462,7 @@ class ClimateControlModel(QObject):
         try:
             response = ControllerResponse(response_dict)
             LOGGER.info("received response {}".format(response.response.value))
+            self.__is_controller_compact = response.is_compact_supported
             if response.response == ControllerResponseEnum.ping:
                 # round_trip_time is the difference between current local time and timestamp
                 # when message was sent, this includes any processing delay on controller side
@@ -554,6 +560,13 @@ class ClimateControlModel(QObject):
                                                                            event.actuator_alive))
             elif isinstance(event, HeartBeatEvent):
                 self.__process_heartbeat_event(event)
+            elif isinstance(event, HeartBeatDeltaEvent):
+                heartbeat = self.__heartbeat_decoder.decode(event)
+                if heartbeat:
+                    self.__process_heartbeat_event(heartbeat)
+                else:
+                    LOGGER.debug("Ignoring heartbeat delta {} of keyframe {}".format(
+                        event.sequence, event.base))
 
         except ValueError as value_error:
             LOGGER.exception(value_error)
@@ -570,6 +583,8 @@ class ClimateControlModel(QObject):
         status = {"network": True, "internet": True}
         self.connection_status.emit(status)
         try:
+            if wire_format.is_compact(message_content):
+                message_content = wire_format.to_xml(message_content)
             message_dict = xmltodict.parse(message_content)
             root_tag = message_dict.keys()[0]
             if root_tag == "response":
@@ -578,7 +593,7 @@ class ClimateControlModel(QObject):
                 self.__handle_event(message_dict)
             else:
                 LOGGER.error("Unsupported message received {}".format(message_content))
-        except (ExpatError, KeyError) as error:
+        except (ExpatError, KeyError, ValueError) as error:
             LOGGER.exception("Error in parsing xml {} xml={}".
                              format(error.message, message_content))
 
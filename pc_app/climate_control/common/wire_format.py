@@ -0,0 +1,144 @@
+""" This module contains the compact wire format of controller messages
+
+Element names are replaced by one character codes from a table shared with the
+controller and devices, datetimes by seconds since epoch, and the prolog and
+whitespace between elements are dropped:
+
+    message = "!1" element
+    element = "(" name *(element / text) ")"
+    name = code / "'" xml-name "'"
+    text = XML character data, with "(", ")" and "\\" escaped by "\\"
+
+A compact message is the same tree as its XML form, so it is converted back to
+XML and parsed as before.
+"""
+
+import calendar
+import re
+from datetime import datetime
+
+
+VERSION = "1"
+PREFIX = "!" + VERSION
+TIME_NAME = "time"
+TIME_FMT = '%Y-%m-%dT%H:%M:%SZ'
+CODES = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
+# append only, a name's code is its index
+NAMES = ("event", "command", "response", "time", "type", "info", "settings", "wire", "seq", "base",
+         "Temperature", "Humidity", "Relay_1", "Relay_2", "mode", "status", "Sensor", "Actuator",
+         "HeartBeat", "HeartBeatKeyframe", "TemperatureReadInterval", "TemperatureReadDelta",
+         "HumidityReadInterval", "HumidityReadDelta", "app_time", "version",
+         "ControllerConfig", "SensorConfig", "ActuatorConfig", "TemperatureThreshold",
+         "HumidityThreshold", "TemperatureOrientation", "HumidityOrientation",
+         "TemperatureControl", "HumidityControl", "Kp", "Ki", "Kd", "ControlWindow", "Mode")
+MAX_DEPTH = 16
+
+_XML_TOKEN = re.compile(r"<([^>]*)>|([^<]+)")
+_COMPACT_TOKEN = re.compile(r"\((?:'([^']+)'|(.))|(\))|\\(.)|([^()\\]+)", re.DOTALL)
+_ESCAPED = re.compile(r"([()\\])")
+
+
+def is_compact(content):
+    """ Check whether message is in compact wire format
+
+    :param str content: received message
+    :rtype: bool
+    """
+    return content is not None and content.startswith(PREFIX)
+
+
+def to_compact(xml):
+    """ Converts XML message to compact wire format
+
+    :param str xml: message xml
+    :return: compact message
+    :rtype: str
+    :raises ValueError: if xml is malformed
+    """
+    if isinstance(xml, bytes):
+        xml = xml.decode("utf-8")
+    parts = [PREFIX]
+    is_time = False
+    position = 0
+    for match in _XML_TOKEN.finditer(xml):
+        if match.start() != position:
+            raise ValueError("Malformed xml")
+        position = match.end()
+        tag, text = match.groups()
+        if text is not None:
+            if text.strip():
+                parts.append(_encode_text(text, is_time))
+            is_time = False
+        elif tag.startswith("/"):
+            parts.append(")")
+        elif not tag.startswith("?") and not tag.startswith("!"):
+            name = re.split(r"[\s/]", tag, 1)[0]
+            parts.append("(" + (CODES[NAMES.index(name)] if name in NAMES else "'" + name + "'"))
+            is_time = name == TIME_NAME
+            if tag.endswith("/"):
+                parts.append(")")
+    if position != len(xml):
+        raise ValueError("Malformed xml")
+    return "".join(parts)
+
+
+def to_xml(compact):
+    """ Converts compact message back to XML
+
+    :param str compact: message in compact wire format
+    :return: message xml
+    :rtype: str
+    :raises ValueError: if message is malformed
+    """
+    if not is_compact(compact):
+        raise ValueError("Not a compact message")
+    parts = []
+    names = []
+    position = len(PREFIX)
+    is_time = False
+    for match in _COMPACT_TOKEN.finditer(compact, position):
+        if match.start() != position:
+            raise ValueError("Malformed compact message")
+        position = match.end()
+        spelt, code, close, escaped, text = match.groups()
+        if spelt is not None or code is not None:
+            if code is not None:
+                index = CODES.find(code)
+                if index < 0 or index >= len(NAMES):
+                    raise ValueError("Unknown name code {}".format(code))
+                spelt = NAMES[index]
+            if len(names) == MAX_DEPTH:
+                raise ValueError("Compact message too deep")
+            names.append(spelt)
+            is_time = spelt == TIME_NAME
+            parts.append("<time type=\"datetime\">" if is_time else "<" + spelt + ">")
+            continue
+        if close is not None:
+            if not names:
+                raise ValueError("Malformed compact message")
+            parts.append("</" + names.pop() + ">")
+        elif escaped is not None:
+            parts.append(escaped)
+        elif is_time and text.isdigit() and compact.startswith(")", position):
+            parts.append(datetime.utcfromtimestamp(int(text)).strftime(TIME_FMT))
+        else:
+            parts.append(text)
+        is_time = False
+    if position != len(compact) or names:
+        raise ValueError("Malformed compact message")
+    return "".join(parts)
+
+
+def _encode_text(text, is_time):
+    """ Encodes character data, datetime of a time element as seconds since epoch
+
+    :param str text: character data
+    :param bool is_time: text is the value of a time element
+    :rtype: str
+    """
+    if is_time:
+        try:
+            return str(calendar.timegm(datetime.strptime(text, TIME_FMT).timetuple()))
+        except ValueError:
+            pass
+    return _ESCAPED.sub(r"\\\1", text)
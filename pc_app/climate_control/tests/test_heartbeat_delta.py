@@ -0,0 +1,119 @@
+""" Test for HeartBeatDeltaDecoder class
+"""
+import sys
+import os
+import xmltodict
+sys.path.append(os.path.join(os.path.dirname(__file__), *([os.path.pardir] * 1)))
+import unittest
+from common.message_parse import ControllerEventFactory, HeartBeatDeltaEvent, \
+    HeartBeatDeltaDecoder
+
+
+KEYFRAME_INFO = "<Temperature>25.00</Temperature>"\
+                "<Humidity>30.00</Humidity>"\
+                "<Relay_1>"\
+                "<mode>AUTO</mode>"\
+                "<status>ON</status>"\
+                "</Relay_1>"\
+                "<Relay_2>"\
+                "<mode>AUTO</mode>"\
+                "<status>OFF</status>"\
+                "</Relay_2>"\
+                "<Sensor>ALIVE</Sensor>"\
+                "<Actuator>ALIVE</Actuator>"
+
+
+def create_delta_event(sequence, base, info):
+    """ Creates delta event as parsed from controller's message
+
+    :param int sequence: sequence of the event
+    :param int base: sequence of the keyframe event refers to
+    :param str info: changed values
+    :rtype: HeartBeatDeltaEvent
+    """
+    delta_xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" \
+                "<event>" \
+                "<time type=\"datetime\">2014-11-28T15:30:09Z</time>" \
+                "<type>HeartBeatDelta</type>" \
+                "<seq>{}</seq>" \
+                "<base>{}</base>" \
+                "<info>{}</info>" \
+                "</event>".format(sequence, base, info)
+    return ControllerEventFactory.create_event(xmltodict.parse(delta_xml))
+
+
+class TestHeartBeatDeltaDecoder(unittest.TestCase):
+    """ Testing of HeartBeatDeltaDecoder class
+    """
+
+    def setUp(self):
+        self.decoder = HeartBeatDeltaDecoder()
+
+    def test_keyframe_is_decoded_expected(self):
+        """ Test passes when keyframe gives heartbeat with all its values
+        """
+        event = create_delta_event(1, 1, KEYFRAME_INFO)
+        self.assertIsInstance(event, HeartBeatDeltaEvent)
+        self.assertTrue(event.is_keyframe)
+        heartbeat = self.decoder.decode(event)
+        self.assertEqual(heartbeat.measurement_data.temperature, 25.0)
+        self.assertEqual(heartbeat.measurement_data.humidity, 30.0)
+        self.assertTrue(heartbeat.relay_status.relay_1_on)
+        self.assertFalse(heartbeat.relay_status.relay_2_on)
+        self.assertTrue(heartbeat.device_status.sensor_alive)
+
+    def test_delta_is_applied_to_keyframe_expected(self):
+        """ Test passes when delta values replace the keyframe ones, and each delta applies to
+        the keyframe rather than to previous delta
+        """
+        self.decoder.decode(create_delta_event(1, 1, KEYFRAME_INFO))
+        heartbeat = self.decoder.decode(create_delta_event(2, 1, ""))
+        self.assertEqual(heartbeat.measurement_data.temperature, 25.0)
+
+        heartbeat = self.decoder.decode(create_delta_event(
+            3, 1, "<Temperature>26.00</Temperature><Sensor>DEAD</Sensor>"))
+        self.assertEqual(heartbeat.measurement_data.temperature, 26.0)
+        self.assertEqual(heartbeat.measurement_data.humidity, 30.0)
+        self.assertFalse(heartbeat.device_status.sensor_alive)
+
+        heartbeat = self.decoder.decode(create_delta_event(
+            5, 1, "<Relay_2><mode>MANUAL</mode><status>ON</status></Relay_2>"))
+        self.assertEqual(heartbeat.measurement_data.temperature, 25.0)
+        self.assertTrue(heartbeat.device_status.sensor_alive)
+        self.assertTrue(heartbeat.relay_status.relay_2_on)
+        self.assertEqual(heartbeat.relay_status.relay_2_mode, "MANUAL")
+
+    def test_delta_without_keyframe_ignored_expected(self):
+        """ Test passes when delta is ignored until its keyframe is received
+        """
+        self.assertIsNone(self.decoder.decode(create_delta_event(2, 1, "")))
+        self.decoder.decode(create_delta_event(1, 1, KEYFRAME_INFO))
+        self.assertIsNone(self.decoder.decode(create_delta_event(9, 8, "")))
+        self.assertIsNotNone(self.decoder.decode(create_delta_event(9, 1, "")))
+
+    def test_stale_delta_ignored_expected(self):
+        """ Test passes when delta older than last received one is ignored, also across
+        sequence wrap
+        """
+        self.decoder.decode(create_delta_event(1, 1, KEYFRAME_INFO))
+        self.assertIsNotNone(self.decoder.decode(create_delta_event(3, 1, "")))
+        self.assertIsNone(self.decoder.decode(create_delta_event(2, 1, "")))
+        self.assertIsNone(self.decoder.decode(create_delta_event(3, 1, "")))
+
+        self.decoder.decode(create_delta_event(0xFFFFFFFF, 0xFFFFFFFF, KEYFRAME_INFO))
+        self.assertIsNotNone(self.decoder.decode(create_delta_event(1, 0xFFFFFFFF, "")))
+
+    def test_invalid_delta_event_exception_expected(self):
+        """ Test passes when delta event without sequence raises ValueError
+        """
+        delta_xml = "<event>" \
+                    "<time type=\"datetime\">2014-11-28T15:30:09Z</time>" \
+                    "<type>HeartBeatDelta</type>" \
+                    "<info></info>" \
+                    "</event>"
+        with self.assertRaises(ValueError):
+            ControllerEventFactory.create_event(xmltodict.parse(delta_xml))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,88 @@
+""" Test for compact wire format
+"""
+import sys
+import os
+import xmltodict
+sys.path.append(os.path.join(os.path.dirname(__file__), *([os.path.pardir] * 1)))
+import unittest
+from common import wire_format
+from common.message_parse import ControllerEventFactory, HeartBeatEvent, ControllerCommand, \
+    ControllerCommandEnum, ControllerResponse
+
+
+HEARTBEAT_XML = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" \
+                "<event>" \
+                "<time type=\"datetime\">2015-03-01T12:30:45Z</time>" \
+                "<type>HeartBeat</type>" \
+                "<info>" \
+                "<Temperature>25.00</Temperature> " \
+                "<Humidity>30.00</Humidity>   " \
+                "<Relay_1><mode>AUTO</mode><status>ON</status> </Relay_1>" \
+                "<Relay_2><mode>MANUAL</mode><status>OFF</status></Relay_2>" \
+                "<Sensor>ALIVE</Sensor>" \
+                "<Actuator>DEAD</Actuator>" \
+                "</info>" \
+                "</event>"
+
+# as encoded by the controller
+HEARTBEAT_COMPACT = "!1(A(D1425213045)(EHeartBeat)(F(K25.00)(L30.00)(M(OAUTO)(PON))" \
+                    "(N(OMANUAL)(POFF))(QALIVE)(RDEAD)))"
+
+
+class TestWireFormat(unittest.TestCase):
+    """ Testing of wire_format module
+    """
+
+    def test_message_to_compact_expected(self):
+        """ Test passes when message is encoded as the controller does
+        """
+        self.assertEqual(wire_format.to_compact(HEARTBEAT_XML), HEARTBEAT_COMPACT)
+
+    def test_compact_to_event_expected(self):
+        """ Test passes when compact message gives the same event as its XML
+        """
+        self.assertTrue(wire_format.is_compact(HEARTBEAT_COMPACT))
+        self.assertFalse(wire_format.is_compact(HEARTBEAT_XML))
+        event = ControllerEventFactory.create_event(
+            xmltodict.parse(wire_format.to_xml(HEARTBEAT_COMPACT)))
+        self.assertIsInstance(event, HeartBeatEvent)
+        self.assertEqual(event.measurement_data.temperature, 25.0)
+        self.assertEqual(event.relay_status.relay_2_mode, "MANUAL")
+        self.assertFalse(event.device_status.actuator_alive)
+        self.assertEqual(event.time.second, 45)
+
+    def test_unknown_names_and_escapes_expected(self):
+        """ Test passes when names missing from table and escaped characters round trip
+        """
+        message = "<command><info>a(b)c\\d</info><Extra>x &amp; y</Extra></command>"
+        compact = wire_format.to_compact(message)
+        self.assertEqual(compact, "!1(B(Fa\\(b\\)c\\\\d)('Extra'x &amp; y))")
+        self.assertEqual(wire_format.to_xml(compact), message)
+
+    def test_malformed_compact_exception_expected(self):
+        """ Test passes when malformed compact messages raise ValueError
+        """
+        for message in ("<event></event>", "!1(A(E)", "!1(A))", "!1(~)", "!1(A\\",
+                        "!1" + "(A" * 17 + ")" * 17):
+            with self.assertRaises(ValueError):
+                wire_format.to_xml(message)
+
+    def test_command_advertises_compact_expected(self):
+        """ Test passes when commands advertise compact wire format and response tells
+        whether controller decodes it
+        """
+        command = ControllerCommand(ControllerCommandEnum.ping)
+        self.assertIn("<wire>1</wire>", command.xml.decode("utf-8")
+                      if isinstance(command.xml, bytes) else command.xml)
+        self.assertTrue(wire_format.to_compact(command.xml).startswith("!1(B(D"))
+
+        response_xml = "<response><time type=\"datetime\">2014-11-28T15:30:09Z</time>" \
+                       "<info>RELAY_1_ON</info>{}</response>"
+        response = ControllerResponse(xmltodict.parse(response_xml.format("<wire>1</wire>")))
+        self.assertTrue(response.is_compact_supported)
+        response = ControllerResponse(xmltodict.parse(response_xml.format("")))
+        self.assertFalse(response.is_compact_supported)
+
+
+if __name__ == '__main__':
+    unittest.main()
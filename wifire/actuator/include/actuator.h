@@ -33,6 +33,8 @@ extern "C" {
 #include "flow/flowcore.h"
 #include "flow/flowmessaging.h"
 #include "queue_wrapper.h"
+#include "wire_format.h"
+#include "climate_proto.h"
 
 #define TAG_ARRAY_SIZE								(300)
 #define TAG_SIZE									(70)
@@ -63,6 +65,7 @@ typedef struct
 typedef struct
 {
 	unsigned int heartBeat;
+	WireFormat wireFormat; // Encoding of messages to controller, compact once its settings advertised it
 }ClimateActuatorConfig;
 
 
@@ -76,6 +79,7 @@ typedef struct
 {
 	Relay_State state;
 	char *xmlTagString;
+	unsigned int field; // In ClimateProto_ActuatorInfo
 }Relay;
 
 // currently all ClimateActuator datastructure are used in ClimateActuatorThread
@@ -35,6 +35,8 @@
 #include "climate_control_logging.h"
 #include "send_message.h"
 #include "flow_interface.h"
+#include "message_template.h"
+#include "climate_proto.h"
 
 #define CLIMATE_ACTUATOR_CMD_QUEUE_SIZE     (10)
 #define DEFAULT_HEART_BEAT_PERIOD			(15*1000) //millisecond
@@ -75,10 +77,10 @@ static void CommandsHandlerInternal(ClimateActuator* me, ControllerCmd* command)
 static ControllerCmd* ParseMsgAndCreateControllerCmd(const char* msgString);
 static void CreateAndQueueRelayStateMsg(ClimateActuator* me);
 static char* CreateHeartBeatMsg(ClimateActuator *me);
+static char* FormatHeartBeatMsg(ClimateActuator *me);
 static void SetRelayState(ClimateActuator* me, Relay_Num relayNum, Relay_State state);
-static bool NodeValueToInt(TreeNode root, unsigned int* valueToSet, char* nodeName);
 static void FreeControllerCmd(ControllerCmd *command);
-static ControllerCmd* CreateControllerCmd(char *cmd, const char *msgString, TreeNode xmlTreeRoot);
+static ControllerCmd* CreateControllerCmd(const ClimateProto_Command *command, const ClimateProto_ActuatorSettings *settings);
 static int  FindCommand(const char *cmd);
 
 static inline char* GetRelayStatusString(Relay_State state);
@@ -137,8 +139,19 @@ static void CreateAndQueueRelayStateMsg(ClimateActuator* me)
 {
 	MeasurementMsg msg;
 	char* msgDetails = CreateHeartBeatMsg(me);
+	if (msgDetails && (me->actuatorConfig.wireFormat == WireFormat_Compact))
+	{
+		//Controller takes XML too, so that is sent if encoding fails
+		char *compact = WireFormat_ToCompact(msgDetails);
+		if (compact)
+		{
+			Flow_MemFree((void **)&msgDetails);
+			msgDetails = compact;
+		}
+	}
 	msg.details = msgDetails;
 	msg.deviceId = FlowString_Duplicate(me->controllerId);
+	msg.sample.time = 0;	//Relay states are sent again with the next heartbeat
 	if (msg.details && msg.deviceId)
 	{
 		ClimateControl_Log(ClimateControlLogLevel_Debug, DEBUG_PREFIX "Sending message");
@@ -176,7 +189,7 @@ static void CreateAndQueueRelayStateMsg(ClimateActuator* me)
 	}
 
 }
-static char* CreateHeartBeatMsg(ClimateActuator *me)
+static char* FormatHeartBeatMsg(ClimateActuator *me)
 {
 	char *tempString = NULL;
 	time_t time;
@@ -185,39 +198,79 @@ static char* CreateHeartBeatMsg(ClimateActuator *me)
 	struct tm timeNow;
 	gmtime_r(&time, &timeNow);
 	char tagArray[TAG_ARRAY_SIZE] = {0};
+	ClimateProto_ActuatorInfo info = { 0 };
 	for (i = 0; i < Number_Of_Relays ; ++i)
 	{
-		unsigned int len;
-		char tag[TAG_SIZE] = {0};
-		len = strlen(me->relays[i].xmlTagString) + 5;
-		snprintf(tag, len, me->relays[i].xmlTagString, GetRelayStatusString(me->relays[i].state));
-		strncat(tagArray, tag, len);
+		ClimateProto_SetString(&ClimateProto_ActuatorInfoSchema, &info, me->relays[i].field,
+								GetRelayStatusString(me->relays[i].state));
 	}
-	const char *msgXML = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+	ClimateProto_Serialize(&ClimateProto_ActuatorInfoSchema, &info, tagArray, sizeof(tagArray));
+	const char *msgXML = CLIMATE_PROTO_XML_DECLARATION
 							"<event>"
-								"<time type=\"datetime\">%04d-%02d-%02dT%02d:%02d:%02dZ</time>"
+								CLIMATE_PROTO_TIME_XML
 								"<type>Actuator</type>"
 								"<info>"
 									"%s"
 								"</info>"
+								WIRE_FORMAT_XML_TAG
 							"</event>";
 	unsigned int stringSize = strlen(msgXML) + strlen(tagArray) + 1;
 	tempString = Flow_MemAlloc(stringSize);
 	if (tempString)
 	{
 		snprintf(tempString, stringSize, msgXML,
-				timeNow.tm_year + 1900,
-				timeNow.tm_mon + 1,
-				timeNow.tm_mday,
-				timeNow.tm_hour,
-				timeNow.tm_min,
-				timeNow.tm_sec,
+				CLIMATE_PROTO_TIME_ARGS(timeNow),
 				tagArray
 				);
 	}
 	return tempString;
 }
 
+/*
+ * Heartbeat from a template rendered on first use, with time and relay
+ * states patched in. Falls back to formatting if anything does not fit.
+ */
+static char* CreateHeartBeatMsg(ClimateActuator *me)
+{
+	static MessageTemplate msgTemplate;
+	static bool isRendered = false;
+	char *message;
+	time_t time;
+	unsigned int i;
+	bool success;
+
+	if (!isRendered)
+	{
+		MessageTemplate_Init(&msgTemplate);
+		MessageTemplate_AppendText(&msgTemplate, CLIMATE_PROTO_XML_DECLARATION "<event><time type=\"datetime\">");
+		MessageTemplate_AppendTime(&msgTemplate);
+		MessageTemplate_AppendText(&msgTemplate, "</time><type>Actuator</type><info>");
+		for (i = 0; i < Number_Of_Relays; ++i)
+		{
+			MessageTemplate_AppendFormat(&msgTemplate, me->relays[i].xmlTagString, strlen(OFF_STR));
+		}
+		MessageTemplate_AppendText(&msgTemplate, "</info>" WIRE_FORMAT_XML_TAG "</event>");
+		isRendered = true;
+	}
+
+	message = MessageTemplate_Copy(&msgTemplate);
+	if (message)
+	{
+		Flow_GetTime(&time);
+		success = MessageTemplate_SetTime(&msgTemplate, message, 0, time);
+		for (i = 0; (i < Number_Of_Relays) && success; ++i)
+		{
+			success = MessageTemplate_SetString(&msgTemplate, message, i + 1, GetRelayStatusString(me->relays[i].state));
+		}
+		if (success)
+		{
+			return message;
+		}
+		Flow_MemFree((void **)&message);
+	}
+	return FormatHeartBeatMsg(me);
+}
+
 static void CleanUp(ClimateActuator* me)
 {
 	if (me->sendMessageQueue)
@@ -234,80 +287,61 @@ static void CleanUp(ClimateActuator* me)
 	}
 }
 
-static ControllerCmd* CreateControllerCmd(char *cmd, const char *msgString, TreeNode xmlTreeRoot)
+static ControllerCmd* CreateControllerCmd(const ClimateProto_Command *command, const ClimateProto_ActuatorSettings *settings)
 {
 	ControllerCmd *controllerCmd  = NULL;
-	bool success = false;
+	ClimateActuatorConfig *config;
+	bool isSettings = (strcmp(UPDATE_SETTINGS_STR, command->info) == 0);
+	if (isSettings && !(settings->present & CLIMATE_PROTO_PRESENT(ActuatorSettings, heartBeat)))
+	{
+		return NULL;
+	}
 	controllerCmd = (ControllerCmd *) Flow_MemAlloc(sizeof (ControllerCmd));
 	if (controllerCmd)
 	{
-		controllerCmd->cmd = NULL;
+		controllerCmd->cmd = FlowString_Duplicate(command->info);
 		controllerCmd->payload = NULL;
-		unsigned int len = strlen(cmd);
-		controllerCmd->cmd = (char *) Flow_MemAlloc(len + 1);
-		if (controllerCmd->cmd)
+		if (isSettings)
 		{
-			strcpy(controllerCmd->cmd, cmd);
-			if (strcmp(UPDATE_SETTINGS_STR, cmd) == 0)
+			config = Flow_MemAlloc(sizeof (ClimateActuatorConfig));
+			controllerCmd->payload = config;
+			if (config)
 			{
-				unsigned int heartBeat;
-				if (NodeValueToInt(xmlTreeRoot, &heartBeat, "command/settings/HeartBeat"))
-				{
-					controllerCmd->payload = Flow_MemAlloc(sizeof (ClimateActuatorConfig));
-					if (controllerCmd->payload)
-					{
-						((ClimateActuatorConfig *) controllerCmd->payload)->heartBeat = heartBeat;
-						success = true;
-					}
-				}
-			}
-			else
-			{
-				success = true;
+				config->heartBeat = settings->heartBeat;
+				config->wireFormat = ClimateProto_WireFormat(command->wire);
 			}
 		}
-
-		if (!success)
+		if (controllerCmd->cmd && (controllerCmd->payload || !isSettings))
 		{
-			FreeControllerCmd(controllerCmd);
+			return controllerCmd;
 		}
+		FreeControllerCmd(controllerCmd);
 	}
-	return controllerCmd;
+	return NULL;
 }
 
 static ControllerCmd* ParseMsgAndCreateControllerCmd(const char* msgString)
 {
-	ControllerCmd *controllerCmd  = NULL;
-	if (msgString)
+	//<command>
+	//	<time type="datetime">2014-11-28T15:30:09Z</time>
+	//	<info>UPDATE_SETTINGS/RELAY_1_ON/RELAY_1_OFF/RELAY_2_ON/RELAY_2_OFF</info>
+	//	<wire>1</wire>
+	//	<settings>
+	//		<HeartBeat>1000</HeartBeat>
+	//	</settings>
+	//</command>
+	ClimateProto_Command command;
+	ClimateProto_ActuatorSettings settings;
+	if (ClimateProto_ParseCommand(msgString, &command, &ClimateProto_ActuatorSettingsSchema, &settings))
 	{
-		TreeNode xmlTreeRoot = TreeNode_ParseXML((uint8_t*)msgString, strlen(msgString), true);
-		if (xmlTreeRoot)
-		{
-			//<command>
-			//	<time type="datetime">2014-11-28T15:30:09Z</time>
-			//	<info>UPDATE_SETTINGS/RELAY_1_ON/RELAY_1_OFF/RELAY_2_ON/RELAY_2_OFF</info>
-			//      <settings>
-			//            <HeartBeat>1000</HeartBeat>
-			//      </seettings>
-			//</command>
-			//
-			TreeNode eventDetails = TreeNode_Navigate(xmlTreeRoot, "command/info");
-			if (eventDetails)
-			{
-				char *buf = (char *)TreeNode_GetValue(eventDetails);
-				if (buf && *buf)
-				{
-					controllerCmd = CreateControllerCmd(buf, msgString, xmlTreeRoot);
-				}
-			}
-			Tree_Delete(xmlTreeRoot);
-		}
+		return CreateControllerCmd(&command, &settings);
 	}
-	return controllerCmd;
+	return NULL;
 }
 
 static void UpdateSettings(ClimateActuator* me, ClimateActuatorConfig* config)
 {
+	me->actuatorConfig.wireFormat = config->wireFormat;
 	if(me->actuatorConfig.heartBeat != config->heartBeat)
 	{
 		ClimateControl_Log(ClimateControlLogLevel_Info, INFO_PREFIX "Changed heartbeat Timer period from %u msec  to %u msec", me->actuatorConfig.heartBeat, config->heartBeat);
@@ -396,21 +430,6 @@ static void ClimateActuatorThread(FlowThread thread, void *taskParameters)
 	}
 }
 
-static bool NodeValueToInt(TreeNode root, unsigned int* valueToSet, char* nodeName)
-{
-	TreeNode node = TreeNode_Navigate(root, nodeName);
-	if (node)
-	{
-		char *buf = (char *)TreeNode_GetValue(node);
-		if (buf && *buf)
-		{
-			*valueToSet = (unsigned int)strtoul (buf, NULL, 10);
-			return true;
-		}
-	}
-	return false;
-}
-
 static void FreeControllerCmd(ControllerCmd *command)
 {
 	if (command)
@@ -453,7 +472,7 @@ void ClimateActuator_Initialize(ClimateActuator* me)
 	Relay_Init();
 	me->sendMessageQueue = QueueCreate(SEND_MESSAGE_QUEUE_SIZE, sizeof (MeasurementMsg));
 	me->cmdQueue = QueueCreate(CLIMATE_ACTUATOR_CMD_QUEUE_SIZE, sizeof (ClimateActuatorCmd));
-	if (me->sendMessageQueue != 0 && me->cmdQueue != 0)
+	if (me->sendMessageQueue != 0 && me->cmdQueue != 0 && SendMessage_Init())
 	{
 		me->climateActuatorThread = FlowThread_New("ClimateActuatorThread",
 			USER_TASK_PRIORITY,
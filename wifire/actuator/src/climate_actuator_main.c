@@ -38,9 +38,11 @@ static ClimateActuator _actuator =
 	{
 		{
 			.xmlTagString = RELAY_1_XML_TAG,
+			.field = ClimateProto_ActuatorInfo_relay1,
 		},
 		{
 			.xmlTagString = RELAY_2_XML_TAG,
+			.field = ClimateProto_ActuatorInfo_relay2,
 		}
 	}
 };
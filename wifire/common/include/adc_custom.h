@@ -14,6 +14,8 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
+
 #define AN0				0
 #define AN1				1
 #define AN2				2
@@ -119,6 +121,62 @@ void adc12_Enable(void);
 unsigned int adc12_Read(int port);
 
 
+/*
+ *  adc12_ConfigFilter(filter, port, oversampling)
+ *
+ *  Arguments:		filter (0 - ADC12_NUM_FILTERS-1), port (AN0 - AN49), oversampling (2 - 256, power of 2)
+ *
+ *  Returnvalues:	NONE
+ *
+ *  Function:		Sets up the digital filter AD1FLTRx to average oversampling conversions of the given port
+ *
+ */
+#define ADC12_NUM_FILTERS		(6)
+void adc12_ConfigFilter(int filter, int port, unsigned int oversampling);
+
+
+/*
+ *  adc12_StartContinuous()
+ *
+ *  Arguments:		NONE
+ *
+ *  Returnvalues:	NONE
+ *
+ *  Function:		Scans the list over and over, triggered by the global level software trigger.
+ *					adc12_Read must not be used after.
+ *
+ */
+void adc12_StartContinuous(void);
+
+
+/*
+ *  adc12_DataReady(port), adc12_GetData(port)
+ *
+ *  Arguments:		port (AN0 - AN49)
+ *
+ *  Returnvalues:	whether a conversion of the port is ready, its data
+ *
+ *  Function:		Latest conversion of a port, without waiting
+ *
+ */
+bool adc12_DataReady(int port);
+unsigned int adc12_GetData(int port);
+
+
+/*
+ *  adc12_FilterReady(filter), adc12_GetFilterData(filter)
+ *
+ *  Arguments:		filter (0 - ADC12_NUM_FILTERS-1)
+ *
+ *  Returnvalues:	whether the filter has an average ready, the average
+ *
+ *  Function:		Latest average of a digital filter, without waiting
+ *
+ */
+bool adc12_FilterReady(int filter);
+unsigned int adc12_GetFilterData(int filter);
+
+
 
 #ifdef	__cplusplus
 }
@@ -0,0 +1,66 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+#ifndef ADC_SCAN_H
+#define	ADC_SCAN_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+/*
+ * Continuous sampling of analog inputs. The ADC scans its list over and
+ * over on its own, each input averaged in hardware by one of its digital
+ * filters, so readers take the latest value without starting a conversion
+ * or waiting for one. Inputs beyond the filters, or with oversampling 1,
+ * give their latest single conversion.
+ *
+ * Registers are reached through adc_custom.h only, simulated on host.
+ */
+
+#define ADC_SCAN_MAX_CHANNELS		(8)
+#define ADC_SCAN_MAX_OVERSAMPLING	(256)
+
+/* Stop scanning and forget all inputs */
+void AdcScan_Init(void);
+
+/*
+ * Add input port (as adc12_ConfigPort) to the scan, averaged over
+ * oversampling conversions, a power of 2. False if the input cannot be
+ * added, or oversampling is out of range. Inputs are added before start.
+ */
+bool AdcScan_AddChannel(int port, unsigned int oversampling);
+void AdcScan_Start(void);
+
+/* Latest value of port, false if it is not scanned or has no value yet */
+bool AdcScan_Latest(int port, unsigned int *value);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* ADC_SCAN_H */
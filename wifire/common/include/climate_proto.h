@@ -0,0 +1,217 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+#ifndef CLIMATE_PROTO_H
+#define CLIMATE_PROTO_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "flow/flowcore.h"
+#include "wire_format.h"
+
+/**
+ * Messages exchanged between sensor, controller and actuator, shared by
+ * all three so that each element is defined once.
+ *
+ * A schema describes the elements of one section of a message, e.g. the
+ * settings of a command, as an X-macro table. From it are generated a
+ * struct holding the values, with a bit per element in its present mask,
+ * and a table from which ClimateProto_Serialize() writes the section and
+ * ClimateProto_Parse() reads it back. Parsing scans the message text in
+ * place, so it allocates nothing. It expects messages as the peers write
+ * them: no entities or CDATA in values, and whitespace only between
+ * elements.
+ *
+ * Schema rows are X(schema, member, type, element name), in the order
+ * elements are written. Elements may be added, as parsers skip those they
+ * do not know, but a schema holds at most 32.
+ *
+ * A schema may also describe records repeated in the text of one element,
+ * with values in schema order separated by ',' and records by ';', e.g.
+ * <samples>1000,2150,4000;1060,-300,65535</samples>. Their element names
+ * are then unused, and values may only be appended to a record.
+ */
+
+#define CLIMATE_PROTO_XML_DECLARATION "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+
+//Time element every message starts with, formatted from a struct tm
+#define CLIMATE_PROTO_TIME_XML "<time type=\"datetime\">%04d-%02d-%02dT%02d:%02d:%02dZ</time>"
+#define CLIMATE_PROTO_TIME_ARGS(tm) \
+	(tm).tm_year + 1900, (tm).tm_mon + 1, (tm).tm_mday, (tm).tm_hour, (tm).tm_min, (tm).tm_sec
+
+#define CLIMATE_PROTO_STRING_SIZE (32)
+
+//Root of several events sent as one message, see ClimateProto_NextEvent()
+#define CLIMATE_PROTO_EVENTS_ROOT "events"
+//Type of the event carrying samples a sensor kept through a network outage,
+//as <count>n</count><samples>time,temperature,humidity;...</samples>, records
+//of the Sample schema with seconds since epoch and values in hundredths,
+//these if there was none
+#define CLIMATE_PROTO_SENSOR_LOG "SensorLog"
+#define CLIMATE_PROTO_NO_TEMPERATURE (-32768)
+#define CLIMATE_PROTO_NO_HUMIDITY (65535)
+//Calibration of a sensor's readings, value = offset + gain * reading + curve * reading^2,
+//sent in fixed point with these fraction bits, so that the sensor applies it in integers
+#define CLIMATE_PROTO_OFFSET_FRACTION_BITS (8)
+#define CLIMATE_PROTO_GAIN_FRACTION_BITS (16)
+#define CLIMATE_PROTO_CURVE_FRACTION_BITS (24)
+//Weight of a new reading in a sensor's smoothing filter, in fixed point
+//with these fraction bits, as 2 decimals would round it
+#define CLIMATE_PROTO_FILTER_ALPHA_FRACTION_BITS (16)
+
+#define CLIMATE_PROTO_COMMAND(X) \
+	X(Command, info, String, "info") \
+	X(Command, wire, Uint, "wire")
+
+#define CLIMATE_PROTO_EVENT(X) \
+	X(Event, type, String, "type") \
+	X(Event, seq, Uint, "seq") \
+	X(Event, base, Uint, "base") \
+	X(Event, wire, Uint, "wire") \
+	X(Event, count, Uint, "count")
+
+#define CLIMATE_PROTO_SAMPLE(X) \
+	X(Sample, time, Uint, "time") \
+	X(Sample, temperature, Int, "temperature") \
+	X(Sample, humidity, Uint, "humidity")
+
+#define CLIMATE_PROTO_SENSOR_INFO(X) \
+	X(SensorInfo, temperature, Float, "Temperature") \
+	X(SensorInfo, humidity, Float, "Humidity")
+
+#define CLIMATE_PROTO_ACTUATOR_INFO(X) \
+	X(ActuatorInfo, relay1, String, "Relay_1") \
+	X(ActuatorInfo, relay2, String, "Relay_2")
+
+#define CLIMATE_PROTO_SENSOR_SETTINGS(X) \
+	X(SensorSettings, heartBeat, Uint, "HeartBeat") \
+	X(SensorSettings, temperatureReadInterval, Uint, "TemperatureReadInterval") \
+	X(SensorSettings, humidityReadInterval, Uint, "HumidityReadInterval") \
+	X(SensorSettings, temperatureReadDelta, Float, "TemperatureReadDelta") \
+	X(SensorSettings, humidityReadDelta, Float, "HumidityReadDelta") \
+	X(SensorSettings, heartBeatKeyframe, Uint, "HeartBeatKeyframe") \
+	X(SensorSettings, temperatureMedianSize, Uint, "TemperatureMedianSize") \
+	X(SensorSettings, humidityMedianSize, Uint, "HumidityMedianSize") \
+	X(SensorSettings, temperatureFilterAlpha, Uint, "TemperatureFilterAlpha") \
+	X(SensorSettings, humidityFilterAlpha, Uint, "HumidityFilterAlpha") \
+	X(SensorSettings, temperatureMaxReadInterval, Uint, "TemperatureMaxReadInterval") \
+	X(SensorSettings, humidityMaxReadInterval, Uint, "HumidityMaxReadInterval") \
+	X(SensorSettings, temperatureOffset, Int, "TemperatureOffset") \
+	X(SensorSettings, humidityOffset, Int, "HumidityOffset") \
+	X(SensorSettings, temperatureGain, Int, "TemperatureGain") \
+	X(SensorSettings, humidityGain, Int, "HumidityGain") \
+	X(SensorSettings, temperatureCurve, Int, "TemperatureCurve") \
+	X(SensorSettings, humidityCurve, Int, "HumidityCurve")
+
+#define CLIMATE_PROTO_ACTUATOR_SETTINGS(X) \
+	X(ActuatorSettings, heartBeat, Uint, "HeartBeat")
+
+//Schemas, as X(schema, path of section, table)
+#define CLIMATE_PROTO_SCHEMAS(X) \
+	X(Command, "command", CLIMATE_PROTO_COMMAND) \
+	X(Event, "event", CLIMATE_PROTO_EVENT) \
+	X(Sample, "event/samples", CLIMATE_PROTO_SAMPLE) \
+	X(SensorInfo, "event/info", CLIMATE_PROTO_SENSOR_INFO) \
+	X(ActuatorInfo, "event/info", CLIMATE_PROTO_ACTUATOR_INFO) \
+	X(SensorSettings, "command/settings", CLIMATE_PROTO_SENSOR_SETTINGS) \
+	X(ActuatorSettings, "command/settings", CLIMATE_PROTO_ACTUATOR_SETTINGS)
+
+typedef unsigned int ClimateProto_Uint;
+typedef int ClimateProto_Int;
+typedef float ClimateProto_Float;	//Written with 2 decimals
+typedef char ClimateProto_String[CLIMATE_PROTO_STRING_SIZE];
+
+typedef enum
+{
+	ClimateProto_TypeUint,
+	ClimateProto_TypeInt,
+	ClimateProto_TypeFloat,
+	ClimateProto_TypeString,
+}ClimateProto_Type;
+
+typedef struct
+{
+	const char *name;
+	ClimateProto_Type type;
+	size_t offset;
+}ClimateProto_Field;
+
+typedef struct
+{
+	const char *path;	//Of the element holding the fields
+	const ClimateProto_Field *fields;
+	unsigned int fieldCount;
+	size_t size;	//Of the generated struct
+}ClimateProto_Schema;
+
+//Bit of an element in the present mask of its schema's struct
+#define CLIMATE_PROTO_PRESENT(schema, member) (1u << ClimateProto_##schema##_##member)
+
+#define CLIMATE_PROTO_FIELD_INDEX(schema, member, type, name) ClimateProto_##schema##_##member,
+#define CLIMATE_PROTO_FIELD_MEMBER(schema, member, type, name) ClimateProto_##type member;
+
+//Field indexes, struct with the present mask first, and schema
+#define CLIMATE_PROTO_DECLARE(schema, path, table) \
+	enum { table(CLIMATE_PROTO_FIELD_INDEX) ClimateProto_##schema##_FieldCount }; \
+	typedef struct \
+	{ \
+		unsigned int present; \
+		table(CLIMATE_PROTO_FIELD_MEMBER) \
+	}ClimateProto_##schema; \
+	extern const ClimateProto_Schema ClimateProto_##schema##Schema;
+
+CLIMATE_PROTO_SCHEMAS(CLIMATE_PROTO_DECLARE)
+
+int ClimateProto_Serialize(const ClimateProto_Schema *schema, const void *message, char *buffer, size_t size);
+bool ClimateProto_Parse(const ClimateProto_Schema *schema, const char *xml, void *message);
+
+bool ClimateProto_GetUint(const ClimateProto_Schema *schema, const void *message, unsigned int field, unsigned int *value);
+bool ClimateProto_GetInt(const ClimateProto_Schema *schema, const void *message, unsigned int field, int *value);
+bool ClimateProto_GetFloat(const ClimateProto_Schema *schema, const void *message, unsigned int field, float *value);
+void ClimateProto_SetUint(const ClimateProto_Schema *schema, void *message, unsigned int field, unsigned int value);
+void ClimateProto_SetInt(const ClimateProto_Schema *schema, void *message, unsigned int field, int value);
+void ClimateProto_SetFloat(const ClimateProto_Schema *schema, void *message, unsigned int field, float value);
+bool ClimateProto_SetString(const ClimateProto_Schema *schema, void *message, unsigned int field, const char *value);
+
+bool ClimateProto_NextEvent(const char *xml, const char **cursor, const char **event);
+bool ClimateProto_NextRecord(const ClimateProto_Schema *schema, const char *xml, const char **cursor, void *record);
+bool ClimateProto_ParseCommand(const char *msgString, ClimateProto_Command *command,
+								const ClimateProto_Schema *settingsSchema, void *settings);
+WireFormat ClimateProto_WireFormat(unsigned int version);
+
+bool ClimateProto_NodeValueToInt(TreeNode root, unsigned int *valueToSet, const char *nodeName);
+bool ClimateProto_NodeValueToFloat(TreeNode root, float *valueToSet, const char *nodeName);
+bool ClimateProto_NodeValueToString(TreeNode root, char *valueToSet, size_t size, const char *nodeName);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* CLIMATE_PROTO_H */
@@ -0,0 +1,99 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+
+#ifndef MESSAGE_TEMPLATE_H
+#define MESSAGE_TEMPLATE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * Pre-rendered message, for messages whose shape never changes and where
+ * only a few fields do. The skeleton is rendered once, with a fixed width
+ * slot per field, and a message is a copy of it with its slots patched.
+ *
+ * A slot holds its value and the closing tag that follows it, then spaces
+ * up to the slot's width, so a shorter value leaves whitespace between
+ * elements rather than inside one: "<status>ON</status> ". XML parsers
+ * ignore it, and values read back exactly as with snprintf.
+ *
+ * Slots are numbered in the order they are appended. A value that does
+ * not fit its slot fails the patch, so the caller can fall back to
+ * formatting the message.
+ */
+
+#define MESSAGE_TEMPLATE_SIZE (512)
+#define MESSAGE_TEMPLATE_MAX_SLOTS (12)
+#define MESSAGE_TEMPLATE_SUFFIX_SIZE (24)
+#define MESSAGE_TEMPLATE_TIME_WIDTH (20)	//2017-07-14T14:00:00Z
+#define MESSAGE_TEMPLATE_FLOAT_WIDTH (9)	//-99999.99
+
+typedef enum
+{
+	TemplateSlot_Time,
+	TemplateSlot_Float,
+	TemplateSlot_String,
+}TemplateSlot_Type;
+
+typedef struct
+{
+	uint16_t offset;	//Of value in text
+	uint8_t valueWidth;
+	uint8_t decimals;	//TemplateSlot_Float only
+	TemplateSlot_Type type;
+	uint8_t suffixLength;
+	char suffix[MESSAGE_TEMPLATE_SUFFIX_SIZE];	//Closing tag written after value
+}TemplateSlot;
+
+typedef struct
+{
+	char text[MESSAGE_TEMPLATE_SIZE];
+	unsigned int length;
+	TemplateSlot slots[MESSAGE_TEMPLATE_MAX_SLOTS];
+	unsigned int slotCount;
+	bool isValid;	//Rendered completely, false if anything did not fit
+}MessageTemplate;
+
+void MessageTemplate_Init(MessageTemplate *me);
+bool MessageTemplate_AppendText(MessageTemplate *me, const char *text);
+bool MessageTemplate_AppendTime(MessageTemplate *me);
+bool MessageTemplate_AppendFormat(MessageTemplate *me, const char *format, unsigned int stringWidth);
+
+char *MessageTemplate_Copy(const MessageTemplate *me);
+bool MessageTemplate_SetTime(const MessageTemplate *me, char *message, unsigned int slot, time_t time);
+bool MessageTemplate_SetFloat(const MessageTemplate *me, char *message, unsigned int slot, float value);
+bool MessageTemplate_SetString(const MessageTemplate *me, char *message, unsigned int slot, const char *value);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* MESSAGE_TEMPLATE_H */
@@ -33,9 +33,11 @@ extern "C" {
 
 #include "FreeRTOS.h"
 #include "queue.h"
+#include "semphr.h"
 #include <stdbool.h>
 	
 typedef QueueHandle_t QueueHandle;
+typedef SemaphoreHandle_t MutexHandle;
 
 /**
  * \memberof 
@@ -78,6 +80,30 @@ bool QueueReceive(QueueHandle queue, void * data, int msec);
 */
 unsigned int QueueNumOfItems(QueueHandle queue);
 
+/**
+ * \memberof
+ * \param
+ * \brief Creates mutex, a FreeRTOS queue of its own, returns 0 if creation fails
+ *
+*/
+MutexHandle MutexCreate(void);
+
+/**
+ * \memberof
+ * \param
+ * \brief Takes mutex, blocks until it is free
+ *
+*/
+void MutexLock(MutexHandle mutex);
+
+/**
+ * \memberof
+ * \param
+ * \brief Gives back mutex taken with MutexLock
+ *
+*/
+void MutexUnlock(MutexHandle mutex);
+
 #ifdef	__cplusplus
 }
 #endif
@@ -0,0 +1,76 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+
+#ifndef SAMPLE_BUFFER_H
+#define SAMPLE_BUFFER_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Measurements kept in RAM while they cannot be sent, to be uploaded once
+ * the network is back, as CLIMATE_PROTO_SENSOR_LOG events. Each is a
+ * fixed 8 byte record rather than its XML message, so the ring holds a
+ * few minutes of readings in 2 KB. When full, the oldest is overwritten.
+ *
+ * The send thread keeps and uploads the samples, and the sensor thread
+ * keeps those it cannot queue, so the ring is guarded by a mutex made by
+ * SampleBuffer_Init, which must be called before either thread starts.
+ */
+
+#define SAMPLE_BUFFER_SIZE			(256)
+
+typedef struct
+{
+	uint32_t time;	//seconds since epoch, 0 if there is no sample
+	int16_t temperature;	//centi degree centigrade, CLIMATE_PROTO_NO_TEMPERATURE if not read
+	uint16_t humidity;	//centi percentage, CLIMATE_PROTO_NO_HUMIDITY if not read
+}StoredSample;
+
+bool SampleBuffer_Init(void);
+void SampleBuffer_MakeSample(StoredSample *sample, time_t time, float temperature, float humidity);
+void SampleBuffer_Push(const StoredSample *sample);
+unsigned int SampleBuffer_Peek(StoredSample *samples, unsigned int max);
+void SampleBuffer_Drop(unsigned int count);
+unsigned int SampleBuffer_Count(void);
+unsigned long SampleBuffer_Overwritten(void);
+
+/*
+ * Returns a CLIMATE_PROTO_SENSOR_LOG event of the samples, allocated with
+ * Flow_MemAlloc, or NULL if allocation failed.
+ */
+char *SampleBuffer_CreateLogXML(const StoredSample *samples, unsigned int count, time_t time);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* SAMPLE_BUFFER_H */
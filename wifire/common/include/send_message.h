@@ -24,6 +24,7 @@
 *******************************************************************************************************/
 
 #include "flow/flowcore.h"
+#include "sample_buffer.h"
 
 #ifndef SEND_MESSAGE_H
 #define	SEND_MESSAGE_H
@@ -33,14 +34,60 @@ extern "C" {
 #endif
 
 #define SEND_MESSAGE_QUEUE_SIZE		(10)
+#define SEND_BATCH_MAX_SIZE			(2048)	//Bytes of a merged payload
+#define SEND_BATCH_WINDOW			(200)	//ms a batch waits for more messages
+#define SEND_STATS_PERIOD			(60000)	//ms between uplink reports
+#define SAMPLE_UPLOAD_BATCH			(16)	//Stored samples per upload
+#define SAMPLE_UPLOAD_INTERVAL		(500)	//ms at least between uploads
+#define SAMPLE_RETRY_INTERVAL		(2000)	//ms between sends while offline
 
 typedef struct
 {
 	char *deviceId;
 	char *details;
+	StoredSample sample;	//Kept if the message cannot be sent, time 0 if none
 }MeasurementMsg;
 
+/*
+ * What the send thread does with messages queued for the same device
+ * while a batch is open, i.e. within SEND_BATCH_WINDOW of the first.
+ */
+typedef enum
+{
+	SendBatch_Off,	//Each sent on its own, as it comes
+	SendBatch_Merge,	//Sent together as one <events> message
+	SendBatch_Latest,	//Only the last sent, as each is a full snapshot
+}SendBatchMode;
+
+typedef struct
+{
+	unsigned long queued;	//Messages taken from the queue
+	unsigned long sent;	//Messages sent to the cloud, batches counting once
+	unsigned long merged;	//Messages sent inside a batch
+	unsigned long superseded;	//Messages dropped for a later one
+	unsigned long failed;	//Messages not sent after retries
+	unsigned long stored;	//Samples kept while offline
+	unsigned long uploaded;	//Stored samples sent since
+	unsigned long lost;	//Messages without sample dropped while offline
+	bool isOffline;	//Since the last send failed
+	unsigned int queueHighWater;	//Most messages seen in the queue
+	unsigned int sentPerMinute;	//Over the last SEND_STATS_PERIOD
+}SendMessageStats;
+
+/*
+ * Creates the locks of the stored samples; call before starting the send
+ * thread. Returns false if that failed.
+ */
+bool SendMessage_Init(void);
 void SendMessageThread(FlowThread thread, void *taskParameters);
+void SendMessage_SetBatchMode(SendBatchMode mode);
+void SendMessage_GetStats(SendMessageStats *stats);
+
+/*
+ * Keep the sample of a message that could not be sent, to upload later.
+ * Also called by the thread queuing messages if the queue is full.
+ */
+void SendMessage_KeepSample(const MeasurementMsg *msg);
 
 #ifdef	__cplusplus
 }
@@ -0,0 +1,80 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+
+#ifndef WIRE_FORMAT_H
+#define WIRE_FORMAT_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+/**
+ * Compact encoding of the XML messages exchanged between sensor,
+ * controller, actuator and user. Element names are replaced by one
+ * character codes from a table shared by all peers, datetimes by seconds
+ * since epoch, and the prolog and whitespace between elements are dropped:
+ *
+ *	message = "!1" element
+ *	element = "(" name *(element / text) ")"
+ *	name = code / "'" xml-name "'"	names missing from the table are spelt out
+ *	text = XML character data, with "(", ")" and "\" escaped by "\"
+ *
+ * Flow messaging carries text/plain content, so the encoding is kept
+ * printable. A message is the same tree as its XML form, so it is decoded
+ * back to XML and parsed as before.
+ *
+ * Peers advertise they decode it with WIRE_FORMAT_XML_TAG in their
+ * messages, and are sent compact messages only once they did. Received
+ * messages are detected per message, so either form is always accepted.
+ */
+
+#define WIRE_FORMAT_VERSION "1"
+#define WIRE_FORMAT_PREFIX "!" WIRE_FORMAT_VERSION
+#define WIRE_FORMAT_XML_TAG "<wire>" WIRE_FORMAT_VERSION "</wire>"
+#define WIRE_FORMAT_MAX_DEPTH (16)
+
+typedef enum
+{
+	WireFormat_Xml,
+	WireFormat_Compact,
+}WireFormat;
+
+bool WireFormat_IsCompact(const char *content);
+
+/**
+ * Both return a message allocated with Flow_MemAlloc, or NULL if the input
+ * is malformed or allocation failed.
+ */
+char *WireFormat_ToCompact(const char *xml);
+char *WireFormat_ToXml(const char *compact);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* WIRE_FORMAT_H */
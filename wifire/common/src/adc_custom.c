@@ -399,11 +399,11 @@ int adc12_SampleReady(int port)
 {
 	if (port <= AN31)
 	{
-		return (AD1DSTAT1 && (1 << port));
+		return (AD1DSTAT1 & (1 << port)) != 0;
 	}
 	else
 	{
-		return (AD1DSTAT2 && (1 << (port-31)));
+		return (AD1DSTAT2 & (1 << (port-32))) != 0;
 	};
 };
 
@@ -411,14 +411,7 @@ int adc12_SampleReady(int port)
 //
 void adc12_Wait(int port)
 {
-	if (port <= AN31)
-	{
-		while ((AD1DSTAT1 && (1 << port)) == 0);
-	}
-	else
-	{
-		while ((AD1DSTAT2 && (1 << (port-31))) == 0);
-	};
+	while (adc12_SampleReady(port) == 0);
 };
 
 
@@ -440,3 +433,76 @@ unsigned int adc12_Read(int port)
 	adc12_Wait(port);
 	return adc12_GetSample(port);
 };
+
+
+//
+static volatile unsigned int *adc12_FilterRegister(int filter)
+{
+	switch (filter)
+	{
+		case 0:
+			return &AD1FLTR1;
+		case 1:
+			return &AD1FLTR2;
+		case 2:
+			return &AD1FLTR3;
+		case 3:
+			return &AD1FLTR4;
+		case 4:
+			return &AD1FLTR5;
+		default:
+			return &AD1FLTR6;
+	};
+};
+
+
+//
+void adc12_ConfigFilter(int filter, int port, unsigned int oversampling)
+{
+	unsigned int ratio = 0;					// Averaging mode: OVRSAM 0 averages 2 conversions, 7 averages 256
+
+	while ((ratio < 7) && ((2u << ratio) < oversampling))
+	{
+		ratio++;
+	};
+	*adc12_FilterRegister(filter) = _AD1FLTR1_AFEN_MASK
+									| _AD1FLTR1_DFMODE_MASK
+									| (ratio << _AD1FLTR1_OVRSAM_POSITION)
+									| (convert_AINtoAN(port) << _AD1FLTR1_CHNLID_POSITION);
+};
+
+
+//
+void adc12_StartContinuous(void)
+{
+	AD1CON1bits.STRGSRC = 2;			// Scan Trigger Src = Global Level Software Trigger (GLSWTRG)
+	AD1CON3bits.GLSWTRG = 1;			// Not self-clearing, so the list is scanned till it is cleared
+};
+
+
+//
+bool adc12_DataReady(int port)
+{
+	return adc12_SampleReady(convert_AINtoAN(port));
+};
+
+
+//
+unsigned int adc12_GetData(int port)
+{
+	return adc12_GetSample(convert_AINtoAN(port));
+};
+
+
+//
+bool adc12_FilterReady(int filter)
+{
+	return (*adc12_FilterRegister(filter) & _AD1FLTR1_AFRDY_MASK) != 0;
+};
+
+
+//
+unsigned int adc12_GetFilterData(int filter)
+{
+	return (*adc12_FilterRegister(filter) & _AD1FLTR1_FLTRDATA_MASK) >> _AD1FLTR1_FLTRDATA_POSITION;
+};
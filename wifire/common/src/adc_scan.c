@@ -0,0 +1,113 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+#include "adc_custom.h"
+#include "adc_scan.h"
+
+typedef struct
+{
+	int port;
+	int filter;	// ADC12_NUM_FILTERS if not averaged
+	unsigned int latest;
+	bool hasValue;
+}AdcScanChannel;
+
+static AdcScanChannel _channels[ADC_SCAN_MAX_CHANNELS];
+static unsigned int _numChannels;
+static int _numFilters;
+static bool _isStarted;
+
+static bool IsPowerOf2(unsigned int value)
+{
+	return (value != 0) && ((value & (value - 1)) == 0);
+}
+
+void AdcScan_Init(void)
+{
+	_numChannels = 0;
+	_numFilters = 0;
+	_isStarted = false;
+	adc12_Init();
+}
+
+bool AdcScan_AddChannel(int port, unsigned int oversampling)
+{
+	AdcScanChannel *channel;
+
+	if (_isStarted || (_numChannels == ADC_SCAN_MAX_CHANNELS) || !IsPowerOf2(oversampling)
+		|| (oversampling > ADC_SCAN_MAX_OVERSAMPLING))
+	{
+		return false;
+	}
+	channel = &_channels[_numChannels++];
+	channel->port = port;
+	channel->filter = ADC12_NUM_FILTERS;
+	channel->hasValue = false;
+	adc12_ConfigPort(port);
+	if ((oversampling > 1) && (_numFilters < ADC12_NUM_FILTERS))
+	{
+		channel->filter = _numFilters++;
+		adc12_ConfigFilter(channel->filter, port, oversampling);
+	}
+	return true;
+}
+
+void AdcScan_Start(void)
+{
+	adc12_Enable();
+	adc12_StartContinuous();
+	_isStarted = true;
+}
+
+bool AdcScan_Latest(int port, unsigned int *value)
+{
+	unsigned int i;
+
+	for (i = 0; _isStarted && (i < _numChannels); ++i)
+	{
+		AdcScanChannel *channel = &_channels[i];
+
+		if (channel->port != port)
+		{
+			continue;
+		}
+		if (channel->filter < ADC12_NUM_FILTERS)
+		{
+			if (adc12_FilterReady(channel->filter))
+			{
+				channel->latest = adc12_GetFilterData(channel->filter);
+				channel->hasValue = true;
+			}
+		}
+		else if (adc12_DataReady(port))
+		{
+			channel->latest = adc12_GetData(port);
+			channel->hasValue = true;
+		}
+		*value = channel->latest;
+		return channel->hasValue;
+	}
+	return false;
+}
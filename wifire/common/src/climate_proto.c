@@ -0,0 +1,571 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "climate_proto.h"
+#include "flow/flowcore.h"
+
+#define CLIMATE_PROTO_FIELD(schema, member, type, name) \
+	{ name, ClimateProto_Type##type, offsetof(ClimateProto_##schema, member) },
+
+#define CLIMATE_PROTO_DEFINE(schema, path, table) \
+	static const ClimateProto_Field _##schema##Fields[] = { table(CLIMATE_PROTO_FIELD) }; \
+	const ClimateProto_Schema ClimateProto_##schema##Schema = \
+	{ \
+		path, \
+		_##schema##Fields, \
+		ClimateProto_##schema##_FieldCount, \
+		sizeof(ClimateProto_##schema), \
+	};
+
+CLIMATE_PROTO_SCHEMAS(CLIMATE_PROTO_DEFINE)
+
+//Content of an element, from after its start tag to its end tag
+typedef struct
+{
+	const char *start;
+	const char *end;
+}Span;
+
+static bool IsNameEnd(char c)
+{
+	return (c == '>') || (c == '/') || (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n');
+}
+
+static const char *FindChar(const char *p, const char *end, char c)
+{
+	while ((p < end) && (*p != c))
+	{
+		p++;
+	}
+	return p;
+}
+
+static bool IsName(const Span *name, const char *value, size_t length)
+{
+	return ((size_t)(name->end - name->start) == length) && (strncmp(name->start, value, length) == 0);
+}
+
+/**
+ * Next element among the children of a parent, from *cursor, skipping
+ * the descendants of each. Processing instructions and comments are
+ * passed over. Sets the element's name and content, and moves the cursor
+ * past its end tag.
+ */
+static bool NextChild(const char **cursor, const char *end, Span *name, Span *child)
+{
+	const char *p = *cursor;
+	const char *tagEnd;
+	int depth = 0;
+
+	while ((p = FindChar(p, end, '<')) < end)
+	{
+		tagEnd = FindChar(p, end, '>');
+		if (tagEnd == end)
+		{
+			return false;
+		}
+		if ((p[1] == '?') || (p[1] == '!'))
+		{
+			//Declaration or comment
+		}
+		else if (p[1] == '/')
+		{
+			if (depth == 0)
+			{
+				//End tag of parent
+				return false;
+			}
+			if (--depth == 0)
+			{
+				child->end = p;
+				*cursor = tagEnd + 1;
+				return true;
+			}
+		}
+		else if (depth == 0)
+		{
+			//Name ends by the '>' at the latest
+			name->start = p + 1;
+			name->end = name->start;
+			while (!IsNameEnd(*name->end))
+			{
+				name->end++;
+			}
+			if (tagEnd[-1] == '/')
+			{
+				//Empty element
+				child->start = tagEnd;
+				child->end = tagEnd;
+				*cursor = tagEnd + 1;
+				return true;
+			}
+			child->start = tagEnd + 1;
+			depth++;
+		}
+		else if (tagEnd[-1] != '/')
+		{
+			depth++;
+		}
+		p = tagEnd + 1;
+	}
+	return false;
+}
+
+static bool FindChild(const Span *parent, const char *name, size_t nameLength, Span *child)
+{
+	const char *cursor = parent->start;
+	const char *end = parent->end;	//Child may be parent
+	Span childName;
+
+	while (NextChild(&cursor, end, &childName, child))
+	{
+		if (IsName(&childName, name, nameLength))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Whether the first element of a document, after any declaration or
+ * comments, is called name. Saves scanning other messages to their end.
+ */
+static bool IsRoot(const char *xml, const char *name, size_t nameLength)
+{
+	const char *p = xml;
+
+	while ((p = strchr(p, '<')) && ((p[1] == '?') || (p[1] == '!')))
+	{
+		p++;
+	}
+	return p && (strncmp(p + 1, name, nameLength) == 0) && IsNameEnd(p[1 + nameLength]);
+}
+
+/**
+ * Content of the element at path, e.g. "command/settings", where the
+ * first name is that of the root element.
+ */
+static bool Navigate(const char *xml, const char *path, Span *span)
+{
+	const char *name = path;
+	const char *nameEnd;
+
+	span->start = xml;
+	span->end = xml + strlen(xml);
+	while (*name)
+	{
+		nameEnd = strchr(name, '/');
+		if (!nameEnd)
+		{
+			nameEnd = name + strlen(name);
+		}
+		if (((name == path) && !IsRoot(xml, name, nameEnd - name)) ||
+			!FindChild(span, name, nameEnd - name, span))
+		{
+			return false;
+		}
+		name = *nameEnd ? nameEnd + 1 : nameEnd;
+	}
+	return true;
+}
+
+static bool ReadField(const ClimateProto_Field *field, const Span *span, void *message)
+{
+	char *value = (char *)message + field->offset;
+	size_t length = span->end - span->start;
+
+	//Empty elements are taken as missing, as by TreeNode
+	if (length == 0)
+	{
+		return false;
+	}
+	switch (field->type)
+	{
+		case ClimateProto_TypeUint:
+			//Value is followed by its end tag, where conversion stops
+			*(unsigned int *)value = (unsigned int)strtoul(span->start, NULL, 10);
+			return true;
+		case ClimateProto_TypeInt:
+			*(int *)value = (int)strtol(span->start, NULL, 10);
+			return true;
+		case ClimateProto_TypeFloat:
+			*(float *)value = (float)strtod(span->start, NULL);
+			return true;
+		case ClimateProto_TypeString:
+			if (length >= CLIMATE_PROTO_STRING_SIZE)
+			{
+				return false;
+			}
+			memcpy(value, span->start, length);
+			value[length] = '\0';
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Writes the present elements of message, in schema order, and returns
+ * their length. As with snprintf, the text was written in full only if
+ * that is less than size.
+ */
+int ClimateProto_Serialize(const ClimateProto_Schema *schema, const void *message, char *buffer, size_t size)
+{
+	unsigned int present = *(const unsigned int *)message;
+	size_t length = 0;
+	unsigned int i;
+	int written = 0;
+
+	if (size)
+	{
+		buffer[0] = '\0';
+	}
+	for (i = 0; i < schema->fieldCount; ++i)
+	{
+		const ClimateProto_Field *field = &schema->fields[i];
+		const char *value = (const char *)message + field->offset;
+		char *out = (length < size) ? buffer + length : NULL;
+		size_t space = (length < size) ? size - length : 0;
+
+		if (!(present & (1u << i)))
+		{
+			continue;
+		}
+		switch (field->type)
+		{
+			case ClimateProto_TypeUint:
+				written = snprintf(out, space, "<%s>%u</%s>", field->name, *(const unsigned int *)value, field->name);
+				break;
+			case ClimateProto_TypeInt:
+				written = snprintf(out, space, "<%s>%d</%s>", field->name, *(const int *)value, field->name);
+				break;
+			case ClimateProto_TypeFloat:
+				written = snprintf(out, space, "<%s>%0.2f</%s>", field->name, *(const float *)value, field->name);
+				break;
+			case ClimateProto_TypeString:
+				written = snprintf(out, space, "<%s>%s</%s>", field->name, value, field->name);
+				break;
+		}
+		if (written < 0)
+		{
+			return written;
+		}
+		length += written;
+	}
+	return (int)length;
+}
+
+/**
+ * Reads the section of the schema from xml into message, which is cleared
+ * first. Elements missing, empty or not fitting their member are left out
+ * of its present mask. Returns false if the message has no such section.
+ */
+bool ClimateProto_Parse(const ClimateProto_Schema *schema, const char *xml, void *message)
+{
+	Span section, name, span;
+	const char *cursor;
+	unsigned int seen = 0;
+	unsigned int i;
+
+	memset(message, 0, schema->size);
+	if (!xml || !Navigate(xml, schema->path, &section))
+	{
+		return false;
+	}
+	//One pass over the section, looking each element up in the schema
+	cursor = section.start;
+	while (NextChild(&cursor, section.end, &name, &span))
+	{
+		for (i = 0; i < schema->fieldCount; ++i)
+		{
+			const ClimateProto_Field *field = &schema->fields[i];
+
+			if (IsName(&name, field->name, strlen(field->name)))
+			{
+				//First of elements with the same name is taken
+				if (!(seen & (1u << i)) && ReadField(field, &span, message))
+				{
+					*(unsigned int *)message |= 1u << i;
+				}
+				seen |= 1u << i;
+				break;
+			}
+		}
+	}
+	return true;
+}
+
+bool ClimateProto_GetUint(const ClimateProto_Schema *schema, const void *message, unsigned int field, unsigned int *value)
+{
+	if ((field < schema->fieldCount) && (schema->fields[field].type == ClimateProto_TypeUint) &&
+		(*(const unsigned int *)message & (1u << field)))
+	{
+		*value = *(const unsigned int *)((const char *)message + schema->fields[field].offset);
+		return true;
+	}
+	return false;
+}
+
+bool ClimateProto_GetInt(const ClimateProto_Schema *schema, const void *message, unsigned int field, int *value)
+{
+	if ((field < schema->fieldCount) && (schema->fields[field].type == ClimateProto_TypeInt) &&
+		(*(const unsigned int *)message & (1u << field)))
+	{
+		*value = *(const int *)((const char *)message + schema->fields[field].offset);
+		return true;
+	}
+	return false;
+}
+
+bool ClimateProto_GetFloat(const ClimateProto_Schema *schema, const void *message, unsigned int field, float *value)
+{
+	if ((field < schema->fieldCount) && (schema->fields[field].type == ClimateProto_TypeFloat) &&
+		(*(const unsigned int *)message & (1u << field)))
+	{
+		*value = *(const float *)((const char *)message + schema->fields[field].offset);
+		return true;
+	}
+	return false;
+}
+
+void ClimateProto_SetUint(const ClimateProto_Schema *schema, void *message, unsigned int field, unsigned int value)
+{
+	if ((field < schema->fieldCount) && (schema->fields[field].type == ClimateProto_TypeUint))
+	{
+		*(unsigned int *)((char *)message + schema->fields[field].offset) = value;
+		*(unsigned int *)message |= 1u << field;
+	}
+}
+
+void ClimateProto_SetInt(const ClimateProto_Schema *schema, void *message, unsigned int field, int value)
+{
+	if ((field < schema->fieldCount) && (schema->fields[field].type == ClimateProto_TypeInt))
+	{
+		*(int *)((char *)message + schema->fields[field].offset) = value;
+		*(unsigned int *)message |= 1u << field;
+	}
+}
+
+void ClimateProto_SetFloat(const ClimateProto_Schema *schema, void *message, unsigned int field, float value)
+{
+	if ((field < schema->fieldCount) && (schema->fields[field].type == ClimateProto_TypeFloat))
+	{
+		*(float *)((char *)message + schema->fields[field].offset) = value;
+		*(unsigned int *)message |= 1u << field;
+	}
+}
+
+bool ClimateProto_SetString(const ClimateProto_Schema *schema, void *message, unsigned int field, const char *value)
+{
+	if ((field < schema->fieldCount) && (schema->fields[field].type == ClimateProto_TypeString) &&
+		(strlen(value) < CLIMATE_PROTO_STRING_SIZE))
+	{
+		strcpy((char *)message + schema->fields[field].offset, value);
+		*(unsigned int *)message |= 1u << field;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Events of a batch, "<events><event>...</event>...</events>", which a
+ * device's send thread sends as one message. Start with *cursor NULL; each
+ * call sets *event to the next event, followed by the rest of the batch,
+ * so that it is parsed in place as a message of its own. Returns false
+ * when there are no more, or if xml is no batch.
+ */
+bool ClimateProto_NextEvent(const char *xml, const char **cursor, const char **event)
+{
+	const char *end;
+	Span name, child;
+
+	if (!*cursor)
+	{
+		if (!Navigate(xml, CLIMATE_PROTO_EVENTS_ROOT, &child))
+		{
+			return false;
+		}
+		*cursor = child.start;
+	}
+	end = *cursor + strlen(*cursor);
+	while (NextChild(cursor, end, &name, &child))
+	{
+		if (IsName(&name, "event", strlen("event")))
+		{
+			*event = name.start - 1;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Records of a schema repeated in the text of the element at its path,
+ * e.g. the samples of a CLIMATE_PROTO_SENSOR_LOG event. Start with *cursor
+ * NULL; each call reads the next record into record, which is cleared
+ * first, with values missing or empty left out of its present mask.
+ * Returns false when there are no more, or if xml has no such element.
+ */
+bool ClimateProto_NextRecord(const ClimateProto_Schema *schema, const char *xml, const char **cursor, void *record)
+{
+	Span span;
+	const char *end;
+	unsigned int i;
+
+	if (!*cursor)
+	{
+		if (!xml || !Navigate(xml, schema->path, &span))
+		{
+			return false;
+		}
+		*cursor = span.start;
+	}
+	//Records are text, so end at the end tag of their element
+	end = *cursor + strcspn(*cursor, "<");
+	if (*cursor == end)
+	{
+		return false;
+	}
+	memset(record, 0, schema->size);
+	span.start = *cursor;
+	for (i = 0; (i < schema->fieldCount) && (span.start < end); ++i)
+	{
+		span.end = span.start + strcspn(span.start, ",;<");
+		if (ReadField(&schema->fields[i], &span, record))
+		{
+			*(unsigned int *)record |= 1u << i;
+		}
+		if (*span.end != ',')
+		{
+			break;
+		}
+		span.start = span.end + 1;
+	}
+	//Values a newer peer added are skipped
+	*cursor = FindChar(span.start, end, ';');
+	if (*cursor < end)
+	{
+		(*cursor)++;
+	}
+	return true;
+}
+
+/**
+ * Command received by a device, in either wire format: its info and wire
+ * version, and its settings if settingsSchema is given. Returns false if
+ * the message is not a command or has no info.
+ */
+bool ClimateProto_ParseCommand(const char *msgString, ClimateProto_Command *command,
+								const ClimateProto_Schema *settingsSchema, void *settings)
+{
+	char *xml = NULL;
+	bool success = false;
+
+	if (WireFormat_IsCompact(msgString))
+	{
+		xml = WireFormat_ToXml(msgString);
+		msgString = xml;
+	}
+	if (ClimateProto_Parse(&ClimateProto_CommandSchema, msgString, command) &&
+		(command->present & CLIMATE_PROTO_PRESENT(Command, info)))
+	{
+		if (settingsSchema)
+		{
+			ClimateProto_Parse(settingsSchema, msgString, settings);
+		}
+		success = true;
+	}
+	if (xml)
+	{
+		Flow_MemFree((void **)&xml);
+	}
+	return success;
+}
+
+/**
+ * Format to send in to a peer which advertised version, 0 if it did not
+ */
+WireFormat ClimateProto_WireFormat(unsigned int version)
+{
+	return (version >= (unsigned int)atoi(WIRE_FORMAT_VERSION)) ? WireFormat_Compact : WireFormat_Xml;
+}
+
+/**
+ * Get node value in integer format
+ */
+bool ClimateProto_NodeValueToInt(TreeNode root, unsigned int *valueToSet, const char *nodeName)
+{
+	TreeNode node = TreeNode_Navigate(root, (char *)nodeName);
+	if (node)
+	{
+		char *buf = (char *)TreeNode_GetValue(node);
+		if (buf && *buf)
+		{
+			*valueToSet = (unsigned int)strtoul(buf, NULL, 10);
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Get node value in float format
+ */
+bool ClimateProto_NodeValueToFloat(TreeNode root, float *valueToSet, const char *nodeName)
+{
+	TreeNode node = TreeNode_Navigate(root, (char *)nodeName);
+	if (node)
+	{
+		char *buf = (char *)TreeNode_GetValue(node);
+		if (buf && *buf)
+		{
+			*valueToSet = atof(buf);
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Get node value in string format, false if it does not fit size
+ */
+bool ClimateProto_NodeValueToString(TreeNode root, char *valueToSet, size_t size, const char *nodeName)
+{
+	TreeNode node = TreeNode_Navigate(root, (char *)nodeName);
+	if (node)
+	{
+		char *buf = (char *)TreeNode_GetValue(node);
+		if (buf && *buf && (strlen(buf) < size))
+		{
+			strcpy(valueToSet, buf);
+			return true;
+		}
+	}
+	return false;
+}
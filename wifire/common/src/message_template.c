@@ -0,0 +1,284 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+
+#include <string.h>
+#include <math.h>
+
+#include "message_template.h"
+#include "flow/flowcore.h"
+
+struct tm *gmtime_r(const time_t *timep, struct tm *result);
+
+void MessageTemplate_Init(MessageTemplate *me)
+{
+	me->length = 0;
+	me->slotCount = 0;
+	me->text[0] = '\0';
+	me->isValid = true;
+}
+
+static bool AppendChars(MessageTemplate *me, const char *text, unsigned int length)
+{
+	if (!me->isValid || me->length + length >= MESSAGE_TEMPLATE_SIZE)
+	{
+		me->isValid = false;
+		return false;
+	}
+	memcpy(me->text + me->length, text, length);
+	me->length += length;
+	me->text[me->length] = '\0';
+	return true;
+}
+
+bool MessageTemplate_AppendText(MessageTemplate *me, const char *text)
+{
+	return AppendChars(me, text, strlen(text));
+}
+
+/**
+ * Add a slot, rendered empty: suffix then padding.
+ */
+static bool AppendSlot(MessageTemplate *me, TemplateSlot_Type type, unsigned int valueWidth, unsigned int decimals,
+						const char *suffix, unsigned int suffixLength)
+{
+	TemplateSlot *slot;
+	unsigned int i;
+
+	if (!me->isValid || me->slotCount == MESSAGE_TEMPLATE_MAX_SLOTS || suffixLength >= MESSAGE_TEMPLATE_SUFFIX_SIZE ||
+		me->length + valueWidth + suffixLength >= MESSAGE_TEMPLATE_SIZE)
+	{
+		me->isValid = false;
+		return false;
+	}
+	slot = &me->slots[me->slotCount++];
+	slot->offset = (uint16_t)me->length;
+	slot->valueWidth = (uint8_t)valueWidth;
+	slot->decimals = (uint8_t)decimals;
+	slot->type = type;
+	slot->suffixLength = (uint8_t)suffixLength;
+	memcpy(slot->suffix, suffix, suffixLength);
+	slot->suffix[suffixLength] = '\0';
+
+	AppendChars(me, suffix, suffixLength);
+	for (i = 0; i < valueWidth; ++i)
+	{
+		AppendChars(me, " ", 1);
+	}
+	return me->isValid;
+}
+
+bool MessageTemplate_AppendTime(MessageTemplate *me)
+{
+	return AppendSlot(me, TemplateSlot_Time, MESSAGE_TEMPLATE_TIME_WIDTH, 0, "", 0);
+}
+
+/**
+ * Append a printf style format, as used for the controller's XML tags.
+ * Each %f (with optional precision) becomes a float slot and each %s a
+ * string slot of stringWidth characters. The slot takes the format's
+ * text up to the next '>' as its closing tag.
+ */
+bool MessageTemplate_AppendFormat(MessageTemplate *me, const char *format, unsigned int stringWidth)
+{
+	const char *text = format;
+
+	while (me->isValid && *text)
+	{
+		const char *percent = strchr(text, '%');
+		const char *suffix, *end;
+		unsigned int decimals = 6;
+
+		if (!percent)
+		{
+			return MessageTemplate_AppendText(me, text);
+		}
+		AppendChars(me, text, (unsigned int)(percent - text));
+
+		//Flags and width are ignored, as slots have their own width
+		text = percent + 1;
+		while (*text && strchr("-+ #0123456789", *text))
+		{
+			text++;
+		}
+		if (*text == '.')
+		{
+			decimals = 0;
+			while (*++text >= '0' && *text <= '9')
+			{
+				decimals = decimals * 10 + (*text - '0');
+			}
+		}
+
+		suffix = text + 1;
+		end = (*text) ? strchr(suffix, '>') : NULL;
+		end = end ? end + 1 : suffix + strlen(suffix);
+		if (*text == 'f' && decimals <= 6)
+		{
+			AppendSlot(me, TemplateSlot_Float, MESSAGE_TEMPLATE_FLOAT_WIDTH, decimals, suffix, (unsigned int)(end - suffix));
+		}
+		else if (*text == 's')
+		{
+			AppendSlot(me, TemplateSlot_String, stringWidth, 0, suffix, (unsigned int)(end - suffix));
+		}
+		else
+		{
+			me->isValid = false;
+		}
+		text = end;
+	}
+	return me->isValid;
+}
+
+char *MessageTemplate_Copy(const MessageTemplate *me)
+{
+	char *message = NULL;
+
+	if (me->isValid)
+	{
+		message = (char *)Flow_MemAlloc(me->length + 1);
+		if (message)
+		{
+			memcpy(message, me->text, me->length + 1);
+		}
+	}
+	return message;
+}
+
+/**
+ * Write value, closing tag and padding into the slot
+ */
+static bool Patch(const TemplateSlot *slot, char *message, const char *value, unsigned int length)
+{
+	char *position = message + slot->offset;
+
+	if (length > slot->valueWidth)
+	{
+		return false;
+	}
+	memcpy(position, value, length);
+	memcpy(position + length, slot->suffix, slot->suffixLength);
+	memset(position + length + slot->suffixLength, ' ', slot->valueWidth - length);
+	return true;
+}
+
+static const TemplateSlot *GetSlot(const MessageTemplate *me, unsigned int slot, TemplateSlot_Type type)
+{
+	if (slot < me->slotCount && me->slots[slot].type == type)
+	{
+		return &me->slots[slot];
+	}
+	return NULL;
+}
+
+static char *PutDigits(char *position, unsigned int value, unsigned int digits)
+{
+	while (digits--)
+	{
+		position[digits] = (char)('0' + value % 10);
+		value /= 10;
+	}
+	return position;
+}
+
+bool MessageTemplate_SetTime(const MessageTemplate *me, char *message, unsigned int slot, time_t time)
+{
+	const TemplateSlot *timeSlot = GetSlot(me, slot, TemplateSlot_Time);
+	char value[MESSAGE_TEMPLATE_TIME_WIDTH];
+	struct tm timeNow;
+
+	if (!timeSlot || !gmtime_r(&time, &timeNow) || timeNow.tm_year + 1900 > 9999)
+	{
+		return false;
+	}
+	PutDigits(value, timeNow.tm_year + 1900, 4);
+	value[4] = '-';
+	PutDigits(value + 5, timeNow.tm_mon + 1, 2);
+	value[7] = '-';
+	PutDigits(value + 8, timeNow.tm_mday, 2);
+	value[10] = 'T';
+	PutDigits(value + 11, timeNow.tm_hour, 2);
+	value[13] = ':';
+	PutDigits(value + 14, timeNow.tm_min, 2);
+	value[16] = ':';
+	PutDigits(value + 17, timeNow.tm_sec, 2);
+	value[19] = 'Z';
+	return Patch(timeSlot, message, value, MESSAGE_TEMPLATE_TIME_WIDTH);
+}
+
+/**
+ * Fixed point rendering of %.<decimals>f. Rounding is to nearest even on
+ * the scaled value, which matches printf for the values sensors report.
+ */
+bool MessageTemplate_SetFloat(const MessageTemplate *me, char *message, unsigned int slot, float value)
+{
+	static const double scales[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+	const TemplateSlot *floatSlot = GetSlot(me, slot, TemplateSlot_Float);
+	char digits[24], text[24];
+	double scaled;
+	unsigned long long fixed;
+	unsigned int count = 0, length = 0;
+
+	if (!floatSlot || isnan(value))
+	{
+		return false;
+	}
+	scaled = nearbyint(fabs((double)value) * scales[floatSlot->decimals]);
+	if (scaled >= 1e15)
+	{
+		return false;
+	}
+	fixed = (unsigned long long)scaled;
+	do
+	{
+		digits[count++] = (char)('0' + fixed % 10);
+		fixed /= 10;
+	} while (fixed || count <= floatSlot->decimals);
+
+	if (signbit(value))
+	{
+		text[length++] = '-';
+	}
+	while (count > floatSlot->decimals)
+	{
+		text[length++] = digits[--count];
+	}
+	if (floatSlot->decimals)
+	{
+		text[length++] = '.';
+		while (count)
+		{
+			text[length++] = digits[--count];
+		}
+	}
+	return Patch(floatSlot, message, text, length);
+}
+
+bool MessageTemplate_SetString(const MessageTemplate *me, char *message, unsigned int slot, const char *value)
+{
+	const TemplateSlot *stringSlot = GetSlot(me, slot, TemplateSlot_String);
+
+	return stringSlot && Patch(stringSlot, message, value, strlen(value));
+}
@@ -78,6 +78,21 @@ unsigned int QueueNumOfItems(QueueHandle queue)
 	return uxQueueMessagesWaiting(queue);
 }
 
+MutexHandle MutexCreate(void)
+{
+	return xSemaphoreCreateMutex();
+}
+
+void MutexLock(MutexHandle mutex)
+{
+	xSemaphoreTake(mutex, portMAX_DELAY);
+}
+
+void MutexUnlock(MutexHandle mutex)
+{
+	xSemaphoreGive(mutex);
+}
+
 
 #ifdef	__cplusplus
 }
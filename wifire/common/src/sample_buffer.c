@@ -0,0 +1,179 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "sample_buffer.h"
+#include "climate_proto.h"
+#include "queue_wrapper.h"
+#include "flow/flowcore.h"
+
+struct tm *gmtime_r(const time_t *timep, struct tm *result);
+
+//Longest "time,temperature,humidity;" of a sample
+#define SAMPLE_TEXT_SIZE (10 + 1 + 6 + 1 + 5 + 1)
+
+static StoredSample _samples[SAMPLE_BUFFER_SIZE];
+static unsigned int _first;	//Oldest sample
+static unsigned int _count;
+static unsigned long _overwritten;
+static unsigned long _peekOverwritten;	//_overwritten when last peeked
+static MutexHandle _lock;	//Of the above
+
+static bool ToHundredths(float value, float min, float max, long *hundredths)
+{
+	if ((value < min) || (value > max))
+	{
+		return false;
+	}
+	*hundredths = (long)(value * 100.0f + ((value < 0.0f) ? -0.5f : 0.5f));
+	return true;
+}
+
+bool SampleBuffer_Init(void)
+{
+	if (!_lock)
+	{
+		_lock = MutexCreate();
+	}
+	return _lock != 0;
+}
+
+void SampleBuffer_MakeSample(StoredSample *sample, time_t time, float temperature, float humidity)
+{
+	long hundredths;
+
+	sample->time = (uint32_t)time;
+	sample->temperature = ToHundredths(temperature, (INT16_MIN + 1) / 100.0f, INT16_MAX / 100.0f, &hundredths) ?
+							(int16_t)hundredths : CLIMATE_PROTO_NO_TEMPERATURE;
+	sample->humidity = ToHundredths(humidity, 0.0f, (UINT16_MAX - 1) / 100.0f, &hundredths) ?
+							(uint16_t)hundredths : CLIMATE_PROTO_NO_HUMIDITY;
+}
+
+void SampleBuffer_Push(const StoredSample *sample)
+{
+	MutexLock(_lock);
+	if (_count == SAMPLE_BUFFER_SIZE)
+	{
+		_first = (_first + 1) % SAMPLE_BUFFER_SIZE;
+		_count--;
+		_overwritten++;
+	}
+	_samples[(_first + _count) % SAMPLE_BUFFER_SIZE] = *sample;
+	_count++;
+	MutexUnlock(_lock);
+}
+
+/*
+ * Copies up to max of the oldest samples, which stay in the ring until
+ * dropped, e.g. once they were sent
+ */
+unsigned int SampleBuffer_Peek(StoredSample *samples, unsigned int max)
+{
+	unsigned int count;
+	unsigned int i;
+
+	MutexLock(_lock);
+	_peekOverwritten = _overwritten;
+	count = (max < _count) ? max : _count;
+	for (i = 0; i < count; ++i)
+	{
+		samples[i] = _samples[(_first + i) % SAMPLE_BUFFER_SIZE];
+	}
+	MutexUnlock(_lock);
+	return count;
+}
+
+/*
+ * Drops the count samples last peeked, less those overwritten since by
+ * samples kept from another thread. Only the send thread peeks and drops.
+ */
+void SampleBuffer_Drop(unsigned int count)
+{
+	unsigned long overwritten;
+
+	MutexLock(_lock);
+	overwritten = _overwritten - _peekOverwritten;
+	count = (overwritten < count) ? count - (unsigned int)overwritten : 0;
+	_peekOverwritten = _overwritten;
+	if (count > _count)
+	{
+		count = _count;
+	}
+	_first = (_first + count) % SAMPLE_BUFFER_SIZE;
+	_count -= count;
+	MutexUnlock(_lock);
+}
+
+unsigned int SampleBuffer_Count(void)
+{
+	unsigned int count;
+
+	MutexLock(_lock);
+	count = _count;
+	MutexUnlock(_lock);
+	return count;
+}
+
+unsigned long SampleBuffer_Overwritten(void)
+{
+	unsigned long overwritten;
+
+	MutexLock(_lock);
+	overwritten = _overwritten;
+	MutexUnlock(_lock);
+	return overwritten;
+}
+
+char *SampleBuffer_CreateLogXML(const StoredSample *samples, unsigned int count, time_t time)
+{
+	const char *msgXML = CLIMATE_PROTO_XML_DECLARATION
+						"<event>"
+							CLIMATE_PROTO_TIME_XML
+							"<type>" CLIMATE_PROTO_SENSOR_LOG "</type>"
+							"<count>%u</count>"
+							"<samples>";
+	const char *msgEnd = "</samples></event>";
+	unsigned int size = strlen(msgXML) + 10 + count * SAMPLE_TEXT_SIZE + strlen(msgEnd) + 1;
+	char *xml = Flow_MemAlloc(size);
+	struct tm timeNow;
+	unsigned int i;
+	int length;
+
+	if (xml)
+	{
+		gmtime_r(&time, &timeNow);
+		length = snprintf(xml, size, msgXML, CLIMATE_PROTO_TIME_ARGS(timeNow), count);
+		for (i = 0; i < count; ++i)
+		{
+			length += snprintf(xml + length, size - length, "%s%lu,%d,%u", (i > 0) ? ";" : "",
+								(unsigned long)samples[i].time, samples[i].temperature, samples[i].humidity);
+		}
+		snprintf(xml + length, size - length, "%s", msgEnd);
+	}
+	return xml;
+}
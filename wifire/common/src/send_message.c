@@ -24,40 +24,390 @@
 *******************************************************************************************************/
 
 
+#include <stdio.h>
+#include <string.h>
+
 #include "send_message.h"
 #include "climate_control_logging.h"
+#include "climate_proto.h"
 #include "flow_interface.h"
 #include "queue_wrapper.h"
+#include "wire_format.h"
 
 
 #define FLOW_RETRY_TIMES				(3)
 
+/*
+ * Messages taken from the queue but not sent yet, all for one device and
+ * in one encoding. Each send is a cloud round trip, so messages coming
+ * close together, e.g. temperature and humidity changing on the same
+ * reading, go out as one.
+ */
+typedef struct
+{
+	MeasurementMsg msgs[SEND_MESSAGE_QUEUE_SIZE];
+	unsigned int count;
+	unsigned int size;	//Of the merged message, but for root and prefix
+	unsigned int startTick;
+	bool isCompact;
+}SendBatch;
+
+static SendBatchMode _batchMode = SendBatch_Merge;
+static SendMessageStats _stats;
+static unsigned int _lastAttemptTick;	//Of the send that failed, while offline
+static unsigned int _nextUploadTick;	//Of stored samples, while online
+static char *_backlogDeviceId;	//Where stored samples go
+static MutexHandle _backlogLock;	//Of _backlogDeviceId, and stored and lost in _stats
+
+bool SendMessage_Init(void)
+{
+	if (!_backlogLock)
+	{
+		_backlogLock = MutexCreate();
+	}
+	return (_backlogLock != 0) && SampleBuffer_Init();
+}
+
+void SendMessage_SetBatchMode(SendBatchMode mode)
+{
+	_batchMode = mode;
+}
+
+void SendMessage_GetStats(SendMessageStats *stats)
+{
+	*stats = _stats;
+}
+
+/*
+ * Message as it goes inside a batch: XML without its declaration, or
+ * compact without its prefix
+ */
+static const char *BatchedContent(const char *details, bool isCompact)
+{
+	const char *declarationEnd;
+
+	if (isCompact)
+	{
+		return details + strlen(WIRE_FORMAT_PREFIX);
+	}
+	if ((strncmp(details, "<?", 2) == 0) && (declarationEnd = strstr(details, "?>")))
+	{
+		return declarationEnd + 2;
+	}
+	return details;
+}
+
+/*
+ * Messages of the batch as one, e.g. <events><event>...</event><event>...
+ * </event></events>, or !1('events'(A...)(A...)) when compact, which the
+ * controller takes apart again. Returns NULL if allocation failed.
+ */
+static char *MergeBatch(const SendBatch *batch)
+{
+	const char *open = batch->isCompact ? WIRE_FORMAT_PREFIX "('" CLIMATE_PROTO_EVENTS_ROOT "'" :
+											CLIMATE_PROTO_XML_DECLARATION "<" CLIMATE_PROTO_EVENTS_ROOT ">";
+	const char *close = batch->isCompact ? ")" : "</" CLIMATE_PROTO_EVENTS_ROOT ">";
+	char *merged = Flow_MemAlloc(strlen(open) + batch->size + strlen(close) + 1);
+	char *p = merged;
+	unsigned int i;
+
+	if (merged)
+	{
+		p += sprintf(p, "%s", open);
+		for (i = 0; i < batch->count; ++i)
+		{
+			p += sprintf(p, "%s", BatchedContent(batch->msgs[i].details, batch->isCompact));
+		}
+		sprintf(p, "%s", close);
+	}
+	return merged;
+}
+
+/*
+ * Send, going offline if all retries fail and back online on success
+ */
+static bool SendWithRetries(char *deviceId, char *details)
+{
+	unsigned int i;
+
+	// retry 3 times if send message fails
+	for (i = 1; i <= FLOW_RETRY_TIMES; i++)
+	{
+		if (ClimateControl_SendMessage(deviceId, details))
+		{
+			_stats.sent++;
+			_stats.isOffline = false;
+			return true;
+		}
+		ClimateControl_Log(ClimateControlLogLevel_Error, ERROR_PREFIX "Sending msg failed");
+	}
+	_stats.failed++;
+	_stats.isOffline = true;
+	_lastAttemptTick = FlowTimer_GetTickCount();
+	return false;
+}
+
+void SendMessage_KeepSample(const MeasurementMsg *msg)
+{
+	MutexLock(_backlogLock);
+	if ((msg->sample.time == 0) || !msg->deviceId)
+	{
+		_stats.lost++;
+	}
+	else
+	{
+		if (!_backlogDeviceId || (strcmp(_backlogDeviceId, msg->deviceId) != 0))
+		{
+			Flow_MemFree((void**)&_backlogDeviceId);
+			_backlogDeviceId = FlowString_Duplicate(msg->deviceId);
+		}
+		SampleBuffer_Push(&msg->sample);
+		_stats.stored++;
+	}
+	MutexUnlock(_backlogLock);
+}
+
+/*
+ * Where stored samples go, a copy to free with Flow_MemFree, or NULL if
+ * none were stored
+ */
+static char *BacklogDeviceId(void)
+{
+	char *deviceId = NULL;
+
+	MutexLock(_backlogLock);
+	if (_backlogDeviceId)
+	{
+		deviceId = FlowString_Duplicate(_backlogDeviceId);
+	}
+	MutexUnlock(_backlogLock);
+	return deviceId;
+}
+
+static bool IsRetryDue(void)
+{
+	return (FlowTimer_GetTickCount() - _lastAttemptTick) >= SAMPLE_RETRY_INTERVAL;
+}
+
+/*
+ * Send the oldest stored samples as one message. Catching up must not
+ * delay live messages, so it is only done while there are none, and
+ * paced to take at most half of the link: the next upload waits for
+ * twice as long as this one took, and SAMPLE_UPLOAD_INTERVAL at least.
+ * While offline it is tried every SAMPLE_RETRY_INTERVAL instead.
+ */
+static void UploadSamples(void)
+{
+	static StoredSample samples[SAMPLE_UPLOAD_BATCH];
+	unsigned int startTick = FlowTimer_GetTickCount();
+	unsigned int count, took;
+	char *deviceId;
+	time_t time;
+	char *xml;
+
+	if ((SampleBuffer_Count() == 0) ||
+		(_stats.isOffline ? !IsRetryDue() : ((int)(startTick - _nextUploadTick) < 0)) ||
+		!(deviceId = BacklogDeviceId()))
+	{
+		return;
+	}
+	count = SampleBuffer_Peek(samples, SAMPLE_UPLOAD_BATCH);
+	Flow_GetTime(&time);
+	xml = SampleBuffer_CreateLogXML(samples, count, time);
+	if (xml && SendWithRetries(deviceId, xml))
+	{
+		SampleBuffer_Drop(count);
+		_stats.uploaded += count;
+		took = FlowTimer_GetTickCount() - startTick;
+		_nextUploadTick = startTick + ((2 * took > SAMPLE_UPLOAD_INTERVAL) ? 2 * took : SAMPLE_UPLOAD_INTERVAL);
+	}
+	Flow_MemFree((void**)&xml);
+	Flow_MemFree((void**)&deviceId);
+}
+
+static void FlushBatch(SendBatch *batch, QueueHandle *sendMessageQueue)
+{
+	unsigned int startTick = FlowTimer_GetTickCount();
+	char *merged = NULL;
+	bool isFailed = false;
+	unsigned int i;
+
+	if (batch->count == 0)
+	{
+		return;
+	}
+	if (batch->count > 1)
+	{
+		merged = MergeBatch(batch);
+	}
+	if (merged)
+	{
+		if (SendWithRetries(batch->msgs[0].deviceId, merged))
+		{
+			_stats.merged += batch->count;
+		}
+		else
+		{
+			for (i = 0; i < batch->count; ++i)
+			{
+				SendMessage_KeepSample(&batch->msgs[i]);
+			}
+		}
+		Flow_MemFree((void**)&merged);
+	}
+	else
+	{
+		//Sent one by one if merging failed, until one fails
+		for (i = 0; i < batch->count; ++i)
+		{
+			if (isFailed || !SendWithRetries(batch->msgs[i].deviceId, batch->msgs[i].details))
+			{
+				SendMessage_KeepSample(&batch->msgs[i]);
+				isFailed = true;
+			}
+		}
+	}
+	ClimateControl_Log(ClimateControlLogLevel_Debug, DEBUG_PREFIX "Send Message x%d q(%d/%d) %d t",
+							batch->count,
+							QueueNumOfItems(sendMessageQueue),
+							SEND_MESSAGE_QUEUE_SIZE,
+							FlowTimer_GetTickCount()-startTick);
+	for (i = 0; i < batch->count; ++i)
+	{
+		Flow_MemFree((void**)&(batch->msgs[i].details));
+		Flow_MemFree((void**)&(batch->msgs[i].deviceId));
+	}
+	batch->count = 0;
+	batch->size = 0;
+}
+
+static bool IsSameBatch(const SendBatch *batch, const MeasurementMsg *msg)
+{
+	return batch->msgs[0].deviceId && msg->deviceId &&
+			(strcmp(batch->msgs[0].deviceId, msg->deviceId) == 0) &&
+			(WireFormat_IsCompact(msg->details) == batch->isCompact);
+}
+
+/*
+ * Add message to the batch, flushing it first if the message cannot join.
+ * In SendBatch_Latest mode a message replaces the batch's; a delta taking
+ * the place of its keyframe is only applied by the controller from the
+ * next keyframe on, so that mode suits sensors sending full snapshots.
+ */
+static void AddToBatch(SendBatch *batch, MeasurementMsg *msg, QueueHandle *sendMessageQueue)
+{
+	bool isCompact = WireFormat_IsCompact(msg->details);
+	unsigned int size = strlen(BatchedContent(msg->details, isCompact));
+
+	if ((batch->count > 0) && !IsSameBatch(batch, msg))
+	{
+		FlushBatch(batch, sendMessageQueue);
+	}
+	if ((batch->count > 0) && (_batchMode == SendBatch_Latest))
+	{
+		Flow_MemFree((void**)&(batch->msgs[0].details));
+		Flow_MemFree((void**)&(batch->msgs[0].deviceId));
+		batch->count = 0;
+		batch->size = 0;
+		_stats.superseded++;
+	}
+	else if ((batch->count == SEND_MESSAGE_QUEUE_SIZE) || (batch->size + size > SEND_BATCH_MAX_SIZE))
+	{
+		FlushBatch(batch, sendMessageQueue);
+	}
+	if (batch->count == 0)
+	{
+		batch->startTick = FlowTimer_GetTickCount();
+		batch->isCompact = isCompact;
+	}
+	batch->msgs[batch->count++] = *msg;
+	batch->size += size;
+	if (_batchMode == SendBatch_Off)
+	{
+		FlushBatch(batch, sendMessageQueue);
+	}
+}
+
+/*
+ * Log uplink rate and queue high-water mark every SEND_STATS_PERIOD
+ */
+static void ReportStats(unsigned int *periodStartTick, unsigned long *periodStartSent)
+{
+	unsigned int elapsed = FlowTimer_GetTickCount() - *periodStartTick;
+
+	if (elapsed >= SEND_STATS_PERIOD)
+	{
+		_stats.sentPerMinute = (unsigned int)((_stats.sent - *periodStartSent) * 60000 / elapsed);
+		ClimateControl_Log(ClimateControlLogLevel_Info, INFO_PREFIX "Uplink %u msg/min, %lu merged, %lu superseded, q high water %u/%d, "
+								"%u samples stored%s",
+								_stats.sentPerMinute,
+								_stats.merged,
+								_stats.superseded,
+								_stats.queueHighWater,
+								SEND_MESSAGE_QUEUE_SIZE,
+								SampleBuffer_Count(),
+								_stats.isOffline ? ", offline" : "");
+		*periodStartTick += elapsed;
+		*periodStartSent = _stats.sent;
+	}
+}
+
 void SendMessageThread(FlowThread thread, void *taskParameters)
 {
+	static SendBatch batch;
+	unsigned int periodStartTick = FlowTimer_GetTickCount();
+	unsigned long periodStartSent = 0;
+
 	ClimateControl_Log(ClimateControlLogLevel_Debug, DEBUG_PREFIX "Send message thread started");
 	QueueHandle* sendMessageQueue = taskParameters;
 	while (sendMessageQueue)
 	{
 		MeasurementMsg msg;
-		if (QueueReceive(sendMessageQueue, &msg, -1))
+		int timeout;
+
+		if (batch.count > 0)
+		{
+			//Open batch waits at most SEND_BATCH_WINDOW for more
+			unsigned int elapsed = FlowTimer_GetTickCount() - batch.startTick;
+			timeout = (elapsed < SEND_BATCH_WINDOW) ? (int)(SEND_BATCH_WINDOW - elapsed) : 0;
+		}
+		else if (SampleBuffer_Count() > 0)
+		{
+			timeout = SAMPLE_UPLOAD_INTERVAL;
+		}
+		else
+		{
+			timeout = SEND_STATS_PERIOD;
+		}
+		if (QueueReceive(sendMessageQueue, &msg, timeout))
 		{
-			unsigned int startTick = FlowTimer_GetTickCount();
-			unsigned int i;
-			// retry 3 times if send message fails
-			for (i = 1; i <= FLOW_RETRY_TIMES; i++)
+			unsigned int waiting = QueueNumOfItems(sendMessageQueue) + 1;
+
+			_stats.queued++;
+			if (waiting > _stats.queueHighWater)
 			{
-				if (ClimateControl_SendMessage(msg.deviceId, msg.details))
-				{
-					break;
-				}
-				ClimateControl_Log(ClimateControlLogLevel_Error, ERROR_PREFIX "Sending msg failed");
+				_stats.queueHighWater = waiting;
 			}
-			ClimateControl_Log(ClimateControlLogLevel_Debug, DEBUG_PREFIX "Send Message q(%d/%d) %d t",
-									QueueNumOfItems(sendMessageQueue),
-									SEND_MESSAGE_QUEUE_SIZE,
-									FlowTimer_GetTickCount()-startTick);
-			Flow_MemFree((void**)&(msg.details));
-			Flow_MemFree((void**)&(msg.deviceId));
+			if (_stats.isOffline && !IsRetryDue())
+			{
+				//Not worth a round trip that would hold up the queue
+				SendMessage_KeepSample(&msg);
+				Flow_MemFree((void**)&(msg.details));
+				Flow_MemFree((void**)&(msg.deviceId));
+			}
+			else
+			{
+				AddToBatch(&batch, &msg, sendMessageQueue);
+			}
+		}
+		else
+		{
+			FlushBatch(&batch, sendMessageQueue);
+		}
+		if ((batch.count == 0) && (QueueNumOfItems(sendMessageQueue) == 0))
+		{
+			UploadSamples();
 		}
+		ReportStats(&periodStartTick, &periodStartSent);
 	}
 }
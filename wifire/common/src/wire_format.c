@@ -0,0 +1,370 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "wire_format.h"
+#include "flow/flowcore.h"
+
+struct tm *gmtime_r(const time_t *timep, struct tm *result);
+
+#define TIME_NAME "time"
+#define TIME_ATTRIBUTES " type=\"datetime\""
+#define NAME_CODES "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
+
+//Element names of event, command, response and settings messages. Append
+//only, as a name's code is its index and all peers share the table.
+static const char *_names[] =
+{
+	"event", "command", "response", "time", "type", "info", "settings", "wire", "seq", "base",
+	"Temperature", "Humidity", "Relay_1", "Relay_2", "mode", "status", "Sensor", "Actuator",
+	"HeartBeat", "HeartBeatKeyframe", "TemperatureReadInterval", "TemperatureReadDelta",
+	"HumidityReadInterval", "HumidityReadDelta", "app_time", "version",
+	"ControllerConfig", "SensorConfig", "ActuatorConfig", "TemperatureThreshold", "HumidityThreshold",
+	"TemperatureOrientation", "HumidityOrientation", "TemperatureControl", "HumidityControl",
+	"Kp", "Ki", "Kd", "ControlWindow", "Mode",
+};
+
+//Encoded message, or only its length while text is NULL
+typedef struct
+{
+	char *text;
+	size_t length;
+}Output;
+
+static void Put(Output *out, const char *chars, size_t length)
+{
+	if (out->text)
+	{
+		memcpy(out->text + out->length, chars, length);
+	}
+	out->length += length;
+}
+
+static bool IsTime(const char *name, size_t length)
+{
+	return (length == strlen(TIME_NAME)) && (strncmp(name, TIME_NAME, length) == 0);
+}
+
+static void PutName(Output *out, const char *name, size_t length)
+{
+	unsigned int i;
+
+	for (i = 0; i < sizeof(_names) / sizeof(_names[0]); ++i)
+	{
+		if ((_names[i][0] == name[0]) && (strncmp(_names[i], name, length) == 0) && (_names[i][length] == '\0'))
+		{
+			Put(out, &NAME_CODES[i], 1);
+			return;
+		}
+	}
+	Put(out, "'", 1);
+	Put(out, name, length);
+	Put(out, "'", 1);
+}
+
+static int Digits(const char *text, unsigned int count)
+{
+	int value = 0;
+
+	while (count--)
+	{
+		if ((*text < '0') || (*text > '9'))
+		{
+			return -1;
+		}
+		value = value * 10 + (*text++ - '0');
+	}
+	return value;
+}
+
+/**
+ * Seconds since epoch of a UTC datetime, without timegm() which the
+ * firmware's C library lacks.
+ */
+static bool ParseDateTime(const char *text, size_t length, long long *seconds)
+{
+	int year, month, day, hour, minute, second;
+	long long days;
+
+	//2017-07-14T14:00:00Z
+	if ((length != 20) || (text[4] != '-') || (text[7] != '-') || (text[10] != 'T') || (text[13] != ':') ||
+		(text[16] != ':') || (text[19] != 'Z'))
+	{
+		return false;
+	}
+	year = Digits(text, 4);
+	month = Digits(text + 5, 2);
+	day = Digits(text + 8, 2);
+	hour = Digits(text + 11, 2);
+	minute = Digits(text + 14, 2);
+	second = Digits(text + 17, 2);
+	if ((year < 0) || (month < 1) || (month > 12) || (day < 0) || (hour < 0) || (minute < 0) || (second < 0))
+	{
+		return false;
+	}
+	//Days from civil, with years starting in March
+	year -= (month <= 2);
+	days = (long long)(year / 400) * 146097;
+	year %= 400;
+	days += year * 365 + year / 4 - year / 100 + (153 * (month + ((month > 2) ? -3 : 9)) + 2) / 5 + day - 1 - 719468;
+	*seconds = ((days * 24 + hour) * 60 + minute) * 60 + second;
+	return true;
+}
+
+static void PutText(Output *out, const char *text, size_t length, bool isTime)
+{
+	long long seconds;
+	size_t run;
+
+	if (isTime && ParseDateTime(text, length, &seconds) && (seconds >= 0))
+	{
+		char digits[24];
+		char *first = digits + sizeof(digits);
+
+		do
+		{
+			*--first = '0' + (seconds % 10);
+			seconds /= 10;
+		} while (seconds);
+		Put(out, first, digits + sizeof(digits) - first);
+		return;
+	}
+	for (run = 0; run < length; ++run)
+	{
+		if ((text[run] == '(') || (text[run] == ')') || (text[run] == '\\'))
+		{
+			Put(out, text, run);
+			Put(out, "\\", 1);
+			//Escaped character starts the next run
+			text += run;
+			length -= run;
+			run = 0;
+		}
+	}
+	Put(out, text, length);
+}
+
+static bool IsBlank(char c)
+{
+	return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n');
+}
+
+static bool Encode(const char *xml, Output *out)
+{
+	const char *end;
+	bool isTime = false;
+	bool isBlank;
+	size_t length;
+
+	Put(out, WIRE_FORMAT_PREFIX, strlen(WIRE_FORMAT_PREFIX));
+	while (*xml)
+	{
+		if (*xml == '<')
+		{
+			end = strchr(xml, '>');
+			if (!end)
+			{
+				return false;
+			}
+			if (xml[1] == '/')
+			{
+				Put(out, ")", 1);
+			}
+			else if ((xml[1] != '?') && (xml[1] != '!'))
+			{
+				for (length = 0; xml[length + 1] && !IsBlank(xml[length + 1]) && (xml[length + 1] != '/') && (xml[length + 1] != '>'); ++length)
+				{
+				}
+				Put(out, "(", 1);
+				PutName(out, xml + 1, length);
+				isTime = IsTime(xml + 1, length);
+				if (end[-1] == '/')
+				{
+					Put(out, ")", 1);
+				}
+			}
+			xml = end + 1;
+		}
+		else
+		{
+			isBlank = true;
+			for (length = 0; xml[length] && (xml[length] != '<'); ++length)
+			{
+				isBlank = isBlank && IsBlank(xml[length]);
+			}
+			if (!isBlank)
+			{
+				PutText(out, xml, length, isTime);
+			}
+			isTime = false;
+			xml += length;
+		}
+	}
+	return true;
+}
+
+static bool Decode(const char *compact, Output *out)
+{
+	const char *names[WIRE_FORMAT_MAX_DEPTH];
+	size_t lengths[WIRE_FORMAT_MAX_DEPTH];
+	unsigned int depth = 0;
+	const char *name, *code;
+	size_t length;
+
+	compact += strlen(WIRE_FORMAT_PREFIX);
+	while (*compact)
+	{
+		if (*compact == '(')
+		{
+			if (compact[1] == '\'')
+			{
+				name = compact + 2;
+				length = strcspn(name, "'");
+				if (!name[length] || !length)
+				{
+					return false;
+				}
+				compact = name + length + 1;
+			}
+			else
+			{
+				code = compact[1] ? strchr(NAME_CODES, compact[1]) : NULL;
+				if (!code || ((unsigned int)(code - NAME_CODES) >= sizeof(_names) / sizeof(_names[0])))
+				{
+					return false;
+				}
+				name = _names[code - NAME_CODES];
+				length = strlen(name);
+				compact += 2;
+			}
+			if (depth == WIRE_FORMAT_MAX_DEPTH)
+			{
+				return false;
+			}
+			names[depth] = name;
+			lengths[depth++] = length;
+			Put(out, "<", 1);
+			Put(out, name, length);
+			if (IsTime(name, length))
+			{
+				size_t digits = strspn(compact, "0123456789");
+				Put(out, TIME_ATTRIBUTES, strlen(TIME_ATTRIBUTES));
+				Put(out, ">", 1);
+				if (digits && (compact[digits] == ')'))
+				{
+					time_t seconds = (time_t)strtoll(compact, NULL, 10);
+					struct tm date;
+					char text[32];
+
+					if (!gmtime_r(&seconds, &date))
+					{
+						return false;
+					}
+					Put(out, text, snprintf(text, sizeof(text), "%04d-%02d-%02dT%02d:%02d:%02dZ",
+												date.tm_year + 1900, date.tm_mon + 1, date.tm_mday,
+												date.tm_hour, date.tm_min, date.tm_sec));
+					compact += digits;
+				}
+			}
+			else
+			{
+				Put(out, ">", 1);
+			}
+		}
+		else if (*compact == ')')
+		{
+			if (!depth)
+			{
+				return false;
+			}
+			--depth;
+			Put(out, "</", 2);
+			Put(out, names[depth], lengths[depth]);
+			Put(out, ">", 1);
+			++compact;
+		}
+		else if (*compact == '\\')
+		{
+			if (!compact[1])
+			{
+				return false;
+			}
+			Put(out, compact + 1, 1);
+			compact += 2;
+		}
+		else
+		{
+			length = strcspn(compact, "()\\");
+			Put(out, compact, length);
+			compact += length;
+		}
+	}
+	return depth == 0;
+}
+
+/**
+ * Run a codec once to size the message, then again to write it.
+ */
+static char *Convert(const char *input, bool (*codec)(const char *, Output *))
+{
+	Output out = { NULL, 0 };
+
+	if (!input || !codec(input, &out))
+	{
+		return NULL;
+	}
+	out.text = (char *)Flow_MemAlloc(out.length + 1);
+	if (out.text)
+	{
+		out.length = 0;
+		codec(input, &out);
+		out.text[out.length] = '\0';
+	}
+	return out.text;
+}
+
+bool WireFormat_IsCompact(const char *content)
+{
+	return content && (strncmp(content, WIRE_FORMAT_PREFIX, strlen(WIRE_FORMAT_PREFIX)) == 0);
+}
+
+char *WireFormat_ToCompact(const char *xml)
+{
+	return Convert(xml, Encode);
+}
+
+char *WireFormat_ToXml(const char *compact)
+{
+	if (!WireFormat_IsCompact(compact))
+	{
+		return NULL;
+	}
+	return Convert(compact, Decode);
+}
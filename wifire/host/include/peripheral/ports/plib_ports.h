@@ -0,0 +1,85 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+#ifndef HOST_PLIB_PORTS_H
+#define	HOST_PLIB_PORTS_H
+
+/*
+ * Host stand-in for the Harmony ports peripheral library, with the calls
+ * relay.c makes. Pin states are kept by ports_sim.c, see wifire_sim.h.
+ */
+
+#include <stdbool.h>
+
+typedef enum
+{
+	PORTS_ID_0,
+}PORTS_MODULE_ID;
+
+typedef enum
+{
+	PORT_CHANNEL_A,
+	PORT_CHANNEL_B,
+	PORT_CHANNEL_C,
+	PORT_CHANNEL_D,
+	PORT_CHANNEL_E,
+	PORT_CHANNEL_F,
+	PORT_CHANNEL_G,
+	PORT_CHANNEL_H,
+	PORT_CHANNEL_J,
+	PORT_CHANNEL_K,
+}PORTS_CHANNEL;
+
+typedef enum
+{
+	PORTS_BIT_POS_0,
+	PORTS_BIT_POS_1,
+	PORTS_BIT_POS_2,
+	PORTS_BIT_POS_3,
+	PORTS_BIT_POS_4,
+	PORTS_BIT_POS_5,
+	PORTS_BIT_POS_6,
+	PORTS_BIT_POS_7,
+	PORTS_BIT_POS_8,
+	PORTS_BIT_POS_9,
+	PORTS_BIT_POS_10,
+	PORTS_BIT_POS_11,
+	PORTS_BIT_POS_12,
+	PORTS_BIT_POS_13,
+	PORTS_BIT_POS_14,
+	PORTS_BIT_POS_15,
+}PORTS_BIT_POS;
+
+typedef enum
+{
+	PORTS_PIN_MODE_ANALOG,
+	PORTS_PIN_MODE_DIGITAL,
+}PORTS_PIN_MODE;
+
+void PLIB_PORTS_PinModePerPortSelect(PORTS_MODULE_ID index, PORTS_CHANNEL channel, PORTS_BIT_POS bitPos, PORTS_PIN_MODE mode);
+void PLIB_PORTS_PinDirectionOutputSet(PORTS_MODULE_ID index, PORTS_CHANNEL channel, PORTS_BIT_POS bitPos);
+void PLIB_PORTS_PinWrite(PORTS_MODULE_ID index, PORTS_CHANNEL channel, PORTS_BIT_POS bitPos, bool value);
+
+#endif	/* HOST_PLIB_PORTS_H */
@@ -0,0 +1,77 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+#ifndef WIFIRE_SIM_H
+#define	WIFIRE_SIM_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Simulated board behind the host HAL: analog inputs read by the ADC
+ * driver and digital outputs written by the ports library, so that
+ * sensor_adc.c and relay.c run on a PC as they are.
+ *
+ * Each analog input follows a random walk of at most drift counts per
+ * conversion, within the 12 bit range, so that a simulated sensor sees its
+ * readings change. Each conversion is off by up to noise counts. In scan
+ * mode a conversion is taken when a result is fetched, the oversampling
+ * of its digital filter for an averaged one.
+ *
+ * The DHT sensor replies to each capture with a waveform of its reading,
+ * each pulse off by up to jitter microseconds and with glitches, pulses of
+ * 1-3 microseconds, within random pulses.
+ */
+
+#define WIFIRE_SIM_ADC_MAX		(4095)
+#define WIFIRE_SIM_NUM_CHANNELS	(50)	//AN0 to AN49
+#define WIFIRE_SIM_NUM_PORTS	(10)	//PORT_CHANNEL_A to PORT_CHANNEL_K
+#define WIFIRE_SIM_NUM_PINS		(16)
+
+void WifireSim_SetAnalogInput(unsigned int value, unsigned int drift, unsigned int seed);
+void WifireSim_SetAnalogNoise(unsigned int noise);
+unsigned int WifireSim_GetAnalogReads(void);	// conversions
+
+bool WifireSim_GetPin(unsigned int port, unsigned int pin);
+unsigned int WifireSim_GetPinWrites(void);
+
+void WifireSim_SetDhtReading(unsigned int humidity, unsigned int temperature, unsigned int jitter, unsigned int glitches);
+unsigned int WifireSim_GetDhtTransactions(void);
+/*
+ * Fill edges with the waveform of a DHT reply of bytes, see dht_decoder.h.
+ * Return number of edges, 0 if they do not fit.
+ */
+unsigned int WifireSim_MakeDhtWaveform(const uint8_t *bytes, unsigned int jitter, unsigned int glitches,
+										unsigned int *seed, uint32_t *edges, unsigned int maxEdges);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* WIFIRE_SIM_H */
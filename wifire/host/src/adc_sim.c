@@ -0,0 +1,217 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+/*
+ * ADC driver of adc_custom.h on the simulated board, see wifire_sim.h
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adc_custom.h"
+#include "wifire_sim.h"
+
+static pthread_mutex_t _adcLock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int _inputs[WIFIRE_SIM_NUM_CHANNELS];
+static unsigned int _drift;
+static unsigned int _noise;
+static unsigned int _seed = 1;
+static unsigned int _reads;
+static bool _isContinuous;
+static int _filterPorts[ADC12_NUM_FILTERS];
+static unsigned int _filterOversampling[ADC12_NUM_FILTERS];	// 0 for filter not used
+
+void WifireSim_SetAnalogInput(unsigned int value, unsigned int drift, unsigned int seed)
+{
+	unsigned int i;
+
+	pthread_mutex_lock(&_adcLock);
+	for (i = 0; i < WIFIRE_SIM_NUM_CHANNELS; ++i)
+	{
+		_inputs[i] = (value > WIFIRE_SIM_ADC_MAX) ? WIFIRE_SIM_ADC_MAX : value;
+	}
+	_drift = drift;
+	_seed = seed ? seed : 1;
+	pthread_mutex_unlock(&_adcLock);
+}
+
+void WifireSim_SetAnalogNoise(unsigned int noise)
+{
+	pthread_mutex_lock(&_adcLock);
+	_noise = noise;
+	pthread_mutex_unlock(&_adcLock);
+}
+
+unsigned int WifireSim_GetAnalogReads(void)
+{
+	unsigned int reads;
+
+	pthread_mutex_lock(&_adcLock);
+	reads = _reads;
+	pthread_mutex_unlock(&_adcLock);
+	return reads;
+}
+
+void adc12_Init(void)
+{
+	pthread_mutex_lock(&_adcLock);
+	_isContinuous = false;
+	memset(_filterOversampling, 0, sizeof(_filterOversampling));
+	pthread_mutex_unlock(&_adcLock);
+}
+
+void adc12_ConfigPort(int port)
+{
+	(void)port;
+}
+
+void adc12_Enable(void)
+{
+}
+
+/*
+ * One conversion of port, with _adcLock held
+ */
+static unsigned int Convert(int port)
+{
+	int value;
+
+	if (_drift)
+	{
+		//Step in -drift..drift, reflected at the ends of the range
+		int step = (int)(rand_r(&_seed) % (2 * _drift + 1)) - (int)_drift;
+		int input = (int)_inputs[port] + step;
+
+		if (input < 0)
+		{
+			input = -input;
+		}
+		else if (input > WIFIRE_SIM_ADC_MAX)
+		{
+			input = 2 * WIFIRE_SIM_ADC_MAX - input;
+		}
+		_inputs[port] = (unsigned int)input;
+	}
+	value = (int)_inputs[port];
+	if (_noise)
+	{
+		value += (int)(rand_r(&_seed) % (2 * _noise + 1)) - (int)_noise;
+		value = (value < 0) ? 0 : ((value > WIFIRE_SIM_ADC_MAX) ? WIFIRE_SIM_ADC_MAX : value);
+	}
+	_reads++;
+	return (unsigned int)value;
+}
+
+static bool IsChannel(int port)
+{
+	return (port >= 0) && (port < WIFIRE_SIM_NUM_CHANNELS);
+}
+
+unsigned int adc12_Read(int port)
+{
+	unsigned int value;
+
+	if (!IsChannel(port))
+	{
+		return 0;
+	}
+	pthread_mutex_lock(&_adcLock);
+	value = Convert(port);
+	pthread_mutex_unlock(&_adcLock);
+	return value;
+}
+
+void adc12_ConfigFilter(int filter, int port, unsigned int oversampling)
+{
+	if ((filter < 0) || (filter >= ADC12_NUM_FILTERS) || !IsChannel(port))
+	{
+		return;
+	}
+	pthread_mutex_lock(&_adcLock);
+	_filterPorts[filter] = port;
+	_filterOversampling[filter] = oversampling;
+	pthread_mutex_unlock(&_adcLock);
+}
+
+void adc12_StartContinuous(void)
+{
+	pthread_mutex_lock(&_adcLock);
+	_isContinuous = true;
+	pthread_mutex_unlock(&_adcLock);
+}
+
+bool adc12_DataReady(int port)
+{
+	bool isReady;
+
+	pthread_mutex_lock(&_adcLock);
+	isReady = _isContinuous && IsChannel(port);
+	pthread_mutex_unlock(&_adcLock);
+	return isReady;
+}
+
+unsigned int adc12_GetData(int port)
+{
+	return adc12_Read(port);
+}
+
+bool adc12_FilterReady(int filter)
+{
+	bool isReady;
+
+	if ((filter < 0) || (filter >= ADC12_NUM_FILTERS))
+	{
+		return false;
+	}
+	pthread_mutex_lock(&_adcLock);
+	isReady = _isContinuous && (_filterOversampling[filter] > 0);
+	pthread_mutex_unlock(&_adcLock);
+	return isReady;
+}
+
+/*
+ * Average of the conversions the filter has taken since its last result,
+ * rounded
+ */
+unsigned int adc12_GetFilterData(int filter)
+{
+	unsigned int sum = 0;
+	unsigned int count;
+	unsigned int i;
+
+	if ((filter < 0) || (filter >= ADC12_NUM_FILTERS))
+	{
+		return 0;
+	}
+	pthread_mutex_lock(&_adcLock);
+	count = _filterOversampling[filter];
+	for (i = 0; i < count; ++i)
+	{
+		sum += Convert(_filterPorts[filter]);
+	}
+	pthread_mutex_unlock(&_adcLock);
+	return count ? (sum + count / 2) / count : 0;
+}
@@ -0,0 +1,134 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+/*
+ * Host main of a WiFire device, sensor or actuator by the sources it is
+ * linked with, in place of main.c and app.c. It logs in to the Flow
+ * stand-in and runs UserSetup() as SYS_AppTask() does, so the firmware
+ * runs its own threads, timers and queues, on pthreads, and its HAL on
+ * the simulated board of wifire_sim.h.
+ *
+ * Messages to and from the controller go over a link to the process
+ * hosting it: a SOCK_SEQPACKET socket inherited as a file descriptor,
+ * one message per packet. The device exits when the link closes.
+ *
+ * Usage: <device> -l link fd [-a analog input] [-w drift] [-s seed] [-v]
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "flow/flowcore.h"
+#include "flow_stub.h"
+#include "user.h"
+#include "wifire_sim.h"
+
+#define USER_ID "user"
+#define CONTROLLER_ID "controller"
+#define CONTROLLER_DEVICE_TYPE "ClimateControlDemoController"
+#define LINK_MESSAGE_SIZE (4096)
+
+static int _link = -1;
+
+/**
+ * Whatever the firmware sends goes to the controller, as only it is known
+ */
+static void SendToLink(const FlowStubMessage *message)
+{
+	if (send(_link, message->content, strlen(message->content), MSG_NOSIGNAL) < 0)
+	{
+		perror("send");
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	static char buffer[LINK_MESSAGE_SIZE];
+	unsigned int input = WIFIRE_SIM_ADC_MAX / 2;
+	unsigned int drift = 8;
+	unsigned int seed = (unsigned int)getpid();
+	bool isVerbose = false;
+	ssize_t length;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "l:a:w:s:v")) != -1)
+	{
+		switch (opt)
+		{
+			case 'l': _link = atoi(optarg); break;
+			case 'a': input = strtoul(optarg, NULL, 10); break;
+			case 'w': drift = strtoul(optarg, NULL, 10); break;
+			case 's': seed = strtoul(optarg, NULL, 10); break;
+			case 'v': isVerbose = true; break;
+			default:
+				fprintf(stderr, "Usage: %s -l link fd [-a analog input] [-w drift] [-s seed] [-v]\n", argv[0]);
+				return 1;
+		}
+	}
+	if (_link < 0)
+	{
+		fprintf(stderr, "%s: link fd is needed\n", argv[0]);
+		return 1;
+	}
+
+	FlowStub_SetLogLevel(isVerbose ? FlowLogLevel_Debug : FlowLogLevel_Error);
+	WifireSim_SetAnalogInput(input, drift, seed);
+	FlowStub_SetOwner(USER_ID);
+	FlowStub_AddOwnedDevice(CONTROLLER_DEVICE_TYPE, CONTROLLER_ID);
+	FlowClient_LoginAsDevice(ClimateControl_GetDeviceType(), NULL, NULL, NULL,
+								ClimateControl_GetExternalSoftwareVersion(), ClimateControl_GetAppName(), NULL);
+	FlowStub_SetSendListener(SendToLink);
+	UserSetup();
+
+	for (;;)
+	{
+		length = recv(_link, buffer, sizeof(buffer) - 1, MSG_TRUNC);
+		if (length == 0)
+		{
+			break;
+		}
+		if (length < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			perror("recv");
+			break;
+		}
+		if ((size_t)length >= sizeof(buffer))
+		{
+			fprintf(stderr, "%s: dropped message of %zd bytes\n", argv[0], length);
+			continue;
+		}
+		buffer[length] = '\0';
+		FlowStub_DeliverMessage(NULL, CONTROLLER_ID, buffer);
+	}
+	return 0;
+}
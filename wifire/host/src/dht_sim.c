@@ -0,0 +1,149 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+/*
+ * DHT capture of dht_capture.h on the simulated board, see wifire_sim.h
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dht_capture.h"
+#include "dht_decoder.h"
+#include "wifire_sim.h"
+
+// from the DHT11 datasheet
+#define REPLY_DELAY			(30)	// microseconds from release of the line to the reply
+#define RESPONSE_LENGTH		(80)	// microseconds, of response low and high
+#define BIT_LOW_LENGTH		(50)	// microseconds
+#define ZERO_HIGH_LENGTH	(27)	// microseconds
+#define ONE_HIGH_LENGTH		(70)	// microseconds
+#define MIN_GLITCH_PULSE	(12)	// microseconds, shorter pulses get no glitch
+
+static pthread_mutex_t _dhtLock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int _humidity = 45;
+static unsigned int _temperature = 21;
+static unsigned int _jitter;
+static unsigned int _glitches;
+static unsigned int _seed = 1;
+static unsigned int _transactions;
+
+void WifireSim_SetDhtReading(unsigned int humidity, unsigned int temperature, unsigned int jitter, unsigned int glitches)
+{
+	pthread_mutex_lock(&_dhtLock);
+	_humidity = humidity;
+	_temperature = temperature;
+	_jitter = jitter;
+	_glitches = glitches;
+	pthread_mutex_unlock(&_dhtLock);
+}
+
+unsigned int WifireSim_GetDhtTransactions(void)
+{
+	unsigned int transactions;
+
+	pthread_mutex_lock(&_dhtLock);
+	transactions = _transactions;
+	pthread_mutex_unlock(&_dhtLock);
+	return transactions;
+}
+
+static uint32_t Pulse(unsigned int length, unsigned int jitter, unsigned int *seed)
+{
+	if (jitter == 0)
+	{
+		return length;
+	}
+	return (uint32_t)((int)length + (int)(rand_r(seed) % (2 * jitter + 1)) - (int)jitter);
+}
+
+static void AddEdge(uint32_t *edges, unsigned int *count, unsigned int maxEdges, uint32_t time)
+{
+	if (*count < maxEdges)
+	{
+		edges[*count] = time;
+	}
+	(*count)++;
+}
+
+unsigned int WifireSim_MakeDhtWaveform(const uint8_t *bytes, unsigned int jitter, unsigned int glitches,
+										unsigned int *seed, uint32_t *edges, unsigned int maxEdges)
+{
+	uint32_t time = REPLY_DELAY;
+	unsigned int count = 0;
+	unsigned int i;
+
+	AddEdge(edges, &count, maxEdges, time);
+	time += Pulse(RESPONSE_LENGTH, jitter, seed);
+	AddEdge(edges, &count, maxEdges, time);
+	time += Pulse(RESPONSE_LENGTH, jitter, seed);
+	for (i = 0; i < 8 * DHT_DECODER_NUM_BYTES; ++i)
+	{
+		bool isOne = (bytes[i / 8] >> (7 - i % 8)) & 1;
+
+		AddEdge(edges, &count, maxEdges, time);
+		time += Pulse(BIT_LOW_LENGTH, jitter, seed);
+		AddEdge(edges, &count, maxEdges, time);
+		time += Pulse(isOne ? ONE_HIGH_LENGTH : ZERO_HIGH_LENGTH, jitter, seed);
+	}
+	//Sensor pulls the line low once more, then releases it
+	AddEdge(edges, &count, maxEdges, time);
+	time += BIT_LOW_LENGTH;
+	AddEdge(edges, &count, maxEdges, time);
+
+	for (i = 0; (i < glitches) && (count + 2 <= maxEdges); ++i)
+	{
+		unsigned int pulse = rand_r(seed) % (count - 1);
+		uint32_t length = edges[pulse + 1] - edges[pulse];
+		uint32_t at;
+
+		if (length < MIN_GLITCH_PULSE)
+		{
+			continue;
+		}
+		at = edges[pulse] + MIN_GLITCH_PULSE / 2 + rand_r(seed) % (length - MIN_GLITCH_PULSE);
+		memmove(&edges[pulse + 3], &edges[pulse + 1], (count - pulse - 1) * sizeof(edges[0]));
+		edges[pulse + 1] = at;
+		edges[pulse + 2] = at + 1 + rand_r(seed) % 3;
+		count += 2;
+	}
+	return (count <= maxEdges) ? count : 0;
+}
+
+unsigned int DhtCapture_Read(uint32_t *edges, unsigned int maxEdges)
+{
+	uint8_t bytes[DHT_DECODER_NUM_BYTES] = { 0 };
+	unsigned int count;
+
+	pthread_mutex_lock(&_dhtLock);
+	bytes[0] = _humidity;
+	bytes[2] = _temperature;
+	bytes[4] = bytes[0] + bytes[2];
+	count = WifireSim_MakeDhtWaveform(bytes, _jitter, _glitches, &_seed, edges, maxEdges);
+	_transactions++;
+	pthread_mutex_unlock(&_dhtLock);
+	return count;
+}
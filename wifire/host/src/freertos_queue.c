@@ -0,0 +1,214 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+/*
+ * FreeRTOS queues on pthreads for the host build: a fixed ring of items
+ * copied by value, with waits on a monotonic clock. A tick is a
+ * millisecond, and portMAX_DELAY waits forever. Mutexes are plain
+ * pthread mutexes, taken without a timeout.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "semphr.h"
+
+typedef struct
+{
+	pthread_mutex_t lock;
+	pthread_cond_t notEmpty;
+	pthread_cond_t notFull;
+	UBaseType_t length;
+	UBaseType_t itemSize;
+	UBaseType_t head;
+	UBaseType_t count;
+	unsigned char *items;
+}HostQueue;
+
+static void Deadline(TickType_t ticks, struct timespec *deadline)
+{
+	clock_gettime(CLOCK_MONOTONIC, deadline);
+	deadline->tv_sec += ticks / 1000;
+	deadline->tv_nsec += (long)(ticks % 1000) * 1000000;
+	if (deadline->tv_nsec >= 1000000000)
+	{
+		deadline->tv_sec++;
+		deadline->tv_nsec -= 1000000000;
+	}
+}
+
+/**
+ * Wait on condition till woken or ticks have passed. False on timeout.
+ */
+static bool Wait(HostQueue *queue, pthread_cond_t *condition, TickType_t ticks, const struct timespec *deadline)
+{
+	if (ticks == 0)
+	{
+		return false;
+	}
+	if (ticks == portMAX_DELAY)
+	{
+		pthread_cond_wait(condition, &queue->lock);
+		return true;
+	}
+	return pthread_cond_timedwait(condition, &queue->lock, deadline) != ETIMEDOUT;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+	HostQueue *queue;
+	pthread_condattr_t attributes;
+
+	if ((length == 0) || (itemSize == 0))
+	{
+		return NULL;
+	}
+	queue = calloc(1, sizeof(HostQueue));
+	if (!queue)
+	{
+		return NULL;
+	}
+	queue->items = malloc(length * itemSize);
+	if (!queue->items)
+	{
+		free(queue);
+		return NULL;
+	}
+	queue->length = length;
+	queue->itemSize = itemSize;
+	pthread_mutex_init(&queue->lock, NULL);
+	pthread_condattr_init(&attributes);
+	pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+	pthread_cond_init(&queue->notEmpty, &attributes);
+	pthread_cond_init(&queue->notFull, &attributes);
+	pthread_condattr_destroy(&attributes);
+	return queue;
+}
+
+void vQueueDelete(QueueHandle_t handle)
+{
+	HostQueue *queue = handle;
+
+	if (queue)
+	{
+		pthread_cond_destroy(&queue->notFull);
+		pthread_cond_destroy(&queue->notEmpty);
+		pthread_mutex_destroy(&queue->lock);
+		free(queue->items);
+		free(queue);
+	}
+}
+
+BaseType_t xQueueSend(QueueHandle_t handle, const void *item, TickType_t ticksToWait)
+{
+	HostQueue *queue = handle;
+	struct timespec deadline;
+	BaseType_t result = pdFALSE;
+
+	if (!queue)
+	{
+		return pdFALSE;
+	}
+	Deadline(ticksToWait, &deadline);
+	pthread_mutex_lock(&queue->lock);
+	while ((queue->count == queue->length) && Wait(queue, &queue->notFull, ticksToWait, &deadline))
+	{
+	}
+	if (queue->count < queue->length)
+	{
+		memcpy(queue->items + ((queue->head + queue->count) % queue->length) * queue->itemSize, item, queue->itemSize);
+		queue->count++;
+		pthread_cond_signal(&queue->notEmpty);
+		result = pdTRUE;
+	}
+	pthread_mutex_unlock(&queue->lock);
+	return result;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t handle, void *buffer, TickType_t ticksToWait)
+{
+	HostQueue *queue = handle;
+	struct timespec deadline;
+	BaseType_t result = pdFALSE;
+
+	if (!queue)
+	{
+		return pdFALSE;
+	}
+	Deadline(ticksToWait, &deadline);
+	pthread_mutex_lock(&queue->lock);
+	while ((queue->count == 0) && Wait(queue, &queue->notEmpty, ticksToWait, &deadline))
+	{
+	}
+	if (queue->count > 0)
+	{
+		memcpy(buffer, queue->items + queue->head * queue->itemSize, queue->itemSize);
+		queue->head = (queue->head + 1) % queue->length;
+		queue->count--;
+		pthread_cond_signal(&queue->notFull);
+		result = pdTRUE;
+	}
+	pthread_mutex_unlock(&queue->lock);
+	return result;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t handle)
+{
+	HostQueue *queue = handle;
+	UBaseType_t count;
+
+	pthread_mutex_lock(&queue->lock);
+	count = queue->count;
+	pthread_mutex_unlock(&queue->lock);
+	return count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+	pthread_mutex_t *mutex = malloc(sizeof(*mutex));
+
+	if (mutex)
+	{
+		pthread_mutex_init(mutex, NULL);
+	}
+	return mutex;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticksToWait)
+{
+	(void)ticksToWait;
+	return (mutex && (pthread_mutex_lock(mutex) == 0)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex)
+{
+	return (mutex && (pthread_mutex_unlock(mutex) == 0)) ? pdTRUE : pdFALSE;
+}
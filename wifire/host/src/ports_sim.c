@@ -0,0 +1,96 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+/*
+ * Ports peripheral library on the simulated board, see wifire_sim.h
+ */
+
+#include <pthread.h>
+
+#include "peripheral/ports/plib_ports.h"
+#include "wifire_sim.h"
+
+static pthread_mutex_t _portsLock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int _latches[WIFIRE_SIM_NUM_PORTS];
+static unsigned int _writes;
+
+bool WifireSim_GetPin(unsigned int port, unsigned int pin)
+{
+	bool isSet;
+
+	if ((port >= WIFIRE_SIM_NUM_PORTS) || (pin >= WIFIRE_SIM_NUM_PINS))
+	{
+		return false;
+	}
+	pthread_mutex_lock(&_portsLock);
+	isSet = (_latches[port] >> pin) & 1;
+	pthread_mutex_unlock(&_portsLock);
+	return isSet;
+}
+
+unsigned int WifireSim_GetPinWrites(void)
+{
+	unsigned int writes;
+
+	pthread_mutex_lock(&_portsLock);
+	writes = _writes;
+	pthread_mutex_unlock(&_portsLock);
+	return writes;
+}
+
+void PLIB_PORTS_PinModePerPortSelect(PORTS_MODULE_ID index, PORTS_CHANNEL channel, PORTS_BIT_POS bitPos, PORTS_PIN_MODE mode)
+{
+	(void)index;
+	(void)channel;
+	(void)bitPos;
+	(void)mode;
+}
+
+void PLIB_PORTS_PinDirectionOutputSet(PORTS_MODULE_ID index, PORTS_CHANNEL channel, PORTS_BIT_POS bitPos)
+{
+	(void)index;
+	(void)channel;
+	(void)bitPos;
+}
+
+void PLIB_PORTS_PinWrite(PORTS_MODULE_ID index, PORTS_CHANNEL channel, PORTS_BIT_POS bitPos, bool value)
+{
+	(void)index;
+	if (((unsigned int)channel >= WIFIRE_SIM_NUM_PORTS) || ((unsigned int)bitPos >= WIFIRE_SIM_NUM_PINS))
+	{
+		return;
+	}
+	pthread_mutex_lock(&_portsLock);
+	if (value)
+	{
+		_latches[channel] |= 1u << bitPos;
+	}
+	else
+	{
+		_latches[channel] &= ~(1u << bitPos);
+	}
+	_writes++;
+	pthread_mutex_unlock(&_portsLock);
+}
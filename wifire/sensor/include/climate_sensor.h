@@ -32,6 +32,11 @@ extern "C" {
 #include "flow/flowcore.h"
 #include "flow/flowmessaging.h"
 #include "queue_wrapper.h"
+#include "wire_format.h"
+#include "climate_proto.h"
+#include "sensor_calibration.h"
+#include "sensor_filter.h"
+#include "sample_schedule.h"
 
 #define NUM_SENSORS (2)
 
@@ -42,28 +47,22 @@ extern "C" {
 #endif
 #define	DEFAULT_HEART_BEAT_PERIOD					(15*1000)//milliseconds
 #define MINIMUM_HUMIDITY_SENSOR_READ_PERIOD			(2500) //milliseconds
+#define MAXIMUM_TEMPERATURE_SENSOR_READ_PERIOD		(8 * MINIMUM_TEMPERATURE_SENSOR_READ_PERIOD) //milliseconds
+#define MAXIMUM_HUMIDITY_SENSOR_READ_PERIOD			(8 * MINIMUM_HUMIDITY_SENSOR_READ_PERIOD) //milliseconds
 #define CLIMATE_SENSOR_MSG_QUEUE_SIZE				(15)
 #define DEFAULT_TEMPERATURE_READING_DELTA			(0.5f)
 #define DEFAULT_HUMIDITY_READING_DELTA				(2.0f)
+#define DEFAULT_MEDIAN_SIZE							(3)
+#define DEFAULT_FILTER_ALPHA						(SENSOR_FILTER_ALPHA_ONE)
 #define TAG_ARRAY_SIZE								(300)
 #define TAG_SIZE									(70)
 #define CONTROLLER_DEVICE_TYPE						"ClimateControlDemoController"
 #define UPDATE_SETTINGS_STR							"UPDATE_SETTINGS"
-#define HEART_BEAT_XML_TAG							"command/settings/HeartBeat"
-#define READ_TEMPERATURE_INTERVAL_XML_TAG			"command/settings/TemperatureReadInterval"
-#define READ_TEMPERATURE_DELTA_XML_TAG				"command/settings/TemperatureReadDelta"
-#define READ_HUMIDITY_INTERVAL_XML_TAG				"command/settings/HumidityReadInterval"
-#define READ_HUMIDITY_DELTA_XML_TAG					"command/settings/HumidityReadDelta"
 #define TEMPERATURE_XML_TAG							"<Temperature>%0.2f</Temperature>"
 #define HUMIDITY_XML_TAG							"<Humidity>%0.2f</Humidity>"
 
-typedef bool (*SensorReadFunc)(float*  const);
-
 typedef enum
 {
-	ClimateSensorCmd_ReadTemperatureSensor,
-	ClimateSensorCmd_ReadHumiditySensor,
-	ClimateSensorCmd_SendHeartBeat,
 	ClimateSensorCmd_ControllerCmd,
 }ClimateSensorCmd_Type;
 
@@ -80,6 +79,13 @@ typedef struct
 	void *payload;
 }ControllerCmd;
 
+// Payload of UPDATE_SETTINGS command
+typedef struct
+{
+	ClimateProto_SensorSettings settings;
+	WireFormat wireFormat;
+}ClimateSensorSettings;
+
 typedef struct
 {
 	ClimateSensorCmd_Type cmdType;
@@ -90,22 +96,25 @@ typedef struct
 {
 	Sensor_Type type;
 	float value;
-	unsigned int readInterval;
+	unsigned int readInterval;	// while readings move
 	unsigned int minimumReadInterval;
+	unsigned int maximumReadInterval;	// while readings are stable, see SampleSchedule
 	float readDelta;
-	char *readIntervalString;
-	char *readDeltaString;
+	unsigned int valueField;	// Field in ClimateProto_SensorInfo
+	unsigned int readIntervalField;	// Fields in ClimateProto_SensorSettings
+	unsigned int maximumReadIntervalField;
+	unsigned int readDeltaField;
+	unsigned int medianSizeField;
+	unsigned int filterAlphaField;
+	unsigned int offsetField;
+	unsigned int gainField;
+	unsigned int curveField;
 	char *xmlTagString;
-	SensorReadFunc readFunc;
-	FlowTimer readSensorTimer;
+	SampleSchedule schedule;
+	SensorCalibration calibration;	// Of this device's readings, before they are filtered
+	SensorFilter filter;	// Applied to calibrated readings before comparing them to value
 }Sensor;
 
-typedef struct
-{
-	QueueHandle* queue;
-	ClimateSensorCmd_Type cmdType;
-}TimerContext;
-
 
 // currently all ClimateSensor datastructure are used in ClimateSensorThread
 // using it in other thread would require synchronization
@@ -117,8 +126,14 @@ typedef struct
 	FlowThread sendMessageThread;
 	char *controllerId;
 	unsigned int heartBeat;
-	FlowTimer heartBeatTimer;
+	unsigned int heartBeatDueTick;
 	Sensor sensors[NUM_SENSORS];
+	unsigned int heartBeatKeyframe; // 0 sends all values, K sends a keyframe every K messages and deltas against it between
+	unsigned int sequence;
+	unsigned int base; // sequence of last keyframe, 0 if none sent since settings
+	float keyframeValues[NUM_SENSORS];
+	WireFormat wireFormat; // Encoding of messages to controller, compact once its settings advertised it
+	unsigned long reads; // sensor read transactions, several sensors read together count once
 }ClimateSensor;
 
 /**
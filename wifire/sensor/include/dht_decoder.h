@@ -0,0 +1,61 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+#ifndef DHT_DECODER_H
+#define	DHT_DECODER_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Decoder of a DHT sensor's reply from the times of the level changes on
+ * its data line, as recorded by a capture layer while the CPU does other
+ * work. Pure, so it runs on host against recorded or simulated waveforms.
+ *
+ * Edges are in microseconds, from the sensor pulling the line low to start
+ * its reply: response low, response high, then per bit a low of 50 us and
+ * a high of 26-28 us for 0 or 70 us for 1, and a final falling edge.
+ */
+
+#define DHT_DECODER_NUM_BYTES		(5)	// humidity, temperature, integral and decimal, then checksum
+#define DHT_DECODER_NUM_EDGES		(2 + 2 * 8 * DHT_DECODER_NUM_BYTES + 1)
+#define DHT_DECODER_MAX_EDGES		(2 * DHT_DECODER_NUM_EDGES)	// room for glitches and the release
+
+/*
+ * Fill bytes with the sensor's reply. Edges closer than a glitch are
+ * dropped in pairs. False if the reply is cut short, a pulse is out of
+ * the datasheet's timing or the checksum does not match.
+ */
+bool DhtDecoder_Decode(const uint32_t *edges, unsigned int count, uint8_t *bytes);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* DHT_DECODER_H */
@@ -0,0 +1,76 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+/*
+ * Generated by wifire/sensor/tools/ntc_table.py --name NCP18WF104 --b 4200 --r0 100000 --series 100000
+ * Do not edit, run it again instead.
+ */
+
+#ifndef NTC_NCP18WF104_H
+#define	NTC_NCP18WF104_H
+
+#include "ntc_table.h"
+
+#define NTC_NCP18WF104_B_CONSTANT		(4200)
+#define NTC_NCP18WF104_R0				(100000)
+
+static const int32_t NtcTable_NCP18WF104[NTC_TABLE_SIZE] =
+{
+	-21936, -15148, -13131, -11875, -10947, -10203, -9578, -9038,
+	-8560, -8130, -7739, -7379, -7046, -6735, -6443, -6168,
+	-5907, -5659, -5423, -5196, -4979, -4770, -4569, -4375,
+	-4187, -4005, -3829, -3657, -3490, -3328, -3170, -3015,
+	-2864, -2716, -2571, -2430, -2291, -2155, -2021, -1890,
+	-1760, -1633, -1508, -1385, -1264, -1145, -1027, -911,
+	-796, -683, -571, -460, -351, -243, -136, -30,
+	74, 178, 281, 382, 483, 583, 682, 781,
+	878, 975, 1071, 1166, 1261, 1355, 1448, 1541,
+	1634, 1725, 1817, 1907, 1998, 2088, 2177, 2266,
+	2354, 2443, 2530, 2618, 2705, 2792, 2878, 2964,
+	3050, 3136, 3221, 3306, 3391, 3476, 3561, 3645,
+	3729, 3813, 3897, 3981, 4064, 4148, 4231, 4315,
+	4398, 4481, 4564, 4647, 4730, 4813, 4896, 4979,
+	5062, 5145, 5228, 5311, 5395, 5478, 5561, 5644,
+	5728, 5811, 5895, 5979, 6063, 6147, 6231, 6315,
+	6400, 6485, 6570, 6655, 6740, 6826, 6912, 6998,
+	7084, 7171, 7258, 7345, 7433, 7521, 7609, 7697,
+	7786, 7876, 7966, 8056, 8146, 8237, 8329, 8421,
+	8513, 8606, 8699, 8793, 8888, 8983, 9079, 9175,
+	9272, 9369, 9468, 9567, 9666, 9767, 9868, 9970,
+	10072, 10176, 10280, 10385, 10491, 10598, 10706, 10815,
+	10925, 11036, 11149, 11262, 11376, 11492, 11609, 11727,
+	11847, 11967, 12090, 12213, 12339, 12466, 12594, 12724,
+	12856, 12990, 13125, 13263, 13402, 13544, 13688, 13834,
+	13982, 14133, 14287, 14443, 14602, 14764, 14929, 15097,
+	15268, 15443, 15621, 15804, 15990, 16181, 16376, 16575,
+	16780, 16990, 17205, 17426, 17654, 17888, 18129, 18377,
+	18633, 18898, 19172, 19456, 19750, 20056, 20374, 20706,
+	21052, 21414, 21794, 22193, 22614, 23058, 23529, 24030,
+	24565, 25139, 25758, 26428, 27161, 27966, 28860, 29863,
+	31004, 32324, 33886, 35787, 38202, 41469, 46403, 55893,
+	116438
+};
+
+#endif	/* NTC_NCP18WF104_H */
@@ -0,0 +1,62 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+#ifndef NTC_TABLE_H
+#define	NTC_TABLE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/*
+ * Temperature of an NTC thermistor by 12-bit ADC code, from a table of
+ * the temperature at every NTC_TABLE_STEP codes, linearly interpolated in
+ * between. Temperatures are fixed point, in 1/256 degree C, so a read is a
+ * multiply and a shift instead of a log().
+ *
+ * Tables for a part are generated from its B constant and R0 by
+ * wifire/sensor/tools/ntc_table.py, each in a header of its own.
+ */
+
+#define NTC_TABLE_CODE_BITS			(12)
+#define NTC_TABLE_STEP_BITS			(4)
+#define NTC_TABLE_STEP				(1 << NTC_TABLE_STEP_BITS)
+#define NTC_TABLE_SIZE				((1 << (NTC_TABLE_CODE_BITS - NTC_TABLE_STEP_BITS)) + 1)
+#define NTC_TABLE_FRACTION_BITS		(8)
+
+/*
+ * Temperature for adcValue, in 1/256 degree C. Codes above the 12 bits
+ * are taken as the largest. Code 0, an open thermistor, has no
+ * temperature and gives that of code 1.
+ */
+int32_t NtcTable_Lookup(const int32_t table[NTC_TABLE_SIZE], unsigned int adcValue);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* NTC_TABLE_H */
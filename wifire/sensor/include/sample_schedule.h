@@ -0,0 +1,68 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+#ifndef SAMPLE_SCHEDULE_H
+#define	SAMPLE_SCHEDULE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+/*
+ * When a sensor is next read. While its readings move, it is read every
+ * minimum interval; while they are stable, the interval doubles after each
+ * reading, up to the maximum interval. Readings count as moving while the
+ * last change, or the recent average squared change, is above a quarter of
+ * the read delta, so a change worth a message is caught at full rate.
+ *
+ * Ticks are milliseconds of FlowTimer_GetTickCount() and may wrap.
+ */
+
+typedef struct
+{
+	unsigned int interval;	// milliseconds till next reading
+	unsigned int dueTick;	// of next reading
+	float lastValue;
+	float activity;	// moving average of squared change between readings
+	bool hasValue;
+}SampleSchedule;
+
+// Read next at minimum interval from now, forgetting past readings
+void SampleSchedule_Reset(SampleSchedule *me, unsigned int interval, unsigned int now);
+
+// Take a reading made at now, and schedule the next one
+void SampleSchedule_Update(SampleSchedule *me, float value, float readDelta,
+							unsigned int minimumInterval, unsigned int maximumInterval, unsigned int now);
+
+// Milliseconds till due, 0 if it is
+unsigned int SampleSchedule_TimeToDue(const SampleSchedule *me, unsigned int now);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* SAMPLE_SCHEDULE_H */
@@ -31,6 +31,19 @@ extern "C" {
 #endif
 
 #include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Readings of all channels, taken in one go so that they belong together,
+ * in 1/256 of a degree centigrade or percent as they are calibrated
+ */
+typedef struct
+{
+	int32_t temperature;
+	int32_t humidity;
+	bool isTemperatureRead;
+	bool isHumidityRead;
+}SensorReadings;
 
 #ifdef USE_ADC_SENSOR
 	#include "sensor_adc.h"
@@ -56,12 +69,12 @@ extern "C" {
 
 	#define Sensor_Init Sensor_Thermistor_Init
 	#define Sensor_ReadTemperature Sensor_Thermistor_ReadTemperature
-	static inline bool Sensor_ReadHumidity(float* const humidity)
+	static inline bool Sensor_ReadHumidity(int32_t* const humidity)
 	{
-		*humidity = 0.0f;
+		*humidity = 0;
 		return true;
 	}
-	static inline bool Sensor_ReadHumidityAndTemperature(float* const humidity, float* const temperature)
+	static inline bool Sensor_ReadHumidityAndTemperature(int32_t* const humidity, int32_t* const temperature)
 	{
 		return Sensor_Thermistor_ReadTemperature(temperature) && Sensor_ReadHumidity(humidity);
 	}
@@ -76,6 +89,27 @@ extern "C" {
 	#define Sensor_ReadHumidity Sensor_DHT_ReadHumidity
 
 #endif	/* USE_THERMISTOR_SENSOR */
+
+/* Read all channels. Return true if any of them has been read. */
+#ifdef USE_DHT_SENSOR
+	static inline bool Sensor_ReadAll(SensorReadings* const readings)
+	{
+		//Both channels come from one transaction
+		bool isRead = Sensor_DHT_ReadHumidityAndTemperature(&readings->humidity, &readings->temperature);
+		readings->isTemperatureRead = isRead;
+		readings->isHumidityRead = isRead;
+		return isRead;
+	}
+#else
+	static inline bool Sensor_ReadAll(SensorReadings* const readings)
+	{
+		//Channels are separate conversions or devices
+		readings->isTemperatureRead = Sensor_ReadTemperature(&readings->temperature);
+		readings->isHumidityRead = Sensor_ReadHumidity(&readings->humidity);
+		return readings->isTemperatureRead || readings->isHumidityRead;
+	}
+#endif	/* USE_DHT_SENSOR */
+
 #ifdef	__cplusplus
 }
 #endif
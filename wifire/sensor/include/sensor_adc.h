@@ -31,6 +31,7 @@ extern "C" {
 #endif
 
 #include <stdbool.h>
+#include <stdint.h>
 
 /**
  * \memberof Heater
@@ -44,25 +45,25 @@ void Sensor_ADC_Init(void);
 /**
  * \memberof Heater
  * \param void
- * \brief Returns temperature read from the sensor range TBD
+ * \brief Returns temperature read from the sensor range TBD, in 1/256 degree centigrade
  *
 */
-bool Sensor_ADC_ReadTemperature(float* const temperature);
+bool Sensor_ADC_ReadTemperature(int32_t* const temperature);
 
 /**
  * \memberof Heater
  * \param void
- * \brief Returns Humidity value in percentage 0.0 to 100.0
+ * \brief Returns Humidity value in percentage 0.0 to 100.0, in 1/256 percent
  *
 */
-bool Sensor_ADC_ReadHumidity(float* const humidity);
+bool Sensor_ADC_ReadHumidity(int32_t* const humidity);
 
 /**
  * \memberof Heater
  * \param place holders for humidity and temperature
  * \brief Returns :- whether retrieving values from the sensor is successful or not.
 */
-bool Sensor_ADC_ReadHumidityAndTemperature(float* const humidity, float* const temperature);
+bool Sensor_ADC_ReadHumidityAndTemperature(int32_t* const humidity, int32_t* const temperature);
 
 #ifdef	__cplusplus
 }
@@ -0,0 +1,80 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+#ifndef SENSOR_CALIBRATION_H
+#define	SENSOR_CALIBRATION_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/*
+ * Correction of a sensor's readings for the device it is on, the second
+ * order polynomial value = offset + gain * reading + curve * reading^2,
+ * gain/offset alone with curve 0. Readings and values are fixed point in
+ * 1/256 of their unit, and so are the coefficients, with the fraction
+ * bits of the UPDATE_SETTINGS fields they come in (see climate_proto.h),
+ * so that a reading is corrected in a few integer ops without branches.
+ */
+
+#define SENSOR_CALIBRATION_READING_BITS		(8)		// and offset
+#define SENSOR_CALIBRATION_GAIN_BITS		(16)
+#define SENSOR_CALIBRATION_CURVE_BITS		(SENSOR_CALIBRATION_READING_BITS + SENSOR_CALIBRATION_GAIN_BITS)
+
+typedef struct
+{
+	int32_t offset;
+	int32_t gain;
+	int32_t curve;
+}SensorCalibration;
+
+//Calibration leaving readings as they are
+#define SENSOR_CALIBRATION_NONE		{ .offset = 0, .gain = 1 << SENSOR_CALIBRATION_GAIN_BITS, .curve = 0 }
+
+/*
+ * Corrected reading, in Horner form: the curve term adds to the gain.
+ * Products are 64 bit so that readings of a few hundred units with gains
+ * of a few times do not overflow.
+ */
+static inline int32_t SensorCalibration_Apply(const SensorCalibration *me, int32_t reading)
+{
+	int32_t slope = me->gain + (int32_t)(((int64_t)me->curve * reading) >> SENSOR_CALIBRATION_GAIN_BITS);
+
+	return me->offset + (int32_t)(((int64_t)slope * reading) >> SENSOR_CALIBRATION_GAIN_BITS);
+}
+
+/*
+ * Same, for a reading in its unit, e.g. to check against the polynomial.
+ * Drivers give readings in fixed point, so the sample path does not use it.
+ */
+float SensorCalibration_ApplyFloat(const SensorCalibration *me, float reading);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* SENSOR_CALIBRATION_H */
@@ -31,11 +31,8 @@ extern "C" {
 #endif
 
 #include <stdbool.h>
+#include <stdint.h>
 
-#define SENSOR_PIN_READ() PLIB_PORTS_PinGet(PORTS_ID_0, DHT_SENSOR_PORT, DHT_SENSOR_PIN)
-#define SENSOR_PIN_WRITE(state) do {\
-PLIB_PORTS_PinWrite(PORTS_ID_0, DHT_SENSOR_PORT, DHT_SENSOR_PIN, state);\
-} while(0)
 /**
  * \memberof Heater
  * \param void
@@ -47,24 +44,25 @@ void Sensor_DHT_Init(void);
 
 /**
  * \memberof Heater
- * \param place holders for temperature
- * \brief Note: Temperature value set is the cached value from last humidity read(after Sensor_DHT_ReadHumidity)
+ * \param place holders for temperature, in 1/256 degree centigrade
+ * \brief Returns :- whether retrieving values from the sensor is successful or not.
+ * Note: each call is a full transaction, use Sensor_DHT_ReadHumidityAndTemperature to read both
 */
-bool Sensor_DHT_ReadTemperature(float* const temperature);
+bool Sensor_DHT_ReadTemperature(int32_t* const temperature);
 
 /**
  * \memberof Heater
- * \param place holders for humidity
+ * \param place holders for humidity, in 1/256 percent
  * \brief Returns :- whether retrieving values from the sensor is successful or not.
 */
-bool Sensor_DHT_ReadHumidity(float* const humidity);
+bool Sensor_DHT_ReadHumidity(int32_t* const humidity);
 
 /**
  * \memberof Heater
  * \param place holders for humidity and temperature
  * \brief Returns :- whether retrieving values from the sensor is successful or not.
 */
-bool Sensor_DHT_ReadHumidityAndTemperature(float* const humidity, float* const temperature);
+bool Sensor_DHT_ReadHumidityAndTemperature(int32_t* const humidity, int32_t* const temperature);
 
 #ifdef	__cplusplus
 }
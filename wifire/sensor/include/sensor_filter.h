@@ -0,0 +1,74 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+#ifndef SENSOR_FILTER_H
+#define	SENSOR_FILTER_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Filter of a sensor's calibrated readings before they are compared to
+ * the last reported value: a median of the last medianSize readings to
+ * drop spikes, then an exponential moving average with weight alpha for
+ * the new median. Readings are fixed point as calibrated, and alpha has
+ * SENSOR_FILTER_ALPHA_BITS fraction bits, so that filtering is integer
+ * only. State is a fixed window kept in the filter, no allocation.
+ *
+ * A zeroed filter passes readings through, as do medianSize 1 and alpha 1.
+ */
+
+#define SENSOR_FILTER_MAX_MEDIAN_SIZE		(7)
+#define SENSOR_FILTER_ALPHA_BITS			(16)
+#define SENSOR_FILTER_ALPHA_ONE				(1u << SENSOR_FILTER_ALPHA_BITS)
+
+typedef struct
+{
+	unsigned int medianSize;	// readings a median is taken of, 0 or 1 for none
+	uint32_t alpha;	// weight of a new reading in the average, 0 or SENSOR_FILTER_ALPHA_ONE for none
+	int32_t window[SENSOR_FILTER_MAX_MEDIAN_SIZE];	// last readings, oldest at next once full
+	unsigned int count;
+	unsigned int next;
+	int32_t average;	// valid once count > 0
+}SensorFilter;
+
+/*
+ * Set filter parameters, forgetting past readings. False, leaving the
+ * filter unchanged, if medianSize is above SENSOR_FILTER_MAX_MEDIAN_SIZE
+ * or alpha is not in (0, SENSOR_FILTER_ALPHA_ONE].
+ */
+bool SensorFilter_Configure(SensorFilter *me, unsigned int medianSize, uint32_t alpha);
+void SensorFilter_Reset(SensorFilter *me);
+int32_t SensorFilter_Apply(SensorFilter *me, int32_t reading);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* SENSOR_FILTER_H */
@@ -31,6 +31,7 @@ extern "C" {
 #endif
 
 #include <stdbool.h>
+#include <stdint.h>
 
 /**
  * \memberof Heater
@@ -44,17 +45,24 @@ void Sensor_Thermistor_Init(void);
 /**
  * \memberof Heater
  * \param void
- * \brief Returns temperature read from the sensor range TBD
+ * \brief Returns temperature read from the sensor range TBD, in 1/256 degree centigrade
  *
 */
-bool Sensor_Thermistor_ReadTemperature(float* const temperature);
+bool Sensor_Thermistor_ReadTemperature(int32_t* const temperature);
+
+/**
+ * \memberof Heater
+ * \param 12-bit ADC code of the thermistor input, place holder for temperature
+ * \brief Returns :- whether the code is a temperature, false for 0, an open thermistor.
+*/
+bool Sensor_Thermistor_Convert(unsigned int adcValue, int32_t* const temperature);
 
 /**
  * \memberof Heater
  * \param place holders for humidity and temperature
  * \brief Returns :- whether retrieving values from the sensor is successful or not.
 */
-bool Sensor_Thermistor_ReadHumidityAndTemperature(float* const humidity, float* const temperature);
+bool Sensor_Thermistor_ReadHumidityAndTemperature(int32_t* const humidity, int32_t* const temperature);
 
 #ifdef	__cplusplus
 }
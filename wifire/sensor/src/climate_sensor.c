@@ -36,7 +36,12 @@
 #include "queue_wrapper.h"
 #include "climate_control_logging.h"
 #include "send_message.h"
+#include "message_template.h"
+#include "climate_proto.h"
 
+#if SENSOR_FILTER_ALPHA_BITS != CLIMATE_PROTO_FILTER_ALPHA_FRACTION_BITS
+#error Filter alpha is taken from UPDATE_SETTINGS as it is
+#endif
 
 struct tm *gmtime_r(const time_t *timep, struct tm *result);
 
@@ -48,60 +53,169 @@ static void QueueMeasurementMsg(ClimateSensor* me);
 static void ClimateSensorThread(FlowThread thread, void *taskParameters);
 static int CompareMeasurements(float a, float b, float offset);
 static char* CreateMessageXML(ClimateSensor* me, time_t time);
-static void CmdTimerHandler(FlowTimer timer, void *context);
+static char* FormatMessageXML(ClimateSensor* me, time_t time);
+static char* CreateDeltaMessageXML(ClimateSensor* me, time_t time);
 static void CleanUp(ClimateSensor* me);
 static ControllerCmd* ParseMsgAndCreateControllerCmd(const char* msgString);
-static ControllerCmd* CreateControllerCmd(char *cmd, const char *msgString);
-static bool NodeValueToInt(TreeNode root, unsigned int* valueToSet, char* nodeName);
-static bool NodeValueToFloat(TreeNode root, float* valueToSet, char* nodeName);
+static ControllerCmd* CreateControllerCmd(const ClimateProto_Command *command, const ClimateProto_SensorSettings *settings);
+static void SerializeValues(ClimateSensor* me, bool isChangedOnly, char *buffer, size_t size);
 static void FreeControllerCmd(ControllerCmd *command);
-static void StopAndFreeTimers(ClimateSensor *me);
-static bool IsSensorValueChanged(ClimateSensor* me, Sensor_Type sensor);
+static bool ApplyReading(ClimateSensor* me, unsigned int index, int32_t reading, float *value);
+static bool ReadSensors(ClimateSensor* me, const bool *isDue, unsigned int now);
+static bool RunSchedule(ClimateSensor* me, unsigned int now);
+static unsigned int TimeToWakeup(const ClimateSensor* me, unsigned int now);
 static float GetCurrentSensorValue(ClimateSensor *me, Sensor_Type type);
-static void ParseAndUpdateSettings(ClimateSensor* me, const char* details);
+static void UpdateSettings(ClimateSensor* me, const ClimateSensorSettings* update);
 static void CommandsHandlerInternal(ClimateSensor* me, ControllerCmd* command);
-static void StartTimers(ClimateSensor *me);
+static void StartSchedule(ClimateSensor *me, unsigned int now);
 
 static int CompareMeasurements(float a, float b, float offset)
 {
 	return (fabs(a - b) > offset);
 }
 
-static char* CreateMessageXML(ClimateSensor* me, time_t time)
+/*
+ * Info of a measurement message, with all values or only those which
+ * differ from the last keyframe
+ */
+static void SerializeValues(ClimateSensor* me, bool isChangedOnly, char *buffer, size_t size)
+{
+	ClimateProto_SensorInfo info = { 0 };
+	unsigned int i;
+	for (i = 0; i < NUM_SENSORS; ++i)
+	{
+		if (!isChangedOnly || (me->sensors[i].value != me->keyframeValues[i]))
+		{
+			ClimateProto_SetFloat(&ClimateProto_SensorInfoSchema, &info, me->sensors[i].valueField, me->sensors[i].value);
+		}
+	}
+	ClimateProto_Serialize(&ClimateProto_SensorInfoSchema, &info, buffer, size);
+}
+
+static char* FormatMessageXML(ClimateSensor* me, time_t time)
 {
 	char *tempString = NULL;
 	struct tm timeNow;
 	gmtime_r(&time, &timeNow);
-	unsigned int i;
 	char tagArray[TAG_ARRAY_SIZE] = {0};
-	for (i = 0; i < NUM_SENSORS; ++i)
+	SerializeValues(me, false, tagArray, sizeof(tagArray));
+	const char *msgXML = CLIMATE_PROTO_XML_DECLARATION
+						"<event>"
+							CLIMATE_PROTO_TIME_XML
+							"<type>Sensor</type>"
+							"<info>"
+								"%s"
+							"</info>"
+							WIRE_FORMAT_XML_TAG
+						"</event>";
+	unsigned int stringSize = strlen(msgXML) + strlen(tagArray) + 1;
+	tempString = Flow_MemAlloc(stringSize);
+	if (tempString)
+	{
+		snprintf(tempString, stringSize, msgXML,
+				CLIMATE_PROTO_TIME_ARGS(timeNow),
+				tagArray);
+	}
+	return tempString;
+}
+
+/*
+ * Measurement message from a template rendered on first use, with time and
+ * values patched in. Falls back to formatting if a value does not fit.
+ */
+static char* CreateMessageXML(ClimateSensor* me, time_t time)
+{
+	static MessageTemplate msgTemplate;
+	static bool isRendered = false;
+	char *message;
+	unsigned int i;
+	bool success;
+
+	if (me->heartBeatKeyframe)
 	{
-		unsigned int len;
-		char tag[TAG_SIZE] = {0};
-		len = strlen(me->sensors[i].xmlTagString) + 1;
-		snprintf(tag, len, me->sensors[i].xmlTagString, me->sensors[i].value);
-		strncat(tagArray, tag, len);
+		return CreateDeltaMessageXML(me, time);
 	}
-	const char *msgXML = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+	if (!isRendered)
+	{
+		MessageTemplate_Init(&msgTemplate);
+		MessageTemplate_AppendText(&msgTemplate, CLIMATE_PROTO_XML_DECLARATION "<event><time type=\"datetime\">");
+		MessageTemplate_AppendTime(&msgTemplate);
+		MessageTemplate_AppendText(&msgTemplate, "</time><type>Sensor</type><info>");
+		for (i = 0; i < NUM_SENSORS; ++i)
+		{
+			MessageTemplate_AppendFormat(&msgTemplate, me->sensors[i].xmlTagString, 0);
+		}
+		MessageTemplate_AppendText(&msgTemplate, "</info>" WIRE_FORMAT_XML_TAG "</event>");
+		isRendered = true;
+	}
+
+	message = MessageTemplate_Copy(&msgTemplate);
+	if (message)
+	{
+		success = MessageTemplate_SetTime(&msgTemplate, message, 0, time);
+		for (i = 0; (i < NUM_SENSORS) && success; ++i)
+		{
+			success = MessageTemplate_SetFloat(&msgTemplate, message, i + 1, me->sensors[i].value);
+		}
+		if (success)
+		{
+			return message;
+		}
+		Flow_MemFree((void **)&message);
+	}
+	return FormatMessageXML(me, time);
+}
+
+/*
+ * Measurement message carrying a sequence number and the sequence of its
+ * keyframe. Every heartBeatKeyframe messages, and after settings, all values
+ * are sent. Messages between carry only the values which differ from that
+ * keyframe, so that controller can apply each on its own even if others
+ * were lost.
+ */
+static char* CreateDeltaMessageXML(ClimateSensor* me, time_t time)
+{
+	char *tempString = NULL;
+	struct tm timeNow;
+	unsigned int sequence, i;
+	bool isKeyframe;
+	char tagArray[TAG_ARRAY_SIZE] = {0};
+	const char *msgXML = CLIMATE_PROTO_XML_DECLARATION
 						"<event>"
-							"<time type=\"datetime\">%04d-%02d-%02dT%02d:%02d:%02dZ</time>"
+							CLIMATE_PROTO_TIME_XML
 							"<type>Sensor</type>"
+							"<seq>%u</seq>"
+							"<base>%u</base>"
 							"<info>"
 								"%s"
 							"</info>"
+							WIRE_FORMAT_XML_TAG
 						"</event>";
-	unsigned int stringSize = strlen(msgXML) + strlen(tagArray) + 1;
+
+	gmtime_r(&time, &timeNow);
+	//0 marks no keyframe, so it is skipped on wrap
+	sequence = (me->sequence + 1) ? (me->sequence + 1) : 1;
+	isKeyframe = (me->base == 0) || ((sequence - me->base) >= me->heartBeatKeyframe);
+	SerializeValues(me, !isKeyframe, tagArray, sizeof(tagArray));
+
+	unsigned int stringSize = strlen(msgXML) + strlen(tagArray) + 2 * 10 + 1;
 	tempString = Flow_MemAlloc(stringSize);
 	if (tempString)
 	{
 		snprintf(tempString, stringSize, msgXML,
-				timeNow.tm_year + 1900,
-				timeNow.tm_mon + 1,
-				timeNow.tm_mday,
-				timeNow.tm_hour,
-				timeNow.tm_min,
-				timeNow.tm_sec,
+				CLIMATE_PROTO_TIME_ARGS(timeNow),
+				sequence,
+				isKeyframe ? sequence : me->base,
 				tagArray);
+		me->sequence = sequence;
+		if (isKeyframe)
+		{
+			me->base = sequence;
+			for (i = 0; i < NUM_SENSORS; ++i)
+			{
+				me->keyframeValues[i] = me->sensors[i].value;
+			}
+		}
 	}
 	return tempString;
 }
@@ -120,33 +234,115 @@ static float GetCurrentSensorValue(ClimateSensor *me, Sensor_Type type)
 }
 
 /*
- * Read sensor value and return true if value has been changed more than read delta
+ * Calibrate and filter a sensor's reading, in fixed point as the drivers
+ * give it, and return true if filtered value has been changed more than
+ * read delta. The filtered value is set in its unit, as it is reported.
+ */
+static bool ApplyReading(ClimateSensor* me, unsigned int index, int32_t reading, float *value)
+{
+	reading = SensorCalibration_Apply(&me->sensors[index].calibration, reading);
+	reading = SensorFilter_Apply(&me->sensors[index].filter, reading);
+	*value = reading * (1.0f / (1 << SENSOR_CALIBRATION_READING_BITS));
+	if (CompareMeasurements(me->sensors[index].value, *value, me->sensors[index].readDelta))
+	{
+		me->sensors[index].value = *value;
+		return true;
+	}
+	return false;
+}
+
+/*
+ * Read all channels in one go, and filter and schedule next reading of
+ * the sensors that are due, with the same tick. Return true if a value
+ * has been changed more than read delta.
  */
-static bool IsSensorValueChanged(ClimateSensor* me, Sensor_Type sensor)
+static bool ReadSensors(ClimateSensor* me, const bool *isDue, unsigned int now)
 {
-	float value = 0.0f;
-	unsigned int index;
-	for (index = 0; index < NUM_SENSORS; ++index)
+	SensorReadings readings;
+	bool isChanged = false;
+	unsigned int i;
+
+	Sensor_ReadAll(&readings);
+	me->reads++;
+	for (i = 0; i < NUM_SENSORS; ++i)
 	{
-		if (sensor == me->sensors[index].type)
+		Sensor *sensor = &me->sensors[i];
+		bool isTemperature = (sensor->type == Sensor_Temperature);
+		float value;
+
+		if (!isDue[i])
 		{
-			break;
+			continue;
+		}
+		if (isTemperature ? readings.isTemperatureRead : readings.isHumidityRead)
+		{
+			isChanged = ApplyReading(me, i, isTemperature ? readings.temperature : readings.humidity, &value) ||
+						isChanged;
+			SampleSchedule_Update(&sensor->schedule, value, sensor->readDelta,
+									sensor->readInterval, sensor->maximumReadInterval, now);
+		}
+		else
+		{
+			//Failed read is retried at full rate
+			SampleSchedule_Reset(&sensor->schedule, sensor->readInterval, now);
 		}
 	}
-	if (index < NUM_SENSORS)
+	return isChanged;
+}
+
+/*
+ * Read sensors due at now and take heartbeat if it is due. A sensor due
+ * within an eighth of its interval is read along with one that is due, as
+ * one transaction may read both. Return true if a message is to be sent.
+ */
+static bool RunSchedule(ClimateSensor* me, unsigned int now)
+{
+	bool isDue[NUM_SENSORS];
+	bool isAnyDue = false;
+	bool isSend = false;
+	unsigned int i;
+
+	for (i = 0; i < NUM_SENSORS; ++i)
+	{
+		isDue[i] = (SampleSchedule_TimeToDue(&me->sensors[i].schedule, now) == 0);
+		isAnyDue = isAnyDue || isDue[i];
+	}
+	if (isAnyDue)
 	{
-		bool success;
-		success = me->sensors[index].readFunc(&value);
-		if (success)
+		for (i = 0; i < NUM_SENSORS; ++i)
 		{
-			if (CompareMeasurements(me->sensors[index].value, value, me->sensors[index].readDelta))
-			{
-				me->sensors[index].value = value;
-				return true;
-			}
+			isDue[i] = isDue[i] ||
+						(SampleSchedule_TimeToDue(&me->sensors[i].schedule, now) <= me->sensors[i].schedule.interval / 8);
 		}
+		isSend = ReadSensors(me, isDue, now);
 	}
-	return false;
+	if ((int)(me->heartBeatDueTick - now) <= 0)
+	{
+		me->heartBeatDueTick = now + me->heartBeat;
+		isSend = true;
+	}
+	return isSend;
+}
+
+/*
+ * Milliseconds till next sensor reading or heartbeat, 0 if one is due
+ */
+static unsigned int TimeToWakeup(const ClimateSensor* me, unsigned int now)
+{
+	int heartBeat = (int)(me->heartBeatDueTick - now);
+	unsigned int timeout = (heartBeat > 0) ? (unsigned int)heartBeat : 0;
+	unsigned int i;
+
+	for (i = 0; i < NUM_SENSORS; ++i)
+	{
+		unsigned int due = SampleSchedule_TimeToDue(&me->sensors[i].schedule, now);
+
+		if (due < timeout)
+		{
+			timeout = due;
+		}
+	}
+	return timeout;
 }
 
 static void QueueMeasurementMsg(ClimateSensor* me)
@@ -154,15 +350,30 @@ static void QueueMeasurementMsg(ClimateSensor* me)
 	time_t time;
 	Flow_GetTime(&time);
 	char* msgXML = CreateMessageXML(me, time);
+	if (msgXML && (me->wireFormat == WireFormat_Compact))
+	{
+		//Controller takes XML too, so that is sent if encoding fails
+		char *compact = WireFormat_ToCompact(msgXML);
+		if (compact)
+		{
+			Flow_MemFree((void **)&msgXML);
+			msgXML = compact;
+		}
+	}
 	if (msgXML)
 	{
 		MeasurementMsg msg;
 		msg.deviceId = FlowString_Duplicate(me->controllerId);
 		msg.details = msgXML;
+		//Kept to upload later if the message cannot be sent or queued
+		SampleBuffer_MakeSample(&msg.sample, time,
+								GetCurrentSensorValue(me, Sensor_Temperature),
+								GetCurrentSensorValue(me, Sensor_Humidity));
 
 		if (false == QueueSend(me->sendMessageQueue, &msg))
 		{
 			ClimateControl_Log(ClimateControlLogLevel_Error, ERROR_PREFIX "Enqueuing sendMessageQueue failed");
+			SendMessage_KeepSample(&msg);
 			Flow_MemFree((void **)&(msg.deviceId));
 			Flow_MemFree((void **)&msgXML);
 		}
@@ -184,68 +395,104 @@ static void QueueMeasurementMsg(ClimateSensor* me)
 	}
 }
 
-static void CmdTimerHandler(FlowTimer timer, void *context)
+static void UpdateSettings(ClimateSensor* me, const ClimateSensorSettings* update)
 {
-	if (context)
+	const ClimateProto_Schema *schema = &ClimateProto_SensorSettingsSchema;
+	const ClimateProto_SensorSettings *settings = &update->settings;
+	unsigned int now = FlowTimer_GetTickCount();
+	unsigned int i;
+	if ((settings->present & CLIMATE_PROTO_PRESENT(SensorSettings, heartBeat)) &&
+		(me->heartBeat != settings->heartBeat))
 	{
-		TimerContext* timerContext = context;
-		QueueHandle* cmdQueue = timerContext->queue ;
-		ClimateSensorCmd cmd;
-		cmd.cmdType = timerContext->cmdType;
-		cmd.details = NULL;
-		if (false == QueueSend(cmdQueue, &cmd))
-		{
-			ClimateControl_Log(ClimateControlLogLevel_Error, ERROR_PREFIX "ClimateSensor thread can't post in queue %d/%d",
-								QueueNumOfItems(cmdQueue),
-								CLIMATE_SENSOR_MSG_QUEUE_SIZE);
-		}
+		ClimateControl_Log(ClimateControlLogLevel_Info, INFO_PREFIX "Changed heartbeat timer period from %u to %u ",
+														me->heartBeat, settings->heartBeat);
+		me->heartBeat = settings->heartBeat;
+		me->heartBeatDueTick = now + me->heartBeat;
 	}
-}
 
-static void ParseAndUpdateSettings(ClimateSensor* me, const char* details)
-{
-	if (details)
+	//Controller may have restarted, so next message is a keyframe. Missing
+	//keyframe setting parses as 0, which sends all values.
+	me->heartBeatKeyframe = settings->heartBeatKeyframe;
+	me->base = 0;
+	me->wireFormat = update->wireFormat;
+
+	for (i = 0 ; i < NUM_SENSORS; ++i)
 	{
-		TreeNode xmlTreeRoot = TreeNode_ParseXML((uint8_t*)details, strlen(details), true);
-		if (xmlTreeRoot)
+		unsigned int readInterval;
+		unsigned int maximumReadInterval;
+		float readDelta;
+		unsigned int medianSize;
+		unsigned int alpha;
+		int offset, gain, curve;
+		if (ClimateProto_GetUint(schema, settings, me->sensors[i].readIntervalField, &readInterval) &&
+			(readInterval != me->sensors[i].readInterval) &&
+			(readInterval > me->sensors[i].minimumReadInterval))
+		{
+			ClimateControl_Log(ClimateControlLogLevel_Info, INFO_PREFIX "Changed read timer period from %u to %u",
+								me->sensors[i].readInterval,
+								readInterval);
+			me->sensors[i].readInterval = readInterval;
+			SampleSchedule_Reset(&me->sensors[i].schedule, me->sensors[i].readInterval, now);
+		}
+
+		//Below read interval, readings are at a fixed period
+		if (ClimateProto_GetUint(schema, settings, me->sensors[i].maximumReadIntervalField, &maximumReadInterval) &&
+			(maximumReadInterval != me->sensors[i].maximumReadInterval))
 		{
-			unsigned int i, value;
-			if (NodeValueToInt(xmlTreeRoot, &value, HEART_BEAT_XML_TAG) &&
-				(me->heartBeatTimer) &&
-				(me->heartBeat != value))
+			ClimateControl_Log(ClimateControlLogLevel_Info, INFO_PREFIX "Changed maximum read period from %u to %u",
+								me->sensors[i].maximumReadInterval,
+								maximumReadInterval);
+			me->sensors[i].maximumReadInterval = maximumReadInterval;
+			SampleSchedule_Reset(&me->sensors[i].schedule, me->sensors[i].readInterval, now);
+		}
+
+		if (ClimateProto_GetFloat(schema, settings, me->sensors[i].readDeltaField, &readDelta) &&
+			(me->sensors[i].readDelta != readDelta))
+		{
+			ClimateControl_Log(ClimateControlLogLevel_Info, INFO_PREFIX "Changed read delta from %f to %f",
+								me->sensors[i].readDelta,
+								readDelta);
+			me->sensors[i].readDelta = readDelta;
+		}
+
+		//Filter parameters not in settings are kept
+		medianSize = me->sensors[i].filter.medianSize;
+		alpha = me->sensors[i].filter.alpha;
+		ClimateProto_GetUint(schema, settings, me->sensors[i].medianSizeField, &medianSize);
+		ClimateProto_GetUint(schema, settings, me->sensors[i].filterAlphaField, &alpha);
+		if ((medianSize != me->sensors[i].filter.medianSize) || (alpha != me->sensors[i].filter.alpha))
+		{
+			if (SensorFilter_Configure(&me->sensors[i].filter, medianSize, alpha))
 			{
-				ClimateControl_Log(ClimateControlLogLevel_Info, INFO_PREFIX "Changed heartbeat timer period from %u to %u ",
-																me->heartBeat, value);
-				me->heartBeat = value;
-				FlowTimer_SetPeriod(me->heartBeatTimer, me->heartBeat);
+				ClimateControl_Log(ClimateControlLogLevel_Info, INFO_PREFIX "Changed filter to median of %u, alpha %f",
+									medianSize,
+									(float)alpha / SENSOR_FILTER_ALPHA_ONE);
 			}
-
-			for (i = 0 ; i < NUM_SENSORS; ++i)
+			else
 			{
-				unsigned int readInterval;
-				float readDelta;
-				if (NodeValueToInt(xmlTreeRoot, &readInterval, me->sensors[i].readIntervalString) &&
-					(readInterval != me->sensors[i].readInterval) &&
-					(readInterval > me->sensors[i].minimumReadInterval) &&
-					(me->sensors[i].readSensorTimer))
-				{
-					ClimateControl_Log(ClimateControlLogLevel_Info, INFO_PREFIX "Changed read timer period from %u to %u",
-										me->sensors[i].readInterval,
-										readInterval);
-					me->sensors[i].readInterval = readInterval;
-					FlowTimer_SetPeriod(me->sensors[i].readSensorTimer, me->sensors[i].readInterval);
-				}
-
-				if (NodeValueToFloat(xmlTreeRoot, &readDelta, me->sensors[i].readDeltaString) &&
-					(me->sensors[i].readDelta != readDelta))
-				{
-					ClimateControl_Log(ClimateControlLogLevel_Info, INFO_PREFIX "Changed read delta from %f to %f",
-										me->sensors[i].readDelta,
-										readDelta);
-					me->sensors[i].readDelta = readDelta;
-				}
+				ClimateControl_Log(ClimateControlLogLevel_Error, ERROR_PREFIX "Invalid filter median of %u, alpha %f",
+									medianSize,
+									(float)alpha / SENSOR_FILTER_ALPHA_ONE);
 			}
-			Tree_Delete(xmlTreeRoot);
+		}
+
+		//As are coefficients of the calibration
+		offset = me->sensors[i].calibration.offset;
+		gain = me->sensors[i].calibration.gain;
+		curve = me->sensors[i].calibration.curve;
+		ClimateProto_GetInt(schema, settings, me->sensors[i].offsetField, &offset);
+		ClimateProto_GetInt(schema, settings, me->sensors[i].gainField, &gain);
+		ClimateProto_GetInt(schema, settings, me->sensors[i].curveField, &curve);
+		if ((offset != me->sensors[i].calibration.offset) || (gain != me->sensors[i].calibration.gain) ||
+			(curve != me->sensors[i].calibration.curve))
+		{
+			ClimateControl_Log(ClimateControlLogLevel_Info, INFO_PREFIX "Changed calibration to offset %d, gain %d, curve %d",
+								offset,
+								gain,
+								curve);
+			me->sensors[i].calibration.offset = offset;
+			me->sensors[i].calibration.gain = gain;
+			me->sensors[i].calibration.curve = curve;
 		}
 	}
 }
@@ -256,7 +503,7 @@ static void CommandsHandlerInternal(ClimateSensor* me, ControllerCmd* command)
 	if (strcmp(command->cmd, UPDATE_SETTINGS_STR) == 0)
 	{
 		ClimateControl_Log(ClimateControlLogLevel_Info, INFO_PREFIX "%s", UPDATE_SETTINGS_STR);
-		ParseAndUpdateSettings(me, command->payload);
+		UpdateSettings(me, command->payload);
 	}
 	else
 	{
@@ -264,92 +511,34 @@ static void CommandsHandlerInternal(ClimateSensor* me, ControllerCmd* command)
 	}
 }
 
-static void StopAndFreeTimers(ClimateSensor *me)
+static void StartSchedule(ClimateSensor *me, unsigned int now)
 {
 	unsigned int i;
 	for (i = 0; i < NUM_SENSORS; ++i)
 	{
-		if (me->sensors[i].readSensorTimer)
-		{
-			FlowTimer_Stop(me->sensors[i].readSensorTimer);
-			FlowTimer_Free(me->sensors[i].readSensorTimer);
-		}
-	}
-	if (me->heartBeatTimer)
-	{
-		FlowTimer_Stop(me->heartBeatTimer);
-		FlowTimer_Free(me->heartBeatTimer);
+		SampleSchedule_Reset(&me->sensors[i].schedule, me->sensors[i].readInterval, now);
 	}
-}
-
-static void StartTimers(ClimateSensor *me)
-{
-	unsigned int i;
-	for (i = 0; i < NUM_SENSORS; ++i)
-	{
-		FlowTimer_Start(me->sensors[i].readSensorTimer);
-	}
-	FlowTimer_Start(me->heartBeatTimer);
+	me->heartBeatDueTick = now + me->heartBeat;
 }
 
 static void ClimateSensorThread(FlowThread thread, void *taskParameters)
 {
-	// 1. Reads the sensor periodically
+	// 1. Reads the sensors when due, more often while their readings move
 	// 2. if change in temperature/humidity Queue measurement msg in SendMessage Queue
-	// 3. if HEARTBEAT timeout  Queue heartbeat msg in SendMessage Queue.
+	// 3. if HEARTBEAT is due Queue heartbeat msg in SendMessage Queue.
+	// Waits for commands from controller till next reading or heartbeat is due.
 	ClimateControl_Log(ClimateControlLogLevel_Debug, DEBUG_PREFIX "climateSensorThread started");
 	ClimateSensor* me = taskParameters;
 
-	TimerContext humidityTimerContext = {me->cmdQueue, ClimateSensorCmd_ReadHumiditySensor};
-	TimerContext temperatureTimerContext = {me->cmdQueue, ClimateSensorCmd_ReadTemperatureSensor};
-	TimerContext heartBeatTimerContext = {me->cmdQueue, ClimateSensorCmd_SendHeartBeat};
-
-	me->sensors[Sensor_Humidity].readSensorTimer = FlowTimer_New("ReadHumiditySensorTimer", MINIMUM_HUMIDITY_SENSOR_READ_PERIOD, true, CmdTimerHandler, (void *)&humidityTimerContext);
-	me->sensors[Sensor_Temperature].readSensorTimer = FlowTimer_New("ReadTemperatureSensorTimer", MINIMUM_TEMPERATURE_SENSOR_READ_PERIOD, true, CmdTimerHandler, (void *)&temperatureTimerContext);
-	me->heartBeatTimer = FlowTimer_New("HeartBeatCmdTimer", DEFAULT_HEART_BEAT_PERIOD, true, CmdTimerHandler, (void *)&heartBeatTimerContext);
-	if (me->sensors[Sensor_Temperature].readSensorTimer == NULL ||
-		me->heartBeatTimer == NULL ||
-		me->sensors[Sensor_Humidity].readSensorTimer == NULL
-		)
-	{
-		ClimateControl_Log(ClimateControlLogLevel_Error, ERROR_PREFIX "Timer creation failed");
-		StopAndFreeTimers(me);
-		// can't do much return
-		return;
-	}
-	StartTimers(me);
+	StartSchedule(me, FlowTimer_GetTickCount());
 	while (me)
 	{
 		//check for any commands
 		ClimateSensorCmd cmd;
-		if (QueueReceive(me->cmdQueue, &cmd, -1))
+		if (QueueReceive(me->cmdQueue, &cmd, (int)TimeToWakeup(me, FlowTimer_GetTickCount())))
 		{
 			switch (cmd.cmdType)
 			{
-				case ClimateSensorCmd_ReadTemperatureSensor:
-				{
-					ClimateControl_Log(ClimateControlLogLevel_Debug, DEBUG_PREFIX "Received ClimateSensorCmd_ReadTemperatureSensor");
-					if (IsSensorValueChanged(me, Sensor_Temperature))
-					{
-						QueueMeasurementMsg(me);
-					}
-					break;
-				}
-				case ClimateSensorCmd_ReadHumiditySensor:
-				{
-					ClimateControl_Log(ClimateControlLogLevel_Debug, DEBUG_PREFIX "Received ClimateSensorCmd_ReadHumiditySensor");
-					if (IsSensorValueChanged(me, Sensor_Humidity))
-					{
-						QueueMeasurementMsg(me);
-					}
-					break;
-				}
-				case ClimateSensorCmd_SendHeartBeat:
-				{
-					ClimateControl_Log(ClimateControlLogLevel_Debug, DEBUG_PREFIX "Received ClimateSensorCmd_SendHeartBeat");
-					QueueMeasurementMsg(me);
-					break;
-				}
 				case ClimateSensorCmd_ControllerCmd:
 				{
 					ClimateControl_Log(ClimateControlLogLevel_Debug, DEBUG_PREFIX "Received ClimateSensorCmd_ControllerCmd");
@@ -361,8 +550,11 @@ static void ClimateSensorThread(FlowThread thread, void *taskParameters)
 					ClimateControl_Log(ClimateControlLogLevel_Debug, DEBUG_PREFIX "Received Unknown Cmd");
 			}
 		}
+		if (RunSchedule(me, FlowTimer_GetTickCount()))
+		{
+			QueueMeasurementMsg(me);
+		}
 	}
-	StopAndFreeTimers(me);
 }
 
 static void CleanUp(ClimateSensor* me)
@@ -375,36 +567,6 @@ static void CleanUp(ClimateSensor* me)
 		FlowThread_Free(me->climateSensorThread);
 }
 
-static bool NodeValueToInt(TreeNode root, unsigned int* valueToSet, char* nodeName)
-{
-	TreeNode node = TreeNode_Navigate(root, nodeName);
-	if (node)
-	{
-		char *buf = (char *)TreeNode_GetValue(node);
-		if (buf && *buf)
-		{
-			*valueToSet = (unsigned int)strtoul (buf, NULL, 10);
-			return true;
-		}
-	}
-	return false;
-}
-
-static bool NodeValueToFloat(TreeNode root, float* valueToSet, char* nodeName)
-{
-	TreeNode node = TreeNode_Navigate(root, nodeName);
-	if (node)
-	{
-		char *buf = (char *)TreeNode_GetValue(node);
-		if (buf && *buf)
-		{
-			*valueToSet = atof(buf);
-			return true;
-		}
-	}
-	return false;
-}
-
 static void FreeControllerCmd(ControllerCmd *command)
 {
 	if (command)
@@ -421,73 +583,53 @@ static void FreeControllerCmd(ControllerCmd *command)
 	}
 }
 
-static ControllerCmd* CreateControllerCmd(char *cmd, const char *msgString)
+static ControllerCmd* CreateControllerCmd(const ClimateProto_Command *command, const ClimateProto_SensorSettings *settings)
 {
-	ControllerCmd *controllerCmd  = (ControllerCmd *)Flow_MemAlloc(sizeof(ControllerCmd));
-	bool success = false;
+	ControllerCmd *controllerCmd;
+	ClimateSensorSettings *update;
+	if (strcmp(UPDATE_SETTINGS_STR, command->info) != 0)
+	{
+		return NULL;
+	}
+	controllerCmd = (ControllerCmd *)Flow_MemAlloc(sizeof(ControllerCmd));
 	if (controllerCmd)
 	{
-		controllerCmd->cmd = NULL;
-		controllerCmd->payload = NULL;
-		unsigned int len = strlen(cmd);
-		controllerCmd->cmd = (char *)Flow_MemAlloc(len + 1);
-		if (controllerCmd->cmd)
-		{
-			strncpy(controllerCmd->cmd, cmd, len + 1);
-			if (strcmp(UPDATE_SETTINGS_STR, cmd) == 0)
-			{
-				unsigned int msgLen = strlen(msgString);
-				controllerCmd->payload = Flow_MemAlloc(msgLen + 1);
-				if (controllerCmd->payload)
-				{
-					strncpy(controllerCmd->payload, msgString, msgLen + 1);
-					success = true;
-				}
-			}
-		}
-		if (!success)
+		controllerCmd->cmd = FlowString_Duplicate(command->info);
+		controllerCmd->payload = update = Flow_MemAlloc(sizeof(ClimateSensorSettings));
+		if (controllerCmd->cmd && update)
 		{
-			FreeControllerCmd(controllerCmd);
+			update->settings = *settings;
+			update->wireFormat = ClimateProto_WireFormat(command->wire);
+			return controllerCmd;
 		}
+		FreeControllerCmd(controllerCmd);
 	}
-	return controllerCmd;
+	return NULL;
 }
 
 static ControllerCmd* ParseMsgAndCreateControllerCmd(const char* msgString)
 {
-	ControllerCmd *controllerCmd  = NULL;
-	if (msgString)
+	// Sample XML format which we will receive from controller
+	//<?xml version="1.0" encoding="UTF-8"?>
+	//<command>
+	//	<time type="datetime">2014-11-28T15:30:09Z</time>
+	//	<info>UPDATE_SETTINGS</info>
+	//	<wire>1</wire>
+	//	<settings>
+	//		<HeartBeat>15000</HeartBeat>
+	//		<TemperatureReadInterval>1000</TemperatureReadInterval>
+	//		<HumidityReadInterval>2500</HumidityReadInterval>
+	//		<TemperatureReadDelta>0.5</TemperatureReadDelta>
+	//		<HumidityReadDelta>2</HumidityReadDelta>
+	//	</settings>
+	//</command>
+	ClimateProto_Command command;
+	ClimateProto_SensorSettings settings;
+	if (ClimateProto_ParseCommand(msgString, &command, &ClimateProto_SensorSettingsSchema, &settings))
 	{
-		TreeNode xmlTreeRoot = TreeNode_ParseXML((uint8_t*)msgString, strlen(msgString), true);
-		if (xmlTreeRoot)
-		{
-			// Sample XML format which we will receive from controller
-			//<?xml version="1.0" encoding="UTF-8"?>
-			//<command>
-			//	<time type="datetime">2014-11-28T15:30:09Z</time>
-			//	<info>UPDATE_SETTINGS</info>
-			//	<settings>
-			//		<HeartBeat>15000</HeartBeat>
-			//		<TemperatureReadInterval>1000</TemperatureReadInterval>
-			//		<HumidityReadInterval>2500</HumidityReadInterval>
-			//		<TemperatureReadDelta>0.5</TemperatureReadDelta>
-			//		<HumidityReadDelta>2</HumidityReadDelta>
-			//	</settings>
-			//</command>
-
-			TreeNode eventDetails = TreeNode_Navigate(xmlTreeRoot, "command/info");
-			if (eventDetails)
-			{
-				char *buf = (char *)TreeNode_GetValue(eventDetails);
-				if (buf && *buf)
-				{
-					controllerCmd = CreateControllerCmd(buf, msgString);
-				}
-			}
-			Tree_Delete(xmlTreeRoot);
-		}
+		return CreateControllerCmd(&command, &settings);
 	}
-	return controllerCmd;
+	return NULL;
 }
 
 /*============================================================================*/
@@ -516,7 +658,7 @@ void ClimateSensor_Initialize(ClimateSensor* me)
 	Sensor_Init();
 	me->sendMessageQueue = QueueCreate(SEND_MESSAGE_QUEUE_SIZE, sizeof(MeasurementMsg));
 	me->cmdQueue = QueueCreate(CLIMATE_SENSOR_MSG_QUEUE_SIZE, sizeof(ClimateSensorCmd));
-	if (me->sendMessageQueue != 0 && me->cmdQueue != 0)
+	if (me->sendMessageQueue != 0 && me->cmdQueue != 0 && SendMessage_Init())
 	{
 		me->climateSensorThread = FlowThread_New("ClimateSensorThread", USER_TASK_PRIORITY,
 									configMINIMAL_STACK_SIZE, ClimateSensorThread, me);
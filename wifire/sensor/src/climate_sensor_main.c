@@ -42,24 +42,40 @@ static ClimateSensor _sensor =
 			.value = FLT_MAX,
 			.readInterval = MINIMUM_TEMPERATURE_SENSOR_READ_PERIOD,
 			.minimumReadInterval = MINIMUM_TEMPERATURE_SENSOR_READ_PERIOD,
+			.maximumReadInterval = MAXIMUM_TEMPERATURE_SENSOR_READ_PERIOD,
 			.readDelta = DEFAULT_TEMPERATURE_READING_DELTA,
-			.readIntervalString = READ_TEMPERATURE_INTERVAL_XML_TAG,
-			.readDeltaString = READ_TEMPERATURE_DELTA_XML_TAG,
+			.valueField = ClimateProto_SensorInfo_temperature,
+			.readIntervalField = ClimateProto_SensorSettings_temperatureReadInterval,
+			.maximumReadIntervalField = ClimateProto_SensorSettings_temperatureMaxReadInterval,
+			.readDeltaField = ClimateProto_SensorSettings_temperatureReadDelta,
+			.medianSizeField = ClimateProto_SensorSettings_temperatureMedianSize,
+			.filterAlphaField = ClimateProto_SensorSettings_temperatureFilterAlpha,
+			.offsetField = ClimateProto_SensorSettings_temperatureOffset,
+			.gainField = ClimateProto_SensorSettings_temperatureGain,
+			.curveField = ClimateProto_SensorSettings_temperatureCurve,
 			.xmlTagString = TEMPERATURE_XML_TAG,
-			.readFunc = Sensor_ReadTemperature,
-			.readSensorTimer = NULL
+			.calibration = SENSOR_CALIBRATION_NONE,
+			.filter = { .medianSize = DEFAULT_MEDIAN_SIZE, .alpha = DEFAULT_FILTER_ALPHA }
 		},
 		{
 			.type = Sensor_Humidity,
 			.value = FLT_MAX,
 			.readInterval = MINIMUM_HUMIDITY_SENSOR_READ_PERIOD,
 			.minimumReadInterval = MINIMUM_HUMIDITY_SENSOR_READ_PERIOD,
+			.maximumReadInterval = MAXIMUM_HUMIDITY_SENSOR_READ_PERIOD,
 			.readDelta = DEFAULT_HUMIDITY_READING_DELTA,
-			.readIntervalString = READ_HUMIDITY_INTERVAL_XML_TAG,
-			.readDeltaString = READ_HUMIDITY_DELTA_XML_TAG,
+			.valueField = ClimateProto_SensorInfo_humidity,
+			.readIntervalField = ClimateProto_SensorSettings_humidityReadInterval,
+			.maximumReadIntervalField = ClimateProto_SensorSettings_humidityMaxReadInterval,
+			.readDeltaField = ClimateProto_SensorSettings_humidityReadDelta,
+			.medianSizeField = ClimateProto_SensorSettings_humidityMedianSize,
+			.filterAlphaField = ClimateProto_SensorSettings_humidityFilterAlpha,
+			.offsetField = ClimateProto_SensorSettings_humidityOffset,
+			.gainField = ClimateProto_SensorSettings_humidityGain,
+			.curveField = ClimateProto_SensorSettings_humidityCurve,
 			.xmlTagString = HUMIDITY_XML_TAG,
-			.readFunc = Sensor_ReadHumidity,
-			.readSensorTimer = NULL
+			.calibration = SENSOR_CALIBRATION_NONE,
+			.filter = { .medianSize = DEFAULT_MEDIAN_SIZE, .alpha = DEFAULT_FILTER_ALPHA }
 		}
 	}
 };
@@ -0,0 +1,107 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+#include <sys/attribs.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "peripheral/int/plib_int.h"
+#include "peripheral/ports/plib_ports.h"
+#include "dht_capture.h"
+#include "dht_decoder.h"
+
+/*
+ * All of this calculations are for 200MHZ processor
+ * coretickrate = (sys frequency/2) = (200000000/2) =  100000000
+ * therefore for 1 microsecond number of ticks  = (100000000)/(1000000) = 100
+ */
+#define F_CPU  (200000000UL)
+#define CORETIMER_TICKS_PER_MICROSECOND		(F_CPU / 2 / 1000000UL)
+
+#define START_SIGNAL_PERIOD		(20)	// milliseconds, sensor needs the line low for at least 18
+#define REPLY_PERIOD			(7)		// milliseconds, reply takes 160 + 40 * 120 microseconds at most
+
+#define HIGH (0x1)
+#define LOW  (0x0)
+#define DHT_SENSOR_PORT PORT_CHANNEL_B
+#define DHT_SENSOR_PIN PORTS_BIT_POS_9
+
+///Got it from timer.h as we are getting lots of build errors if we include timer.h
+unsigned int __attribute__((nomips16)) ReadCoreTimer(void);
+
+// Core timer counts at edges, written by the interrupt while a reply is captured
+static volatile uint32_t _edges[DHT_DECODER_MAX_EDGES];
+static volatile unsigned int _count;
+
+void __ISR(_CHANGE_NOTICE_B_VECTOR, IPL5AUTO) DhtCapture_ChangeNoticeHandler(void)
+{
+	uint32_t now = ReadCoreTimer();
+
+	//Reading the port ends the mismatch
+	PLIB_PORTS_PinGet(PORTS_ID_0, DHT_SENSOR_PORT, DHT_SENSOR_PIN);
+	if (_count < DHT_DECODER_MAX_EDGES)
+	{
+		_edges[_count++] = now;
+	}
+	PLIB_INT_SourceFlagClear(INT_ID_0, INT_SOURCE_CHANGE_NOTICE_B);
+}
+
+unsigned int DhtCapture_Read(uint32_t *edges, unsigned int maxEdges)
+{
+	unsigned int count;
+	unsigned int i;
+
+	// To request sample from sensor we need to pull pin low for 18 milliseconds,
+	// other tasks run meanwhile
+	PLIB_PORTS_PinModePerPortSelect(PORTS_ID_0, DHT_SENSOR_PORT, DHT_SENSOR_PIN, PORTS_PIN_MODE_DIGITAL);
+	PLIB_PORTS_PinDirectionOutputSet(PORTS_ID_0, DHT_SENSOR_PORT, DHT_SENSOR_PIN);
+	PLIB_PORTS_PinWrite(PORTS_ID_0, DHT_SENSOR_PORT, DHT_SENSOR_PIN, LOW);
+	vTaskDelay(START_SIGNAL_PERIOD / portTICK_RATE_MS);
+
+	// Release the line, sensor replies after 20-40 microseconds
+	PLIB_PORTS_PinWrite(PORTS_ID_0, DHT_SENSOR_PORT, DHT_SENSOR_PIN, HIGH);
+	PLIB_PORTS_PinDirectionInputSet(PORTS_ID_0, DHT_SENSOR_PORT, DHT_SENSOR_PIN);
+
+	_count = 0;
+	PLIB_PORTS_ChangeNoticePerPortTurnOn(PORTS_ID_0, DHT_SENSOR_PORT);
+	PLIB_PORTS_PinChangeNoticePerPortEnable(PORTS_ID_0, DHT_SENSOR_PORT, DHT_SENSOR_PIN);
+	PLIB_PORTS_PinGet(PORTS_ID_0, DHT_SENSOR_PORT, DHT_SENSOR_PIN);
+	PLIB_INT_VectorPrioritySet(INT_ID_0, INT_VECTOR_CHANGE_NOTICE_B, INT_PRIORITY_LEVEL5);
+	PLIB_INT_SourceFlagClear(INT_ID_0, INT_SOURCE_CHANGE_NOTICE_B);
+	PLIB_INT_SourceEnable(INT_ID_0, INT_SOURCE_CHANGE_NOTICE_B);
+
+	vTaskDelay(REPLY_PERIOD / portTICK_RATE_MS);
+
+	PLIB_INT_SourceDisable(INT_ID_0, INT_SOURCE_CHANGE_NOTICE_B);
+	PLIB_PORTS_PinChangeNoticePerPortDisable(PORTS_ID_0, DHT_SENSOR_PORT, DHT_SENSOR_PIN);
+	PLIB_PORTS_ChangeNoticePerPortTurnOff(PORTS_ID_0, DHT_SENSOR_PORT);
+
+	count = (_count < maxEdges) ? _count : maxEdges;
+	for (i = 0; i < count; ++i)
+	{
+		edges[i] = (_edges[i] - _edges[0]) / CORETIMER_TICKS_PER_MICROSECOND;
+	}
+	return count;
+}
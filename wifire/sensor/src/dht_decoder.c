@@ -0,0 +1,104 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+#include <string.h>
+
+#include "dht_decoder.h"
+
+// from the DHT11 datasheet, with margin for capture latency
+#define GLITCH				(5)		// microseconds, shorter pulses are noise
+#define MIN_RESPONSE		(40)	// microseconds, response low and high are 80
+#define MAX_RESPONSE		(120)	// microseconds
+#define MIN_BIT_LOW			(25)	// microseconds, low before each bit is 50
+#define MAX_BIT_LOW			(90)	// microseconds
+#define MAX_BIT_HIGH		(100)	// microseconds
+#define ONE_BIT_HIGH		(48)	// microseconds, midway between 0's 28 and 1's 70
+
+static bool IsWithin(uint32_t length, uint32_t minimum, uint32_t maximum)
+{
+	return (length >= minimum) && (length <= maximum);
+}
+
+/*
+ * Copy edges to clean, dropping any edge which comes within a glitch of
+ * the last one kept along with that one. Return number of edges kept.
+ */
+static unsigned int DropGlitches(const uint32_t *edges, unsigned int count, uint32_t *clean)
+{
+	unsigned int kept = 0;
+	unsigned int i;
+
+	for (i = 0; i < count; ++i)
+	{
+		if ((kept > 0) && ((edges[i] - clean[kept - 1]) < GLITCH))
+		{
+			//Edge undoes the last one
+			kept--;
+		}
+		else if (kept < DHT_DECODER_MAX_EDGES)
+		{
+			clean[kept++] = edges[i];
+		}
+	}
+	return kept;
+}
+
+bool DhtDecoder_Decode(const uint32_t *edges, unsigned int count, uint8_t *bytes)
+{
+	uint32_t clean[DHT_DECODER_MAX_EDGES];
+	unsigned int kept = DropGlitches(edges, count, clean);
+	uint8_t sum = 0;
+	unsigned int i;
+
+	if ((kept < DHT_DECODER_NUM_EDGES)
+		|| !IsWithin(clean[1] - clean[0], MIN_RESPONSE, MAX_RESPONSE)
+		|| !IsWithin(clean[2] - clean[1], MIN_RESPONSE, MAX_RESPONSE))
+	{
+		return false;
+	}
+
+	memset(bytes, 0, DHT_DECODER_NUM_BYTES);
+	for (i = 0; i < 8 * DHT_DECODER_NUM_BYTES; ++i)
+	{
+		//Falling edge starting the bit's low, rising edge starting its high, falling edge ending it
+		const uint32_t *bit = &clean[2 + 2 * i];
+		uint32_t high = bit[2] - bit[1];
+
+		if (!IsWithin(bit[1] - bit[0], MIN_BIT_LOW, MAX_BIT_LOW) || (high > MAX_BIT_HIGH))
+		{
+			return false;
+		}
+		if (high > ONE_BIT_HIGH)
+		{
+			bytes[i / 8] |= 0x80 >> (i % 8);
+		}
+	}
+
+	for (i = 0; i < DHT_DECODER_NUM_BYTES - 1; ++i)
+	{
+		sum += bytes[i];
+	}
+	return (sum == bytes[DHT_DECODER_NUM_BYTES - 1]);
+}
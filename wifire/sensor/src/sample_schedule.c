@@ -0,0 +1,75 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+#include "sample_schedule.h"
+
+#define ACTIVITY_WEIGHT (0.25f)	// of a new squared change in the average
+#define ACTIVITY_FRACTION (0.25f)	// of read delta, changes above count as movement
+
+void SampleSchedule_Reset(SampleSchedule *me, unsigned int interval, unsigned int now)
+{
+	me->interval = interval;
+	me->dueTick = now + interval;
+	me->activity = 0.0f;
+	me->hasValue = false;
+}
+
+void SampleSchedule_Update(SampleSchedule *me, float value, float readDelta,
+							unsigned int minimumInterval, unsigned int maximumInterval, unsigned int now)
+{
+	float threshold = readDelta * ACTIVITY_FRACTION;
+	bool isMoving = true;
+
+	if (me->hasValue)
+	{
+		float change = value - me->lastValue;
+
+		me->activity += ACTIVITY_WEIGHT * (change * change - me->activity);
+		isMoving = (change > threshold) || (change < -threshold) || (me->activity > threshold * threshold);
+	}
+	me->lastValue = value;
+	me->hasValue = true;
+
+	if (isMoving || (me->interval < minimumInterval))
+	{
+		me->interval = minimumInterval;
+	}
+	else
+	{
+		me->interval *= 2;
+	}
+	if (me->interval > maximumInterval)
+	{
+		me->interval = (maximumInterval > minimumInterval) ? maximumInterval : minimumInterval;
+	}
+	me->dueTick = now + me->interval;
+}
+
+unsigned int SampleSchedule_TimeToDue(const SampleSchedule *me, unsigned int now)
+{
+	int remaining = (int)(me->dueTick - now);
+
+	return (remaining > 0) ? (unsigned int)remaining : 0;
+}
@@ -24,39 +24,54 @@
 *******************************************************************************************************/
 
 #include "sensor_adc.h"
-#include "adc_custom.h"
+#include "adc_scan.h"
+#include "sensor_calibration.h"
 
 #define  WIFIRE_POTENTIOMETER_PIN (12)
+#define  ADC_OVERSAMPLING (16)	// conversions averaged by the ADC per value
+#define  ADC_FULL_SCALE_VOLTS (3.3)
+#define  ADC_MAX_CODE (4095)
+
+//Gain from ADC code, of volts times scale, in 1/256 units
+#define  ADC_GAIN(scale) ((int32_t)(ADC_FULL_SCALE_VOLTS * (scale) / ADC_MAX_CODE * \
+	(1 << (SENSOR_CALIBRATION_READING_BITS + SENSOR_CALIBRATION_GAIN_BITS)) + 0.5))
+
+//Linear approximations, values will be in the range of -25 to 24.5 and 0 to 99
+static const SensorCalibration _temperatureScale = { .offset = -25 * (1 << SENSOR_CALIBRATION_READING_BITS), .gain = ADC_GAIN(15), .curve = 0 };
+static const SensorCalibration _humidityScale = { .offset = 0, .gain = ADC_GAIN(30), .curve = 0 };
 
 void Sensor_ADC_Init(void)
 {
 	//ADC setup
-	adc12_Init();
-	adc12_ConfigPort(WIFIRE_POTENTIOMETER_PIN);
-	adc12_Enable();
+	AdcScan_Init();
+	AdcScan_AddChannel(WIFIRE_POTENTIOMETER_PIN, ADC_OVERSAMPLING);
+	AdcScan_Start();
 }
 
 
-bool Sensor_ADC_ReadHumidityAndTemperature(float* const humidity, float* const temperature)
+bool Sensor_ADC_ReadHumidityAndTemperature(int32_t* const humidity, int32_t* const temperature)
 {
 	return Sensor_ADC_ReadTemperature(temperature) && Sensor_ADC_ReadHumidity(humidity);
 }
 
-bool Sensor_ADC_ReadTemperature(float* const temperature)
+bool Sensor_ADC_ReadTemperature(int32_t* const temperature)
 {
-	unsigned int adcValue =  adc12_Read(WIFIRE_POTENTIOMETER_PIN);
-	*temperature = adcValue * 3.3 / 4095;
-	//Linear approximation, value will be in the range of -25 to 24.5
-	*temperature *= 15;
-	*temperature -= 25;
+	unsigned int adcValue;
+	if (!AdcScan_Latest(WIFIRE_POTENTIOMETER_PIN, &adcValue))
+	{
+		return false;
+	}
+	*temperature = SensorCalibration_Apply(&_temperatureScale, adcValue);
 	return true;
 }
 
-bool Sensor_ADC_ReadHumidity(float* const humidity)
+bool Sensor_ADC_ReadHumidity(int32_t* const humidity)
 {
-	unsigned int adcValue =  adc12_Read(WIFIRE_POTENTIOMETER_PIN);
-	*humidity = adcValue * 3.3 / 4095;
-	//Linear approximation, value will be in the range of 0 to 99
-	*humidity *= 30;
+	unsigned int adcValue;
+	if (!AdcScan_Latest(WIFIRE_POTENTIOMETER_PIN, &adcValue))
+	{
+		return false;
+	}
+	*humidity = SensorCalibration_Apply(&_humidityScale, adcValue);
 	return true;
 }
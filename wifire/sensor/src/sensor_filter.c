@@ -0,0 +1,103 @@
+/**************************************************************************************************
+	Copyright (c) 2015, Imagination Technologies Limited
+	All rights reserved.
+	Redistribution and use of the Software in source and binary forms, with or without modification,
+	are permitted provided that the following conditions are met:
+	1. The Software (including after any modifications that you make to it) must support
+	   the FlowCloud Web Service API provided by Licensor and accessible at http://ws-uat.flowworld.com
+	   and/or some other location(s) that we specify.
+	2. Redistributions of source code must retain the above copyright notice, this list of
+	   conditions and the following disclaimer.
+	3. Redistributions in binary form must reproduce the above copyright notice, this list
+	   of conditions and the following disclaimer in the documentation and/or other materials
+	   provided with the distribution.
+	4. Neither the name of the copyright holder nor the names of its contributors may be used
+	   to endorse or promote products derived from this Software without specific prior written permission.
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+	IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+	FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+	DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+	IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+	THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************************************/
+
+#include "sensor_filter.h"
+
+bool SensorFilter_Configure(SensorFilter *me, unsigned int medianSize, uint32_t alpha)
+{
+	if ((medianSize > SENSOR_FILTER_MAX_MEDIAN_SIZE) || (alpha == 0) || (alpha > SENSOR_FILTER_ALPHA_ONE))
+	{
+		return false;
+	}
+	me->medianSize = medianSize;
+	me->alpha = alpha;
+	SensorFilter_Reset(me);
+	return true;
+}
+
+void SensorFilter_Reset(SensorFilter *me)
+{
+	me->count = 0;
+	me->next = 0;
+}
+
+/*
+ * Median of the readings in the window. While it fills, that of the
+ * readings so far, the lower middle one if there is an even number.
+ */
+static int32_t Median(const SensorFilter *me)
+{
+	int32_t sorted[SENSOR_FILTER_MAX_MEDIAN_SIZE];
+	unsigned int i, j;
+
+	//Insertion sort, the window is a handful of readings
+	for (i = 0; i < me->count; ++i)
+	{
+		int32_t reading = me->window[i];
+
+		for (j = i; (j > 0) && (sorted[j - 1] > reading); --j)
+		{
+			sorted[j] = sorted[j - 1];
+		}
+		sorted[j] = reading;
+	}
+	return sorted[(me->count - 1) / 2];
+}
+
+/*
+ * Filtered reading. The average moves by alpha of the difference, rounded
+ * to nearest rather than down, so that it does not drift low.
+ */
+int32_t SensorFilter_Apply(SensorFilter *me, int32_t reading)
+{
+	int32_t value = reading;
+	bool isFirst = (me->count == 0);
+
+	if (me->medianSize > 1)
+	{
+		me->window[me->next] = reading;
+		me->next = (me->next + 1) % me->medianSize;
+		if (me->count < me->medianSize)
+		{
+			me->count++;
+		}
+		value = Median(me);
+	}
+	else
+	{
+		me->count = 1;
+	}
+
+	if (isFirst || (me->alpha == 0) || (me->alpha >= SENSOR_FILTER_ALPHA_ONE))
+	{
+		me->average = value;
+	}
+	else
+	{
+		me->average += (int32_t)(((int64_t)(value - me->average) * me->alpha +
+									(SENSOR_FILTER_ALPHA_ONE / 2)) >> SENSOR_FILTER_ALPHA_BITS);
+	}
+	return me->average;
+}
@@ -26,8 +26,9 @@
 *******************************************************************************************************/
 
 #include "sensor_thermistor.h"
-#include "adc_custom.h"
-#include <math.h>
+#include "adc_scan.h"
+#include "ntc_ncp18wf104.h"
+#include "sensor_calibration.h"
 #include "peripheral/ports/plib_ports.h"
 
 /*
@@ -38,17 +39,18 @@
  */
 
 #define THERMISTOR_INPUT_ADC_NUM	(2)
-#define B_CONSTANT					(4200)
+#define ADC_OVERSAMPLING			(16)	// conversions averaged by the ADC per value
+
+#if NTC_TABLE_FRACTION_BITS != SENSOR_CALIBRATION_READING_BITS
+#error Table temperatures are taken as readings as they are
+#endif
 
 void Sensor_Thermistor_Init(void)
 {
 	//ADC setup
-	adc12_Init();
-	adc12_ConfigPort(THERMISTOR_INPUT_ADC_NUM);
-	adc12_Enable();
-
-	//TBD: temporary fix for first reading being wrong
-	adc12_Read(THERMISTOR_INPUT_ADC_NUM);
+	AdcScan_Init();
+	AdcScan_AddChannel(THERMISTOR_INPUT_ADC_NUM, ADC_OVERSAMPLING);
+	AdcScan_Start();
 }
 
 /*
@@ -59,14 +61,28 @@ void Sensor_Thermistor_Init(void)
  *		B: B-Constant of Thermistor
  *
  *		B=ln (R/R0) / (1/T-1/T0)
+ *
+ *  worked out for every ADC code ahead of time into NtcTable_NCP18WF104,
+ *  see ntc_table.py
  */
 
-bool Sensor_Thermistor_ReadTemperature(float *const temperature)
+bool Sensor_Thermistor_Convert(unsigned int adcValue, int32_t *const temperature)
 {
-	//TBD: temporary fix for first reading being wrong
-	adc12_Read(THERMISTOR_INPUT_ADC_NUM);
-	unsigned int adcValue =  adc12_Read(THERMISTOR_INPUT_ADC_NUM);
-	float resistance=(float)((4096-adcValue)*100000)/(adcValue); //get the resistance of the sensor;
-	*temperature=1/(log(resistance/100000)/B_CONSTANT+1/298.15)-273.15;//convert to temperature via datasheet ;
+	if (adcValue == 0)
+	{
+		return false;
+	}
+	*temperature = NtcTable_Lookup(NtcTable_NCP18WF104, adcValue);
 	return true;
 }
+
+bool Sensor_Thermistor_ReadTemperature(int32_t *const temperature)
+{
+	// Averaged in scan mode, so a first conversion off does not show
+	unsigned int adcValue;
+	if (!AdcScan_Latest(THERMISTOR_INPUT_ADC_NUM, &adcValue))
+	{
+		return false;
+	}
+	return Sensor_Thermistor_Convert(adcValue, temperature);
+}
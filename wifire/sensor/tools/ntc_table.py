@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+""" Generates the temperature table of an NTC thermistor for ntc_table.h
+
+The thermistor is the lower half of a divider with a series resistor, R0
+unless given, read by a 12-bit ADC, so that at code c its resistance is
+series * (4096 - c) / c. Its temperature follows the B equation
+
+    1/T = ln(R/R0)/B + 1/T0, with T0 = 298.15 K (25 C)
+
+Written to output, or printed, as a header with a static table named
+NtcTable_<name>, and the part's constants as NTC_<name>_B_CONSTANT and
+NTC_<name>_R0. The license comment is that of ntc_table.h.
+
+Usage: ntc_table.py --name NAME --b B --r0 OHMS [--series OHMS] [-o header.h]
+"""
+
+import argparse
+import math
+import os
+import sys
+
+
+# Must match ntc_table.h
+CODE_BITS = 12
+STEP_BITS = 4
+FRACTION_BITS = 8
+T0 = 298.15
+KELVIN = 273.15
+
+NTC_TABLE_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "include", "ntc_table.h")
+
+
+def temperature(code, b_constant, r0, series):
+    """ Returns the temperature in degree C at an ADC code, 1 to 4095
+    """
+    resistance = series * ((1 << CODE_BITS) - code) / code
+    return 1.0 / (math.log(resistance / r0) / b_constant + 1.0 / T0) - KELVIN
+
+
+def make_table(b_constant, r0, series):
+    """ Returns the fixed point temperatures every step codes, from code 0 to 4096
+
+    Codes 0 and 4096 have no temperature, so they take those of codes 1
+    and 4095.
+    """
+    last = (1 << CODE_BITS) - 1
+    table = []
+    for code in range(0, (1 << CODE_BITS) + 1, 1 << STEP_BITS):
+        value = temperature(min(max(code, 1), last), b_constant, r0, series)
+        table.append(int(round(value * (1 << FRACTION_BITS))))
+    if any(later < earlier for earlier, later in zip(table, table[1:])):
+        raise ValueError("temperature does not rise with the code")
+    if any(abs(value) >= 1 << 23 for value in table):
+        raise ValueError("temperature out of the fixed point range")
+    return table
+
+
+def license_comment():
+    """ Returns the license comment at the top of ntc_table.h
+    """
+    with open(NTC_TABLE_H) as header:
+        text = header.read()
+    return text[:text.index("*/") + 2] + "\n"
+
+
+def write_header(out, name, b_constant, r0, series, table):
+    """ Writes the table as a header
+    """
+    guard = "NTC_%s_H" % name.upper()
+    out.write(license_comment())
+    out.write("\n/*\n")
+    out.write(" * Generated by wifire/sensor/tools/ntc_table.py --name %s --b %g --r0 %g --series %g\n"
+              % (name, b_constant, r0, series))
+    out.write(" * Do not edit, run it again instead.\n */\n\n")
+    out.write("#ifndef %s\n#define\t%s\n\n" % (guard, guard))
+    out.write("#include \"ntc_table.h\"\n\n")
+    out.write("#define NTC_%s_B_CONSTANT\t\t(%g)\n" % (name.upper(), b_constant))
+    out.write("#define NTC_%s_R0\t\t\t\t(%g)\n\n" % (name.upper(), r0))
+    out.write("static const int32_t NtcTable_%s[NTC_TABLE_SIZE] =\n{\n" % name)
+    for start in range(0, len(table), 8):
+        row = ", ".join("%d" % value for value in table[start:start + 8])
+        out.write("\t%s%s\n" % (row, "," if start + 8 < len(table) else ""))
+    out.write("};\n\n#endif\t/* %s */\n" % guard)
+
+
+def main():
+    """ Generates the table asked for, returns process exit status
+    """
+    parser = argparse.ArgumentParser(description="Generate an NTC thermistor table")
+    parser.add_argument("--name", required=True, help="part name, used in the table and macro names")
+    parser.add_argument("--b", type=float, required=True, help="B constant of the thermistor")
+    parser.add_argument("--r0", type=float, required=True, help="resistance at 25 C in ohms")
+    parser.add_argument("--series", type=float, help="series resistor in ohms, R0 if not given")
+    parser.add_argument("-o", "--output", help="header to write, standard output if not given")
+    args = parser.parse_args()
+    series = args.series if args.series else args.r0
+    try:
+        table = make_table(args.b, args.r0, series)
+    except ValueError as error:
+        sys.stderr.write("%s\n" % error)
+        return 1
+    if args.output:
+        with open(args.output, "w") as out:
+            write_header(out, args.name, args.b, args.r0, series, table)
+    else:
+        write_header(sys.stdout, args.name, args.b, args.r0, series, table)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())